@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""
+Benchmark de la analítica de ocupación con eventos sintéticos
+
+Genera N eventos de una flota de S espacios en orden de llegada (R eventos
+por segundo en total), con reinicios de dispositivos que pierden la salida
+de la sesión abierta. Mide la ingesta en OccupancyAnalytics, la memoria y
+las consultas sobre el resultado. Los primeros --check eventos se vuelven a
+calcular recorriendo el historial completo (lo que haría un análisis ad hoc
+del log) para comprobar los acumulados y estimar cuánto costaría esa
+consulta con los N eventos.
+
+Uso:
+    python analytics_bench.py                       # 100 M eventos, 10000 espacios
+    python analytics_bench.py --events 2000000 --output analytics_bench.json
+"""
+
+import argparse
+import json
+import random
+import resource
+import sys
+import time
+
+from occupancy_analytics import DWELL, SESSIONS, OccupancyAnalytics
+
+START = 1_735_689_600.0   # 2025-01-01 00:00 UTC
+
+
+def make_events(count, spots, rate, restart_rate, seed):
+    """(hora, parkingId, ocupado, timestamp) en orden; alterna ocupado/libre por espacio"""
+    rng = random.Random(seed)
+    # Una secuencia de espacios precalculada recorrida con desplazamientos
+    # distintos: evita un random() por evento sin repetir el mismo orden
+    picks = [rng.randrange(spots) + 1 for _ in range(1 << 16)]
+    restarts = set(rng.randrange(count) for _ in range(int(count * restart_rate)))
+    occupied = [False] * (spots + 1)
+    boot = [START] * (spots + 1)
+    step = 1.0 / rate
+    index = 0
+    shift = 0
+    for i in range(count):
+        parking_id = picks[index]
+        index += 1
+        if index == len(picks):
+            shift = (shift + 7919) % len(picks)
+            index = shift
+        when = START + i * step
+        if i in restarts:
+            # Se reinició mientras estaba ocupado: la salida no llegó
+            boot[parking_id] = when
+            occupied[parking_id] = False
+        state = not occupied[parking_id]
+        occupied[parking_id] = state
+        yield when, parking_id, state, int((when - boot[parking_id]) * 1000)
+
+
+def rescan(events, utc_offset):
+    """Los mismos totales y filas diarias recorriendo todos los eventos"""
+    open_sessions, last_seen, last_timestamp = {}, {}, {}
+    totals = {"sessions": 0, "truncated": 0, "dwell": 0.0}
+    days = {}
+    for when, parking_id, occupied, timestamp in events:
+        end = None
+        if parking_id in last_timestamp and timestamp < last_timestamp[parking_id] \
+                and parking_id in open_sessions:
+            end, complete = last_seen[parking_id], False
+        elif not occupied and parking_id in open_sessions:
+            end, complete = when, True
+        if end is not None:
+            start = open_sessions.pop(parking_id)
+            day = days.setdefault(int((end + utc_offset) // 86400), [0, 0.0])
+            if complete:
+                totals["sessions"] += 1
+                totals["dwell"] += end - start
+                day[0] += 1
+                day[1] += end - start
+            else:
+                totals["truncated"] += 1
+        if occupied and parking_id not in open_sessions:
+            open_sessions[parking_id] = when
+        last_timestamp[parking_id] = timestamp
+        last_seen[parking_id] = when
+    return totals, days
+
+
+def time_query(function, repeat):
+    start = time.perf_counter()
+    for _ in range(repeat):
+        function()
+    return (time.perf_counter() - start) / repeat * 1e6
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark de la analítica de ocupación")
+    parser.add_argument("--events", type=int, default=100_000_000)
+    parser.add_argument("--spots", type=int, default=10_000)
+    parser.add_argument("--rate", type=float, default=20.0, help="Eventos por segundo de la flota")
+    parser.add_argument("--restart-rate", type=float, default=1e-4, help="Reinicios por evento")
+    parser.add_argument("--check", type=int, default=1_000_000,
+                        help="Eventos recalculados recorriendo el historial")
+    parser.add_argument("--output", default=None, help="Guardar el resultado en JSON")
+    args = parser.parse_args()
+
+    # ---- Comprobación contra el recorrido completo ----
+    check_events = list(make_events(min(args.check, args.events), args.spots, args.rate,
+                                    args.restart_rate, 1))
+    reference = OccupancyAnalytics(utc_offset=0)
+    for when, parking_id, occupied, timestamp in check_events:
+        reference.record(parking_id, occupied, when, timestamp)
+    start = time.perf_counter()
+    totals, days = rescan(check_events, 0)
+    rescan_s = time.perf_counter() - start
+    summary = reference.summary(now=check_events[-1][0])
+    matches = (summary["sessions"] == totals["sessions"] and summary["truncated"] == totals["truncated"]
+               and abs(reference.totals[DWELL] - totals["dwell"]) < 1e-3 * max(1.0, totals["dwell"])
+               and all(reference.days[key][SESSIONS] == row[0] for key, row in days.items()))
+    del check_events
+
+    # ---- Ingesta ----
+    analytics = OccupancyAnalytics(utc_offset=0)
+    record = analytics.record
+    report_every = max(1, args.events // 10)
+    start = time.perf_counter()
+    last = START
+    for i, (when, parking_id, occupied, timestamp) in enumerate(
+            make_events(args.events, args.spots, args.rate, args.restart_rate, 2)):
+        record(parking_id, occupied, when, timestamp)
+        last = when
+        if (i + 1) % report_every == 0:
+            elapsed = time.perf_counter() - start
+            print(f"   {i + 1:>12} eventos  {(i + 1) / elapsed / 1e3:8.0f} k eventos/s", flush=True)
+    ingest_s = time.perf_counter() - start
+
+    # Solo la generación, para descontarla de la ingesta
+    sample = min(args.events, 2_000_000)
+    gen_start = time.perf_counter()
+    for _ in make_events(sample, args.spots, args.rate, args.restart_rate, 3):
+        pass
+    generated = (time.perf_counter() - gen_start) / sample * args.events
+    record_ns = max(0.0, ingest_s - generated) / args.events * 1e9
+    rss_mb = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+
+    # ---- Consultas ----
+    now = last
+    summary_us = time_query(lambda: analytics.summary(now), 1000)
+    spot_us = time_query(lambda: analytics.spot(args.spots // 2, now), 1000)
+    hourly_us = time_query(lambda: analytics.hourly(now - 86400, now, now), 20)
+    daily_us = time_query(lambda: analytics.daily(now - 30 * 86400, now, now), 20)
+    rescan_estimate_s = rescan_s / max(1, min(args.check, args.events)) * args.events
+    final = analytics.summary(now)
+
+    result = {
+        "events": args.events,
+        "spots": args.spots,
+        "span_days": round((now - START) / 86400, 1),
+        "ingest_s": round(ingest_s, 1),
+        "record_ns": round(record_ns),
+        "max_rss_mb": round(rss_mb, 1),
+        "hours": len(analytics.hours),
+        "days": len(analytics.days),
+        "summary_us": round(summary_us, 1),
+        "spot_us": round(spot_us, 1),
+        "hourly_24h_us": round(hourly_us, 1),
+        "daily_30d_us": round(daily_us, 1),
+        "rescan_s_estimate": round(rescan_estimate_s, 1),
+        "check_matches": matches,
+        "summary": final,
+    }
+
+    print("\n📈 ANALÍTICA DE OCUPACIÓN")
+    print("=" * 55)
+    print(f"   Eventos: {args.events} de {args.spots} espacios en {result['span_days']} días")
+    print(f"   Ingesta: {ingest_s:.1f} s ({args.events / ingest_s / 1e3:.0f} k eventos/s con la generación), "
+          f"record(): {record_ns:.0f} ns")
+    print(f"   Memoria máxima: {rss_mb:.0f} MB ({len(analytics.hours)} horas, {len(analytics.days)} días)")
+    print(f"   summary(): {summary_us:.1f} µs   spot(): {spot_us:.1f} µs")
+    print(f"   hourly(24 h): {hourly_us:.0f} µs   daily(30 d): {daily_us:.0f} µs")
+    print(f"   Recorrer el historial: ~{rescan_estimate_s:.0f} s por consulta")
+    print(f"   Sesiones: {final['sessions']} (+{final['truncated']} truncadas), "
+          f"estadía promedio {final['avg_dwell_s']} s, utilización {final['utilization']}")
+    print(f"   Comprobación ({min(args.check, args.events)} eventos): {'✅' if matches else '❌'}")
+    print("=" * 55)
+
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            json.dump(result, f, indent=2)
+        print(f"📁 Resultado guardado en {args.output}")
+    return 0 if matches else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
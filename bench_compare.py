@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Comparación de resultados de microbenchmarks contra una línea base
+
+Lee el JSON del env bench (o la salida serie del env bench_esp32, donde
+busca la línea JSON) y lo compara caso por caso con la línea base guardada.
+Sale con código 1 si algún caso empeora más allá de la tolerancia. Un caso
+de la línea base puede fijar su propia tolerancia con la clave "tolerance"
+(p. ej. los que incluyen llamadas al sistema); --update la conserva.
+
+Uso:
+    .pio/build/bench/program > resultados.json
+    python bench_compare.py resultados.json
+    python bench_compare.py resultados.json --update     # Guardar como nueva línea base
+"""
+
+import argparse
+import json
+import os
+import sys
+
+BASELINE_DIR = "benchmarks"
+PEAK_TOLERANCE = 0.05
+
+
+def load_results(path):
+    """Cargar resultados; acepta un JSON o un log con una línea JSON"""
+    with open(path, "r", encoding="utf-8") as f:
+        text = f.read()
+    try:
+        return json.loads(text)
+    except json.JSONDecodeError:
+        for line in text.splitlines():
+            line = line.strip()
+            if line.startswith('{"platform"'):
+                return json.loads(line)
+    raise ValueError(f"No se encontraron resultados en {path}")
+
+
+def default_baseline(results):
+    return os.path.join(BASELINE_DIR, f"baseline_{results['platform']}.json")
+
+
+def compare(current, baseline, tolerance):
+    """Comparar dos conjuntos de resultados; retorna (filas, regresiones)"""
+    base_by_name = {r["name"]: r for r in baseline["results"]}
+    rows = []
+    regressions = []
+
+    for result in current["results"]:
+        name = result["name"]
+        base = base_by_name.pop(name, None)
+        if base is None:
+            rows.append((name, result["ns_per_op"], None, None, "nuevo"))
+            continue
+
+        ratio = result["ns_per_op"] / base["ns_per_op"] if base["ns_per_op"] else 1.0
+        notes = []
+        if ratio > 1.0 + base.get("tolerance", tolerance):
+            notes.append(f"tiempo +{(ratio - 1) * 100:.0f}%")
+
+        # Las asignaciones son deterministas: cualquier aumento es una regresión
+        for key, label in (("allocs_per_op", "allocs"), ("bytes_per_op", "bytes")):
+            now, before = result.get(key), base.get(key)
+            if now is not None and before is not None and now > before + 0.01:
+                notes.append(f"{label} {before:g} → {now:g}")
+
+        # Pico de heap informado por el caso (p. ej. OpenSSL): varía unos bytes entre corridas
+        now, before = result.get("peak_bytes"), base.get("peak_bytes")
+        if now is not None and before is not None and now > before * (1 + PEAK_TOLERANCE):
+            notes.append(f"pico {before:g} → {now:g}")
+
+        if notes:
+            regressions.append(name)
+        rows.append((name, result["ns_per_op"], base["ns_per_op"], ratio, ", ".join(notes) or "ok"))
+
+    for name in base_by_name:
+        rows.append((name, None, base_by_name[name]["ns_per_op"], None, "falta"))
+
+    return rows, regressions
+
+
+def print_table(rows):
+    print(f"{'caso':<22} {'ns/op':>12} {'base':>12} {'razón':>7}  estado")
+    for name, now, before, ratio, status in rows:
+        now_text = f"{now:.1f}" if now is not None else "-"
+        before_text = f"{before:.1f}" if before is not None else "-"
+        ratio_text = f"{ratio:.2f}" if ratio is not None else "-"
+        print(f"{name:<22} {now_text:>12} {before_text:>12} {ratio_text:>7}  {status}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Comparar microbenchmarks con la línea base")
+    parser.add_argument("results", help="JSON del env bench o log serie del env bench_esp32")
+    parser.add_argument("--baseline", help="Línea base (por defecto benchmarks/baseline_<plataforma>.json)")
+    parser.add_argument("--tolerance", type=float, default=0.15,
+                        help="Aumento de ns/op tolerado (0.15 = 15%%)")
+    parser.add_argument("--update", action="store_true", help="Guardar los resultados como línea base")
+    args = parser.parse_args()
+
+    current = load_results(args.results)
+    baseline_path = args.baseline or default_baseline(current)
+
+    if args.update:
+        # Conservar las tolerancias por caso de la línea base anterior
+        if os.path.exists(baseline_path):
+            with open(baseline_path, "r", encoding="utf-8") as f:
+                previous = {r["name"]: r for r in json.load(f)["results"]}
+            for result in current["results"]:
+                if "tolerance" in previous.get(result["name"], {}):
+                    result["tolerance"] = previous[result["name"]]["tolerance"]
+
+        os.makedirs(os.path.dirname(baseline_path) or ".", exist_ok=True)
+        with open(baseline_path, "w", encoding="utf-8") as f:
+            json.dump(current, f, indent=2)
+            f.write("\n")
+        print(f"💾 Línea base actualizada: {baseline_path}")
+        return 0
+
+    if not os.path.exists(baseline_path):
+        print(f"❌ No existe la línea base {baseline_path}; créala con --update")
+        return 1
+
+    with open(baseline_path, "r", encoding="utf-8") as f:
+        baseline = json.load(f)
+
+    rows, regressions = compare(current, baseline, args.tolerance)
+    print_table(rows)
+
+    if regressions:
+        print(f"\n❌ Regresiones en: {', '.join(regressions)}")
+        return 1
+    print("\n✅ Sin regresiones")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
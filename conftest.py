@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""
+Fixtures compartidas por las pruebas del servidor (pytest las carga solo)
+
+- start_server(**opciones): arranca un ParkingServer en 127.0.0.1 con puerto
+  libre, dentro de tmp_path; las opciones van al constructor.
+- server: el mismo con las opciones por defecto.
+Los servidores que la prueba no detuvo se detienen al terminar.
+"""
+
+import threading
+import time
+
+import pytest
+
+from parking_server import ParkingServer
+
+
+@pytest.fixture
+def start_server(tmp_path, monkeypatch):
+    monkeypatch.chdir(tmp_path)
+    started = []
+
+    def start(**options):
+        options.setdefault("quiet", True)
+        srv = ParkingServer('127.0.0.1', 0, **options)
+        started.append(srv)
+        threading.Thread(target=srv.start_server, daemon=True).start()
+        # Con http_port la API HTTP arranca después de marcar running
+        while not srv.running or (options.get("http_port") is not None and srv.http_server is None):
+            time.sleep(0.01)
+        return srv
+
+    yield start
+    for srv in started:
+        if srv.running:
+            srv.stop_server()
+
+
+@pytest.fixture
+def server(start_server):
+    return start_server()
@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""
+Prueba de escala del servidor con el simulador de flota (firmware en el host)
+
+Levanta parking_server.py, ejecuta N sensores simulados (env fleet_sim) y
+opcionalmente reinicia el servidor a mitad de la prueba para provocar una
+tormenta de reconexiones. Muestra un resumen y guarda el informe JSON.
+
+Uso:
+    pio run -e fleet_sim
+    python fleet_simulator.py --devices 500 --duration 90 --restart-at 40 --downtime 10
+    python fleet_simulator.py --devices 200 --speed 20 -- --image-rate 1.0   # Imágenes/s
+    python fleet_simulator.py --devices 500 --speed 20 -- --heartbeat 30000  # Modo heartbeat
+    python fleet_simulator.py --devices 200 -- --gateways 4                  # Modo gateway
+    python fleet_simulator.py --devices 50 -- --transport udp --loss 0.05    # UDP con pérdida
+    python fleet_simulator.py --devices 1000 --speed 50 --sweep 1,2,4,8     # Escala con --workers
+"""
+
+import argparse
+import json
+import os
+import signal
+import socket
+import subprocess
+import sys
+import threading
+import time
+
+from sharded_ingest import WORKER_TIMEOUT
+
+DEFAULT_BINARY = os.path.join(".pio", "build", "fleet_sim", "program")
+SERVER_SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "parking_server.py")
+
+
+def start_server(port, extra_args):
+    """Iniciar parking_server.py en modo silencioso con confirmación de eventos"""
+    command = [sys.executable, SERVER_SCRIPT, "--port", str(port),
+               "--quiet", "--ack-events"] + extra_args
+    # Grupo propio: si hay que matarlo, los workers de --workers caen con él
+    server = subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                              start_new_session=True)
+    # Hasta que acepte conexiones (con --workers cada proceso tarda en arrancar)
+    deadline = time.time() + 10.0
+    while time.time() < deadline and server.poll() is None:
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=0.5).close()
+            break
+        except OSError:
+            time.sleep(0.1)
+    return server
+
+
+def stop_server(server):
+    """SIGTERM y, si no termina, SIGKILL a todo el grupo
+
+    Con --workers el coordinador espera hasta WORKER_TIMEOUT a cada worker
+    antes de matarlo; cortarlo antes dejaba workers huérfanos en el puerto.
+    """
+    server.terminate()
+    try:
+        server.wait(timeout=WORKER_TIMEOUT + 5)
+    except subprocess.TimeoutExpired:
+        pass
+    try:
+        os.killpg(server.pid, signal.SIGKILL)   # Workers que hayan quedado
+    except OSError:
+        pass
+    server.wait()
+
+
+def query_status(port):
+    """COMMAND:STATUS del servidor (contadores del pipeline de imágenes)"""
+    try:
+        with socket.create_connection(("127.0.0.1", port), timeout=2.0) as admin:
+            admin.sendall(b"COMMAND:STATUS\n")
+            return json.loads(admin.recv(65536).decode("utf-8"))
+    except (OSError, ValueError):
+        return None
+
+
+def print_sweep(rows):
+    """Tabla de la prueba de escala por cantidad de workers"""
+    base = rows[0]["acked_per_second"] or 1.0
+    print("\n📈 ESCALA POR WORKERS (parking_server.py --workers)")
+    print("=" * 72)
+    print(f"   {'Workers':>7}{'Enviados/s':>12}{'Confirmados/s':>15}{'Escala':>8}"
+          f"{'p50 ms':>9}{'p99 ms':>9}{'Traspasos':>11}")
+    for row in rows:
+        print(f"   {row['workers']:>7}{row['events_per_second']:>12.1f}{row['acked_per_second']:>15.1f}"
+              f"{row['acked_per_second'] / base:>8.2f}{row['p50_ms']:>9.2f}{row['p99_ms']:>9.2f}"
+              f"{row['handed_off']:>11}")
+    print("=" * 72)
+
+
+def print_summary(report):
+    """Resumen legible del informe del simulador"""
+    latency = report["ingest_latency_us"]
+    print("\n📊 RESULTADOS DEL SIMULADOR DE FLOTA")
+    print("=" * 45)
+    print(f"   Sensores: {report['devices']} (reloj x{report['speed']})")
+    if report.get("mode") == "gateway":
+        gateway = report["gateway"]
+        print(f"   Modo gateway: {gateway['gateways']} gateways, {gateway['leaves']} hojas")
+    if report.get("transport") == "udp" or report.get("loss"):
+        print(f"   Transporte: {report['transport'].upper()}, pérdida simulada {report['loss'] * 100:.1f}%")
+    print(f"   Asociaciones al AP: {report['ap_associations']}, "
+          f"conexiones con el servidor: {report['server_connections']}")
+    print(f"   Mensajes al servidor: {report['upstream_messages']} "
+          f"({report['upstream_messages_per_second']:.1f}/s)")
+    print(f"   Duración: {report['duration_s']:.0f} s")
+    print(f"   Eventos enviados: {report['events_sent']} ({report['events_per_second']:.1f}/s)")
+    print(f"   Eventos confirmados: {report['events_acked']}")
+    print(f"   Intentos de conexión: {report['connect_attempts']}")
+    print(f"   Latencia de ingesta (ms): p50={latency['p50'] / 1000:.2f} "
+          f"p90={latency['p90'] / 1000:.2f} p99={latency['p99'] / 1000:.2f} "
+          f"max={latency['max'] / 1000:.2f} (n={latency['count']})")
+    if report.get("images_sent"):
+        upload = report["image_upload_ms"]
+        print(f"   Imágenes: {report['images_sent']} enviadas, {report['images_acked']} confirmadas "
+              f"({report['images_per_second']:.1f}/s), {report['images_rejected']} rechazadas")
+        print(f"   Subida de imagen (ms): p50={upload['p50']:.0f} p90={upload['p90']:.0f} "
+              f"p99={upload['p99']:.0f} max={upload['max']:.0f}")
+    server_images = report.get("server_images")
+    if server_images and server_images.get("received"):
+        print(f"   Servidor: {server_images['saved']} imágenes guardadas, "
+              f"{server_images['duplicates']} duplicadas, {server_images['invalid']} inválidas, "
+              f"{server_images['busy']} rechazadas por cola llena, "
+              f"{server_images['batches']} lotes de fsync, "
+              f"{server_images['avg_latency_ms']:.0f} ms en el pipeline")
+    liveness = report.get("server_liveness")
+    if report.get("heartbeats_sent") or (liveness and liveness.get("heartbeats")):
+        print(f"   Heartbeats: {report.get('heartbeats_sent', 0)} enviados, "
+              f"{liveness['heartbeats'] if liveness else 0} recibidos, "
+              f"{liveness['lost_frames'] if liveness else 0} tramas perdidas detectadas")
+    radio = report.get("radio_on_ms")
+    if radio:
+        print(f"   Radio ocupada por sensor (ms): media={radio['mean']:.0f} p99={radio['p99']:.0f} "
+              f"({radio['fraction'] * 100:.2f}% del tiempo), conexión abierta "
+              f"{report['connection_open_fraction'] * 100:.1f}% del tiempo")
+    udp = report.get("udp")
+    if udp:
+        print(f"   UDP: {udp['frames']} tramas, {udp['datagrams']} datagramas, "
+              f"{udp['retransmits']} retransmisiones, {udp['acked']} confirmadas, "
+              f"{udp['lost']} perdidas, {udp['evicted']} descartadas por ventana llena")
+    if report.get("mode") == "gateway":
+        gateway = report["gateway"]
+        print(f"   Lotes: {gateway['batches_acked']} confirmados, {gateway['batches_resent']} reenviados, "
+              f"{gateway['frames_per_batch']:.1f} tramas/lote, {gateway['duplicates']} duplicadas, "
+              f"{gateway['dropped']} descartadas")
+    for storm in report["reconnect_storms"]:
+        recovery = f"{storm['recovery_s']:.0f} s" if storm["recovery_s"] >= 0 else "sin recuperar"
+        print(f"   🌩️ Tormenta en t={storm['at_s']:.0f}s: mínimo {storm['min_connected']} conectados, "
+              f"recuperación {recovery}, pico {storm['peak_attempts_per_s']} intentos/s, "
+              f"{storm['attempts']} intentos en total")
+    print("=" * 45)
+
+
+def run_once(args, workers):
+    """Servidor y simulador una vez; retorna el informe del simulador o None"""
+    server_args = args.server_arg + (["--workers", str(workers)] if workers else [])
+    server = start_server(args.port, server_args)
+    sim = subprocess.Popen([args.binary, "--devices", str(args.devices), "--port", str(args.port),
+                            "--duration", str(args.duration), "--speed", str(args.speed)] + args.sim_args,
+                           stdout=subprocess.PIPE, text=True)
+
+    # Reiniciar el servidor en otro hilo mientras el simulador corre
+    state = {"server": server}
+
+    def restart():
+        time.sleep(args.restart_at)
+        print(f"🛑 Deteniendo servidor (t={args.restart_at:.0f}s)")
+        stop_server(state["server"])
+        time.sleep(args.downtime)
+        print("🚀 Reiniciando servidor")
+        state["server"] = start_server(args.port, server_args)
+
+    if args.restart_at is not None:
+        threading.Thread(target=restart, daemon=True).start()
+
+    try:
+        output, _ = sim.communicate()
+        status = query_status(args.port)
+    finally:
+        # En su propio grupo el servidor no recibe el Ctrl+C de la terminal
+        stop_server(state["server"])
+
+    if sim.returncode != 0:
+        print("❌ El simulador terminó con error")
+        return None
+
+    report = json.loads(output)
+    if status is not None and status.get("shard"):
+        # Con workers el STATUS es el de uno solo: sus contadores no son del total
+        report["handed_off"] = status["shard"]["handed_off"]
+        status = None
+    if status is not None and "images" in status:
+        report["server_images"] = status["images"]
+    if status is not None and "liveness" in status:
+        report["server_liveness"] = status["liveness"]
+    if status is not None and status.get("udp"):
+        report["server_udp"] = status["udp"]
+    return report
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Prueba de escala con el simulador de flota")
+    parser.add_argument("--binary", default=DEFAULT_BINARY, help="Ejecutable del env fleet_sim")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--devices", type=int, default=500)
+    parser.add_argument("--duration", type=float, default=60.0)
+    parser.add_argument("--speed", type=float, default=1.0)
+    parser.add_argument("--restart-at", type=float, default=None,
+                        help="Segundo en que se detiene el servidor (tormenta de reconexión)")
+    parser.add_argument("--downtime", type=float, default=5.0, help="Segundos con el servidor caído")
+    parser.add_argument("--output", default="fleet_report.json", help="Archivo del informe JSON")
+    parser.add_argument("--server-arg", action="append", default=[],
+                        help="Argumento adicional para parking_server.py (repetible)")
+    parser.add_argument("--workers", type=int, default=0,
+                        help="Procesos de ingesta del servidor (ver sharded_ingest.py)")
+    parser.add_argument("--sweep", default=None,
+                        help="Repetir la prueba con estas cantidades de workers, p. ej. 1,2,4,8")
+    parser.add_argument("sim_args", nargs="*", help="Opciones extra del simulador (tras --)")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.binary):
+        print(f"❌ No existe {args.binary}; compila con: pio run -e fleet_sim")
+        return 1
+
+    if args.sweep:
+        rows = []
+        for workers in [int(n) for n in args.sweep.split(",")]:
+            print(f"🚀 {workers} worker(s)")
+            report = run_once(args, workers)
+            if report is None:
+                return 1
+            latency = report["ingest_latency_us"]
+            rows.append({"workers": workers, "events_per_second": report["events_per_second"],
+                         "acked_per_second": report["events_acked"] / report["duration_s"],
+                         "p50_ms": latency["p50"] / 1000, "p99_ms": latency["p99"] / 1000,
+                         "handed_off": report.get("handed_off", 0), "report": report})
+            time.sleep(1.0)   # Que el puerto quede libre
+        with open(args.output, "w", encoding="utf-8") as f:
+            json.dump({"sweep": rows}, f, indent=2)
+        print_sweep(rows)
+        print(f"📁 Informe guardado en {args.output}")
+        return 0
+
+    report = run_once(args, args.workers)
+    if report is None:
+        return 1
+    with open(args.output, "w", encoding="utf-8") as f:
+        json.dump(report, f, indent=2)
+
+    print_summary(report)
+    print(f"📁 Informe guardado en {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
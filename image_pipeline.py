@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+"""
+Pipeline de ingesta de imágenes del servidor de parqueo
+
+    recepción (hilo de la conexión)
+      → cola acotada
+      → trabajadores: base64, validación JPEG, hash (dedup), miniatura,
+        escritura en archivo temporal
+      → escritor: fsync por lotes, renombrado, índice y respuesta al cliente
+
+El hilo de la conexión solo encola la carga en base64 y sigue leyendo; si la
+cola está llena responde "busy" en vez de bloquear. La respuesta llega al
+dispositivo cuando la imagen ya está en disco.
+
+Los nombres son parking_<parkingId>_<evento>.jpg, con sufijo _N si el mismo
+evento trae más de una imagen. Las imágenes repetidas (mismo SHA-256) no se
+vuelven a guardar: se responde con el archivo existente. Si la original
+todavía está en curso, la repetida espera su resultado: éxito cuando la
+original llega a disco, el mismo error si falla. El índice
+index.jsonl guarda hash, nombre y evento de cada imagen y se recarga al
+iniciar para mantener la deduplicación entre reinicios.
+
+Las miniaturas requieren Pillow (opcional); sin Pillow se omiten.
+"""
+
+import base64
+import binascii
+import hashlib
+import io
+import json
+import os
+import queue
+import re
+import threading
+import time
+
+try:
+    from PIL import Image
+except ImportError:
+    Image = None
+
+INDEX_FILE = "index.jsonl"
+THUMBS_DIR = "thumbs"
+
+
+class ImageJob:
+    """Imagen en tránsito por el pipeline"""
+
+    __slots__ = ("payload", "parking_id", "event_id", "reply", "received",
+                 "data", "digest", "filename", "thumbnail", "temp_paths")
+
+    def __init__(self, payload, parking_id, event_id, reply):
+        self.payload = payload
+        self.parking_id = parking_id
+        self.event_id = event_id
+        self.reply = reply
+        self.received = time.monotonic()
+        self.data = None
+        self.digest = None
+        self.filename = None
+        self.thumbnail = None
+        self.temp_paths = []
+
+
+class ImagePipeline:
+    def __init__(self, images_dir, workers=4, queue_size=64, batch_size=32,
+                 thumb_size=(160, 120), max_bytes=512 * 1024, fsync=True, quiet=False):
+        self.images_dir = images_dir
+        self.thumbs_dir = os.path.join(images_dir, THUMBS_DIR)
+        self.index_path = os.path.join(images_dir, INDEX_FILE)
+        self.worker_count = max(1, workers)
+        self.jobs = queue.Queue(maxsize=queue_size)
+        self.commits = queue.Queue()
+        self.batch_size = batch_size
+        self.thumb_size = thumb_size
+        self.max_bytes = max_bytes
+        self.fsync = fsync
+        self.quiet = quiet
+        self.threads = []
+        self.running = False
+
+        # Hash → archivo (guardado o en curso), nombres ya reservados y
+        # repetidas que esperan a una original en curso (hash → trabajos)
+        self.lock = threading.Lock()
+        self.by_hash = {}
+        self.names = set()
+        self.waiting = {}
+
+        self.stats_lock = threading.Lock()
+        self.counters = {"received": 0, "saved": 0, "duplicates": 0, "invalid": 0, "busy": 0,
+                         "errors": 0, "thumbnails": 0, "batches": 0, "bytes": 0}
+        self.latency_total = 0.0
+
+        os.makedirs(self.thumbs_dir, exist_ok=True)
+        self.load_index()
+
+    def load_index(self):
+        """Recuperar hashes y nombres de las imágenes guardadas antes"""
+        if not os.path.exists(self.index_path):
+            return
+        with open(self.index_path, "r", encoding="utf-8") as f:
+            for line in f:
+                try:
+                    entry = json.loads(line)
+                except json.JSONDecodeError:
+                    continue  # Línea incompleta de un corte de energía
+                self.by_hash[entry["sha256"]] = entry["file"]
+                self.names.add(entry["file"])
+
+    def start(self):
+        self.running = True
+        for i in range(self.worker_count):
+            self.threads.append(threading.Thread(target=self.worker_loop, name=f"imagen-{i}", daemon=True))
+        self.threads.append(threading.Thread(target=self.writer_loop, name="imagen-disco", daemon=True))
+        for thread in self.threads:
+            thread.start()
+        if Image is None and not self.quiet:
+            print("⚠️ Pillow no está instalado: no se generarán miniaturas")
+
+    def stop(self, timeout=5.0):
+        """Procesar lo encolado y detener los hilos"""
+        if not self.running:
+            return
+        self.running = False
+        for _ in range(self.worker_count):
+            self.jobs.put(None)
+        deadline = time.monotonic() + timeout
+        for thread in self.threads[:-1]:
+            thread.join(max(0.0, deadline - time.monotonic()))
+        self.commits.put(None)
+        self.threads[-1].join(max(0.0, deadline - time.monotonic()))
+        self.threads = []
+
+    def submit(self, payload, parking_id, event_id, reply):
+        """Encolar una imagen en base64; reply(respuesta) se llama desde otro hilo
+
+        Nunca bloquea: con la cola llena responde "busy" y el hilo de la
+        conexión sigue leyendo.
+        """
+        self.count("received")
+        try:
+            self.jobs.put_nowait(ImageJob(payload, parking_id, event_id, reply))
+            return True
+        except queue.Full:
+            self.count("busy")
+            self.send_reply(reply, {"status": "error", "error": "busy",
+                                    "message": "Servidor ocupado, reintentar"})
+            return False
+
+    def stats(self):
+        with self.stats_lock:
+            result = dict(self.counters)
+            done = result["saved"] + result["duplicates"]
+            result["avg_latency_ms"] = round(self.latency_total / done * 1000.0, 2) if done else 0.0
+        result["queued"] = self.jobs.qsize()
+        return result
+
+    def count(self, name, amount=1):
+        with self.stats_lock:
+            self.counters[name] += amount
+
+    def send_reply(self, reply, response):
+        try:
+            reply(response)
+        except OSError:
+            pass  # El cliente se desconectó antes de la respuesta
+
+    # ---- Trabajadores ----
+
+    def worker_loop(self):
+        while True:
+            job = self.jobs.get()
+            if job is None:
+                return
+            try:
+                self.process(job)
+            except Exception as e:
+                self.count("errors")
+                self.fail(job, {"status": "error", "message": str(e)})
+
+    def process(self, job):
+        try:
+            job.data = base64.b64decode(job.payload, validate=True)
+        except (binascii.Error, ValueError) as e:
+            self.reject(job, f"base64 inválido: {e}")
+            return
+        job.payload = None
+
+        problem = self.validate(job.data)
+        if problem:
+            self.reject(job, problem)
+            return
+
+        job.digest = hashlib.sha256(job.data).hexdigest()
+        with self.lock:
+            existing = self.by_hash.get(job.digest)
+            if existing is None:
+                job.filename = self.reserve_name(job.parking_id, job.event_id)
+                self.by_hash[job.digest] = job.filename
+                self.waiting[job.digest] = []
+            elif job.digest in self.waiting:
+                # La original no está en disco todavía: responde el escritor
+                self.waiting[job.digest].append(job)
+                return
+        if existing is not None:
+            self.count("duplicates")
+            self.finish(job, {"status": "success", "message": "Imagen duplicada",
+                              "filename": existing, "duplicate": True})
+            return
+
+        job.thumbnail = self.make_thumbnail(job.data)
+
+        # Escritura sin fsync: el escritor sincroniza el lote completo
+        image_temp = os.path.join(self.images_dir, job.filename + ".tmp")
+        self.write_file(image_temp, job.data)
+        job.temp_paths.append(image_temp)
+        if job.thumbnail is not None:
+            thumb_temp = os.path.join(self.thumbs_dir, job.filename + ".tmp")
+            self.write_file(thumb_temp, job.thumbnail)
+            job.temp_paths.append(thumb_temp)
+        self.commits.put(job)
+
+    def validate(self, data):
+        """Comprobación barata de un JPEG completo; retorna el problema o None"""
+        if len(data) < 4:
+            return "imagen vacía"
+        if len(data) > self.max_bytes:
+            return f"imagen de {len(data)} bytes (máximo {self.max_bytes})"
+        if data[:2] != b"\xff\xd8":
+            return "no es un JPEG (falta SOI)"
+        # Algunos codificadores rellenan después del EOI
+        if data.rfind(b"\xff\xd9", max(0, len(data) - 64)) < 0:
+            return "JPEG truncado (falta EOI)"
+        return None
+
+    def reserve_name(self, parking_id, event_id):
+        """parking_<id>_<evento>.jpg, con sufijo si ya existe (llamar con self.lock)"""
+        base = f"parking_{safe_component(parking_id)}_{safe_component(event_id)}"
+        name = base + ".jpg"
+        suffix = 1
+        while name in self.names or os.path.exists(os.path.join(self.images_dir, name)):
+            name = f"{base}_{suffix}.jpg"
+            suffix += 1
+        self.names.add(name)
+        return name
+
+    def release(self, job):
+        """Liberar el nombre y el hash de una imagen que no se guardó
+
+        Retorna las repetidas que esperaban su resultado.
+        """
+        for path in job.temp_paths:
+            try:
+                os.remove(path)
+            except OSError:
+                pass
+        if job.filename is None:
+            return []
+        with self.lock:
+            self.names.discard(job.filename)
+            if self.by_hash.get(job.digest) == job.filename:
+                del self.by_hash[job.digest]
+            return self.waiting.pop(job.digest, [])
+
+    def fail(self, job, response):
+        """Imagen que no se guardó: la misma respuesta a ella y a sus repetidas"""
+        for waiter in [job] + self.release(job):
+            self.send_reply(waiter.reply, response)
+
+    def make_thumbnail(self, data):
+        if Image is None or not self.thumb_size:
+            return None
+        try:
+            with Image.open(io.BytesIO(data)) as image:
+                # draft() decodifica el JPEG directamente a 1/2, 1/4 u 1/8 de escala
+                image.draft("RGB", self.thumb_size)
+                image.thumbnail(self.thumb_size)
+                out = io.BytesIO()
+                image.convert("RGB").save(out, "JPEG", quality=70)
+                return out.getvalue()
+        except Exception:
+            return None  # La imagen se guarda igual aunque Pillow no la decodifique
+
+    def write_file(self, path, data):
+        with open(path, "wb") as f:
+            f.write(data)
+
+    def reject(self, job, message):
+        self.count("invalid")
+        self.send_reply(job.reply, {"status": "error", "message": message})
+
+    def finish(self, job, response):
+        with self.stats_lock:
+            self.latency_total += time.monotonic() - job.received
+        self.send_reply(job.reply, response)
+
+    # ---- Escritor: fsync por lotes ----
+
+    def writer_loop(self):
+        # Sin esperas artificiales: el lote es lo que llegó mientras se
+        # sincronizaba el anterior (con poca carga, lotes de una imagen)
+        while True:
+            job = self.commits.get()
+            if job is None:
+                return
+            batch = [job]
+            stopping = False
+            while len(batch) < self.batch_size:
+                try:
+                    job = self.commits.get_nowait()
+                except queue.Empty:
+                    break
+                if job is None:
+                    stopping = True
+                    break
+                batch.append(job)
+            self.commit(batch)
+            if stopping:
+                return
+
+    def commit(self, batch):
+        """Sincronizar, renombrar e indexar un lote; una sola sincronización de directorio"""
+        committed = []
+        for job in batch:
+            try:
+                if self.fsync:
+                    for path in job.temp_paths:
+                        fsync_path(path)
+                for path in job.temp_paths:
+                    os.replace(path, path[:-len(".tmp")])
+                job.temp_paths = []
+                committed.append(job)
+            except OSError as e:
+                self.count("errors")
+                self.fail(job, {"status": "error", "message": f"error de disco: {e}"})
+
+        if not committed:
+            return
+
+        with open(self.index_path, "a", encoding="utf-8") as f:
+            for job in committed:
+                f.write(json.dumps({"file": job.filename, "sha256": job.digest,
+                                    "parkingId": job.parking_id, "event": job.event_id,
+                                    "bytes": len(job.data), "thumbnail": job.thumbnail is not None}) + "\n")
+            if self.fsync:
+                f.flush()
+                os.fsync(f.fileno())
+        if self.fsync:
+            fsync_path(self.images_dir)
+            if any(job.thumbnail is not None for job in committed):
+                fsync_path(self.thumbs_dir)
+
+        with self.stats_lock:
+            self.counters["batches"] += 1
+        with self.lock:
+            waiters = [(job, self.waiting.pop(job.digest, [])) for job in committed]
+        for job, duplicates in waiters:
+            self.count("saved")
+            self.count("bytes", len(job.data))
+            if job.thumbnail is not None:
+                self.count("thumbnails")
+            if not self.quiet:
+                print(f"📸 Imagen guardada: {job.filename} ({len(job.data)} bytes)")
+            self.finish(job, {"status": "success", "message": "Imagen recibida correctamente",
+                              "filename": job.filename})
+            for duplicate in duplicates:
+                self.count("duplicates")
+                self.finish(duplicate, {"status": "success", "message": "Imagen duplicada",
+                                        "filename": job.filename, "duplicate": True})
+
+
+def safe_component(value):
+    """Parte de un nombre de archivo sin separadores ni caracteres raros"""
+    return re.sub(r"[^A-Za-z0-9-]", "-", str(value)) or "x"
+
+
+def fsync_path(path):
+    fd = os.open(path, os.O_RDONLY)
+    try:
+        os.fsync(fd)
+    finally:
+        os.close(fd)
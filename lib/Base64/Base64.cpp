@@ -0,0 +1,50 @@
+#include "Base64.h"
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64EncodeBlock(const uint8_t* data, size_t length, char* out) {
+    char* p = out;
+    size_t i = 0;
+    
+    // Grupos completos de 3 bytes → 4 caracteres
+    for (; i + 3 <= length; i += 3) {
+        uint32_t chunk = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        *p++ = base64_chars[(chunk >> 18) & 0x3F];
+        *p++ = base64_chars[(chunk >> 12) & 0x3F];
+        *p++ = base64_chars[(chunk >> 6) & 0x3F];
+        *p++ = base64_chars[chunk & 0x3F];
+    }
+    
+    // Último grupo incompleto: los bytes van alineados a la izquierda y se rellena con '='
+    size_t remaining = length - i;
+    if (remaining > 0) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (remaining == 2) {
+            chunk |= (uint32_t)data[i + 1] << 8;
+        }
+        *p++ = base64_chars[(chunk >> 18) & 0x3F];
+        *p++ = base64_chars[(chunk >> 12) & 0x3F];
+        *p++ = remaining == 2 ? base64_chars[(chunk >> 6) & 0x3F] : '=';
+        *p++ = '=';
+    }
+    
+    return (size_t)(p - out);
+}
+
+// Función para codificar en base64
+String base64Encode(const uint8_t* data, size_t length) {
+    String result = "";
+    result.reserve(base64Length(length));
+    
+    // Codificar por bloques en la pila para no duplicar la imagen en memoria
+    char block[257];
+    const size_t blockInput = 192; // Múltiplo de 3 → 256 caracteres
+    for (size_t i = 0; i < length; i += blockInput) {
+        size_t n = length - i < blockInput ? length - i : blockInput;
+        size_t written = base64EncodeBlock(data + i, n, block);
+        block[written] = '\0';
+        result += block;
+    }
+    
+    return result;
+}
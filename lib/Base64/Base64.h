@@ -0,0 +1,18 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include "Hal.h"
+
+// Codificación base64 estándar (RFC 4648, con relleno '=') para enviar
+// imágenes JPEG por el canal de texto TCP.
+String base64Encode(const uint8_t* data, size_t length);
+
+// Caracteres necesarios para codificar length bytes (sin terminador)
+inline size_t base64Length(size_t length) { return (length + 2) / 3 * 4; }
+
+// Codifica en un buffer del llamador (base64Length(length) bytes) y retorna
+// los caracteres escritos. Sin asignaciones: permite enviar por bloques.
+// Para encadenar bloques, length debe ser múltiplo de 3 salvo en el último.
+size_t base64EncodeBlock(const uint8_t* data, size_t length, char* out);
+
+#endif // BASE64_H
@@ -1,32 +1,65 @@
 #include "CameraManager.h"
-#include "board_config.h"
+#include "HalBoard.h"
+
+#include <stdlib.h>
 
 CameraManager::CameraManager() {
     cameraInitialized = false;
     cameraDetected = false;
+    sensor = NULL;
+    autoTune = false;
+    lastFrameBytes = 0;
+    registerAccess = false;
+    activeProfile = -1;
+    memset(&switchStats, 0, sizeof(switchStats));
+    switchStartUs = 0;
+    switchPending = false;
+    roi = {0, 0, 1000, 1000};
+    roiEnabled = false;
+    roiBuffer = NULL;
+    roiCapacity = 0;
+    thumbBuffer = NULL;
+    thumbCapacity = 0;
+    frameWaiters = 0;
+    memset(&lockStats, 0, sizeof(lockStats));
+    memset(&roiFrame, 0, sizeof(roiFrame));
+    memset(&roiStats, 0, sizeof(roiStats));
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        compileProfile(cameraProfile((CameraProfileId)i), profiles[i]);
+    }
     setupCameraConfig();
+    manualFramesize = config.frame_size;
+    
+    // El ajuste automático parte de la configuración fija
+    lastSettings.framesize = config.frame_size;
+    lastSettings.quality = config.jpeg_quality;
+    tuner.setInitialSettings(lastSettings);
+    tuner.setBestQuality(config.jpeg_quality);
+    tuner.setFramesizeRange(config.frame_size, config.frame_size);
 }
 
 void CameraManager::setupCameraConfig() {
     // Configuración para ESP32-S3-CAM con TY-OV2640
     config.ledc_channel = LEDC_CHANNEL_0;
     config.ledc_timer = LEDC_TIMER_0;
-    config.pin_d0 = Y2_GPIO_NUM;
-    config.pin_d1 = Y3_GPIO_NUM;
-    config.pin_d2 = Y4_GPIO_NUM;
-    config.pin_d3 = Y5_GPIO_NUM;
-    config.pin_d4 = Y6_GPIO_NUM;
-    config.pin_d5 = Y7_GPIO_NUM;
-    config.pin_d6 = Y8_GPIO_NUM;
-    config.pin_d7 = Y9_GPIO_NUM;
-    config.pin_xclk = XCLK_GPIO_NUM;
-    config.pin_pclk = PCLK_GPIO_NUM;
-    config.pin_vsync = VSYNC_GPIO_NUM;
-    config.pin_href = HREF_GPIO_NUM;
-    config.pin_sccb_sda = SIOD_GPIO_NUM;
-    config.pin_sccb_scl = SIOC_GPIO_NUM;
-    config.pin_pwdn = PWDN_GPIO_NUM;
-    config.pin_reset = RESET_GPIO_NUM;
+    // Pines del perfil de la placa (HalBoard.h)
+    const hal::CameraPins& pins = hal::BOARD.camera;
+    config.pin_d0 = pins.data[0];
+    config.pin_d1 = pins.data[1];
+    config.pin_d2 = pins.data[2];
+    config.pin_d3 = pins.data[3];
+    config.pin_d4 = pins.data[4];
+    config.pin_d5 = pins.data[5];
+    config.pin_d6 = pins.data[6];
+    config.pin_d7 = pins.data[7];
+    config.pin_xclk = pins.xclk;
+    config.pin_pclk = pins.pclk;
+    config.pin_vsync = pins.vsync;
+    config.pin_href = pins.href;
+    config.pin_sccb_sda = pins.sccbSda;
+    config.pin_sccb_scl = pins.sccbScl;
+    config.pin_pwdn = pins.pwdn;
+    config.pin_reset = pins.reset;
     config.xclk_freq_hz = 20000000;
     config.pixel_format = PIXFORMAT_JPEG;
     
@@ -55,10 +88,10 @@ bool CameraManager::begin() {
                   (config.fb_location == CAMERA_FB_IN_PSRAM) ? "PSRAM" : "DRAM");
     
     // Verificar memoria disponible
-    Serial.printf("  Memoria libre: %d bytes\n", esp_get_free_heap_size());
+    Serial.printf("  Memoria libre: %d bytes\n", hal::freeHeap());
     
     // Esperar un poco para que la cámara se estabilice
-    delay(3000);
+    hal::delayMs(3000);
     
     // Intentar inicializar la cámara
     esp_err_t err = esp_camera_init(&config);
@@ -107,6 +140,21 @@ bool CameraManager::begin() {
     s->set_dcw(s, 1);            // 0 = disable , 1 = enable
     s->set_colorbar(s, 0);       // 0 = disable , 1 = enable
     
+    // Los registros que tocan los perfiles quedan como los dejó la inicialización
+    sensor = s;
+    registerAccess = (s->id.PID == OV2640_PID);
+    shadow.invalidate();
+    if (registerAccess) {
+        SensorWrite zoom[3];
+        uint8_t count = zoomWrites((framesize_t)s->status.framesize, zoom);
+        for (uint8_t i = 0; i < count; i++) {
+            shadow.assume(zoom[i]);
+        }
+        shadow.assume(qualityWrite(s->status.quality));
+        shadow.assume(gainCeilingWrite(0));
+    }
+    activeProfile = -1;
+    
     cameraInitialized = true;
     cameraDetected = true;
     
@@ -115,7 +163,7 @@ bool CameraManager::begin() {
     Serial.printf("Resolución: %d\n", s->status.framesize);
     
     // Esperar un poco más para que el sensor se estabilice
-    delay(500);
+    hal::delayMs(500);
     
     return true;
 }
@@ -123,6 +171,13 @@ bool CameraManager::begin() {
 void CameraManager::end() {
     if (cameraInitialized) {
         esp_camera_deinit();
+        sensor = NULL;
+        free(roiBuffer);
+        roiBuffer = NULL;
+        roiCapacity = 0;
+        free(thumbBuffer);
+        thumbBuffer = NULL;
+        thumbCapacity = 0;
         cameraInitialized = false;
         cameraDetected = false;
         Serial.println("Cámara desactivada");
@@ -146,8 +201,13 @@ bool CameraManager::testCamera() {
     Serial.println("Probando captura de imagen...");
     
     // Intentar capturar una imagen
+    if (!lockFrame()) {
+        Serial.println("Error: Cuadro ocupado por otra captura");
+        return false;
+    }
     camera_fb_t *fb = esp_camera_fb_get();
     if (!fb) {
+        frameLock.unlock();
         Serial.println("Error: No se pudo capturar imagen");
         Serial.println("Posibles causas:");
         Serial.println("  - Sensor no responde");
@@ -157,12 +217,13 @@ bool CameraManager::testCamera() {
     }
     
     Serial.printf("Imagen capturada: %dx%d, %d bytes\n", 
-                  fb->width, fb->height, fb->len);
+                  (int)fb->width, (int)fb->height, (int)fb->len);
     Serial.printf("Formato: %d\n", fb->format);
-    Serial.printf("Timestamp: %llu\n", fb->timestamp.tv_sec);
+    Serial.printf("Timestamp: %llu\n", (unsigned long long)fb->timestamp.tv_sec);
     
     // Liberar el buffer
     esp_camera_fb_return(fb);
+    frameLock.unlock();
     
     Serial.println("Test de cámara exitoso");
     return true;
@@ -203,22 +264,437 @@ bool CameraManager::captureTest() {
     return testCamera();
 }
 
+camera_fb_t* CameraManager::capture() {
+    return capture(-1);
+}
+
+camera_fb_t* CameraManager::capture(int maxFramesize) {
+    if (!cameraInitialized || !lockFrame()) return NULL;
+    sensor_t *s = sensor;
+    
+    JpegSettings next;
+    next.framesize = manualFramesize;
+    next.quality = s->status.quality;
+    if (autoTune) {
+        tuner.reportRssi(hal::wifiRssi());
+        next = tuner.nextSettings();
+    }
+    if (maxFramesize >= 0 && next.framesize > (framesize_t)maxFramesize) {
+        next.framesize = (framesize_t)maxFramesize;
+    }
+    
+    bool changed = applyFramesize(next.framesize);
+    changed = applyQuality(next.quality) || changed;
+    if (changed) {
+        markSwitch(hal::micros());
+    }
+    
+    camera_fb_t *fb = grabFrame();
+    if (fb == NULL) {
+        frameLock.unlock();
+        return NULL;
+    }
+    
+    lastSettings.framesize = (framesize_t)s->status.framesize;
+    lastSettings.quality = s->status.quality;
+    if (roiEnabled) {
+        fb = cropToRoi(fb);
+    }
+    
+    // Con recorte el tamaño observado es el de la región: el ajuste
+    // automático presupuesta lo que de verdad se envía
+    lastFrameBytes = fb->len;
+    tuner.reportFrame(lastSettings, fb->len);
+    return fb;
+}
+
+camera_fb_t* CameraManager::grabFrame() {
+    // Con un solo buffer, el cuadro pendiente se tomó con los ajustes anteriores
+    if (switchPending) {
+        camera_fb_t *stale = esp_camera_fb_get();
+        if (stale) {
+            esp_camera_fb_return(stale);
+            switchStats.staleFrames++;
+        }
+    }
+    
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb != NULL && switchPending) {
+        switchStats.lastSwitchUs = hal::micros() - switchStartUs;
+        switchPending = false;
+    }
+    return fb;
+}
+
+bool CameraManager::captureGrayscale(uint8_t* out, uint16_t width, uint16_t height) {
+    if (!cameraInitialized || width == 0 || height == 0 || !lockFrame()) return false;
+    
+    camera_fb_t *fb = grabFrame();
+    if (fb == NULL) {
+        frameLock.unlock();
+        return false;
+    }
+    size_t needed = ((fb->width + 7) / 8) * ((fb->height + 7) / 8);
+    if (needed > thumbCapacity) {
+        uint8_t* grown = (uint8_t*)realloc(thumbBuffer, needed);
+        if (grown == NULL) {
+            esp_camera_fb_return(fb);
+            frameLock.unlock();
+            return false;
+        }
+        thumbBuffer = grown;
+        thumbCapacity = needed;
+    }
+    uint16_t thumbWidth = 0;
+    uint16_t thumbHeight = 0;
+    size_t pixels = cropper.lumaThumbnail(fb->buf, fb->len, thumbBuffer, thumbCapacity,
+                                          &thumbWidth, &thumbHeight);
+    esp_camera_fb_return(fb);
+    frameLock.unlock();
+    if (pixels == 0) return false;
+    
+    // Solo la región de interés, si hay, reducida por promedio de áreas
+    int rx = 0;
+    int ry = 0;
+    int rw = thumbWidth;
+    int rh = thumbHeight;
+    if (roiEnabled) {
+        rx = thumbWidth * roi.x / 1000;
+        ry = thumbHeight * roi.y / 1000;
+        rw = (thumbWidth * roi.width + 999) / 1000;
+        rh = (thumbHeight * roi.height + 999) / 1000;
+        rw = rx + rw > thumbWidth ? thumbWidth - rx : rw;
+        rh = ry + rh > thumbHeight ? thumbHeight - ry : rh;
+    }
+    for (int oy = 0; oy < height; oy++) {
+        int y0 = ry + oy * rh / height;
+        int y1 = ry + (oy + 1) * rh / height;
+        y1 = y1 > y0 ? y1 : y0 + 1;
+        for (int ox = 0; ox < width; ox++) {
+            int x0 = rx + ox * rw / width;
+            int x1 = rx + (ox + 1) * rw / width;
+            x1 = x1 > x0 ? x1 : x0 + 1;
+            uint32_t sum = 0;
+            for (int y = y0; y < y1; y++) {
+                const uint8_t* row = thumbBuffer + y * thumbWidth;
+                for (int x = x0; x < x1; x++) {
+                    sum += row[x];
+                }
+            }
+            uint32_t count = (uint32_t)((y1 - y0) * (x1 - x0));
+            out[oy * width + ox] = (uint8_t)((sum + count / 2) / count);
+        }
+    }
+    return true;
+}
+
+camera_fb_t* CameraManager::cropToRoi(camera_fb_t* fb) {
+    unsigned long start = hal::micros();
+    roiStats.lastFullBytes = fb->len;
+    roiStats.lastBytes = fb->len;
+    
+    size_t needed = JpegCropper::outputCapacity(fb->len);
+    if (needed > roiCapacity) {
+        uint8_t* grown = (uint8_t*)realloc(roiBuffer, needed);
+        if (grown == NULL) {
+            roiStats.failed++;
+            return fb;
+        }
+        roiBuffer = grown;
+        roiCapacity = needed;
+    }
+    
+    JpegRect rect;
+    rect.x = (uint16_t)(fb->width * roi.x / 1000);
+    rect.y = (uint16_t)(fb->height * roi.y / 1000);
+    rect.width = (uint16_t)((fb->width * roi.width + 999) / 1000);
+    rect.height = (uint16_t)((fb->height * roi.height + 999) / 1000);
+    JpegRect applied;
+    size_t length = cropper.crop(fb->buf, fb->len, rect, roiBuffer, roiCapacity, &applied);
+    if (length == 0) {
+        roiStats.failed++;
+        return fb;
+    }
+    
+    roiFrame = *fb;
+    roiFrame.buf = roiBuffer;
+    roiFrame.len = length;
+    roiFrame.width = applied.width;
+    roiFrame.height = applied.height;
+    esp_camera_fb_return(fb);
+    
+    roiStats.cropped++;
+    roiStats.lastBytes = length;
+    roiStats.lastRect = applied;
+    roiStats.lastCropUs = hal::micros() - start;
+    return &roiFrame;
+}
+
+void CameraManager::release(camera_fb_t* fb) {
+    if (fb == NULL) {
+        return;
+    }
+    // El cuadro recortado es propio: el del sensor ya se devolvió
+    if (fb != &roiFrame) {
+        esp_camera_fb_return(fb);
+    }
+    frameLock.unlock();
+}
+
+camera_fb_t* CameraManager::captureLive() {
+    if (!cameraInitialized) return NULL;
+    if (!frameLock.tryLock()) {
+        lockStats.liveSkipped++;
+        return NULL;
+    }
+    camera_fb_t *fb = grabFrame();
+    if (fb == NULL) {
+        frameLock.unlock();
+    }
+    return fb;
+}
+
+bool CameraManager::lockFrame() {
+    if (frameLock.tryLock()) {
+        return true;
+    }
+    // Lo tiene la vista en vivo: en el ESP32 hereda la prioridad de esta
+    // tarea hasta soltarlo
+    lockStats.contended++;
+    unsigned long start = hal::micros();
+    frameWaiters++;
+    bool locked = frameLock.lock(CAMERA_LOCK_WAIT_MS);
+    frameWaiters--;
+    unsigned long waited = hal::micros() - start;
+    if (waited > lockStats.maxWaitUs) {
+        lockStats.maxWaitUs = waited;
+    }
+    if (!locked) {
+        lockStats.timeouts++;
+    }
+    return locked;
+}
+
+bool CameraManager::isFrameWanted() const {
+    return frameWaiters > 0;
+}
+
+CameraLockStats CameraManager::getLockStats() const {
+    return lockStats;
+}
+
+void CameraManager::setAutoTune(bool enable) {
+    autoTune = enable;
+}
+
+bool CameraManager::isAutoTune() const {
+    return autoTune;
+}
+
+JpegTuner& CameraManager::getTuner() {
+    return tuner;
+}
+
+void CameraManager::reportUpload(size_t wireBytes, unsigned long uploadMs) {
+    tuner.reportUpload(wireBytes, uploadMs);
+}
+
+JpegSettings CameraManager::getLastSettings() const {
+    return lastSettings;
+}
+
+size_t CameraManager::getLastFrameBytes() const {
+    return lastFrameBytes;
+}
+
+bool CameraManager::applyFramesize(framesize_t framesize) {
+    if (framesize == sensor->status.framesize) return false;
+    
+    if (!registerAccess || !sameSensorWindow((framesize_t)sensor->status.framesize, framesize)) {
+        // Cambia el modo o la relación de aspecto: ventana completa y resincronización
+        sensor->set_framesize(sensor, framesize);
+        switchStats.windowResyncs++;
+        shadow.invalidate();
+        if (registerAccess) {
+            SensorWrite zoom[3];
+            uint8_t count = zoomWrites(framesize, zoom);
+            for (uint8_t i = 0; i < count; i++) {
+                shadow.assume(zoom[i]);
+            }
+        }
+        return true;
+    }
+    
+    // Misma ventana del sensor: solo el escalador de salida del DSP
+    SensorWrite zoom[3];
+    uint8_t count = zoomWrites(framesize, zoom);
+    shadow.apply(sensor, zoom, count);
+    sensor->status.framesize = framesize;
+    return true;
+}
+
+bool CameraManager::applyQuality(int quality) {
+    if (quality == sensor->status.quality) return false;
+    if (registerAccess) {
+        shadow.write(sensor, qualityWrite((uint8_t)quality));
+        sensor->status.quality = (uint8_t)quality;
+    } else {
+        sensor->set_quality(sensor, quality);
+    }
+    return true;
+}
+
+bool CameraManager::applyGainCeiling(int gainceiling) {
+    if (gainceiling == sensor->status.gainceiling) return false;
+    if (registerAccess) {
+        shadow.write(sensor, gainCeilingWrite((uint8_t)gainceiling));
+        sensor->status.gainceiling = (uint8_t)gainceiling;
+    } else {
+        sensor->set_gainceiling(sensor, (gainceiling_t)gainceiling);
+    }
+    return true;
+}
+
+bool CameraManager::applyBrightness(int brightness) {
+    if (brightness == sensor->status.brightness) return false;
+    sensor->set_brightness(sensor, brightness);
+    switchStats.sdeCalls++;
+    return true;
+}
+
+bool CameraManager::applyContrast(int contrast) {
+    if (contrast == sensor->status.contrast) return false;
+    sensor->set_contrast(sensor, contrast);
+    switchStats.sdeCalls++;
+    return true;
+}
+
+void CameraManager::markSwitch(unsigned long startUs) {
+    // Varios cambios seguidos cuentan desde el primero
+    if (!switchPending) {
+        switchStartUs = startUs;
+        switchPending = true;
+    }
+}
+
+bool CameraManager::applyProfile(CameraProfileId id) {
+    if (id >= PROFILE_COUNT) return false;
+    const CompiledProfile& compiled = profiles[id];
+    const CameraProfile& profile = *compiled.profile;
+    
+    // Con ajuste automático el perfil es el techo de resolución y calidad
+    tuner.setMaxFramesize(profile.framesize);
+    tuner.setBestQuality(profile.quality);
+    manualFramesize = profile.framesize;
+    if (!cameraInitialized) return false;
+    
+    unsigned long start = hal::micros();
+    uint32_t writesBefore = shadow.getStats().writes;
+    bool changed = false;
+    if (registerAccess) {
+        // Un cambio de modo pasa por el driver; después, una sola ráfaga con
+        // lo que falte (el escalador ya quedó escrito y se omite)
+        if (!sameSensorWindow((framesize_t)sensor->status.framesize, profile.framesize)) {
+            changed = applyFramesize(profile.framesize);
+        }
+        changed = shadow.apply(sensor, compiled.writes, compiled.writeCount) > 0 || changed;
+        sensor->status.framesize = profile.framesize;
+        sensor->status.quality = profile.quality;
+        sensor->status.gainceiling = profile.gainceiling;
+    } else {
+        changed = applyFramesize(profile.framesize);
+        changed = applyQuality(profile.quality) || changed;
+        changed = applyGainCeiling(profile.gainceiling) || changed;
+    }
+    changed = applyBrightness(profile.brightness) || changed;
+    changed = applyContrast(profile.contrast) || changed;
+    
+    activeProfile = id;
+    if (!changed) return true;
+    
+    switchStats.switches++;
+    switchStats.lastApplyUs = hal::micros() - start;
+    markSwitch(start);
+    Serial.printf("📷 Perfil %s: %u registros en %lu us\n", profile.name,
+                  (unsigned)(shadow.getStats().writes - writesBefore), switchStats.lastApplyUs);
+    return true;
+}
+
+bool CameraManager::applyProfile(const char* name) {
+    int id = findCameraProfile(name);
+    if (id < 0) {
+        Serial.printf("⚠️ Perfil de cámara desconocido: %s\n", name);
+        return false;
+    }
+    return applyProfile((CameraProfileId)id);
+}
+
+int CameraManager::getActiveProfile() const {
+    return activeProfile;
+}
+
+CameraSwitchStats CameraManager::getSwitchStats() const {
+    CameraSwitchStats stats = switchStats;
+    stats.registerWrites = shadow.getStats().writes;
+    stats.writesSkipped = shadow.getStats().skipped;
+    return stats;
+}
+
+void CameraManager::setRegionOfInterest(const CameraRoi& region) {
+    if (region.width == 0 || region.height == 0 || region.x >= 1000 || region.y >= 1000) {
+        clearRegionOfInterest();
+        return;
+    }
+    roi = region;
+    if (roi.x + roi.width > 1000) roi.width = (uint16_t)(1000 - roi.x);
+    if (roi.y + roi.height > 1000) roi.height = (uint16_t)(1000 - roi.y);
+    
+    // El cuadro completo no necesita recorte
+    roiEnabled = roi.width < 1000 || roi.height < 1000;
+    if (roiEnabled) {
+        Serial.printf("📐 Región de interés: x=%u y=%u %ux%u (milésimas)\n",
+                      roi.x, roi.y, roi.width, roi.height);
+    }
+}
+
+void CameraManager::clearRegionOfInterest() {
+    roi = {0, 0, 1000, 1000};
+    roiEnabled = false;
+}
+
+bool CameraManager::hasRegionOfInterest() const {
+    return roiEnabled;
+}
+
+CameraRoi CameraManager::getRegionOfInterest() const {
+    return roi;
+}
+
+CameraRoiStats CameraManager::getRoiStats() const {
+    return roiStats;
+}
+
 void CameraManager::setResolution(framesize_t resolution) {
+    // Con ajuste automático pasa a ser la resolución máxima
+    tuner.setMaxFramesize(resolution);
+    manualFramesize = resolution;
     if (!cameraInitialized) return;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        s->set_framesize(s, resolution);
+    activeProfile = -1;
+    if (applyFramesize(resolution)) {
+        markSwitch(hal::micros());
         Serial.printf("Resolución cambiada a: %d\n", resolution);
     }
 }
 
 void CameraManager::setQuality(int quality) {
+    // Con ajuste automático pasa a ser la mejor calidad permitida
+    tuner.setBestQuality(quality);
     if (!cameraInitialized) return;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        s->set_quality(s, quality);
+    activeProfile = -1;
+    if (applyQuality(quality)) {
+        markSwitch(hal::micros());
         Serial.printf("Calidad JPEG cambiada a: %d\n", quality);
     }
 }
@@ -226,9 +702,9 @@ void CameraManager::setQuality(int quality) {
 void CameraManager::setBrightness(int brightness) {
     if (!cameraInitialized) return;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        s->set_brightness(s, brightness);
+    activeProfile = -1;
+    if (applyBrightness(brightness)) {
+        markSwitch(hal::micros());
         Serial.printf("Brillo cambiado a: %d\n", brightness);
     }
 }
@@ -236,9 +712,9 @@ void CameraManager::setBrightness(int brightness) {
 void CameraManager::setContrast(int contrast) {
     if (!cameraInitialized) return;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        s->set_contrast(s, contrast);
+    activeProfile = -1;
+    if (applyContrast(contrast)) {
+        markSwitch(hal::micros());
         Serial.printf("Contraste cambiado a: %d\n", contrast);
     }
 }
@@ -246,41 +722,25 @@ void CameraManager::setContrast(int contrast) {
 framesize_t CameraManager::getCurrentResolution() {
     if (!cameraInitialized) return FRAMESIZE_INVALID;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        return (framesize_t)s->status.framesize;
-    }
-    return FRAMESIZE_INVALID;
+    return (framesize_t)sensor->status.framesize;
 }
 
 int CameraManager::getCurrentQuality() {
     if (!cameraInitialized) return -1;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        return s->status.quality;
-    }
-    return -1;
+    return sensor->status.quality;
 }
 
 int CameraManager::getCurrentBrightness() {
     if (!cameraInitialized) return -1;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        return s->status.brightness;
-    }
-    return -1;
+    return sensor->status.brightness;
 }
 
 int CameraManager::getCurrentContrast() {
     if (!cameraInitialized) return -1;
     
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        return s->status.contrast;
-    }
-    return -1;
+    return sensor->status.contrast;
 }
 
 // Métodos para cambiar resolución
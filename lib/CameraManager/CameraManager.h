@@ -1,18 +1,111 @@
 #ifndef CAMERAMANAGER_H
 #define CAMERAMANAGER_H
 
-#include <Arduino.h>
-#include "esp_camera.h"
+#include "Hal.h"
+#include "HalCamera.h"
+#include "HalTask.h"
+#include "JpegTuner.h"
+#include "CameraProfile.h"
+#include "JpegCrop.h"
+
+// Costo de los cambios de perfil. Sin cuadros descartados por la
+// resincronización del sensor (el driver no los informa): en la placa se ven
+// en lastSwitchUs y en el host en hal::sim::framesDropped().
+struct CameraSwitchStats {
+    uint32_t switches;          // applyProfile() que cambiaron algo en el sensor
+    uint32_t registerWrites;    // set_reg() emitidos por la caché de registros
+    uint32_t writesSkipped;     // Escrituras omitidas: el registro ya tenía el valor
+    uint32_t sdeCalls;          // Brillo/contraste por el driver
+    uint32_t windowResyncs;     // set_framesize() completos del driver
+    uint32_t staleFrames;       // Cuadros pendientes descartados tras un cambio
+    unsigned long lastApplyUs;  // Ráfaga SCCB del último cambio
+    unsigned long lastSwitchUs; // Del último cambio al primer cuadro válido
+};
+
+// Espera máxima de capture()/captureGrayscale() por el cuadro que tiene otra
+// tarea (la vista en vivo lo suelta al terminar de enviarlo)
+#define CAMERA_LOCK_WAIT_MS 1500
+
+// Esperas de las capturas por el buffer del cuadro
+struct CameraLockStats {
+    uint32_t contended;         // Capturas que encontraron el cuadro tomado
+    uint32_t timeouts;          // Sin cuadro tras CAMERA_LOCK_WAIT_MS
+    uint32_t liveSkipped;       // captureLive() sin cuadro: lo tenía una captura
+    unsigned long maxWaitUs;
+};
+
+// Región de interés en milésimas del cuadro: vale igual para cualquier resolución
+struct CameraRoi {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+struct CameraRoiStats {
+    uint32_t cropped;           // Cuadros recortados
+    uint32_t failed;            // No se pudo recortar: se envió el cuadro completo
+    size_t lastFullBytes;       // JPEG del sensor
+    size_t lastBytes;           // JPEG devuelto por capture()
+    unsigned long lastCropUs;
+    JpegRect lastRect;          // En píxeles, ya ajustado a bordes de MCU
+};
 
 class CameraManager {
 private:
     bool cameraInitialized;
     bool cameraDetected;
     camera_config_t config;
+    sensor_t* sensor;               // Fijo entre begin() y end()
+    
+    // Perfiles precompilados y caché de registros (solo OV2640)
+    CompiledProfile profiles[PROFILE_COUNT];
+    SensorShadow shadow;
+    bool registerAccess;            // El sensor es un OV2640: escribir registros directo
+    int activeProfile;              // -1 = ajustes sueltos
+    CameraSwitchStats switchStats;
+    unsigned long switchStartUs;
+    bool switchPending;             // Falta el primer cuadro tras el cambio
+    
+    // Ajuste automático de calidad/resolución por captura
+    JpegTuner tuner;
+    bool autoTune;
+    JpegSettings lastSettings;      // Ajustes de la última captura
+    size_t lastFrameBytes;
+    framesize_t manualFramesize;    // Última setResolution(): la de las capturas sin ajuste
+    
+    // Recorte a la región de interés (JpegCrop.h): el cuadro recortado vive
+    // en roiBuffer y el del sensor se devuelve al driver enseguida
+    CameraRoi roi;
+    bool roiEnabled;
+    JpegCropper cropper;
+    uint8_t* roiBuffer;
+    size_t roiCapacity;
+    camera_fb_t roiFrame;
+    CameraRoiStats roiStats;
+    uint8_t* thumbBuffer;           // Miniatura DC de captureGrayscale()
+    size_t thumbCapacity;
+    
+    // Con fb_count = 1 hay un solo cuadro: lo toma una captura a la vez,
+    // desde capture() hasta release()
+    hal::Mutex frameLock;
+    volatile uint8_t frameWaiters;  // Capturas esperando el cuadro
+    CameraLockStats lockStats;
+    bool lockFrame();
     
     // Configuración específica para ESP32-S3-CAM
     void setupCameraConfig();
     
+    // Cambios en el sensor solo si difieren del estado actual; true si hubo escritura
+    bool applyFramesize(framesize_t framesize);
+    bool applyQuality(int quality);
+    bool applyGainCeiling(int gainceiling);
+    bool applyBrightness(int brightness);
+    bool applyContrast(int contrast);
+    void markSwitch(unsigned long startUs);
+    camera_fb_t* grabFrame();       // Descarta el cuadro viejo tras un cambio
+    camera_fb_t* cropToRoi(camera_fb_t* fb);
+    
 public:
     // Constructor
     CameraManager();
@@ -31,6 +124,54 @@ public:
     // Captura de imagen (básica para testing)
     bool captureTest();
     
+    // Captura para enviar: con el ajuste automático activo, aplica antes la
+    // calidad/resolución que calcula el JpegTuner. Con región de interés
+    // devuelve solo esa parte del cuadro. Devolver con release().
+    camera_fb_t* capture();
+    // Igual, con un tope de resolución solo para esta captura (-1 = sin tope;
+    // ver CapturePolicy res=)
+    camera_fb_t* capture(int maxFramesize);
+    void release(camera_fb_t* fb);
+    
+    // Cuadro completo del sensor tal como está configurado, sin ajuste ni
+    // recorte ni copia (vista en vivo). No espera: NULL si otra captura tiene
+    // el cuadro. Devolver con release().
+    camera_fb_t* captureLive();
+    // Una captura espera el cuadro que tiene captureLive(): soltarlo cuanto antes
+    bool isFrameWanted() const;
+    CameraLockStats getLockStats() const;
+    
+    // Miniatura en escala de grises de un cuadro nuevo (con los ajustes
+    // actuales, sin pasar por el ajuste automático), para clasificar en el
+    // dispositivo. Sale de los DC del JPEG (1/8 de escala, sin IDCT) y se
+    // reduce por promedio de áreas a width x height; con región de interés
+    // solo cubre la región. out debe tener width * height bytes.
+    bool captureGrayscale(uint8_t* out, uint16_t width, uint16_t height);
+    
+    // Ajuste automático hacia un presupuesto de bytes por imagen
+    void setAutoTune(bool enable);
+    bool isAutoTune() const;
+    JpegTuner& getTuner();
+    void reportUpload(size_t wireBytes, unsigned long uploadMs);
+    JpegSettings getLastSettings() const;
+    size_t getLastFrameBytes() const;
+    
+    // Perfiles de captura (CameraProfile.h): aplica en una ráfaga solo los
+    // registros que cambian. Con ajuste automático fija sus límites.
+    bool applyProfile(CameraProfileId id);
+    bool applyProfile(const char* name);
+    int getActiveProfile() const;
+    CameraSwitchStats getSwitchStats() const;
+    
+    // Región de interés del espacio vigilado. El recorte es en bordes de MCU
+    // sobre el JPEG del sensor; el ajuste automático presupuesta los bytes
+    // recortados, así que la región se envía con más resolución o calidad.
+    void setRegionOfInterest(const CameraRoi& region);
+    void clearRegionOfInterest();
+    bool hasRegionOfInterest() const;
+    CameraRoi getRegionOfInterest() const;
+    CameraRoiStats getRoiStats() const;
+    
     // Configuración
     void setResolution(framesize_t resolution);
     void setQuality(int quality);
@@ -0,0 +1,127 @@
+#include "CameraProfile.h"
+
+#include <string.h>
+
+namespace {
+
+// Registros del OV2640 (ov2640_regs.h de esp32-camera)
+const uint16_t REG_QS = 0x44;           // Banco DSP: escala de cuantización JPEG
+const uint16_t REG_ZMOW = 0x5A;         // Banco DSP: ancho de salida / 4
+const uint16_t REG_ZMOH = 0x5B;         // Banco DSP: alto de salida / 4
+const uint16_t REG_ZMHH = 0x5C;         // Banco DSP: bits altos de ZMOW/ZMOH
+const uint16_t REG_COM9 = 0x100 | 0x14; // Banco del sensor: techo de ganancia en bits 7:5
+
+const CameraProfile PROFILES[PROFILE_COUNT] = {
+    // nombre       resolución       calidad brillo contraste techo de ganancia
+    {"day",        FRAMESIZE_QVGA,  12,     0,     0,        GAINCEILING_2X},
+    {"night",      FRAMESIZE_QVGA,  14,     1,     1,        GAINCEILING_16X},
+    {"thumbnail",  FRAMESIZE_QQVGA, 20,     0,     0,        GAINCEILING_2X},
+    {"evidence",   FRAMESIZE_VGA,   10,     0,     1,        GAINCEILING_2X},
+};
+
+const uint16_t WIDTHS[] = {96, 160, 176, 240, 240, 320, 400, 480, 640, 800, 1024, 1280, 1280, 1600};
+const uint16_t HEIGHTS[] = {96, 120, 144, 176, 240, 240, 296, 320, 480, 600, 768, 720, 1024, 1200};
+
+// Modo del sensor que elige set_framesize() del driver
+uint8_t sensorMode(framesize_t framesize) {
+    return framesize <= FRAMESIZE_CIF ? 0 : (framesize <= FRAMESIZE_SVGA ? 1 : 2);
+}
+
+} // namespace
+
+const CameraProfile& cameraProfile(CameraProfileId id) {
+    return PROFILES[id < PROFILE_COUNT ? id : PROFILE_DAY];
+}
+
+int findCameraProfile(const char* name) {
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (strcmp(PROFILES[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint8_t zoomWrites(framesize_t framesize, SensorWrite* out) {
+    // Mismos valores que escribe set_window() del driver
+    uint16_t w = WIDTHS[framesize];
+    uint16_t h = HEIGHTS[framesize];
+    out[0] = {REG_ZMOW, 0xFF, (uint8_t)(w >> 2)};
+    out[1] = {REG_ZMOH, 0xFF, (uint8_t)(h >> 2)};
+    out[2] = {REG_ZMHH, 0xFF, (uint8_t)(((w >> 10) & 0x03) | ((h >> 8) & 0x04))};
+    return 3;
+}
+
+SensorWrite qualityWrite(uint8_t quality) {
+    return {REG_QS, 0xFF, quality};
+}
+
+SensorWrite gainCeilingWrite(uint8_t gainceiling) {
+    return {REG_COM9, 0xE0, (uint8_t)(gainceiling << 5)};
+}
+
+bool sameSensorWindow(framesize_t from, framesize_t to) {
+    if (from >= FRAMESIZE_INVALID || to >= FRAMESIZE_INVALID) {
+        return false;
+    }
+    // El driver recorta la ventana según la relación de aspecto
+    return sensorMode(from) == sensorMode(to) &&
+           (uint32_t)WIDTHS[from] * HEIGHTS[to] == (uint32_t)WIDTHS[to] * HEIGHTS[from];
+}
+
+void compileProfile(const CameraProfile& profile, CompiledProfile& out) {
+    // Primero todo el banco DSP y al final el del sensor: un solo cambio de banco
+    out.profile = &profile;
+    out.zoomWrites = zoomWrites(profile.framesize, out.writes);
+    uint8_t n = out.zoomWrites;
+    out.writes[n++] = qualityWrite(profile.quality);
+    out.writes[n++] = gainCeilingWrite(profile.gainceiling);
+    out.writeCount = n;
+}
+
+// ---- SensorShadow ----
+
+SensorShadow::SensorShadow() {
+    memset(values, 0, sizeof(values));
+    memset(&stats, 0, sizeof(stats));
+    invalidate();
+}
+
+void SensorShadow::invalidate() {
+    memset(known, 0, sizeof(known));
+}
+
+void SensorShadow::assume(const SensorWrite& write) {
+    int bank = (write.reg >> 8) & 0x01;
+    uint8_t reg = write.reg & 0xFF;
+    values[bank][reg] = (uint8_t)((values[bank][reg] & ~write.mask) | (write.value & write.mask));
+    known[bank][reg] |= write.mask;
+}
+
+bool SensorShadow::write(sensor_t* sensor, const SensorWrite& write) {
+    int bank = (write.reg >> 8) & 0x01;
+    uint8_t reg = write.reg & 0xFF;
+    if ((known[bank][reg] & write.mask) == write.mask &&
+        (values[bank][reg] & write.mask) == (write.value & write.mask)) {
+        stats.skipped++;
+        return false;
+    }
+    if (sensor->set_reg(sensor, write.reg, write.mask, write.value) != 0) {
+        // No se sabe qué quedó en el registro: que la próxima vez se escriba
+        known[bank][reg] &= ~write.mask;
+        return false;
+    }
+    stats.writes++;
+    assume(write);
+    return true;
+}
+
+uint8_t SensorShadow::apply(sensor_t* sensor, const SensorWrite* writes, uint8_t count) {
+    uint8_t written = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (write(sensor, writes[i])) {
+            written++;
+        }
+    }
+    return written;
+}
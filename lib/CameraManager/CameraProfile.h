@@ -0,0 +1,97 @@
+#ifndef CAMERAPROFILE_H
+#define CAMERAPROFILE_H
+
+#include "HalCamera.h"
+
+// Perfiles de captura con nombre (día, noche, miniatura, evidencia) y la
+// caché de registros del sensor con la que CameraManager los aplica.
+//
+// Cada perfil se precompila una vez en la lista de escrituras de registro
+// del OV2640 que lo distinguen (calidad QS, tamaño de salida ZMOW/ZMOH/ZMHH,
+// techo de ganancia COM9), ordenada por banco para no alternar BANK_SEL.
+// SensorShadow recuerda el último valor escrito de cada registro y omite las
+// escrituras que no cambian nada: volver a aplicar el perfil activo no
+// genera tráfico SCCB.
+//
+// Cambiar de resolución con set_framesize() reescribe la ventana completa y
+// el sensor descarta cuadros al resincronizar. Si el modo del sensor (CIF,
+// SVGA o UXGA) y la relación de aspecto no cambian, basta con el escalador
+// de salida del DSP (3 registros) y no hay resincronización. El brillo y el
+// contraste van por los registros indirectos del SDE: se delegan al driver y
+// solo se llaman si cambian.
+
+enum CameraProfileId : uint8_t {
+    PROFILE_DAY = 0,
+    PROFILE_NIGHT,
+    PROFILE_THUMBNAIL,
+    PROFILE_EVIDENCE,
+    PROFILE_COUNT
+};
+
+struct CameraProfile {
+    const char* name;
+    framesize_t framesize;
+    uint8_t quality;            // 0-63, menor = mejor
+    int8_t brightness;          // -2 a 2
+    int8_t contrast;            // -2 a 2
+    uint8_t gainceiling;        // gainceiling_t
+};
+
+// Escritura de registro como set_reg() del driver: bit 8 de reg = banco del sensor
+struct SensorWrite {
+    uint16_t reg;
+    uint8_t mask;
+    uint8_t value;
+};
+
+#define PROFILE_MAX_WRITES 6
+
+// Perfil precompilado: escrituras directas de registro y ajustes del SDE
+struct CompiledProfile {
+    const CameraProfile* profile;
+    SensorWrite writes[PROFILE_MAX_WRITES];
+    uint8_t writeCount;
+    uint8_t zoomWrites;         // Las primeras zoomWrites son ZMOW/ZMOH/ZMHH
+};
+
+const CameraProfile& cameraProfile(CameraProfileId id);
+// -1 si no hay un perfil con ese nombre
+int findCameraProfile(const char* name);
+void compileProfile(const CameraProfile& profile, CompiledProfile& out);
+
+// Escrituras del escalador de salida para una resolución (3 registros)
+uint8_t zoomWrites(framesize_t framesize, SensorWrite* out);
+SensorWrite qualityWrite(uint8_t quality);
+SensorWrite gainCeilingWrite(uint8_t gainceiling);
+
+// La resolución se puede cambiar solo con el escalador: mismo modo del
+// sensor y misma relación de aspecto
+bool sameSensorWindow(framesize_t from, framesize_t to);
+
+struct SensorShadowStats {
+    uint32_t writes;            // set_reg() emitidos
+    uint32_t skipped;           // Omitidos porque el registro ya tenía el valor
+};
+
+class SensorShadow {
+private:
+    uint8_t values[2][256];     // [banco][registro]
+    uint8_t known[2][256];      // Bits de values que reflejan el sensor
+    SensorShadowStats stats;
+
+public:
+    SensorShadow();
+
+    // Olvida todo (el driver reescribió registros por su cuenta)
+    void invalidate();
+    // Registrar un valor escrito por el driver sin emitir nada
+    void assume(const SensorWrite& write);
+    // Escribe si hace falta; true si se emitió set_reg()
+    bool write(sensor_t* sensor, const SensorWrite& write);
+    // Emite las escrituras pendientes de la lista; devuelve cuántas
+    uint8_t apply(sensor_t* sensor, const SensorWrite* writes, uint8_t count);
+
+    const SensorShadowStats& getStats() const { return stats; }
+};
+
+#endif // CAMERAPROFILE_H
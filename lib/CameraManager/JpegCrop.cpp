@@ -0,0 +1,621 @@
+#include "JpegCrop.h"
+
+#include <string.h>
+
+namespace {
+
+uint16_t readWord(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Lectura de datos de entropía: quita el 0x00 de relleno tras cada 0xFF y se
+// detiene en el primer marcador. Después del marcador entrega ceros y los
+// cuenta: consumirlos significa que los datos están truncados.
+struct BitReader {
+    const uint8_t* data;
+    size_t pos;
+    size_t end;
+    uint64_t acc;
+    int bits;
+    int padding;                // Ceros agregados al final de acc
+    bool marker;
+    bool overrun;
+
+    void fill() {
+        while (bits <= 56) {
+            uint64_t b = 0;
+            if (!marker && pos < end) {
+                b = data[pos];
+                if (b == 0xFF && pos + 1 < end && data[pos + 1] == 0x00) {
+                    pos += 2;
+                } else if (b == 0xFF) {
+                    marker = true;
+                    b = 0;
+                    padding += 8;
+                } else {
+                    pos++;
+                }
+            } else {
+                padding += 8;
+            }
+            acc |= b << (56 - bits);
+            bits += 8;
+        }
+    }
+
+    uint32_t peek(int count) {
+        if (bits < count) {
+            fill();
+        }
+        return (uint32_t)(acc >> (64 - count));
+    }
+
+    void skip(int count) {
+        acc <<= count;
+        bits -= count;
+        if (bits < padding) {
+            overrun = true;
+        }
+    }
+
+    uint32_t get(int count) {
+        if (count == 0) {
+            return 0;
+        }
+        uint32_t value = peek(count);
+        skip(count);
+        return value;
+    }
+
+    // Descarta el relleno hasta el byte y consume el RSTn esperado
+    bool restart(int index) {
+        acc = 0;
+        bits = 0;
+        padding = 0;
+        marker = false;
+        if (pos + 1 >= end || data[pos] != 0xFF || data[pos + 1] != 0xD0 + index) {
+            return false;
+        }
+        pos += 2;
+        return true;
+    }
+};
+
+struct BitWriter {
+    uint8_t* out;
+    size_t pos;
+    size_t capacity;
+    uint32_t acc;
+    int bits;
+    bool overflow;
+
+    void byte(uint8_t value) {
+        if (pos >= capacity) {
+            overflow = true;
+            return;
+        }
+        out[pos++] = value;
+    }
+
+    void bytes(const uint8_t* data, size_t count) {
+        if (pos + count > capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(out + pos, data, count);
+        pos += count;
+    }
+
+    void put(uint32_t value, int count) {
+        acc = (acc << count) | (value & ((1u << count) - 1));
+        bits += count;
+        while (bits >= 8) {
+            uint8_t b = (uint8_t)(acc >> (bits - 8));
+            byte(b);
+            if (b == 0xFF) {
+                byte(0x00);
+            }
+            bits -= 8;
+        }
+    }
+
+    void flush() {
+        if (bits > 0) {
+            put(0x7F, 8 - bits);    // Relleno con unos
+        }
+    }
+};
+
+// Coeficiente con signo a partir de sus bits adicionales (F.2.2.1)
+int extend(uint32_t value, int size) {
+    if (size == 0) {
+        return 0;
+    }
+    return value < (1u << (size - 1)) ? (int)value - (1 << size) + 1 : (int)value;
+}
+
+int magnitudeSize(int value) {
+    unsigned v = (unsigned)(value < 0 ? -value : value);
+    int size = 0;
+    while (v) {
+        size++;
+        v >>= 1;
+    }
+    return size;
+}
+
+} // namespace
+
+JpegCropper::JpegCropper() {
+    memset(dc, 0, sizeof(dc));
+    memset(ac, 0, sizeof(ac));
+    memset(components, 0, sizeof(components));
+    componentCount = 0;
+    width = 0;
+    height = 0;
+    restartInterval = 0;
+    memset(quantDc, 0, sizeof(quantDc));
+}
+
+bool JpegCropper::buildHuffman(JpegHuffman& table, const uint8_t* bits, const uint8_t* values) {
+    memset(&table, 0, sizeof(table));
+    int32_t code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++) {
+        table.valOffset[length] = k - code;
+        for (int i = 0; i < bits[length - 1]; i++, k++, code++) {
+            uint8_t symbol = values[k];
+            table.values[k] = symbol;
+            if (length <= 8) {
+                int shift = 8 - length;
+                for (int j = 0; j < (1 << shift); j++) {
+                    table.fast[(code << shift) | j] = (uint16_t)((length << 8) | symbol);
+                }
+            }
+            if (symbol < 16) {
+                table.code[symbol] = (uint16_t)code;
+                table.size[symbol] = (uint8_t)length;
+            }
+        }
+        table.maxCode[length] = bits[length - 1] ? code - 1 : -1;
+        if (code > (1 << length)) {
+            return false;           // Más códigos que los que caben en ese largo
+        }
+        code <<= 1;
+    }
+    table.maxCode[17] = 0x7FFFFFFF;
+    table.present = true;
+    return true;
+}
+
+// Símbolo siguiente; en codeBits/codeLength queda el código tal como venía
+static int decodeSymbol(BitReader& reader, const JpegHuffman& table, uint32_t* codeBits, int* codeLength) {
+    uint32_t look = reader.peek(16);
+    uint16_t entry = table.fast[look >> 8];
+    if (entry != 0) {
+        *codeLength = entry >> 8;
+        *codeBits = look >> (16 - *codeLength);
+        reader.skip(*codeLength);
+        return entry & 0xFF;
+    }
+    for (int length = 9; length <= 16; length++) {
+        int32_t code = (int32_t)(look >> (16 - length));
+        if (code <= table.maxCode[length]) {
+            *codeLength = length;
+            *codeBits = (uint32_t)code;
+            reader.skip(length);
+            return table.values[code + table.valOffset[length]];
+        }
+    }
+    return -1;
+}
+
+bool JpegCropper::imageSize(const uint8_t* jpeg, size_t length, uint16_t* width, uint16_t* height) {
+    if (length < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) {
+        return false;
+    }
+    size_t pos = 2;
+    while (pos + 4 <= length && jpeg[pos] == 0xFF) {
+        uint8_t marker = jpeg[pos + 1];
+        size_t segment = readWord(jpeg + pos + 2);
+        if (marker == 0xC0 || marker == 0xC1) {
+            if (pos + 9 > length) {
+                return false;
+            }
+            *height = readWord(jpeg + pos + 5);
+            *width = readWord(jpeg + pos + 7);
+            return true;
+        }
+        if (marker == 0xDA || marker == 0xD9 || segment < 2) {
+            return false;
+        }
+        pos += 2 + segment;
+    }
+    return false;
+}
+
+size_t JpegCropper::outputCapacity(size_t inputLength) {
+    // El DC recodificado puede crecer algunos bits por bloque
+    return inputLength + inputLength / 8 + 1024;
+}
+
+size_t JpegCropper::parseHeaders(const uint8_t* jpeg, size_t length) {
+    if (length < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) {
+        return 0;
+    }
+    dc[0].present = dc[1].present = false;
+    ac[0].present = ac[1].present = false;
+    componentCount = 0;
+    restartInterval = 0;
+    memset(quantDc, 0, sizeof(quantDc));
+
+    size_t pos = 2;
+    while (true) {
+        if (pos + 4 > length || jpeg[pos] != 0xFF) {
+            return 0;
+        }
+        uint8_t marker = jpeg[pos + 1];
+        if (marker == 0xFF) {
+            pos++;                  // Relleno entre segmentos
+            continue;
+        }
+        size_t segment = readWord(jpeg + pos + 2);
+        if (segment < 2 || pos + 2 + segment > length) {
+            return 0;
+        }
+        const uint8_t* data = jpeg + pos + 4;
+        size_t count = segment - 2;
+
+        if (marker == 0xC0 || marker == 0xC1) {
+            if (count < 6 || data[0] != 8) {
+                return 0;
+            }
+            height = readWord(data + 1);
+            width = readWord(data + 3);
+            componentCount = data[5];
+            if ((componentCount != 1 && componentCount != 3) || count < 6 + 3u * componentCount ||
+                width == 0 || height == 0) {
+                return 0;
+            }
+            for (uint8_t i = 0; i < componentCount; i++) {
+                components[i].id = data[6 + 3 * i];
+                components[i].h = data[7 + 3 * i] >> 4;
+                components[i].v = data[7 + 3 * i] & 0x0F;
+                components[i].quantTable = data[8 + 3 * i] & 0x03;
+                if (components[i].h < 1 || components[i].h > 2 || components[i].v < 1 || components[i].v > 2) {
+                    return 0;
+                }
+            }
+        } else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4) {
+            return 0;               // Progresivo, sin pérdida o aritmético
+        } else if (marker == 0xC4) {
+            size_t i = 0;
+            while (i + 17 <= count) {
+                uint8_t tableClass = data[i] >> 4;
+                uint8_t tableId = data[i] & 0x0F;
+                const uint8_t* bits = data + i + 1;
+                size_t symbols = 0;
+                for (int b = 0; b < 16; b++) {
+                    symbols += bits[b];
+                }
+                if (tableClass > 1 || tableId > 1 || symbols > 256 || i + 17 + symbols > count) {
+                    return 0;
+                }
+                JpegHuffman& table = tableClass == 0 ? dc[tableId] : ac[tableId];
+                if (!buildHuffman(table, bits, data + i + 17)) {
+                    return 0;
+                }
+                i += 17 + symbols;
+            }
+        } else if (marker == 0xDB) {
+            // Solo interesa el primer coeficiente (DC) de cada tabla
+            size_t i = 0;
+            while (i < count) {
+                uint8_t precision = data[i] >> 4;
+                size_t tableSize = precision ? 128 : 64;
+                if (i + 1 + tableSize > count) {
+                    return 0;
+                }
+                quantDc[data[i] & 0x03] = precision ? readWord(data + i + 1) : data[i + 1];
+                i += 1 + tableSize;
+            }
+        } else if (marker == 0xDD) {
+            if (count < 2) {
+                return 0;
+            }
+            restartInterval = readWord(data);
+        } else if (marker == 0xDA) {
+            // Un solo scan con todos los componentes, espectro completo
+            if (componentCount == 0 || count < 1 || data[0] != componentCount ||
+                count < 4 + 2u * componentCount) {
+                return 0;
+            }
+            for (uint8_t i = 0; i < componentCount; i++) {
+                uint8_t id = data[1 + 2 * i];
+                uint8_t c = 0;
+                while (c < componentCount && components[c].id != id) {
+                    c++;
+                }
+                if (c != i) {
+                    return 0;
+                }
+                components[c].dcTable = data[2 + 2 * i] >> 4;
+                components[c].acTable = data[2 + 2 * i] & 0x0F;
+                if (components[c].dcTable > 1 || components[c].acTable > 1 ||
+                    !dc[components[c].dcTable].present || !ac[components[c].acTable].present) {
+                    return 0;
+                }
+            }
+            const uint8_t* spectral = data + 1 + 2 * componentCount;
+            if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) {
+                return 0;
+            }
+            return pos + 2 + segment;
+        } else if (marker == 0xD9 || (marker >= 0xD0 && marker <= 0xD8)) {
+            return 0;
+        }
+        pos += 2 + segment;
+    }
+}
+
+void JpegCropper::mcuLayout(uint8_t* blocks, int* mcuWidth, int* mcuHeight) const {
+    *mcuWidth = 8;
+    *mcuHeight = 8;
+    if (componentCount == 1) {
+        blocks[0] = 1;              // Un solo componente: un bloque por MCU
+        return;
+    }
+    uint8_t hmax = 1;
+    uint8_t vmax = 1;
+    for (uint8_t i = 0; i < componentCount; i++) {
+        blocks[i] = (uint8_t)(components[i].h * components[i].v);
+        hmax = components[i].h > hmax ? components[i].h : hmax;
+        vmax = components[i].v > vmax ? components[i].v : vmax;
+    }
+    *mcuWidth = 8 * hmax;
+    *mcuHeight = 8 * vmax;
+}
+
+size_t JpegCropper::crop(const uint8_t* jpeg, size_t length, const JpegRect& rect,
+                         uint8_t* out, size_t outCapacity, JpegRect* applied) {
+    size_t scanStart = parseHeaders(jpeg, length);
+    if (scanStart == 0) {
+        return 0;
+    }
+
+    // ---- Cabeceras: se copian DQT, SOF, DHT y SOS; se descarta el resto ----
+    BitWriter writer = {out, 0, outCapacity, 0, 0, false};
+    writer.byte(0xFF);
+    writer.byte(0xD8);
+    size_t sofOut = 0;
+    for (size_t pos = 2; pos < scanStart;) {
+        uint8_t marker = jpeg[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        size_t segment = readWord(jpeg + pos + 2);
+        if (marker == 0xC0 || marker == 0xC1) {
+            sofOut = writer.pos;
+        }
+        if (marker == 0xC0 || marker == 0xC1 || marker == 0xC4 || marker == 0xDB || marker == 0xDA) {
+            writer.bytes(jpeg + pos, 2 + segment);
+        }
+        // APPn, COM y el resto no hacen falta para decodificar
+        pos += 2 + segment;
+    }
+
+    // ---- Geometría del recorte en MCU ----
+    uint8_t blocks[3];
+    int mcuWidth;
+    int mcuHeight;
+    mcuLayout(blocks, &mcuWidth, &mcuHeight);
+    int mcusX = (width + mcuWidth - 1) / mcuWidth;
+
+    if (rect.width == 0 || rect.height == 0 || rect.x >= width || rect.y >= height) {
+        return 0;
+    }
+    int right = rect.x + rect.width > width ? width : rect.x + rect.width;
+    int bottom = rect.y + rect.height > height ? height : rect.y + rect.height;
+    int col0 = rect.x / mcuWidth;
+    int col1 = (right + mcuWidth - 1) / mcuWidth;
+    int row0 = rect.y / mcuHeight;
+    int row1 = (bottom + mcuHeight - 1) / mcuHeight;
+    JpegRect result;
+    result.x = (uint16_t)(col0 * mcuWidth);
+    result.y = (uint16_t)(row0 * mcuHeight);
+    result.width = (uint16_t)((col1 * mcuWidth > width ? width : col1 * mcuWidth) - result.x);
+    result.height = (uint16_t)((row1 * mcuHeight > height ? height : row1 * mcuHeight) - result.y);
+    if (writer.overflow) {
+        return 0;
+    }
+    out[sofOut + 5] = (uint8_t)(result.height >> 8);
+    out[sofOut + 6] = (uint8_t)result.height;
+    out[sofOut + 7] = (uint8_t)(result.width >> 8);
+    out[sofOut + 8] = (uint8_t)result.width;
+
+    // ---- Datos de entropía: hasta la última fila del recorte ----
+    BitReader reader = {jpeg, scanStart, length, 0, 0, 0, false, false};
+    int inPredictor[3] = {0, 0, 0};
+    int outPredictor[3] = {0, 0, 0};
+    unsigned restartsLeft = restartInterval;
+    int nextRestart = 0;
+
+    for (int row = 0; row < row1; row++) {
+        for (int col = 0; col < mcusX; col++) {
+            if (restartInterval) {
+                if (restartsLeft == 0) {
+                    if (!reader.restart(nextRestart)) {
+                        return 0;
+                    }
+                    nextRestart = (nextRestart + 1) & 7;
+                    inPredictor[0] = inPredictor[1] = inPredictor[2] = 0;
+                    restartsLeft = restartInterval;
+                }
+                restartsLeft--;
+            }
+            bool keep = row >= row0 && col >= col0 && col < col1;
+
+            for (uint8_t c = 0; c < componentCount; c++) {
+                const JpegHuffman& dcTable = dc[components[c].dcTable];
+                const JpegHuffman& acTable = ac[components[c].acTable];
+                for (uint8_t b = 0; b < blocks[c]; b++) {
+                    uint32_t codeBits;
+                    int codeLength;
+                    int size = decodeSymbol(reader, dcTable, &codeBits, &codeLength);
+                    if (size < 0 || size > 11) {
+                        return 0;
+                    }
+                    inPredictor[c] += extend(reader.get(size), size);
+                    if (keep) {
+                        // DC relativo al bloque anterior que quedó en la salida
+                        int diff = inPredictor[c] - outPredictor[c];
+                        outPredictor[c] = inPredictor[c];
+                        int outSize = magnitudeSize(diff);
+                        if (dcTable.size[outSize] == 0) {
+                            return 0;
+                        }
+                        writer.put(dcTable.code[outSize], dcTable.size[outSize]);
+                        if (outSize > 0) {
+                            writer.put((uint32_t)(diff < 0 ? diff + (1 << outSize) - 1 : diff), outSize);
+                        }
+                    }
+
+                    // AC: los mismos códigos y bits adicionales
+                    for (int k = 1; k < 64;) {
+                        int symbol = decodeSymbol(reader, acTable, &codeBits, &codeLength);
+                        if (symbol < 0) {
+                            return 0;
+                        }
+                        if (keep) {
+                            writer.put(codeBits, codeLength);
+                        }
+                        int run = symbol >> 4;
+                        int bits = symbol & 0x0F;
+                        if (bits == 0) {
+                            if (run != 15) {
+                                break;      // EOB
+                            }
+                            k += 16;        // ZRL
+                            continue;
+                        }
+                        k += run;
+                        uint32_t extra = reader.get(bits);
+                        if (keep) {
+                            writer.put(extra, bits);
+                        }
+                        k++;
+                        if (k > 64) {
+                            return 0;
+                        }
+                    }
+                }
+            }
+            if (reader.overrun) {
+                return 0;
+            }
+        }
+    }
+
+    writer.flush();
+    writer.byte(0xFF);
+    writer.byte(0xD9);
+    if (writer.overflow) {
+        return 0;
+    }
+    if (applied != NULL) {
+        *applied = result;
+    }
+    return writer.pos;
+}
+
+size_t JpegCropper::lumaThumbnail(const uint8_t* jpeg, size_t length, uint8_t* out, size_t capacity,
+                                  uint16_t* thumbWidth, uint16_t* thumbHeight) {
+    size_t scanStart = parseHeaders(jpeg, length);
+    if (scanStart == 0) {
+        return 0;
+    }
+    uint8_t blocks[3];
+    int mcuWidth;
+    int mcuHeight;
+    mcuLayout(blocks, &mcuWidth, &mcuHeight);
+    int lumaH = componentCount == 1 ? 1 : components[0].h;
+    int lumaV = componentCount == 1 ? 1 : components[0].v;
+    int outWidth = (width * lumaH * 8 / mcuWidth + 7) / 8;
+    int outHeight = (height * lumaV * 8 / mcuHeight + 7) / 8;
+    int quant = quantDc[components[0].quantTable];
+    if ((size_t)outWidth * outHeight > capacity || quant == 0) {
+        return 0;
+    }
+    int mcusX = (width + mcuWidth - 1) / mcuWidth;
+    int mcusY = (height + mcuHeight - 1) / mcuHeight;
+
+    BitReader reader = {jpeg, scanStart, length, 0, 0, 0, false, false};
+    int predictor[3] = {0, 0, 0};
+    unsigned restartsLeft = restartInterval;
+    int nextRestart = 0;
+    for (int row = 0; row < mcusY; row++) {
+        for (int col = 0; col < mcusX; col++) {
+            if (restartInterval) {
+                if (restartsLeft == 0) {
+                    if (!reader.restart(nextRestart)) {
+                        return 0;
+                    }
+                    nextRestart = (nextRestart + 1) & 7;
+                    predictor[0] = predictor[1] = predictor[2] = 0;
+                    restartsLeft = restartInterval;
+                }
+                restartsLeft--;
+            }
+            for (uint8_t c = 0; c < componentCount; c++) {
+                const JpegHuffman& dcTable = dc[components[c].dcTable];
+                const JpegHuffman& acTable = ac[components[c].acTable];
+                for (uint8_t b = 0; b < blocks[c]; b++) {
+                    uint32_t codeBits;
+                    int codeLength;
+                    int size = decodeSymbol(reader, dcTable, &codeBits, &codeLength);
+                    if (size < 0 || size > 11) {
+                        return 0;
+                    }
+                    predictor[c] += extend(reader.get(size), size);
+
+                    // Promedio del bloque: DC descuantizado / 8, centrado en 128
+                    int x = col * lumaH + b % lumaH;
+                    int y = row * lumaV + b / lumaH;
+                    if (c == 0 && x < outWidth && y < outHeight) {
+                        int value = predictor[0] * quant;
+                        value = 128 + (value >= 0 ? value + 4 : value - 4) / 8;
+                        out[y * outWidth + x] = (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+                    }
+
+                    for (int k = 1; k < 64;) {
+                        int symbol = decodeSymbol(reader, acTable, &codeBits, &codeLength);
+                        if (symbol < 0) {
+                            return 0;
+                        }
+                        int run = symbol >> 4;
+                        int bits = symbol & 0x0F;
+                        if (bits == 0) {
+                            if (run != 15) {
+                                break;      // EOB
+                            }
+                            k += 16;        // ZRL
+                            continue;
+                        }
+                        reader.get(bits);
+                        k += run + 1;
+                        if (k > 64) {
+                            return 0;
+                        }
+                    }
+                }
+            }
+            if (reader.overrun) {
+                return 0;
+            }
+        }
+    }
+    *thumbWidth = (uint16_t)outWidth;
+    *thumbHeight = (uint16_t)outHeight;
+    return (size_t)outWidth * outHeight;
+}
@@ -0,0 +1,92 @@
+#ifndef JPEGCROP_H
+#define JPEGCROP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Recorte de un JPEG baseline en bordes de MCU, sin IDCT ni recuantizar.
+//
+// Solo se decodifica Huffman: los MCU fuera del rectángulo se descartan y los
+// de adentro se copian con sus códigos AC intactos. Lo único que se recodifica
+// es el DC, que es diferencial respecto del bloque anterior del mismo
+// componente y cambia de vecino al quitar columnas. El resultado es un JPEG
+// válido con las mismas tablas (DQT/DHT), un SOF con el tamaño nuevo y sin
+// marcadores de reinicio ni segmentos APPn/COM.
+//
+// El rectángulo se amplía hacia afuera hasta bordes de MCU (16x8 en el 4:2:2
+// del OV2640, 8x8 en escala de grises); el que se aplicó se devuelve. Costo:
+// proporcional a los bytes de entrada hasta la última fila del recorte, sin
+// memoria dinámica (~4 KB de tablas en el objeto). Con la misma decodificación
+// se obtiene una miniatura en escala de grises a partir de los DC.
+//
+// Sin dependencias de Arduino: se prueba y se simula en el host.
+
+struct JpegRect {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+// Tabla de Huffman de un DHT lista para decodificar
+struct JpegHuffman {
+    // Búsqueda rápida de códigos de hasta 8 bits: (largo << 8) | símbolo, 0 = más largo
+    uint16_t fast[256];
+    int32_t maxCode[18];        // Mayor código de cada largo (-1 si no hay)
+    int32_t valOffset[17];
+    uint8_t values[256];
+    uint16_t code[16];          // Para recodificar el DC: categorías 0-15
+    uint8_t size[16];
+    bool present;
+};
+
+class JpegCropper {
+public:
+    JpegCropper();
+
+    // Escribe en out el JPEG recortado y devuelve su tamaño; 0 si la entrada
+    // no es un baseline soportado (progresivo, aritmético, 12 bits, varios
+    // scans), está dañada o no cabe en outCapacity
+    size_t crop(const uint8_t* jpeg, size_t length, const JpegRect& rect,
+                uint8_t* out, size_t outCapacity, JpegRect* applied = NULL);
+
+    // Dimensiones del SOF sin recortar (false si no hay SOF baseline)
+    static bool imageSize(const uint8_t* jpeg, size_t length, uint16_t* width, uint16_t* height);
+
+    // Capacidad de salida suficiente para recortar una entrada de ese tamaño
+    static size_t outputCapacity(size_t inputLength);
+
+    // Miniatura en escala de grises a 1/8 de escala: un píxel por bloque de
+    // luminancia, su promedio sacado del DC (sin IDCT). Devuelve la cantidad
+    // de píxeles escritos en out (fila por fila, thumbWidth x thumbHeight);
+    // 0 con las mismas entradas que rechaza crop() o si no cabe en capacity
+    size_t lumaThumbnail(const uint8_t* jpeg, size_t length, uint8_t* out, size_t capacity,
+                         uint16_t* thumbWidth, uint16_t* thumbHeight);
+
+private:
+    struct Component {
+        uint8_t id;
+        uint8_t h;
+        uint8_t v;
+        uint8_t dcTable;
+        uint8_t acTable;
+        uint8_t quantTable;
+    };
+
+    JpegHuffman dc[2];              // Baseline: dos tablas DC y dos AC
+    JpegHuffman ac[2];
+    Component components[3];
+    uint8_t componentCount;
+    uint16_t width;
+    uint16_t height;
+    uint16_t restartInterval;
+    uint16_t quantDc[4];            // Primer coeficiente de cada DQT
+
+    // Lee las cabeceras hasta el SOS; devuelve dónde empiezan los datos de
+    // entropía o 0 si la entrada no está soportada
+    size_t parseHeaders(const uint8_t* jpeg, size_t length);
+    void mcuLayout(uint8_t* blocks, int* mcuWidth, int* mcuHeight) const;
+    static bool buildHuffman(JpegHuffman& table, const uint8_t* bits, const uint8_t* values);
+};
+
+#endif // JPEGCROP_H
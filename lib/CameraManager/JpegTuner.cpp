@@ -0,0 +1,195 @@
+#include "JpegTuner.h"
+
+#include <math.h>
+
+// Dimensiones por framesize_t, de FRAMESIZE_96X96 a FRAMESIZE_UXGA
+static const uint16_t frameDims[][2] = {
+    {96, 96}, {160, 120}, {176, 144}, {240, 176}, {240, 240}, {320, 240}, {400, 296},
+    {480, 320}, {640, 480}, {800, 600}, {1024, 768}, {1280, 720}, {1280, 1024}, {1600, 1200},
+};
+
+static const uint16_t* dimsFor(framesize_t framesize) {
+    int index = (int)framesize;
+    int last = (int)(sizeof(frameDims) / sizeof(frameDims[0])) - 1;
+    return frameDims[index < 0 ? 0 : index > last ? last : index];
+}
+
+static uint32_t pixelsFor(framesize_t framesize) {
+    const uint16_t* dims = dimsFor(framesize);
+    return (uint32_t)dims[0] * dims[1];
+}
+
+// Solo se baja a resoluciones con la misma proporción (QVGA → QQVGA, no 240x240)
+static bool sameAspect(framesize_t a, framesize_t b) {
+    const uint16_t* da = dimsFor(a);
+    const uint16_t* db = dimsFor(b);
+    return (uint32_t)da[0] * db[1] == (uint32_t)da[1] * db[0];
+}
+
+// Fracción del tiempo objetivo usada para el presupuesto: margen para la
+// variación del enlace entre una subida y la siguiente
+#define JPEG_BUDGET_HEADROOM 0.7f
+
+// Rendimiento TCP aproximado del ESP32-S3 según el RSSI, en bytes/ms
+static const struct {
+    int rssi;
+    float bytesPerMs;
+} rssiTable[] = {
+    {-50, 250.0f}, {-60, 150.0f}, {-70, 60.0f}, {-80, 15.0f}, {-90, 3.0f},
+};
+
+JpegTuner::JpegTuner() {
+    targetUploadMs = 1500;
+    bestQuality = 12;       // La calidad fija anterior: nunca se sube de ahí
+    worstQuality = 50;
+    downshiftQuality = 30;
+    minFramesize = FRAMESIZE_QVGA;
+    maxFramesize = FRAMESIZE_QVGA;
+
+    complexity = 1.0f;
+    throughput = 0.0f;
+    throughputRssi = -60;
+    rssi = -60;
+    current.framesize = FRAMESIZE_QVGA;
+    current.quality = 12;
+}
+
+void JpegTuner::setTargetUploadMs(unsigned long ms) {
+    targetUploadMs = ms > 0 ? ms : 1;
+}
+
+void JpegTuner::setQualityRange(int best, int worst) {
+    bestQuality = best < 0 ? 0 : best;
+    worstQuality = worst > 63 ? 63 : worst < bestQuality ? bestQuality : worst;
+    if (downshiftQuality > worstQuality) downshiftQuality = worstQuality;
+    if (downshiftQuality < bestQuality) downshiftQuality = bestQuality;
+}
+
+void JpegTuner::setFramesizeRange(framesize_t min, framesize_t max) {
+    minFramesize = min <= max ? min : max;
+    maxFramesize = max;
+}
+
+void JpegTuner::setInitialSettings(const JpegSettings& settings) {
+    current = settings;
+}
+
+void JpegTuner::setBestQuality(int best) {
+    setQualityRange(best, worstQuality > best ? worstQuality : best);
+}
+
+void JpegTuner::setMaxFramesize(framesize_t max) {
+    setFramesizeRange(minFramesize < max ? minFramesize : max, max);
+}
+
+void JpegTuner::reportRssi(int dbm) {
+    rssi = dbm;
+}
+
+void JpegTuner::reportFrame(const JpegSettings& used, size_t jpegBytes) {
+    size_t modeled = predictSize(used.framesize, used.quality, 1.0f);
+    if (modeled == 0 || jpegBytes == 0) {
+        return;
+    }
+
+    // El cuadro anterior pesa más: la luz y la escena cambian rápido
+    float observed = (float)jpegBytes / (float)modeled;
+    complexity = 0.3f * complexity + 0.7f * observed;
+}
+
+void JpegTuner::reportUpload(size_t wireBytes, unsigned long uploadMs) {
+    if (wireBytes == 0) {
+        return;
+    }
+
+    // Se promedia el tiempo por byte (media armónica del rendimiento): una
+    // subida lenta pesa más que una rápida, que es el error caro
+    float msPerByte = (float)(uploadMs > 0 ? uploadMs : 1) / (float)wireBytes;
+    if (throughput <= 0) {
+        throughput = 1.0f / msPerByte;
+        throughputRssi = rssi;
+    } else {
+        throughput = 1.0f / (0.7f / throughput + 0.3f * msPerByte);
+        throughputRssi = (int)lroundf(0.7f * throughputRssi + 0.3f * rssi);
+    }
+}
+
+float JpegTuner::linkThroughput() const {
+    float estimate = rssiThroughput(rssi);
+    if (throughput <= 0) {
+        return estimate;
+    }
+
+    // Corregir la medición si el RSSI cambió desde que se tomó
+    float ratio = estimate / rssiThroughput(throughputRssi);
+    ratio = ratio < 0.25f ? 0.25f : ratio > 4.0f ? 4.0f : ratio;
+    return throughput * ratio;
+}
+
+size_t JpegTuner::byteBudget() const {
+    // Base64 envía 4 caracteres por cada 3 bytes
+    float budget = linkThroughput() * (float)targetUploadMs * JPEG_BUDGET_HEADROOM * 0.75f;
+    return budget < 1024.0f ? 1024 : (size_t)budget;
+}
+
+float JpegTuner::sceneComplexity() const {
+    return complexity;
+}
+
+JpegSettings JpegTuner::nextSettings() {
+    // Resolución más baja permitida con la proporción de la máxima
+    int lowest = (int)maxFramesize;
+    for (int fs = (int)minFramesize; fs < (int)maxFramesize; fs++) {
+        if (sameAspect((framesize_t)fs, maxFramesize)) {
+            lowest = fs;
+            break;
+        }
+    }
+
+    float budget = (float)byteBudget();
+    JpegSettings next;
+    next.framesize = (framesize_t)lowest;
+    next.quality = worstQuality;
+
+    for (int fs = (int)maxFramesize; fs >= lowest; fs--) {
+        if (!sameAspect((framesize_t)fs, maxFramesize)) {
+            continue;
+        }
+
+        // Calidad mínima (número) con la que el cuadro cabe en el presupuesto
+        float scale = complexity * pixelsFor((framesize_t)fs) * 0.15f * 22.0f;
+        int quality = (int)ceilf(scale / budget - 10.0f);
+
+        int limit = fs == lowest ? worstQuality : downshiftQuality;
+        if (fs > (int)current.framesize) {
+            limit -= 4; // Histéresis: subir de resolución solo con margen
+        }
+        if (quality <= limit) {
+            next.framesize = (framesize_t)fs;
+            next.quality = quality < bestQuality ? bestQuality : quality > worstQuality ? worstQuality : quality;
+            break;
+        }
+    }
+
+    current = next;
+    return next;
+}
+
+size_t JpegTuner::predictSize(framesize_t framesize, int quality, float complexity) {
+    double size = (double)pixelsFor(framesize) * 0.15 * 22.0 / (quality + 10.0) * complexity;
+    return (size_t)size;
+}
+
+float JpegTuner::rssiThroughput(int dbm) {
+    const int count = sizeof(rssiTable) / sizeof(rssiTable[0]);
+    if (dbm >= rssiTable[0].rssi) {
+        return rssiTable[0].bytesPerMs;
+    }
+    for (int i = 1; i < count; i++) {
+        if (dbm >= rssiTable[i].rssi) {
+            float t = (float)(dbm - rssiTable[i].rssi) / (float)(rssiTable[i - 1].rssi - rssiTable[i].rssi);
+            return rssiTable[i].bytesPerMs + t * (rssiTable[i - 1].bytesPerMs - rssiTable[i].bytesPerMs);
+        }
+    }
+    return rssiTable[count - 1].bytesPerMs;
+}
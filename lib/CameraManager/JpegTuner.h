@@ -0,0 +1,73 @@
+#ifndef JPEGTUNER_H
+#define JPEGTUNER_H
+
+#include "HalCamera.h"
+
+// Ajuste automático de calidad JPEG (y opcionalmente resolución) por captura
+// para que cada imagen quepa en un presupuesto de bytes.
+//
+// Presupuesto = rendimiento del enlace × tiempo objetivo de subida, en bytes
+// de JPEG (descontando el 4/3 de base64). El rendimiento sale de las subidas
+// medidas (promedio exponencial) y se corrige con el RSSI actual; sin
+// mediciones se estima solo a partir del RSSI.
+//
+// El tamaño de un JPEG se modela como
+//     bytes ≈ complejidad × píxeles × 0.15 × 22 / (calidad + 10)
+// (~0.15 bytes/píxel en calidad 12 para una escena típica). La complejidad se
+// recalcula con el tamaño del cuadro anterior, así que la escena y la luz
+// actuales guían la calidad del siguiente.
+//
+// Sin dependencias de Arduino: se prueba y se simula en el host.
+
+struct JpegSettings {
+    framesize_t framesize;
+    int quality;                // 0-63, menor = mejor calidad
+};
+
+class JpegTuner {
+private:
+    unsigned long targetUploadMs;
+    int bestQuality;
+    int worstQuality;
+    int downshiftQuality;       // Por encima de esta calidad conviene bajar resolución
+    framesize_t minFramesize;
+    framesize_t maxFramesize;
+
+    float complexity;           // Escala del modelo de tamaño según la escena actual
+    float throughput;           // Bytes/ms medidos (0 = sin mediciones)
+    int throughputRssi;         // RSSI promedio durante las mediciones
+    int rssi;                   // Último RSSI reportado
+    JpegSettings current;
+
+public:
+    JpegTuner();
+
+    // Configuración
+    void setTargetUploadMs(unsigned long ms);
+    void setQualityRange(int best, int worst);
+    // Con min < max también se baja la resolución cuando la calidad no alcanza.
+    // max no debe superar la resolución de esp_camera_init(): el buffer del
+    // cuadro se reserva para ese tamaño.
+    void setFramesizeRange(framesize_t min, framesize_t max);
+    void setInitialSettings(const JpegSettings& settings);
+    void setBestQuality(int best);              // Mantiene la peor calidad
+    void setMaxFramesize(framesize_t max);      // Mantiene la mínima (si cabe)
+
+    // Realimentación
+    void reportRssi(int dbm);
+    void reportFrame(const JpegSettings& used, size_t jpegBytes);
+    void reportUpload(size_t wireBytes, unsigned long uploadMs);
+
+    // Ajustes para la siguiente captura
+    JpegSettings nextSettings();
+
+    size_t byteBudget() const;
+    float linkThroughput() const;   // Bytes/ms estimados con el RSSI actual
+    float sceneComplexity() const;
+
+    // Modelo de tamaño y capacidad del enlace (públicos para simulación y pruebas)
+    static size_t predictSize(framesize_t framesize, int quality, float complexity);
+    static float rssiThroughput(int dbm);
+};
+
+#endif // JPEGTUNER_H
@@ -1,28 +0,0 @@
-#ifndef BOARD_CONFIG_H
-#define BOARD_CONFIG_H
-
-// Board configuration for ESP32-S3-CAM with TY-OV2640
-// CAMERA_MODEL_ESP32S3_CAM is defined in platformio.ini
-
-#if defined(CAMERA_MODEL_ESP32S3_CAM)
-#define PWDN_GPIO_NUM     -1
-#define RESET_GPIO_NUM    -1
-#define XCLK_GPIO_NUM     15
-#define SIOD_GPIO_NUM     4
-#define SIOC_GPIO_NUM     5
-
-#define Y9_GPIO_NUM       16
-#define Y8_GPIO_NUM       17
-#define Y7_GPIO_NUM       18
-#define Y6_GPIO_NUM       12
-#define Y5_GPIO_NUM       10
-#define Y4_GPIO_NUM       8
-#define Y3_GPIO_NUM       9
-#define Y2_GPIO_NUM       11
-
-#define VSYNC_GPIO_NUM    6
-#define HREF_GPIO_NUM     7
-#define PCLK_GPIO_NUM     13
-#endif
-
-#endif // BOARD_CONFIG_H
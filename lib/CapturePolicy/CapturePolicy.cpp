@@ -0,0 +1,246 @@
+#include "CapturePolicy.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define RULE_TEXT_MAX 96
+#define MINUTES_PER_DAY 1440
+
+CapturePolicy::CapturePolicy() {
+    clear();
+}
+
+// Entero decimal seguido de uno de los caracteres de stops (o del fin del texto)
+static bool parseNumber(const char* text, const char* stops, long minValue, long maxValue, long& value,
+                        const char** rest) {
+    if (*text < '0' || *text > '9') return false;
+    char* end;
+    errno = 0;
+    value = strtol(text, &end, 10);
+    if (errno != 0 || value < minValue || value > maxValue) return false;
+    if (*end != '\0' && strchr(stops, *end) == NULL) return false;
+    *rest = end;
+    return true;
+}
+
+// "H" o "H:MM" → minuto del día; acepta 24 como fin del día
+static bool parseClock(const char* text, char stop, uint16_t& minute, const char** rest) {
+    long hours;
+    long minutes = 0;
+    const char stops[] = {':', stop, '\0'};
+    if (!parseNumber(text, stops, 0, 24, hours, &text)) {
+        return false;
+    }
+    if (*text == ':') {
+        const char minuteStops[] = {stop, '\0'};
+        if (!parseNumber(text + 1, minuteStops, 0, 59, minutes, &text)) return false;
+    }
+    if (*text != stop && *text != '\0') return false;
+    if (hours == 24 && minutes != 0) return false;
+    minute = (uint16_t)((hours * 60 + minutes) % MINUTES_PER_DAY);
+    *rest = text;
+    return true;
+}
+
+static bool parseTransitions(char* value, uint8_t& transitions) {
+    transitions = 0;
+    while (*value != '\0') {
+        char* comma = strchr(value, ',');
+        if (comma != NULL) *comma = '\0';
+        if (strcmp(value, "arrival") == 0) transitions |= CAPTURE_ON_ARRIVAL;
+        else if (strcmp(value, "departure") == 0) transitions |= CAPTURE_ON_DEPARTURE;
+        else return false;
+        if (comma == NULL) break;
+        value = comma + 1;
+    }
+    return transitions != 0;
+}
+
+bool CapturePolicy::parseRule(const char* text, CaptureRule& rule) {
+    if (text == NULL || strlen(text) >= RULE_TEXT_MAX) {
+        return false;
+    }
+    char buffer[RULE_TEXT_MAX];
+    strcpy(buffer, text);
+
+    CaptureRule parsed;
+    parsed.transitions = 0;
+    parsed.periodMs = 0;
+    parsed.maxPerHour = 0;
+    parsed.framesize = -1;
+    parsed.fromMinute = 0;
+    parsed.toMinute = 0;
+
+    char* cursor = buffer;
+    while (*cursor != '\0') {
+        while (*cursor == ' ') cursor++;
+        if (*cursor == '\0') break;
+        char* key = cursor;
+        while (*cursor != '\0' && *cursor != ' ') cursor++;
+        if (*cursor == ' ') *cursor++ = '\0';
+
+        char* value = strchr(key, '=');
+        if (value == NULL) return false;
+        *value++ = '\0';
+
+        long number;
+        const char* rest;
+        if (strcmp(key, "on") == 0) {
+            if (!parseTransitions(value, parsed.transitions)) return false;
+        } else if (strcmp(key, "every") == 0) {
+            if (!parseNumber(value, "", 10, 86400, number, &rest)) return false;
+            parsed.periodMs = (uint32_t)number * 1000;
+        } else if (strcmp(key, "max") == 0) {
+            if (!parseNumber(value, "", 1, CAPTURE_MAX_PER_HOUR, number, &rest)) return false;
+            parsed.maxPerHour = (uint8_t)number;
+        } else if (strcmp(key, "res") == 0) {
+            // Mismo rango que res= en CFG: FRAMESIZE_96X96 .. FRAMESIZE_UXGA
+            if (!parseNumber(value, "", 0, 13, number, &rest)) return false;
+            parsed.framesize = (int8_t)number;
+        } else if (strcmp(key, "hours") == 0) {
+            if (!parseClock(value, '-', parsed.fromMinute, &rest) || *rest != '-' ||
+                !parseClock(rest + 1, '\0', parsed.toMinute, &rest)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    // Una regla que nunca dispara es un error de escritura
+    if (parsed.transitions == 0 && parsed.periodMs == 0) {
+        return false;
+    }
+    rule = parsed;
+    return true;
+}
+
+bool CapturePolicy::addRule(const CaptureRule& rule) {
+    if (ruleCount >= CAPTURE_MAX_RULES || rule.maxPerHour > CAPTURE_MAX_PER_HOUR) {
+        return false;
+    }
+    rules[ruleCount] = rule;
+    memset(&state[ruleCount], 0, sizeof(RuleState));
+    ruleCount++;
+    return true;
+}
+
+bool CapturePolicy::addRule(const char* text) {
+    CaptureRule rule;
+    return parseRule(text, rule) && addRule(rule);
+}
+
+void CapturePolicy::clear() {
+    ruleCount = 0;
+    reset();
+}
+
+void CapturePolicy::reset() {
+    memset(state, 0, sizeof(state));
+    occupied = false;
+}
+
+bool CapturePolicy::inHours(const CaptureRule& rule, int minuteOfDay) const {
+    if (rule.fromMinute == rule.toMinute) {
+        return true;
+    }
+    if (minuteOfDay < 0) {
+        return false;
+    }
+    uint16_t minute = (uint16_t)minuteOfDay;
+    if (rule.fromMinute < rule.toMinute) {
+        return minute >= rule.fromMinute && minute < rule.toMinute;
+    }
+    return minute >= rule.fromMinute || minute < rule.toMinute;  // Cruza medianoche
+}
+
+bool CapturePolicy::underRate(uint8_t index, uint32_t nowMs) const {
+    const RuleState& rs = state[index];
+    uint8_t limit = rules[index].maxPerHour;
+    if (limit == 0 || rs.recentCount < limit) {
+        return true;
+    }
+    // La más antigua de las últimas 'limit' capturas ya salió de la ventana
+    uint8_t oldest = (uint8_t)((rs.recentHead + CAPTURE_MAX_PER_HOUR - limit) % CAPTURE_MAX_PER_HOUR);
+    return nowMs - rs.recent[oldest] >= CAPTURE_HOUR_MS;
+}
+
+bool CapturePolicy::tryFire(uint8_t index, uint32_t nowMs, int minuteOfDay) {
+    RuleState& rs = state[index];
+    if (!inHours(rules[index], minuteOfDay)) {
+        rs.stats.outsideHours++;
+        return false;
+    }
+    if (!underRate(index, nowMs)) {
+        rs.stats.rateLimited++;
+        return false;
+    }
+    rs.recent[rs.recentHead] = nowMs;
+    rs.recentHead = (uint8_t)((rs.recentHead + 1) % CAPTURE_MAX_PER_HOUR);
+    if (rs.recentCount < CAPTURE_MAX_PER_HOUR) {
+        rs.recentCount++;
+    }
+    rs.stats.fired++;
+    return true;
+}
+
+CaptureDecision CapturePolicy::decision(CaptureReason reason, int8_t index) const {
+    CaptureDecision result;
+    result.reason = reason;
+    result.rule = index;
+    result.framesize = index >= 0 ? rules[index].framesize : -1;
+    return result;
+}
+
+CaptureDecision CapturePolicy::update(bool nowOccupied, uint32_t nowMs, int minuteOfDay) {
+    CaptureDecision result = decision(CAPTURE_NONE, -1);
+
+    if (nowOccupied != occupied) {
+        occupied = nowOccupied;
+        uint8_t mask = occupied ? CAPTURE_ON_ARRIVAL : CAPTURE_ON_DEPARTURE;
+        for (uint8_t i = 0; i < ruleCount; i++) {
+            // Las periódicas cuentan desde la llegada
+            state[i].nextPeriodicMs = nowMs + rules[i].periodMs;
+            if (!result.fire() && (rules[i].transitions & mask) && tryFire(i, nowMs, minuteOfDay)) {
+                result = decision(occupied ? CAPTURE_ARRIVAL : CAPTURE_DEPARTURE, (int8_t)i);
+            }
+        }
+        return result;
+    }
+
+    if (!occupied) {
+        return result;
+    }
+    for (uint8_t i = 0; i < ruleCount; i++) {
+        RuleState& rs = state[i];
+        // Si ya disparó otra regla esta queda vencida para la próxima vuelta
+        if (rules[i].periodMs == 0 || (int32_t)(nowMs - rs.nextPeriodicMs) < 0 || result.fire()) {
+            continue;
+        }
+        // Fuera de horario o sin cupo se salta este período, sin acumular
+        rs.nextPeriodicMs = nowMs + rules[i].periodMs;
+        if (tryFire(i, nowMs, minuteOfDay)) {
+            result = decision(CAPTURE_PERIODIC, (int8_t)i);
+        }
+    }
+    return result;
+}
+
+bool CapturePolicy::nextWake(uint32_t& dueMs) const {
+    if (!occupied) {
+        return false;
+    }
+    bool found = false;
+    for (uint8_t i = 0; i < ruleCount; i++) {
+        if (rules[i].periodMs == 0) {
+            continue;
+        }
+        uint32_t due = state[i].nextPeriodicMs;
+        if (!found || (int32_t)(due - dueMs) < 0) {
+            dueMs = due;
+            found = true;
+        }
+    }
+    return found;
+}
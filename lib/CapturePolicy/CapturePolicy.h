@@ -0,0 +1,111 @@
+#ifndef CAPTUREPOLICY_H
+#define CAPTUREPOLICY_H
+
+#include <stdint.h>
+
+// Política declarativa de captura de imágenes: qué transiciones de ocupación
+// disparan una foto, capturas periódicas mientras el espacio sigue ocupado,
+// horario permitido, máximo por hora y resolución por regla.
+//
+// Cada regla se escribe como los campos de CFG (clave=valor separados por
+// espacios):
+//     "on=arrival"                          LIBRE → OCUPADO (lo de siempre)
+//     "on=arrival,departure hours=6-22"     llegada y salida, solo de día
+//     "every=900 max=3 res=5 hours=6:30-22" cada 15 min ocupado, máx. 3/h, QVGA
+//
+//   on=arrival|departure[,...]  transiciones que disparan
+//   every=<s>                   periódica mientras está ocupado (desde la llegada)
+//   max=<n>                     capturas por hora, ventana deslizante (1-CAPTURE_MAX_PER_HOUR)
+//   res=<framesize_t>           resolución máxima de la captura (por defecto la del ajuste)
+//   hours=H[:MM]-H[:MM]         horario local [inicio, fin); puede cruzar medianoche
+//
+// update() se llama en cada vuelta del loop con el estado de ocupación: solo
+// compara enteros, sin reservas de memoria ni acceso a cámara o red; la foto
+// se toma únicamente cuando una regla dispara. Sin dependencias de Arduino:
+// se prueba en el host y con trazas (trace_replay captures).
+
+#define CAPTURE_MAX_RULES 4
+#define CAPTURE_MAX_PER_HOUR 30
+#define CAPTURE_HOUR_MS 3600000UL
+
+// Transiciones (CaptureRule::transitions)
+#define CAPTURE_ON_ARRIVAL   0x01   // LIBRE → OCUPADO
+#define CAPTURE_ON_DEPARTURE 0x02   // OCUPADO → LIBRE
+
+enum CaptureReason : uint8_t {
+    CAPTURE_NONE = 0,
+    CAPTURE_ARRIVAL,
+    CAPTURE_DEPARTURE,
+    CAPTURE_PERIODIC
+};
+
+struct CaptureRule {
+    uint8_t transitions;        // CAPTURE_ON_*
+    uint32_t periodMs;          // 0 = sin captura periódica
+    uint8_t maxPerHour;         // 0 = sin límite
+    int8_t framesize;           // -1 = la que decida el JpegTuner
+    uint16_t fromMinute;        // Horario local en minutos del día;
+    uint16_t toMinute;          // from == to: todo el día
+};
+
+struct CaptureDecision {
+    CaptureReason reason;
+    int8_t rule;                // Índice de la regla que disparó (-1 = ninguna)
+    int8_t framesize;
+
+    bool fire() const { return reason != CAPTURE_NONE; }
+};
+
+struct CaptureRuleStats {
+    uint32_t fired;
+    uint32_t rateLimited;       // Coincidió pero ya llevaba max capturas en la hora
+    uint32_t outsideHours;      // Coincidió fuera de horario (o sin hora conocida)
+};
+
+class CapturePolicy {
+private:
+    struct RuleState {
+        uint32_t nextPeriodicMs;
+        uint32_t recent[CAPTURE_MAX_PER_HOUR];  // Anillo con las últimas capturas
+        uint8_t recentHead;
+        uint8_t recentCount;
+        CaptureRuleStats stats;
+    };
+
+    CaptureRule rules[CAPTURE_MAX_RULES];
+    RuleState state[CAPTURE_MAX_RULES];
+    uint8_t ruleCount;
+    bool occupied;
+
+    bool inHours(const CaptureRule& rule, int minuteOfDay) const;
+    bool underRate(uint8_t index, uint32_t nowMs) const;
+    bool tryFire(uint8_t index, uint32_t nowMs, int minuteOfDay);
+    CaptureDecision decision(CaptureReason reason, int8_t index) const;
+
+public:
+    CapturePolicy();
+
+    // Interpreta una regla en texto; false (y la regla sin cambios) si es inválida
+    static bool parseRule(const char* text, CaptureRule& rule);
+
+    bool addRule(const CaptureRule& rule);
+    bool addRule(const char* text);
+    void clear();
+    void reset();               // Olvida ocupación, horarios periódicos y límites
+
+    uint8_t getRuleCount() const { return ruleCount; }
+    const CaptureRule& getRule(uint8_t index) const { return rules[index]; }
+    const CaptureRuleStats& getStats(uint8_t index) const { return state[index].stats; }
+
+    // Evalúa el estado actual. minuteOfDay: hora local (0-1439) o -1 si
+    // todavía no se conoce; las reglas con horario no disparan sin hora.
+    // Como mucho una captura por llamada: si varias reglas coinciden dispara
+    // la primera y las demás no consumen su cupo.
+    CaptureDecision update(bool occupied, uint32_t nowMs, int minuteOfDay);
+
+    // Próxima captura periódica pendiente (para dormir hasta entonces o
+    // reproducir trazas); false si no hay ninguna programada
+    bool nextWake(uint32_t& dueMs) const;
+};
+
+#endif // CAPTUREPOLICY_H
@@ -0,0 +1,336 @@
+#include "CommandChannel.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+CommandParser::CommandParser() {
+    reset();
+}
+
+bool CommandParser::feed(char c) {
+    // La trama anterior ya fue entregada: empezar una nueva
+    if (ready) {
+        reset();
+    }
+
+    if (c == '\r') {
+        return false;
+    }
+
+    if (c == '\n') {
+        if (overflow || length == 0) {
+            // Trama vacía o demasiado larga: descartar y seguir
+            reset();
+            return false;
+        }
+        buffer[length] = '\0';
+        ready = true;
+        return true;
+    }
+
+    if (length >= CMD_MAX_FRAME) {
+        overflow = true;
+        return false;
+    }
+
+    buffer[length++] = c;
+    return false;
+}
+
+const char* CommandParser::frame() const {
+    return buffer;
+}
+
+void CommandParser::reset() {
+    length = 0;
+    overflow = false;
+    ready = false;
+    buffer[0] = '\0';
+}
+
+// Convierte un entero decimal completo; falla si sobran caracteres
+static bool parseLong(const char* text, long& value) {
+    if (*text == '\0') return false;
+    char* end;
+    errno = 0;
+    value = strtol(text, &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+static bool parseUnsigned(const char* text, uint32_t& value) {
+    if (*text < '0' || *text > '9') return false;
+    char* end;
+    errno = 0;
+    unsigned long number = strtoul(text, &end, 10);
+    if (errno != 0 || *end != '\0' || number > 0xFFFFFFFFUL) return false;
+    value = (uint32_t)number;
+    return true;
+}
+
+static bool parseFloat(const char* text, float& value) {
+    if (*text == '\0') return false;
+    char* end;
+    errno = 0;
+    value = strtof(text, &end);
+    return errno == 0 && *end == '\0';
+}
+
+static void setError(Command& out, CommandStatus status, const char* key) {
+    out.status = status;
+    strncpy(out.errorKey, key, sizeof(out.errorKey) - 1);
+    out.errorKey[sizeof(out.errorKey) - 1] = '\0';
+}
+
+// Interpreta un par clave=valor sobre la configuración en preparación
+static CommandStatus parseConfigPair(char* key, char* value, ConfigUpdate& cfg) {
+    long number;
+
+    if (strcmp(key, "threshold") == 0) {
+        float distance;
+        if (!parseFloat(value, distance)) return CMD_BAD_VALUE;
+        if (distance < 2.0f || distance > 400.0f) return CMD_OUT_OF_RANGE;
+        cfg.thresholdDistance = distance;
+        cfg.fields |= CFG_THRESHOLD;
+    } else if (strcmp(key, "id") == 0) {
+        if (!parseLong(value, number)) return CMD_BAD_VALUE;
+        if (number <= 0 || number > 65535) return CMD_OUT_OF_RANGE;
+        cfg.parkingId = (int)number;
+        cfg.fields |= CFG_PARKING_ID;
+    } else if (strcmp(key, "server") == 0) {
+        char* colon = strrchr(value, ':');
+        if (colon == NULL || colon == value) return CMD_BAD_VALUE;
+        *colon = '\0';
+        if (strlen(value) >= CMD_MAX_SERVER_IP) return CMD_OUT_OF_RANGE;
+        if (!parseLong(colon + 1, number)) return CMD_BAD_VALUE;
+        if (number <= 0 || number > 65535) return CMD_OUT_OF_RANGE;
+        strcpy(cfg.serverIP, value);
+        cfg.serverPort = (int)number;
+        cfg.fields |= CFG_SERVER;
+    } else if (strcmp(key, "interval") == 0) {
+        if (!parseLong(value, number)) return CMD_BAD_VALUE;
+        if (number < 100 || number > 3600000) return CMD_OUT_OF_RANGE;
+        cfg.measurementInterval = (unsigned long)number;
+        cfg.fields |= CFG_INTERVAL;
+    } else if (strcmp(key, "hb") == 0) {
+        if (!parseLong(value, number)) return CMD_BAD_VALUE;
+        if (number != 0 && (number < 1000 || number > 3600000)) return CMD_OUT_OF_RANGE;
+        cfg.heartbeatInterval = (unsigned long)number;
+        cfg.fields |= CFG_HEARTBEAT;
+    } else if (strcmp(key, "raw") == 0) {
+        if (!parseLong(value, number)) return CMD_BAD_VALUE;
+        if (number != 0 && (number < 1000 || number > 600000)) return CMD_OUT_OF_RANGE;
+        cfg.rawFlushInterval = (unsigned long)number;
+        cfg.fields |= CFG_RAW;
+    } else if (strcmp(key, "res") == 0) {
+        if (!parseLong(value, number)) return CMD_BAD_VALUE;
+        if (number < 0 || number > 13) return CMD_OUT_OF_RANGE; // FRAMESIZE_96X96 .. FRAMESIZE_UXGA
+        cfg.cameraResolution = (int)number;
+        cfg.fields |= CFG_RESOLUTION;
+    } else if (strcmp(key, "quality") == 0) {
+        if (!parseLong(value, number)) return CMD_BAD_VALUE;
+        if (number < 0 || number > 63) return CMD_OUT_OF_RANGE;
+        cfg.cameraQuality = (int)number;
+        cfg.fields |= CFG_QUALITY;
+    } else if (strcmp(key, "roi") == 0) {
+        if (strcmp(value, "off") == 0) {
+            memset(cfg.cameraRoi, 0, sizeof(cfg.cameraRoi));
+        } else {
+            // Cuatro enteros separados por coma, dentro del cuadro
+            char* saveptr;
+            char* part = strtok_r(value, ",", &saveptr);
+            for (int i = 0; i < 4; i++) {
+                if (part == NULL || !parseLong(part, number)) return CMD_BAD_VALUE;
+                if (number < 0 || number > 1000) return CMD_OUT_OF_RANGE;
+                cfg.cameraRoi[i] = (uint16_t)number;
+                part = strtok_r(NULL, ",", &saveptr);
+            }
+            if (part != NULL) return CMD_BAD_VALUE;
+            if (cfg.cameraRoi[2] == 0 || cfg.cameraRoi[3] == 0 ||
+                cfg.cameraRoi[0] + cfg.cameraRoi[2] > 1000 || cfg.cameraRoi[1] + cfg.cameraRoi[3] > 1000) {
+                return CMD_OUT_OF_RANGE;
+            }
+        }
+        cfg.fields |= CFG_ROI;
+    } else {
+        return CMD_UNKNOWN_KEY;
+    }
+
+    return CMD_OK;
+}
+
+// Identificador de parche: también es parte de un nombre de archivo en el servidor
+static bool parseOtaId(const char* text, char* id) {
+    size_t length = strlen(text);
+    if (length == 0 || length >= CMD_MAX_OTA_ID) return false;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                     c == '.' || c == '_' || c == '-';
+        if (!valid) return false;
+    }
+    strcpy(id, text);
+    return true;
+}
+
+// OTA <seq> id=<parche> size=<bytes>: ambos campos obligatorios
+static void parseOtaOffer(char** saveptr, Command& out) {
+    out.type = CMD_OTA;
+    char* pair;
+    while ((pair = strtok_r(NULL, " ", saveptr)) != NULL) {
+        char* equals = strchr(pair, '=');
+        if (equals == NULL) {
+            setError(out, CMD_BAD_VALUE, pair);
+            return;
+        }
+        *equals = '\0';
+        char* value = equals + 1;
+        if (strcmp(pair, "id") == 0) {
+            if (!parseOtaId(value, out.ota.id)) {
+                setError(out, CMD_BAD_VALUE, pair);
+                return;
+            }
+        } else if (strcmp(pair, "size") == 0) {
+            if (!parseUnsigned(value, out.ota.size)) {
+                setError(out, CMD_BAD_VALUE, pair);
+                return;
+            }
+            if (out.ota.size == 0 || out.ota.size > CMD_MAX_OTA_SIZE) {
+                setError(out, CMD_OUT_OF_RANGE, pair);
+                return;
+            }
+        } else {
+            setError(out, CMD_UNKNOWN_KEY, pair);
+            return;
+        }
+    }
+    if (out.ota.id[0] == '\0' || out.ota.size == 0) {
+        setError(out, CMD_BAD_FRAME, "OTA");
+        return;
+    }
+    out.status = CMD_OK;
+}
+
+// OTAD <offset> <longitud> <parche> (el offset ya se leyó como seq)
+static void parseOtaData(char** saveptr, Command& out) {
+    out.type = CMD_OTA_DATA;
+    out.ota.offset = out.seq;
+    char* lengthText = strtok_r(NULL, " ", saveptr);
+    char* idText = strtok_r(NULL, " ", saveptr);
+    if (lengthText == NULL || idText == NULL || strtok_r(NULL, " ", saveptr) != NULL ||
+        !parseUnsigned(lengthText, out.ota.length) || !parseOtaId(idText, out.ota.id)) {
+        setError(out, CMD_BAD_FRAME, "OTAD");
+        return;
+    }
+    if (out.ota.length == 0 || out.ota.length > CMD_MAX_OTA_CHUNK) {
+        setError(out, CMD_OUT_OF_RANGE, "OTAD");
+        return;
+    }
+    out.status = CMD_OK;
+}
+
+void parseCommand(const char* frame, Command& out) {
+    memset(&out, 0, sizeof(out));
+    out.type = CMD_NONE;
+    out.status = CMD_BAD_FRAME;
+
+    // Respuesta JSON del servidor a una imagen: basta con el estado
+    if (frame[0] == '{') {
+        out.type = CMD_IMAGE_ACK;
+        out.status = strstr(frame, "\"success\"") != NULL ? CMD_OK : CMD_REJECTED;
+        return;
+    }
+
+    // Copia local para poder separar tokens sin tocar el buffer del parser
+    char work[CMD_MAX_FRAME + 1];
+    strncpy(work, frame, CMD_MAX_FRAME);
+    work[CMD_MAX_FRAME] = '\0';
+
+    char* saveptr = NULL;
+    char* verb = strtok_r(work, " ", &saveptr);
+    char* seqText = strtok_r(NULL, " ", &saveptr);
+    if (verb == NULL || seqText == NULL) {
+        return;
+    }
+
+    if (!parseUnsigned(seqText, out.seq)) {
+        return;
+    }
+
+    if (strcmp(verb, "PING") == 0) {
+        out.type = CMD_PING;
+        out.status = CMD_OK;
+        return;
+    }
+
+    if (strcmp(verb, "EVT") == 0) {
+        out.type = CMD_EVENT_ACK;
+        out.status = CMD_OK;
+        return;
+    }
+
+    if (strcmp(verb, "PMK") == 0) {
+        out.type = CMD_POSTMORTEM_ACK;
+        out.status = CMD_OK;
+        return;
+    }
+
+    if (strcmp(verb, "GWK") == 0) {
+        out.type = CMD_GATEWAY_ACK;
+        out.status = CMD_OK;
+        return;
+    }
+
+    if (strcmp(verb, "OTA") == 0) {
+        parseOtaOffer(&saveptr, out);
+        return;
+    }
+
+    if (strcmp(verb, "OTAD") == 0) {
+        parseOtaData(&saveptr, out);
+        return;
+    }
+
+    if (strcmp(verb, "CFG") != 0) {
+        setError(out, CMD_BAD_FRAME, verb);
+        return;
+    }
+
+    out.type = CMD_CONFIG;
+    out.config.seq = out.seq;
+
+    char* pair;
+    while ((pair = strtok_r(NULL, " ", &saveptr)) != NULL) {
+        char* equals = strchr(pair, '=');
+        if (equals == NULL) {
+            setError(out, CMD_BAD_VALUE, pair);
+            return;
+        }
+        *equals = '\0';
+
+        CommandStatus status = parseConfigPair(pair, equals + 1, out.config);
+        if (status != CMD_OK) {
+            setError(out, status, pair);
+            return;
+        }
+    }
+
+    if (out.config.fields == 0) {
+        setError(out, CMD_BAD_FRAME, "CFG");
+        return;
+    }
+
+    out.status = CMD_OK;
+}
+
+const char* commandStatusName(CommandStatus status) {
+    switch (status) {
+        case CMD_OK:            return "ok";
+        case CMD_BAD_FRAME:     return "bad_frame";
+        case CMD_UNKNOWN_KEY:   return "unknown_key";
+        case CMD_BAD_VALUE:     return "bad_value";
+        case CMD_OUT_OF_RANGE:  return "out_of_range";
+        case CMD_REJECTED:      return "rejected";
+    }
+    return "unknown";
+}
@@ -0,0 +1,132 @@
+#ifndef COMMANDCHANNEL_H
+#define COMMANDCHANNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Canal de comandos servidor → ESP32 sobre la misma conexión TCP.
+//
+// Cada trama es una línea de texto terminada en '\n':
+//   CFG <seq> clave=valor [clave=valor ...]   → cambio de configuración
+//   PING <seq>                                → prueba de vida
+//   EVT <timestamp>                           → el servidor procesó el evento
+//                                               enviado en <timestamp> (sin respuesta)
+//   OTA <seq> id=<parche> size=<bytes>        → actualización de firmware disponible
+//   OTAD <offset> <longitud> <parche>         → trozo del parche: la línea va seguida
+//                                               de <longitud> bytes binarios (sin respuesta)
+//   PMK <seq>                                 → el servidor guardó el informe
+//                                               postmortem hasta <seq> (sin respuesta)
+//   GWK <lote>                                → el servidor procesó el lote <lote>
+//                                               de un gateway (sin respuesta)
+//   {"status": "success"|"error", ...}        → respuesta a una imagen (IMAGE:),
+//                                               sin respuesta
+//
+// El ESP32 responde cada trama con una línea JSON de confirmación:
+//   {"ack":<seq>,"parkingId":<id>,"status":"ok"}
+//   {"ack":<seq>,"parkingId":<id>,"status":"error","error":"<motivo>","key":"<clave>"}
+//
+// Este módulo no depende de Arduino para poder compilarse en el host.
+
+#define CMD_MAX_FRAME 256       // Longitud máxima de una trama (sin '\n')
+#define CMD_MAX_SERVER_IP 40    // Longitud máxima de la IP/host del servidor
+#define CMD_MAX_OTA_ID 48       // Longitud máxima del identificador de parche (con '\0')
+#define CMD_MAX_OTA_CHUNK 4096  // Bytes máximos de un trozo OTAD
+#define CMD_MAX_OTA_SIZE (8UL * 1024 * 1024)
+
+// Campos presentes en una actualización de configuración (máscara de bits)
+enum ConfigField {
+    CFG_THRESHOLD    = 1 << 0,  // threshold=<cm>
+    CFG_PARKING_ID   = 1 << 1,  // id=<entero>
+    CFG_SERVER       = 1 << 2,  // server=<ip>:<puerto>
+    CFG_INTERVAL     = 1 << 3,  // interval=<ms>
+    CFG_RESOLUTION   = 1 << 4,  // res=<framesize_t>
+    CFG_QUALITY      = 1 << 5,  // quality=<0-63>
+    CFG_HEARTBEAT    = 1 << 6,  // hb=<ms> (0 = sin heartbeat, 1000-3600000)
+    CFG_ROI          = 1 << 7,  // roi=<x>,<y>,<ancho>,<alto> en milésimas del cuadro, o roi=off
+    CFG_RAW          = 1 << 8,  // raw=<ms> plazo de los bloques crudos (0 = apagado, 1000-600000)
+};
+
+#define CFG_CAMERA_FIELDS (CFG_RESOLUTION | CFG_QUALITY)
+
+// Tipo de trama recibida
+enum CommandType {
+    CMD_NONE,
+    CMD_CONFIG,
+    CMD_PING,
+    CMD_EVENT_ACK,
+    CMD_IMAGE_ACK,      // status CMD_OK si el servidor guardó la imagen
+    CMD_OTA,            // Oferta de actualización (Command::ota)
+    CMD_OTA_DATA,       // Cabecera de un trozo del parche (Command::ota)
+    CMD_POSTMORTEM_ACK, // Informe postmortem guardado (seq del informe)
+    CMD_GATEWAY_ACK,    // Lote de un gateway procesado (seq = número de lote)
+};
+
+// Resultado de interpretar una trama
+enum CommandStatus {
+    CMD_OK,
+    CMD_BAD_FRAME,      // Formato de trama inválido
+    CMD_UNKNOWN_KEY,    // Clave desconocida
+    CMD_BAD_VALUE,      // Valor no numérico o mal formado
+    CMD_OUT_OF_RANGE,   // Valor fuera del rango permitido
+    CMD_REJECTED,       // El destinatario no pudo aplicar el cambio
+};
+
+// Actualización de configuración ya validada y con tipos
+struct ConfigUpdate {
+    uint32_t seq;
+    uint16_t fields;                    // Máscara de ConfigField
+    float thresholdDistance;
+    int parkingId;
+    char serverIP[CMD_MAX_SERVER_IP];
+    int serverPort;
+    unsigned long measurementInterval;
+    unsigned long heartbeatInterval;
+    unsigned long rawFlushInterval;
+    int cameraResolution;
+    int cameraQuality;
+    uint16_t cameraRoi[4];              // x, y, ancho, alto; ancho 0 = sin recorte
+};
+
+// Oferta OTA o cabecera de un trozo OTAD
+struct OtaFrame {
+    char id[CMD_MAX_OTA_ID];            // [A-Za-z0-9._-]
+    uint32_t size;                      // OTA: tamaño total del parche
+    uint32_t offset;                    // OTAD: posición y longitud del trozo
+    uint32_t length;
+};
+
+// Comando completo interpretado a partir de una trama
+struct Command {
+    CommandType type;
+    CommandStatus status;
+    uint32_t seq;
+    char errorKey[16];                  // Clave que causó el error (si aplica)
+    ConfigUpdate config;
+    OtaFrame ota;
+};
+
+// Acumula bytes del socket hasta completar una trama, sin bloquear
+class CommandParser {
+private:
+    char buffer[CMD_MAX_FRAME + 1];
+    size_t length;
+    bool overflow;                      // Trama actual demasiado larga: se descarta
+    bool ready;                         // Hay una trama completa sin consumir
+
+public:
+    CommandParser();
+
+    // Agrega un byte; retorna true cuando hay una trama completa en frame()
+    bool feed(char c);
+    const char* frame() const;
+    void reset();
+};
+
+// Interpreta una trama completa. Nunca aplica cambios parciales: si alguna
+// clave es inválida, el comando completo se marca con error.
+void parseCommand(const char* frame, Command& out);
+
+// Texto corto para el campo "error" de la confirmación
+const char* commandStatusName(CommandStatus status);
+
+#endif // COMMANDCHANNEL_H
@@ -11,7 +11,7 @@ ESP32Monitor::ESP32Monitor(unsigned long interval, bool enableSerial) {
 void ESP32Monitor::begin() {
     if (serialEnabled) {
         Serial.begin(115200);
-        delay(1000);
+        hal::delayMs(1000);
         
         Serial.println("\n=== INFORMACIÓN DEL ESP32-S3-CAM ===");
         
@@ -35,9 +35,10 @@ void ESP32Monitor::begin() {
         
         // Información adicional de memoria
         Serial.println("\n📊 MEMORIA DETALLADA:");
-        Serial.println("  Total Heap: " + String(heap_caps_get_total_size(MALLOC_CAP_DEFAULT)) + " bytes");
-        Serial.println("  Free Heap: " + String(heap_caps_get_free_size(MALLOC_CAP_DEFAULT)) + " bytes");
-        Serial.println("  Largest Free Block: " + String(heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT)) + " bytes");
+        hal::MemoryStats memory = hal::memoryStats();
+        Serial.println("  Total Heap: " + String(memory.totalHeap) + " bytes");
+        Serial.println("  Free Heap: " + String(memory.freeHeap) + " bytes");
+        Serial.println("  Largest Free Block: " + String(memory.largestFreeBlock) + " bytes");
         
         // Información de tiempo
         Serial.println("\n⏰ TIEMPO:");
@@ -59,8 +60,8 @@ void ESP32Monitor::begin() {
 
 // Actualización periódica
 void ESP32Monitor::update() {
-    if (serialEnabled && (millis() - lastUpdate > updateInterval)) {
-        lastUpdate = millis();
+    if (serialEnabled && (hal::millis() - lastUpdate > updateInterval)) {
+        lastUpdate = hal::millis();
         printStatus();
     }
 }
@@ -103,43 +104,43 @@ void ESP32Monitor::printStatus() {
 
 // Getters para información del sistema
 String ESP32Monitor::getChipModel() {
-    return String(ESP.getChipModel());
+    return String(hal::chipModel());
 }
 
 String ESP32Monitor::getChipRevision() {
-    return String(ESP.getChipRevision());
+    return String(hal::chipRevision());
 }
 
 uint32_t ESP32Monitor::getCpuFreq() {
-    return ESP.getCpuFreqMHz();
+    return hal::cpuFreqMHz();
 }
 
 uint32_t ESP32Monitor::getFlashSize() {
-    return ESP.getFlashChipSize() / 1024 / 1024;
+    return hal::flashSize() / 1024 / 1024;
 }
 
 uint32_t ESP32Monitor::getFlashSpeed() {
-    return ESP.getFlashChipSpeed() / 1000000;
+    return hal::flashSpeed() / 1000000;
 }
 
 uint32_t ESP32Monitor::getFreeHeap() {
-    return ESP.getFreeHeap();
+    return hal::freeHeap();
 }
 
 uint32_t ESP32Monitor::getFreePSRAM() {
-    return heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    return hal::memoryStats().freePsram;
 }
 
 uint32_t ESP32Monitor::getTotalPSRAM() {
-    return heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    return hal::memoryStats().totalPsram;
 }
 
 bool ESP32Monitor::isPSRAMFound() {
-    return psramFound();
+    return hal::psramFound();
 }
 
 unsigned long ESP32Monitor::getUptime() {
-    return millis() / 1000;
+    return hal::millis() / 1000;
 }
 
 // Configuración
@@ -1,9 +1,7 @@
 #ifndef ESP32MONITOR_H
 #define ESP32MONITOR_H
 
-#include <Arduino.h>
-#include <esp_system.h>
-#include <esp_heap_caps.h>
+#include "Hal.h"
 #include "CameraManager.h"
 
 class ESP32Monitor {
@@ -0,0 +1,151 @@
+#include "EventTrace.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+uint32_t civilToEpoch(int year, int month, int day, int hour, int minute, int second) {
+    // Días desde 1970-01-01 (algoritmo de Howard Hinnant, calendario gregoriano)
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yearOfEra = year - era * 400;
+    long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    long days = era * 146097 + dayOfEra - 719468;
+    return (uint32_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+// Dígitos fijos sin sscanf: la conversión procesa millones de líneas
+static bool parseDigits(const char* p, int count, int& value) {
+    value = 0;
+    for (int i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (p[i] - '0');
+    }
+    return true;
+}
+
+// Valor que sigue a "clave": en el JSON (acepta espacios tras los dos puntos)
+static const char* findValue(const char* json, const char* key) {
+    const char* p = strstr(json, key);
+    if (p == NULL) {
+        return NULL;
+    }
+    p += strlen(key);
+    while (*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+bool parseLogLine(const char* line, TraceRecord& out) {
+    // 2025-09-05 11:39:26 | ('192.168.1.21', 58180) | {"parkingId": 1, ...}
+    int year, month, day, hour, minute, second;
+    if (!parseDigits(line, 4, year) || line[4] != '-' || !parseDigits(line + 5, 2, month) ||
+        line[7] != '-' || !parseDigits(line + 8, 2, day) || line[10] != ' ' ||
+        !parseDigits(line + 11, 2, hour) || line[13] != ':' || !parseDigits(line + 14, 2, minute) ||
+        line[16] != ':' || !parseDigits(line + 17, 2, second)) {
+        return false;
+    }
+    
+    const char* json = strstr(line + 19, "| {");
+    if (json == NULL) {
+        return false;
+    }
+    json += 2;
+    
+    const char* parkingId = findValue(json, "\"parkingId\":");
+    const char* occupied = findValue(json, "\"occupied\":");
+    const char* distance = findValue(json, "\"distance\":");
+    const char* timestamp = findValue(json, "\"timestamp\":");
+    if (parkingId == NULL || occupied == NULL || distance == NULL || timestamp == NULL) {
+        return false;
+    }
+    
+    char* end;
+    long id = strtol(parkingId, &end, 10);
+    if (end == parkingId || id < 0 || id > 0xFFFF) {
+        return false;
+    }
+    double cm = strtod(distance, &end);
+    if (end == distance || cm < 0) {
+        return false;
+    }
+    unsigned long deviceMs = strtoul(timestamp, &end, 10);
+    if (end == timestamp) {
+        return false;
+    }
+    
+    memset(&out, 0, sizeof(out));
+    out.wall = civilToEpoch(year, month, day, hour, minute, second);
+    out.deviceMs = (uint32_t)deviceMs;
+    out.parkingId = (uint16_t)id;
+    double dm = cm * 10.0 + 0.5;
+    out.distanceDm = dm > 0xFFFF ? 0xFFFF : (uint16_t)dm;
+    out.flags = *occupied == 't' ? TRACE_OCCUPIED : 0;
+    return true;
+}
+
+bool writeTraceHeader(FILE* f, uint64_t count) {
+    uint8_t header[16];
+    uint32_t version = TRACE_VERSION;
+    memcpy(header, TRACE_MAGIC, 4);
+    memcpy(header + 4, &version, 4);
+    memcpy(header + 8, &count, 8);
+    return fwrite(header, 1, sizeof(header), f) == sizeof(header);
+}
+
+bool readTraceHeader(FILE* f, uint64_t& count) {
+    uint8_t header[16];
+    uint32_t version;
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, TRACE_MAGIC, 4) != 0) {
+        return false;
+    }
+    memcpy(&version, header + 4, 4);
+    memcpy(&count, header + 8, 8);
+    return version == TRACE_VERSION;
+}
+
+long convertLog(const char* logPath, const char* tracePath, unsigned long* skipped) {
+    FILE* in = fopen(logPath, "r");
+    if (in == NULL) {
+        return -1;
+    }
+    FILE* out = fopen(tracePath, "wb");
+    if (out == NULL) {
+        fclose(in);
+        return -1;
+    }
+    
+    // La cantidad se completa al final
+    writeTraceHeader(out, 0);
+    
+    // Registros en bloques para no hacer una escritura por línea
+    static TraceRecord block[4096];
+    size_t pending = 0;
+    uint64_t count = 0;
+    unsigned long ignored = 0;
+    char line[4096];
+    bool ok = true;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (!parseLogLine(line, block[pending])) {
+            ignored++;
+            continue;
+        }
+        count++;
+        if (++pending == sizeof(block) / sizeof(block[0])) {
+            ok = ok && fwrite(block, sizeof(TraceRecord), pending, out) == pending;
+            pending = 0;
+        }
+    }
+    ok = ok && fwrite(block, sizeof(TraceRecord), pending, out) == pending;
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && writeTraceHeader(out, count);
+    
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    if (skipped != NULL) {
+        *skipped = ignored;
+    }
+    return ok ? (long)count : -1;
+}
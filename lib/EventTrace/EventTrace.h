@@ -0,0 +1,50 @@
+#ifndef EVENTTRACE_H
+#define EVENTTRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Traza binaria compacta de eventos de ocupación, convertida desde
+// parking_sensor.log (una línea "fecha | (ip, puerto) | json" por evento)
+// para reproducirla a alta velocidad (ver src/native/trace_replay.cpp y
+// trace_replay.py).
+//
+// Archivo: cabecera de 16 bytes y registros de 16 bytes, little-endian.
+//     cabecera: "PKTR", versión (u32), cantidad de registros (u64)
+//     registro: ver TraceRecord
+//
+// Sin dependencias de Arduino: se prueba en el host.
+
+#define TRACE_MAGIC "PKTR"
+#define TRACE_VERSION 1
+#define TRACE_OCCUPIED 0x01
+
+struct TraceRecord {
+    uint32_t wall;          // Hora del servidor en s (fecha del log tomada como UTC)
+    uint32_t deviceMs;      // timestamp del dispositivo (ms desde su arranque)
+    uint16_t parkingId;
+    uint16_t distanceDm;    // Distancia en décimas de cm
+    uint8_t flags;          // TRACE_OCCUPIED
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord debe ocupar 16 bytes");
+
+inline bool traceOccupied(const TraceRecord& record) { return (record.flags & TRACE_OCCUPIED) != 0; }
+inline float traceDistance(const TraceRecord& record) { return record.distanceDm / 10.0f; }
+
+// Segundos desde 1970 para una fecha y hora civil (UTC)
+uint32_t civilToEpoch(int year, int month, int day, int hour, int minute, int second);
+
+// Interpreta una línea del log; false si no es un evento del sensor
+bool parseLogLine(const char* line, TraceRecord& out);
+
+// Escribe o valida la cabecera; readTraceHeader deja el archivo en el primer registro
+bool writeTraceHeader(FILE* f, uint64_t count);
+bool readTraceHeader(FILE* f, uint64_t& count);
+
+// Convierte un log completo; retorna los registros escritos (skipped: líneas ignoradas)
+long convertLog(const char* logPath, const char* tracePath, unsigned long* skipped);
+
+#endif // EVENTTRACE_H
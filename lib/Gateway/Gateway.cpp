@@ -0,0 +1,281 @@
+#include "Gateway.h"
+
+Gateway::Gateway(int gatewayId, const char* serverIP, int serverPort) {
+    this->gatewayId = gatewayId;
+    strncpy(this->serverIP, serverIP, CMD_MAX_SERVER_IP - 1);
+    this->serverIP[CMD_MAX_SERVER_IP - 1] = '\0';
+    this->serverPort = serverPort;
+    this->epoch = 0;
+
+    this->client = &tcpClient;
+    this->connected = false;
+    this->lastConnectAttempt = 0;
+    this->reconnectInterval = 5000;
+    this->leafHeartbeat = 0;
+    this->batchWindow = GW_BATCH_WINDOW_MS;
+
+    this->link = NULL;
+    this->head = 0;
+    this->count = 0;
+    this->inflight = 0;
+    this->batchSeq = 0;
+    this->batchSentAt = 0;
+    this->ackHandler = NULL;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void Gateway::begin() {
+    // Cada arranque numera sus lotes desde 1: el epoch los distingue de los anteriores
+    epoch = hal::random32();
+    Serial.println("=== INICIALIZANDO GATEWAY ===");
+    Serial.printf("ID de gateway: %d\n", gatewayId);
+    Serial.printf("Servidor TCP: %s:%d\n", serverIP, serverPort);
+    Serial.printf("Lotes de hasta %d tramas cada %lu ms\n", GW_BATCH_FRAMES, batchWindow);
+    Serial.println("=============================================");
+}
+
+void Gateway::update() {
+    unsigned long now = hal::millis();
+
+    if (link != NULL) {
+        drainLink();
+    }
+
+    if (!connected && (stats.connectAttempts == 0 || now - lastConnectAttempt >= reconnectInterval)) {
+        lastConnectAttempt = now;
+        connectToServer();
+    }
+    if (!connected) {
+        return;
+    }
+
+    pollUpstream();
+    if (!connected) {
+        return;
+    }
+
+    if (inflight > 0) {
+        // Sin confirmación: la conexión está muerta aunque el socket no lo
+        // sepa. millis() de nuevo: el reenvío al reconectar es posterior a now
+        if (hal::millis() - batchSentAt >= GW_ACK_TIMEOUT_MS) {
+            client->stop();
+            connectionLost("⚠️ Gateway: lote sin confirmar, reconectando");
+        }
+        return;
+    }
+
+    if (count > 0 && (count >= GW_BATCH_FRAMES ||
+                      hal::micros() - queue[head].receivedUs >= batchWindow * 1000UL)) {
+        batchSeq++;
+        sendBatch();
+    }
+}
+
+void Gateway::drainLink() {
+    uint8_t buffer[LINK_MAX_FRAME];
+    for (int i = 0; i < GW_LINK_BUDGET; i++) {
+        size_t length = link->receive(buffer, sizeof(buffer));
+        if (length == 0) {
+            break;
+        }
+        submit(buffer, length);
+    }
+}
+
+bool Gateway::submit(const uint8_t* data, size_t length) {
+    GatewayFrame frame;
+    if (!decodeGatewayFrame(data, length, frame)) {
+        stats.invalid++;
+        return false;
+    }
+    if (isDuplicate(frame)) {
+        stats.duplicates++;
+        return false;
+    }
+    stats.received++;
+    enqueue(frame);
+    return true;
+}
+
+bool Gateway::isDuplicate(const GatewayFrame& frame) {
+    for (uint16_t i = 0; i < stats.leaves; i++) {
+        LeafState& leaf = leaves[i];
+        if (leaf.parkingId != frame.parkingId) {
+            continue;
+        }
+        // Otro epoch: la hoja se reinició y su seq volvió a empezar
+        if (leaf.epoch == frame.epoch && frame.seq <= leaf.lastSeq) {
+            return true;
+        }
+        leaf.epoch = frame.epoch;
+        leaf.lastSeq = frame.seq;
+        return false;
+    }
+    if (stats.leaves < GW_MAX_LEAVES) {
+        LeafState& leaf = leaves[stats.leaves++];
+        leaf.parkingId = frame.parkingId;
+        leaf.epoch = frame.epoch;
+        leaf.lastSeq = frame.seq;
+    }
+    return false;
+}
+
+void Gateway::enqueue(const GatewayFrame& frame) {
+    if (count == GW_QUEUE_FRAMES) {
+        // Se pierde la más vieja que no está en el lote sin confirmar: el
+        // lote se corre un lugar para ocupar su hueco
+        for (uint16_t i = inflight; i > 0; i--) {
+            queue[(head + i) % GW_QUEUE_FRAMES] = queue[(head + i - 1) % GW_QUEUE_FRAMES];
+        }
+        head = (head + 1) % GW_QUEUE_FRAMES;
+        count--;
+        stats.dropped++;
+    }
+    QueuedFrame& slot = queue[(head + count) % GW_QUEUE_FRAMES];
+    slot.frame = frame;
+    slot.receivedUs = hal::micros();
+    count++;
+    stats.queued = count;
+}
+
+bool Gateway::connectToServer() {
+    Serial.printf("Gateway: conectando a %s:%d...\n", serverIP, serverPort);
+    stats.connectAttempts++;
+
+    if (!client->connect(serverIP, serverPort)) {
+        Serial.println("❌ Gateway: error al conectar al servidor TCP");
+        return false;
+    }
+    connected = true;
+    commandParser.reset();
+
+    char hello[96];
+    int length = snprintf(hello, sizeof(hello), "{\"hello\":true,\"gateway\":%d", gatewayId);
+    if (leafHeartbeat > 0) {
+        length += snprintf(hello + length, sizeof(hello) - length, ",\"hb\":%lu", leafHeartbeat);
+    }
+    snprintf(hello + length, sizeof(hello) - length, "}");
+    client->println(hello);
+    Serial.printf("✅ Gateway conectado (%u tramas en cola)\n", (unsigned)count);
+
+    // El lote pendiente pudo llegar sin que llegara su GWK: mismo número
+    if (inflight > 0) {
+        stats.batchesResent++;
+        sendBatch();
+    }
+    return connected;
+}
+
+void Gateway::connectionLost(const char* message) {
+    connected = false;
+    Serial.println(message);
+}
+
+void Gateway::pollUpstream() {
+    if (!client->connected()) {
+        connectionLost("⚠️ Gateway: conexión TCP perdida");
+        return;
+    }
+    int budget = GW_READ_BUDGET;
+    while (budget-- > 0 && client->available() > 0) {
+        int c = client->read();
+        if (c < 0) {
+            break;
+        }
+        if (!commandParser.feed((char)c)) {
+            continue;
+        }
+        Command command;
+        parseCommand(commandParser.frame(), command);
+        if (command.type == CMD_GATEWAY_ACK) {
+            acknowledge(command.seq);
+        }
+    }
+}
+
+void Gateway::acknowledge(uint32_t seq) {
+    if (inflight == 0 || seq != batchSeq) {
+        return;
+    }
+    unsigned long now = hal::micros();
+    for (uint16_t i = 0; i < inflight; i++) {
+        const QueuedFrame& queued = queue[(head + i) % GW_QUEUE_FRAMES];
+        if (ackHandler != NULL) {
+            ackHandler(queued.frame.type, now - queued.receivedUs);
+        }
+    }
+    head = (head + inflight) % GW_QUEUE_FRAMES;
+    count -= inflight;
+    stats.forwarded += inflight;
+    stats.batchesAcked++;
+    stats.queued = count;
+    inflight = 0;
+}
+
+size_t Gateway::buildBatch(uint16_t frames, char* buffer, size_t size) const {
+    if (frames > count) {
+        frames = count;
+    }
+    if (size < GW_BATCH_BYTES || frames > GW_BATCH_FRAMES) {
+        return 0;
+    }
+    int length = snprintf(buffer, size, "{\"gateway\":%d,\"epoch\":%lu,\"batch\":%lu,\"frames\":[",
+                          gatewayId, (unsigned long)epoch, (unsigned long)batchSeq);
+    for (uint16_t i = 0; i < frames; i++) {
+        const GatewayFrame& f = queue[(head + i) % GW_QUEUE_FRAMES].frame;
+        // Distancia con un decimal sin pasar por float
+        length += snprintf(buffer + length, size - length, "%s[%u,%lu,%u,%d,%u.%u,%lu,%lu,%lu,%u]",
+                           i > 0 ? "," : "", (unsigned)f.parkingId, (unsigned long)f.seq,
+                           (unsigned)f.type, f.occupied ? 1 : 0,
+                           (unsigned)(f.distanceDm / 10), (unsigned)(f.distanceDm % 10),
+                           (unsigned long)f.leafMs, (unsigned long)f.validMeasurements,
+                           (unsigned long)f.failedMeasurements, (unsigned)f.health);
+    }
+    length += snprintf(buffer + length, size - length, "]}\r\n");
+    return (size_t)length;
+}
+
+void Gateway::sendBatch() {
+    uint16_t frames = inflight > 0 ? inflight : (count < GW_BATCH_FRAMES ? count : GW_BATCH_FRAMES);
+    size_t length = buildBatch(frames, batchLine, sizeof(batchLine));
+    inflight = frames;
+    batchSentAt = hal::millis();
+    stats.batchesSent++;
+
+    if (client->write((const uint8_t*)batchLine, length) != length || !client->connected()) {
+        client->stop();
+        connectionLost("⚠️ Gateway: conexión TCP perdida enviando un lote");
+    }
+}
+
+void Gateway::setLink(hal::LocalLink* localLink) {
+    link = localLink;
+}
+
+void Gateway::setTransport(hal::NetClient* transport) {
+    if (connected) {
+        client->stop();
+        connected = false;
+    }
+    client = transport != NULL ? transport : &tcpClient;
+}
+
+void Gateway::setLeafHeartbeat(unsigned long intervalMs) {
+    leafHeartbeat = intervalMs;
+}
+
+void Gateway::setBatchWindow(unsigned long windowMs) {
+    batchWindow = windowMs;
+}
+
+void Gateway::setAckHandler(void (*handler)(uint8_t type, unsigned long latencyUs)) {
+    ackHandler = handler;
+}
+
+bool Gateway::isConnected() const {
+    return connected;
+}
+
+const GatewayStats& Gateway::getStats() const {
+    return stats;
+}
@@ -0,0 +1,141 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include "Hal.h"
+#include "HalLink.h"
+#include "HalSocket.h"
+#include "CommandChannel.h"
+#include "GatewayFrame.h"
+
+// Modo gateway: una placa reenvía al servidor lo de muchas hojas por una sola
+// conexión TCP.
+//
+// Sin gateway cada ParkingSensor se asocia al punto de acceso y mantiene su
+// propia conexión con el servidor. En modo hoja (ParkingSensor::
+// setFrameSender) el sensor solo envía tramas de 24 bytes (GatewayFrame.h)
+// por el enlace local (hal::LocalLink: ESP-NOW en la placa, UDP en el host).
+// El gateway:
+//   - descarta las repetidas (reintentos de ESP-NOW cuya confirmación se
+//     perdió) con el epoch y el seq de cada hoja
+//   - las encola (GW_QUEUE_FRAMES; llena, se pierden las más viejas y el
+//     servidor ve el hueco en el seq)
+//   - las envía en lotes de hasta GW_BATCH_FRAMES, una línea JSON por lote,
+//     cuando el lote se llena o la trama más vieja esperó batchWindow ms:
+//       {"gateway":<id>,"epoch":<e>,"batch":<n>,"frames":[[parkingId,seq,tipo,
+//        ocupado,distancia,ms,válidas,fallidas,salud],...]}
+//   - espera "GWK <n>" antes del lote siguiente; si la conexión se corta o la
+//     confirmación no llega en GW_ACK_TIMEOUT_MS, reconecta y reenvía el mismo
+//     lote (el servidor reconoce el número y no lo aplica dos veces)
+//
+// Las tramas no llevan comandos de vuelta: CFG y OTA siguen requiriendo la
+// conexión directa.
+//
+// Sin dependencias de Arduino más allá de la HAL: se prueba en el host.
+
+#define GW_QUEUE_FRAMES 256
+#define GW_BATCH_FRAMES 48
+#define GW_BATCH_WINDOW_MS 100
+#define GW_ACK_TIMEOUT_MS 5000
+#define GW_MAX_LEAVES 256           // Hojas con deduplicación; las demás pasan sin ella
+#define GW_LINK_BUDGET 64           // Tramas leídas del enlace por update()
+#define GW_READ_BUDGET 64           // Bytes leídos del servidor por update() (solo GWK)
+#define GW_BATCH_BYTES (GW_BATCH_FRAMES * 72 + 96)
+
+struct GatewayStats {
+    uint32_t received;          // Tramas válidas de las hojas (enlace y submit())
+    uint32_t invalid;           // Lo recibido que no es una trama de hoja
+    uint32_t duplicates;
+    uint32_t dropped;           // Descartadas con la cola llena
+    uint32_t forwarded;         // Confirmadas por el servidor
+    uint32_t batchesSent;       // Incluye reenvíos
+    uint32_t batchesAcked;
+    uint32_t batchesResent;
+    uint32_t connectAttempts;
+    uint16_t leaves;            // Hojas distintas vistas
+    uint16_t queued;            // En cola, incluido el lote sin confirmar
+};
+
+class Gateway {
+private:
+    struct QueuedFrame {
+        GatewayFrame frame;
+        unsigned long receivedUs;   // Para la latencia hasta la confirmación
+    };
+
+    struct LeafState {
+        uint16_t parkingId;
+        uint16_t epoch;
+        uint32_t lastSeq;
+    };
+
+    int gatewayId;
+    uint32_t epoch;             // Aleatorio por arranque: el servidor reconoce los reenvíos
+    char serverIP[CMD_MAX_SERVER_IP];
+    int serverPort;
+    hal::TcpClient tcpClient;
+    hal::NetClient* client;
+    bool connected;
+    unsigned long lastConnectAttempt;
+    unsigned long reconnectInterval;
+    unsigned long leafHeartbeat;    // Intervalo de las hojas, anunciado en el hello
+    unsigned long batchWindow;
+
+    hal::LocalLink* link;
+    CommandParser commandParser;
+
+    // Cola circular; las primeras `inflight` tramas forman el lote sin confirmar
+    QueuedFrame queue[GW_QUEUE_FRAMES];
+    uint16_t head;
+    uint16_t count;
+    uint16_t inflight;
+    uint32_t batchSeq;
+    unsigned long batchSentAt;
+
+    LeafState leaves[GW_MAX_LEAVES];
+    char batchLine[GW_BATCH_BYTES];
+    GatewayStats stats;
+    void (*ackHandler)(uint8_t type, unsigned long latencyUs);
+
+    bool isDuplicate(const GatewayFrame& frame);
+    void enqueue(const GatewayFrame& frame);
+    void drainLink();
+    bool connectToServer();
+    void connectionLost(const char* message);
+    void pollUpstream();
+    void sendBatch();
+    void acknowledge(uint32_t seq);
+
+public:
+    Gateway(int gatewayId, const char* serverIP, int serverPort);
+
+    void begin();
+    void update();
+
+    // Tramas de las hojas; sin enlace solo llegan por submit()
+    void setLink(hal::LocalLink* localLink);
+
+    // Una trama codificada (encodeGatewayFrame), p. ej. del sensor de la
+    // propia placa. false si no es válida o es repetida.
+    bool submit(const uint8_t* data, size_t length);
+
+    // Transporte alternativo (p. ej. hal::TlsClient); NULL vuelve a TCP plano
+    void setTransport(hal::NetClient* transport);
+
+    // Intervalo de heartbeat de las hojas: el servidor marca stale a las que
+    // dejan de reportar (0 = sin heartbeat)
+    void setLeafHeartbeat(unsigned long intervalMs);
+
+    // Espera máxima de una trama antes de enviar un lote incompleto
+    void setBatchWindow(unsigned long windowMs);
+
+    // Se llama por cada trama confirmada con su tipo y los µs desde que llegó
+    void setAckHandler(void (*handler)(uint8_t type, unsigned long latencyUs));
+
+    bool isConnected() const;
+    const GatewayStats& getStats() const;
+
+    // Línea del lote con las primeras `frames` tramas en cola (para los benchmarks)
+    size_t buildBatch(uint16_t frames, char* buffer, size_t size) const;
+};
+
+#endif // GATEWAY_H
@@ -0,0 +1,55 @@
+#include "GatewayFrame.h"
+
+static void put16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    put16(p, (uint16_t)value);
+    put16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+size_t encodeGatewayFrame(const GatewayFrame& frame, uint8_t* out) {
+    out[0] = GW_FRAME_MAGIC;
+    out[1] = (uint8_t)((frame.type & GW_FRAME_TYPE_MASK) |
+                       ((frame.health << GW_FRAME_HEALTH_SHIFT) & GW_FRAME_HEALTH_MASK) |
+                       (frame.occupied ? GW_FRAME_OCCUPIED : 0));
+    put16(out + 2, frame.parkingId);
+    put16(out + 4, frame.epoch);
+    put16(out + 6, frame.distanceDm);
+    put32(out + 8, frame.seq);
+    put32(out + 12, frame.leafMs);
+    put32(out + 16, frame.validMeasurements);
+    put32(out + 20, frame.failedMeasurements);
+    return GW_FRAME_SIZE;
+}
+
+bool decodeGatewayFrame(const uint8_t* data, size_t length, GatewayFrame& out) {
+    if (length != GW_FRAME_SIZE || data[0] != GW_FRAME_MAGIC) {
+        return false;
+    }
+    uint8_t type = data[1] & GW_FRAME_TYPE_MASK;
+    if (type != GW_FRAME_EVENT && type != GW_FRAME_HEARTBEAT) {
+        return false;
+    }
+    out.type = type;
+    out.occupied = (data[1] & GW_FRAME_OCCUPIED) != 0;
+    out.health = (uint8_t)((data[1] & GW_FRAME_HEALTH_MASK) >> GW_FRAME_HEALTH_SHIFT);
+    out.parkingId = get16(data + 2);
+    out.epoch = get16(data + 4);
+    out.distanceDm = get16(data + 6);
+    out.seq = get32(data + 8);
+    out.leafMs = get32(data + 12);
+    out.validMeasurements = get32(data + 16);
+    out.failedMeasurements = get32(data + 20);
+    return true;
+}
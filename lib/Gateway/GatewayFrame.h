@@ -0,0 +1,54 @@
+#ifndef GATEWAYFRAME_H
+#define GATEWAYFRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Trama de una hoja al gateway (ver Gateway.h): el evento o heartbeat de
+// ParkingSensor en 24 bytes little-endian, en lugar de la línea JSON.
+//
+//     0  magic 'L'            8  seq (u32)
+//     1  tipo | salud<<4     12  ms de la hoja (u32)
+//          | ocupado<<7
+//     2  parkingId (u16)     16  mediciones válidas (u32)
+//     4  epoch (u16)         20  mediciones fallidas (u32)
+//     6  distancia (u16, décimas de cm)
+//
+// epoch es aleatorio en cada arranque de la hoja: el gateway descarta las
+// tramas repetidas (seq ya visto con el mismo epoch) sin confundir un
+// reinicio con una repetición. La salud es el SensorHealthState de la hoja
+// (lib/ParkingSensor/SensorHealth.h); 0 en hojas sin ella.
+//
+// Sin dependencias de Arduino: se prueba en el host.
+
+#define GW_FRAME_MAGIC 0x4C
+#define GW_FRAME_SIZE 24
+#define GW_FRAME_OCCUPIED 0x80
+#define GW_FRAME_TYPE_MASK 0x0F
+#define GW_FRAME_HEALTH_SHIFT 4
+#define GW_FRAME_HEALTH_MASK 0x70
+
+enum GatewayFrameType : uint8_t {
+    GW_FRAME_EVENT = 1,         // Cambio de estado (o primera medición)
+    GW_FRAME_HEARTBEAT = 2,
+};
+
+struct GatewayFrame {
+    uint16_t parkingId;
+    uint16_t epoch;
+    uint8_t type;               // GatewayFrameType
+    bool occupied;
+    uint8_t health;             // SensorHealthState, 0-7
+    uint16_t distanceDm;
+    uint32_t seq;
+    uint32_t leafMs;            // hal::millis() de la hoja: timestamp del evento
+    uint32_t validMeasurements;
+    uint32_t failedMeasurements;
+};
+
+size_t encodeGatewayFrame(const GatewayFrame& frame, uint8_t* out);
+
+// false si no es una trama de hoja (otro tamaño, magic o tipo)
+bool decodeGatewayFrame(const uint8_t* data, size_t length, GatewayFrame& out);
+
+#endif // GATEWAYFRAME_H
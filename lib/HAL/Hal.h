@@ -0,0 +1,199 @@
+#ifndef HAL_H
+#define HAL_H
+
+// Capa de abstracción de hardware (HAL) para compilar las librerías del
+// proyecto tanto en el ESP32 como en el host (Linux, env "native").
+//
+// - Reloj:    hal::millis(), hal::micros(), hal::delayMs(), hal::delayMicros()
+// - GPIO:     hal::gpioOutput(), hal::gpioInput(), hal::gpioWrite(), hal::pulseInHigh()
+// - Memoria:  hal::freeHeap(), hal::memoryStats(), ...
+// - Sistema:  hal::chipModel(), hal::cpuFreqMHz(), hal::restart(), hal::resetReason(), hal::random32(), ...
+// - Wi-Fi:    hal::wifiRssi()
+// - Socket:   hal::TcpClient, hal::TcpServer (HalSocket.h), hal::UdpSocket (HalUdp.h)
+// - Tareas:   hal::Mutex, hal::startTask() (HalTask.h)
+// - Enlace:   hal::LocalLink, tramas cortas entre placas (HalLink.h)
+// - Cámara:   API esp_camera (HalCamera.h)
+// - OTA:      imagen en ejecución y partición inactiva (HalOta.h)
+//
+// En el ESP32 las funciones son inline sobre Arduino/ESP-IDF, sin costo extra.
+// En el host se implementan en HalPosix.cpp y String/Serial vienen de HalNative.h.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_system.h>
+#include <esp_heap_caps.h>
+#include <WiFi.h>
+#else
+#include "HalNative.h"
+#endif
+
+namespace hal {
+
+// Estadísticas de memoria del sistema
+struct MemoryStats {
+    uint32_t totalHeap;
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;       // Mínimo histórico de heap libre
+    uint32_t largestFreeBlock;
+    uint32_t totalPsram;
+    uint32_t freePsram;
+};
+
+// Causa del último reinicio
+enum ResetReason : uint8_t {
+    RESET_UNKNOWN,
+    RESET_POWERON,      // Encendido: la RAM RTC trae basura
+    RESET_EXTERNAL,     // Pin EN
+    RESET_SOFTWARE,     // ESP.restart()
+    RESET_PANIC,        // Excepción o abort()
+    RESET_WATCHDOG,     // Watchdog de interrupciones, de tareas o del RTC
+    RESET_BROWNOUT,     // Caída de tensión
+    RESET_DEEPSLEEP,
+};
+
+// Variables en RAM RTC que el arranque no inicializa: conservan su valor
+// tras un reinicio en caliente (software, watchdog, pánico, brownout).
+// En el host son variables comunes.
+#ifdef ARDUINO
+#define HAL_NOINIT RTC_NOINIT_ATTR
+#else
+#define HAL_NOINIT
+#endif
+
+#ifdef ARDUINO
+
+// ---- Reloj ----
+inline unsigned long millis() { return ::millis(); }
+inline unsigned long micros() { return ::micros(); }
+inline void delayMs(unsigned long ms) { ::delay(ms); }
+inline void delayMicros(unsigned int us) { ::delayMicroseconds(us); }
+
+// ---- GPIO ----
+inline void gpioOutput(int pin) { ::pinMode(pin, OUTPUT); }
+inline void gpioInput(int pin) { ::pinMode(pin, INPUT); }
+inline void gpioWrite(int pin, bool high) { ::digitalWrite(pin, high ? HIGH : LOW); }
+inline unsigned long pulseInHigh(int pin, unsigned long timeoutUs) { return ::pulseIn(pin, HIGH, timeoutUs); }
+
+// ---- Memoria ----
+inline uint32_t freeHeap() { return esp_get_free_heap_size(); }
+inline bool psramFound() { return ::psramFound(); }
+inline MemoryStats memoryStats() {
+    MemoryStats stats;
+    stats.totalHeap = heap_caps_get_total_size(MALLOC_CAP_DEFAULT);
+    stats.freeHeap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    stats.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    stats.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+    stats.totalPsram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    stats.freePsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    return stats;
+}
+
+// ---- Sistema ----
+inline const char* chipModel() { return ESP.getChipModel(); }
+inline uint32_t chipRevision() { return ESP.getChipRevision(); }
+inline uint32_t cpuFreqMHz() { return ESP.getCpuFreqMHz(); }
+inline uint32_t flashSize() { return ESP.getFlashChipSize(); }
+inline uint32_t flashSpeed() { return ESP.getFlashChipSpeed(); }
+inline void restart() { ESP.restart(); }
+inline ResetReason resetReason() {
+    switch (esp_reset_reason()) {
+        case ESP_RST_POWERON: return RESET_POWERON;
+        case ESP_RST_EXT: return RESET_EXTERNAL;
+        case ESP_RST_SW: return RESET_SOFTWARE;
+        case ESP_RST_PANIC: return RESET_PANIC;
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT: return RESET_WATCHDOG;
+        case ESP_RST_BROWNOUT: return RESET_BROWNOUT;
+        case ESP_RST_DEEPSLEEP: return RESET_DEEPSLEEP;
+        default: return RESET_UNKNOWN;
+    }
+}
+inline uint32_t random32() { return esp_random(); }
+
+// ---- Wi-Fi ----
+inline int wifiRssi() { return WiFi.RSSI(); }
+
+#else
+
+// ---- Reloj ----
+unsigned long millis();
+unsigned long micros();
+void delayMs(unsigned long ms);
+void delayMicros(unsigned int us);
+
+// ---- GPIO ----
+void gpioOutput(int pin);
+void gpioInput(int pin);
+void gpioWrite(int pin, bool high);
+unsigned long pulseInHigh(int pin, unsigned long timeoutUs);
+
+// ---- Memoria ----
+uint32_t freeHeap();
+bool psramFound();
+MemoryStats memoryStats();
+
+// ---- Sistema ----
+const char* chipModel();
+uint32_t chipRevision();
+uint32_t cpuFreqMHz();
+uint32_t flashSize();
+uint32_t flashSpeed();
+void restart();                 // Marca restartRequested y deja RESET_SOFTWARE como causa
+ResetReason resetReason();
+uint32_t random32();
+
+// ---- Wi-Fi ----
+int wifiRssi();
+
+// ---- Simulación (solo host) ----
+namespace sim {
+
+// Placa simulada. Cada hilo puede tener la suya, lo que permite correr
+// varias instancias del firmware en un mismo proceso.
+struct Board {
+    // Distancia actual en cm para el eco del HC-SR04; < 0 simula un timeout
+    float (*distanceSource)(void* context, unsigned long nowMs);
+    void* context;
+    float fixedDistance;        // Usada si distanceSource es NULL
+    double timeScale;           // > 1 acelera millis()/delay()
+    bool serialEnabled;         // Silenciar Serial para simulaciones masivas
+    int rssi;                   // RSSI de Wi-Fi reportado por hal::wifiRssi() (dBm)
+    bool triggered;             // Hubo pulso de trigger desde el último eco
+    bool restartRequested;      // hal::restart() fue llamado
+    ResetReason resetReason;    // Lo que reporta hal::resetReason() (RESET_POWERON al inicio)
+    // Pérdida de paquetes del enlace Wi-Fi simulado: se pierde cada datagrama
+    // UDP con esta probabilidad y cada segmento TCP llega tras el RTO
+    double packetLoss;
+    // OTA (HalOta.h): la imagen "en ejecución" y la partición inactiva las
+    // pone quien controla la simulación; la placa no copia ni libera nada
+    const uint8_t* runningImage;
+    size_t runningImageSize;
+    const char* firmwareId;
+    uint8_t* otaPartition;
+    size_t otaCapacity;
+    size_t otaWritten;
+    bool otaOpen;               // Entre otaBegin() y otaEnd()/otaAbort()
+    bool otaCompleted;          // otaEnd() aceptó la imagen: se arrancaría con ella
+};
+
+void initBoard(Board& board);
+void bindBoard(Board* board);   // Asocia la placa al hilo actual (NULL = placa por defecto)
+Board& currentBoard();
+void setFixedDistance(float cm);
+void setSerialEnabled(bool enabled);
+void setTimeScale(double scale);
+void setResetReason(ResetReason reason);
+void setPacketLoss(double probability);
+bool packetLost();              // Sorteo con la pérdida de la placa actual
+
+} // namespace sim
+
+#endif
+
+} // namespace hal
+
+#endif // HAL_H
@@ -0,0 +1,133 @@
+#ifndef HALBOARD_H
+#define HALBOARD_H
+
+// Perfil de la placa en tiempo de compilación: pines del HC-SR04 y del bus
+// de la cámara en un solo lugar (antes TRIG_PIN/ECHO_PIN en main.cpp,
+// board_config.h y camera_pins.h). El perfil se elige con el mismo define
+// de platformio.ini (CAMERA_MODEL_*) y queda en hal::BOARD; los pines son
+// constantes, así que pueden ser argumentos de plantilla (hal::Ultrasonic,
+// HalGpio.h) y los conflictos se detectan al compilar:
+//
+//     - trigger y eco distintos y fuera del bus de la cámara
+//     - pines del bus de la cámara sin repetir
+//     - ninguno de los reservados por la flash (y la PSRAM octal)
+//
+// Las comprobaciones son constexpr de una sola expresión (C++11: el core
+// de Arduino del ESP32 no compila con -std=gnu++17).
+
+#include <stdint.h>
+
+namespace hal {
+
+#define BOARD_NO_PIN -1
+#define BOARD_MAX_GPIO 48
+
+struct CameraPins {
+    int8_t data[8];             // Y2 ... Y9
+    int8_t xclk;
+    int8_t pclk;
+    int8_t vsync;
+    int8_t href;
+    int8_t sccbSda;
+    int8_t sccbScl;
+    int8_t pwdn;                // BOARD_NO_PIN si la placa no lo cablea
+    int8_t reset;
+};
+
+struct BoardProfile {
+    const char* name;
+    int8_t trigPin;             // HC-SR04
+    int8_t echoPin;
+    CameraPins camera;
+    uint64_t reservedPins;      // Bit n = GPIO n usado por la flash o la PSRAM
+};
+
+namespace board {
+
+constexpr uint64_t pinBit(int pin) {
+    return pin >= 0 && pin <= BOARD_MAX_GPIO ? (uint64_t)1 << pin : 0;
+}
+
+// GPIO first..last (reservados de un módulo)
+constexpr uint64_t pinRange(int first, int last) {
+    return first > last ? 0 : pinBit(first) | pinRange(first + 1, last);
+}
+
+constexpr uint64_t dataPins(const CameraPins& camera, int i = 0) {
+    return i == 8 ? 0 : pinBit(camera.data[i]) | dataPins(camera, i + 1);
+}
+
+constexpr uint64_t cameraPins(const CameraPins& camera) {
+    return dataPins(camera) | pinBit(camera.xclk) | pinBit(camera.pclk) | pinBit(camera.vsync) |
+           pinBit(camera.href) | pinBit(camera.sccbSda) | pinBit(camera.sccbScl) |
+           pinBit(camera.pwdn) | pinBit(camera.reset);
+}
+
+constexpr int cameraPinCount(const CameraPins& camera) {
+    return 14 + (camera.pwdn != BOARD_NO_PIN) + (camera.reset != BOARD_NO_PIN);
+}
+
+constexpr int bitCount(uint64_t bits) {
+    return bits == 0 ? 0 : (int)(bits & 1) + bitCount(bits >> 1);
+}
+
+constexpr bool validPin(int pin) {
+    return pin >= 0 && pin <= BOARD_MAX_GPIO;
+}
+
+// Dos pines de la cámara en el mismo GPIO dejan menos bits que pines
+constexpr bool cameraPinsDistinct(const BoardProfile& profile) {
+    return bitCount(cameraPins(profile.camera)) == cameraPinCount(profile.camera);
+}
+
+constexpr bool sensorPinsValid(const BoardProfile& profile) {
+    return validPin(profile.trigPin) && validPin(profile.echoPin) && profile.trigPin != profile.echoPin;
+}
+
+constexpr bool sensorPinsFree(const BoardProfile& profile) {
+    return ((pinBit(profile.trigPin) | pinBit(profile.echoPin)) & cameraPins(profile.camera)) == 0;
+}
+
+constexpr bool pinsNotReserved(const BoardProfile& profile) {
+    return ((pinBit(profile.trigPin) | pinBit(profile.echoPin) | cameraPins(profile.camera)) &
+            profile.reservedPins) == 0;
+}
+
+constexpr bool profileValid(const BoardProfile& profile) {
+    return cameraPinsDistinct(profile) && sensorPinsValid(profile) &&
+           sensorPinsFree(profile) && pinsNotReserved(profile);
+}
+
+// ESP32-S3: GPIO 26-32 son de la flash SPI; con PSRAM octal (módulos
+// N8R8/N16R8) también 33-37, y ahí el HC-SR04 en 35/36 no funciona:
+// definir BOARD_OCTAL_PSRAM hace fallar la compilación en ese caso
+constexpr uint64_t ESP32S3_RESERVED = pinRange(26, 32)
+#ifdef BOARD_OCTAL_PSRAM
+                                      | pinRange(33, 37)
+#endif
+    ;
+
+// ESP32-S3-CAM con cámara TY-OV2640
+constexpr BoardProfile ESP32S3_CAM = {
+    "ESP32-S3-CAM (TY-OV2640)",
+    35, 36,
+    {{11, 9, 8, 10, 12, 18, 17, 16}, 15, 13, 6, 7, 4, 5, BOARD_NO_PIN, BOARD_NO_PIN},
+    ESP32S3_RESERVED,
+};
+
+} // namespace board
+
+#if defined(CAMERA_MODEL_ESP32S3_CAM)
+static constexpr const BoardProfile& BOARD = board::ESP32S3_CAM;
+#else
+#error "Sin perfil de placa: definir CAMERA_MODEL_ESP32S3_CAM (platformio.ini) o agregar uno en HalBoard.h"
+#endif
+
+static_assert(board::cameraPinsDistinct(BOARD), "Dos pines del bus de la cámara comparten GPIO");
+static_assert(board::sensorPinsValid(BOARD), "Trigger y eco del HC-SR04 deben ser GPIO distintos y válidos");
+static_assert(board::sensorPinsFree(BOARD), "El HC-SR04 usa un pin del bus de la cámara");
+static_assert(board::pinsNotReserved(BOARD), "Un pin del perfil es de la flash o la PSRAM del módulo");
+
+} // namespace hal
+
+#endif // HALBOARD_H
@@ -0,0 +1,227 @@
+#ifndef HALCAMERA_H
+#define HALCAMERA_H
+
+// Cámara de la HAL. En el ESP32 es la API de esp32-camera; en el host se
+// emula el subconjunto que usa CameraManager con un sensor simulado que
+// entrega JPEG baseline 4:2:2 válidos (contenido sintético) cuyo tamaño
+// depende de resolución y calidad; la escena (auto, vacío o persona) se
+// puede elegir y el objeto tiene más detalle que el fondo.
+//
+// El sensor simulado tiene los registros del OV2640 que usa CameraProfile
+// (QS, ZMOW/ZMOH/ZMHH, COM9) y cobra el tiempo del bus SCCB y de los cuadros:
+// set_framesize() reescribe la ventana completa y el sensor se resincroniza
+// descartando cuadros, como en el driver real.
+
+#include "Hal.h"
+
+#ifdef ARDUINO
+
+#include "esp_camera.h"
+
+#else
+
+#include <sys/time.h>
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+#define ESP_ERR_CAMERA_NOT_DETECTED 0x20001
+
+typedef enum {
+    LEDC_CHANNEL_0 = 0,
+} ledc_channel_t;
+
+typedef enum {
+    LEDC_TIMER_0 = 0,
+} ledc_timer_t;
+
+typedef enum {
+    PIXFORMAT_RGB565,
+    PIXFORMAT_YUV422,
+    PIXFORMAT_YUV420,
+    PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG,
+    PIXFORMAT_RGB888,
+    PIXFORMAT_RAW,
+    PIXFORMAT_RGB444,
+    PIXFORMAT_RGB555,
+} pixformat_t;
+
+typedef enum {
+    FRAMESIZE_96X96,    // 96x96
+    FRAMESIZE_QQVGA,    // 160x120
+    FRAMESIZE_QCIF,     // 176x144
+    FRAMESIZE_HQVGA,    // 240x176
+    FRAMESIZE_240X240,  // 240x240
+    FRAMESIZE_QVGA,     // 320x240
+    FRAMESIZE_CIF,      // 400x296
+    FRAMESIZE_HVGA,     // 480x320
+    FRAMESIZE_VGA,      // 640x480
+    FRAMESIZE_SVGA,     // 800x600
+    FRAMESIZE_XGA,      // 1024x768
+    FRAMESIZE_HD,       // 1280x720
+    FRAMESIZE_SXGA,     // 1280x1024
+    FRAMESIZE_UXGA,     // 1600x1200
+    FRAMESIZE_INVALID
+} framesize_t;
+
+typedef enum {
+    GAINCEILING_2X,
+    GAINCEILING_4X,
+    GAINCEILING_8X,
+    GAINCEILING_16X,
+    GAINCEILING_32X,
+    GAINCEILING_64X,
+    GAINCEILING_128X,
+} gainceiling_t;
+
+typedef enum {
+    CAMERA_GRAB_WHEN_EMPTY,
+    CAMERA_GRAB_LATEST,
+} camera_grab_mode_t;
+
+typedef enum {
+    CAMERA_FB_IN_PSRAM,
+    CAMERA_FB_IN_DRAM,
+} camera_fb_location_t;
+
+typedef struct {
+    int pin_pwdn;
+    int pin_reset;
+    int pin_xclk;
+    int pin_sccb_sda;
+    int pin_sccb_scl;
+    int pin_d7, pin_d6, pin_d5, pin_d4, pin_d3, pin_d2, pin_d1, pin_d0;
+    int pin_vsync;
+    int pin_href;
+    int pin_pclk;
+    int xclk_freq_hz;
+    ledc_timer_t ledc_timer;
+    ledc_channel_t ledc_channel;
+    pixformat_t pixel_format;
+    framesize_t frame_size;
+    int jpeg_quality;
+    size_t fb_count;
+    camera_fb_location_t fb_location;
+    camera_grab_mode_t grab_mode;
+} camera_config_t;
+
+typedef struct {
+    uint8_t* buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+    struct timeval timestamp;
+} camera_fb_t;
+
+typedef struct {
+    framesize_t framesize;
+    uint8_t quality;
+    int8_t brightness;
+    int8_t contrast;
+    int8_t saturation;
+    int8_t sharpness;
+    uint8_t denoise;
+    uint8_t special_effect;
+    uint8_t wb_mode;
+    uint8_t awb;
+    uint8_t awb_gain;
+    uint8_t aec;
+    uint8_t aec2;
+    int8_t ae_level;
+    uint16_t aec_value;
+    uint8_t agc;
+    uint8_t agc_gain;
+    uint8_t gainceiling;
+    uint8_t bpc;
+    uint8_t wpc;
+    uint8_t raw_gma;
+    uint8_t lenc;
+    uint8_t hmirror;
+    uint8_t vflip;
+    uint8_t dcw;
+    uint8_t colorbar;
+} camera_status_t;
+
+#define OV2640_PID 0x26
+
+typedef struct {
+    uint8_t MIDH;
+    uint8_t MIDL;
+    uint16_t PID;
+    uint8_t VER;
+} sensor_id_t;
+
+typedef struct _sensor sensor_t;
+struct _sensor {
+    sensor_id_t id;
+    camera_status_t status;
+    int (*set_framesize)(sensor_t* sensor, framesize_t framesize);
+    int (*set_quality)(sensor_t* sensor, int quality);
+    int (*set_brightness)(sensor_t* sensor, int level);
+    int (*set_contrast)(sensor_t* sensor, int level);
+    int (*set_saturation)(sensor_t* sensor, int level);
+    int (*set_special_effect)(sensor_t* sensor, int effect);
+    int (*set_whitebal)(sensor_t* sensor, int enable);
+    int (*set_awb_gain)(sensor_t* sensor, int enable);
+    int (*set_wb_mode)(sensor_t* sensor, int mode);
+    int (*set_exposure_ctrl)(sensor_t* sensor, int enable);
+    int (*set_aec2)(sensor_t* sensor, int enable);
+    int (*set_ae_level)(sensor_t* sensor, int level);
+    int (*set_aec_value)(sensor_t* sensor, int value);
+    int (*set_gain_ctrl)(sensor_t* sensor, int enable);
+    int (*set_agc_gain)(sensor_t* sensor, int gain);
+    int (*set_gainceiling)(sensor_t* sensor, gainceiling_t gainceiling);
+    int (*set_bpc)(sensor_t* sensor, int enable);
+    int (*set_wpc)(sensor_t* sensor, int enable);
+    int (*set_raw_gma)(sensor_t* sensor, int enable);
+    int (*set_lenc)(sensor_t* sensor, int enable);
+    int (*set_hmirror)(sensor_t* sensor, int enable);
+    int (*set_vflip)(sensor_t* sensor, int enable);
+    int (*set_dcw)(sensor_t* sensor, int enable);
+    int (*set_colorbar)(sensor_t* sensor, int enable);
+    // Registros crudos: bit 8 de reg = banco del sensor (1) o DSP (0)
+    int (*get_reg)(sensor_t* sensor, int reg, int mask);
+    int (*set_reg)(sensor_t* sensor, int reg, int mask, int value);
+};
+
+esp_err_t esp_camera_init(const camera_config_t* config);
+esp_err_t esp_camera_deinit();
+camera_fb_t* esp_camera_fb_get();
+void esp_camera_fb_return(camera_fb_t* fb);
+sensor_t* esp_camera_sensor_get();
+
+namespace hal {
+namespace sim {
+
+// Complejidad de la escena simulada (1.0 = escena típica). Escala el tamaño
+// de los JPEG generados para imitar cambios de iluminación o contenido.
+void setSceneComplexity(float complexity);
+
+// Contenido de la escena simulada: un auto en el centro del cuadro (por
+// defecto), el espacio vacío o una persona de pie en el espacio
+enum SimScene {
+    SCENE_CAR,
+    SCENE_EMPTY,
+    SCENE_PERSON,
+};
+void setScene(SimScene scene);
+
+// Capturas realizadas por el sensor simulado desde esp_camera_init()
+uint32_t framesCaptured();
+
+// Transacciones SCCB (lecturas, escrituras y cambios de banco) desde
+// esp_camera_init()
+uint32_t sccbTransactions();
+
+// Cuadros descartados por el sensor al resincronizarse tras un cambio de
+// ventana desde esp_camera_init()
+uint32_t framesDropped();
+
+} // namespace sim
+} // namespace hal
+
+#endif // ARDUINO
+
+#endif // HALCAMERA_H
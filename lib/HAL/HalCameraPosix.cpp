@@ -0,0 +1,631 @@
+#ifndef ARDUINO
+
+#include "HalCamera.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mutex>
+
+// Sensor OV2640 simulado para el host
+namespace {
+
+// Registros del OV2640 (banco DSP salvo COM9)
+const uint8_t REG_QS = 0x44;
+const uint8_t REG_ZMOW = 0x5A;
+const uint8_t REG_ZMOH = 0x5B;
+const uint8_t REG_ZMHH = 0x5C;
+const uint8_t REG_COM9 = 0x14;      // Banco del sensor
+const int BANK_DSP = 0;
+const int BANK_SENSOR = 1;
+
+// SCCB a 100 kHz: una escritura son 3 bytes con ACK (~290 us); una lectura,
+// la dirección del registro y luego el dato (~400 us)
+const unsigned long SCCB_WRITE_US = 290;
+const unsigned long SCCB_READ_US = 400;
+
+// set_framesize() del driver (set_window): tabla del modo CIF/SVGA/UXGA,
+// registros de ventana, reloj y DVP, y 10 ms de espera; después el sensor
+// entrega cuadros corruptos hasta resincronizar
+const uint32_t WINDOW_WRITES = 60;
+const unsigned long WINDOW_SETTLE_US = 10000;
+const uint8_t RESYNC_FRAMES = 2;
+
+struct SimCamera {
+    std::mutex lock;
+    bool initialized;
+    sensor_t sensor;
+    camera_fb_t frame;
+    uint8_t* buffer;
+    size_t bufferSize;
+    bool frameOut;              // El buffer fue entregado y no devuelto
+    float sceneComplexity;
+    hal::sim::SimScene scene;
+    uint32_t framesCaptured;
+    uint32_t noise;             // Estado del generador pseudoaleatorio
+    uint8_t regs[2][256];       // [banco][registro]
+    int bank;                   // Banco seleccionado (-1 = desconocido)
+    uint8_t mode;               // 0 = CIF, 1 = SVGA, 2 = UXGA
+    uint8_t resyncFrames;       // Cuadros a descartar antes del próximo válido
+    uint32_t sccbTransactions;
+    uint32_t framesDropped;
+};
+
+SimCamera camera = {};
+
+const uint16_t frameWidths[] = {96, 160, 176, 240, 240, 320, 400, 480, 640, 800, 1024, 1280, 1280, 1600};
+const uint16_t frameHeights[] = {96, 120, 144, 176, 240, 240, 296, 320, 480, 600, 768, 720, 1024, 1200};
+
+uint32_t nextNoise() {
+    // xorshift32: determinista para poder comparar corridas
+    uint32_t x = camera.noise;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    camera.noise = x;
+    return x;
+}
+
+// Tiempo del bus y de los cuadros, escalado como hal::delayMs()
+void busWait(unsigned long us) {
+    double scaled = (double)us / hal::sim::currentBoard().timeScale;
+    if (scaled >= 1.0) {
+        usleep((useconds_t)scaled);
+    }
+}
+
+uint8_t sensorMode(framesize_t framesize) {
+    return framesize <= FRAMESIZE_CIF ? 0 : (framesize <= FRAMESIZE_SVGA ? 1 : 2);
+}
+
+// Período de cuadro aproximado del OV2640 en JPEG con XCLK de 20 MHz
+unsigned long framePeriodUs() {
+    static const unsigned long periods[] = {20000, 40000, 80000};
+    return periods[camera.mode];
+}
+
+void selectBank(int bank) {
+    // Como el driver: solo escribe BANK_SEL si cambia
+    if (camera.bank != bank) {
+        camera.bank = bank;
+        camera.sccbTransactions++;
+        busWait(SCCB_WRITE_US);
+    }
+}
+
+void writeRegs(int bank, uint32_t writes) {
+    selectBank(bank);
+    camera.sccbTransactions += writes;
+    busWait(writes * SCCB_WRITE_US);
+}
+
+void setZoom(framesize_t framesize) {
+    uint16_t w = frameWidths[framesize];
+    uint16_t h = frameHeights[framesize];
+    camera.regs[BANK_DSP][REG_ZMOW] = (uint8_t)(w >> 2);
+    camera.regs[BANK_DSP][REG_ZMOH] = (uint8_t)(h >> 2);
+    camera.regs[BANK_DSP][REG_ZMHH] = (uint8_t)(((w >> 10) & 0x03) | ((h >> 8) & 0x04));
+}
+
+int setFramesize(sensor_t* sensor, framesize_t framesize) {
+    if (framesize >= FRAMESIZE_INVALID) return -1;
+    writeRegs(BANK_DSP, WINDOW_WRITES);
+    selectBank(BANK_SENSOR);        // CLKRC
+    selectBank(BANK_DSP);
+    busWait(WINDOW_SETTLE_US);
+    camera.mode = sensorMode(framesize);
+    setZoom(framesize);
+    camera.resyncFrames = RESYNC_FRAMES;
+    sensor->status.framesize = framesize;
+    return 0;
+}
+
+int setQuality(sensor_t* sensor, int quality) {
+    if (quality < 0 || quality > 63) return -1;
+    writeRegs(BANK_DSP, 1);
+    camera.regs[BANK_DSP][REG_QS] = (uint8_t)quality;
+    sensor->status.quality = (uint8_t)quality;
+    return 0;
+}
+
+// Brillo y contraste van por los registros indirectos del SDE (BPADDR/BPDATA)
+int setBrightness(sensor_t* sensor, int level) {
+    writeRegs(BANK_DSP, 5);
+    sensor->status.brightness = (int8_t)level;
+    return 0;
+}
+
+int setContrast(sensor_t* sensor, int level) {
+    writeRegs(BANK_DSP, 7);
+    sensor->status.contrast = (int8_t)level;
+    return 0;
+}
+
+int getReg(sensor_t* sensor, int reg, int mask) {
+    (void)sensor;
+    int bank = (reg >> 8) & 0x01;
+    selectBank(bank);
+    camera.sccbTransactions++;
+    busWait(SCCB_READ_US);
+    return camera.regs[bank][reg & 0xFF] & mask;
+}
+
+int setReg(sensor_t* sensor, int reg, int mask, int value) {
+    // Lectura y escritura, como set_reg() del driver del OV2640
+    int old = getReg(sensor, reg, 0xFF);
+    int bank = (reg >> 8) & 0x01;
+    camera.sccbTransactions++;
+    busWait(SCCB_WRITE_US);
+    camera.regs[bank][reg & 0xFF] = (uint8_t)((old & ~mask) | (value & mask));
+    return 0;
+}
+int setSaturation(sensor_t* sensor, int level) { sensor->status.saturation = (int8_t)level; return 0; }
+int setSpecialEffect(sensor_t* sensor, int effect) { sensor->status.special_effect = (uint8_t)effect; return 0; }
+int setWhitebal(sensor_t* sensor, int enable) { sensor->status.awb = (uint8_t)enable; return 0; }
+int setAwbGain(sensor_t* sensor, int enable) { sensor->status.awb_gain = (uint8_t)enable; return 0; }
+int setWbMode(sensor_t* sensor, int mode) { sensor->status.wb_mode = (uint8_t)mode; return 0; }
+int setExposureCtrl(sensor_t* sensor, int enable) { sensor->status.aec = (uint8_t)enable; return 0; }
+int setAec2(sensor_t* sensor, int enable) { sensor->status.aec2 = (uint8_t)enable; return 0; }
+int setAeLevel(sensor_t* sensor, int level) { sensor->status.ae_level = (int8_t)level; return 0; }
+int setAecValue(sensor_t* sensor, int value) { sensor->status.aec_value = (uint16_t)value; return 0; }
+int setGainCtrl(sensor_t* sensor, int enable) { sensor->status.agc = (uint8_t)enable; return 0; }
+int setAgcGain(sensor_t* sensor, int gain) { sensor->status.agc_gain = (uint8_t)gain; return 0; }
+int setGainceiling(sensor_t* sensor, gainceiling_t ceiling) {
+    setReg(sensor, 0x100 | REG_COM9, 0xE0, (int)ceiling << 5);
+    sensor->status.gainceiling = (uint8_t)ceiling;
+    return 0;
+}
+int setBpc(sensor_t* sensor, int enable) { sensor->status.bpc = (uint8_t)enable; return 0; }
+int setWpc(sensor_t* sensor, int enable) { sensor->status.wpc = (uint8_t)enable; return 0; }
+int setRawGma(sensor_t* sensor, int enable) { sensor->status.raw_gma = (uint8_t)enable; return 0; }
+int setLenc(sensor_t* sensor, int enable) { sensor->status.lenc = (uint8_t)enable; return 0; }
+int setHmirror(sensor_t* sensor, int enable) { sensor->status.hmirror = (uint8_t)enable; return 0; }
+int setVflip(sensor_t* sensor, int enable) { sensor->status.vflip = (uint8_t)enable; return 0; }
+int setDcw(sensor_t* sensor, int enable) { sensor->status.dcw = (uint8_t)enable; return 0; }
+int setColorbar(sensor_t* sensor, int enable) { sensor->status.colorbar = (uint8_t)enable; return 0; }
+
+// Tamaño aproximado de un JPEG del OV2640: ~0.15 bytes/píxel en calidad 12
+// para una escena típica; calidades más bajas (número mayor) comprimen más.
+size_t estimateJpegSize(size_t width, size_t height, int quality, float complexity) {
+    double pixels = (double)width * height;
+    double qualityFactor = 22.0 / (quality + 10.0);
+    double jitter = 0.95 + (nextNoise() % 1000) / 10000.0; // ±5%
+    double size = pixels * 0.15 * qualityFactor * complexity * jitter;
+    return size < 256 ? 256 : (size_t)size;
+}
+
+// ---- JPEG sintético ----
+// Baseline 4:2:2 como el del OV2640 (MCU de 16x8: dos bloques Y, uno Cb y
+// uno Cr) con las tablas de Huffman estándar del anexo K. Los coeficientes
+// son pseudoaleatorios: cualquier decodificador acepta la imagen y su tamaño
+// sigue estimateJpegSize(). Los DC siguen la escena (piso, auto o persona),
+// así que la miniatura en escala de grises tiene contenido reconocible; el
+// objeto tiene más detalle que el fondo y sus bytes por píxel son mayores.
+
+const uint8_t STD_DC_LUMA_BITS[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+const uint8_t STD_DC_CHROMA_BITS[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+const uint8_t STD_DC_VALUES[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+const uint8_t STD_AC_LUMA_BITS[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+const uint8_t STD_AC_LUMA_VALUES[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+const uint8_t STD_AC_CHROMA_BITS[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+const uint8_t STD_AC_CHROMA_VALUES[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+// Cuantización del anexo K (en orden zigzag no importa: solo se decodifica)
+const uint8_t STD_LUMA_QUANT[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+
+struct HuffCodes {
+    uint16_t code[256];
+    uint8_t size[256];
+};
+
+struct JpegTables {
+    HuffCodes dc[2];
+    HuffCodes ac[2];
+};
+
+void buildCodes(const uint8_t* bits, const uint8_t* values, HuffCodes& out) {
+    uint16_t code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++) {
+        for (int i = 0; i < bits[length - 1]; i++, k++) {
+            out.code[values[k]] = code++;
+            out.size[values[k]] = (uint8_t)length;
+        }
+        code <<= 1;
+    }
+}
+
+const JpegTables& jpegTables() {
+    static JpegTables tables;
+    static bool built = false;
+    if (!built) {
+        buildCodes(STD_DC_LUMA_BITS, STD_DC_VALUES, tables.dc[0]);
+        buildCodes(STD_DC_CHROMA_BITS, STD_DC_VALUES, tables.dc[1]);
+        buildCodes(STD_AC_LUMA_BITS, STD_AC_LUMA_VALUES, tables.ac[0]);
+        buildCodes(STD_AC_CHROMA_BITS, STD_AC_CHROMA_VALUES, tables.ac[1]);
+        built = true;
+    }
+    return tables;
+}
+
+struct JpegWriter {
+    uint8_t* out;
+    size_t pos;
+    uint32_t acc;
+    int bits;
+
+    void byte(uint8_t value) { out[pos++] = value; }
+    void word(uint16_t value) { byte((uint8_t)(value >> 8)); byte((uint8_t)value); }
+    void bytes(const uint8_t* data, size_t count) { memcpy(out + pos, data, count); pos += count; }
+
+    // Datos de entropía: MSB primero, con 0x00 tras cada 0xFF
+    void put(uint32_t value, int count) {
+        acc = (acc << count) | (value & ((1u << count) - 1));
+        bits += count;
+        while (bits >= 8) {
+            uint8_t b = (uint8_t)(acc >> (bits - 8));
+            out[pos++] = b;
+            if (b == 0xFF) {
+                out[pos++] = 0x00;
+            }
+            bits -= 8;
+        }
+    }
+
+    void flush() {
+        if (bits > 0) {
+            put(0x7F, 8 - bits);    // Relleno con unos
+        }
+    }
+
+    size_t bitCount() const { return pos * 8 + bits; }
+};
+
+void writeHuffTable(JpegWriter& w, uint8_t classAndId, const uint8_t* bits, const uint8_t* values) {
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+        count += bits[i];
+    }
+    w.byte(classAndId);
+    w.bytes(bits, 16);
+    w.bytes(values, count);
+}
+
+void writeHeaders(JpegWriter& w, size_t width, size_t height, int quality) {
+    w.word(0xFFD8);
+
+    // Escala de cuantización al estilo de QS: 12 = tablas del anexo K
+    int scale = quality > 0 ? quality : 1;
+    w.word(0xFFDB);
+    w.word(2 + 2 * 65);
+    for (uint8_t table = 0; table < 2; table++) {
+        w.byte(table);
+        for (int i = 0; i < 64; i++) {
+            int base = table == 0 ? STD_LUMA_QUANT[i] : (i < 4 ? 17 + i * 6 : 99);
+            int q = (base * scale + 6) / 12;
+            w.byte((uint8_t)(q < 1 ? 1 : q > 255 ? 255 : q));
+        }
+    }
+
+    w.word(0xFFC0);
+    w.word(17);
+    w.byte(8);
+    w.word((uint16_t)height);
+    w.word((uint16_t)width);
+    w.byte(3);
+    static const uint8_t components[9] = {1, 0x21, 0, 2, 0x11, 1, 3, 0x11, 1};
+    w.bytes(components, sizeof(components));
+
+    w.word(0xFFC4);
+    w.word(2 + 4 * 17 + 12 + 12 + 162 + 162);
+    writeHuffTable(w, 0x00, STD_DC_LUMA_BITS, STD_DC_VALUES);
+    writeHuffTable(w, 0x10, STD_AC_LUMA_BITS, STD_AC_LUMA_VALUES);
+    writeHuffTable(w, 0x01, STD_DC_CHROMA_BITS, STD_DC_VALUES);
+    writeHuffTable(w, 0x11, STD_AC_CHROMA_BITS, STD_AC_CHROMA_VALUES);
+
+    w.word(0xFFDA);
+    w.word(12);
+    w.byte(3);
+    static const uint8_t scan[6] = {1, 0x00, 2, 0x11, 3, 0x11};
+    w.bytes(scan, sizeof(scan));
+    w.byte(0);
+    w.byte(63);
+    w.byte(0);
+}
+
+uint8_t magnitudeSize(int value) {
+    unsigned v = (unsigned)(value < 0 ? -value : value);
+    uint8_t size = 0;
+    while (v) {
+        size++;
+        v >>= 1;
+    }
+    return size;
+}
+
+void writeCoefficient(JpegWriter& w, int value, uint8_t size) {
+    w.put((uint32_t)(value < 0 ? value + (1 << size) - 1 : value), size);
+}
+
+// Bloque: DC diferencial y coeficientes AC mientras quede presupuesto de bits
+void writeBlock(JpegWriter& w, const JpegTables& t, int table, int dc, int& predictor, size_t budgetBits) {
+    int diff = dc - predictor;
+    predictor = dc;
+    uint8_t size = magnitudeSize(diff);
+    w.put(t.dc[table].code[size], t.dc[table].size[size]);
+    if (size > 0) {
+        writeCoefficient(w, diff, size);
+    }
+
+    int k = 1;
+    while (k < 64 && w.bitCount() < budgetBits) {
+        int run = (int)(nextNoise() % 4);
+        if (k + run > 63) {
+            run = 63 - k;
+        }
+        uint8_t bits = (uint8_t)(1 + nextNoise() % 3);
+        int magnitude = (1 << (bits - 1)) + (int)(nextNoise() % (1u << (bits - 1)));
+        int value = (nextNoise() & 1) ? magnitude : -magnitude;
+        uint8_t symbol = (uint8_t)((run << 4) | bits);
+        w.put(t.ac[table].code[symbol], t.ac[table].size[symbol]);
+        writeCoefficient(w, value, bits);
+        k += run + 1;
+    }
+    if (k < 64) {
+        w.put(t.ac[table].code[0x00], t.ac[table].size[0x00]);   // EOB
+    }
+}
+
+// Capacidad suficiente para encodeJpeg() con ese objetivo
+size_t jpegCapacity(size_t width, size_t height, size_t targetBytes) {
+    size_t mcus = ((width + 15) / 16) * ((height + 7) / 8);
+    return 2 * (targetBytes + mcus * 4 * 8) + 1024;
+}
+
+// DC cuantizado de un bloque cuyo promedio es 128 + offset (en niveles de gris)
+int quantizedDc(int offset, int quality) {
+    int q0 = (STD_LUMA_QUANT[0] * (quality > 0 ? quality : 1) + 6) / 12;
+    int scaled = offset * 8;
+    return (scaled >= 0 ? scaled + q0 / 2 : scaled - q0 / 2) / q0;
+}
+
+size_t encodeJpeg(uint8_t* out, size_t width, size_t height, int quality, size_t targetBytes,
+                  hal::sim::SimScene scene) {
+    const JpegTables& t = jpegTables();
+    JpegWriter w = {out, 0, 0, 0};
+    writeHeaders(w, width, height, quality);
+    size_t headerBits = w.bitCount();
+
+    size_t mcusX = (width + 15) / 16;
+    size_t mcusY = (height + 7) / 8;
+
+    // El objeto de la escena (auto o persona) se corre hasta un MCU por cuadro
+    // y tiene más detalle por MCU que el fondo: 4x el auto, 3x la persona
+    int shift = (int)(nextNoise() % 3) - 1;
+    size_t objX0 = 0, objX1 = 0, objY0 = 0, objY1 = 0;
+    int objLuma = 0;
+    size_t objWeight = 1;
+    if (scene == hal::sim::SCENE_CAR) {
+        objX0 = mcusX * 3 / 10 + shift;
+        objX1 = mcusX * 7 / 10 + shift;
+        objY0 = mcusY * 35 / 100;
+        objY1 = mcusY * 80 / 100;
+        objLuma = 60;
+        objWeight = 4;
+    } else if (scene == hal::sim::SCENE_PERSON) {
+        objX0 = mcusX * 46 / 100 + shift;
+        objX1 = objX0 + (mcusX * 8 + 99) / 100;
+        objY0 = mcusY * 20 / 100;
+        objY1 = mcusY * 85 / 100;
+        objLuma = 50;
+        objWeight = 3;
+    }
+    size_t objMcus = (objX1 - objX0) * (objY1 - objY0);
+    size_t totalWeight = mcusX * mcusY + (objWeight - 1) * objMcus;
+    size_t targetBits = targetBytes * 8;
+    size_t dataBits = targetBits > headerBits + 16 ? targetBits - headerBits - 16 : 0;
+    int light = (int)(nextNoise() % 17) - 8;    // Variación de exposición entre cuadros
+
+    int predictors[3] = {0, 0, 0};
+    size_t weight = 0;
+    for (size_t my = 0; my < mcusY; my++) {
+        for (size_t mx = 0; mx < mcusX; mx++) {
+            bool object = mx >= objX0 && mx < objX1 && my >= objY0 && my < objY1;
+            size_t start = headerBits + (size_t)((double)dataBits * weight / totalWeight);
+            weight += object ? objWeight : 1;
+            size_t end = headerBits + (size_t)((double)dataBits * weight / totalWeight);
+            size_t step = (end - start) / 4;
+
+            // Piso con gradiente vertical; el auto o la persona más claros
+            // y el auto rojizo
+            int luma = (int)(my * 96 / mcusY) - 48 + light + (object ? objLuma : 0);
+            writeBlock(w, t, 0, quantizedDc(luma, quality), predictors[0], start + step);
+            writeBlock(w, t, 0, quantizedDc(luma + 2 * ((int)(mx % 3) - 1), quality), predictors[0],
+                       start + 2 * step);
+            writeBlock(w, t, 1, 0, predictors[1], start + 3 * step);
+            writeBlock(w, t, 1, object && scene == hal::sim::SCENE_CAR ? 6 : 0, predictors[2], end);
+        }
+    }
+    w.flush();
+    w.word(0xFFD9);
+    return w.pos;
+}
+
+} // namespace
+
+esp_err_t esp_camera_init(const camera_config_t* config) {
+    std::lock_guard<std::mutex> guard(camera.lock);
+    if (camera.initialized) {
+        return ESP_FAIL;
+    }
+
+    sensor_t& s = camera.sensor;
+    memset(&s, 0, sizeof(s));
+    s.id.PID = OV2640_PID;
+    s.status.framesize = config->frame_size;
+    s.status.quality = (uint8_t)config->jpeg_quality;
+    memset(camera.regs, 0, sizeof(camera.regs));
+    camera.regs[BANK_DSP][REG_QS] = (uint8_t)config->jpeg_quality;
+    camera.mode = sensorMode(config->frame_size);
+    setZoom(config->frame_size);
+    camera.bank = -1;
+    camera.resyncFrames = 0;
+    camera.sccbTransactions = 0;
+    camera.framesDropped = 0;
+    s.set_framesize = setFramesize;
+    s.set_quality = setQuality;
+    s.set_brightness = setBrightness;
+    s.set_contrast = setContrast;
+    s.set_saturation = setSaturation;
+    s.set_special_effect = setSpecialEffect;
+    s.set_whitebal = setWhitebal;
+    s.set_awb_gain = setAwbGain;
+    s.set_wb_mode = setWbMode;
+    s.set_exposure_ctrl = setExposureCtrl;
+    s.set_aec2 = setAec2;
+    s.set_ae_level = setAeLevel;
+    s.set_aec_value = setAecValue;
+    s.set_gain_ctrl = setGainCtrl;
+    s.set_agc_gain = setAgcGain;
+    s.set_gainceiling = setGainceiling;
+    s.set_bpc = setBpc;
+    s.set_wpc = setWpc;
+    s.set_raw_gma = setRawGma;
+    s.set_lenc = setLenc;
+    s.set_hmirror = setHmirror;
+    s.set_vflip = setVflip;
+    s.set_dcw = setDcw;
+    s.set_colorbar = setColorbar;
+    s.get_reg = getReg;
+    s.set_reg = setReg;
+
+    if (camera.sceneComplexity <= 0) {
+        camera.sceneComplexity = 1.0f;
+    }
+    camera.noise = 0x2545F491;
+    camera.framesCaptured = 0;
+    camera.frameOut = false;
+    camera.initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit() {
+    std::lock_guard<std::mutex> guard(camera.lock);
+    free(camera.buffer);
+    camera.buffer = NULL;
+    camera.bufferSize = 0;
+    camera.initialized = false;
+    return ESP_OK;
+}
+
+camera_fb_t* esp_camera_fb_get() {
+    std::lock_guard<std::mutex> guard(camera.lock);
+    // Con fb_count = 1 no hay otro buffer mientras el anterior no se devuelva
+    if (!camera.initialized || camera.frameOut) {
+        return NULL;
+    }
+
+    // Tras un cambio de ventana los primeros cuadros salen corruptos y el
+    // driver los descarta; cada uno cuesta un período de cuadro
+    while (camera.resyncFrames > 0) {
+        camera.resyncFrames--;
+        camera.framesDropped++;
+        busWait(framePeriodUs());
+    }
+    busWait(framePeriodUs());
+
+    // El tamaño de salida y la calidad salen de los registros, no de status:
+    // así se nota si alguien los escribe sin pasar por el driver y se equivoca
+    const uint8_t* dsp = camera.regs[BANK_DSP];
+    size_t width = (size_t)(dsp[REG_ZMOW] | ((dsp[REG_ZMHH] & 0x03) << 8)) * 4;
+    size_t height = (size_t)(dsp[REG_ZMOH] | (((dsp[REG_ZMHH] >> 2) & 0x01) << 8)) * 4;
+    size_t target = estimateJpegSize(width, height, dsp[REG_QS], camera.sceneComplexity);
+    size_t capacity = jpegCapacity(width, height, target);
+    if (capacity > camera.bufferSize) {
+        uint8_t* grown = (uint8_t*)realloc(camera.buffer, capacity);
+        if (grown == NULL) {
+            return NULL;
+        }
+        camera.buffer = grown;
+        camera.bufferSize = capacity;
+    }
+    size_t length = encodeJpeg(camera.buffer, width, height, dsp[REG_QS], target, camera.scene);
+
+    camera.frame.buf = camera.buffer;
+    camera.frame.len = length;
+    camera.frame.width = width;
+    camera.frame.height = height;
+    camera.frame.format = PIXFORMAT_JPEG;
+    gettimeofday(&camera.frame.timestamp, NULL);
+
+    camera.frameOut = true;
+    camera.framesCaptured++;
+    return &camera.frame;
+}
+
+void esp_camera_fb_return(camera_fb_t* fb) {
+    std::lock_guard<std::mutex> guard(camera.lock);
+    if (fb == &camera.frame) {
+        camera.frameOut = false;
+    }
+}
+
+sensor_t* esp_camera_sensor_get() {
+    return camera.initialized ? &camera.sensor : NULL;
+}
+
+namespace hal {
+namespace sim {
+
+void setSceneComplexity(float complexity) {
+    std::lock_guard<std::mutex> guard(camera.lock);
+    camera.sceneComplexity = complexity > 0 ? complexity : 1.0f;
+}
+
+void setScene(SimScene scene) {
+    std::lock_guard<std::mutex> guard(camera.lock);
+    camera.scene = scene;
+}
+
+uint32_t framesCaptured() {
+    return camera.framesCaptured;
+}
+
+uint32_t sccbTransactions() {
+    return camera.sccbTransactions;
+}
+
+uint32_t framesDropped() {
+    return camera.framesDropped;
+}
+
+} // namespace sim
+} // namespace hal
+
+#endif // ARDUINO
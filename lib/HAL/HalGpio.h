@@ -0,0 +1,116 @@
+#ifndef HALGPIO_H
+#define HALGPIO_H
+
+// GPIO con el número de pin como parámetro de plantilla (ver HalBoard.h).
+//
+// hal::gpioWrite() pasa por digitalWrite(): busca el pin en tiempo de
+// ejecución y llega a gpio_set_level(). Con el pin constante, FastPin<N>
+// compila a una sola escritura en GPIO_OUT_W1TS/W1TC (o OUT1 para 32-48).
+//
+// hal::Ultrasonic<TRIG, ECHO>::ping() es la medición del HC-SR04 sobre esos
+// registros: el pulso de 10 µs se cuenta en ciclos del CPU con las
+// interrupciones de este núcleo apagadas (ni el Wi-Fi ni el tick de FreeRTOS
+// lo estiran) y el eco se mide leyendo GPIO_IN con el contador de ciclos en
+// lugar de pulseIn()/micros(). ParkingSensor::setPing() la usa en lugar de
+// la ruta con pines en tiempo de ejecución.
+//
+// En el host ambas rutas llegan a la misma simulación (hal::gpioWrite y
+// hal::pulseInHigh), así que dan el mismo eco.
+
+#include "Hal.h"
+
+#ifdef ARDUINO
+#include <soc/gpio_struct.h>
+#include <freertos/FreeRTOS.h>
+#endif
+
+namespace hal {
+
+template <int PIN>
+struct FastPin {
+    static_assert(PIN >= 0 && PIN <= 48, "GPIO fuera de rango");
+
+#ifdef ARDUINO
+    static void output() { ::pinMode(PIN, OUTPUT); }
+    static void input() { ::pinMode(PIN, INPUT); }
+    static void write(bool high) {
+        // PIN es constante: el compilador deja solo una de las cuatro ramas
+        if (PIN < 32) {
+            if (high) GPIO.out_w1ts = 1UL << (PIN & 31);
+            else GPIO.out_w1tc = 1UL << (PIN & 31);
+        } else {
+            if (high) GPIO.out1_w1ts.val = 1UL << (PIN & 31);
+            else GPIO.out1_w1tc.val = 1UL << (PIN & 31);
+        }
+    }
+    static bool read() {
+        return PIN < 32 ? (GPIO.in >> (PIN & 31)) & 1 : (GPIO.in1.val >> (PIN & 31)) & 1;
+    }
+#else
+    static void output() { gpioOutput(PIN); }
+    static void input() { gpioInput(PIN); }
+    static void write(bool high) { gpioWrite(PIN, high); }
+#endif
+};
+
+template <int TRIG, int ECHO>
+struct Ultrasonic {
+    static_assert(TRIG != ECHO, "Trigger y eco del HC-SR04 en el mismo pin");
+
+    static void begin() {
+        FastPin<TRIG>::output();
+        FastPin<ECHO>::input();
+        FastPin<TRIG>::write(false);
+    }
+
+    // 2 µs en bajo y 10 µs en alto (la parte que mide el benchmark trigger_pulse_fast)
+    static void trigger() {
+#ifdef ARDUINO
+        static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+        uint32_t pulseCycles = 10 * ESP.getCpuFreqMHz();
+        FastPin<TRIG>::write(false);
+        ::delayMicroseconds(2);
+        portENTER_CRITICAL(&mux);
+        uint32_t start = ESP.getCycleCount();
+        FastPin<TRIG>::write(true);
+        while (ESP.getCycleCount() - start < pulseCycles) {
+        }
+        FastPin<TRIG>::write(false);
+        portEXIT_CRITICAL(&mux);
+#else
+        FastPin<TRIG>::write(false);
+        delayMicros(2);
+        FastPin<TRIG>::write(true);
+        delayMicros(10);
+        FastPin<TRIG>::write(false);
+#endif
+    }
+
+    // Duración del eco en µs; 0 si no llegó dentro de timeoutUs (como pulseIn)
+    static unsigned long echo(unsigned long timeoutUs) {
+#ifdef ARDUINO
+        uint32_t cyclesPerUs = ESP.getCpuFreqMHz();
+        uint32_t timeoutCycles = (uint32_t)timeoutUs * cyclesPerUs;
+        uint32_t start = ESP.getCycleCount();
+        while (!FastPin<ECHO>::read()) {
+            if (ESP.getCycleCount() - start >= timeoutCycles) return 0;
+        }
+        uint32_t rise = ESP.getCycleCount();
+        while (FastPin<ECHO>::read()) {
+            if (ESP.getCycleCount() - start >= timeoutCycles) return 0;
+        }
+        return (ESP.getCycleCount() - rise) / cyclesPerUs;
+#else
+        return pulseInHigh(ECHO, timeoutUs);
+#endif
+    }
+
+    static unsigned long ping(unsigned long timeoutUs) {
+        trigger();
+        return echo(timeoutUs);
+    }
+};
+
+} // namespace hal
+
+#endif // HALGPIO_H
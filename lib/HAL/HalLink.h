@@ -0,0 +1,72 @@
+#ifndef HALLINK_H
+#define HALLINK_H
+
+// Enlace local entre placas para el modo gateway (lib/Gateway): tramas
+// cortas de las hojas al gateway sin asociarse al punto de acceso.
+//
+// En el ESP32 es ESP-NOW: la hoja solo pone el Wi-Fi en modo estación en el
+// canal del punto de acceso (el del gateway) y envía con confirmación de la
+// capa MAC, reintentando hasta LINK_SEND_RETRIES veces. El gateway sigue
+// asociado al AP y recibe de cualquier hoja en una cola que llena la tarea
+// de Wi-Fi. Solo puede haber un LocalLink por placa.
+//
+// En el host es UDP: la hoja envía a "host:puerto" y el gateway escucha en
+// un puerto (0 = uno libre, ver port()). Sin confirmación: una trama perdida
+// se pierde.
+
+#include "Hal.h"
+
+#define LINK_MAX_FRAME 64           // Bytes por trama (ESP-NOW admite hasta 250)
+#define LINK_QUEUE_DEPTH 64         // Tramas recibidas en espera (ESP32)
+#define LINK_SEND_RETRIES 3         // Reintentos sin confirmación MAC (ESP32)
+#define LINK_SEND_TIMEOUT_MS 30     // Espera de la confirmación de cada envío (ESP32)
+#define LINK_DEFAULT_PORT 9100      // Puerto UDP del gateway (host)
+
+namespace hal {
+
+struct LinkStats {
+    uint32_t sent;
+    uint32_t sendFailures;          // Sin confirmación tras los reintentos (o error de sendto)
+    uint32_t retries;
+    uint32_t received;
+    uint32_t overflows;             // Tramas descartadas con la cola llena (ESP32)
+};
+
+class LocalLink {
+private:
+#ifdef ARDUINO
+    uint8_t peer[6];
+#else
+    int socketFd;
+    uint16_t boundPort;
+#endif
+    LinkStats stats;
+
+public:
+    LocalLink();
+    ~LocalLink();
+
+    LocalLink(const LocalLink&) = delete;
+    LocalLink& operator=(const LocalLink&) = delete;
+
+    // Hoja: gateway como MAC "aa:bb:cc:dd:ee:ff" (ESP32) o "host:puerto" (host)
+    bool beginLeaf(const char* gateway);
+
+    // Gateway: recibir de cualquier hoja (el puerto solo se usa en el host)
+    bool beginGateway(uint16_t port = LINK_DEFAULT_PORT);
+
+    void end();
+
+    // true si la trama salió (en el ESP32, con confirmación MAC del gateway)
+    bool send(const uint8_t* data, size_t length);
+
+    // Una trama recibida sin bloquear; 0 si no hay ninguna
+    size_t receive(uint8_t* buffer, size_t size);
+
+    uint16_t port() const;          // Puerto UDP del gateway (host); 0 en el ESP32
+    const LinkStats& getStats() const { return stats; }
+};
+
+} // namespace hal
+
+#endif // HALLINK_H
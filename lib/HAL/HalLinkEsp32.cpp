@@ -0,0 +1,144 @@
+#ifdef ARDUINO
+
+#include "HalLink.h"
+
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+namespace hal {
+
+// Los callbacks de ESP-NOW son globales y corren en la tarea de Wi-Fi
+struct LinkItem {
+    uint8_t length;
+    uint8_t data[LINK_MAX_FRAME];
+};
+
+static QueueHandle_t receiveQueue = NULL;
+static SemaphoreHandle_t sendDone = NULL;
+static volatile bool sendDelivered = false;
+static volatile uint32_t receiveOverflows = 0;
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+static void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int length) {
+    (void)info;
+#else
+static void onReceive(const uint8_t* mac, const uint8_t* data, int length) {
+    (void)mac;
+#endif
+    if (length <= 0 || length > LINK_MAX_FRAME) {
+        return;
+    }
+    LinkItem item;
+    item.length = (uint8_t)length;
+    memcpy(item.data, data, length);
+    if (xQueueSend(receiveQueue, &item, 0) != pdTRUE) {
+        receiveOverflows++;
+    }
+}
+
+static void onSent(const uint8_t* mac, esp_now_send_status_t status) {
+    (void)mac;
+    sendDelivered = status == ESP_NOW_SEND_SUCCESS;
+    xSemaphoreGive(sendDone);
+}
+
+static bool parseMac(const char* text, uint8_t* mac) {
+    unsigned int b[6];
+    if (sscanf(text, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t)b[i];
+    }
+    return true;
+}
+
+static bool initEspNow() {
+    if (sendDone == NULL) {
+        sendDone = xSemaphoreCreateBinary();
+        receiveQueue = xQueueCreate(LINK_QUEUE_DEPTH, sizeof(LinkItem));
+    }
+    // ESP-NOW necesita el Wi-Fi encendido; la hoja no se asocia a ningún AP
+    if (WiFi.getMode() == WIFI_OFF) {
+        WiFi.mode(WIFI_STA);
+    }
+    return esp_now_init() == ESP_OK &&
+           esp_now_register_send_cb(onSent) == ESP_OK &&
+           esp_now_register_recv_cb(onReceive) == ESP_OK;
+}
+
+LocalLink::LocalLink() {
+    memset(peer, 0, sizeof(peer));
+    memset(&stats, 0, sizeof(stats));
+}
+
+LocalLink::~LocalLink() {
+    end();
+}
+
+bool LocalLink::beginLeaf(const char* gateway) {
+    if (!parseMac(gateway, peer) || !initEspNow()) {
+        return false;
+    }
+    esp_now_peer_info_t info;
+    memset(&info, 0, sizeof(info));
+    memcpy(info.peer_addr, peer, 6);
+    info.channel = 0;               // El canal actual de la radio
+    info.ifidx = WIFI_IF_STA;
+    info.encrypt = false;
+    return esp_now_add_peer(&info) == ESP_OK;
+}
+
+bool LocalLink::beginGateway(uint16_t port) {
+    (void)port;
+    return initEspNow();
+}
+
+void LocalLink::end() {
+    esp_now_deinit();
+}
+
+bool LocalLink::send(const uint8_t* data, size_t length) {
+    if (length > LINK_MAX_FRAME) {
+        return false;
+    }
+    for (int attempt = 0; attempt <= LINK_SEND_RETRIES; attempt++) {
+        if (attempt > 0) {
+            stats.retries++;
+        }
+        xSemaphoreTake(sendDone, 0);
+        if (esp_now_send(peer, data, length) != ESP_OK) {
+            continue;
+        }
+        if (xSemaphoreTake(sendDone, pdMS_TO_TICKS(LINK_SEND_TIMEOUT_MS)) == pdTRUE && sendDelivered) {
+            stats.sent++;
+            return true;
+        }
+    }
+    stats.sendFailures++;
+    return false;
+}
+
+size_t LocalLink::receive(uint8_t* buffer, size_t size) {
+    stats.overflows = receiveOverflows;
+    LinkItem item;
+    if (receiveQueue == NULL || xQueueReceive(receiveQueue, &item, 0) != pdTRUE) {
+        return 0;
+    }
+    size_t length = item.length < size ? item.length : size;
+    memcpy(buffer, item.data, length);
+    stats.received++;
+    return length;
+}
+
+uint16_t LocalLink::port() const {
+    return 0;
+}
+
+} // namespace hal
+
+#endif // ARDUINO
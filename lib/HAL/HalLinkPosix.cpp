@@ -0,0 +1,119 @@
+#ifndef ARDUINO
+
+#include "HalLink.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace hal {
+
+LocalLink::LocalLink() {
+    socketFd = -1;
+    boundPort = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+LocalLink::~LocalLink() {
+    end();
+}
+
+bool LocalLink::beginLeaf(const char* gateway) {
+    end();
+
+    // "host:puerto"
+    char host[64];
+    const char* colon = strrchr(gateway, ':');
+    if (colon == NULL || (size_t)(colon - gateway) >= sizeof(host)) {
+        return false;
+    }
+    memcpy(host, gateway, colon - gateway);
+    host[colon - gateway] = '\0';
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(host, colon + 1, &hints, &result) != 0 || result == NULL) {
+        return false;
+    }
+
+    socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    // connect() fija el destino: send() sin dirección en cada trama
+    bool ok = socketFd >= 0 && ::connect(socketFd, result->ai_addr, result->ai_addrlen) == 0;
+    freeaddrinfo(result);
+    if (!ok) {
+        end();
+    }
+    return ok;
+}
+
+bool LocalLink::beginGateway(uint16_t port) {
+    end();
+    socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (socketFd < 0) {
+        return false;
+    }
+
+    // Ráfagas de cientos de hojas entre dos update() del gateway
+    int buffer = 1 << 20;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    socklen_t length = sizeof(address);
+    if (bind(socketFd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        getsockname(socketFd, (struct sockaddr*)&address, &length) != 0) {
+        end();
+        return false;
+    }
+    boundPort = ntohs(address.sin_port);
+    return true;
+}
+
+void LocalLink::end() {
+    if (socketFd >= 0) {
+        close(socketFd);
+    }
+    socketFd = -1;
+    boundPort = 0;
+}
+
+bool LocalLink::send(const uint8_t* data, size_t length) {
+    if (socketFd < 0 || length > LINK_MAX_FRAME) {
+        return false;
+    }
+    if (::send(socketFd, data, length, MSG_NOSIGNAL) != (ssize_t)length) {
+        stats.sendFailures++;
+        return false;
+    }
+    stats.sent++;
+    return true;
+}
+
+size_t LocalLink::receive(uint8_t* buffer, size_t size) {
+    if (socketFd < 0) {
+        return 0;
+    }
+    ssize_t n = recv(socketFd, buffer, size, MSG_DONTWAIT);
+    if (n <= 0) {
+        return 0;
+    }
+    stats.received++;
+    return (size_t)n;
+}
+
+uint16_t LocalLink::port() const {
+    return boundPort;
+}
+
+} // namespace hal
+
+#endif // ARDUINO
@@ -0,0 +1,102 @@
+#ifndef ARDUINO
+
+#include "Hal.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+HostSerial Serial;
+
+// ---- String ----
+
+String::String(int value) : data(std::to_string(value)) {}
+String::String(unsigned int value) : data(std::to_string(value)) {}
+String::String(long value) : data(std::to_string(value)) {}
+String::String(unsigned long value) : data(std::to_string(value)) {}
+String::String(long long value) : data(std::to_string(value)) {}
+String::String(unsigned long long value) : data(std::to_string(value)) {}
+
+String::String(float value, unsigned int decimals) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, (double)value);
+    data = buffer;
+}
+
+String::String(double value, unsigned int decimals) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+    data = buffer;
+}
+
+int String::indexOf(char c) const {
+    size_t position = data.find(c);
+    return position == std::string::npos ? -1 : (int)position;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > data.size()) return String();
+    if (to > data.size()) to = (unsigned int)data.size();
+    if (to < from) return String();
+    return String(data.substr(from, to - from));
+}
+
+long String::toInt() const {
+    return strtol(data.c_str(), NULL, 10);
+}
+
+float String::toFloat() const {
+    return strtof(data.c_str(), NULL);
+}
+
+// ---- Serial ----
+
+size_t HostSerial::print(const char* text) {
+    if (!hal::sim::currentBoard().serialEnabled) return 0;
+    return fputs(text, stdout) < 0 ? 0 : strlen(text);
+}
+
+size_t HostSerial::print(char c) {
+    char text[2] = {c, '\0'};
+    return print(text);
+}
+
+size_t HostSerial::print(int value) {
+    return print(String(value));
+}
+
+size_t HostSerial::print(unsigned long value) {
+    return print(String(value));
+}
+
+size_t HostSerial::println() {
+    return print("\n");
+}
+
+size_t HostSerial::println(const char* text) {
+    if (!hal::sim::currentBoard().serialEnabled) return 0;
+    // Una sola escritura para que las líneas de varios hilos no se mezclen
+    return printf("%s\n", text);
+}
+
+size_t HostSerial::println(int value) {
+    return println(String(value));
+}
+
+size_t HostSerial::println(unsigned long value) {
+    return println(String(value));
+}
+
+size_t HostSerial::printf(const char* format, ...) {
+    if (!hal::sim::currentBoard().serialEnabled) return 0;
+    va_list args;
+    va_start(args, format);
+    int written = vprintf(format, args);
+    va_end(args);
+    return written < 0 ? 0 : (size_t)written;
+}
+
+void HostSerial::flush() {
+    fflush(stdout);
+}
+
+#endif // ARDUINO
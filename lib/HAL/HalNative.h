@@ -0,0 +1,81 @@
+#ifndef HALNATIVE_H
+#define HALNATIVE_H
+
+// Subconjunto de la API de Arduino (String, Serial) para compilar en el host.
+// Solo se incluye desde Hal.h cuando ARDUINO no está definido.
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+
+// Cadena compatible con la String de Arduino para los usos del proyecto
+class String {
+private:
+    std::string data;
+
+public:
+    String() {}
+    String(const char* text) : data(text ? text : "") {}
+    String(const std::string& text) : data(text) {}
+    String(char c) : data(1, c) {}
+    explicit String(int value);
+    explicit String(unsigned int value);
+    explicit String(long value);
+    explicit String(unsigned long value);
+    explicit String(long long value);
+    explicit String(unsigned long long value);
+    String(float value, unsigned int decimals = 2);
+    String(double value, unsigned int decimals = 2);
+
+    const char* c_str() const { return data.c_str(); }
+    unsigned int length() const { return (unsigned int)data.size(); }
+    bool reserve(unsigned int size) { data.reserve(size); return true; }
+    char operator[](unsigned int index) const { return data[index]; }
+    bool operator==(const String& other) const { return data == other.data; }
+    bool operator==(const char* other) const { return data == other; }
+    bool operator!=(const String& other) const { return data != other.data; }
+    bool startsWith(const String& prefix) const { return data.compare(0, prefix.data.size(), prefix.data) == 0; }
+    int indexOf(char c) const;
+    String substring(unsigned int from, unsigned int to) const;
+    String substring(unsigned int from) const { return substring(from, length()); }
+    long toInt() const;
+    float toFloat() const;
+
+    String& operator+=(const String& other) { data += other.data; return *this; }
+    String& operator+=(const char* other) { data += other; return *this; }
+    String& operator+=(char c) { data += c; return *this; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.data + b.data); }
+    friend String operator+(const String& a, const char* b) { return String(a.data + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.data); }
+    friend String operator+(const String& a, char b) { return String(a.data + b); }
+};
+
+// Puerto serie del host: escribe en stdout
+class HostSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void setDebugOutput(bool enable) { (void)enable; }
+    size_t print(const char* text);
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t print(char c);
+    size_t print(int value);
+    size_t print(unsigned long value);
+    size_t println();
+    size_t println(const char* text);
+    size_t println(const String& text) { return println(text.c_str()); }
+    size_t println(int value);
+    size_t println(unsigned long value);
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flush();
+};
+
+extern HostSerial Serial;
+
+#endif // ARDUINO
+
+#endif // HALNATIVE_H
@@ -0,0 +1,41 @@
+#ifndef HALOTA_H
+#define HALOTA_H
+
+// Actualización de firmware: lectura de la imagen en ejecución (base de los
+// parches delta) y escritura secuencial de la partición inactiva.
+//
+// En el ESP32 usa esp_ota_* sobre la tabla de particiones con dos slots
+// (app0/app1); la partición se borra a medida que se escribe, sin reservar
+// la imagen en RAM. En el host la imagen en ejecución y la partición son
+// buffers de la placa simulada (hal::sim::Board).
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace hal {
+
+// Identificador de la imagen en ejecución: los primeros 16 dígitos hex del
+// SHA-256 del ELF (el mismo que calcula ota_delta.py a partir del .bin)
+const char* firmwareId();
+
+bool runningImageRead(uint32_t offset, uint8_t* buffer, size_t size);
+
+bool otaBegin();                                // Descarta cualquier escritura anterior
+bool otaWrite(const uint8_t* data, size_t size);
+bool otaEnd();                                  // Valida la imagen y la deja para el próximo arranque
+void otaAbort();
+
+#ifndef ARDUINO
+
+namespace sim {
+
+void setRunningImage(const uint8_t* image, size_t size, const char* firmwareId);
+void setOtaPartition(uint8_t* buffer, size_t capacity);
+
+} // namespace sim
+
+#endif
+
+} // namespace hal
+
+#endif // HALOTA_H
@@ -0,0 +1,74 @@
+#ifdef ARDUINO
+
+#include "HalOta.h"
+
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+namespace hal {
+
+static const esp_partition_t* otaTarget = NULL;
+static esp_ota_handle_t otaHandle = 0;
+
+const char* firmwareId() {
+    static char id[17] = "";
+    if (id[0] == '\0') {
+        esp_ota_get_app_elf_sha256(id, sizeof(id));
+    }
+    return id;
+}
+
+bool runningImageRead(uint32_t offset, uint8_t* buffer, size_t size) {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (running == NULL || offset > running->size || size > running->size - offset) {
+        return false;
+    }
+    return esp_partition_read(running, offset, buffer, size) == ESP_OK;
+}
+
+bool otaBegin() {
+    otaAbort();
+    otaTarget = esp_ota_get_next_update_partition(NULL);
+    if (otaTarget == NULL) {
+        Serial.println("❌ OTA: no hay partición inactiva (tabla sin app1)");
+        return false;
+    }
+    // Borrado por sectores a medida que se escribe: sin la pausa de borrar
+    // la partición completa al empezar
+    if (esp_ota_begin(otaTarget, OTA_WITH_SEQUENTIAL_WRITES, &otaHandle) != ESP_OK) {
+        otaTarget = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool otaWrite(const uint8_t* data, size_t size) {
+    return otaTarget != NULL && esp_ota_write(otaHandle, data, size) == ESP_OK;
+}
+
+bool otaEnd() {
+    if (otaTarget == NULL) {
+        return false;
+    }
+    // esp_ota_end verifica la imagen (cabecera, segmentos y hash) antes de aceptarla
+    esp_err_t err = esp_ota_end(otaHandle);
+    const esp_partition_t* target = otaTarget;
+    otaTarget = NULL;
+    if (err != ESP_OK) {
+        Serial.printf("❌ OTA: imagen inválida (%s)\n", esp_err_to_name(err));
+        return false;
+    }
+    return esp_ota_set_boot_partition(target) == ESP_OK;
+}
+
+void otaAbort() {
+    if (otaTarget != NULL) {
+        esp_ota_abort(otaHandle);
+        otaTarget = NULL;
+    }
+}
+
+} // namespace hal
+
+#endif // ARDUINO
@@ -0,0 +1,83 @@
+#ifndef ARDUINO
+
+#include "Hal.h"
+#include "HalOta.h"
+
+#include <string.h>
+
+namespace hal {
+
+namespace sim {
+
+void setRunningImage(const uint8_t* image, size_t size, const char* firmwareId) {
+    Board& board = currentBoard();
+    board.runningImage = image;
+    board.runningImageSize = image != NULL ? size : 0;
+    board.firmwareId = firmwareId != NULL ? firmwareId : "native";
+}
+
+void setOtaPartition(uint8_t* buffer, size_t capacity) {
+    Board& board = currentBoard();
+    board.otaPartition = buffer;
+    board.otaCapacity = buffer != NULL ? capacity : 0;
+    board.otaWritten = 0;
+    board.otaOpen = false;
+    board.otaCompleted = false;
+}
+
+} // namespace sim
+
+const char* firmwareId() {
+    return sim::currentBoard().firmwareId;
+}
+
+bool runningImageRead(uint32_t offset, uint8_t* buffer, size_t size) {
+    sim::Board& board = sim::currentBoard();
+    if (board.runningImage == NULL || offset > board.runningImageSize ||
+        size > board.runningImageSize - offset) {
+        return false;
+    }
+    memcpy(buffer, board.runningImage + offset, size);
+    return true;
+}
+
+bool otaBegin() {
+    sim::Board& board = sim::currentBoard();
+    if (board.otaPartition == NULL) {
+        return false;
+    }
+    board.otaWritten = 0;
+    board.otaOpen = true;
+    board.otaCompleted = false;
+    return true;
+}
+
+bool otaWrite(const uint8_t* data, size_t size) {
+    sim::Board& board = sim::currentBoard();
+    if (!board.otaOpen || size > board.otaCapacity - board.otaWritten) {
+        return false;
+    }
+    memcpy(board.otaPartition + board.otaWritten, data, size);
+    board.otaWritten += size;
+    return true;
+}
+
+bool otaEnd() {
+    sim::Board& board = sim::currentBoard();
+    if (!board.otaOpen || board.otaWritten == 0) {
+        return false;
+    }
+    board.otaOpen = false;
+    board.otaCompleted = true;
+    return true;
+}
+
+void otaAbort() {
+    sim::Board& board = sim::currentBoard();
+    board.otaOpen = false;
+    board.otaWritten = 0;
+}
+
+} // namespace hal
+
+#endif // ARDUINO
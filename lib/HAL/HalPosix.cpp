@@ -0,0 +1,220 @@
+#ifndef ARDUINO
+
+#include "Hal.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <random>
+
+namespace hal {
+
+namespace sim {
+
+static thread_local Board* boundBoard = NULL;
+
+void initBoard(Board& board) {
+    board.distanceSource = NULL;
+    board.context = NULL;
+    board.fixedDistance = 80.0f;
+    board.timeScale = 1.0;
+    board.serialEnabled = true;
+    board.rssi = -55;
+    board.triggered = false;
+    board.restartRequested = false;
+    board.resetReason = RESET_POWERON;
+    board.packetLoss = 0.0;
+    board.runningImage = NULL;
+    board.runningImageSize = 0;
+    board.firmwareId = "native";
+    board.otaPartition = NULL;
+    board.otaCapacity = 0;
+    board.otaWritten = 0;
+    board.otaOpen = false;
+    board.otaCompleted = false;
+}
+
+void bindBoard(Board* board) {
+    boundBoard = board;
+}
+
+Board& currentBoard() {
+    if (boundBoard != NULL) {
+        return *boundBoard;
+    }
+    // Placa por defecto, compartida por los hilos sin placa propia
+    static Board defaultBoard = [] { Board board; initBoard(board); return board; }();
+    return defaultBoard;
+}
+
+void setFixedDistance(float cm) {
+    currentBoard().fixedDistance = cm;
+}
+
+void setSerialEnabled(bool enabled) {
+    currentBoard().serialEnabled = enabled;
+}
+
+void setTimeScale(double scale) {
+    currentBoard().timeScale = scale > 0 ? scale : 1.0;
+}
+
+void setResetReason(ResetReason reason) {
+    currentBoard().resetReason = reason;
+}
+
+void setPacketLoss(double probability) {
+    currentBoard().packetLoss = probability;
+}
+
+bool packetLost() {
+    double loss = currentBoard().packetLoss;
+    return loss > 0 && (double)random32() < loss * 4294967296.0;
+}
+
+} // namespace sim
+
+// ---- Reloj ----
+
+static uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Instante de "arranque" de la placa, como millis() en el ESP32
+static const uint64_t bootNs = monotonicNs();
+
+static uint64_t elapsedNs() {
+    return (uint64_t)((double)(monotonicNs() - bootNs) * sim::currentBoard().timeScale);
+}
+
+unsigned long millis() {
+    return (unsigned long)(elapsedNs() / 1000000ULL);
+}
+
+unsigned long micros() {
+    return (unsigned long)(elapsedNs() / 1000ULL);
+}
+
+void delayMs(unsigned long ms) {
+    usleep((useconds_t)((double)ms * 1000.0 / sim::currentBoard().timeScale));
+}
+
+void delayMicros(unsigned int us) {
+    // Los retardos cortos del trigger no aportan nada en el host
+    (void)us;
+}
+
+// ---- GPIO ----
+// Solo se simula el HC-SR04: un pulso en cualquier salida arma el trigger
+// y pulseInHigh() devuelve el eco correspondiente a la distancia simulada.
+
+void gpioOutput(int pin) {
+    (void)pin;
+}
+
+void gpioInput(int pin) {
+    (void)pin;
+}
+
+void gpioWrite(int pin, bool high) {
+    (void)pin;
+    if (high) {
+        sim::currentBoard().triggered = true;
+    }
+}
+
+unsigned long pulseInHigh(int pin, unsigned long timeoutUs) {
+    (void)pin;
+    sim::Board& board = sim::currentBoard();
+    if (!board.triggered) {
+        return 0;
+    }
+    board.triggered = false;
+
+    float distance = board.distanceSource != NULL
+        ? board.distanceSource(board.context, millis())
+        : board.fixedDistance;
+    if (distance < 0) {
+        return 0;
+    }
+
+    // Inverso de distance = duration * 0.0343 / 2
+    unsigned long duration = (unsigned long)(distance * 2.0f / 0.0343f + 0.5f);
+    return duration > timeoutUs ? 0 : duration;
+}
+
+// ---- Memoria ----
+
+uint32_t freeHeap() {
+    return memoryStats().freeHeap;
+}
+
+bool psramFound() {
+    return false;
+}
+
+MemoryStats memoryStats() {
+    static uint32_t minFree = UINT32_MAX;
+    struct mallinfo2 info = mallinfo2();
+
+    MemoryStats stats;
+    stats.totalHeap = (uint32_t)info.arena;
+    stats.freeHeap = (uint32_t)info.fordblks;
+    if (stats.freeHeap < minFree) {
+        minFree = stats.freeHeap;
+    }
+    stats.minFreeHeap = minFree;
+    stats.largestFreeBlock = (uint32_t)info.fordblks;
+    stats.totalPsram = 0;
+    stats.freePsram = 0;
+    return stats;
+}
+
+// ---- Sistema ----
+
+const char* chipModel() {
+    return "host";
+}
+
+uint32_t chipRevision() {
+    return 0;
+}
+
+uint32_t cpuFreqMHz() {
+    return 0;
+}
+
+uint32_t flashSize() {
+    return 0;
+}
+
+uint32_t flashSpeed() {
+    return 0;
+}
+
+void restart() {
+    // En el host no se reinicia el proceso: quien controla la simulación decide
+    sim::currentBoard().restartRequested = true;
+    sim::currentBoard().resetReason = RESET_SOFTWARE;
+}
+
+ResetReason resetReason() {
+    return sim::currentBoard().resetReason;
+}
+
+uint32_t random32() {
+    static thread_local std::mt19937 generator(std::random_device{}());
+    return generator();
+}
+
+// ---- Wi-Fi ----
+
+int wifiRssi() {
+    return sim::currentBoard().rssi;
+}
+
+} // namespace hal
+
+#endif // ARDUINO
@@ -0,0 +1,142 @@
+#ifndef HALSOCKET_H
+#define HALSOCKET_H
+
+// Cliente TCP de la HAL. En el ESP32 es directamente WiFiClient; en el host
+// es una implementación sobre sockets POSIX con la misma interfaz.
+//
+// hal::TcpServer acepta conexiones entrantes (vista en vivo, lib/LiveView)
+// sin bloquear: accept() entrega la conexión en un TcpClient, y
+// hal::tcpWriteSome() escribe sin esperar a que el otro lado lea (write()
+// de WiFiClient reintenta hasta ~10 s con la ventana llena).
+//
+// hal::NetClient es la interfaz común de los transportes (TCP o TLS, ver
+// HalTls.h): en el ESP32 es la clase Client de Arduino.
+
+#include "Hal.h"
+
+#ifdef ARDUINO
+
+#include <WiFi.h>
+#include <errno.h>
+#include <lwip/sockets.h>
+
+namespace hal {
+typedef ::Client NetClient;
+typedef WiFiClient TcpClient;
+
+// Bytes que aceptó la pila TCP; 0 con el buffer de envío lleno, -1 si la
+// conexión se cerró
+inline int tcpWriteSome(TcpClient& client, const uint8_t* data, size_t length) {
+    int fd = client.fd();
+    if (fd < 0) {
+        return -1;
+    }
+    int rc = send(fd, data, length, MSG_DONTWAIT);
+    if (rc >= 0) {
+        return rc;
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+}
+
+class TcpServer {
+private:
+    WiFiServer server;
+
+public:
+    bool begin(uint16_t port) {
+        server.begin(port);
+        server.setNoDelay(true);
+        return (bool)server;
+    }
+    void stop() { server.end(); }
+
+    // false si no hay ninguna conexión pendiente
+    bool accept(TcpClient& client) {
+        WiFiClient incoming = server.available();
+        if (!incoming) {
+            return false;
+        }
+        client = incoming;
+        return true;
+    }
+};
+}
+
+#else
+
+namespace hal {
+
+// Subconjunto de Client de Arduino que usan las librerías
+class NetClient {
+public:
+    virtual ~NetClient() {}
+
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual uint8_t connected() = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t* buffer, size_t size) = 0;
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+    virtual void flush() {}
+    virtual void stop() = 0;
+
+    size_t print(const char* text);
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t println(const char* text);
+    size_t println(const String& text) { return println(text.c_str()); }
+};
+
+class TcpClient : public NetClient {
+private:
+    int socketFd;
+    uint32_t connectTimeoutMs;
+
+    size_t writeAll(const uint8_t* data, size_t length);
+
+public:
+    TcpClient();
+    ~TcpClient();
+
+    // No copiable: el descriptor pertenece a una sola instancia
+    TcpClient(const TcpClient&) = delete;
+    TcpClient& operator=(const TcpClient&) = delete;
+
+    int connect(const char* host, uint16_t port) override;
+    uint8_t connected() override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void stop() override;
+    void setTimeout(uint32_t timeoutMs) { connectTimeoutMs = timeoutMs; }
+    int fd() const { return socketFd; }
+
+    friend class TcpServer;
+};
+
+class TcpServer {
+private:
+    int listenFd;
+
+public:
+    TcpServer();
+    ~TcpServer();
+
+    TcpServer(const TcpServer&) = delete;
+    TcpServer& operator=(const TcpServer&) = delete;
+
+    bool begin(uint16_t port);              // 0 = puerto libre
+    void stop();
+    bool accept(TcpClient& client);
+    uint16_t localPort() const;             // Solo en el host (pruebas)
+};
+
+int tcpWriteSome(TcpClient& client, const uint8_t* data, size_t length);
+
+} // namespace hal
+
+#endif
+
+#endif // HALSOCKET_H
@@ -0,0 +1,259 @@
+#ifndef ARDUINO
+
+#include "HalSocket.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+namespace hal {
+
+// Pérdida simulada (sim::setPacketLoss): el kernel retransmite, así que un
+// segmento perdido solo llega tarde. RTO inicial de Linux: 1 s para el SYN,
+// 200 ms para los datos, el doble en cada pérdida seguida.
+#define SIM_SYN_RTO_MS 1000
+#define SIM_TCP_RTO_MS 200
+#define SIM_MAX_RETRANSMITS 6
+#define SIM_SEND_BUFFER 5744     // CONFIG_LWIP_TCP_SND_BUF_DEFAULT
+
+static void simulateRetransmits(unsigned long rtoMs) {
+    for (int i = 0; i < SIM_MAX_RETRANSMITS && sim::packetLost(); i++) {
+        delayMs(rtoMs);
+        rtoMs *= 2;
+    }
+}
+
+size_t NetClient::print(const char* text) {
+    return write((const uint8_t*)text, strlen(text));
+}
+
+size_t NetClient::println(const char* text) {
+    // Una sola escritura con el terminador "\r\n" de Arduino (un registro en TLS)
+    std::string line(text);
+    line += "\r\n";
+    return write((const uint8_t*)line.data(), line.size());
+}
+
+TcpClient::TcpClient() {
+    socketFd = -1;
+    connectTimeoutMs = 3000; // Igual que el timeout por defecto de WiFiClient
+}
+
+TcpClient::~TcpClient() {
+    stop();
+}
+
+int TcpClient::connect(const char* host, uint16_t port) {
+    stop();
+    simulateRetransmits(SIM_SYN_RTO_MS);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = NULL;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    if (getaddrinfo(host, service, &hints, &result) != 0 || result == NULL) {
+        return 0;
+    }
+
+    socketFd = socket(result->ai_family, result->ai_socktype | SOCK_CLOEXEC, result->ai_protocol);
+    if (socketFd < 0) {
+        freeaddrinfo(result);
+        return 0;
+    }
+
+    // Conexión no bloqueante con timeout, como hace WiFiClient
+    int flags = fcntl(socketFd, F_GETFL, 0);
+    fcntl(socketFd, F_SETFL, flags | O_NONBLOCK);
+
+    int rc = ::connect(socketFd, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+
+    if (rc < 0 && errno == EINPROGRESS) {
+        struct pollfd pfd = {socketFd, POLLOUT, 0};
+        rc = poll(&pfd, 1, (int)connectTimeoutMs);
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (rc == 1 && getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+            rc = 0;
+        } else {
+            rc = -1;
+        }
+    }
+
+    if (rc < 0) {
+        stop();
+        return 0;
+    }
+
+    // Las lecturas siguen siendo no bloqueantes; las escrituras esperan
+    int noDelay = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return 1;
+}
+
+uint8_t TcpClient::connected() {
+    if (socketFd < 0) {
+        return 0;
+    }
+
+    // Igual que WiFiClient: con datos pendientes se considera conectado
+    uint8_t probe;
+    ssize_t rc = recv(socketFd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (rc > 0) {
+        return 1;
+    }
+    if (rc == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+int TcpClient::available() {
+    if (socketFd < 0) {
+        return 0;
+    }
+    int count = 0;
+    if (ioctl(socketFd, FIONREAD, &count) < 0) {
+        return 0;
+    }
+    return count;
+}
+
+int TcpClient::read() {
+    uint8_t byte;
+    return read(&byte, 1) == 1 ? byte : -1;
+}
+
+int TcpClient::read(uint8_t* buffer, size_t size) {
+    if (socketFd < 0) {
+        return -1;
+    }
+    ssize_t rc = recv(socketFd, buffer, size, MSG_DONTWAIT);
+    return rc < 0 ? -1 : (int)rc;
+}
+
+size_t TcpClient::writeAll(const uint8_t* data, size_t length) {
+    simulateRetransmits(SIM_TCP_RTO_MS);
+    size_t sent = 0;
+    while (socketFd >= 0 && sent < length) {
+        ssize_t rc = send(socketFd, data + sent, length - sent, MSG_NOSIGNAL);
+        if (rc > 0) {
+            sent += (size_t)rc;
+            continue;
+        }
+        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            struct pollfd pfd = {socketFd, POLLOUT, 0};
+            if (poll(&pfd, 1, (int)connectTimeoutMs) == 1) {
+                continue;
+            }
+        }
+        stop();
+    }
+    return sent;
+}
+
+size_t TcpClient::write(uint8_t byte) {
+    return writeAll(&byte, 1);
+}
+
+size_t TcpClient::write(const uint8_t* buffer, size_t size) {
+    return writeAll(buffer, size);
+}
+
+void TcpClient::stop() {
+    if (socketFd >= 0) {
+        close(socketFd);
+        socketFd = -1;
+    }
+}
+
+TcpServer::TcpServer() {
+    listenFd = -1;
+}
+
+TcpServer::~TcpServer() {
+    stop();
+}
+
+bool TcpServer::begin(uint16_t port) {
+    stop();
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listenFd < 0) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 4) != 0) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void TcpServer::stop() {
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+    }
+}
+
+bool TcpServer::accept(TcpClient& client) {
+    if (listenFd < 0) {
+        return false;
+    }
+    int fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    // Como las de connect(): lecturas sin bloquear, escrituras con espera.
+    // Buffer de envío del tamaño del de lwIP (TCP_SND_BUF): un cliente que no
+    // lee frena las escrituras como en la placa y no como en Linux (MB)
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    int sendBuffer = SIM_SEND_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    client.stop();
+    client.socketFd = fd;
+    return true;
+}
+
+int tcpWriteSome(TcpClient& client, const uint8_t* data, size_t length) {
+    if (client.fd() < 0) {
+        return -1;
+    }
+    ssize_t rc = send(client.fd(), data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (rc >= 0) {
+        return (int)rc;
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+}
+
+uint16_t TcpServer::localPort() const {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (listenFd < 0 || getsockname(listenFd, (struct sockaddr*)&address, &length) != 0) {
+        return 0;
+    }
+    return ntohs(address.sin_port);
+}
+
+} // namespace hal
+
+#endif // ARDUINO
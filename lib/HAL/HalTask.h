@@ -0,0 +1,80 @@
+#ifndef HALTASK_H
+#define HALTASK_H
+
+// Tareas y exclusión mutua de la HAL. En el ESP32 son tareas y mutex de
+// FreeRTOS; en el host, hilos y std::timed_mutex.
+//
+// loop() corre en la tarea de Arduino con prioridad 1. Una tarea con
+// TASK_PRIORITY_BACKGROUND solo avanza cuando loop() espera (delay(), red),
+// y el mutex de FreeRTOS hereda prioridad: si loop() espera un Mutex que
+// tiene la tarea de fondo, ésta corre con la prioridad de loop() hasta
+// soltarlo. En el host la prioridad se aproxima con nice por hilo.
+
+#include "Hal.h"
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+#include <mutex>
+#endif
+
+namespace hal {
+
+#define TASK_PRIORITY_BACKGROUND 0  // Debajo de loop()
+#define TASK_PRIORITY_LOOP 1
+
+#ifdef ARDUINO
+
+class Mutex {
+private:
+    SemaphoreHandle_t handle;
+
+public:
+    Mutex() { handle = xSemaphoreCreateMutex(); }
+    ~Mutex() { vSemaphoreDelete(handle); }
+
+    Mutex(const Mutex&) = delete;
+    Mutex& operator=(const Mutex&) = delete;
+
+    // false si no se obtuvo en timeoutMs (0 = sin esperar)
+    bool lock(unsigned long timeoutMs) { return xSemaphoreTake(handle, pdMS_TO_TICKS(timeoutMs)) == pdTRUE; }
+    bool tryLock() { return xSemaphoreTake(handle, 0) == pdTRUE; }
+    void unlock() { xSemaphoreGive(handle); }
+};
+
+// Tarea en el núcleo de loop(); stackBytes en bytes (ESP-IDF). entry no
+// puede retornar: termina con hal::endTask()
+inline bool startTask(const char* name, void (*entry)(void*), void* arg, uint32_t stackBytes, int priority) {
+    return xTaskCreatePinnedToCore(entry, name, stackBytes, arg, priority, NULL, ARDUINO_RUNNING_CORE) == pdPASS;
+}
+
+inline void endTask() { vTaskDelete(NULL); }
+
+#else
+
+class Mutex {
+private:
+    std::timed_mutex mutex;
+
+public:
+    Mutex() {}
+
+    Mutex(const Mutex&) = delete;
+    Mutex& operator=(const Mutex&) = delete;
+
+    bool lock(unsigned long timeoutMs);     // Espera en tiempo real, sin sim::setTimeScale
+    bool tryLock() { return mutex.try_lock(); }
+    void unlock() { mutex.unlock(); }
+};
+
+// Hilo separado (detach); stackBytes se ignora
+bool startTask(const char* name, void (*entry)(void*), void* arg, uint32_t stackBytes, int priority);
+inline void endTask() {}
+
+#endif
+
+} // namespace hal
+
+#endif // HALTASK_H
@@ -0,0 +1,32 @@
+#ifndef ARDUINO
+
+#include "HalTask.h"
+
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+namespace hal {
+
+bool Mutex::lock(unsigned long timeoutMs) {
+    return mutex.try_lock_for(std::chrono::milliseconds(timeoutMs));
+}
+
+bool startTask(const char* name, void (*entry)(void*), void* arg, uint32_t stackBytes, int priority) {
+    (void)name;
+    (void)stackBytes;
+    std::thread([entry, arg, priority]() {
+        // En Linux nice es por hilo: la tarea de fondo cede la CPU al hilo principal
+        if (priority < TASK_PRIORITY_LOOP) {
+            setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+        }
+        entry(arg);
+    }).detach();
+    return true;
+}
+
+} // namespace hal
+
+#endif // ARDUINO
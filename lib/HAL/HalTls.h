@@ -0,0 +1,148 @@
+#ifndef HALTLS_H
+#define HALTLS_H
+
+// Transporte TLS opcional con la misma interfaz que hal::TcpClient
+// (hal::NetClient). En el ESP32 usa mbedTLS directamente sobre un
+// WiFiClient; en el host, OpenSSL sobre hal::TcpClient.
+//
+// Pensado para una conexión persistente con reconexiones ocasionales:
+// - Solo TLS 1.2 (lo que soporta el mbedTLS del core de Arduino) con
+//   ECDHE + AES-128-GCM; con un certificado ECDSA P-256 el handshake completo
+//   es varias veces más barato que con RSA-2048 en el ESP32.
+// - La sesión (ticket RFC 5077) se guarda al conectar y se ofrece en la
+//   siguiente conexión al mismo servidor: el handshake reanudado no verifica
+//   certificados ni hace ECDHE, solo un ida y vuelta.
+// - Registros de hasta 4 KB (extensión max_fragment_length)
+//   y buffers liberados mientras la conexión está inactiva (host).
+//
+// getStats() reporta handshakes completos/reanudados, su duración y el heap
+// que usaron (ver bench "tls_handshake_*").
+
+#include "HalSocket.h"
+
+#ifdef ARDUINO
+#include <mbedtls/ssl.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/x509_crt.h>
+#else
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+typedef struct ssl_session_st SSL_SESSION;
+#endif
+
+// Tiempo máximo del handshake y de cada escritura bloqueada
+#define TLS_TIMEOUT_MS 5000
+
+#define TLS_MAX_HOST 40
+
+namespace hal {
+
+struct TlsStats {
+    uint32_t fullHandshakes;
+    uint32_t resumedHandshakes;
+    uint32_t failedHandshakes;
+    uint32_t lastHandshakeUs;       // Sin contar la conexión TCP
+    bool lastResumed;
+    uint32_t lastHandshakePeakBytes;  // Pico de heap durante el handshake (muestreado en el ESP32)
+    uint32_t connectionBytes;       // Heap retenido por la conexión abierta
+};
+
+class TlsClient : public NetClient {
+private:
+    TcpClient tcp;
+    const char* caCert;
+    bool resumption;
+    char sessionHost[TLS_MAX_HOST];
+    uint16_t sessionPort;
+    TlsStats stats;
+
+#ifdef ARDUINO
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    mbedtls_x509_crt ca;
+    mbedtls_ssl_session session;
+    bool configured;
+    bool active;
+    bool hasSession;
+    int peekByte;
+
+    bool setup();
+    static int sendCallback(void* context, const unsigned char* data, size_t length);
+    static int recvCallback(void* context, unsigned char* buffer, size_t length);
+#else
+    SSL_CTX* ctx;
+    SSL* ssl;
+    SSL_SESSION* session;
+
+    bool setup();
+    bool waitSocket(int sslError, unsigned long deadline);
+#endif
+
+    bool handshake(const char* host);
+    void saveSession(const char* host, uint16_t port);
+    bool sessionMatches(const char* host, uint16_t port) const;
+
+public:
+    TlsClient();
+    ~TlsClient();
+
+    TlsClient(const TlsClient&) = delete;
+    TlsClient& operator=(const TlsClient&) = delete;
+
+    // PEM de la CA del servidor (o de su certificado autofirmado). Debe
+    // seguir existiendo mientras se use el cliente.
+    void setCACert(const char* pem);
+    void setSessionResumption(bool enabled);
+    void clearSession();
+    bool hasSavedSession() const;
+    const TlsStats& getStats() const { return stats; }
+
+#ifdef ARDUINO
+    int connect(IPAddress ip, uint16_t port) override;
+    int peek() override;
+    operator bool() override { return connected(); }
+#endif
+    int connect(const char* host, uint16_t port) override;
+    uint8_t connected() override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void flush() override {}
+    void stop() override;
+};
+
+#ifndef ARDUINO
+
+namespace sim {
+
+// Servidor TLS en loopback para pruebas y benchmarks: certificado ECDSA
+// autofirmado generado al arrancar, conexiones atendidas de a una. Guarda las
+// líneas recibidas y responde "OK\n" a cada una.
+class TlsTestServer {
+private:
+    struct State;
+    State* state;
+
+public:
+    TlsTestServer();
+    ~TlsTestServer();
+
+    bool start(uint16_t& port);   // Puerto efímero en 127.0.0.1
+    const char* caCert() const;   // PEM del certificado autofirmado
+    uint32_t handshakes() const;
+    uint32_t resumed() const;
+    bool received(const char* text) const;  // Alguna línea contiene text
+};
+
+} // namespace sim
+
+#endif
+
+} // namespace hal
+
+#endif // HALTLS_H
@@ -0,0 +1,337 @@
+#ifdef ARDUINO
+
+#include "HalTls.h"
+
+#include <mbedtls/error.h>
+
+namespace hal {
+
+// Solo lo que negocia el servidor (ver parking_server.py --tls-cert)
+static const int TLS_CIPHERSUITES[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    0
+};
+
+TlsClient::TlsClient() {
+    caCert = NULL;
+    resumption = true;
+    sessionHost[0] = '\0';
+    sessionPort = 0;
+    memset(&stats, 0, sizeof(stats));
+    configured = false;
+    active = false;
+    hasSession = false;
+    peekByte = -1;
+    mbedtls_ssl_session_init(&session);
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    mbedtls_ssl_session_free(&session);
+    if (configured) {
+        mbedtls_ssl_config_free(&conf);
+        mbedtls_x509_crt_free(&ca);
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+    }
+}
+
+void TlsClient::setCACert(const char* pem) {
+    stop();
+    caCert = pem;
+    clearSession();
+    if (configured) {
+        mbedtls_ssl_config_free(&conf);
+        mbedtls_x509_crt_free(&ca);
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+        configured = false;
+    }
+}
+
+void TlsClient::setSessionResumption(bool enabled) {
+    resumption = enabled;
+    if (!enabled) {
+        clearSession();
+    }
+}
+
+void TlsClient::clearSession() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    hasSession = false;
+    sessionHost[0] = '\0';
+}
+
+bool TlsClient::hasSavedSession() const {
+    return hasSession;
+}
+
+bool TlsClient::setup() {
+    if (configured) {
+        return true;
+    }
+    if (caCert == NULL) {
+        Serial.println("❌ TLS sin certificado de CA (setCACert)");
+        return false;
+    }
+
+    // La configuración y la CA se preparan una vez y sobreviven a las reconexiones
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_entropy_init(&entropy);
+    configured = true;
+
+    const char* personalization = "parking-sensor";
+    if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                              (const unsigned char*)personalization, strlen(personalization)) != 0 ||
+        mbedtls_x509_crt_parse(&ca, (const unsigned char*)caCert, strlen(caCert) + 1) != 0 ||
+        mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+        Serial.println("❌ Certificado de CA TLS inválido");
+        setCACert(caCert);
+        return false;
+    }
+
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&conf, &ca, NULL);
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+    mbedtls_ssl_conf_ciphersuites(&conf, TLS_CIPHERSUITES);
+    mbedtls_ssl_conf_min_version(&conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+    mbedtls_ssl_conf_max_version(&conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    // Registros cortos del servidor; los buffers de entrada/salida los fija
+    // la configuración de mbedTLS del core (CONFIG_MBEDTLS_SSL_IN/OUT_CONTENT_LEN)
+    mbedtls_ssl_conf_max_frag_len(&conf, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+#endif
+    return true;
+}
+
+int TlsClient::sendCallback(void* context, const unsigned char* data, size_t length) {
+    TcpClient* tcp = (TcpClient*)context;
+    size_t written = tcp->write(data, length);
+    if (written > 0) {
+        return (int)written;
+    }
+    return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_CONN_RESET;
+}
+
+int TlsClient::recvCallback(void* context, unsigned char* buffer, size_t length) {
+    TcpClient* tcp = (TcpClient*)context;
+    if (tcp->available() <= 0) {
+        return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    int rc = tcp->read(buffer, length);
+    return rc > 0 ? rc : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+bool TlsClient::sessionMatches(const char* host, uint16_t port) const {
+    return hasSession && port == sessionPort && strcmp(host, sessionHost) == 0;
+}
+
+void TlsClient::saveSession(const char* host, uint16_t port) {
+    if (!resumption) {
+        return;
+    }
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    hasSession = mbedtls_ssl_get_session(&ssl, &session) == 0;
+    if (hasSession) {
+        strncpy(sessionHost, host, TLS_MAX_HOST - 1);
+        sessionHost[TLS_MAX_HOST - 1] = '\0';
+        sessionPort = port;
+    }
+}
+
+bool TlsClient::handshake(const char* host) {
+    mbedtls_ssl_init(&ssl);
+    active = true;
+    if (mbedtls_ssl_setup(&ssl, &conf) != 0 || mbedtls_ssl_set_hostname(&ssl, host) != 0) {
+        return false;
+    }
+    mbedtls_ssl_set_bio(&ssl, &tcp, sendCallback, recvCallback, NULL);
+    if (hasSession) {
+        mbedtls_ssl_set_session(&ssl, &session);
+    }
+
+    // El heap del ESP32 no tiene un pico reiniciable: se muestrea en cada espera
+    uint32_t heapBase = hal::freeHeap();
+    uint32_t heapLow = heapBase;
+    unsigned long deadline = ::millis() + TLS_TIMEOUT_MS;
+    int rc;
+    while ((rc = mbedtls_ssl_handshake(&ssl)) != 0) {
+        uint32_t heap = hal::freeHeap();
+        if (heap < heapLow) {
+            heapLow = heap;
+        }
+        if ((rc != MBEDTLS_ERR_SSL_WANT_READ && rc != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+            (long)(::millis() - deadline) >= 0) {
+            char message[96];
+            mbedtls_strerror(rc, message, sizeof(message));
+            Serial.printf("❌ Handshake TLS: %s (-0x%04x)\n", message, (unsigned)-rc);
+            return false;
+        }
+        ::delay(1);
+    }
+    stats.lastHandshakePeakBytes = heapBase - heapLow;
+    return true;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    stop();
+    if (!setup()) {
+        return 0;
+    }
+    if (!sessionMatches(host, port)) {
+        clearSession();
+    }
+    if (!tcp.connect(host, port)) {
+        return 0;
+    }
+
+    uint32_t heapBefore = hal::freeHeap();
+    unsigned long start = ::micros();
+
+    // Para saber si el servidor aceptó la sesión ofrecida
+    unsigned char offeredMaster[48];
+    bool offered = hasSession;
+    if (offered) {
+        memcpy(offeredMaster, session.master, sizeof(offeredMaster));
+    }
+
+    if (!handshake(host)) {
+        stats.failedHandshakes++;
+        // Una sesión vencida o rechazada no se vuelve a ofrecer
+        clearSession();
+        stop();
+        return 0;
+    }
+
+    stats.lastHandshakeUs = ::micros() - start;
+    stats.lastResumed = offered && memcmp(ssl.session->master, offeredMaster, sizeof(offeredMaster)) == 0;
+    if (stats.lastResumed) {
+        stats.resumedHandshakes++;
+    } else {
+        stats.fullHandshakes++;
+    }
+    saveSession(host, port);
+    uint32_t heapAfter = hal::freeHeap();
+    stats.connectionBytes = heapBefore > heapAfter ? heapBefore - heapAfter : 0;
+    return 1;
+}
+
+uint8_t TlsClient::connected() {
+    if (!active) {
+        return 0;
+    }
+    if (peekByte >= 0 || mbedtls_ssl_get_bytes_avail(&ssl) > 0) {
+        return 1;
+    }
+    if (!tcp.connected()) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+int TlsClient::available() {
+    if (!active) {
+        return 0;
+    }
+    // Los bytes del socket pueden ser un registro a medias: solo cuenta lo descifrado
+    size_t pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    if (pending == 0 && tcp.available() > 0) {
+        int rc = mbedtls_ssl_read(&ssl, NULL, 0);
+        if (rc < 0 && rc != MBEDTLS_ERR_SSL_WANT_READ && rc != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            stop();
+            return 0;
+        }
+        pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    }
+    return (int)pending + (peekByte >= 0 ? 1 : 0);
+}
+
+int TlsClient::peek() {
+    if (peekByte < 0) {
+        peekByte = read();
+    }
+    return peekByte;
+}
+
+int TlsClient::read() {
+    uint8_t byte;
+    return read(&byte, 1) == 1 ? byte : -1;
+}
+
+int TlsClient::read(uint8_t* buffer, size_t size) {
+    if (!active || size == 0) {
+        return -1;
+    }
+    size_t offset = 0;
+    if (peekByte >= 0) {
+        buffer[offset++] = (uint8_t)peekByte;
+        peekByte = -1;
+        if (offset == size) {
+            return 1;
+        }
+    }
+    int rc = mbedtls_ssl_read(&ssl, buffer + offset, size - offset);
+    if (rc > 0) {
+        return (int)offset + rc;
+    }
+    if (rc != MBEDTLS_ERR_SSL_WANT_READ && rc != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        stop();
+    }
+    return offset > 0 ? (int)offset : -1;
+}
+
+size_t TlsClient::write(uint8_t byte) {
+    return write(&byte, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buffer, size_t size) {
+    if (!active) {
+        return 0;
+    }
+    size_t sent = 0;
+    unsigned long deadline = ::millis() + TLS_TIMEOUT_MS;
+    while (sent < size) {
+        int rc = mbedtls_ssl_write(&ssl, buffer + sent, size - sent);
+        if (rc > 0) {
+            sent += (size_t)rc;
+            continue;
+        }
+        if ((rc != MBEDTLS_ERR_SSL_WANT_READ && rc != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+            (long)(::millis() - deadline) >= 0) {
+            stop();
+            break;
+        }
+        ::delay(1);
+    }
+    return sent;
+}
+
+void TlsClient::stop() {
+    if (active) {
+        // close_notify sin esperar la respuesta: la sesión sigue siendo reanudable.
+        // mbedtls_ssl_free libera los buffers de entrada/salida de la conexión.
+        mbedtls_ssl_close_notify(&ssl);
+        mbedtls_ssl_free(&ssl);
+        active = false;
+    }
+    peekByte = -1;
+    tcp.stop();
+}
+
+} // namespace hal
+
+#endif // ARDUINO
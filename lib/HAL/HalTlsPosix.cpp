@@ -0,0 +1,532 @@
+#ifndef ARDUINO
+
+#include "HalTls.h"
+
+#include <malloc.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+namespace hal {
+
+// ---- Heap de OpenSSL por hilo ----
+// Las funciones de memoria de libcrypto se reemplazan una sola vez, antes de
+// cualquier asignación, para medir el heap de cada handshake como en el
+// ESP32. El servidor de prueba corre en otro hilo y no se mezcla.
+
+static thread_local int64_t tlsHeapCurrent = 0;
+static thread_local int64_t tlsHeapPeak = 0;
+
+static void* countedMalloc(size_t size, const char*, int) {
+    void* p = malloc(size);
+    if (p != NULL) {
+        tlsHeapCurrent += (int64_t)malloc_usable_size(p);
+        if (tlsHeapCurrent > tlsHeapPeak) {
+            tlsHeapPeak = tlsHeapCurrent;
+        }
+    }
+    return p;
+}
+
+static void* countedRealloc(void* old, size_t size, const char*, int) {
+    size_t before = old != NULL ? malloc_usable_size(old) : 0;
+    void* p = realloc(old, size);
+    if (p != NULL || size == 0) {
+        tlsHeapCurrent += (int64_t)(p != NULL ? malloc_usable_size(p) : 0) - (int64_t)before;
+        if (tlsHeapCurrent > tlsHeapPeak) {
+            tlsHeapPeak = tlsHeapCurrent;
+        }
+    }
+    return p;
+}
+
+static void countedFree(void* p, const char*, int) {
+    if (p != NULL) {
+        tlsHeapCurrent -= (int64_t)malloc_usable_size(p);
+        free(p);
+    }
+}
+
+static void initOpenSsl() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        // Falla si libcrypto ya asignó memoria: entonces el heap se reporta en 0
+        CRYPTO_set_mem_functions(countedMalloc, countedRealloc, countedFree);
+        OPENSSL_init_ssl(0, NULL);
+    });
+}
+
+// Reloj real: hal::millis() puede estar acelerado en la simulación y los
+// tiempos de espera y del handshake son del socket
+static uint64_t realMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static bool isIpAddress(const char* host) {
+    struct in_addr addr;
+    return inet_pton(AF_INET, host, &addr) == 1;
+}
+
+static X509* parseCertificate(const char* pem) {
+    BIO* bio = BIO_new_mem_buf(pem, -1);
+    X509* cert = bio != NULL ? PEM_read_bio_X509(bio, NULL, NULL, NULL) : NULL;
+    BIO_free(bio);
+    return cert;
+}
+
+// ---- Cliente ----
+
+TlsClient::TlsClient() {
+    initOpenSsl();
+    caCert = NULL;
+    resumption = true;
+    sessionHost[0] = '\0';
+    sessionPort = 0;
+    memset(&stats, 0, sizeof(stats));
+    ctx = NULL;
+    ssl = NULL;
+    session = NULL;
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    clearSession();
+    SSL_CTX_free(ctx);
+}
+
+void TlsClient::setCACert(const char* pem) {
+    caCert = pem;
+    clearSession();
+    SSL_CTX_free(ctx);
+    ctx = NULL;
+}
+
+void TlsClient::setSessionResumption(bool enabled) {
+    resumption = enabled;
+    if (!enabled) {
+        clearSession();
+    }
+}
+
+void TlsClient::clearSession() {
+    if (session != NULL) {
+        SSL_SESSION_free(session);
+        session = NULL;
+    }
+    sessionHost[0] = '\0';
+}
+
+bool TlsClient::hasSavedSession() const {
+    return session != NULL;
+}
+
+bool TlsClient::setup() {
+    if (ctx != NULL) {
+        return true;
+    }
+    if (caCert == NULL) {
+        Serial.println("❌ TLS sin certificado de CA (setCACert)");
+        return false;
+    }
+
+    ctx = SSL_CTX_new(TLS_client_method());
+    X509* cert = parseCertificate(caCert);
+    if (ctx == NULL || cert == NULL || X509_STORE_add_cert(SSL_CTX_get_cert_store(ctx), cert) != 1) {
+        Serial.println("❌ Certificado de CA TLS inválido");
+        X509_free(cert);
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+        return false;
+    }
+    X509_free(cert);
+
+    // Lo mismo que negocia el ESP32 con mbedTLS
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_cipher_list(ctx, "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256");
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+    SSL_CTX_set_tlsext_max_fragment_length(ctx, TLSEXT_max_fragment_length_4096);
+
+    // La sesión se guarda a mano (una por cliente), sin la caché interna
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+    // Sin buffers de lectura/escritura mientras la conexión está inactiva
+    SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS);
+    return true;
+}
+
+bool TlsClient::sessionMatches(const char* host, uint16_t port) const {
+    return session != NULL && port == sessionPort && strcmp(host, sessionHost) == 0;
+}
+
+void TlsClient::saveSession(const char* host, uint16_t port) {
+    if (!resumption) {
+        return;
+    }
+    SSL_SESSION* current = SSL_get1_session(ssl);
+    if (current == NULL) {
+        return;
+    }
+    clearSession();
+    session = current;
+    strncpy(sessionHost, host, TLS_MAX_HOST - 1);
+    sessionHost[TLS_MAX_HOST - 1] = '\0';
+    sessionPort = port;
+}
+
+bool TlsClient::waitSocket(int sslError, unsigned long deadline) {
+    unsigned long now = (unsigned long)(realMicros() / 1000);
+    if (now >= deadline || (sslError != SSL_ERROR_WANT_READ && sslError != SSL_ERROR_WANT_WRITE)) {
+        return false;
+    }
+    struct pollfd pfd = {tcp.fd(), (short)(sslError == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT), 0};
+    return poll(&pfd, 1, (int)(deadline - now)) == 1;
+}
+
+bool TlsClient::handshake(const char* host) {
+    ssl = SSL_new(ctx);
+    if (ssl == NULL) {
+        return false;
+    }
+    SSL_set_fd(ssl, tcp.fd());
+
+    // El servidor se identifica por IP o por nombre, según cómo se conectó
+    X509_VERIFY_PARAM* param = SSL_get0_param(ssl);
+    if (isIpAddress(host)) {
+        X509_VERIFY_PARAM_set1_ip_asc(param, host);
+    } else {
+        SSL_set_tlsext_host_name(ssl, host);
+        X509_VERIFY_PARAM_set1_host(param, host, 0);
+    }
+
+    if (session != NULL) {
+        SSL_set_session(ssl, session);
+    }
+
+    unsigned long deadline = (unsigned long)(realMicros() / 1000) + TLS_TIMEOUT_MS;
+    while (true) {
+        int rc = SSL_connect(ssl);
+        if (rc == 1) {
+            return true;
+        }
+        if (!waitSocket(SSL_get_error(ssl, rc), deadline)) {
+            ERR_clear_error();
+            return false;
+        }
+    }
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    stop();
+    if (!setup()) {
+        return 0;
+    }
+    if (!sessionMatches(host, port)) {
+        clearSession();
+    }
+    if (!tcp.connect(host, port)) {
+        return 0;
+    }
+
+    int64_t heapBase = tlsHeapCurrent;
+    tlsHeapPeak = heapBase;
+    uint64_t start = realMicros();
+
+    if (!handshake(host)) {
+        stats.failedHandshakes++;
+        Serial.println("❌ Handshake TLS fallido");
+        // Una sesión vencida o rechazada no se vuelve a ofrecer
+        clearSession();
+        stop();
+        return 0;
+    }
+
+    stats.lastHandshakeUs = (uint32_t)(realMicros() - start);
+    stats.lastResumed = SSL_session_reused(ssl) == 1;
+    if (stats.lastResumed) {
+        stats.resumedHandshakes++;
+    } else {
+        stats.fullHandshakes++;
+    }
+    saveSession(host, port);
+    stats.lastHandshakePeakBytes = (uint32_t)(tlsHeapPeak - heapBase);
+    stats.connectionBytes = (uint32_t)(tlsHeapCurrent - heapBase);
+    return 1;
+}
+
+uint8_t TlsClient::connected() {
+    if (ssl == NULL) {
+        return 0;
+    }
+    if (SSL_pending(ssl) > 0) {
+        return 1;
+    }
+    if (!tcp.connected()) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+int TlsClient::available() {
+    if (ssl == NULL) {
+        return 0;
+    }
+    // Los bytes del socket pueden ser un registro a medias: solo cuenta lo descifrado
+    if (SSL_pending(ssl) == 0 && tcp.available() > 0) {
+        uint8_t probe;
+        if (SSL_peek(ssl, &probe, 1) <= 0) {
+            ERR_clear_error();
+        }
+    }
+    return SSL_pending(ssl);
+}
+
+int TlsClient::read() {
+    uint8_t byte;
+    return read(&byte, 1) == 1 ? byte : -1;
+}
+
+int TlsClient::read(uint8_t* buffer, size_t size) {
+    if (ssl == NULL) {
+        return -1;
+    }
+    int rc = SSL_read(ssl, buffer, (int)size);
+    if (rc <= 0) {
+        int error = SSL_get_error(ssl, rc);
+        ERR_clear_error();
+        if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+            stop();
+        }
+        return -1;
+    }
+    return rc;
+}
+
+size_t TlsClient::write(uint8_t byte) {
+    return write(&byte, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buffer, size_t size) {
+    if (ssl == NULL || size == 0) {
+        return 0;
+    }
+    unsigned long deadline = (unsigned long)(realMicros() / 1000) + TLS_TIMEOUT_MS;
+    while (true) {
+        int rc = SSL_write(ssl, buffer, (int)size);
+        if (rc > 0) {
+            return (size_t)rc;
+        }
+        if (!waitSocket(SSL_get_error(ssl, rc), deadline)) {
+            ERR_clear_error();
+            stop();
+            return 0;
+        }
+    }
+}
+
+void TlsClient::stop() {
+    if (ssl != NULL) {
+        // close_notify sin esperar la respuesta: la sesión sigue siendo reanudable
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        ssl = NULL;
+        ERR_clear_error();
+    }
+    tcp.stop();
+}
+
+// ---- Servidor de prueba ----
+
+namespace sim {
+
+struct TlsTestServer::State {
+    SSL_CTX* ctx;
+    int listenFd;
+    char* certPem;
+    std::atomic<uint32_t> handshakes;
+    std::atomic<uint32_t> resumed;
+    mutable std::mutex lock;
+    std::string lines;             // Todas las líneas, separadas por '\n'
+    std::atomic<bool> running;
+    std::thread thread;
+};
+
+static bool generateCertificate(SSL_CTX* ctx, char** pemOut) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    if (key == NULL || cert == NULL) {
+        EVP_PKEY_free(key);
+        X509_free(cert);
+        return false;
+    }
+
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"127.0.0.1", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+
+    X509V3_CTX v3;
+    X509V3_set_ctx_nodb(&v3);
+    X509V3_set_ctx(&v3, cert, cert, NULL, NULL, 0);
+    X509_EXTENSION* san = X509V3_EXT_conf_nid(NULL, &v3, NID_subject_alt_name, "IP:127.0.0.1");
+    X509_EXTENSION* basic = X509V3_EXT_conf_nid(NULL, &v3, NID_basic_constraints, "critical,CA:TRUE");
+    bool ok = san != NULL && basic != NULL && X509_add_ext(cert, san, -1) == 1 &&
+              X509_add_ext(cert, basic, -1) == 1 && X509_sign(cert, key, EVP_sha256()) > 0 &&
+              SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+    X509_EXTENSION_free(san);
+    X509_EXTENSION_free(basic);
+
+    if (ok) {
+        BIO* bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_X509(bio, cert);
+        char* data = NULL;
+        long length = BIO_get_mem_data(bio, &data);
+        *pemOut = (char*)malloc(length + 1);
+        memcpy(*pemOut, data, length);
+        (*pemOut)[length] = '\0';
+        BIO_free(bio);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+static void serveConnection(SSL_CTX* ctx, int fd, std::mutex& lock, std::string& lines,
+                            std::atomic<uint32_t>& handshakes, std::atomic<uint32_t>& resumed) {
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    if (SSL_accept(ssl) == 1) {
+        handshakes++;
+        if (SSL_session_reused(ssl)) {
+            resumed++;
+        }
+        std::string pending;
+        char buffer[2048];
+        int rc;
+        while ((rc = SSL_read(ssl, buffer, sizeof(buffer))) > 0) {
+            pending.append(buffer, rc);
+            size_t newline;
+            while ((newline = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, newline);
+                if (!line.empty() && line[line.size() - 1] == '\r') {
+                    line.erase(line.size() - 1);
+                }
+                pending.erase(0, newline + 1);
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    lines += line;
+                    lines += '\n';
+                }
+                SSL_write(ssl, "OK\n", 3);
+            }
+        }
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    ERR_clear_error();
+    close(fd);
+}
+
+TlsTestServer::TlsTestServer() {
+    state = new State();
+    state->ctx = NULL;
+    state->listenFd = -1;
+    state->certPem = NULL;
+    state->handshakes = 0;
+    state->resumed = 0;
+    state->running = false;
+}
+
+TlsTestServer::~TlsTestServer() {
+    state->running = false;
+    if (state->listenFd >= 0) {
+        shutdown(state->listenFd, SHUT_RDWR);
+        close(state->listenFd);
+    }
+    if (state->thread.joinable()) {
+        state->thread.join();
+    }
+    SSL_CTX_free(state->ctx);
+    free(state->certPem);
+    delete state;
+}
+
+bool TlsTestServer::start(uint16_t& port) {
+    initOpenSsl();
+    state->ctx = SSL_CTX_new(TLS_server_method());
+    if (state->ctx == NULL || !generateCertificate(state->ctx, &state->certPem)) {
+        return false;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &length) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    port = ntohs(addr.sin_port);
+    state->listenFd = fd;
+    state->running = true;
+
+    State* s = state;
+    state->thread = std::thread([s]() {
+        while (s->running) {
+            int client = accept(s->listenFd, NULL, NULL);
+            if (client < 0) {
+                break;
+            }
+            serveConnection(s->ctx, client, s->lock, s->lines, s->handshakes, s->resumed);
+        }
+    });
+    return true;
+}
+
+const char* TlsTestServer::caCert() const {
+    return state->certPem;
+}
+
+uint32_t TlsTestServer::handshakes() const {
+    return state->handshakes;
+}
+
+uint32_t TlsTestServer::resumed() const {
+    return state->resumed;
+}
+
+bool TlsTestServer::received(const char* text) const {
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->lines.find(text) != std::string::npos;
+}
+
+} // namespace sim
+
+} // namespace hal
+
+#endif // ARDUINO
@@ -0,0 +1,61 @@
+#ifndef HALUDP_H
+#define HALUDP_H
+
+// Socket UDP de la HAL. En el ESP32 es directamente WiFiUDP; en el host es
+// una implementación sobre sockets POSIX con el subconjunto de su interfaz
+// que usan las librerías (lib/UdpTelemetry). En el host la pérdida simulada
+// de la placa (sim::setPacketLoss) descarta datagramas en ambos sentidos.
+
+#include "Hal.h"
+
+#ifdef ARDUINO
+
+#include <WiFiUdp.h>
+
+namespace hal {
+typedef WiFiUDP UdpSocket;
+}
+
+#else
+
+namespace hal {
+
+#define UDP_MAX_DATAGRAM 512
+
+class UdpSocket {
+private:
+    int socketFd;
+    uint32_t destAddress;       // Orden de red, de beginPacket()
+    uint16_t destPort;
+    uint8_t txBuffer[UDP_MAX_DATAGRAM];
+    size_t txLength;
+    uint8_t rxBuffer[UDP_MAX_DATAGRAM];
+    size_t rxLength;
+    size_t rxOffset;
+
+public:
+    UdpSocket();
+    ~UdpSocket();
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    uint8_t begin(uint16_t port);           // 0 = puerto libre
+    void stop();
+
+    int beginPacket(const char* host, uint16_t port);
+    size_t write(const uint8_t* buffer, size_t size);
+    int endPacket();
+
+    // Tamaño del siguiente datagrama sin bloquear; 0 si no hay ninguno
+    int parsePacket();
+    int read(uint8_t* buffer, size_t size);
+
+    uint16_t localPort() const;             // Solo en el host (pruebas)
+};
+
+} // namespace hal
+
+#endif
+
+#endif // HALUDP_H
@@ -0,0 +1,143 @@
+#ifndef ARDUINO
+
+#include "HalUdp.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace hal {
+
+UdpSocket::UdpSocket() {
+    socketFd = -1;
+    destAddress = 0;
+    destPort = 0;
+    txLength = 0;
+    rxLength = 0;
+    rxOffset = 0;
+}
+
+UdpSocket::~UdpSocket() {
+    stop();
+}
+
+uint8_t UdpSocket::begin(uint16_t port) {
+    stop();
+    socketFd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (socketFd < 0) {
+        return 0;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(socketFd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void UdpSocket::stop() {
+    if (socketFd >= 0) {
+        close(socketFd);
+    }
+    socketFd = -1;
+    txLength = 0;
+    rxLength = 0;
+    rxOffset = 0;
+}
+
+int UdpSocket::beginPacket(const char* host, uint16_t port) {
+    struct in_addr parsed;
+    if (inet_pton(AF_INET, host, &parsed) != 1) {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo* result = NULL;
+        if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) {
+            return 0;
+        }
+        parsed = ((struct sockaddr_in*)result->ai_addr)->sin_addr;
+        freeaddrinfo(result);
+    }
+    destAddress = parsed.s_addr;
+    destPort = port;
+    txLength = 0;
+    return 1;
+}
+
+size_t UdpSocket::write(const uint8_t* buffer, size_t size) {
+    if (txLength + size > sizeof(txBuffer)) {
+        size = sizeof(txBuffer) - txLength;
+    }
+    memcpy(txBuffer + txLength, buffer, size);
+    txLength += size;
+    return size;
+}
+
+int UdpSocket::endPacket() {
+    if (socketFd < 0 || destPort == 0) {
+        return 0;
+    }
+    size_t length = txLength;
+    txLength = 0;
+    // Perdido en el aire: para quien envía salió bien
+    if (sim::packetLost()) {
+        return 1;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = destAddress;
+    address.sin_port = htons(destPort);
+    ssize_t rc = sendto(socketFd, txBuffer, length, MSG_NOSIGNAL,
+                        (struct sockaddr*)&address, sizeof(address));
+    return rc == (ssize_t)length ? 1 : 0;
+}
+
+int UdpSocket::parsePacket() {
+    rxLength = 0;
+    rxOffset = 0;
+    if (socketFd < 0) {
+        return 0;
+    }
+    while (true) {
+        ssize_t n = recv(socketFd, rxBuffer, sizeof(rxBuffer), MSG_DONTWAIT);
+        if (n <= 0) {
+            return 0;
+        }
+        if (!sim::packetLost()) {
+            rxLength = (size_t)n;
+            return (int)n;
+        }
+    }
+}
+
+int UdpSocket::read(uint8_t* buffer, size_t size) {
+    size_t available = rxLength - rxOffset;
+    if (size > available) {
+        size = available;
+    }
+    memcpy(buffer, rxBuffer + rxOffset, size);
+    rxOffset += size;
+    return (int)size;
+}
+
+uint16_t UdpSocket::localPort() const {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (socketFd < 0 || getsockname(socketFd, (struct sockaddr*)&address, &length) != 0) {
+        return 0;
+    }
+    return ntohs(address.sin_port);
+}
+
+} // namespace hal
+
+#endif // ARDUINO
@@ -0,0 +1,273 @@
+#include "LiveView.h"
+
+LiveView::LiveView(CameraManager& camera, uint16_t port) {
+    this->camera = &camera;
+    this->port = port;
+    this->state = VIEWER_NONE;
+    this->requestLength = 0;
+    this->request[0] = '\0';
+    this->connectedAt = 0;
+    this->lastFrameAt = 0;
+    this->partOpen = false;
+    this->frameIntervalMs = 1000 / LIVEVIEW_DEFAULT_FPS;
+    this->sessionLimitMs = LIVEVIEW_SESSION_MS;
+    this->running = false;
+    this->taskDone = true;
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool LiveView::begin() {
+    if (!server.begin(port)) {
+        Serial.printf("❌ Vista en vivo: no se pudo abrir el puerto %u\n", (unsigned)port);
+        return false;
+    }
+    Serial.printf("🎥 Vista en vivo en el puerto %u (/stream, hasta %lu cuadros/s)\n",
+                  (unsigned)port, 1000 / frameIntervalMs);
+    return true;
+}
+
+void LiveView::end() {
+    viewer.stop();
+    state = VIEWER_NONE;
+    server.stop();
+}
+
+bool LiveView::start(int priority) {
+    if (running) {
+        return true;
+    }
+    running = true;
+    taskDone = false;
+    if (!hal::startTask("liveview", taskMain, this, LIVEVIEW_TASK_STACK, priority)) {
+        running = false;
+        taskDone = true;
+        return false;
+    }
+    return true;
+}
+
+void LiveView::stop() {
+    running = false;
+    while (!taskDone) {
+        hal::delayMs(10);
+    }
+}
+
+void LiveView::taskMain(void* arg) {
+    LiveView* view = (LiveView*)arg;
+    while (view->running) {
+        unsigned long wait = view->poll();
+        hal::delayMs(wait < LIVEVIEW_POLL_MS ? (wait > 0 ? wait : 1) : LIVEVIEW_POLL_MS);
+    }
+    view->taskDone = true;
+    hal::endTask();
+}
+
+unsigned long LiveView::poll() {
+    unsigned long now = hal::millis();
+    acceptViewers(now);
+
+    if (state == VIEWER_REQUEST) {
+        readRequest(now);
+        return state == VIEWER_REQUEST ? 20 : 0;
+    }
+    if (state == VIEWER_STREAM) {
+        return streamFrame(now);
+    }
+    return LIVEVIEW_POLL_MS;
+}
+
+void LiveView::acceptViewers(unsigned long now) {
+    if (state == VIEWER_NONE) {
+        if (server.accept(viewer)) {
+            state = VIEWER_REQUEST;
+            requestLength = 0;
+            request[0] = '\0';
+            connectedAt = now;
+        }
+        return;
+    }
+
+    // Un visor a la vez: cada cuadro más es radio y CPU que no son del sensor
+    hal::TcpClient other;
+    while (server.accept(other)) {
+        const char* busy = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 10\r\n"
+                           "Content-Length: 0\r\nConnection: close\r\n\r\n";
+        other.write((const uint8_t*)busy, strlen(busy));
+        other.stop();
+        stats.rejected++;
+    }
+}
+
+void LiveView::readRequest(unsigned long now) {
+    int available = viewer.available();
+    size_t room = sizeof(request) - 1 - requestLength;
+    if (available > 0 && room > 0) {
+        int n = viewer.read((uint8_t*)request + requestLength, (size_t)available < room ? (size_t)available : room);
+        if (n > 0) {
+            requestLength += (size_t)n;
+            request[requestLength] = '\0';
+        }
+    }
+
+    bool complete = strstr(request, "\r\n\r\n") != NULL;
+    if (!complete) {
+        if (requestLength == sizeof(request) - 1) {
+            // Sin el final de las cabeceras: solo importa la primera línea
+            complete = strstr(request, "\r\n") != NULL;
+        }
+        if (!complete) {
+            if (now - connectedAt > LIVEVIEW_REQUEST_TIMEOUT_MS || !viewer.connected()) {
+                drop(&stats.idleDrops);
+            }
+            return;
+        }
+    }
+
+    if (strncmp(request, "GET /stream ", 12) != 0 && strncmp(request, "GET / ", 6) != 0) {
+        sendText("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+                 now + LIVEVIEW_SEND_TIMEOUT_MS);
+        drop(&stats.badRequests);
+        return;
+    }
+
+    if (!sendText("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: multipart/x-mixed-replace; boundary=" LIVEVIEW_BOUNDARY "\r\n"
+                  "Cache-Control: no-cache\r\nConnection: close\r\n\r\n",
+                  now + LIVEVIEW_SEND_TIMEOUT_MS)) {
+        drop(NULL);
+        return;
+    }
+    stats.viewers++;
+    state = VIEWER_STREAM;
+    connectedAt = now;
+    lastFrameAt = now - frameIntervalMs;
+    partOpen = false;
+}
+
+unsigned long LiveView::streamFrame(unsigned long now) {
+    if (now - connectedAt > sessionLimitMs) {
+        drop(&stats.sessionEnds);
+        return LIVEVIEW_POLL_MS;
+    }
+    if (!viewer.connected()) {
+        drop(NULL);
+        return LIVEVIEW_POLL_MS;
+    }
+
+    // Tope duro: el próximo cuadro empieza frameIntervalMs después del anterior
+    unsigned long elapsed = now - lastFrameAt;
+    if (elapsed < frameIntervalMs) {
+        return frameIntervalMs - elapsed;
+    }
+
+    // Antes de tomar el cuadro, el comienzo de la parte: si no entra, el
+    // visor todavía no leyó el anterior y la cámara queda para el sensor
+    if (!partOpen) {
+        static const char prefix[] = "--" LIVEVIEW_BOUNDARY "\r\nContent-Type: image/jpeg\r\n";
+        int written = hal::tcpWriteSome(viewer, (const uint8_t*)prefix, sizeof(prefix) - 1);
+        if (written < 0) {
+            drop(NULL);
+            return LIVEVIEW_POLL_MS;
+        }
+        if (written == 0) {
+            if (elapsed - frameIntervalMs > LIVEVIEW_SEND_TIMEOUT_MS) {
+                drop(&stats.idleDrops);
+                return LIVEVIEW_POLL_MS;
+            }
+            return LIVEVIEW_WRITE_WAIT_MS;
+        }
+        if (!sendAll((const uint8_t*)prefix + written, sizeof(prefix) - 1 - written,
+                     now + LIVEVIEW_SEND_TIMEOUT_MS)) {
+            drop(&stats.idleDrops);
+            return LIVEVIEW_POLL_MS;
+        }
+        partOpen = true;
+    }
+
+    unsigned long startUs = hal::micros();
+    camera_fb_t* fb = camera->captureLive();
+    if (fb == NULL) {
+        // Lo tiene el sensor (o la cámara falló): la parte sigue abierta
+        stats.skipped++;
+        return frameIntervalMs / 4 + 1;
+    }
+    lastFrameAt = now;
+    partOpen = false;
+    bool sent = sendFrame(fb, hal::millis() + LIVEVIEW_SEND_TIMEOUT_MS);
+    size_t length = fb->len;
+    camera->release(fb);
+
+    unsigned long heldUs = hal::micros() - startUs;
+    if (heldUs > stats.maxHoldUs) {
+        stats.maxHoldUs = heldUs;
+    }
+    if (!sent) {
+        drop(&stats.idleDrops);
+        return LIVEVIEW_POLL_MS;
+    }
+    stats.frames++;
+    stats.bytes += (uint32_t)length;
+    elapsed = hal::millis() - lastFrameAt;
+    return elapsed < frameIntervalMs ? frameIntervalMs - elapsed : 0;
+}
+
+bool LiveView::sendFrame(const camera_fb_t* fb, unsigned long deadline) {
+    char header[40];
+    snprintf(header, sizeof(header), "Content-Length: %u\r\n\r\n", (unsigned)fb->len);
+    return sendText(header, deadline) && sendAll(fb->buf, fb->len, deadline) && sendText("\r\n", deadline);
+}
+
+// Del buffer al socket sin bloquear: un visor que no lee llena el buffer de
+// envío y el plazo corta el envío. Si además el sensor espera el cuadro, el
+// visor se corta enseguida
+bool LiveView::sendAll(const uint8_t* data, size_t length, unsigned long deadline) {
+    size_t offset = 0;
+    while (offset < length) {
+        int written = hal::tcpWriteSome(viewer, data + offset, length - offset);
+        if (written < 0) {
+            return false;
+        }
+        if (written == 0) {
+            if ((long)(hal::millis() - deadline) > 0 || camera->isFrameWanted()) {
+                return false;
+            }
+            hal::delayMs(LIVEVIEW_WRITE_WAIT_MS);
+            continue;
+        }
+        offset += (size_t)written;
+    }
+    return true;
+}
+
+bool LiveView::sendText(const char* text, unsigned long deadline) {
+    return sendAll((const uint8_t*)text, strlen(text), deadline);
+}
+
+void LiveView::drop(uint32_t* counter) {
+    if (counter != NULL) {
+        (*counter)++;
+    }
+    viewer.stop();
+    state = VIEWER_NONE;
+    partOpen = false;
+    requestLength = 0;
+    request[0] = '\0';
+}
+
+void LiveView::setMaxFps(int fps) {
+    fps = fps < 1 ? 1 : (fps > LIVEVIEW_MAX_FPS ? LIVEVIEW_MAX_FPS : fps);
+    frameIntervalMs = 1000 / fps;
+}
+
+void LiveView::setSessionLimit(unsigned long ms) {
+    sessionLimitMs = ms;
+}
+
+bool LiveView::hasViewer() const {
+    return state == VIEWER_STREAM;
+}
+
+LiveViewStats LiveView::getStats() const {
+    return stats;
+}
@@ -0,0 +1,111 @@
+#ifndef LIVEVIEW_H
+#define LIVEVIEW_H
+
+#include "Hal.h"
+#include "HalSocket.h"
+#include "HalTask.h"
+#include "CameraManager.h"
+
+// Vista en vivo para apuntar la cámara al instalarla: MJPEG por HTTP
+// (multipart/x-mixed-replace) que cualquier navegador muestra en
+// http://<ip>:81/stream.
+//
+// Cada cuadro sale del buffer del driver (CameraManager::captureLive()) por
+// el socket, sin copiarlo ni recortarlo, con la resolución y calidad que
+// tenga la cámara. Para que no le quite nada al sensor:
+//   - corre en su propia tarea con TASK_PRIORITY_BACKGROUND (start()): solo
+//     avanza mientras loop() espera, nunca entre una medición y su envío
+//   - tope duro de cuadros por segundo (LIVEVIEW_MAX_FPS) contado desde el
+//     inicio del cuadro anterior
+//   - no espera por la cámara: si una captura del sensor tiene el cuadro,
+//     salta éste. Toma el cuadro solo cuando el socket ya vació el anterior
+//     (el comienzo de la parte entra sin esperar) y lo escribe sin bloquear
+//     (hal::tcpWriteSome), así que lo suelta en menos de
+//     LIVEVIEW_SEND_TIMEOUT_MS. Si el sensor lo pide mientras tanto, en el
+//     ESP32 la tarea hereda la prioridad de loop() por el mutex, y si el
+//     socket está lleno se corta al visor en lugar de hacer esperar al sensor
+//   - un visor a la vez (a los demás, 503); se corta al que no pide nada en
+//     LIVEVIEW_REQUEST_TIMEOUT_MS, al que no lee los cuadros (el socket sigue
+//     lleno LIVEVIEW_SEND_TIMEOUT_MS) y a todos tras LIVEVIEW_SESSION_MS:
+//     una pestaña olvidada no deja la radio y la cámara ocupadas
+//
+// Sin dependencias de Arduino más allá de la HAL: se prueba en el host.
+
+#define LIVEVIEW_PORT 81
+#define LIVEVIEW_DEFAULT_FPS 2
+#define LIVEVIEW_MAX_FPS 5
+#define LIVEVIEW_REQUEST_TIMEOUT_MS 2000
+#define LIVEVIEW_SEND_TIMEOUT_MS 500
+#define LIVEVIEW_WRITE_WAIT_MS 5    // Reintento con el buffer de envío lleno
+#define LIVEVIEW_SESSION_MS 300000
+#define LIVEVIEW_POLL_MS 100        // Espera de la tarea sin visor
+#define LIVEVIEW_REQUEST_BYTES 256
+#define LIVEVIEW_TASK_STACK 4096
+#define LIVEVIEW_BOUNDARY "liveframe"
+
+struct LiveViewStats {
+    uint32_t viewers;           // Visores atendidos
+    uint32_t rejected;          // 503: ya había uno
+    uint32_t badRequests;       // 404 o petición ilegible
+    uint32_t idleDrops;         // Sin petición a tiempo o sin leer los cuadros
+    uint32_t sessionEnds;       // Cortados por LIVEVIEW_SESSION_MS
+    uint32_t frames;
+    uint32_t skipped;           // Cuadro tomado por una captura del sensor
+    uint32_t bytes;
+    unsigned long maxHoldUs;    // Más tiempo con el cuadro tomado (captura + envío)
+};
+
+class LiveView {
+private:
+    enum ViewerState {
+        VIEWER_NONE,
+        VIEWER_REQUEST,         // Conectado, leyendo la petición HTTP
+        VIEWER_STREAM
+    };
+
+    CameraManager* camera;
+    uint16_t port;
+    hal::TcpServer server;
+    hal::TcpClient viewer;
+    ViewerState state;
+    char request[LIVEVIEW_REQUEST_BYTES];
+    size_t requestLength;
+    unsigned long connectedAt;
+    unsigned long lastFrameAt;
+    bool partOpen;              // Comienzo de la parte enviado, falta el cuadro
+    unsigned long frameIntervalMs;
+    unsigned long sessionLimitMs;
+    volatile bool running;
+    volatile bool taskDone;
+    LiveViewStats stats;
+
+    void acceptViewers(unsigned long now);
+    void readRequest(unsigned long now);
+    unsigned long streamFrame(unsigned long now);
+    bool sendFrame(const camera_fb_t* fb, unsigned long deadline);
+    bool sendAll(const uint8_t* data, size_t length, unsigned long deadline);
+    bool sendText(const char* text, unsigned long deadline);
+    void drop(uint32_t* counter);
+    static void taskMain(void* arg);
+
+public:
+    LiveView(CameraManager& camera, uint16_t port = LIVEVIEW_PORT);
+
+    bool begin();               // Abre el puerto
+    void end();                 // Cierra el visor y el puerto (tras stop())
+
+    // Tarea de fondo que llama a poll(); stop() espera a que termine
+    bool start(int priority = TASK_PRIORITY_BACKGROUND);
+    void stop();
+
+    // Un paso sin la tarea (pruebas): acepta, lee la petición o envía un
+    // cuadro si ya toca. Devuelve los ms hasta el próximo paso útil
+    unsigned long poll();
+
+    void setMaxFps(int fps);    // 1 .. LIVEVIEW_MAX_FPS
+    void setSessionLimit(unsigned long ms);
+    bool hasViewer() const;
+    LiveViewStats getStats() const;
+};
+
+#endif // LIVEVIEW_H
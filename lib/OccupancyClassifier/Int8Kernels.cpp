@@ -0,0 +1,98 @@
+#include "Int8Kernels.h"
+
+#ifdef ARDUINO
+#include "sdkconfig.h"
+#endif
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(INT8_DISABLE_SIMD)
+#define INT8_HAS_SIMD 1
+#else
+#define INT8_HAS_SIMD 0
+#endif
+
+namespace {
+
+bool simdEnabled = INT8_HAS_SIMD;
+bool simdVerified = false;      // Autoverificación hecha y correcta
+
+#if INT8_HAS_SIMD
+// ee.vld.128.ip carga 16 bytes alineados y avanza el puntero;
+// ee.vmulas.s8.accx suma los 16 productos en ACCX; ee.srs.accx lo lee
+// saturado a 32 bits (con corrimiento 0 no hay redondeo)
+int32_t dotProductS8Simd(const int8_t* a, const int8_t* b, size_t length) {
+    int32_t result;
+    uint32_t shift = 0;
+    asm volatile("ee.zero.accx");
+    for (size_t i = 0; i < length; i += INT8_BLOCK) {
+        asm volatile(
+            "ee.vld.128.ip q0, %0, 16\n\t"
+            "ee.vld.128.ip q1, %1, 16\n\t"
+            "ee.vmulas.s8.accx q0, q1\n\t"
+            : "+r"(a), "+r"(b)
+            :
+            : "memory");
+    }
+    asm volatile("ee.srs.accx %0, %1, 0" : "=r"(result) : "r"(shift));
+    return result;
+}
+#endif
+
+} // namespace
+
+int32_t dotProductS8Scalar(const int8_t* a, const int8_t* b, size_t length) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < length; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+int32_t dotProductS8(const int8_t* a, const int8_t* b, size_t length) {
+#if INT8_HAS_SIMD
+    if (simdEnabled && simdVerified && length % INT8_BLOCK == 0 &&
+        ((uintptr_t)a & 15) == 0 && ((uintptr_t)b & 15) == 0) {
+        return dotProductS8Simd(a, b, length);
+    }
+#endif
+    return dotProductS8Scalar(a, b, length);
+}
+
+bool int8SelfTest() {
+#if INT8_HAS_SIMD
+    // Extremos (-128 * -128, 127 * -128) y valores pseudoaleatorios
+    alignas(16) int8_t a[4 * INT8_BLOCK];
+    alignas(16) int8_t b[4 * INT8_BLOCK];
+    uint32_t x = 0x9E3779B9;
+    for (int round = 0; round < 8; round++) {
+        for (size_t i = 0; i < sizeof(a); i++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            a[i] = round == 0 ? -128 : (int8_t)x;
+            b[i] = round == 0 ? (i & 1 ? -128 : 127) : (int8_t)(x >> 8);
+        }
+        for (size_t length = INT8_BLOCK; length <= sizeof(a); length += INT8_BLOCK) {
+            if (dotProductS8Simd(a, b, length) != dotProductS8Scalar(a, b, length)) {
+                simdVerified = false;
+                return false;
+            }
+        }
+    }
+    simdVerified = true;
+    return simdEnabled;
+#else
+    return false;
+#endif
+}
+
+void setInt8SimdEnabled(bool enabled) {
+    simdEnabled = enabled && INT8_HAS_SIMD;
+}
+
+bool int8SimdActive() {
+    return simdEnabled && simdVerified;
+}
+
+const char* int8KernelName() {
+    return int8SimdActive() ? "esp32s3-pie" : "scalar";
+}
@@ -0,0 +1,38 @@
+#ifndef INT8KERNELS_H
+#define INT8KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Producto punto int8 → int32 del clasificador de ocupación.
+//
+// En el ESP32-S3 usa las instrucciones vectoriales del procesador (PIE):
+// 16 productos int8 por instrucción, acumulados en el registro ACCX de 40
+// bits. En el ESP32 clásico y en el host es un lazo escalar. Los dos dan el
+// mismo resultado exacto, así que el host reproduce los logits de la placa.
+//
+// Requisitos de la versión vectorial: largo múltiplo de 16 y punteros
+// alineados a 16 bytes (los pesos del modelo ya lo están). ACCX y los
+// registros q no se guardan en los cambios de contexto de FreeRTOS: el
+// kernel se usa desde una sola tarea (el lazo principal).
+//
+// Compilar con -DINT8_DISABLE_SIMD fuerza el lazo escalar.
+
+#define INT8_BLOCK 16
+
+// Kernel activo: el vectorial si está compilado y pasó int8SelfTest()
+int32_t dotProductS8(const int8_t* a, const int8_t* b, size_t length);
+
+// Lazo escalar de referencia (siempre disponible)
+int32_t dotProductS8Scalar(const int8_t* a, const int8_t* b, size_t length);
+
+// Compara el kernel vectorial con el escalar sobre vectores de prueba y lo
+// desactiva si no coinciden. true si el kernel activo es el vectorial.
+bool int8SelfTest();
+
+// Fuerza el lazo escalar (false) o vuelve al vectorial si está disponible
+void setInt8SimdEnabled(bool enabled);
+bool int8SimdActive();
+const char* int8KernelName();
+
+#endif // INT8KERNELS_H
@@ -0,0 +1,129 @@
+#include "OccupancyClassifier.h"
+#include "Int8Kernels.h"
+
+static_assert(OCC_INPUTS % INT8_BLOCK == 0 && OCC_HIDDEN % INT8_BLOCK == 0,
+              "El kernel vectorial procesa bloques de 16");
+
+OccupancyClassifier::OccupancyClassifier() {
+    margin = OCC_DEFAULT_MARGIN;
+    latencyBudgetUs = OCC_DEFAULT_BUDGET_US;
+    vetoHoldMs = OCC_DEFAULT_VETO_HOLD_MS;
+    holdActive = false;
+    heldOccupied = false;
+    heldSince = 0;
+    resetStats();
+}
+
+bool OccupancyClassifier::begin() {
+    return int8SelfTest();
+}
+
+OccupancyScore OccupancyClassifier::classify(const uint8_t* thumbnail) const {
+    alignas(16) int8_t input[OCC_INPUTS];
+    alignas(16) int8_t hidden[OCC_HIDDEN];
+
+    // Entrada centrada en el promedio de la miniatura: la exposición no cuenta
+    uint32_t sum = 0;
+    for (int i = 0; i < OCC_INPUTS; i++) {
+        sum += thumbnail[i];
+    }
+    int mean = (int)(sum / OCC_INPUTS);
+    for (int i = 0; i < OCC_INPUTS; i++) {
+        int value = thumbnail[i] - mean;
+        input[i] = (int8_t)(value < -128 ? -128 : value > 127 ? 127 : value);
+    }
+
+    // Capa oculta: ReLU y recuantización a int8 con multiplicador entero
+    const int64_t rounding = (int64_t)1 << (OCC_REQUANT_SHIFT - 1);
+    for (int j = 0; j < OCC_HIDDEN; j++) {
+        int32_t acc = dotProductS8(OCC_W1[j], input, OCC_INPUTS) + OCC_B1[j];
+        int64_t value = ((int64_t)acc * OCC_REQUANT_MULTIPLIER + rounding) >> OCC_REQUANT_SHIFT;
+        hidden[j] = (int8_t)(value < 0 ? 0 : value > 127 ? 127 : value);
+    }
+
+    OccupancyScore score;
+    for (int k = 0; k < OCC_OUTPUTS; k++) {
+        score.logits[k] = dotProductS8(OCC_W2[k], hidden, OCC_HIDDEN) + OCC_B2[k];
+    }
+    score.margin = (float)(score.logits[1] - score.logits[0]) * OCC_OUTPUT_SCALE;
+    return score;
+}
+
+OccupancyVerdict OccupancyClassifier::judge(bool occupied, const uint8_t* thumbnail, unsigned long captureUs) {
+    stats.lastInferenceUs = 0;
+    stats.lastLatencyUs = captureUs;
+    if (captureUs <= latencyBudgetUs) {
+        unsigned long start = hal::micros();
+        OccupancyScore score = classify(thumbnail);
+        stats.lastInferenceUs = hal::micros() - start;
+        stats.lastLatencyUs += stats.lastInferenceUs;
+        stats.lastMargin = score.margin;
+    }
+    if (stats.lastLatencyUs > stats.maxLatencyUs) {
+        stats.maxLatencyUs = stats.lastLatencyUs;
+    }
+    if (stats.lastLatencyUs > latencyBudgetUs) {
+        stats.overBudget++;
+        return OCCUPANCY_UNSURE;
+    }
+
+    // Positivo: la cámara coincide con el cambio propuesto
+    float agreement = occupied ? stats.lastMargin : -stats.lastMargin;
+    if (agreement >= margin) {
+        stats.confirmed++;
+        holdActive = false;
+        return OCCUPANCY_CONFIRMED;
+    }
+    if (agreement <= -margin) {
+        stats.vetoed++;
+        holdActive = true;
+        heldOccupied = occupied;
+        heldSince = hal::millis();
+        return OCCUPANCY_VETOED;
+    }
+    stats.unsure++;
+    return OCCUPANCY_UNSURE;
+}
+
+OccupancyVerdict OccupancyClassifier::verify(bool occupied, CameraManager& camera) {
+    if (holdActive && heldOccupied == occupied && hal::millis() - heldSince < vetoHoldMs) {
+        stats.held++;
+        return OCCUPANCY_VETOED;
+    }
+    holdActive = false;
+
+    unsigned long start = hal::micros();
+    if (!camera.captureGrayscale(gray, OCC_INPUT_WIDTH, OCC_INPUT_HEIGHT)) {
+        stats.unsure++;
+        return OCCUPANCY_UNSURE;
+    }
+    return judge(occupied, gray, hal::micros() - start);
+}
+
+void OccupancyClassifier::setMargin(float margin) {
+    this->margin = margin > 0 ? margin : OCC_DEFAULT_MARGIN;
+}
+
+void OccupancyClassifier::setLatencyBudget(unsigned long us) {
+    latencyBudgetUs = us;
+}
+
+void OccupancyClassifier::setVetoHold(unsigned long ms) {
+    vetoHoldMs = ms;
+}
+
+float OccupancyClassifier::getMargin() const {
+    return margin;
+}
+
+unsigned long OccupancyClassifier::getLatencyBudget() const {
+    return latencyBudgetUs;
+}
+
+OccupancyClassifierStats OccupancyClassifier::getStats() const {
+    return stats;
+}
+
+void OccupancyClassifier::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,93 @@
+#ifndef OCCUPANCYCLASSIFIER_H
+#define OCCUPANCYCLASSIFIER_H
+
+#include "Hal.h"
+#include "CameraManager.h"
+#include "OccupancyModel.h"
+
+// Confirmación de los cambios de ocupación con la cámara.
+//
+// El ultrasonido da lecturas cortas con cualquier cosa frente al sensor: una
+// persona, un carrito, lluvia fuerte. Antes de enviar un cambio de estado se
+// toma una miniatura en escala de grises del espacio (CameraManager::
+// captureGrayscale, OCC_INPUT_WIDTH x OCC_INPUT_HEIGHT) y un clasificador
+// int8 (OccupancyModel.h, generado por train_occupancy_model.py) dice si hay
+// un auto. El margen logit(auto) - logit(vacío) decide:
+//
+//   coincide con el cambio y supera el margen   → confirmado
+//   lo contradice y supera el margen            → vetado
+//   margen chico, sin cámara o fuera de tiempo  → dudoso: vale el ultrasonido
+//
+// El presupuesto de latencia cubre captura + inferencia; si se pasa, el
+// veredicto no se usa (falla abierto). Tras un veto, el mismo cambio se veta
+// sin capturar durante vetoHoldMs para no tomar una foto en cada medición
+// mientras la persona sigue ahí.
+//
+// La inferencia es aritmética entera (Int8Kernels.h): el host da los mismos
+// logits que la placa, bit a bit (ver OccupancyReference.h).
+
+enum OccupancyVerdict {
+    OCCUPANCY_CONFIRMED,
+    OCCUPANCY_VETOED,
+    OCCUPANCY_UNSURE
+};
+
+struct OccupancyScore {
+    int32_t logits[OCC_OUTPUTS];    // [vacío, auto]
+    float margin;                   // logit(auto) - logit(vacío)
+};
+
+struct OccupancyClassifierStats {
+    uint32_t confirmed;
+    uint32_t vetoed;
+    uint32_t unsure;            // Margen chico o sin cámara
+    uint32_t overBudget;        // Captura + inferencia fuera de presupuesto
+    uint32_t held;              // Vetos repetidos sin capturar
+    float lastMargin;
+    unsigned long lastLatencyUs;    // Captura + inferencia
+    unsigned long lastInferenceUs;
+    unsigned long maxLatencyUs;
+};
+
+#define OCC_DEFAULT_MARGIN 2.0f             // ~88 % de confianza
+#define OCC_DEFAULT_BUDGET_US 150000UL
+#define OCC_DEFAULT_VETO_HOLD_MS 20000UL
+
+class OccupancyClassifier {
+private:
+    float margin;
+    unsigned long latencyBudgetUs;
+    unsigned long vetoHoldMs;
+    bool holdActive;
+    bool heldOccupied;          // Cambio vetado que se mantiene
+    unsigned long heldSince;
+    OccupancyClassifierStats stats;
+    alignas(16) uint8_t gray[OCC_INPUTS];
+
+public:
+    OccupancyClassifier();
+
+    // Autoverificación del kernel vectorial (ver Int8Kernels.h); false si
+    // queda el escalar
+    bool begin();
+
+    // Logits de una miniatura OCC_INPUT_WIDTH x OCC_INPUT_HEIGHT (0-255)
+    OccupancyScore classify(const uint8_t* thumbnail) const;
+
+    // Veredicto sobre un cambio a 'occupied' con una miniatura ya tomada en
+    // captureUs: aplica el margen, el presupuesto y la espera tras un veto
+    OccupancyVerdict judge(bool occupied, const uint8_t* thumbnail, unsigned long captureUs);
+
+    // Todo junto: espera tras veto, captura con la cámara y judge()
+    OccupancyVerdict verify(bool occupied, CameraManager& camera);
+
+    void setMargin(float margin);
+    void setLatencyBudget(unsigned long us);
+    void setVetoHold(unsigned long ms);
+    float getMargin() const;
+    unsigned long getLatencyBudget() const;
+    OccupancyClassifierStats getStats() const;
+    void resetStats();
+};
+
+#endif // OCCUPANCYCLASSIFIER_H
@@ -0,0 +1,264 @@
+#ifndef OCCUPANCYMODEL_H
+#define OCCUPANCYMODEL_H
+
+// Generado por train_occupancy_model.py: no editar a mano.
+// 6000 muestras, semilla 42; validación int8: 97.1% de aciertos, 96.0% con margen >= 2.0 (98.3% de aciertos)
+//
+// Miniatura 16x12 menos su promedio (int8) → 16 ReLU (int8) → 2 logits (int32).
+// Los pesos van alineados a 16 bytes para las cargas de 128 bits del ESP32-S3.
+
+#include <stdint.h>
+
+#define OCC_INPUT_WIDTH 16
+#define OCC_INPUT_HEIGHT 12
+#define OCC_INPUTS 192
+#define OCC_HIDDEN 16
+#define OCC_OUTPUTS 2
+
+alignas(16) static const int8_t OCC_W1[OCC_HIDDEN][OCC_INPUTS] = {
+    {
+        -11, -11, -8, 0, 7, -1, 21, 5, -1, -3, 0, 24, 24, -17, -23, -17,
+        -4, 11, 5, -6, 5, -8, 8, 20, -1, -30, 9, 16, 19, -33, -10, -23,
+        -28, -5, -6, -1, 6, -26, 8, 19, -5, -37, -4, 31, 33, -11, -8, 1,
+        -3, -10, -9, -4, -19, 9, -6, 6, 6, 2, 24, 38, 26, -24, -24, -4,
+        11, -15, 16, -24, -26, -13, -50, 41, -8, -11, 30, 27, 6, -34, -10, 7,
+        -11, -1, -30, -43, -34, -19, -27, 19, -10, 0, 31, 34, -10, -39, 4, 18,
+        8, -5, 3, -39, -1, -25, -28, 12, 3, 24, 30, 18, -34, -9, 8, 11,
+        0, 0, -5, -55, 3, -2, -8, 40, 48, 4, 17, -9, -6, -11, 24, 19,
+        23, -12, -29, -35, 34, -30, 16, 58, 52, 16, -11, -24, -51, -24, 7, 41,
+        7, 20, -15, -29, 28, 36, 54, 43, -25, -38, 20, -1, -44, -14, 12, 33,
+        32, 32, 18, 27, 33, 19, 12, 2, -6, -26, 35, -31, -43, 1, 8, 16,
+        20, 29, -6, 2, 23, 10, 17, -36, -20, -6, 4, -4, 3, 34, 5, 32,
+    },
+    {
+        -27, 18, -11, 1, 4, 8, 20, -1, 37, 14, 17, 18, 3, 12, -18, -14,
+        -40, 21, 10, 13, -5, 13, 36, -5, -9, 0, 16, 31, 17, 7, -29, -17,
+        0, 8, -8, -6, 24, 35, 7, 14, -15, 7, 19, 21, 0, 0, -16, -14,
+        -19, 9, -19, -17, 5, 13, -17, 10, -9, 1, -9, 13, 8, 7, 25, 1,
+        3, 2, -10, 4, -4, -68, -45, -13, 1, -28, -51, -53, -14, -12, -5, -2,
+        -6, -22, 12, -4, 11, -25, -3, 17, 12, -13, -2, -15, -33, -9, -10, 4,
+        -5, 5, 26, -3, 6, -7, 22, 23, 41, 3, 28, 13, 19, -4, 4, 2,
+        6, -3, -11, 10, 0, -35, 9, 10, 25, 15, 9, -27, -20, 4, 13, 49,
+        24, -26, 20, -30, -4, -48, -57, -19, 0, -50, -19, -31, -10, -2, 16, 10,
+        5, 12, -2, 4, -3, -33, -13, -15, 17, 22, 0, -14, -11, -5, 17, 25,
+        21, -7, 13, -4, 10, -12, 4, -12, -8, -12, -11, -19, -30, 6, 1, 43,
+        45, 20, 6, 4, 10, -23, 0, -7, -18, -26, -13, 41, 2, 18, 10, 41,
+    },
+    {
+        31, 34, 43, 23, 40, 8, 76, 41, 38, 64, 44, 35, 6, 66, 29, 39,
+        12, 4, -17, 2, 17, -19, 29, 18, 32, 32, 34, 8, 10, 24, 27, 38,
+        7, -9, -27, -37, -43, -26, -11, -9, -11, 19, -1, -20, -14, -8, 22, 31,
+        15, 7, -27, -35, -18, -29, -73, -32, -23, -17, -60, -80, -14, -16, -4, 1,
+        20, -14, -20, -41, -21, -59, -21, -21, 7, -24, -52, -68, -10, 3, -5, 24,
+        18, -7, -30, -30, -39, -41, -48, -91, -61, -54, -80, -50, -43, -8, 9, -16,
+        11, 7, -1, -10, -36, -6, -23, -32, -23, -61, -71, -65, -36, -2, -18, 8,
+        -3, 0, 24, 17, -14, 27, 12, 39, 24, -26, 4, 7, 29, 9, 5, 4,
+        -2, -10, 26, -17, -20, 7, -12, 15, 5, -46, -30, -25, 30, -4, 5, -22,
+        -17, -17, 24, 49, 27, 20, 5, 11, -60, 13, 3, 2, 54, -21, -20, -30,
+        -37, -2, 21, 38, 59, 84, 90, 84, 60, 99, 70, 46, 43, 8, -17, -52,
+        -56, -34, -20, -16, -3, -7, 76, 108, 69, 11, 0, -11, 14, -60, -36, -42,
+    },
+    {
+        -49, -18, -2, 12, 10, 16, 2, -19, -2, -11, -21, -8, -19, -14, -31, -40,
+        -28, 15, 9, 34, 20, 9, 38, -8, 21, 4, -11, 15, 10, -20, -41, -25,
+        -18, 7, 16, 11, 28, 35, 14, 10, 5, 8, 27, 8, 3, -2, -8, -17,
+        -33, 0, 15, 16, 14, 27, 31, 25, 28, 33, 35, 17, 9, -13, -25, -22,
+        6, -11, -18, -4, 0, -45, 14, 5, 11, 5, 7, -6, 14, -11, 7, -24,
+        23, 0, -9, -10, -21, -22, 30, 11, 8, -32, 13, -7, -12, -6, -20, -7,
+        16, 0, -11, -17, -30, -35, 25, 25, 31, -24, 2, 3, 11, 10, -5, -9,
+        15, 17, 1, -36, -86, -94, -69, -80, -55, -66, -37, -21, -22, -15, 8, 5,
+        26, 12, 15, -25, -60, -57, -52, -42, -2, -30, -14, -12, 4, -1, -2, 11,
+        58, 19, 18, 14, 56, -13, 25, 21, 34, 35, 22, 19, 10, -21, -12, 5,
+        38, -2, -13, -1, 2, -33, -1, 2, -44, 10, 7, -21, -44, -21, 9, 67,
+        38, 40, 47, 9, -4, -16, -6, -10, -41, -75, -20, 2, -21, 5, 12, 52,
+    },
+    {
+        39, 7, 0, 16, 5, -3, -26, -11, 14, -12, -4, 3, 9, -14, -7, -24,
+        5, 1, 10, -3, -13, -10, 10, 4, -9, -36, -28, 14, -30, -4, -30, -16,
+        -6, 1, -57, -25, -23, 4, -13, -8, -55, -28, -23, 6, 4, 3, -10, -3,
+        9, -2, -2, -8, -10, -13, -16, -6, -13, -55, -36, -8, -3, -8, 8, 3,
+        5, 14, 13, -6, -25, -36, -7, -1, -13, -9, -42, -35, 16, -12, -8, 25,
+        7, -8, 24, 15, 35, 21, 54, 11, 32, 1, 22, 44, 33, -3, -2, -5,
+        28, 8, 17, 31, 22, 41, 7, 64, 69, 55, 50, 18, 42, 47, 31, 31,
+        -4, 4, 27, 11, 11, 27, 62, 106, 87, 100, 51, 16, 20, 15, 21, 30,
+        -5, 0, 0, 5, 3, 5, 10, 19, 29, 24, 9, -28, 18, 6, -17, 16,
+        -19, 7, -13, -12, -19, -34, -75, -15, 64, -28, -92, -82, -26, -13, 2, 15,
+        -17, -19, 4, 16, 7, 7, -44, 10, 16, -21, -55, -18, 7, -17, -5, -39,
+        -34, -15, -5, -20, 22, -21, -19, -27, 26, -31, -39, 24, -2, -20, -27, -23,
+    },
+    {
+        2, 11, -3, -17, 19, 35, 51, 13, -28, -20, 4, -4, 12, -29, 11, 35,
+        24, 45, -5, 19, 14, 50, 50, 8, -8, -7, 25, -14, -10, 2, 15, 18,
+        -7, 16, 13, 7, -15, 29, 60, -1, 20, -17, -77, -41, -24, 5, -3, 5,
+        2, -9, -26, -22, -28, 0, 58, -5, -5, -35, -24, -2, -8, 3, 2, -17,
+        8, 8, 3, -19, -35, -7, 1, 18, -24, -40, -20, 11, 4, 14, -3, -11,
+        -23, -22, -10, -16, -41, -27, 19, 51, 6, 5, -55, -16, 1, 7, 16, 0,
+        -32, 0, -1, -2, -9, 1, 30, 26, 4, -1, -67, 15, -15, 49, 13, 5,
+        -19, 5, -19, -44, -16, 10, 10, -10, 9, -24, -77, 23, 8, 29, 4, 12,
+        -18, 1, -21, -29, -10, 24, 72, 63, 33, -36, -76, -1, 23, 32, 2, 17,
+        -6, -13, -26, -45, -14, 45, 69, 78, 14, -58, -58, -4, 9, 32, 6, 0,
+        -2, -6, 12, 1, -25, 15, 62, 43, 16, -39, -70, -45, 24, -4, 17, -18,
+        -33, 7, -27, -16, -32, -25, -28, -5, -10, 10, -18, -13, 30, -3, 1, -1,
+    },
+    {
+        33, 3, -4, 5, -5, 14, -1, 9, -4, -18, -46, -26, 8, -2, 11, 28,
+        44, 13, -5, 16, 4, 8, 1, 10, -4, -16, -34, -38, 1, -19, 47, 28,
+        33, 10, 8, -5, -5, -17, -17, 11, 6, -8, -5, -1, -19, -10, 16, 13,
+        25, 4, -23, -2, 8, 8, -19, 11, -9, 21, 44, 13, -4, -6, 28, -10,
+        0, -7, -7, 14, 25, 30, -24, 0, -9, -4, 28, -24, -55, -8, 8, 1,
+        -25, -12, -16, 8, 39, 22, -37, 6, 3, 11, 18, -2, -24, -11, 37, 20,
+        1, -17, -44, 1, -7, -23, -22, -14, 8, 17, 38, 16, -21, -16, 29, 20,
+        -13, 15, -28, -6, 9, -27, -70, -29, -11, 6, 40, 12, -24, 2, 8, -21,
+        -5, 12, -9, -6, 0, -49, -28, -55, -5, 78, 102, 49, -9, -24, -6, 11,
+        14, 8, -15, -3, -30, -41, -24, -84, -57, 20, 113, 81, 14, 19, 15, 3,
+        11, 5, 4, -15, -17, -27, -37, -48, -21, -7, 70, 49, 26, 12, -6, 4,
+        1, -19, -2, -8, 2, 30, 1, -39, -20, 23, 5, -30, -19, 6, -1, -17,
+    },
+    {
+        -66, -49, 15, -21, -9, -3, -18, -4, 34, 13, 7, 21, 16, 29, -15, -40,
+        -35, -15, 2, 5, 14, 12, 23, 17, 9, 25, 17, 54, 17, 16, -6, -16,
+        -40, 16, 13, 34, 47, 13, 11, 2, 30, 36, 39, 15, 12, 23, -3, -9,
+        -19, -12, 19, 5, 14, 17, 7, 22, 24, 34, 9, 21, -8, 7, 0, -13,
+        7, -11, -6, 17, -20, -23, -23, 17, 4, 0, -4, -24, -29, -3, 13, -1,
+        -2, 0, -28, -34, -22, -14, 7, -21, -27, -60, -17, -31, -37, -14, -46, -20,
+        16, 16, -17, 6, -18, 18, 36, 29, -5, -34, 3, -7, -5, -7, -53, -6,
+        4, -10, -17, -8, -42, 40, 8, 8, 12, 24, 34, -9, -26, -19, 1, 8,
+        -4, -4, -29, -24, -55, -13, -90, -91, -53, -31, -9, -9, -43, 13, -14, 14,
+        5, -20, -20, -41, -63, -34, -31, -80, -26, -9, -15, -7, -50, -30, 6, 20,
+        33, -13, 4, 3, -6, 12, -24, -43, -57, -40, 1, -4, -48, 12, 22, 68,
+        50, 37, 34, 26, 17, 21, 23, 30, -41, 8, 29, 71, 24, 71, 61, 63,
+    },
+    {
+        11, -32, -4, -12, 20, 19, 28, 47, -11, -6, 18, -32, 8, -24, -11, -2,
+        7, -26, -5, 1, 17, 3, 4, 33, 3, 10, 8, -27, 24, -7, -37, 14,
+        11, -35, 13, 0, -10, -35, -41, 10, 39, 1, 17, -18, -10, 1, -19, 11,
+        3, -19, -3, 10, -14, -10, 6, -30, 24, 72, 16, -26, 9, 5, -11, 10,
+        1, -11, 31, -2, 1, 14, -20, 7, 28, 68, 18, -24, 7, -6, -12, 17,
+        -17, 2, 21, 29, -41, -12, -3, 4, 16, 28, -26, -50, -18, 20, -5, 26,
+        2, -19, 27, 1, -12, -44, -19, 3, 6, 54, -12, -42, -48, -1, 1, 26,
+        20, 25, 21, 27, 5, -61, -53, -5, 51, 53, -13, -49, -38, -2, -6, -1,
+        -17, 1, 10, -4, -46, -105, -76, 26, 89, 68, -3, -2, -36, 23, 8, 17,
+        -2, 14, 13, 21, -54, -102, 17, 44, 70, -4, 6, -22, -46, 20, -18, -2,
+        7, 20, -1, -23, -72, -81, -15, 77, 118, 30, -25, -58, -55, 29, -30, 14,
+        -4, 19, -5, 12, -11, 2, 22, 34, 42, 11, -44, -21, -17, -11, -20, 12,
+    },
+    {
+        44, 11, -4, -9, -12, -21, -16, -28, -19, -25, 5, -20, -3, 21, 4, 37,
+        54, -15, -7, -24, 3, -4, -8, 8, -42, -28, -33, -14, -30, -11, -1, -1,
+        9, -17, -40, -33, -23, 17, -8, 16, -40, -17, -38, -14, -24, -12, 23, 17,
+        24, 14, -7, -10, 15, -7, 14, 11, -4, -24, -64, -57, -6, 7, -6, 30,
+        10, 30, 16, 10, -3, -6, 66, 16, -4, -4, 15, -13, -2, 8, 2, 37,
+        5, 18, 11, 43, 32, 13, 39, 15, 11, 33, 66, 31, 17, 20, 14, 5,
+        27, 15, 50, 16, 24, -13, -14, -7, 40, 5, 82, 18, 46, 31, 46, 48,
+        -2, 26, -5, 10, -4, -4, 38, 38, 45, 70, 69, 27, 10, -3, 19, 3,
+        5, -6, 24, 9, 15, 41, 97, 70, 68, 74, 97, 25, 16, 4, 2, -12,
+        -26, 0, -4, 7, 9, -5, -3, 24, 41, 38, 20, -31, 0, 7, 15, 4,
+        -35, -37, -14, -5, -15, -18, 0, 28, 8, 19, -28, 2, -2, -16, -33, -50,
+        -65, -49, -15, -24, -27, -15, -24, 0, -6, -10, -28, -19, -30, -65, -37, -55,
+    },
+    {
+        -22, -31, -12, -19, -1, -14, -12, -24, -31, -2, -16, -38, -13, 10, 20, -16,
+        -18, -16, 2, -17, -12, -6, -4, -39, -3, -10, -8, -8, 19, -9, -14, -11,
+        -24, -22, -16, -26, 29, 28, -2, 18, 27, 41, 22, 19, -6, 0, -9, -17,
+        -16, 12, 7, 18, 27, 22, 42, 57, 103, 65, 52, 32, 24, 20, -7, -25,
+        10, 10, -8, 4, 6, 16, 59, 58, 94, 98, 50, 16, 3, 16, 5, 2,
+        10, 5, 2, 2, 11, -23, 12, -64, -12, -38, -21, 10, 14, 5, 3, -28,
+        -4, -2, -13, -2, -52, -44, -55, -83, -51, -127, -104, -66, -33, 2, 3, -5,
+        -12, -30, -4, -15, -30, -33, -8, -6, -7, -24, -11, -11, -20, -4, -13, -8,
+        -5, 22, 24, -1, 8, 11, 38, 14, 49, 28, 19, 25, -1, 4, -2, -3,
+        11, 12, -1, 17, 46, 17, -10, 2, 36, 20, 7, 10, 15, 4, -10, 10,
+        4, -11, 16, 5, -25, 0, -12, -18, -36, -37, -2, -34, -24, -14, 10, 19,
+        35, 28, 11, 8, -20, 15, 26, 17, -14, -53, -11, -7, -14, 17, 19, 25,
+    },
+    {
+        14, 20, 5, 11, -14, -24, 1, 19, 22, -15, -8, -21, 0, 52, 12, 15,
+        -9, 1, 19, -7, -3, -10, 15, 22, 14, -19, -24, -18, -17, 36, -6, 8,
+        -11, -4, 10, -15, -7, -20, 1, 35, 36, -12, -27, -22, -17, 36, -42, -11,
+        8, 9, 9, -14, -6, -50, 2, 12, 43, -8, -28, -28, 23, 35, -31, 27,
+        -18, -12, -7, -25, -12, -6, 5, 71, 29, 14, -49, 9, 34, 56, -24, -23,
+        -4, 0, -17, 3, -28, -3, -5, 54, 42, -1, -54, 24, -5, 32, -15, -13,
+        -14, -10, 15, 10, 16, -25, -10, 45, 0, -10, -19, -3, -6, 24, -32, 2,
+        -8, 4, -6, -9, -4, -24, -34, 15, 16, 5, -26, 17, -2, 42, -12, 0,
+        11, -26, -12, -16, 11, -11, -54, 23, -5, 16, 5, 31, 14, 39, -22, 16,
+        -13, 2, 30, 12, 34, 5, -49, -2, -47, -10, 26, -7, -8, 12, -47, 17,
+        -9, 15, 61, 17, 19, 42, -23, 13, -12, -13, -20, -21, -9, 13, -40, -5,
+        -22, -13, 24, 16, 18, 8, 4, 33, 5, -17, -22, -7, -31, -10, -44, -14,
+    },
+    {
+        9, 7, 9, -10, -40, 2, 5, -13, -35, -2, -20, 0, -36, -10, 27, 20,
+        5, 2, -4, -12, -9, 3, -10, 2, 3, 24, 19, -5, -33, 5, 3, 2,
+        7, 17, 10, -34, -24, 18, 39, 28, -2, 25, 15, 21, -6, 17, 13, 7,
+        -1, 6, -24, -19, -16, 41, 60, 30, -9, -23, -14, -6, -29, 4, 12, 6,
+        -44, -31, -30, -5, -6, 48, 9, 15, -32, -12, -31, -29, -52, -10, 16, -20,
+        -21, -19, -1, -1, 6, 34, 3, 33, -26, 20, -36, -48, -40, 0, 28, -2,
+        -4, -28, -19, 6, 18, 0, 14, -1, -26, 24, -33, -13, -8, 6, 6, 9,
+        -16, -18, 13, 8, 19, -13, 32, 3, -33, -18, -28, -35, -5, -28, -27, -9,
+        -14, -5, 20, 34, 47, 14, 48, -23, -75, 2, 14, 3, -17, -46, -25, -13,
+        32, 53, 60, 49, 49, 2, -7, -80, -57, 1, 42, 8, 12, 43, -12, 12,
+        19, 11, 40, 27, 34, 38, -15, -74, -83, -38, 19, 13, 31, 14, 0, 4,
+        23, 34, -11, 34, 19, 18, 21, -74, -54, 13, 30, 14, 54, -10, -5, 2,
+    },
+    {
+        -43, -38, -24, -45, -12, -39, -44, -27, -20, -10, -30, -9, -21, -29, -48, -51,
+        -23, -14, 15, -5, 26, 16, 4, -14, -9, 0, 3, 18, 8, -21, -39, -37,
+        -26, 29, -1, 29, 25, 45, 10, 37, 16, 21, 28, 18, 33, 15, -4, -22,
+        3, 15, 22, 20, 27, 46, 42, 57, 41, 25, 28, 50, 36, 15, -10, 4,
+        7, 27, 3, 18, -2, -20, 5, 47, 64, 29, 46, -27, 5, -1, 9, 4,
+        16, 2, -9, 16, 15, -13, -2, -22, -2, -31, 15, 12, 13, -11, -7, -16,
+        22, 16, -19, -35, 8, -16, -21, -34, -30, -29, 10, 9, 9, 2, -11, 5,
+        2, -14, -39, -55, -29, -11, -22, -4, 8, 1, 31, -3, 3, -13, 17, 28,
+        17, -2, 27, -31, -4, 5, -14, -41, -38, -15, 1, -34, -7, -5, 8, 11,
+        40, 9, 1, -12, -6, -21, -32, 1, 36, 12, -1, -23, -18, 3, 11, 33,
+        36, 2, -24, -35, -18, -29, -24, -49, -46, -34, -8, -8, -49, -8, 5, 41,
+        64, 38, 26, -2, 14, -8, -50, -34, -56, -62, 5, 33, -20, 39, 31, 34,
+    },
+    {
+        30, 7, 25, 13, -6, -8, 1, 8, -13, 11, 10, 2, 3, 9, 7, 4,
+        9, 4, 5, -11, -13, -16, 4, 6, -1, -7, 25, -11, -25, -2, -8, 17,
+        4, 0, -22, -11, -15, -22, 1, -35, -9, 6, -5, -4, -16, -24, -1, 1,
+        7, 12, -8, 9, -6, -4, -17, 7, 27, 32, 3, -22, -6, -16, -7, 11,
+        11, -21, -8, -10, -20, -41, -8, -20, -1, -30, -1, -6, -1, -17, 10, 14,
+        12, -14, -5, -16, 4, 0, 6, 10, 23, -6, 5, 3, 5, -9, -1, 6,
+        -2, -14, 14, -7, -6, 29, 12, 32, 24, -1, 18, 12, -18, 13, 19, 1,
+        -16, 4, 23, 20, -15, -22, -31, -24, -13, -50, 1, 9, -5, 4, 6, -6,
+        -10, -1, 4, 18, 1, -14, -51, -7, 1, -28, 19, -11, 22, 10, -9, 8,
+        -28, -9, 6, 49, 57, 35, 22, 33, 54, 57, 42, 34, 46, 6, 9, 9,
+        -23, -17, 11, 5, 33, 37, 14, 45, 35, 33, 15, 36, 25, -3, -20, -30,
+        -37, -19, -9, 2, -19, -26, -32, -20, 47, -12, -21, -5, -30, -36, -35, -39,
+    },
+    {
+        1, 16, 6, 31, -10, -17, 14, 12, 18, -39, 7, 19, 20, -21, -3, -9,
+        31, 20, 1, 32, -12, -14, 28, -5, 15, 25, 26, -3, 11, -15, -27, -14,
+        -17, -2, 21, 39, -1, -14, 16, 16, 5, -6, 17, 28, 40, -16, -26, 8,
+        -9, -32, 0, -12, -8, -6, 30, -16, -18, -35, 23, 32, 26, -16, -20, 8,
+        -5, -15, 4, -3, -9, -17, 19, 26, -29, -20, 5, 18, 20, -19, -37, 12,
+        -3, -2, 29, 12, -46, -12, 11, 25, -17, 2, 15, 30, 7, -14, -11, 18,
+        -3, 19, 24, 41, 4, -26, -31, -33, -39, 3, 6, 37, 27, 13, -1, 11,
+        -13, -39, 17, 7, -23, -17, -24, -41, -31, -28, -4, 27, 53, 14, -13, 23,
+        -5, -19, 5, 32, -6, -19, 7, -38, -60, -24, -9, 25, 30, -8, -12, 7,
+        -3, -10, 15, 42, -9, 3, 36, 1, 3, -10, -59, -24, 1, 11, -19, 21,
+        -17, -21, 3, 18, 4, 44, 77, 51, 14, -26, -72, -42, -4, -7, -12, 36,
+        -11, 0, -6, 30, 13, 13, 26, 23, 12, -3, -24, -10, 15, -13, -40, 9,
+    },
+};
+
+static const int32_t OCC_B1[OCC_HIDDEN] = {
+    -1220, -935, -795, -2375, -1090, -1426, -2879, -215,
+    1871, -1333, -1730, -714, -2291, -2139, -1706, -3051,
+};
+
+// Recuantización de la capa oculta: (acc * MULTIPLIER + 2^(SHIFT-1)) >> SHIFT
+static const int32_t OCC_REQUANT_MULTIPLIER = 1896862087;
+static const int OCC_REQUANT_SHIFT = 42;
+
+alignas(16) static const int8_t OCC_W2[OCC_OUTPUTS][OCC_HIDDEN] = {
+    {83, -70, -76, -90, -100, 66, 44, -68, 68, -70, -127, 60, 85, -48, -67, 64},
+    {-73, 36, 91, 75, 60, -69, -109, 99, -108, 80, 53, -90, -77, 64, 66, -75},
+};
+
+static const int32_t OCC_B2[OCC_OUTPUTS] = {437, -437};
+
+// Valor real (logit) de una unidad de los logits enteros
+static const float OCC_OUTPUT_SCALE = 0.00455405774f;
+
+#endif // OCCUPANCYMODEL_H
@@ -0,0 +1,143 @@
+#ifndef OCCUPANCYREFERENCE_H
+#define OCCUPANCYREFERENCE_H
+
+// Generado por train_occupancy_model.py: no editar a mano.
+//
+// Miniaturas de prueba y los logits que calcula la referencia entera en
+// Python. El kernel del ESP32 (vectorial o escalar) y el del host tienen que
+// dar exactamente estos valores. Solo para pruebas y benchmark: no incluir
+// en el firmware.
+
+#include <stdint.h>
+
+#include "OccupancyModel.h"
+
+#define OCC_REFERENCE_COUNT 8
+
+static const uint8_t OCC_REFERENCE_INPUTS[OCC_REFERENCE_COUNT][OCC_INPUTS] = {
+    {  // auto
+        193, 163, 164, 163, 162, 163, 163, 166, 165, 166, 164, 166, 165, 185, 167, 168,
+        191, 161, 161, 162, 164, 162, 163, 163, 163, 164, 165, 164, 164, 185, 165, 166,
+        189, 159, 159, 161, 164, 160, 163, 162, 163, 163, 163, 163, 165, 184, 163, 166,
+        187, 127, 127, 127, 128, 128, 129, 129, 129, 129, 128, 129, 145, 181, 162, 161,
+        186, 65, 39, 13, 11, 14, 13, 14, 12, 13, 15, 65, 115, 180, 160, 161,
+        183, 65, 39, 13, 14, 13, 15, 13, 13, 13, 13, 66, 112, 178, 160, 160,
+        182, 64, 53, 39, 40, 39, 39, 40, 37, 39, 39, 64, 112, 174, 156, 159,
+        180, 64, 65, 64, 65, 64, 65, 64, 64, 65, 64, 66, 109, 175, 155, 156,
+        178, 65, 64, 65, 66, 66, 64, 65, 64, 66, 66, 65, 108, 173, 156, 156,
+        179, 65, 44, 44, 65, 66, 65, 65, 65, 65, 48, 53, 109, 171, 153, 153,
+        177, 147, 142, 141, 149, 148, 149, 148, 150, 150, 145, 149, 151, 170, 151, 151,
+        174, 146, 147, 148, 146, 148, 147, 148, 147, 148, 148, 148, 150, 168, 149, 150,
+    },
+    {  // vacío
+        76, 77, 77, 78, 80, 80, 81, 82, 83, 84, 84, 85, 61, 37, 38, 38,
+        77, 77, 79, 79, 80, 81, 81, 82, 84, 84, 85, 86, 61, 38, 38, 38,
+        77, 78, 79, 80, 81, 81, 82, 83, 84, 85, 86, 87, 62, 38, 38, 40,
+        78, 78, 79, 80, 81, 81, 83, 84, 84, 85, 86, 87, 62, 38, 40, 40,
+        78, 79, 80, 81, 82, 82, 83, 84, 85, 86, 87, 87, 64, 39, 40, 41,
+        79, 80, 80, 82, 82, 83, 84, 84, 85, 86, 88, 88, 64, 39, 41, 41,
+        80, 81, 81, 82, 83, 84, 85, 85, 87, 86, 88, 89, 64, 40, 41, 42,
+        80, 80, 82, 82, 84, 84, 85, 85, 86, 87, 88, 89, 65, 41, 42, 42,
+        81, 82, 83, 83, 84, 85, 85, 86, 88, 89, 89, 90, 65, 41, 42, 44,
+        81, 82, 83, 83, 84, 85, 86, 87, 87, 88, 89, 90, 66, 42, 43, 43,
+        82, 83, 83, 84, 85, 85, 87, 88, 88, 89, 90, 90, 66, 43, 43, 45,
+        82, 83, 84, 85, 86, 86, 87, 88, 89, 89, 91, 92, 67, 43, 44, 44,
+    },
+    {  // auto
+        115, 88, 82, 84, 87, 86, 85, 86, 85, 86, 84, 85, 85, 84, 83, 103,
+        117, 88, 72, 77, 87, 85, 79, 80, 85, 85, 87, 85, 85, 85, 84, 104,
+        118, 87, 87, 87, 88, 86, 78, 81, 86, 86, 86, 87, 85, 84, 85, 104,
+        120, 90, 89, 89, 89, 88, 87, 87, 88, 88, 88, 86, 87, 87, 87, 106,
+        120, 89, 133, 175, 176, 176, 175, 175, 175, 174, 130, 88, 87, 86, 87, 104,
+        120, 91, 132, 175, 175, 175, 174, 174, 174, 175, 133, 89, 88, 88, 88, 105,
+        119, 91, 133, 176, 176, 177, 175, 175, 176, 175, 131, 88, 89, 87, 87, 108,
+        122, 92, 134, 175, 175, 175, 174, 174, 175, 175, 132, 89, 90, 88, 88, 108,
+        122, 93, 134, 174, 175, 175, 176, 175, 174, 175, 133, 88, 89, 89, 89, 109,
+        122, 94, 128, 165, 166, 164, 165, 164, 165, 165, 127, 90, 90, 89, 88, 109,
+        125, 93, 78, 62, 62, 62, 61, 62, 61, 60, 74, 93, 90, 91, 91, 109,
+        124, 94, 93, 95, 93, 93, 93, 92, 93, 93, 93, 91, 92, 91, 92, 110,
+    },
+    {  // vacío
+        111, 109, 109, 108, 107, 107, 106, 106, 105, 104, 104, 103, 104, 102, 101, 101,
+        112, 112, 111, 111, 110, 109, 109, 108, 108, 107, 107, 106, 105, 105, 104, 104,
+        115, 114, 114, 113, 113, 112, 111, 112, 110, 110, 110, 108, 108, 107, 106, 106,
+        117, 117, 116, 116, 115, 114, 115, 114, 113, 112, 111, 110, 111, 110, 109, 109,
+        120, 118, 118, 118, 118, 117, 116, 116, 116, 115, 115, 113, 112, 113, 112, 110,
+        122, 122, 120, 120, 120, 119, 119, 119, 117, 117, 116, 116, 114, 114, 114, 113,
+        126, 124, 125, 123, 124, 122, 123, 121, 120, 120, 119, 118, 118, 117, 117, 116,
+        128, 126, 126, 124, 119, 123, 123, 123, 122, 123, 122, 121, 120, 120, 118, 119,
+        129, 129, 128, 123, 111, 124, 126, 126, 125, 124, 124, 123, 122, 123, 121, 121,
+        132, 132, 132, 130, 130, 130, 129, 127, 128, 127, 126, 126, 125, 125, 124, 123,
+        135, 135, 134, 133, 133, 132, 131, 131, 131, 130, 129, 128, 128, 127, 126, 127,
+        137, 137, 136, 135, 134, 134, 135, 134, 133, 132, 132, 130, 131, 129, 128, 128,
+    },
+    {  // auto
+        188, 187, 188, 186, 186, 186, 184, 187, 185, 185, 185, 186, 184, 183, 183, 181,
+        188, 189, 187, 188, 187, 187, 187, 186, 185, 184, 182, 185, 186, 185, 183, 182,
+        188, 189, 187, 189, 186, 188, 186, 186, 187, 186, 187, 185, 186, 185, 184, 184,
+        191, 190, 189, 203, 203, 203, 201, 203, 202, 201, 202, 187, 185, 185, 186, 183,
+        192, 191, 189, 231, 231, 231, 231, 232, 231, 231, 232, 187, 189, 185, 185, 187,
+        191, 192, 192, 231, 231, 232, 231, 232, 232, 231, 230, 190, 187, 188, 186, 187,
+        193, 192, 190, 230, 231, 232, 229, 233, 229, 231, 230, 188, 191, 188, 187, 186,
+        191, 193, 194, 231, 230, 232, 232, 231, 231, 231, 233, 189, 189, 189, 187, 188,
+        193, 194, 192, 231, 230, 231, 232, 232, 228, 231, 231, 191, 189, 189, 190, 188,
+        193, 194, 193, 206, 204, 207, 206, 204, 204, 206, 203, 190, 190, 189, 189, 190,
+        195, 195, 195, 196, 194, 196, 194, 192, 194, 192, 191, 193, 194, 189, 190, 192,
+        195, 197, 196, 195, 195, 194, 195, 194, 194, 193, 192, 193, 192, 191, 193, 192,
+    },
+    {  // vacío
+        133, 154, 134, 135, 135, 136, 138, 139, 139, 141, 142, 143, 143, 143, 145, 167,
+        137, 159, 139, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149, 149, 171,
+        142, 163, 143, 144, 145, 145, 147, 147, 149, 149, 150, 151, 152, 153, 153, 175,
+        145, 167, 148, 148, 148, 150, 151, 151, 152, 153, 153, 153, 155, 157, 158, 179,
+        150, 171, 152, 153, 152, 154, 155, 156, 157, 158, 151, 149, 161, 161, 161, 184,
+        153, 175, 156, 156, 157, 159, 159, 160, 160, 161, 162, 164, 165, 165, 167, 188,
+        158, 179, 160, 160, 162, 163, 164, 164, 164, 166, 168, 163, 167, 169, 170, 192,
+        162, 184, 164, 165, 166, 167, 168, 168, 169, 171, 113, 57, 57, 56, 175, 197,
+        167, 188, 168, 169, 170, 171, 173, 173, 174, 174, 115, 57, 57, 56, 179, 201,
+        171, 192, 173, 173, 174, 175, 176, 177, 178, 178, 159, 140, 141, 141, 183, 205,
+        175, 197, 177, 177, 178, 180, 180, 181, 183, 183, 184, 184, 186, 186, 188, 209,
+        180, 201, 181, 182, 183, 184, 185, 185, 186, 187, 188, 189, 190, 191, 191, 213,
+    },
+    {  // auto
+        156, 178, 153, 154, 152, 151, 150, 150, 148, 148, 148, 145, 145, 167, 143, 142,
+        155, 178, 153, 153, 153, 152, 152, 149, 149, 148, 146, 146, 146, 169, 143, 143,
+        157, 170, 127, 126, 125, 124, 125, 125, 124, 122, 124, 121, 134, 169, 143, 143,
+        157, 160, 99, 61, 44, 43, 43, 44, 44, 43, 43, 97, 121, 168, 146, 144,
+        156, 161, 97, 62, 43, 44, 44, 44, 45, 44, 43, 98, 122, 167, 145, 145,
+        159, 161, 98, 87, 79, 80, 80, 79, 80, 79, 78, 98, 123, 169, 146, 144,
+        158, 161, 97, 98, 99, 99, 97, 98, 99, 98, 98, 98, 124, 171, 146, 146,
+        159, 162, 98, 98, 99, 98, 100, 98, 99, 97, 98, 98, 123, 171, 147, 146,
+        161, 161, 98, 61, 88, 98, 98, 99, 98, 98, 59, 73, 124, 171, 147, 146,
+        160, 174, 138, 97, 129, 136, 137, 135, 134, 134, 96, 113, 142, 171, 146, 145,
+        162, 182, 158, 158, 157, 156, 155, 154, 153, 152, 151, 150, 149, 171, 148, 147,
+        160, 182, 159, 159, 158, 156, 155, 154, 153, 152, 152, 151, 149, 172, 147, 147,
+    },
+    {  // vacío
+        116, 127, 119, 116, 117, 119, 120, 117, 120, 121, 121, 121, 121, 121, 120, 131,
+        116, 128, 117, 116, 117, 119, 121, 118, 117, 119, 120, 119, 121, 120, 121, 132,
+        117, 129, 117, 116, 119, 118, 120, 116, 116, 119, 120, 118, 121, 120, 122, 129,
+        116, 128, 115, 118, 117, 117, 118, 114, 114, 119, 118, 121, 120, 121, 121, 131,
+        116, 128, 118, 116, 117, 116, 118, 119, 119, 119, 118, 120, 119, 121, 120, 130,
+        116, 127, 119, 117, 119, 117, 121, 118, 119, 119, 119, 121, 119, 120, 120, 131,
+        117, 127, 119, 118, 117, 119, 118, 120, 120, 118, 119, 120, 120, 120, 120, 133,
+        115, 127, 116, 117, 117, 118, 118, 120, 117, 120, 121, 120, 120, 120, 119, 132,
+        115, 125, 117, 116, 118, 117, 120, 118, 118, 120, 119, 119, 120, 120, 121, 131,
+        116, 126, 117, 116, 117, 118, 117, 118, 120, 119, 120, 120, 121, 121, 123, 130,
+        116, 127, 115, 117, 117, 118, 119, 120, 119, 120, 121, 119, 119, 119, 121, 129,
+        117, 127, 118, 116, 118, 116, 119, 118, 116, 118, 119, 120, 120, 121, 120, 132,
+    },
+};
+
+static const int32_t OCC_REFERENCE_LOGITS[OCC_REFERENCE_COUNT][OCC_OUTPUTS] = {
+    {-7549, 8655},
+    {528, -585},
+    {-4052, 3062},
+    {673, -695},
+    {-1932, 1470},
+    {1558, -1685},
+    {-3546, 3845},
+    {435, -509},
+};
+
+#endif // OCCUPANCYREFERENCE_H
@@ -0,0 +1,301 @@
+#include "DeltaPatch.h"
+
+#include <string.h>
+
+// CRC-32 (el de zlib) con tabla de 16 entradas: poca flash y suficiente
+// velocidad para verificar la imagen completa
+static const uint32_t CRC_NIBBLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t readLe32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+DeltaPatcher::DeltaPatcher() {
+    DeltaIo none = {NULL, NULL, NULL};
+    begin(none);
+}
+
+void DeltaPatcher::begin(const DeltaIo& io) {
+    this->io = io;
+    state = ST_HEADER;
+    error = DELTA_OK;
+    oldSize = oldCrc = newSize = newCrc = 0;
+    varint = 0;
+    varintShift = 0;
+    oldPos = 0;
+    remaining = 0;
+    spanRemaining = 0;
+    produced = 0;
+    crc = 0;
+    patchBytes = 0;
+    outLength = 0;
+    oldCacheStart = 0;
+    oldCacheLength = 0;
+}
+
+bool DeltaPatcher::fail(DeltaError code) {
+    state = ST_ERROR;
+    error = code;
+    return false;
+}
+
+// LEB128: 7 bits por byte, el bit alto indica que sigue otro
+bool DeltaPatcher::varintByte(uint8_t byte, bool& complete) {
+    if (varintShift > 35) {
+        return fail(DELTA_BAD_PATCH);
+    }
+    varint |= (uint64_t)(byte & 0x7F) << varintShift;
+    varintShift += 7;
+    complete = (byte & 0x80) == 0;
+    return true;
+}
+
+bool DeltaPatcher::parseHeader() {
+    if (memcmp(header, DELTA_MAGIC, 4) != 0 || header[4] != DELTA_VERSION) {
+        return fail(DELTA_BAD_HEADER);
+    }
+    oldSize = readLe32(header + 8);
+    oldCrc = readLe32(header + 12);
+    newSize = readLe32(header + 16);
+    newCrc = readLe32(header + 20);
+    if (newSize == 0) {
+        return fail(DELTA_BAD_HEADER);
+    }
+    if (oldSize > 0 && !verifySource()) {
+        return false;
+    }
+    state = ST_OPCODE;
+    return true;
+}
+
+bool DeltaPatcher::verifySource() {
+    // El buffer de salida todavía está vacío: sirve de bloque de lectura
+    uint32_t sourceCrc = 0;
+    for (uint32_t offset = 0; offset < oldSize; ) {
+        size_t chunk = oldSize - offset < DELTA_OUT_BUFFER ? oldSize - offset : DELTA_OUT_BUFFER;
+        if (!io.readOld(io.context, offset, out, chunk)) {
+            return fail(DELTA_READ_FAILED);
+        }
+        sourceCrc = crc32Update(sourceCrc, out, chunk);
+        offset += chunk;
+    }
+    return sourceCrc == oldCrc ? true : fail(DELTA_BAD_SOURCE);
+}
+
+bool DeltaPatcher::flushOut() {
+    if (outLength == 0) {
+        return true;
+    }
+    crc = crc32Update(crc, out, outLength);
+    if (!io.writeNew(io.context, out, outLength)) {
+        return fail(DELTA_WRITE_FAILED);
+    }
+    outLength = 0;
+    return true;
+}
+
+bool DeltaPatcher::emit(uint8_t byte) {
+    out[outLength++] = byte;
+    produced++;
+    return outLength < DELTA_OUT_BUFFER || flushOut();
+}
+
+bool DeltaPatcher::oldByte(uint32_t position, uint8_t& value) {
+    if (position < oldCacheStart || position >= oldCacheStart + oldCacheLength) {
+        size_t length = oldSize - position < DELTA_OLD_CACHE ? oldSize - position : DELTA_OLD_CACHE;
+        if (!io.readOld(io.context, position, oldCache, length)) {
+            return fail(DELTA_READ_FAILED);
+        }
+        oldCacheStart = position;
+        oldCacheLength = length;
+    }
+    value = oldCache[position - oldCacheStart];
+    return true;
+}
+
+// Bytes iguales: directo de la imagen anterior al buffer de salida
+bool DeltaPatcher::copyOld(uint32_t count) {
+    while (count > 0) {
+        size_t space = DELTA_OUT_BUFFER - outLength;
+        size_t chunk = count < space ? count : space;
+        if (!io.readOld(io.context, oldPos, out + outLength, chunk)) {
+            return fail(DELTA_READ_FAILED);
+        }
+        outLength += chunk;
+        oldPos += chunk;
+        produced += chunk;
+        remaining -= chunk;
+        count -= chunk;
+        if (outLength == DELTA_OUT_BUFFER && !flushOut()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeltaPatcher::afterOperation() {
+    if (produced < newSize) {
+        state = ST_OPCODE;
+        return true;
+    }
+    if (!flushOut()) {
+        return false;
+    }
+    if (crc != newCrc) {
+        return fail(DELTA_BAD_OUTPUT);
+    }
+    state = ST_DONE;
+    return true;
+}
+
+bool DeltaPatcher::feed(const uint8_t* data, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        if (state == ST_ERROR) {
+            return false;
+        }
+        if (state == ST_DONE) {
+            return fail(DELTA_BAD_PATCH);   // Bytes de más después de la imagen
+        }
+
+        // Bytes literales y de diferencia: por bloques
+        if (state == ST_INSERT_BYTES || state == ST_DIFF_BYTES) {
+            uint32_t& pending = state == ST_INSERT_BYTES ? remaining : spanRemaining;
+            size_t count = length - i < pending ? length - i : pending;
+            for (size_t k = 0; k < count; k++) {
+                uint8_t value = data[i + k];
+                if (state == ST_DIFF_BYTES) {
+                    uint8_t previous;
+                    if (!oldByte(oldPos++, previous)) {
+                        return false;
+                    }
+                    value = (uint8_t)(previous + value);
+                }
+                if (!emit(value)) {
+                    return false;
+                }
+            }
+            i += count;
+            patchBytes += count;
+            if (state == ST_DIFF_BYTES) {
+                remaining -= count;
+                spanRemaining -= count;
+                if (spanRemaining == 0 && !(remaining == 0 ? afterOperation() : (state = ST_SPAN_EQUAL, true))) {
+                    return false;
+                }
+            } else {
+                remaining -= count;
+                if (remaining == 0 && !afterOperation()) {
+                    return false;
+                }
+            }
+            varint = 0;
+            varintShift = 0;
+            continue;
+        }
+
+        uint8_t byte = data[i++];
+        patchBytes++;
+
+        if (state == ST_HEADER) {
+            header[patchBytes - 1] = byte;
+            if (patchBytes == DELTA_HEADER_SIZE && !parseHeader()) {
+                return false;
+            }
+            continue;
+        }
+
+        if (state == ST_OPCODE) {
+            if (byte == 'A') state = ST_ADD_OFFSET;
+            else if (byte == 'I') state = ST_INSERT_LENGTH;
+            else return fail(DELTA_BAD_PATCH);
+            varint = 0;
+            varintShift = 0;
+            continue;
+        }
+
+        bool complete;
+        if (!varintByte(byte, complete)) {
+            return false;
+        }
+        if (!complete) {
+            continue;
+        }
+        uint64_t value = varint;
+        varint = 0;
+        varintShift = 0;
+
+        switch (state) {
+            case ST_ADD_OFFSET: {
+                int64_t delta = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+                int64_t position = (int64_t)oldPos + delta;
+                if (position < 0 || position > (int64_t)oldSize) {
+                    return fail(DELTA_BAD_PATCH);
+                }
+                oldPos = (uint32_t)position;
+                state = ST_ADD_LENGTH;
+                break;
+            }
+            case ST_ADD_LENGTH:
+                if (value == 0 || value > newSize - produced || value > oldSize - oldPos) {
+                    return fail(DELTA_BAD_PATCH);
+                }
+                remaining = (uint32_t)value;
+                state = ST_SPAN_EQUAL;
+                break;
+            case ST_SPAN_EQUAL:
+                if (value > remaining || !copyOld((uint32_t)value)) {
+                    return state == ST_ERROR ? false : fail(DELTA_BAD_PATCH);
+                }
+                if (remaining == 0) {
+                    if (!afterOperation()) return false;
+                } else {
+                    state = ST_SPAN_DIFF;
+                }
+                break;
+            case ST_SPAN_DIFF:
+                if (value == 0 || value > remaining) {
+                    return fail(DELTA_BAD_PATCH);
+                }
+                spanRemaining = (uint32_t)value;
+                state = ST_DIFF_BYTES;
+                break;
+            case ST_INSERT_LENGTH:
+                if (value == 0 || value > newSize - produced) {
+                    return fail(DELTA_BAD_PATCH);
+                }
+                remaining = (uint32_t)value;
+                state = ST_INSERT_BYTES;
+                break;
+            default:
+                return fail(DELTA_BAD_PATCH);
+        }
+    }
+    return state != ST_ERROR;
+}
+
+const char* DeltaPatcher::errorName(DeltaError error) {
+    switch (error) {
+        case DELTA_OK:           return "ok";
+        case DELTA_BAD_HEADER:   return "bad_header";
+        case DELTA_BAD_SOURCE:   return "bad_source";
+        case DELTA_BAD_PATCH:    return "bad_patch";
+        case DELTA_READ_FAILED:  return "read_failed";
+        case DELTA_WRITE_FAILED: return "write_failed";
+        case DELTA_BAD_OUTPUT:   return "bad_output";
+    }
+    return "unknown";
+}
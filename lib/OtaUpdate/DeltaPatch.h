@@ -0,0 +1,113 @@
+#ifndef DELTAPATCH_H
+#define DELTAPATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Parches binarios de firmware (formato "PKDL", generados por ota_delta.py)
+// aplicados en streaming: el parche llega por partes desde la red, los bytes
+// de la imagen anterior se leen de la partición en ejecución y la imagen
+// nueva se escribe por bloques, sin tenerla nunca completa en RAM.
+//
+// Cabecera (24 bytes, little-endian):
+//     "PKDL", versión (u8), flags (u8), reservado (u16),
+//     tamaño anterior (u32), CRC-32 anterior (u32),
+//     tamaño nuevo (u32), CRC-32 nuevo (u32)
+// Operaciones, hasta completar el tamaño nuevo:
+//     'A' desplazamiento (varint zigzag, relativo al final del 'A' anterior),
+//         longitud (varint), y pares hasta cubrirla:
+//         iguales (varint), distintos (varint), distintos bytes de diferencia
+//         (nuevo = anterior + diferencia, módulo 256)
+//     'I' longitud (varint), longitud bytes literales
+//
+// Un parche con tamaño anterior 0 es la imagen completa (sin imagen base).
+// Antes de la primera operación se verifica el CRC de la imagen anterior y
+// al terminar el de la nueva. Sin dependencias de Arduino ni memoria dinámica.
+
+#define DELTA_MAGIC "PKDL"
+#define DELTA_VERSION 1
+#define DELTA_HEADER_SIZE 24
+#define DELTA_OUT_BUFFER 512
+#define DELTA_OLD_CACHE 64
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length);
+
+enum DeltaError {
+    DELTA_OK,
+    DELTA_BAD_HEADER,       // Magic o versión desconocidos
+    DELTA_BAD_SOURCE,       // La imagen en ejecución no es la base del parche
+    DELTA_BAD_PATCH,        // Operación inválida o fuera de rango
+    DELTA_READ_FAILED,
+    DELTA_WRITE_FAILED,
+    DELTA_BAD_OUTPUT,       // Tamaño o CRC de la imagen nueva incorrectos
+};
+
+// Acceso a la imagen anterior y a la partición de destino
+struct DeltaIo {
+    bool (*readOld)(void* context, uint32_t offset, uint8_t* buffer, size_t size);
+    bool (*writeNew)(void* context, const uint8_t* data, size_t size);
+    void* context;
+};
+
+class DeltaPatcher {
+private:
+    enum State {
+        ST_HEADER, ST_OPCODE, ST_ADD_OFFSET, ST_ADD_LENGTH, ST_SPAN_EQUAL, ST_SPAN_DIFF,
+        ST_DIFF_BYTES, ST_INSERT_LENGTH, ST_INSERT_BYTES, ST_DONE, ST_ERROR
+    };
+
+    DeltaIo io;
+    State state;
+    DeltaError error;
+
+    uint8_t header[DELTA_HEADER_SIZE];
+    uint32_t oldSize;
+    uint32_t oldCrc;
+    uint32_t newSize;
+    uint32_t newCrc;
+
+    uint64_t varint;            // Entero en lectura y su desplazamiento en bits
+    uint8_t varintShift;
+
+    uint32_t oldPos;            // Siguiente byte de la imagen anterior
+    uint32_t remaining;         // Bytes pendientes de la operación actual
+    uint32_t spanRemaining;     // Bytes distintos pendientes del par actual
+    uint32_t produced;          // Bytes de la imagen nueva ya generados
+    uint32_t crc;
+    uint32_t patchBytes;
+
+    uint8_t out[DELTA_OUT_BUFFER];
+    size_t outLength;
+    uint8_t oldCache[DELTA_OLD_CACHE];
+    uint32_t oldCacheStart;
+    size_t oldCacheLength;
+
+    bool fail(DeltaError code);
+    bool varintByte(uint8_t byte, bool& complete);
+    bool parseHeader();
+    bool verifySource();
+    bool emit(uint8_t byte);
+    bool flushOut();
+    bool oldByte(uint32_t position, uint8_t& value);
+    bool copyOld(uint32_t count);
+    bool afterOperation();
+
+public:
+    DeltaPatcher();
+
+    void begin(const DeltaIo& io);
+
+    // Consume un trozo del parche; false si el parche quedó en error
+    bool feed(const uint8_t* data, size_t length);
+
+    bool isDone() const { return state == ST_DONE; }
+    bool hasFailed() const { return state == ST_ERROR; }
+    DeltaError getError() const { return error; }
+    uint32_t getNewSize() const { return newSize; }
+    uint32_t getProduced() const { return produced; }
+    uint32_t getPatchBytes() const { return patchBytes; }
+
+    static const char* errorName(DeltaError error);
+};
+
+#endif // DELTAPATCH_H
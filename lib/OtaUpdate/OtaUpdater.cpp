@@ -0,0 +1,130 @@
+#include "OtaUpdater.h"
+
+#include <string.h>
+
+#include "HalOta.h"
+
+OtaUpdater::OtaUpdater() {
+    state = OTA_IDLE;
+    id[0] = '\0';
+    size = 0;
+    received = 0;
+    requested = 0;
+    lastProgressMs = 0;
+    failure = "";
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool OtaUpdater::readOld(void* context, uint32_t offset, uint8_t* buffer, size_t length) {
+    (void)context;
+    return hal::runningImageRead(offset, buffer, length);
+}
+
+bool OtaUpdater::writeNew(void* context, const uint8_t* data, size_t length) {
+    (void)context;
+    return hal::otaWrite(data, length);
+}
+
+void OtaUpdater::fail(const char* reason) {
+    if (state == OTA_DOWNLOADING) {
+        hal::otaAbort();
+    }
+    state = OTA_FAILED;
+    failure = reason;
+}
+
+bool OtaUpdater::offer(const char* patchId, uint32_t patchSize, unsigned long nowMs) {
+    stats.offers++;
+    bool same = strcmp(patchId, id) == 0 && patchSize == size;
+
+    if (same && state == OTA_DONE) {
+        return true;    // Ya aplicado: solo falta reiniciar
+    }
+    if (same && state == OTA_DOWNLOADING) {
+        stats.resumes++;
+        rewind(nowMs);
+        return true;
+    }
+
+    if (state == OTA_DOWNLOADING) {
+        hal::otaAbort();
+    }
+    strncpy(id, patchId, CMD_MAX_OTA_ID - 1);
+    id[CMD_MAX_OTA_ID - 1] = '\0';
+    size = patchSize;
+    received = 0;
+    requested = 0;
+    lastProgressMs = nowMs;
+    failure = "";
+
+    if (!hal::otaBegin()) {
+        state = OTA_FAILED;
+        failure = "no_partition";
+        return false;
+    }
+    DeltaIo io = {readOld, writeNew, this};
+    patcher.begin(io);
+    state = OTA_DOWNLOADING;
+    return true;
+}
+
+void OtaUpdater::rewind(unsigned long nowMs) {
+    requested = received;
+    lastProgressMs = nowMs;
+}
+
+bool OtaUpdater::nextRequest(uint32_t& offset, uint32_t& length, unsigned long nowMs) {
+    if (state != OTA_DOWNLOADING) {
+        return false;
+    }
+    if (requested > received && nowMs - lastProgressMs >= OTA_REQUEST_TIMEOUT_MS) {
+        stats.retries++;
+        rewind(nowMs);
+    }
+    if (requested >= size || requested - received >= OTA_WINDOW * OTA_CHUNK_SIZE) {
+        return false;
+    }
+    offset = requested;
+    length = size - requested < OTA_CHUNK_SIZE ? size - requested : OTA_CHUNK_SIZE;
+    requested += length;
+    stats.requests++;
+    return true;
+}
+
+bool OtaUpdater::acceptChunk(const char* patchId, uint32_t offset, uint32_t length) {
+    // Solo el trozo que sigue: los repetidos (pedidos de nuevo tras un corte)
+    // y los de una oferta anterior se descartan
+    return state == OTA_DOWNLOADING && offset == received && length <= size - received &&
+           strcmp(patchId, id) == 0;
+}
+
+bool OtaUpdater::feedChunk(const uint8_t* data, size_t length, unsigned long nowMs) {
+    if (state != OTA_DOWNLOADING) {
+        stats.discardedBytes += length;
+        return false;
+    }
+    if (!patcher.feed(data, length)) {
+        fail(DeltaPatcher::errorName(patcher.getError()));
+        return false;
+    }
+    received += length;
+    lastProgressMs = nowMs;
+    if (requested < received) {
+        requested = received;
+    }
+
+    if (received < size) {
+        return true;
+    }
+    if (!patcher.isDone()) {
+        fail("truncated");
+        return false;
+    }
+    if (!hal::otaEnd()) {
+        state = OTA_FAILED;
+        failure = "activate_failed";
+        return false;
+    }
+    state = OTA_DONE;
+    return true;
+}
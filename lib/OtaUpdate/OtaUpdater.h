@@ -0,0 +1,85 @@
+#ifndef OTAUPDATER_H
+#define OTAUPDATER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "CommandChannel.h"
+#include "DeltaPatch.h"
+
+// Descarga reanudable de un parche de firmware sobre la conexión con el
+// servidor (tramas OTA/OTAD de CommandChannel.h).
+//
+// El dispositivo pide el parche por trozos ({"ota":"get",...}) con hasta
+// OTA_WINDOW pedidos en vuelo; el servidor responde cada uno sin guardar
+// estado. Cada trozo recibido en orden se aplica de inmediato con
+// DeltaPatcher y la imagen nueva va directo a la partición inactiva. Si la
+// conexión se corta, el progreso queda en RAM y al reconectar se vuelve a
+// pedir desde el último byte aplicado; los trozos repetidos o fuera de orden
+// se descartan. Un reinicio empieza la descarga de cero.
+
+#define OTA_CHUNK_SIZE 1024
+#define OTA_WINDOW 4                    // Pedidos en vuelo
+#define OTA_REQUEST_TIMEOUT_MS 5000     // Sin datos: se vuelve a pedir desde lo aplicado
+#define OTA_RESTART_DELAY_MS 2000       // Tiempo para avisar al servidor antes de reiniciar
+
+enum OtaState {
+    OTA_IDLE,
+    OTA_DOWNLOADING,
+    OTA_DONE,           // Imagen nueva validada: arranca en el próximo reinicio
+    OTA_FAILED
+};
+
+struct OtaStats {
+    uint32_t offers;
+    uint32_t resumes;           // Ofertas o reconexiones que continuaron una descarga
+    uint32_t requests;
+    uint32_t retries;           // Ventanas pedidas de nuevo por timeout
+    uint32_t discardedBytes;    // Trozos repetidos, fuera de orden o de otro parche
+};
+
+class OtaUpdater {
+private:
+    OtaState state;
+    char id[CMD_MAX_OTA_ID];
+    uint32_t size;              // Tamaño del parche
+    uint32_t received;          // Bytes del parche ya aplicados
+    uint32_t requested;         // Fin de lo pedido
+    unsigned long lastProgressMs;
+    const char* failure;
+    DeltaPatcher patcher;
+    OtaStats stats;
+
+    void fail(const char* reason);
+    static bool readOld(void* context, uint32_t offset, uint8_t* buffer, size_t length);
+    static bool writeNew(void* context, const uint8_t* data, size_t length);
+
+public:
+    OtaUpdater();
+
+    // Oferta del servidor. El mismo parche continúa donde quedó; uno distinto
+    // descarta la descarga anterior. false si no se puede escribir la partición.
+    bool offer(const char* patchId, uint32_t patchSize, unsigned long nowMs);
+
+    // Tras reconectar: lo pedido y no recibido se perdió con la conexión
+    void rewind(unsigned long nowMs);
+
+    // Siguiente pedido a enviar, si la ventana lo permite
+    bool nextRequest(uint32_t& offset, uint32_t& length, unsigned long nowMs);
+
+    // Cabecera OTAD: true si el trozo debe aplicarse (feedChunk con sus bytes)
+    bool acceptChunk(const char* patchId, uint32_t offset, uint32_t length);
+    // false si los bytes no se aplicaron (parche rechazado: queda en OTA_FAILED)
+    bool feedChunk(const uint8_t* data, size_t length, unsigned long nowMs);
+    void discard(size_t length) { stats.discardedBytes += length; }
+
+    OtaState getState() const { return state; }
+    bool isActive() const { return state == OTA_DOWNLOADING; }
+    const char* getId() const { return id; }
+    uint32_t getSize() const { return size; }
+    uint32_t getReceived() const { return received; }
+    const char* getFailure() const { return failure; }
+    const OtaStats& getStats() const { return stats; }
+};
+
+#endif // OTAUPDATER_H
@@ -0,0 +1,24 @@
+#include "OccupancyDecision.h"
+
+OccupancyDecision::OccupancyDecision(float thresholdDistance) {
+    this->thresholdDistance = thresholdDistance;
+    reset();
+}
+
+bool OccupancyDecision::apply(float distance) {
+    bool first = !hasState;
+    hasState = true;
+    
+    // Actualizar estado anterior antes de cambiar el actual
+    previousOccupied = occupied;
+    occupied = (distance < thresholdDistance);
+    
+    // Solo enviar si cambió el estado o es la primera medición
+    return first || occupied != previousOccupied;
+}
+
+void OccupancyDecision::reset() {
+    occupied = false;
+    previousOccupied = false;
+    hasState = false;
+}
@@ -0,0 +1,46 @@
+#ifndef OCCUPANCYDECISION_H
+#define OCCUPANCYDECISION_H
+
+// Decisión de ocupación del ParkingSensor separada del hardware y la red:
+// dada una distancia medida decide el estado y si hay que enviar un evento.
+// La usan ParkingSensor::update() y el reproductor de trazas
+// (src/native/trace_replay.cpp), así que cualquier cambio al filtro se puede
+// comparar contra el historial de parking_sensor.log.
+//
+// Sin dependencias de Arduino ni reservas de memoria.
+
+// Rango válido del HC-SR04 en cm
+#define DISTANCE_MIN_CM 2.0f
+#define DISTANCE_MAX_CM 400.0f
+
+class OccupancyDecision {
+private:
+    float thresholdDistance;
+    bool occupied;
+    bool previousOccupied;
+    bool hasState;              // Hubo al menos una medición válida
+
+public:
+    explicit OccupancyDecision(float thresholdDistance = 50.0f);
+
+    // Aplica una medición válida; retorna true si debe enviarse un evento
+    // (cambio de estado o primera medición)
+    bool apply(float distance);
+    void reset();
+
+    // Deshace el cambio que acaba de aplicar apply() cuando otra fuente lo
+    // desmiente (p. ej. la cámara): vuelve al estado anterior sin cambio
+    void reject() { occupied = previousOccupied; }
+
+    bool isOccupied() const { return occupied; }
+    bool wasOccupied() const { return previousOccupied; }
+    bool hasChanged() const { return occupied != previousOccupied; }
+    float getThreshold() const { return thresholdDistance; }
+    void setThreshold(float distance) { thresholdDistance = distance; }
+
+    static bool isValidDistance(float distance) {
+        return distance >= DISTANCE_MIN_CM && distance <= DISTANCE_MAX_CM;
+    }
+};
+
+#endif // OCCUPANCYDECISION_H
@@ -1,79 +1,136 @@
 #include "ParkingSensor.h"
+#include "Base64.h"
+#include "HalOta.h"
 
 ParkingSensor::ParkingSensor(int trigPin, int echoPin, int parkingId, 
                              const char* serverIP, int serverPort,
-                             float thresholdDistance) {
+                             float thresholdDistance)
+    : decision(thresholdDistance) {
     this->trigPin = trigPin;
     this->echoPin = echoPin;
     this->parkingId = parkingId;
-    this->serverIP = serverIP;
+    strncpy(this->serverIP, serverIP, CMD_MAX_SERVER_IP - 1);
+    this->serverIP[CMD_MAX_SERVER_IP - 1] = '\0';
     this->serverPort = serverPort;
-    this->thresholdDistance = thresholdDistance;
     
     // Estado inicial
-    this->isOccupied = false;
-    this->previousOccupied = false;
     this->lastDistance = 0.0;
     this->lastMeasurement = 0;
     this->measurementInterval = 1000; // Medir cada 1 segundo
     
-    // TCP
+    // TCP (TCP plano hasta que se configure otro transporte)
+    this->client = &tcpClient;
     this->tcpConnected = false;
     this->lastTcpAttempt = 0;
     this->tcpReconnectInterval = 5000; // Intentar reconectar cada 5 segundos
+    
+    // Estadísticas
+    this->connectAttempts = 0;
+    this->eventsSent = 0;
+    this->eventAcks = 0;
+    this->lastEventTimestamp = 0;
+    this->lastEventSentMicros = 0;
+    this->lastIngestLatency = 0;
+    this->ingestAckPending = false;
+    this->imageSentMicros = 0;
+    this->imageWireBytes = 0;
+    this->imageAckPending = false;
+    this->imageAckHandler = NULL;
+    
+    // Heartbeat (apagado por defecto: protocolo de eventos clásico)
+    this->heartbeatInterval = 0;
+    this->lastHeartbeat = 0;
+    this->heartbeatsSent = 0;
+    this->frameSeq = 0;
+    this->validMeasurements = 0;
+    this->failedMeasurements = 0;
+    this->hasMeasurement = false;
+    
+    // Comandos remotos
+    this->configHandler = NULL;
+    
+    // Sin verificación: el ultrasonido decide solo
+    this->transitionVerifier = NULL;
+    this->vetoedTransitions = 0;
+    
+    // OTA (deshabilitado hasta setOtaUpdater)
+    this->otaUpdater = NULL;
+    this->otaRawRemaining = 0;
+    this->otaRawAccepted = false;
+    this->otaReported = OTA_IDLE;
+    this->otaRestartAt = 0;
+    this->otaRestartPending = false;
+    
+    // Sin registro postmortem hasta setPostmortem
+    this->postmortem = NULL;
+    
+    // Modo directo hasta setFrameSender
+    this->frameSender = NULL;
+    this->leafEpoch = 0;
+    
+    // Serie cruda apagada hasta setRawStream o CFG raw=<ms>
+    this->rawBlocksSent = 0;
+    this->rawBlocksLost = 0;
+    
+    // Pines en tiempo de ejecución hasta setPing
+    this->pingFunction = NULL;
 }
 
 void ParkingSensor::begin() {
     Serial.println("=== INICIALIZANDO SENSOR DE PARQUEO ===");
     Serial.printf("ID de parqueo: %d\n", parkingId);
     Serial.printf("Pines - Trig: %d, Echo: %d\n", trigPin, echoPin);
-    Serial.printf("Distancia umbral: %.1f cm\n", thresholdDistance);
+    Serial.printf("Distancia umbral: %.1f cm\n", decision.getThreshold());
     Serial.printf("Servidor TCP: %s:%d\n", serverIP, serverPort);
     
-    // Configurar pines del sensor ultrasónico
-    pinMode(trigPin, OUTPUT);
-    pinMode(echoPin, INPUT);
+    // Configurar pines del sensor ultrasónico (también con setPing: mismos pines)
+    hal::gpioOutput(trigPin);
+    hal::gpioInput(echoPin);
     
     // Estado inicial del trigger
-    digitalWrite(trigPin, LOW);
+    hal::gpioWrite(trigPin, false);
+    
+    // El seq vuelve a empezar: el gateway lo distingue de una repetición
+    leafEpoch = (uint16_t)hal::random32();
     
     Serial.println("Sensor ultrasónico configurado correctamente");
     Serial.println("=============================================");
 }
 
 void ParkingSensor::update() {
-    unsigned long currentTime = millis();
+    unsigned long currentTime = hal::millis();
     
     // Medir distancia si ha pasado el intervalo
     if (currentTime - lastMeasurement >= measurementInterval) {
         float distance = measureDistance();
+        recordRaw(currentTime, distance);
+        SensorHealthState previousHealth = health.getState();
+        if (health.add(distance)) {
+            healthChanged(previousHealth);
+        }
         
         if (isDistanceValid(distance)) {
             lastDistance = distance;
-            
-            // Determinar si está ocupado
-            bool newOccupied = (distance < thresholdDistance);
-            
-            // Actualizar estado anterior antes de cambiar el actual
-            previousOccupied = isOccupied;
-            isOccupied = newOccupied;
+            validMeasurements++;
+            hasMeasurement = true;
             
             // Solo enviar datos si cambió el estado o es la primera medición
-            if (newOccupied != previousOccupied || lastMeasurement == 0) {
+            if (applyDistance(distance)) {
                 sendParkingData();
                 
                 Serial.printf("Parqueo %d - Distancia: %.1f cm, Estado: %s\n", 
-                             parkingId, distance, isOccupied ? "OCUPADO" : "LIBRE");
+                             parkingId, distance, decision.isOccupied() ? "OCUPADO" : "LIBRE");
                 
-                if (newOccupied != previousOccupied) {
+                if (decision.hasChanged()) {
                     Serial.printf("🔄 Cambio de estado: %s → %s\n", 
-                                 previousOccupied ? "OCUPADO" : "LIBRE",
-                                 isOccupied ? "OCUPADO" : "LIBRE");
+                                 decision.wasOccupied() ? "OCUPADO" : "LIBRE",
+                                 decision.isOccupied() ? "OCUPADO" : "LIBRE");
                 }
             }
         } else {
             // Si la medición no es válida, no actualizar el timestamp
             // para intentar de nuevo más rápido
+            failedMeasurements++;
             Serial.println("🔄 Reintentando medición en 500ms...");
             lastMeasurement = currentTime - measurementInterval + 500;
         }
@@ -81,38 +138,77 @@ void ParkingSensor::update() {
         lastMeasurement = currentTime;
     }
     
-    // Intentar conectar TCP si no está conectado
-    if (!tcpConnected && currentTime - lastTcpAttempt >= tcpReconnectInterval) {
+    // Intentar conectar TCP si no está conectado (en modo tramas no hay conexión)
+    if (!tcpConnected && frameSender == NULL && currentTime - lastTcpAttempt >= tcpReconnectInterval) {
         connectToServer();
         lastTcpAttempt = currentTime;
     }
+    
+    // Sin cambios: solo el heartbeat mantiene vivo el espacio en el servidor
+    if (heartbeatInterval > 0 && (tcpConnected || frameSender != NULL) &&
+        currentTime - lastHeartbeat >= heartbeatInterval) {
+        sendHeartbeat();
+    }
+    
+    // Bloque crudo vencido aunque no haya mediciones nuevas
+    if (rawStream.isDue((uint32_t)currentTime)) {
+        sendRawBlock();
+    }
+    
+    // Leer comandos del servidor sin bloquear
+    pollCommands();
+    
+    if (otaUpdater != NULL) {
+        serviceOta();
+    }
 }
 
-float ParkingSensor::measureDistance() {
+bool ParkingSensor::applyDistance(float distance) {
+    if (!decision.apply(distance)) {
+        return false;
+    }
+    if (decision.hasChanged() && transitionVerifier != NULL &&
+        !transitionVerifier(decision.isOccupied(), distance)) {
+        decision.reject();
+        vetoedTransitions++;
+        Serial.printf("🚫 Parqueo %d - Cambio a %s vetado (%.1f cm)\n",
+                     parkingId, decision.isOccupied() ? "LIBRE" : "OCUPADO", distance);
+        return false;
+    }
+    if (decision.hasChanged() && postmortem != NULL) {
+        postmortem->record(decision.isOccupied() ? PM_ARRIVAL : PM_DEPARTURE,
+                           (int32_t)(distance * 10.0f + 0.5f), hal::millis());
+    }
+    return true;
+}
+
+unsigned long ParkingSensor::ping(unsigned long timeoutUs) {
+    if (pingFunction != NULL) {
+        return pingFunction(timeoutUs);
+    }
+    
     // Limpiar el pin trigger
-    digitalWrite(trigPin, LOW);
-    delayMicroseconds(2);
+    hal::gpioWrite(trigPin, false);
+    hal::delayMicros(2);
     
     // Enviar pulso de 10 microsegundos
-    digitalWrite(trigPin, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(trigPin, LOW);
+    hal::gpioWrite(trigPin, true);
+    hal::delayMicros(10);
+    hal::gpioWrite(trigPin, false);
     
-    // Leer el tiempo de respuesta del echo con timeout más largo
-    unsigned long duration = pulseIn(echoPin, HIGH, 50000); // Timeout de 50ms
+    // Leer el tiempo de respuesta del echo
+    return hal::pulseInHigh(echoPin, timeoutUs);
+}
+
+float ParkingSensor::measureDistance() {
+    unsigned long duration = ping(50000); // Timeout de 50ms
     
     if (duration == 0) {
         Serial.println("⚠️ Timeout en medición ultrasónica - reintentando...");
         
         // Segundo intento con delay
-        delay(100);
-        digitalWrite(trigPin, LOW);
-        delayMicroseconds(2);
-        digitalWrite(trigPin, HIGH);
-        delayMicroseconds(10);
-        digitalWrite(trigPin, LOW);
-        
-        duration = pulseIn(echoPin, HIGH, 50000);
+        hal::delayMs(100);
+        duration = ping(50000);
         
         if (duration == 0) {
             Serial.println("❌ Error: Sensor ultrasónico no responde");
@@ -120,41 +216,81 @@ float ParkingSensor::measureDistance() {
         }
     }
     
+    return durationToDistance(duration);
+}
+
+float ParkingSensor::durationToDistance(unsigned long duration) {
     // Calcular distancia en cm
     // Velocidad del sonido = 343 m/s = 0.0343 cm/μs
     // Distancia = (tiempo * velocidad) / 2 (ida y vuelta)
-    float distance = (duration * 0.0343) / 2.0;
-    
-    return distance;
+    return (duration * 0.0343) / 2.0;
 }
 
 bool ParkingSensor::isDistanceValid(float distance) {
-    // Rango válido para HC-SR04: 2cm a 400cm
+    // Rango válido para HC-SR04: 2cm a 400cm (ver OccupancyDecision.h)
     // También verificar que no sea valor de error (-1.0)
+    if (OccupancyDecision::isValidDistance(distance)) {
+        return true;
+    }
+    
     if (distance < 0) {
         Serial.println("⚠️ Distancia inválida: valor de error");
         return false;
     }
     
-    if (distance < 2.0) {
+    if (distance < DISTANCE_MIN_CM) {
         Serial.println("⚠️ Distancia muy cercana: posible error de medición");
-        return false;
-    }
-    
-    if (distance > 400.0) {
+    } else {
         Serial.println("⚠️ Distancia muy lejana: posible error de medición");
-        return false;
     }
-    
-    return true;
+    return false;
 }
 
 bool ParkingSensor::connectToServer() {
     Serial.printf("Intentando conectar a servidor TCP %s:%d...\n", serverIP, serverPort);
+    connectAttempts++;
     
-    if (tcpClient.connect(serverIP, serverPort)) {
+    if (client->connect(serverIP, serverPort)) {
         tcpConnected = true;
+        commandParser.reset();
+        otaRawRemaining = 0;
         Serial.println("✅ Conectado al servidor TCP exitosamente");
+        
+        // Identificarse para que el servidor pueda enviar comandos de inmediato
+        char hello[96];
+        int length = snprintf(hello, sizeof(hello), "{\"hello\":true,\"parkingId\":%d", parkingId);
+        if (heartbeatInterval > 0) {
+            // El servidor usa el intervalo para decidir cuándo el espacio quedó sin noticias
+            length += snprintf(hello + length, sizeof(hello) - length, ",\"hb\":%lu", heartbeatInterval);
+        }
+        if (otaUpdater != NULL) {
+            // Imagen en ejecución: base de los parches que ofrezca el servidor
+            length += snprintf(hello + length, sizeof(hello) - length, ",\"fw\":\"%s\"", hal::firmwareId());
+        }
+        snprintf(hello + length, sizeof(hello) - length, "}");
+        client->println(hello);
+        
+        // Lo pedido antes del corte no va a llegar: seguir desde lo aplicado
+        if (otaUpdater != NULL) {
+            otaUpdater->rewind(hal::millis());
+        }
+        
+        if (postmortem != NULL) {
+            postmortem->record(PM_TCP_UP, (int32_t)connectAttempts, hal::millis());
+            if (postmortem->hasReport()) {
+                sendPostmortem();
+            }
+        }
+        
+        // Una falla anterior a la conexión (o a un reinicio del servidor) sigue en pie
+        if (health.getState() > HEALTH_OK) {
+            sendHealth();
+        }
+        
+        // Los cambios ocurridos sin conexión se perdieron: reenviar el estado actual
+        if (heartbeatInterval > 0 && hasMeasurement) {
+            sendParkingData();
+        }
         return true;
     } else {
         tcpConnected = false;
@@ -164,34 +300,461 @@ bool ParkingSensor::connectToServer() {
 }
 
 void ParkingSensor::sendParkingData() {
+    // La secuencia avanza aunque no haya conexión: el hueco le indica al
+    // servidor cuántos eventos se perdieron
+    frameSeq++;
+    
+    if (frameSender != NULL) {
+        sendLeafFrame(GW_FRAME_EVENT);
+        return;
+    }
+    
     if (!tcpConnected) {
         Serial.println("⚠️ No conectado al servidor TCP, no se pueden enviar datos");
         return;
     }
     
     // Crear JSON con los datos del parqueo
+    unsigned long timestamp = hal::millis();
+    String jsonData = buildParkingJson(timestamp);
+    
+    // Enviar datos
+    lastEventSentMicros = hal::micros();
+    client->println(jsonData);
+    
+    // Verificar si la conexión sigue activa
+    if (!client->connected()) {
+        connectionLost("⚠️ Conexión TCP perdida");
+    } else {
+        eventsSent++;
+        lastEventTimestamp = timestamp;
+        ingestAckPending = true;
+        lastHeartbeat = hal::millis(); // El evento también prueba que el sensor sigue vivo
+        Serial.printf("📤 Datos enviados: %s\n", jsonData.c_str());
+    }
+}
+
+void ParkingSensor::sendHeartbeat() {
+    frameSeq++;
+    lastHeartbeat = hal::millis();
+    
+    if (frameSender != NULL) {
+        sendLeafFrame(GW_FRAME_HEARTBEAT);
+        return;
+    }
+    
+    char frame[64];
+    size_t length = buildHeartbeat(frame, sizeof(frame));
+    client->write((const uint8_t*)frame, length);
+    
+    if (!client->connected()) {
+        connectionLost("⚠️ Conexión TCP perdida");
+        return;
+    }
+    heartbeatsSent++;
+}
+
+void ParkingSensor::sendPostmortem() {
+    String report = postmortem->buildReport(parkingId);
+    client->println(report);
+    if (!client->connected()) {
+        connectionLost("⚠️ Conexión TCP perdida enviando el informe postmortem");
+        return;
+    }
+    Serial.printf("🩺 Informe postmortem enviado (%u bytes, %u reinicio(s))\n",
+                  report.length(), (unsigned)postmortem->getPendingBoots());
+}
+
+void ParkingSensor::sendLeafFrame(uint8_t type) {
+    uint8_t frame[GW_FRAME_SIZE];
+    size_t length = encodeGatewayFrame(buildLeafFrame(type), frame);
+    if (!frameSender(frame, length)) {
+        Serial.printf("⚠️ Trama #%lu no enviada\n", (unsigned long)frameSeq);
+        return;
+    }
+    if (type == GW_FRAME_HEARTBEAT) {
+        heartbeatsSent++;
+        return;
+    }
+    eventsSent++;
+    lastEventTimestamp = hal::millis();
+    lastHeartbeat = lastEventTimestamp;
+    Serial.printf("📡 Evento #%lu enviado como trama (%s, %.1f cm)\n", (unsigned long)frameSeq,
+                  decision.isOccupied() ? "OCUPADO" : "LIBRE", lastDistance);
+}
+
+GatewayFrame ParkingSensor::buildLeafFrame(uint8_t type) const {
+    GatewayFrame frame;
+    frame.parkingId = (uint16_t)parkingId;
+    frame.epoch = leafEpoch;
+    frame.type = type;
+    frame.occupied = decision.isOccupied();
+    frame.distanceDm = (uint16_t)(lastDistance * 10.0f + 0.5f);
+    frame.seq = frameSeq;
+    frame.leafMs = (uint32_t)hal::millis();
+    frame.validMeasurements = (uint32_t)validMeasurements;
+    frame.failedMeasurements = (uint32_t)failedMeasurements;
+    frame.health = (uint8_t)health.getState();
+    return frame;
+}
+
+void ParkingSensor::recordRaw(unsigned long now, float distance) {
+    if (!rawStream.isEnabled()) {
+        return;
+    }
+    if (!rawStream.add((uint32_t)now, distance)) {
+        sendRawBlock();
+        rawStream.add((uint32_t)now, distance);
+    }
+    if (rawStream.isDue((uint32_t)now)) {
+        sendRawBlock();
+    }
+}
+
+void ParkingSensor::sendRawBlock() {
+    // Sin conexión se descarta: el número de bloque avanza y el servidor ve el hueco
+    if (!tcpConnected || frameSender != NULL) {
+        rawStream.drop();
+        rawBlocksLost++;
+        return;
+    }
+    
+    char line[RAW_LINE_BYTES];
+    size_t length = rawStream.buildLine(line);
+    client->write((const uint8_t*)line, length);
+    if (!client->connected()) {
+        rawBlocksLost++;
+        connectionLost("⚠️ Conexión TCP perdida enviando la serie cruda");
+        return;
+    }
+    rawBlocksSent++;
+}
+
+void ParkingSensor::healthChanged(SensorHealthState previous) {
+    // Al terminar el calentamiento en buen estado no hay nada que avisar
+    SensorHealthState state = health.getState();
+    if (previous == HEALTH_UNKNOWN && state == HEALTH_OK) {
+        return;
+    }
+    if (state == HEALTH_OK) {
+        Serial.printf("✅ Parqueo %d - Sensor ultrasónico funcionando normalmente\n", parkingId);
+    } else {
+        Serial.printf("🚨 Parqueo %d - Sensor ultrasónico: %s (timeouts %.0f%%, inválidas %.0f%%, "
+                      "desvío %.1f cm)\n", parkingId, sensorHealthName(state),
+                      health.getTimeoutRate() * 100.0f, health.getInvalidRate() * 100.0f,
+                      health.getNoise());
+    }
+    
+    if (frameSender != NULL) {
+        sendHeartbeat();    // La trama lleva el estado (ver GatewayFrame.h)
+    } else if (tcpConnected) {
+        sendHealth();
+    }
+}
+
+void ParkingSensor::sendHealth() {
+    char line[192];
+    snprintf(line, sizeof(line),
+             "{\"health\":\"%s\",\"parkingId\":%d,\"timeouts\":%.3f,\"invalid\":%.3f,"
+             "\"near\":%.3f,\"far\":%.3f,\"jumps\":%.3f,\"sd\":%.2f,\"stuck\":%lu}",
+             sensorHealthName(health.getState()), parkingId, health.getTimeoutRate(),
+             health.getInvalidRate(), health.getNearRate(), health.getFarRate(),
+             health.getJumpRate(), health.getNoise(), (unsigned long)health.getStuckRun());
+    client->println(line);
+    if (!client->connected()) {
+        connectionLost("⚠️ Conexión TCP perdida enviando la salud del sensor");
+    }
+}
+
+void ParkingSensor::connectionLost(const char* message) {
+    tcpConnected = false;
+    Serial.println(message);
+    if (postmortem != NULL) {
+        postmortem->record(PM_TCP_LOST, 0, hal::millis());
+    }
+}
+
+size_t ParkingSensor::buildHeartbeat(char* buffer, size_t size) const {
+    // HB <seq> <ocupado> <distancia> <mediciones válidas> <fallidas> <salud>
+    int length = snprintf(buffer, size, "HB %lu %d %.1f %lu %lu %u\r\n",
+                          (unsigned long)frameSeq, decision.isOccupied() ? 1 : 0, lastDistance,
+                          validMeasurements, failedMeasurements, (unsigned)health.getState());
+    if (length < 0) {
+        return 0;
+    }
+    return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+bool ParkingSensor::sendImage(const uint8_t* data, size_t length) {
+    if (!tcpConnected) {
+        Serial.println("⚠️ No conectado al servidor TCP, imagen no enviada");
+        return false;
+    }
+    
+    // Bloques de 768 bytes → 1024 caracteres: una escritura por bloque
+    const size_t blockInput = 768;
+    char block[1024];
+    
+    imageSentMicros = hal::micros();
+    imageWireBytes = 6 + base64Length(length) + 2;
+    imageAckPending = false;
+    
+    bool ok = client->print("IMAGE:") == 6;
+    for (size_t i = 0; ok && i < length; i += blockInput) {
+        size_t n = length - i < blockInput ? length - i : blockInput;
+        size_t written = base64EncodeBlock(data + i, n, block);
+        ok = client->write((const uint8_t*)block, written) == written;
+    }
+    ok = ok && client->print("\r\n") == 2;
+    
+    if (!ok || !client->connected()) {
+        connectionLost("⚠️ Conexión TCP perdida enviando imagen");
+        return false;
+    }
+    
+    imageAckPending = true;
+    return true;
+}
+
+String ParkingSensor::buildParkingJson(unsigned long timestamp) const {
     String jsonData = "{";
     jsonData += "\"parkingId\":" + String(parkingId) + ",";
-    jsonData += "\"occupied\":" + String(isOccupied ? "true" : "false") + ",";
+    jsonData += "\"occupied\":" + String(decision.isOccupied() ? "true" : "false") + ",";
     jsonData += "\"distance\":" + String(lastDistance, 1) + ",";
-    jsonData += "\"timestamp\":" + String(millis());
+    jsonData += "\"timestamp\":" + String(timestamp);
+    if (heartbeatInterval > 0) {
+        jsonData += ",\"seq\":" + String((unsigned long)frameSeq);
+    }
     jsonData += "}";
+    return jsonData;
+}
+
+void ParkingSensor::pollCommands() {
+    if (!tcpConnected) {
+        return;
+    }
     
-    // Enviar datos
-    tcpClient.println(jsonData);
+    if (!client->connected()) {
+        connectionLost("⚠️ Conexión TCP perdida");
+        return;
+    }
     
-    // Verificar si la conexión sigue activa
-    if (!tcpClient.connected()) {
-        tcpConnected = false;
-        Serial.println("⚠️ Conexión TCP perdida");
+    // Leer solo lo que ya está en el buffer, con un tope por ciclo,
+    // para no retrasar las mediciones
+    int budget = otaUpdater != NULL && otaUpdater->isActive() ? OTA_READ_BUDGET : CMD_READ_BUDGET;
+    while (budget > 0 && client->available() > 0) {
+        if (otaRawRemaining > 0) {
+            readOtaData(budget);
+            continue;
+        }
+        budget--;
+        int c = client->read();
+        if (c < 0) {
+            break;
+        }
+        if (commandParser.feed((char)c)) {
+            handleCommand(commandParser.frame());
+        }
+    }
+}
+
+void ParkingSensor::readOtaData(int& budget) {
+    uint8_t buffer[256];
+    size_t wanted = otaRawRemaining < sizeof(buffer) ? otaRawRemaining : sizeof(buffer);
+    if ((int)wanted > budget) {
+        wanted = (size_t)budget;
+    }
+    int n = client->read(buffer, wanted);
+    if (n <= 0) {
+        budget = 0;
+        return;
+    }
+    budget -= n;
+    otaRawRemaining -= (uint32_t)n;
+    if (otaRawAccepted) {
+        if (!otaUpdater->feedChunk(buffer, (size_t)n, hal::millis())) {
+            // Trozo rechazado: el resto de la trama se descarta y el error
+            // se avisa ya, sin seguir leyendo en esta vuelta
+            otaRawAccepted = false;
+            serviceOta();
+            budget = 0;
+        }
+    } else if (otaUpdater != NULL) {
+        otaUpdater->discard((size_t)n);
+    }
+}
+
+void ParkingSensor::serviceOta() {
+    unsigned long now = hal::millis();
+    OtaState state = otaUpdater->getState();
+    
+    if (state == OTA_DOWNLOADING && tcpConnected) {
+        uint32_t offset;
+        uint32_t length;
+        while (otaUpdater->nextRequest(offset, length, now)) {
+            char request[128];
+            snprintf(request, sizeof(request),
+                     "{\"ota\":\"get\",\"parkingId\":%d,\"id\":\"%s\",\"offset\":%lu,\"length\":%lu}",
+                     parkingId, otaUpdater->getId(), (unsigned long)offset, (unsigned long)length);
+            client->println(request);
+        }
+        return;
+    }
+    
+    // Resultado: se avisa una vez (o al reconectar si no había conexión)
+    if ((state == OTA_DONE || state == OTA_FAILED) && state != otaReported && tcpConnected) {
+        char report[160];
+        if (state == OTA_DONE) {
+            snprintf(report, sizeof(report), "{\"ota\":\"done\",\"parkingId\":%d,\"id\":\"%s\"}",
+                     parkingId, otaUpdater->getId());
+            Serial.printf("✅ Firmware actualizado (%lu bytes de parche), reiniciando...\n",
+                          (unsigned long)otaUpdater->getSize());
+            otaRestartAt = now + OTA_RESTART_DELAY_MS;
+            otaRestartPending = true;
+        } else {
+            snprintf(report, sizeof(report), "{\"ota\":\"error\",\"parkingId\":%d,\"id\":\"%s\",\"error\":\"%s\"}",
+                     parkingId, otaUpdater->getId(), otaUpdater->getFailure());
+            Serial.printf("❌ Actualización fallida: %s\n", otaUpdater->getFailure());
+        }
+        client->println(report);
+        otaReported = state;
+    }
+    
+    if (otaRestartPending && (long)(now - otaRestartAt) >= 0) {
+        otaRestartPending = false;   // En el host la simulación decide qué hacer
+        if (postmortem != NULL) {
+            postmortem->record(PM_RESTART, PM_RESTART_OTA, now);
+        }
+        hal::restart();
+    }
+}
+
+void ParkingSensor::handleCommand(const char* frame) {
+    Command command;
+    parseCommand(frame, command);
+    
+    // Trozo del parche: los bytes binarios que siguen se leen aparte
+    if (command.type == CMD_OTA_DATA && command.status == CMD_OK) {
+        otaRawRemaining = command.ota.length;
+        otaRawAccepted = otaUpdater != NULL &&
+                         otaUpdater->acceptChunk(command.ota.id, command.ota.offset, command.ota.length);
+        return;
+    }
+    
+    // Confirmación de ingesta: seq es el timestamp con el que se envió el evento
+    if (command.type == CMD_EVENT_ACK) {
+        if (ingestAckPending && command.seq == (uint32_t)lastEventTimestamp) {
+            eventAcks++;
+            lastIngestLatency = hal::micros() - lastEventSentMicros;
+            ingestAckPending = false;
+        }
+        return;
+    }
+    
+    // El servidor guardó el informe postmortem: no se vuelve a enviar
+    if (command.type == CMD_POSTMORTEM_ACK) {
+        if (postmortem != NULL && postmortem->acknowledge(command.seq)) {
+            Serial.println("🩺 Informe postmortem entregado");
+        }
+        return;
+    }
+    
+    // Respuesta a la última imagen: tiempo total de subida
+    if (command.type == CMD_IMAGE_ACK) {
+        if (imageAckPending) {
+            imageAckPending = false;
+            unsigned long uploadMs = (hal::micros() - imageSentMicros) / 1000;
+            if (imageAckHandler != NULL) {
+                imageAckHandler(imageWireBytes, uploadMs, command.status == CMD_OK);
+            }
+        }
+        return;
+    }
+    
+    Serial.printf("📥 Comando recibido: %s\n", frame);
+    
+    if (command.status != CMD_OK) {
+        Serial.printf("⚠️ Comando rechazado: %s (%s)\n",
+                     commandStatusName(command.status), command.errorKey);
+        sendAck(command.seq, command.status, command.errorKey);
+        return;
+    }
+    
+    if (command.type == CMD_PING) {
+        sendAck(command.seq, CMD_OK, "");
+        return;
+    }
+    
+    if (command.type == CMD_OTA) {
+        bool accepted = otaUpdater != NULL &&
+                        otaUpdater->offer(command.ota.id, command.ota.size, hal::millis());
+        if (accepted && otaUpdater->getState() == OTA_DOWNLOADING) {
+            otaReported = OTA_IDLE;
+        }
+        sendAck(command.seq, accepted ? CMD_OK : CMD_REJECTED, accepted ? "" : "OTA");
+        return;
+    }
+    
+    CommandStatus status = applyConfig(command.config);
+    sendAck(command.seq, status, "");
+    
+    // El cambio de servidor se aplica después de confirmar, ya que cierra la conexión
+    if (status == CMD_OK && (command.config.fields & CFG_SERVER)) {
+        setServerConfig(command.config.serverIP, command.config.serverPort);
+    }
+}
+
+CommandStatus ParkingSensor::applyConfig(const ConfigUpdate& config) {
+    // Los campos externos se aplican primero: si fallan no se toca nada del sensor
+    uint16_t externalFields = config.fields & ~(CFG_THRESHOLD | CFG_PARKING_ID | CFG_SERVER |
+                                                CFG_INTERVAL | CFG_HEARTBEAT | CFG_RAW);
+    if (externalFields != 0) {
+        if (configHandler == NULL || !configHandler(config)) {
+            Serial.println("⚠️ Configuración rechazada por el manejador externo");
+            return CMD_REJECTED;
+        }
+    }
+    
+    if (config.fields & CFG_THRESHOLD) {
+        setThresholdDistance(config.thresholdDistance);
+    }
+    if (config.fields & CFG_INTERVAL) {
+        setMeasurementInterval(config.measurementInterval);
+    }
+    if (config.fields & CFG_HEARTBEAT) {
+        setHeartbeatInterval(config.heartbeatInterval);
+    }
+    if (config.fields & CFG_RAW) {
+        setRawStream(config.rawFlushInterval);
+    }
+    if (config.fields & CFG_PARKING_ID) {
+        setParkingId(config.parkingId);
+    }
+    
+    return CMD_OK;
+}
+
+void ParkingSensor::sendAck(uint32_t seq, CommandStatus status, const char* key) {
+    if (!tcpConnected) {
+        return;
+    }
+    
+    char ack[96];
+    if (status == CMD_OK) {
+        snprintf(ack, sizeof(ack), "{\"ack\":%lu,\"parkingId\":%d,\"status\":\"ok\"}",
+                 (unsigned long)seq, parkingId);
     } else {
-        Serial.printf("📤 Datos enviados: %s\n", jsonData.c_str());
+        snprintf(ack, sizeof(ack), "{\"ack\":%lu,\"parkingId\":%d,\"status\":\"error\",\"error\":\"%s\",\"key\":\"%s\"}",
+                 (unsigned long)seq, parkingId, commandStatusName(status), key);
     }
+    
+    client->println(ack);
+    Serial.printf("📤 Confirmación enviada: %s\n", ack);
 }
 
 // Getters
 bool ParkingSensor::getIsOccupied() const {
-    return isOccupied;
+    return decision.isOccupied();
 }
 
 float ParkingSensor::getLastDistance() const {
@@ -206,40 +769,181 @@ bool ParkingSensor::isTcpConnected() const {
     return tcpConnected;
 }
 
-WiFiClient& ParkingSensor::getTcpClient() {
-    return tcpClient;
+hal::NetClient& ParkingSensor::getTransport() {
+    return *client;
 }
 
 bool ParkingSensor::hasStateChanged() const {
-    return (isOccupied != previousOccupied);
+    return decision.hasChanged();
+}
+
+float ParkingSensor::getThresholdDistance() const {
+    return decision.getThreshold();
+}
+
+unsigned long ParkingSensor::getMeasurementInterval() const {
+    return measurementInterval;
+}
+
+unsigned long ParkingSensor::getConnectAttempts() const {
+    return connectAttempts;
+}
+
+unsigned long ParkingSensor::getEventsSent() const {
+    return eventsSent;
+}
+
+unsigned long ParkingSensor::getEventAcks() const {
+    return eventAcks;
+}
+
+unsigned long ParkingSensor::getLastIngestLatency() const {
+    return lastIngestLatency;
+}
+
+bool ParkingSensor::isIngestAckPending() const {
+    return ingestAckPending;
+}
+
+bool ParkingSensor::isImageAckPending() const {
+    return imageAckPending;
+}
+
+unsigned long ParkingSensor::getHeartbeatInterval() const {
+    return heartbeatInterval;
+}
+
+unsigned long ParkingSensor::getHeartbeatsSent() const {
+    return heartbeatsSent;
+}
+
+uint32_t ParkingSensor::getFrameSeq() const {
+    return frameSeq;
+}
+
+unsigned long ParkingSensor::getVetoedTransitions() const {
+    return vetoedTransitions;
+}
+
+unsigned long ParkingSensor::getRawBlocksSent() const {
+    return rawBlocksSent;
+}
+
+unsigned long ParkingSensor::getRawBlocksLost() const {
+    return rawBlocksLost;
+}
+
+SensorHealthState ParkingSensor::getHealth() const {
+    return health.getState();
+}
+
+const SensorHealth& ParkingSensor::getHealthStats() const {
+    return health;
 }
 
 // Setters
 void ParkingSensor::setThresholdDistance(float distance) {
-    thresholdDistance = distance;
+    decision.setThreshold(distance);
     Serial.printf("Distancia umbral cambiada a: %.1f cm\n", distance);
 }
 
 void ParkingSensor::setServerConfig(const char* ip, int port) {
-    serverIP = ip;
+    strncpy(serverIP, ip, CMD_MAX_SERVER_IP - 1);
+    serverIP[CMD_MAX_SERVER_IP - 1] = '\0';
     serverPort = port;
+    client->stop();
     tcpConnected = false; // Forzar reconexión
+    lastTcpAttempt = 0;
     Serial.printf("Configuración de servidor cambiada a: %s:%d\n", ip, port);
 }
 
+void ParkingSensor::setTransport(hal::NetClient* transport) {
+    client->stop();
+    client = transport != NULL ? transport : &tcpClient;
+    tcpConnected = false; // Forzar reconexión con el nuevo transporte
+    lastTcpAttempt = 0;
+}
+
 void ParkingSensor::setParkingId(int id) {
     parkingId = id;
     Serial.printf("ID de parqueo cambiado a: %d\n", id);
 }
 
+void ParkingSensor::setMeasurementInterval(unsigned long interval) {
+    measurementInterval = interval;
+    Serial.printf("Intervalo de medición cambiado a: %lu ms\n", interval);
+}
+
+void ParkingSensor::setHeartbeatInterval(unsigned long interval) {
+    heartbeatInterval = interval;
+    lastHeartbeat = hal::millis();
+    Serial.printf("Intervalo de heartbeat cambiado a: %lu ms\n", interval);
+}
+
+void ParkingSensor::setRawStream(unsigned long flushMs) {
+    rawStream.setFlushInterval(flushMs);
+    if (flushMs > 0) {
+        Serial.printf("📈 Serie cruda activada (bloques cada %lu ms como máximo)\n", flushMs);
+    } else {
+        Serial.println("📈 Serie cruda desactivada");
+    }
+}
+
+void ParkingSensor::setConfigHandler(bool (*handler)(const ConfigUpdate& config)) {
+    configHandler = handler;
+}
+
+void ParkingSensor::setImageAckHandler(void (*handler)(size_t wireBytes, unsigned long uploadMs, bool accepted)) {
+    imageAckHandler = handler;
+}
+
+void ParkingSensor::setTransitionVerifier(bool (*verifier)(bool occupied, float distance)) {
+    transitionVerifier = verifier;
+}
+
+void ParkingSensor::setOtaUpdater(OtaUpdater* updater) {
+    otaUpdater = updater;
+}
+
+void ParkingSensor::setFrameSender(bool (*sender)(const uint8_t* frame, size_t length)) {
+    if (sender != NULL && tcpConnected) {
+        client->stop();
+        tcpConnected = false;
+    }
+    frameSender = sender;
+}
+
+void ParkingSensor::setPing(unsigned long (*ping)(unsigned long timeoutUs)) {
+    pingFunction = ping;
+}
+
+void ParkingSensor::setPostmortem(Postmortem* recorder) {
+    postmortem = recorder;
+}
+
 String ParkingSensor::getStatusString() const {
     String status = "=== ESTADO DEL SENSOR DE PARQUEO ===\n";
     status += "ID: " + String(parkingId) + "\n";
     status += "Distancia: " + String(lastDistance, 1) + " cm\n";
-    status += "Estado: " + String(isOccupied ? "OCUPADO" : "LIBRE") + "\n";
-    status += "Umbral: " + String(thresholdDistance, 1) + " cm\n";
-    status += "TCP: " + String(tcpConnected ? "Conectado" : "Desconectado") + "\n";
-    status += "Servidor: " + String(serverIP) + ":" + String(serverPort) + "\n";
+    status += "Estado: " + String(decision.isOccupied() ? "OCUPADO" : "LIBRE") + "\n";
+    status += "Umbral: " + String(decision.getThreshold(), 1) + " cm\n";
+    status += "Intervalo: " + String(measurementInterval) + " ms\n";
+    status += "Heartbeat: " + String(heartbeatInterval) + " ms\n";
+    if (rawStream.isEnabled()) {
+        status += "Serie cruda: " + String(rawStream.getFlushInterval()) + " ms, " +
+                  String(rawBlocksSent) + " bloques (" + String(rawBlocksLost) + " perdidos)\n";
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "Salud: %s (timeouts %.0f%%, inválidas %.0f%%, desvío %.1f cm)\n",
+             sensorHealthName(health.getState()), health.getTimeoutRate() * 100.0f,
+             health.getInvalidRate() * 100.0f, health.getNoise());
+    status += line;
+    if (frameSender != NULL) {
+        status += "TCP: No (modo tramas: gateway o UDP)\n";
+    } else {
+        status += "TCP: " + String(tcpConnected ? "Conectado" : "Desconectado") + "\n";
+        status += "Servidor: " + String(serverIP) + ":" + String(serverPort) + "\n";
+    }
     status += "=====================================";
     return status;
 }
@@ -248,14 +952,13 @@ void ParkingSensor::forceMeasurement() {
     float distance = measureDistance();
     if (isDistanceValid(distance)) {
         lastDistance = distance;
-        bool newOccupied = (distance < thresholdDistance);
+        hasMeasurement = true;
         
-        if (newOccupied != isOccupied) {
-            isOccupied = newOccupied;
+        if (applyDistance(distance)) {
             sendParkingData();
         }
         
         Serial.printf("Medición forzada - Distancia: %.1f cm, Estado: %s\n", 
-                     distance, isOccupied ? "OCUPADO" : "LIBRE");
+                     distance, decision.isOccupied() ? "OCUPADO" : "LIBRE");
     }
 }
@@ -1,39 +1,129 @@
 #ifndef PARKINGSENSOR_H
 #define PARKINGSENSOR_H
 
-#include <Arduino.h>
-#include <WiFi.h>
+#include "Hal.h"
+#include "HalSocket.h"
+#include "CommandChannel.h"
+#include "OccupancyDecision.h"
+#include "RawStream.h"
+#include "SensorHealth.h"
+#include "OtaUpdater.h"
+#include "Postmortem.h"
+#include "GatewayFrame.h"
+
+// Bytes máximos leídos del socket por cada llamada a update()
+#define CMD_READ_BUDGET 128
+#define OTA_READ_BUDGET (OTA_CHUNK_SIZE * 2)   // Mientras se descarga un parche
 
 class ParkingSensor {
 private:
-    // Pines del sensor ultrasónico HC-SR04
+    // Pines del sensor ultrasónico HC-SR04 y la medición con pines fijos
+    // (hal::Ultrasonic<TRIG, ECHO>::ping); NULL = estos pines con gpioWrite
     int trigPin;
     int echoPin;
+    unsigned long (*pingFunction)(unsigned long timeoutUs);
     
     // Configuración de parqueo
     int parkingId;
-    float thresholdDistance; // Distancia umbral en cm (50cm por defecto)
     
-    // Estado del parqueo
-    bool isOccupied;
-    bool previousOccupied; // Estado anterior para detectar cambios
+    // Estado del parqueo: umbral (50cm por defecto), estado actual y anterior
+    OccupancyDecision decision;
     float lastDistance;
     unsigned long lastMeasurement;
     unsigned long measurementInterval; // Intervalo entre mediciones en ms
     
     // Configuración TCP
-    const char* serverIP;
+    char serverIP[CMD_MAX_SERVER_IP];
     int serverPort;
-    WiFiClient tcpClient;
+    hal::TcpClient tcpClient;
+    hal::NetClient* client;            // tcpClient o el transporte de setTransport()
     bool tcpConnected;
     unsigned long lastTcpAttempt;
     unsigned long tcpReconnectInterval;
     
+    // Estadísticas de conexión y envío
+    unsigned long connectAttempts;
+    unsigned long eventsSent;
+    unsigned long eventAcks;           // Eventos confirmados por el servidor (EVT)
+    unsigned long lastEventTimestamp;  // timestamp del último evento enviado
+    unsigned long lastEventSentMicros;
+    unsigned long lastIngestLatency;   // µs entre envío y confirmación del último evento
+    bool ingestAckPending;
+    
+    // Subida de imágenes: duración desde el primer byte hasta la respuesta del servidor
+    unsigned long imageSentMicros;
+    size_t imageWireBytes;             // Bytes en el cable de la imagen en curso
+    bool imageAckPending;
+    
+    // Modo heartbeat: trama corta "HB" cada heartbeatInterval ms (0 = apagado).
+    // Cada trama de estado lleva un número de secuencia para que el servidor
+    // detecte pérdidas; los eventos completos solo se envían en cambios.
+    unsigned long heartbeatInterval;
+    unsigned long lastHeartbeat;
+    unsigned long heartbeatsSent;
+    uint32_t frameSeq;                 // Se incrementa aunque la trama no salga
+    unsigned long validMeasurements;   // Resumen enviado en cada heartbeat
+    unsigned long failedMeasurements;
+    bool hasMeasurement;
+    void (*imageAckHandler)(size_t wireBytes, unsigned long uploadMs, bool accepted);
+    
+    // Canal de comandos remotos
+    CommandParser commandParser;
+    bool (*configHandler)(const ConfigUpdate& config); // Cambios de cámara u otros módulos
+    
+    // Confirmación de cambios de estado por otra fuente (p. ej. la cámara)
+    bool (*transitionVerifier)(bool occupied, float distance);
+    unsigned long vetoedTransitions;
+    
+    // Actualización de firmware (opcional): bytes binarios pendientes del
+    // trozo OTAD en curso, que no pasan por el parser de líneas
+    OtaUpdater* otaUpdater;
+    uint32_t otaRawRemaining;
+    bool otaRawAccepted;
+    OtaState otaReported;              // Último resultado avisado al servidor
+    unsigned long otaRestartAt;
+    bool otaRestartPending;
+    
+    // Registro postmortem (opcional): eventos de conexión y de estado, y el
+    // informe del reinicio anterior al conectar
+    Postmortem* postmortem;
+    
+    // Modo tramas (opcional): estado y heartbeats como tramas compactas al
+    // gateway o por UDP, sin conexión TCP propia
+    bool (*frameSender)(const uint8_t* frame, size_t length);
+    uint16_t leafEpoch;                // Aleatorio por arranque (ver GatewayFrame.h)
+    
+    // Serie cruda (opcional, ver RawStream.h): cada medición en bloques
+    // "RAW <base64>" por la conexión TCP; sin conexión el bloque se pierde
+    RawStream rawStream;
+    unsigned long rawBlocksSent;
+    unsigned long rawBlocksLost;
+    
+    // Salud del sensor (ver SensorHealth.h): viaja en cada heartbeat y trama,
+    // y en modo directo se avisa con una línea JSON en cada cambio
+    SensorHealth health;
+    
     // Métodos privados
+    unsigned long ping(unsigned long timeoutUs);
     float measureDistance();
     bool connectToServer();
     void sendParkingData();
+    void sendHeartbeat();
+    void sendPostmortem();
+    void sendLeafFrame(uint8_t type);
+    void recordRaw(unsigned long now, float distance);
+    void sendRawBlock();
+    void healthChanged(SensorHealthState previous);
+    void sendHealth();
+    void connectionLost(const char* message);
     bool isDistanceValid(float distance);
+    bool applyDistance(float distance);  // decision.apply() más el verificador
+    void pollCommands();
+    void handleCommand(const char* frame);
+    CommandStatus applyConfig(const ConfigUpdate& config);
+    void sendAck(uint32_t seq, CommandStatus status, const char* key);
+    void readOtaData(int& budget);
+    void serviceOta();
     
 public:
     // Constructor
@@ -46,22 +136,94 @@ public:
     void begin();
     void update();
     
+    // Envía un JPEG como "IMAGE:<base64>" codificando por bloques, sin copiar
+    // la imagen. Retorna false si no hay conexión o el envío se cortó.
+    bool sendImage(const uint8_t* data, size_t length);
+    
     // Getters
     bool getIsOccupied() const;
     float getLastDistance() const;
     int getParkingId() const;
     bool isTcpConnected() const;
-    WiFiClient& getTcpClient();
+    hal::NetClient& getTransport();
     bool hasStateChanged() const;
+    float getThresholdDistance() const;
+    unsigned long getConnectAttempts() const;
+    unsigned long getEventsSent() const;
+    unsigned long getEventAcks() const;
+    unsigned long getLastIngestLatency() const;
+    bool isIngestAckPending() const;
+    bool isImageAckPending() const;
+    unsigned long getMeasurementInterval() const;
+    unsigned long getHeartbeatInterval() const;
+    unsigned long getHeartbeatsSent() const;
+    uint32_t getFrameSeq() const;
+    unsigned long getVetoedTransitions() const;
+    unsigned long getRawBlocksSent() const;
+    unsigned long getRawBlocksLost() const;
+    SensorHealthState getHealth() const;
+    const SensorHealth& getHealthStats() const;
     
     // Setters
     void setThresholdDistance(float distance);
     void setServerConfig(const char* ip, int port);
     void setParkingId(int id);
+    void setMeasurementInterval(unsigned long interval);
+    void setHeartbeatInterval(unsigned long interval);
+    
+    // Serie cruda: cada medición, también las fallidas, en bloques que salen
+    // al llenarse o flushMs después de su primera medición (también con
+    // CFG raw=<ms>). 0 = apagado. Solo en modo directo por TCP
+    void setRawStream(unsigned long flushMs);
+    
+    // Transporte alternativo con la interfaz de TcpClient (p. ej. hal::TlsClient);
+    // NULL vuelve a TCP plano. La conexión se mantiene abierta entre envíos.
+    void setTransport(hal::NetClient* transport);
+    
+    // Manejador para los campos que no pertenecen al sensor (p. ej. cámara).
+    // Debe retornar false si no puede aplicarlos; en ese caso no se aplica nada.
+    void setConfigHandler(bool (*handler)(const ConfigUpdate& config));
+    
+    // Se llama desde update() antes de enviar un cambio de estado (no en la
+    // primera medición) con el estado nuevo y la distancia. Si retorna false
+    // el cambio se descarta: el estado sigue siendo el anterior y no se envía
+    // ningún evento. Corre en el lazo principal: debe tener tiempo acotado.
+    void setTransitionVerifier(bool (*verifier)(bool occupied, float distance));
+    
+    // Se llama desde update() cuando el servidor responde a una imagen, con los
+    // bytes enviados y el tiempo de subida (para estimar el ancho de banda)
+    void setImageAckHandler(void (*handler)(size_t wireBytes, unsigned long uploadMs, bool accepted));
+    
+    // Habilita OTA: el hello incluye "fw" (hal::firmwareId()) y se aceptan
+    // ofertas OTA del servidor. Al terminar se avisa y se reinicia.
+    void setOtaUpdater(OtaUpdater* updater);
+    
+    // Registra conexiones, cortes y cambios de estado en el anillo postmortem
+    // y, si quedó un informe del reinicio anterior, lo envía tras el hello
+    // hasta que el servidor lo confirme (PMK)
+    void setPostmortem(Postmortem* recorder);
+    
+    // Modo tramas: los eventos y heartbeats salen como GatewayFrame por esta
+    // función (hal::LocalLink::send hacia el gateway en modo hoja, o
+    // UdpTelemetry::send directo al servidor) y no se abre la conexión TCP:
+    // sin imágenes, comandos ni OTA. Debe retornar false si la trama no
+    // salió. NULL vuelve al modo directo.
+    void setFrameSender(bool (*sender)(const uint8_t* frame, size_t length));
+    
+    // Medición con los pines fijados al compilar: hal::Ultrasonic<TRIG, ECHO>::ping
+    // (HalGpio.h), con los mismos pines pasados al constructor. Debe retornar
+    // la duración del eco en µs o 0 tras timeoutUs. NULL vuelve a gpioWrite.
+    void setPing(unsigned long (*ping)(unsigned long timeoutUs));
     
     // Métodos de utilidad
     String getStatusString() const;
     void forceMeasurement();
+    
+    // Piezas de update() expuestas para los benchmarks (src/bench)
+    String buildParkingJson(unsigned long timestamp) const;
+    size_t buildHeartbeat(char* buffer, size_t size) const;
+    GatewayFrame buildLeafFrame(uint8_t type) const;
+    static float durationToDistance(unsigned long duration);
 };
 
 #endif // PARKINGSENSOR_H
@@ -0,0 +1,157 @@
+#include "RawStream.h"
+#include "Base64.h"
+#include <string.h>
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static bool getVarint(const uint8_t* data, size_t length, size_t& offset, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && offset < length; shift += 7) {
+        uint8_t byte = data[offset++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+RawStream::RawStream() {
+    this->length = RAW_HEADER_SIZE;
+    this->count = 0;
+    this->blockSeq = 0;
+    this->firstMs = 0;
+    this->lastMs = 0;
+    this->lastInterval = 0;
+    this->lastMm = 0;
+    this->flushMs = 0;
+}
+
+void RawStream::setFlushInterval(unsigned long ms) {
+    if (ms == 0 && count > 0) {
+        drop();
+    }
+    flushMs = ms;
+}
+
+void RawStream::putVarint(uint32_t value) {
+    while (value >= 0x80) {
+        block[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    block[length++] = (uint8_t)value;
+}
+
+bool RawStream::add(uint32_t ms, float distanceCm) {
+    if (flushMs == 0) {
+        return true;
+    }
+    if (count == RAW_MAX_READINGS || length + RAW_READING_MAX_BYTES > RAW_BLOCK_BYTES) {
+        return false;
+    }
+
+    // Milímetros: la resolución del HC-SR04 ronda los 3 mm
+    int32_t mm = 0;
+    if (distanceCm >= 0) {
+        float scaled = distanceCm * 10.0f + 0.5f;
+        mm = scaled >= RAW_MAX_MM ? RAW_MAX_MM : (scaled < 1.0f ? 1 : (int32_t)scaled);
+    }
+
+    int32_t interval = 0;
+    if (count == 0) {
+        firstMs = ms;
+    } else {
+        interval = (int32_t)(ms - lastMs);
+    }
+    putVarint(zigzag(interval - lastInterval));
+    putVarint(zigzag(mm - lastMm));
+    lastMs = ms;
+    lastInterval = interval;
+    lastMm = mm;
+    count++;
+    return true;
+}
+
+bool RawStream::isDue(uint32_t now) const {
+    if (count == 0) {
+        return false;
+    }
+    return count == RAW_MAX_READINGS || length + RAW_READING_MAX_BYTES > RAW_BLOCK_BYTES ||
+           now - firstMs >= flushMs;
+}
+
+size_t RawStream::build(uint8_t* out) {
+    if (count == 0) {
+        return 0;
+    }
+    block[0] = RAW_VERSION;
+    block[1] = (uint8_t)blockSeq;
+    block[2] = (uint8_t)(blockSeq >> 8);
+    block[3] = (uint8_t)firstMs;
+    block[4] = (uint8_t)(firstMs >> 8);
+    block[5] = (uint8_t)(firstMs >> 16);
+    block[6] = (uint8_t)(firstMs >> 24);
+    block[7] = count;
+    size_t size = length;
+    memcpy(out, block, size);
+    drop();
+    return size;
+}
+
+size_t RawStream::buildLine(char* out) {
+    uint8_t data[RAW_BLOCK_BYTES];
+    size_t size = build(data);
+    if (size == 0) {
+        return 0;
+    }
+    memcpy(out, "RAW ", 4);
+    size_t n = 4 + base64EncodeBlock(data, size, out + 4);
+    out[n++] = '\r';
+    out[n++] = '\n';
+    out[n] = '\0';
+    return n;
+}
+
+void RawStream::drop() {
+    blockSeq++;
+    length = RAW_HEADER_SIZE;
+    count = 0;
+    lastInterval = 0;
+    lastMm = 0;
+}
+
+int decodeRawBlock(const uint8_t* data, size_t length, uint16_t& blockSeq,
+                   uint32_t* ms, uint16_t* mm) {
+    if (length < RAW_HEADER_SIZE || data[0] != RAW_VERSION) {
+        return -1;
+    }
+    blockSeq = (uint16_t)(data[1] | data[2] << 8);
+    uint32_t at = (uint32_t)data[3] | (uint32_t)data[4] << 8 | (uint32_t)data[5] << 16 |
+                  (uint32_t)data[6] << 24;
+    int count = data[7];
+
+    size_t offset = RAW_HEADER_SIZE;
+    int32_t interval = 0;
+    int32_t value = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t dInterval, dValue;
+        if (!getVarint(data, length, offset, dInterval) || !getVarint(data, length, offset, dValue)) {
+            return -1;
+        }
+        interval += unzigzag(dInterval);
+        value += unzigzag(dValue);
+        if (value < 0 || value > RAW_MAX_MM) {
+            return -1;
+        }
+        at += (uint32_t)interval;
+        ms[i] = at;
+        mm[i] = (uint16_t)value;
+    }
+    return offset == length ? count : -1;
+}
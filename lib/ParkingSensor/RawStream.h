@@ -0,0 +1,84 @@
+#ifndef RAWSTREAM_H
+#define RAWSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Serie cruda de distancias para diagnóstico y entrenamiento: cada medición
+// (también las fallidas) en bloques compactos que ParkingSensor envía como
+// "RAW <base64>" cuando el bloque se llena o vence su plazo. El servidor los
+// decodifica en su historial (raw_stream.py).
+//
+// Bloque, little-endian:
+//     0  versión (u8)            3  ms de la primera medición (u32)
+//     1  número de bloque (u16)  7  cantidad de mediciones (u8)
+//     8  mediciones: por cada una dos varint con zigzag
+//          - intervalo desde la anterior menos el intervalo anterior (la
+//            primera, 0: su momento es el de la cabecera)
+//          - milímetros menos los de la anterior (la primera, desde 0);
+//            0 mm = medición fallida
+//
+// Con el sensor quieto y el intervalo fijo ambas diferencias son casi cero:
+// un byte cada una. El número de bloque avanza aunque el bloque no salga
+// (sin conexión): el servidor cuenta los perdidos por el hueco.
+//
+// Sin dependencias de Arduino ni reservas de memoria.
+
+#define RAW_VERSION 1
+#define RAW_HEADER_SIZE 8
+#define RAW_BLOCK_BYTES 192             // Cabecera incluida
+#define RAW_MAX_READINGS 255
+#define RAW_READING_MAX_BYTES 10        // Dos varint de 32 bits en el peor caso
+#define RAW_MAX_MM 65535
+#define RAW_FLUSH_MIN_MS 1000
+#define RAW_FLUSH_MAX_MS 600000
+#define RAW_LINE_BYTES (4 + (RAW_BLOCK_BYTES + 2) / 3 * 4 + 3)   // "RAW " + base64 + "\r\n" + '\0'
+
+class RawStream {
+private:
+    uint8_t block[RAW_BLOCK_BYTES];
+    size_t length;                      // Bytes usados, cabecera incluida
+    uint8_t count;
+    uint16_t blockSeq;
+    uint32_t firstMs;
+    uint32_t lastMs;
+    int32_t lastInterval;
+    int32_t lastMm;
+    unsigned long flushMs;              // Plazo desde la primera medición; 0 = apagado
+
+    void putVarint(uint32_t value);
+
+public:
+    RawStream();
+
+    // 0 apaga el modo (y descarta el bloque en curso)
+    void setFlushInterval(unsigned long ms);
+    unsigned long getFlushInterval() const { return flushMs; }
+    bool isEnabled() const { return flushMs > 0; }
+
+    // Agrega una medición en cm (< 0 = fallida). Retorna false si no entra:
+    // hay que enviar el bloque (build()) y volver a agregarla
+    bool add(uint32_t ms, float distanceCm);
+
+    // Hay que enviar: lleno (la siguiente podría no entrar) o vencido el plazo
+    bool isDue(uint32_t now) const;
+    uint8_t getCount() const { return count; }
+    uint16_t getBlockSeq() const { return blockSeq; }
+
+    // Cierra el bloque en out (RAW_BLOCK_BYTES) y empieza otro; retorna sus
+    // bytes, 0 si estaba vacío
+    size_t build(uint8_t* out);
+
+    // Lo mismo como línea "RAW <base64>\r\n" (RAW_LINE_BYTES)
+    size_t buildLine(char* out);
+
+    // Descarta el bloque en curso sin enviarlo (cuenta como perdido)
+    void drop();
+};
+
+// Decodifica un bloque en ms y mm (RAW_MAX_READINGS de capacidad); retorna
+// la cantidad de mediciones o -1 si el bloque es inválido
+int decodeRawBlock(const uint8_t* data, size_t length, uint16_t& blockSeq,
+                   uint32_t* ms, uint16_t* mm);
+
+#endif // RAWSTREAM_H
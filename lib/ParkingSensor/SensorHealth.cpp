@@ -0,0 +1,121 @@
+#include "SensorHealth.h"
+#include "OccupancyDecision.h"
+#include <math.h>
+
+static inline void ewma(float& average, bool hit) {
+    average += HEALTH_ALPHA * ((hit ? 1.0f : 0.0f) - average);
+}
+
+SensorHealth::SensorHealth() {
+    reset();
+}
+
+void SensorHealth::reset() {
+    timeoutRate = 0.0f;
+    invalidRate = 0.0f;
+    nearRate = 0.0f;
+    farRate = 0.0f;
+    jumpRate = 0.0f;
+    diffSquares = 0.0f;
+    lastValid = 0.0f;
+    hasValid = false;
+    lastMm = 0;
+    stuckRun = 0;
+    readings = 0;
+    state = HEALTH_UNKNOWN;
+    candidate = HEALTH_UNKNOWN;
+    candidateCount = 0;
+}
+
+bool SensorHealth::add(float distance) {
+    bool timeout = distance < 0;
+    bool valid = OccupancyDecision::isValidDistance(distance);
+    ewma(timeoutRate, timeout);
+    ewma(invalidRate, !timeout && !valid);
+    ewma(nearRate, !timeout && distance < HEALTH_BLOCKED_CM);
+    ewma(farRate, distance > DISTANCE_MAX_CM);
+
+    if (valid) {
+        uint32_t mm = (uint32_t)(distance * 10.0f + 0.5f);
+        if (hasValid) {
+            float diff = fabsf(distance - lastValid);
+            ewma(jumpRate, diff > HEALTH_JUMP_CM);
+            if (diff > HEALTH_JUMP_CM) {
+                diff = HEALTH_JUMP_CM;
+            }
+            diffSquares += HEALTH_ALPHA * (diff * diff - diffSquares);
+            stuckRun = mm == lastMm ? stuckRun + 1 : 1;
+        } else {
+            stuckRun = 1;
+        }
+        lastValid = distance;
+        lastMm = mm;
+        hasValid = true;
+    }
+
+    if (readings < HEALTH_WARMUP_READINGS) {
+        readings++;
+        return false;
+    }
+
+    SensorHealthState next = classify();
+    if (next == state) {
+        candidateCount = 0;
+        return false;
+    }
+    if (next != candidate) {
+        candidate = next;
+        candidateCount = 0;
+    }
+    // Recién calentado no hay estado que confirmar: se toma el primero
+    if (state != HEALTH_UNKNOWN && ++candidateCount < HEALTH_CONFIRM_READINGS) {
+        return false;
+    }
+    state = next;
+    candidateCount = 0;
+    return true;
+}
+
+float SensorHealth::limit(float threshold, SensorHealthState owner) const {
+    return state == owner ? threshold * HEALTH_HYSTERESIS : threshold;
+}
+
+SensorHealthState SensorHealth::classify() const {
+    // De la falla más grave a la más leve: un sensor sin eco también tiene
+    // pocas mediciones válidas, así que no cuenta como ruidoso
+    if (timeoutRate >= limit(HEALTH_FAILING_RATE, HEALTH_FAILING)) {
+        return HEALTH_FAILING;
+    }
+    if (nearRate >= limit(HEALTH_BLOCKED_RATE, HEALTH_BLOCKED)) {
+        return HEALTH_BLOCKED;
+    }
+    if (stuckRun >= HEALTH_STUCK_READINGS) {
+        return HEALTH_STUCK;
+    }
+    if (farRate >= limit(HEALTH_FAR_RATE, HEALTH_MISALIGNED) ||
+        jumpRate >= limit(HEALTH_JUMP_RATE, HEALTH_MISALIGNED) ||
+        getNoise() >= limit(HEALTH_NOISE_CM, HEALTH_MISALIGNED)) {
+        return HEALTH_MISALIGNED;
+    }
+    if (timeoutRate + invalidRate >= limit(HEALTH_DEGRADED_RATE, HEALTH_DEGRADED)) {
+        return HEALTH_DEGRADED;
+    }
+    return HEALTH_OK;
+}
+
+float SensorHealth::getNoise() const {
+    // Diferencia entre dos mediciones independientes: varianza doble
+    return sqrtf(diffSquares / 2.0f);
+}
+
+const char* sensorHealthName(SensorHealthState state) {
+    switch (state) {
+        case HEALTH_OK: return "ok";
+        case HEALTH_DEGRADED: return "degraded";
+        case HEALTH_MISALIGNED: return "misaligned";
+        case HEALTH_BLOCKED: return "blocked";
+        case HEALTH_STUCK: return "stuck";
+        case HEALTH_FAILING: return "failing";
+        default: return "unknown";
+    }
+}
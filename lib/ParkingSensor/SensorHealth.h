@@ -0,0 +1,96 @@
+#ifndef SENSORHEALTH_H
+#define SENSORHEALTH_H
+
+#include <stdint.h>
+
+// Salud del sensor ultrasónico a partir de sus propias mediciones: tapado,
+// desalineado, sin eco o trabado en un valor. ParkingSensor::update() le pasa
+// cada medición (también las fallidas) y avisa al servidor cuando cambia el
+// estado; el servidor levanta la alerta (sensor_health.py).
+//
+// Estadísticas móviles con memoria O(1): promedios exponenciales con
+// alfa 1/32 (~30 mediciones) de
+//     - timeouts: sin eco en ninguno de los dos intentos (distancia < 0)
+//     - inválidas: fuera del rango del HC-SR04 (OccupancyDecision.h)
+//     - cercanas: menos de HEALTH_BLOCKED_CM, inválidas incluidas
+//     - lejanas: más allá del rango
+//     - saltos: diferencia con la medición válida anterior > HEALTH_JUMP_CM
+//     - ruido: desvío entre mediciones válidas seguidas, con cada diferencia
+//       recortada a HEALTH_JUMP_CM para que la llegada de un auto no lo dispare
+// y las mediciones válidas seguidas con exactamente los mismos milímetros.
+//
+// El estado nuevo tiene que repetirse HEALTH_CONFIRM_READINGS mediciones
+// para reemplazar al actual, y para salir de un estado los umbrales bajan a
+// HEALTH_HYSTERESIS: un promedio que ronda el umbral no hace oscilar el aviso.
+//
+// Sin dependencias de Arduino ni reservas de memoria.
+
+#define HEALTH_ALPHA 0.03125f               // 1/32
+#define HEALTH_WARMUP_READINGS 16           // Antes: HEALTH_UNKNOWN
+#define HEALTH_CONFIRM_READINGS 5
+#define HEALTH_HYSTERESIS 0.7f
+#define HEALTH_JUMP_CM 20.0f
+#define HEALTH_BLOCKED_CM 5.0f
+#define HEALTH_STUCK_READINGS 600           // 10 min a una medición por segundo
+
+// Umbrales de cada estado (tasas entre 0 y 1, ruido en cm)
+#define HEALTH_FAILING_RATE 0.5f            // Timeouts
+#define HEALTH_BLOCKED_RATE 0.5f            // Cercanas
+#define HEALTH_FAR_RATE 0.3f                // Lejanas
+#define HEALTH_JUMP_RATE 0.25f
+#define HEALTH_NOISE_CM 4.0f
+#define HEALTH_DEGRADED_RATE 0.1f           // Timeouts más inválidas
+
+// El código viaja en el heartbeat y en las tramas (3 bits): no reordenar
+enum SensorHealthState : uint8_t {
+    HEALTH_UNKNOWN = 0,         // Pocas mediciones todavía
+    HEALTH_OK = 1,
+    HEALTH_DEGRADED = 2,        // Mide, pero con fallas frecuentes
+    HEALTH_MISALIGNED = 3,      // Fuera de alcance, ruido o saltos: apunta mal o hay ecos cruzados
+    HEALTH_BLOCKED = 4,         // Algo tapa el transductor
+    HEALTH_STUCK = 5,           // Repite exactamente el mismo valor
+    HEALTH_FAILING = 6,         // Sin eco: desconectado o dañado
+};
+
+class SensorHealth {
+private:
+    float timeoutRate;
+    float invalidRate;
+    float nearRate;
+    float farRate;
+    float jumpRate;
+    float diffSquares;          // Promedio de la diferencia al cuadrado entre válidas
+    float lastValid;
+    bool hasValid;
+    uint32_t lastMm;
+    uint32_t stuckRun;
+    uint32_t readings;          // Satura: solo importa el calentamiento
+    SensorHealthState state;
+    SensorHealthState candidate;
+    uint8_t candidateCount;
+
+    SensorHealthState classify() const;
+    float limit(float threshold, SensorHealthState owner) const;
+
+public:
+    SensorHealth();
+
+    // Una medición en cm (< 0 = sin eco); retorna true si cambió el estado
+    bool add(float distance);
+    void reset();
+
+    SensorHealthState getState() const { return state; }
+    float getTimeoutRate() const { return timeoutRate; }
+    float getInvalidRate() const { return invalidRate; }
+    float getNearRate() const { return nearRate; }
+    float getFarRate() const { return farRate; }
+    float getJumpRate() const { return jumpRate; }
+    float getNoise() const;     // Desvío de una medición en cm
+    uint32_t getStuckRun() const { return stuckRun; }
+    uint32_t getReadings() const { return readings; }
+};
+
+// "ok", "blocked", ...: el nombre en los mensajes al servidor
+const char* sensorHealthName(SensorHealthState state);
+
+#endif // SENSORHEALTH_H
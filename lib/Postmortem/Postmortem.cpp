@@ -0,0 +1,264 @@
+#include "Postmortem.h"
+#include <string.h>
+
+static const char* RESET_NAMES[] = {
+    "unknown", "poweron", "external", "software", "panic", "watchdog", "brownout", "deepsleep",
+};
+
+static const char* EVENT_NAMES[PM_EVENT_TYPES] = {
+    "boot", "restart", "wifi_lost", "wifi_up", "tcp_up", "tcp_lost", "arrival", "departure", "slow_loop",
+};
+
+// FNV-1a de 32 bits
+static uint32_t fnv1a(const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static uint16_t eventCheck(const PostmortemEvent& event) {
+    uint32_t hash = fnv1a(&event, offsetof(PostmortemEvent, check));
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+static uint32_t headerCheck(const PostmortemRing& ring) {
+    return fnv1a(&ring, offsetof(PostmortemRing, check));
+}
+
+const char* postmortemResetName(uint8_t reason) {
+    return reason < sizeof(RESET_NAMES) / sizeof(RESET_NAMES[0]) ? RESET_NAMES[reason] : "unknown";
+}
+
+const char* postmortemEventName(uint8_t type) {
+    return type < PM_EVENT_TYPES ? EVENT_NAMES[type] : "unknown";
+}
+
+Postmortem::Postmortem(PostmortemRing& ring) : ring(ring) {
+    reportSeq = 0;
+    droppedEvents = 0;
+    salvaged = false;
+}
+
+bool Postmortem::eventValid(uint32_t seq) const {
+    const PostmortemEvent& event = ring.events[seq % PM_EVENTS];
+    return event.seq == seq && event.type < PM_EVENT_TYPES && event.check == eventCheck(event);
+}
+
+void Postmortem::seal() {
+    ring.check = headerCheck(ring);
+}
+
+bool Postmortem::begin(hal::ResetReason reason, unsigned long nowMs) {
+    bool sameLayout = ring.magic == PM_MAGIC && ring.version == PM_VERSION &&
+                      ring.size == sizeof(PostmortemRing);
+    bool warm = reason != hal::RESET_POWERON && sameLayout;
+    reportSeq = 0;
+    droppedEvents = 0;
+    salvaged = false;
+
+    if (warm && ring.check == headerCheck(ring)) {
+        // El arranque que terminó pasa a ser el anterior
+        ring.previous = ring.current;
+        ring.hasPrevious = 1;
+    } else if (warm) {
+        // Cabecera a medio escribir: se sigue desde el evento válido más nuevo
+        salvaged = true;
+        uint32_t lastSeq = 0;
+        uint8_t lastBoot = 0;
+        for (uint32_t slot = 0; slot < PM_EVENTS; slot++) {
+            const PostmortemEvent& event = ring.events[slot];
+            if (event.seq != 0 && event.seq % PM_EVENTS == slot && event.seq > lastSeq &&
+                eventValid(event.seq)) {
+                lastSeq = event.seq;
+                lastBoot = event.boot;
+            }
+        }
+        ring.bootCount = lastBoot;
+        ring.nextSeq = lastSeq + 1;
+        ring.deliveredSeq = 0;
+        ring.pendingBoots = 0;
+        ring.hasPrevious = 0;
+        memset(&ring.previous, 0, sizeof(ring.previous));
+    } else {
+        memset(&ring, 0, sizeof(ring));
+        ring.magic = PM_MAGIC;
+        ring.version = PM_VERSION;
+        ring.size = sizeof(PostmortemRing);
+        ring.nextSeq = 1;
+    }
+
+    if (warm) {
+        uint32_t first = ring.nextSeq > PM_EVENTS ? ring.nextSeq - PM_EVENTS : 1;
+        if (first < ring.deliveredSeq) {
+            first = ring.deliveredSeq;
+        }
+        for (uint32_t seq = first; seq < ring.nextSeq; seq++) {
+            if (!eventValid(seq)) {
+                droppedEvents++;
+            }
+        }
+        ring.pendingBoots++;
+    }
+
+    ring.bootCount++;
+    memset(&ring.current, 0, sizeof(ring.current));
+    ring.current.minFreeHeap = UINT32_MAX;
+    ring.current.resetReason = (uint8_t)reason;
+    record(PM_BOOT, (int32_t)reason, nowMs);
+    return warm;
+}
+
+void Postmortem::record(PostmortemEventType type, int32_t value, unsigned long nowMs) {
+    uint32_t seq = ring.nextSeq;
+    PostmortemEvent& event = ring.events[seq % PM_EVENTS];
+    event.seq = seq;
+    event.ms = (uint32_t)nowMs;
+    event.value = value;
+    event.boot = (uint8_t)ring.bootCount;
+    event.type = (uint8_t)type;
+    event.check = eventCheck(event);
+
+    // El evento queda escrito antes de que la cabecera lo cuente
+    ring.nextSeq = seq + 1;
+    ring.current.uptimeMs = (uint32_t)nowMs;
+    seal();
+}
+
+void Postmortem::sample(unsigned long nowMs, uint32_t loopMs, uint32_t freeHeap) {
+    PostmortemBoot& boot = ring.current;
+    uint16_t ms = loopMs > 0xFFFF ? 0xFFFF : (uint16_t)loopMs;
+    boot.uptimeMs = (uint32_t)nowMs;
+    boot.loops++;
+    if (freeHeap < boot.minFreeHeap) {
+        boot.minFreeHeap = freeHeap;
+    }
+    if (ms > boot.maxLoopMs) {
+        boot.maxLoopMs = ms;
+    }
+    boot.loopMs[boot.loopNext] = ms;
+    boot.loopNext = (uint8_t)((boot.loopNext + 1) % PM_LOOP_SAMPLES);
+
+    if (loopMs >= PM_SLOW_LOOP_MS) {
+        boot.slowLoops++;
+        record(PM_SLOW_LOOP, (int32_t)loopMs, nowMs);     // Sella la cabecera
+        return;
+    }
+    seal();
+}
+
+bool Postmortem::hasReport() const {
+    return ring.pendingBoots > 0;
+}
+
+// Agrega ,"clave":valor sin cadenas temporales: el informe se arma sobre un
+// único buffer reservado
+static void appendNumber(String& json, const char* key, unsigned long value) {
+    json += key;
+    json += String(value);
+}
+
+static void appendText(String& json, const char* key, const char* value) {
+    json += key;
+    json += '"';
+    json += value;
+    json += '"';
+}
+
+String Postmortem::buildReport(int parkingId) {
+    reportSeq = ring.nextSeq;
+    String json;
+    json.reserve(1600);
+    json += "{\"postmortem\":true";
+    json += ",\"parkingId\":";
+    json += String(parkingId);
+    appendNumber(json, ",\"boot\":", ring.bootCount);
+    appendText(json, ",\"reset\":", postmortemResetName(ring.current.resetReason));
+    appendNumber(json, ",\"boots\":", ring.pendingBoots);
+    appendNumber(json, ",\"seq\":", reportSeq);
+
+    if (ring.hasPrevious) {
+        const PostmortemBoot& boot = ring.previous;
+        appendText(json, ",\"previous\":{\"reset\":", postmortemResetName(boot.resetReason));
+        appendNumber(json, ",\"uptime\":", boot.uptimeMs);
+        if (boot.loops > 0) {
+            appendNumber(json, ",\"heapMin\":", boot.minFreeHeap);
+        } else {
+            json += ",\"heapMin\":null";
+        }
+        appendNumber(json, ",\"loops\":", boot.loops);
+        appendNumber(json, ",\"loopMax\":", boot.maxLoopMs);
+        appendNumber(json, ",\"slowLoops\":", boot.slowLoops);
+        json += ",\"loopMs\":[";
+        uint32_t count = boot.loops < PM_LOOP_SAMPLES ? boot.loops : PM_LOOP_SAMPLES;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t slot = (boot.loopNext + PM_LOOP_SAMPLES - count + i) % PM_LOOP_SAMPLES;
+            appendNumber(json, i > 0 ? "," : "", boot.loopMs[slot]);
+        }
+        json += "]}";
+    }
+
+    // Eventos no entregados que siguen en el anillo; los pisados antes de
+    // entregarse se cuentan como perdidos
+    uint32_t delivered = ring.deliveredSeq > 0 ? ring.deliveredSeq : 1;
+    uint32_t first = ring.nextSeq > PM_EVENTS ? ring.nextSeq - PM_EVENTS : 1;
+    if (first < delivered) {
+        first = delivered;
+    }
+    json += ",\"events\":[";
+    bool any = false;
+    for (uint32_t seq = first; seq < ring.nextSeq; seq++) {
+        if (!eventValid(seq)) {
+            continue;
+        }
+        const PostmortemEvent& event = ring.events[seq % PM_EVENTS];
+        appendNumber(json, any ? ",[" : "[", event.seq);
+        appendNumber(json, ",", event.boot);
+        appendNumber(json, ",", event.ms);
+        appendText(json, ",", postmortemEventName(event.type));
+        json += ',';
+        json += String((long)event.value);
+        json += ']';
+        any = true;
+    }
+    json += ']';
+    appendNumber(json, ",\"lost\":", first - delivered);
+    appendNumber(json, ",\"dropped\":", droppedEvents);
+    json += salvaged ? ",\"salvaged\":true}" : ",\"salvaged\":false}";
+    return json;
+}
+
+bool Postmortem::acknowledge(uint32_t seq) {
+    if (reportSeq == 0 || seq != reportSeq) {
+        return false;
+    }
+    ring.deliveredSeq = seq;
+    ring.pendingBoots = 0;
+    reportSeq = 0;
+    droppedEvents = 0;
+    salvaged = false;
+    seal();
+    return true;
+}
+
+uint32_t Postmortem::getBootCount() const {
+    return ring.bootCount;
+}
+
+uint16_t Postmortem::getPendingBoots() const {
+    return ring.pendingBoots;
+}
+
+uint16_t Postmortem::getDroppedEvents() const {
+    return droppedEvents;
+}
+
+bool Postmortem::wasSalvaged() const {
+    return salvaged;
+}
+
+const PostmortemBoot& Postmortem::getPrevious() const {
+    return ring.previous;
+}
@@ -0,0 +1,140 @@
+#ifndef POSTMORTEM_H
+#define POSTMORTEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Hal.h"
+
+// Registro de lo que pasó antes de un reinicio.
+//
+// Cuando la placa se reinicia (ESP.restart() sin Wi-Fi, brownout, watchdog,
+// pánico) el log del servidor solo muestra el timestamp volviendo a cero.
+// PostmortemRing se declara HAL_NOINIT (RAM RTC que el arranque no borra) y
+// guarda:
+//   - los últimos PM_EVENTS eventos (Wi-Fi, conexión, cambios de estado,
+//     vueltas lentas del loop, reinicios pedidos por el firmware), con un
+//     número de secuencia que sigue entre arranques
+//   - un resumen del arranque en curso, que pasa a ser el "anterior" en el
+//     siguiente: duración, mínimo de heap libre, la vuelta más lenta del loop
+//     y las últimas PM_LOOP_SAMPLES latencias
+//   - la causa de cada reinicio (hal::resetReason())
+//
+// Tras un encendido la RAM RTC trae basura: se empieza de cero. Tras un
+// reinicio en caliente la cabecera y cada evento se validan con su suma de
+// verificación; si la que falla es la de la cabecera (reinicio a mitad de
+// una escritura) se rescatan los eventos válidos.
+//
+// Cada reinicio en caliente deja un informe pendiente que ParkingSensor
+// envía al conectar ({"postmortem":true,...}, ver README_SERVER.md). El
+// servidor lo confirma con "PMK <seq>" y recién ahí se marca entregado: si
+// la placa vuelve a reiniciarse antes, los eventos siguen en el anillo y
+// entran en el informe siguiente.
+//
+// Sin dependencias de Arduino más allá de Hal.h: se prueba en el host.
+
+#define PM_MAGIC 0x504D5254UL       // "PMRT"
+#define PM_VERSION 1
+#define PM_EVENTS 32
+#define PM_LOOP_SAMPLES 16
+#define PM_SLOW_LOOP_MS 1000        // Vueltas del loop más largas también son evento
+
+enum PostmortemEventType : uint8_t {
+    PM_BOOT,            // valor: hal::ResetReason
+    PM_RESTART,         // Reinicio pedido por el firmware; valor: PostmortemRestart
+    PM_WIFI_LOST,
+    PM_WIFI_UP,         // valor: RSSI en dBm
+    PM_TCP_UP,          // valor: intentos de conexión acumulados
+    PM_TCP_LOST,
+    PM_ARRIVAL,         // valor: distancia en décimas de cm
+    PM_DEPARTURE,       // valor: distancia en décimas de cm
+    PM_SLOW_LOOP,       // valor: duración de la vuelta en ms
+    PM_EVENT_TYPES
+};
+
+enum PostmortemRestart {
+    PM_RESTART_WIFI = 1,    // Sin Wi-Fi al arrancar
+    PM_RESTART_OTA = 2,     // Firmware nuevo instalado
+};
+
+struct PostmortemEvent {
+    uint32_t seq;           // 0 = vacío
+    uint32_t ms;            // hal::millis() del arranque en que ocurrió
+    int32_t value;
+    uint8_t boot;           // Número de arranque (8 bits bajos)
+    uint8_t type;           // PostmortemEventType
+    uint16_t check;         // Suma de verificación de los 14 bytes anteriores
+};
+
+struct PostmortemBoot {
+    uint32_t uptimeMs;          // Último millis() registrado
+    uint32_t minFreeHeap;
+    uint32_t loops;             // Vueltas del loop muestreadas
+    uint16_t maxLoopMs;
+    uint16_t slowLoops;         // Vueltas de PM_SLOW_LOOP_MS o más
+    uint16_t loopMs[PM_LOOP_SAMPLES];   // Últimas latencias (circular)
+    uint8_t loopNext;
+    uint8_t resetReason;        // Causa del reinicio que inició este arranque
+    uint16_t reserved;
+};
+
+struct PostmortemRing {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;              // sizeof(PostmortemRing): otro firmware, otro formato
+    uint32_t bootCount;
+    uint32_t nextSeq;
+    uint32_t deliveredSeq;      // Los eventos con seq menor ya llegaron al servidor
+    uint16_t pendingBoots;      // Reinicios en caliente sin informe entregado
+    uint16_t hasPrevious;       // previous es válido
+    PostmortemBoot previous;
+    PostmortemBoot current;
+    uint32_t check;             // Suma de verificación de todo lo anterior
+    PostmortemEvent events[PM_EVENTS];
+};
+
+static_assert(sizeof(PostmortemEvent) == 16, "PostmortemEvent debe ocupar 16 bytes");
+static_assert(sizeof(PostmortemBoot) == 52, "PostmortemBoot no debe tener relleno");
+
+const char* postmortemResetName(uint8_t reason);
+const char* postmortemEventName(uint8_t type);
+
+class Postmortem {
+private:
+    PostmortemRing& ring;
+    uint32_t reportSeq;         // seq que confirma el último informe armado
+    uint16_t droppedEvents;     // Eventos inválidos descartados al arrancar
+    bool salvaged;              // Cabecera inválida: solo se rescataron eventos
+
+    bool eventValid(uint32_t seq) const;
+    void seal();
+
+public:
+    explicit Postmortem(PostmortemRing& ring);
+
+    // Al arrancar, antes de cualquier record(): valida el anillo según la
+    // causa del reinicio y empieza el arranque nuevo. true si se recuperó
+    // lo anterior (hay informe pendiente).
+    bool begin(hal::ResetReason reason, unsigned long nowMs);
+
+    void record(PostmortemEventType type, int32_t value, unsigned long nowMs);
+
+    // Una vez por vuelta del loop: duración de la vuelta y heap libre
+    void sample(unsigned long nowMs, uint32_t loopMs, uint32_t freeHeap);
+
+    bool hasReport() const;
+
+    // Trama JSON (una línea) con el arranque anterior y los eventos no
+    // entregados, del más viejo al más nuevo
+    String buildReport(int parkingId);
+
+    // "PMK <seq>" del servidor; false si no corresponde al último informe
+    bool acknowledge(uint32_t seq);
+
+    uint32_t getBootCount() const;
+    uint16_t getPendingBoots() const;
+    uint16_t getDroppedEvents() const;
+    bool wasSalvaged() const;
+    const PostmortemBoot& getPrevious() const;
+};
+
+#endif // POSTMORTEM_H
@@ -0,0 +1,202 @@
+#include "UdpTelemetry.h"
+
+static void put16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    put16(p, (uint16_t)value);
+    put16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+size_t encodeTelemetryAck(const TelemetryAck& ack, uint8_t* out) {
+    out[0] = TELEMETRY_ACK_MAGIC;
+    out[1] = 0;
+    put16(out + 2, ack.parkingId);
+    put16(out + 4, ack.epoch);
+    put16(out + 6, 0);
+    put32(out + 8, ack.seq);
+    put32(out + 12, ack.bitmap);
+    return TELEMETRY_ACK_SIZE;
+}
+
+bool decodeTelemetryAck(const uint8_t* data, size_t length, TelemetryAck& out) {
+    if (length != TELEMETRY_ACK_SIZE || data[0] != TELEMETRY_ACK_MAGIC) {
+        return false;
+    }
+    out.parkingId = get16(data + 2);
+    out.epoch = get16(data + 4);
+    out.seq = get32(data + 8);
+    out.bitmap = get32(data + 12);
+    return true;
+}
+
+UdpTelemetry::UdpTelemetry(const char* serverIP, int serverPort) {
+    strncpy(this->serverIP, serverIP, sizeof(this->serverIP) - 1);
+    this->serverIP[sizeof(this->serverIP) - 1] = '\0';
+    this->serverPort = serverPort;
+    this->started = false;
+    this->pendingCount = 0;
+    this->activeSince = 0;
+    this->ackHandler = NULL;
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool UdpTelemetry::begin(uint16_t localPort) {
+    started = socket.begin(localPort) == 1;
+    if (started) {
+        Serial.printf("📡 Telemetría UDP a %s:%d (ventana de %d tramas)\n", serverIP, serverPort, TELEMETRY_WINDOW);
+    } else {
+        Serial.println("❌ Error abriendo el socket UDP de telemetría");
+    }
+    return started;
+}
+
+void UdpTelemetry::end() {
+    socket.stop();
+    started = false;
+}
+
+void UdpTelemetry::update() {
+    if (!started) {
+        return;
+    }
+    pollAcks();
+    retransmit();
+}
+
+bool UdpTelemetry::send(const uint8_t* frame, size_t length) {
+    GatewayFrame decoded;
+    if (!started || !decodeGatewayFrame(frame, length, decoded)) {
+        return false;
+    }
+    if (pendingCount == TELEMETRY_WINDOW) {
+        // Lo más nuevo vale más que lo más viejo: el servidor verá el hueco
+        stats.evicted++;
+        remove(0);
+    }
+    if (pendingCount == 0) {
+        activeSince = hal::millis();
+    }
+
+    Pending& slot = pending[pendingCount++];
+    memcpy(slot.data, frame, GW_FRAME_SIZE);
+    slot.parkingId = decoded.parkingId;
+    slot.epoch = decoded.epoch;
+    slot.seq = decoded.seq;
+    slot.type = decoded.type;
+    slot.attempts = 0;
+    slot.firstSentUs = hal::micros();
+    stats.sent++;
+    transmit(slot);
+    return true;
+}
+
+bool UdpTelemetry::transmit(Pending& frame) {
+    frame.attempts++;
+    frame.lastSentMs = hal::millis();
+    stats.datagrams++;
+    if (!socket.beginPacket(serverIP, serverPort)) {
+        return false;
+    }
+    socket.write(frame.data, GW_FRAME_SIZE);
+    return socket.endPacket() == 1;
+}
+
+void UdpTelemetry::remove(uint8_t index) {
+    for (uint8_t i = index; i + 1 < pendingCount; i++) {
+        pending[i] = pending[i + 1];
+    }
+    pendingCount--;
+    if (pendingCount == 0) {
+        stats.activeMs += hal::millis() - activeSince;
+    }
+}
+
+void UdpTelemetry::pollAcks() {
+    uint8_t buffer[TELEMETRY_ACK_SIZE + 1];
+    for (int i = 0; i < TELEMETRY_READ_BUDGET; i++) {
+        int size = socket.parsePacket();
+        if (size <= 0) {
+            break;
+        }
+        int length = socket.read(buffer, sizeof(buffer));
+        TelemetryAck ack;
+        if (length <= 0 || !decodeTelemetryAck(buffer, (size_t)length, ack)) {
+            stats.invalidAcks++;
+            continue;
+        }
+        stats.acksReceived++;
+        acknowledge(ack);
+    }
+}
+
+void UdpTelemetry::acknowledge(const TelemetryAck& ack) {
+    // Confirmaciones repetidas o de tramas ya abandonadas no encuentran nada
+    unsigned long now = hal::micros();
+    uint8_t i = 0;
+    while (i < pendingCount) {
+        const Pending& frame = pending[i];
+        if (frame.parkingId != ack.parkingId || frame.epoch != ack.epoch) {
+            i++;
+            continue;
+        }
+        // Diferencia sin signo: vale también cuando el seq de 32 bits da la vuelta
+        uint32_t behind = ack.seq - frame.seq;
+        bool received = behind == 0 ||
+                        (behind <= 32 && (ack.bitmap & (1UL << (behind - 1))) != 0);
+        if (!received) {
+            i++;
+            continue;
+        }
+        stats.acked++;
+        if (ackHandler != NULL) {
+            ackHandler(frame.type, now - frame.firstSentUs);
+        }
+        remove(i);
+    }
+}
+
+void UdpTelemetry::retransmit() {
+    unsigned long now = hal::millis();
+    uint8_t i = 0;
+    while (i < pendingCount) {
+        Pending& frame = pending[i];
+        unsigned long timeout = (unsigned long)TELEMETRY_RTO_MS << (frame.attempts - 1);
+        if (now - frame.lastSentMs < timeout) {
+            i++;
+            continue;
+        }
+        if (frame.attempts >= TELEMETRY_MAX_ATTEMPTS) {
+            Serial.printf("⚠️ Trama #%lu sin confirmación tras %d envíos\n",
+                          (unsigned long)frame.seq, TELEMETRY_MAX_ATTEMPTS);
+            stats.lost++;
+            remove(i);
+            continue;
+        }
+        stats.retransmits++;
+        transmit(frame);
+        i++;
+    }
+}
+
+void UdpTelemetry::setAckHandler(void (*handler)(uint8_t type, unsigned long latencyUs)) {
+    ackHandler = handler;
+}
+
+uint8_t UdpTelemetry::getPending() const {
+    return pendingCount;
+}
+
+const TelemetryStats& UdpTelemetry::getStats() const {
+    return stats;
+}
@@ -0,0 +1,113 @@
+#ifndef UDPTELEMETRY_H
+#define UDPTELEMETRY_H
+
+#include "Hal.h"
+#include "HalUdp.h"
+#include "GatewayFrame.h"
+
+// Telemetría por UDP: eventos y heartbeats de ParkingSensor sin conexión TCP.
+//
+// Un sensor que envía unos pocos eventos por hora paga sobre todo el connect,
+// las reconexiones y mantener la conexión abierta, y es al reconectar tras un
+// corte de Wi-Fi cuando se pierden eventos. Con ParkingSensor::setFrameSender
+// apuntando a send() cada trama (GatewayFrame, 24 bytes) sale sola en un
+// datagrama al servidor (parking_server.py --udp-port), que responde por cada
+// una con una confirmación selectiva de 16 bytes:
+//
+//     0  magic 'K'            8  seq más alto recibido (u32)
+//     2  parkingId (u16)     12  mapa: bit i = recibido seq - 1 - i (u32)
+//     4  epoch (u16)
+//
+// Lo no confirmado se retransmite a los TELEMETRY_RTO_MS, el doble en cada
+// intento, hasta TELEMETRY_MAX_ATTEMPTS envíos; después se da por perdido y
+// el servidor ve el hueco en el seq. Con TELEMETRY_WINDOW tramas en vuelo la
+// más vieja se abandona para hacerle lugar a la nueva. El servidor descarta
+// las repetidas (epoch y seq, como el gateway) y las vuelve a confirmar.
+//
+// Sin comandos de vuelta: CFG, OTA e imágenes siguen requiriendo TCP.
+//
+// Sin dependencias de Arduino más allá de la HAL: se prueba en el host.
+
+#define TELEMETRY_WINDOW 16
+#define TELEMETRY_RTO_MS 300
+#define TELEMETRY_MAX_ATTEMPTS 5
+#define TELEMETRY_LOCAL_PORT 9200
+#define TELEMETRY_ACK_MAGIC 0x4B
+#define TELEMETRY_ACK_SIZE 16
+#define TELEMETRY_READ_BUDGET 8     // Confirmaciones leídas por update()
+
+struct TelemetryAck {
+    uint16_t parkingId;
+    uint16_t epoch;
+    uint32_t seq;
+    uint32_t bitmap;
+};
+
+size_t encodeTelemetryAck(const TelemetryAck& ack, uint8_t* out);
+bool decodeTelemetryAck(const uint8_t* data, size_t length, TelemetryAck& out);
+
+struct TelemetryStats {
+    uint32_t sent;              // Tramas nuevas
+    uint32_t datagrams;         // Incluye retransmisiones
+    uint32_t retransmits;
+    uint32_t acked;
+    uint32_t lost;              // Sin confirmación tras TELEMETRY_MAX_ATTEMPTS
+    uint32_t evicted;           // Abandonadas con la ventana llena
+    uint32_t acksReceived;
+    uint32_t invalidAcks;       // Datagramas que no son una confirmación
+    unsigned long activeMs;     // Tiempo con tramas sin confirmar (radio encendida)
+};
+
+class UdpTelemetry {
+private:
+    struct Pending {
+        uint8_t data[GW_FRAME_SIZE];
+        uint16_t parkingId;
+        uint16_t epoch;
+        uint32_t seq;
+        uint8_t type;
+        uint8_t attempts;
+        unsigned long firstSentUs;  // Para la latencia hasta la confirmación
+        unsigned long lastSentMs;
+    };
+
+    char serverIP[64];
+    int serverPort;
+    hal::UdpSocket socket;
+    bool started;
+
+    Pending pending[TELEMETRY_WINDOW];
+    uint8_t pendingCount;
+    unsigned long activeSince;
+    TelemetryStats stats;
+    void (*ackHandler)(uint8_t type, unsigned long latencyUs);
+
+    bool transmit(Pending& frame);
+    void remove(uint8_t index);
+    void pollAcks();
+    void retransmit();
+
+public:
+    UdpTelemetry(const char* serverIP, int serverPort);
+
+    bool begin(uint16_t localPort = TELEMETRY_LOCAL_PORT);
+    void end();
+
+    // Confirmaciones y retransmisiones: llamar en cada vuelta del loop
+    void update();
+
+    // Una trama codificada (encodeGatewayFrame); false si no es válida o no
+    // se llamó a begin(). Un datagrama que no sale se reintenta como uno perdido
+    bool send(const uint8_t* frame, size_t length);
+
+    // Aplica una confirmación recibida (update() la lee del socket)
+    void acknowledge(const TelemetryAck& ack);
+
+    // Se llama por cada trama confirmada con su tipo y los µs desde el primer envío
+    void setAckHandler(void (*handler)(uint8_t type, unsigned long latencyUs));
+
+    uint8_t getPending() const;
+    const TelemetryStats& getStats() const;
+};
+
+#endif // UDPTELEMETRY_H
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Benchmark del log de eventos: abrir el archivo por evento vs SensorLog
+
+Simula la carga de una flota: T hilos (conexiones) registran eventos de D
+dispositivos, con el mismo formato de línea que parking_server.py. Compara
+el log_sensor_data original (open/append/close por evento) con SensorLog
+(un archivo abierto, buffer, rotación y compresión en segundo plano) y
+reporta eventos por segundo y espacio en disco. Al final relee todo con
+read_lines() para comprobar que no se perdió ninguna línea.
+
+Uso:
+    python log_bench.py --events 200000 --threads 8 --devices 500 --max-mb 4
+"""
+
+import argparse
+import json
+import os
+import random
+import shutil
+import sys
+import tempfile
+import threading
+import time
+from datetime import datetime
+
+from sensor_log import SensorLog, disk_usage, list_segments, read_lines
+
+
+def legacy_log(path, data, client_address):
+    """log_sensor_data anterior a SensorLog"""
+    timestamp = datetime.now().strftime("%Y-%m-%d %H:%M:%S")
+    with open(path, 'a', encoding='utf-8') as f:
+        f.write(f"{timestamp} | {client_address} | {json.dumps(data)}\n")
+
+
+def make_events(count, devices, seed):
+    rng = random.Random(seed)
+    occupied = [False] * devices
+    events = []
+    for n in range(count):
+        device = rng.randrange(devices)
+        occupied[device] = not occupied[device]
+        distance = rng.uniform(15.0, 40.0) if occupied[device] else rng.uniform(80.0, 300.0)
+        events.append(((f"10.0.{device // 250}.{device % 250 + 1}", 40000 + device),
+                       {"parkingId": device + 1, "occupied": occupied[device],
+                        "distance": round(distance, 1), "timestamp": 1000 * n}))
+    return events
+
+
+def run(write, events, threads):
+    """Repartir los eventos entre hilos y medir el tiempo total"""
+    chunks = [events[i::threads] for i in range(threads)]
+    barrier = threading.Barrier(threads + 1)
+
+    def worker(chunk):
+        barrier.wait()
+        for address, data in chunk:
+            write(data, address)
+
+    workers = [threading.Thread(target=worker, args=(chunk,)) for chunk in chunks]
+    for w in workers:
+        w.start()
+    barrier.wait()
+    start = time.perf_counter()
+    for w in workers:
+        w.join()
+    return time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark del log de eventos del servidor")
+    parser.add_argument("--events", type=int, default=200000)
+    parser.add_argument("--threads", type=int, default=8, help="Conexiones escribiendo a la vez")
+    parser.add_argument("--devices", type=int, default=500)
+    parser.add_argument("--max-mb", type=float, default=4.0, help="Tamaño de rotación de SensorLog")
+    parser.add_argument("--codec", choices=["gzip", "zstd"], default="gzip")
+    parser.add_argument("--output", default=None, help="Guardar el resultado en JSON")
+    args = parser.parse_args()
+
+    events = make_events(args.events, args.devices, seed=1)
+    directory = tempfile.mkdtemp(prefix="log_bench_")
+    try:
+        legacy_path = os.path.join(directory, "legacy", "parking_sensor.log")
+        os.makedirs(os.path.dirname(legacy_path))
+        legacy_lock = threading.Lock()   # El servidor no bloqueaba; sin lock las líneas pueden mezclarse
+
+        def legacy_write(data, address):
+            with legacy_lock:
+                legacy_log(legacy_path, data, address)
+
+        legacy_time = run(legacy_write, events, args.threads)
+        legacy_bytes = os.path.getsize(legacy_path)
+
+        log_path = os.path.join(directory, "rotated", "parking_sensor.log")
+        log = SensorLog(log_path, max_bytes=int(args.max_mb * (1 << 20)), codec=args.codec)
+        log_time = run(lambda data, address: log.write(address, data), events, args.threads)
+        flush_start = time.perf_counter()
+        log.flush()
+        flush_time = time.perf_counter() - flush_start
+        close_start = time.perf_counter()
+        log.close()
+        compress_wait = time.perf_counter() - close_start
+        log_bytes = disk_usage(log_path)
+        segments = len(list_segments(log_path))
+
+        read_start = time.perf_counter()
+        lines = sum(1 for _ in read_lines(log_path))
+        read_time = time.perf_counter() - read_start
+    finally:
+        shutil.rmtree(directory, ignore_errors=True)
+
+    result = {
+        "events": args.events,
+        "threads": args.threads,
+        "devices": args.devices,
+        "legacy": {"events_per_s": args.events / legacy_time, "disk_bytes": legacy_bytes},
+        "sensor_log": {
+            "events_per_s": args.events / (log_time + flush_time),
+            "disk_bytes": log_bytes,
+            "segments": segments,
+            "codec": args.codec,
+            "compress_wait_s": compress_wait,
+            "read_lines_per_s": lines / read_time,
+            "lines_read": lines,
+        },
+    }
+
+    print("\n📊 LOG DE EVENTOS")
+    print("=" * 45)
+    print(f"   Eventos: {args.events} ({args.threads} hilos, {args.devices} dispositivos)")
+    print(f"   open/append por evento: {result['legacy']['events_per_s']:,.0f} ev/s, "
+          f"{legacy_bytes / 1e6:.1f} MB")
+    print(f"   SensorLog: {result['sensor_log']['events_per_s']:,.0f} ev/s, "
+          f"{log_bytes / 1e6:.1f} MB en {segments} segmentos + activo "
+          f"({log_bytes / legacy_bytes * 100:.0f}%)")
+    print(f"   Compresión pendiente al cerrar: {compress_wait:.2f} s")
+    print(f"   read_lines(): {lines} líneas, {result['sensor_log']['read_lines_per_s']:,.0f} líneas/s")
+    print("=" * 45)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(result, f, indent=2)
+        print(f"📁 Resultado guardado en {args.output}")
+    return 0 if lines == args.events else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
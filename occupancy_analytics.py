@@ -0,0 +1,478 @@
+#!/usr/bin/env python3
+"""
+Analítica de ocupación: tiempo de estadía, rotación y utilización
+
+Mantiene acumulados incrementales a medida que llegan los eventos, sin
+volver a leer el historial: por espacio, por hora y por día (hora local del
+servidor). Cada evento "ocupado" abre una sesión y el siguiente "libre" la
+cierra; la estadía es la diferencia entre las horas del servidor en que
+llegaron ambos eventos (la hora del dispositivo es millis() y vuelve a cero
+al reiniciar).
+
+Un timestamp del dispositivo que retrocede indica un reinicio. Si había una
+sesión abierta su salida se perdió: se cierra en la última vez que se supo
+del dispositivo y se cuenta como truncada. Las truncadas suman a la rotación
+y al tiempo ocupado pero no al promedio de estadía. Un auto que sigue ahí
+después del reinicio abre una sesión nueva.
+
+El tiempo ocupado de cada sesión se reparte entre las horas y días que
+abarca. La utilización de una hora es tiempo ocupado / (espacios × 3600);
+las sesiones abiertas suman hasta `now` al consultar.
+
+Consultas (OccupancyHttpServer las expone en /analytics):
+    summary()     totales, estadía promedio, rotación y utilización: O(1)
+    spot(id)      un espacio: O(1)
+    hourly()      filas por hora en un rango
+    daily()       filas por día en un rango, con rotación por espacio
+
+Uso (reconstruir desde el log, p. ej. tras instalar esta versión):
+    python occupancy_analytics.py parking_sensor.log
+    python occupancy_analytics.py parking_sensor.log --since 2025-09-01 --output parking_analytics.json
+"""
+
+import argparse
+import json
+import os
+import sys
+import threading
+import time
+
+from sensor_log import TIME_FORMAT, TIME_LENGTH, read_lines
+
+# Columnas de cada fila de hora, día y de los totales
+ARRIVALS, SESSIONS, DWELL, OCCUPIED, TRUNCATED = range(5)
+
+
+class SpotStats:
+    __slots__ = ("parking_id", "first_seen", "last_seen", "timestamp", "arrived", "arrivals",
+                 "sessions", "dwell", "dwell_min", "dwell_max", "occupied", "truncated", "restarts")
+
+    def __init__(self, parking_id, when):
+        self.parking_id = parking_id
+        self.first_seen = when
+        self.last_seen = when
+        self.timestamp = None        # Último timestamp del dispositivo (millis)
+        self.arrived = None          # Hora de llegada de la sesión abierta
+        self.arrivals = 0
+        self.sessions = 0            # Sesiones completas (llegada y salida)
+        self.dwell = 0.0
+        self.dwell_min = None
+        self.dwell_max = 0.0
+        self.occupied = 0.0          # Segundos ocupados en sesiones cerradas
+        self.truncated = 0
+        self.restarts = 0
+
+
+def local_offset():
+    """Segundos a sumar a la hora UTC para obtener la hora local (sin cambios de horario)"""
+    return time.localtime().tm_gmtoff
+
+
+def parse_time(text):
+    """Hora local 'AAAA-MM-DD[THH:MM]' o segundos desde 1970 (parámetros HTTP)"""
+    try:
+        return float(text)
+    except ValueError:
+        pass
+    text = text.replace("T", " ")
+    return time.mktime(time.strptime(text, "%Y-%m-%d %H:%M" if " " in text else "%Y-%m-%d"))
+
+
+def average(total, count):
+    return round(total / count, 1) if count else None
+
+
+class OccupancyAnalytics:
+    def __init__(self, utc_offset=None):
+        self.utc_offset = local_offset() if utc_offset is None else utc_offset
+        self.spots = {}
+        self.hours = {}              # Horas desde 1970 (hora local) → fila
+        self.days = {}               # Días desde 1970 (hora local) → fila
+        self.totals = [0, 0, 0.0, 0.0, 0]
+        self.events = 0
+        self.restarts = 0
+        # Para summary() en O(1): suma de first_seen de los espacios y de las
+        # llegadas de las sesiones abiertas
+        self.first_seen_sum = 0.0
+        self.open_count = 0
+        self.open_arrived_sum = 0.0
+        # Sesiones abiertas por hora de llegada: hora → [cantidad, suma de llegadas]
+        self.open_hours = {}
+        self.lock = threading.Lock()
+        # Filas de la última hora y el último día usados: los eventos llegan
+        # casi en orden, así que casi siempre se evita buscar en el dict
+        self.hour_key = None
+        self.hour_row = None
+        self.day_key = None
+        self.day_row = None
+
+    # ---- Escritura ----
+
+    def record(self, parking_id, occupied, when=None, timestamp=None):
+        """Registrar un evento del sensor (when = hora del servidor, timestamp = millis del dispositivo)"""
+        if when is None:
+            when = time.time()
+        with self.lock:
+            self.events += 1
+            spot = self.spots.get(parking_id)
+            if spot is None:
+                spot = self.spots[parking_id] = SpotStats(parking_id, when)
+                self.first_seen_sum += when
+            if timestamp is not None:
+                previous = spot.timestamp
+                if previous is not None and timestamp < previous:
+                    self.restart(spot)
+                spot.timestamp = timestamp
+            if occupied:
+                if spot.arrived is None:
+                    spot.arrived = when
+                    spot.arrivals += 1
+                    self.open_count += 1
+                    self.open_arrived_sum += when
+                    self.totals[ARRIVALS] += 1
+                    key = int((when + self.utc_offset) // 3600)
+                    row = self.hour_row if key == self.hour_key else self.hour_at(key)
+                    row[ARRIVALS] += 1
+                    self.add_open(key, 1, when)
+            elif spot.arrived is not None:
+                self.close(spot, when, True)
+            if when > spot.last_seen:
+                spot.last_seen = when
+
+    def seen(self, parking_id, when=None):
+        """Heartbeat u otra trama: el dispositivo seguía vivo (acota las sesiones truncadas)"""
+        when = time.time() if when is None else when
+        with self.lock:
+            spot = self.spots.get(parking_id)
+            if spot is not None and when > spot.last_seen:
+                spot.last_seen = when
+
+    def restart(self, spot):
+        """El dispositivo se reinició: la salida de la sesión abierta se perdió"""
+        spot.restarts += 1
+        self.restarts += 1
+        if spot.arrived is not None:
+            self.close(spot, spot.last_seen, False)
+
+    def close(self, spot, end, complete):
+        start = spot.arrived
+        spot.arrived = None
+        self.open_count -= 1
+        self.open_arrived_sum -= start
+        self.add_open(int((start + self.utc_offset) // 3600), -1, -start)
+        if end < start:
+            end = start
+        dwell = end - start
+        spot.occupied += dwell
+        totals = self.totals
+        totals[OCCUPIED] += dwell
+
+        # La sesión se atribuye a la hora y al día de la salida
+        offset = self.utc_offset
+        hour_key = int((end + offset) // 3600)
+        hour = self.hour_row if hour_key == self.hour_key else self.hour_at(hour_key)
+        day_key = hour_key // 24
+        day = self.day_row if day_key == self.day_key else self.day_at(day_key)
+        if complete:
+            spot.sessions += 1
+            spot.dwell += dwell
+            if dwell > spot.dwell_max:
+                spot.dwell_max = dwell
+            if spot.dwell_min is None or dwell < spot.dwell_min:
+                spot.dwell_min = dwell
+            hour[SESSIONS] += 1
+            hour[DWELL] += dwell
+            day[SESSIONS] += 1
+            day[DWELL] += dwell
+            totals[SESSIONS] += 1
+            totals[DWELL] += dwell
+        else:
+            spot.truncated += 1
+            hour[TRUNCATED] += 1
+            day[TRUNCATED] += 1
+            totals[TRUNCATED] += 1
+
+        if int((start + offset) // 3600) == hour_key:
+            # Caso común: llegada y salida en la misma hora
+            hour[OCCUPIED] += dwell
+            day[OCCUPIED] += dwell
+        else:
+            self.spread(start, end)
+
+    def spread(self, start, end):
+        """Repartir el tiempo ocupado entre las horas y días de [start, end)"""
+        offset = self.utc_offset
+        t = start
+        while t < end:
+            key = int((t + offset) // 3600)
+            stop = min(end, (key + 1) * 3600 - offset)
+            self.hour_at(key)[OCCUPIED] += stop - t
+            self.day_at(key // 24)[OCCUPIED] += stop - t
+            t = stop
+
+    def add_open(self, key, count, arrived):
+        entry = self.open_hours.get(key)
+        if entry is None:
+            entry = self.open_hours[key] = [0, 0.0]
+        entry[0] += count
+        entry[1] += arrived
+        if entry[0] == 0:
+            del self.open_hours[key]
+
+    def hour_at(self, key):
+        row = self.hours.get(key)
+        if row is None:
+            row = self.hours[key] = [0, 0, 0.0, 0.0, 0]
+        self.hour_key, self.hour_row = key, row
+        return row
+
+    def day_at(self, key):
+        row = self.days.get(key)
+        if row is None:
+            row = self.days[key] = [0, 0, 0.0, 0.0, 0]
+        self.day_key, self.day_row = key, row
+        return row
+
+    # ---- Consultas ----
+
+    def summary(self, now=None):
+        now = time.time() if now is None else now
+        with self.lock:
+            spots = len(self.spots)
+            totals = list(self.totals)
+            observed = spots * now - self.first_seen_sum
+            occupied = totals[OCCUPIED] + self.open_count * now - self.open_arrived_sum
+            open_count = self.open_count
+            result = {"events": self.events, "restarts": self.restarts}
+        days = observed / spots / 86400 if spots else 0.0
+        vehicles = totals[SESSIONS] + totals[TRUNCATED]
+        result.update({
+            "spots": spots,
+            "occupied_now": open_count,
+            "arrivals": totals[ARRIVALS],
+            "sessions": totals[SESSIONS],
+            "truncated": totals[TRUNCATED],
+            "avg_dwell_s": average(totals[DWELL], totals[SESSIONS]),
+            "turnover_per_spot_day": round(vehicles / spots / max(days, 1.0), 3) if spots else None,
+            "utilization": round(occupied / observed, 4) if observed > 0 else None,
+        })
+        return result
+
+    def spot(self, parking_id, now=None):
+        now = time.time() if now is None else now
+        with self.lock:
+            spot = self.spots.get(parking_id)
+            if spot is None:
+                return None
+            in_progress = now - spot.arrived if spot.arrived is not None else 0.0
+            observed = now - spot.first_seen
+            days = max(observed / 86400, 1.0)
+            return {
+                "parkingId": parking_id,
+                "arrivals": spot.arrivals,
+                "sessions": spot.sessions,
+                "truncated": spot.truncated,
+                "restarts": spot.restarts,
+                "avg_dwell_s": average(spot.dwell, spot.sessions),
+                "min_dwell_s": None if spot.dwell_min is None else round(spot.dwell_min, 1),
+                "max_dwell_s": round(spot.dwell_max, 1),
+                "turnover_per_day": round((spot.sessions + spot.truncated) / days, 3),
+                "utilization": round((spot.occupied + in_progress) / observed, 4) if observed > 0 else None,
+                "occupied_since": spot.arrived,
+            }
+
+    def hourly(self, since, until, now=None):
+        """Filas por hora de [since, until) (hora del servidor)"""
+        return self.rollup(self.hours, 3600, since, until, now)
+
+    def daily(self, since, until, now=None):
+        """Filas por día de [since, until); turnover = vehículos por espacio en el día"""
+        return self.rollup(self.days, 86400, since, until, now)
+
+    def rollup(self, table, width, since, until, now):
+        now = time.time() if now is None else now
+        offset = self.utc_offset
+        first = int((since + offset) // width)
+        last = int((until - 1 + offset) // width)
+        with self.lock:
+            spots = len(self.spots)
+            keys = range(first, last + 1) if last - first < len(table) else table
+            rows = {key: list(table[key]) for key in keys if first <= key <= last and key in table}
+            open_hours = sorted((key, list(entry)) for key, entry in self.open_hours.items())
+        self.add_in_progress(rows, open_hours, width, first, last, now)
+        result = []
+        for key in sorted(rows):
+            row = rows[key]
+            vehicles = row[SESSIONS] + row[TRUNCATED]
+            result.append({
+                "start": time.strftime("%Y-%m-%d %H:%M" if width < 86400 else "%Y-%m-%d",
+                                       time.gmtime(key * width)),
+                "arrivals": row[ARRIVALS],
+                "sessions": row[SESSIONS],
+                "truncated": row[TRUNCATED],
+                "avg_dwell_s": average(row[DWELL], row[SESSIONS]),
+                "turnover_per_spot": round(vehicles / spots, 3) if spots else None,
+                "utilization": round(row[OCCUPIED] / (spots * width), 4) if spots else None,
+            })
+        return result
+
+    def add_in_progress(self, rows, open_hours, width, first, last, now):
+        """Sumar a cada período el tiempo de las sesiones abiertas hasta now
+
+        Con las llegadas agrupadas por período: las que llegaron antes ocupan
+        el período entero (hasta now), las del período desde su llegada.
+        Recorre los períodos desde la llegada más antigua, no las sesiones.
+        """
+        if not open_hours:
+            return
+        offset = self.utc_offset
+        buckets = {}
+        for hour, (count, arrived) in open_hours:
+            entry = buckets.setdefault(hour * 3600 // width, [0, 0.0])
+            entry[0] += count
+            entry[1] += arrived
+        before = 0
+        for key in range(open_hours[0][0] * 3600 // width, min(last, int((now + offset) // width)) + 1):
+            start = key * width - offset
+            end = min(start + width, now)
+            count, arrived = buckets.get(key, (0, 0.0))
+            if key >= first:
+                occupied = before * (end - start) + count * end - arrived
+                if occupied > 0:
+                    rows.setdefault(key, [0, 0, 0.0, 0.0, 0])[OCCUPIED] += occupied
+            before += count
+
+    # ---- Persistencia (para no reconstruir desde el log al reiniciar el servidor) ----
+
+    def state(self):
+        """Acumulados en tipos JSON (save(), y los workers de sharded_ingest.py)"""
+        with self.lock:
+            return {
+                "utc_offset": self.utc_offset,
+                "events": self.events,
+                "restarts": self.restarts,
+                "totals": list(self.totals),
+                "hours": {key: list(row) for key, row in self.hours.items()},
+                "days": {key: list(row) for key, row in self.days.items()},
+                "spots": [[getattr(spot, name) for name in SpotStats.__slots__]
+                          for spot in self.spots.values()],
+            }
+
+    def save(self, path):
+        data = json.dumps(self.state())
+        tmp_path = path + ".tmp"
+        with open(tmp_path, "w", encoding="utf-8") as f:
+            f.write(data)
+        os.replace(tmp_path, path)
+
+    @classmethod
+    def load(cls, path):
+        with open(path, "r", encoding="utf-8") as f:
+            return cls.from_state(json.load(f))
+
+    @classmethod
+    def from_state(cls, state):
+        analytics = cls(utc_offset=state["utc_offset"])
+        analytics.events = state["events"]
+        analytics.restarts = state["restarts"]
+        analytics.totals = state["totals"]
+        analytics.hours = {int(key): row for key, row in state["hours"].items()}
+        analytics.days = {int(key): row for key, row in state["days"].items()}
+        for values in state["spots"]:
+            spot = SpotStats(None, 0.0)
+            for name, value in zip(SpotStats.__slots__, values):
+                setattr(spot, name, value)
+            analytics.spots[spot.parking_id] = spot
+            analytics.first_seen_sum += spot.first_seen
+            if spot.arrived is not None:
+                analytics.open_count += 1
+                analytics.open_arrived_sum += spot.arrived
+                analytics.add_open(int((spot.arrived + analytics.utc_offset) // 3600), 1, spot.arrived)
+        return analytics
+
+    @classmethod
+    def merged(cls, states):
+        """Un solo acumulado a partir de los de varios shards, con espacios disjuntos
+
+        Las filas por hora y día y los totales se suman columna a columna;
+        las consultas del resultado dan lo mismo que un servidor que hubiera
+        recibido todos los eventos.
+        """
+        merged = {"utc_offset": states[0]["utc_offset"] if states else local_offset(),
+                  "events": 0, "restarts": 0, "totals": [0, 0, 0.0, 0.0, 0],
+                  "hours": {}, "days": {}, "spots": []}
+        for state in states:
+            merged["events"] += state["events"]
+            merged["restarts"] += state["restarts"]
+            merged["totals"] = [a + b for a, b in zip(merged["totals"], state["totals"])]
+            for table in ("hours", "days"):
+                rows = merged[table]
+                for key, row in state[table].items():
+                    key = int(key)
+                    current = rows.get(key)
+                    rows[key] = list(row) if current is None else [a + b for a, b in zip(current, row)]
+            merged["spots"].extend(state["spots"])
+        return cls.from_state(merged)
+
+
+def log_events(path="parking_sensor.log", since=None):
+    """(hora, parkingId, ocupado, timestamp) de cada evento del log, incluidos los segmentos rotados
+
+    since: prefijo de fecha como en sensor_log.read_lines ("2025-09-05").
+    """
+    stamp, when = None, None
+    for line in read_lines(path, since=since):
+        try:
+            text = line.decode("utf-8")
+            if text[:TIME_LENGTH] != stamp:
+                # Muchas líneas comparten el segundo: se convierte una vez
+                when = time.mktime(time.strptime(text[:TIME_LENGTH], TIME_FORMAT))
+                stamp = text[:TIME_LENGTH]
+            data = json.loads(text.split(" | ", 2)[2])
+        except (UnicodeDecodeError, ValueError, IndexError):
+            continue
+        if isinstance(data, dict) and data.get("parkingId") is not None and "occupied" in data:
+            yield when, data["parkingId"], bool(data["occupied"]), data.get("timestamp")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Estadía, rotación y utilización desde parking_sensor.log")
+    parser.add_argument("log", nargs="?", default="parking_sensor.log")
+    parser.add_argument("--since", default=None, help="Desde 'AAAA-MM-DD[ HH:MM:SS]'")
+    parser.add_argument("--output", default=None, help="Guardar los acumulados (formato del servidor)")
+    args = parser.parse_args()
+
+    analytics = OccupancyAnalytics()
+    last = None
+    for when, parking_id, occupied, timestamp in log_events(args.log, args.since):
+        analytics.record(parking_id, occupied, when, timestamp)
+        last = when
+    if last is None:
+        print(f"❌ Sin eventos en {args.log}")
+        return 1
+
+    summary = analytics.summary(now=last)
+    first = min(spot.first_seen for spot in analytics.spots.values())
+    print("\n📈 ANALÍTICA DE OCUPACIÓN")
+    print("=" * 60)
+    print(f"   Eventos: {summary['events']}  Espacios: {summary['spots']}  "
+          f"Reinicios: {summary['restarts']}")
+    print(f"   Sesiones: {summary['sessions']} (+{summary['truncated']} truncadas)  "
+          f"Estadía promedio: {summary['avg_dwell_s']} s")
+    print(f"   Rotación: {summary['turnover_per_spot_day']} por espacio y día  "
+          f"Utilización: {summary['utilization']}")
+    print("-" * 60)
+    print(f"   {'Día':<12}{'Llegadas':>10}{'Sesiones':>10}{'Estadía (s)':>13}{'Rotación':>10}{'Util.':>8}")
+    for row in analytics.daily(first, last + 1, now=last):
+        print(f"   {row['start']:<12}{row['arrivals']:>10}{row['sessions']:>10}"
+              f"{str(row['avg_dwell_s']):>13}{str(row['turnover_per_spot']):>10}{str(row['utilization']):>8}")
+    print("=" * 60)
+
+    if args.output:
+        analytics.save(args.output)
+        print(f"📁 Acumulados guardados en {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+Benchmark de la tabla de ocupación en vivo y de la suscripción SSE
+
+Llena una OccupancyTable con N espacios, mide las consultas y luego publica
+cambios de ocupación a un ritmo fijo con S suscriptores conectados a
+/events, midiendo la latencia de fan-out (desde update() hasta que cada
+suscriptor recibe el cambio).
+
+Uso:
+    python occupancy_bench.py --spots 10000 --subscribers 100 --rate 200 --duration 10
+"""
+
+import argparse
+import json
+import random
+import re
+import socket
+import sys
+import threading
+import time
+
+from occupancy_state import OccupancyHttpServer, OccupancyTable
+
+EVENT_ID = re.compile(rb"id: (\d+)\nevent: spot\n")
+
+
+class Subscriber(threading.Thread):
+    """Cliente SSE mínimo: registra cuándo llega cada número de cambio"""
+
+    def __init__(self, port):
+        super().__init__(daemon=True)
+        self.socket = socket.create_connection(("127.0.0.1", port))
+        self.socket.sendall(b"GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n")
+        self.received = []          # (seq, time.perf_counter())
+        self.last_seq = 0
+        self.ready = threading.Event()
+
+    def run(self):
+        buffer = b""
+        while True:
+            try:
+                data = self.socket.recv(65536)
+            except OSError:
+                break
+            if not data:
+                break
+            now = time.perf_counter()
+            buffer += data
+            end = buffer.rfind(b"\n\n")
+            if end < 0:
+                continue
+            complete, buffer = buffer[:end + 2], buffer[end + 2:]
+            if not self.ready.is_set() and b"event: snapshot" in complete:
+                self.ready.set()
+            for match in EVENT_ID.finditer(complete):
+                seq = int(match.group(1))
+                self.received.append((seq, now))
+                self.last_seq = seq
+
+    def close(self):
+        try:
+            self.socket.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self.socket.close()
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    index = min(len(values) - 1, int(p / 100.0 * (len(values) - 1) + 0.5))
+    return values[index]
+
+
+def time_per_op(function, count):
+    start = time.perf_counter()
+    for i in range(count):
+        function(i)
+    return (time.perf_counter() - start) / count * 1e9
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark de ocupación en vivo y fan-out SSE")
+    parser.add_argument("--spots", type=int, default=10000)
+    parser.add_argument("--subscribers", type=int, default=100)
+    parser.add_argument("--rate", type=float, default=200.0, help="Cambios publicados por segundo")
+    parser.add_argument("--duration", type=float, default=10.0)
+    parser.add_argument("--output", default=None, help="Guardar el resultado en JSON")
+    args = parser.parse_args()
+
+    rng = random.Random(1)
+    table = OccupancyTable(history=max(4096, int(args.rate * 5)))
+
+    # ---- Consultas ----
+    spots = args.spots
+    update_ns = time_per_op(lambda i: table.update(i + 1, rng.random() < 0.5, 100.0, i), spots)
+    get_ns = time_per_op(lambda i: table.get(i % spots + 1), 200000)
+    counts_ns = time_per_op(lambda i: table.counts(), 200000)
+    same_ns = time_per_op(lambda i: table.update(i % spots + 1, table.get(i % spots + 1).occupied, 90.0, i), 100000)
+    start = time.perf_counter()
+    free = table.free_spots()
+    free_ms = (time.perf_counter() - start) * 1000
+
+    # ---- Fan-out ----
+    server = OccupancyHttpServer(table, "127.0.0.1", 0)
+    server.start()
+    subscribers = [Subscriber(server.port) for _ in range(args.subscribers)]
+    for subscriber in subscribers:
+        subscriber.start()
+    for subscriber in subscribers:
+        subscriber.ready.wait(10.0)
+
+    published = {}
+    interval = 1.0 / args.rate
+    total = int(args.rate * args.duration)
+    next_time = time.perf_counter()
+    for _ in range(total):
+        parking_id = rng.randint(1, spots)
+        occupied = not table.get(parking_id).occupied
+        seq = table.update(parking_id, occupied, 30.0 if occupied else 150.0)
+        published[seq] = time.perf_counter()
+        next_time += interval
+        delay = next_time - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+    last_seq = table.diffs.last_seq
+
+    deadline = time.time() + 30.0
+    while time.time() < deadline and any(s.last_seq < last_seq for s in subscribers):
+        time.sleep(0.05)
+    server.stop()
+    for subscriber in subscribers:
+        subscriber.close()
+
+    latencies = []
+    delivered = 0
+    for subscriber in subscribers:
+        for seq, received in subscriber.received:
+            if seq in published:
+                latencies.append((received - published[seq]) * 1000.0)
+                delivered += 1
+    latencies.sort()
+    expected = len(published) * len(subscribers)
+
+    result = {
+        "spots": spots,
+        "subscribers": args.subscribers,
+        "rate": args.rate,
+        "duration_s": args.duration,
+        "update_ns": round(update_ns),
+        "update_unchanged_ns": round(same_ns),
+        "get_ns": round(get_ns),
+        "counts_ns": round(counts_ns),
+        "free_spots_ms": round(free_ms, 3),
+        "published": len(published),
+        "delivered": delivered,
+        "expected": expected,
+        "fanout_ms": {"p50": round(percentile(latencies, 50), 3), "p90": round(percentile(latencies, 90), 3),
+                      "p99": round(percentile(latencies, 99), 3), "max": round(percentile(latencies, 100), 3)},
+    }
+
+    print("\n📊 OCUPACIÓN EN VIVO")
+    print("=" * 45)
+    print(f"   Espacios: {spots} ({len(free)} libres)")
+    print(f"   update(): {update_ns:.0f} ns (sin cambio: {same_ns:.0f} ns)")
+    print(f"   get(): {get_ns:.0f} ns   counts(): {counts_ns:.0f} ns   free_spots(): {free_ms:.2f} ms")
+    print(f"   Suscriptores: {args.subscribers}, {len(published)} cambios a {args.rate:.0f}/s")
+    print(f"   Entregados: {delivered}/{expected}")
+    fanout = result["fanout_ms"]
+    print(f"   Fan-out (ms): p50={fanout['p50']:.2f} p90={fanout['p90']:.2f} "
+          f"p99={fanout['p99']:.2f} max={fanout['max']:.2f}")
+    print("=" * 45)
+
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            json.dump(result, f, indent=2)
+        print(f"📁 Resultado guardado en {args.output}")
+    return 0 if delivered == expected else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
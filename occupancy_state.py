@@ -0,0 +1,400 @@
+#!/usr/bin/env python3
+"""
+Estado de ocupación en vivo del servidor de parqueo
+
+Tabla en memoria por parkingId con el último estado, distancia y momento en
+que se supo del dispositivo. Las consultas no toman locks: cada espacio es
+una tupla inmutable que se reemplaza entera al actualizarse, y los conjuntos
+de libres/ocupados/sin datos se mantienen al escribir, así que contar y
+consultar un espacio es O(1).
+
+Un espacio pasa a "stale" cuando su dispositivo se desconecta o no envía
+nada durante su tiempo límite: stale_after segundos, o el que fije
+set_timeout() (los dispositivos en modo heartbeat anuncian su intervalo).
+Los espacios se ordenan por actividad dentro de cada tiempo límite, por lo
+que expire() solo recorre los que vencieron.
+
+Las tramas con número de secuencia (eventos y heartbeats) permiten contar
+las que se perdieron: un salto suma al total de perdidas del espacio y una
+secuencia que retrocede indica que el dispositivo se reinició.
+
+Cada cambio (ocupación, stale, espacio nuevo) se publica una sola vez como
+JSON en un registro circular (DiffLog); los suscriptores leen desde su
+último número de secuencia. OccupancyHttpServer lo expone por HTTP:
+
+    GET /spots          todos los espacios y los contadores
+    GET /spots/free     parkingId de los espacios libres
+    GET /spots/<id>     un espacio
+    GET /events         Server-Sent Events con cada cambio; acepta
+                        Last-Event-ID o ?since=N para retomar sin perder
+                        cambios (si ya salieron del registro se envía
+                        un evento "snapshot" completo)
+
+Con una OccupancyAnalytics (occupancy_analytics.py) también:
+
+    GET /analytics              estadía promedio, rotación y utilización
+    GET /analytics/hourly       por hora; ?since=&until= (últimas 24 h)
+    GET /analytics/daily        por día; ?since=&until= (últimos 30 días)
+    GET /analytics/spots/<id>   un espacio
+"""
+
+import collections
+import itertools
+import json
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+from occupancy_analytics import parse_time
+
+Spot = collections.namedtuple("Spot", "parking_id occupied distance timestamp last_seen stale "
+                                       "seq lost measurements failures",
+                               defaults=(None, 0, None, None))
+
+
+def spot_dict(spot):
+    return {"parkingId": spot.parking_id, "occupied": spot.occupied, "distance": spot.distance,
+            "timestamp": spot.timestamp, "lastSeen": round(spot.last_seen, 3), "stale": spot.stale,
+            "seq": spot.seq, "lost": spot.lost}
+
+
+class DiffLog:
+    """Registro circular de cambios ya codificados, compartido por los suscriptores"""
+
+    def __init__(self, capacity=4096):
+        self.entries = collections.deque(maxlen=capacity)
+        self.last_seq = 0
+        self.cond = threading.Condition()
+
+    def append(self, payload):
+        with self.cond:
+            self.last_seq += 1
+            self.entries.append((self.last_seq, payload))
+            self.cond.notify_all()
+            return self.last_seq
+
+    def read(self, after_seq, timeout=None):
+        """Cambios posteriores a after_seq; (None, last_seq) si ya no están en el registro"""
+        with self.cond:
+            self.cond.wait_for(lambda: self.last_seq > after_seq, timeout)
+            if self.last_seq <= after_seq:
+                return [], after_seq
+            first_seq = self.entries[0][0]
+            if after_seq + 1 < first_seq:
+                return None, self.last_seq
+            start = after_seq + 1 - first_seq
+            return list(itertools.islice(self.entries, start, None)), self.last_seq
+
+    def wake_all(self):
+        with self.cond:
+            self.cond.notify_all()
+
+
+class OccupancyTable:
+    def __init__(self, stale_after=900.0, history=4096):
+        self.stale_after = stale_after
+        self.spots = {}
+        self.lock = threading.Lock()      # Solo para escrituras
+        # Tiempo límite → (parkingId → last_seen, el más antiguo primero)
+        self.activity = {stale_after: collections.OrderedDict()}
+        self.timeouts = {}                # parkingId → tiempo límite propio
+        self.active_in = {}               # parkingId → tiempo límite en que está registrado
+        self.lost_frames = 0
+        self.restarts = 0
+        self.free = set()
+        self.occupied = set()
+        self.stale = set()
+        self.diffs = DiffLog(history)
+
+    # ---- Escritura (hilos de conexión) ----
+
+    def update(self, parking_id, occupied, distance, timestamp=None, now=None,
+               seq=None, measurements=None, failures=None):
+        """Registrar un evento o heartbeat del sensor; retorna el número de cambio o 0 si no cambió nada
+
+        timestamp=None conserva el del último evento (los heartbeats no lo traen).
+        """
+        now = time.time() if now is None else now
+        occupied = bool(occupied)
+        with self.lock:
+            previous = self.spots.get(parking_id)
+            lost = 0
+            if previous is not None:
+                lost = previous.lost
+                if timestamp is None:
+                    timestamp = previous.timestamp
+                if seq is None:
+                    seq = previous.seq
+                elif previous.seq is not None:
+                    lost += self.count_gap(previous.seq, seq)
+                if measurements is None:
+                    measurements, failures = previous.measurements, previous.failures
+            spot = Spot(parking_id, occupied, distance, timestamp, now, False,
+                        seq, lost, measurements, failures)
+            self.spots[parking_id] = spot
+            self.mark_active(parking_id, now)
+            if previous is not None and previous.occupied == occupied and not previous.stale:
+                return 0
+            self.move(parking_id, previous, spot)
+            return self.publish(spot)
+
+    def touch(self, parking_id, now=None):
+        """Cualquier trama del dispositivo prueba que sigue vivo"""
+        now = time.time() if now is None else now
+        with self.lock:
+            previous = self.spots.get(parking_id)
+            if previous is None:
+                return 0  # Sin evento todavía no se conoce el estado
+            spot = previous._replace(last_seen=now, stale=False)
+            self.spots[parking_id] = spot
+            self.mark_active(parking_id, now)
+            if not previous.stale:
+                return 0
+            self.move(parking_id, previous, spot)
+            return self.publish(spot)
+
+    def count_gap(self, previous_seq, seq):
+        """Tramas perdidas entre dos secuencias (llamar con self.lock)"""
+        if seq > previous_seq + 1:
+            self.lost_frames += seq - previous_seq - 1
+            return seq - previous_seq - 1
+        if seq <= previous_seq:
+            self.restarts += 1  # La secuencia volvió a empezar: el dispositivo se reinició
+        return 0
+
+    def set_timeout(self, parking_id, seconds):
+        """Tiempo sin noticias tras el cual el espacio pasa a stale (None = stale_after)"""
+        with self.lock:
+            if seconds is None:
+                self.timeouts.pop(parking_id, None)
+            else:
+                self.timeouts[parking_id] = seconds
+            last_seen = self.unmark_active(parking_id)
+            if last_seen is not None:
+                self.mark_active(parking_id, last_seen)
+
+    def mark_stale(self, parking_id):
+        """Dispositivo desconectado: su último estado deja de ser confiable"""
+        with self.lock:
+            return self.set_stale(parking_id)
+
+    def expire(self, now=None):
+        """Marcar como stale los espacios sin noticias; retorna cuántos se marcaron"""
+        now = time.time() if now is None else now
+        expired = 0
+        with self.lock:
+            for timeout, activity in self.activity.items():
+                limit = now - timeout
+                while activity:
+                    parking_id, last_seen = next(iter(activity.items()))
+                    if last_seen > limit:
+                        break
+                    activity.popitem(last=False)
+                    del self.active_in[parking_id]
+                    if self.set_stale(parking_id):
+                        expired += 1
+        return expired
+
+    def mark_active(self, parking_id, now):
+        timeout = self.timeouts.get(parking_id, self.stale_after)
+        if self.active_in.get(parking_id, timeout) != timeout:
+            self.unmark_active(parking_id)
+        activity = self.activity.get(timeout)
+        if activity is None:
+            activity = self.activity[timeout] = collections.OrderedDict()
+        activity[parking_id] = now
+        activity.move_to_end(parking_id)
+        self.active_in[parking_id] = timeout
+
+    def unmark_active(self, parking_id):
+        timeout = self.active_in.pop(parking_id, None)
+        if timeout is None:
+            return None
+        return self.activity[timeout].pop(parking_id, None)
+
+    def set_stale(self, parking_id):
+        previous = self.spots.get(parking_id)
+        if previous is None or previous.stale:
+            return 0
+        spot = previous._replace(stale=True)
+        self.spots[parking_id] = spot
+        self.unmark_active(parking_id)
+        self.move(parking_id, previous, spot)
+        return self.publish(spot)
+
+    def move(self, parking_id, previous, spot):
+        if previous is not None:
+            self.bucket(previous).discard(parking_id)
+        self.bucket(spot).add(parking_id)
+
+    def bucket(self, spot):
+        if spot.stale:
+            return self.stale
+        return self.occupied if spot.occupied else self.free
+
+    def publish(self, spot):
+        # Se codifica una sola vez para todos los suscriptores
+        return self.diffs.append(json.dumps(spot_dict(spot)).encode("utf-8"))
+
+    # ---- Consultas (sin lock) ----
+
+    def get(self, parking_id):
+        return self.spots.get(parking_id)
+
+    def counts(self):
+        return {"total": len(self.spots), "free": len(self.free),
+                "occupied": len(self.occupied), "stale": len(self.stale)}
+
+    def liveness(self):
+        return {"lost_frames": self.lost_frames, "restarts": self.restarts,
+                "custom_timeouts": len(self.timeouts)}
+
+    def free_spots(self):
+        with self.lock:
+            return sorted(self.free)
+
+    def snapshot(self):
+        """(secuencia, espacios) coherentes entre sí, para retomar con DiffLog.read()"""
+        with self.lock:
+            spots = list(self.spots.values())
+            seq = self.diffs.last_seq
+        return seq, [spot_dict(spot) for spot in spots]
+
+
+class OccupancyHttpServer:
+    """Consultas y suscripción SSE sobre una OccupancyTable"""
+
+    def __init__(self, table, host="0.0.0.0", port=8081, keepalive=15.0, analytics=None):
+        self.table = table
+        self.analytics = analytics
+        self.keepalive = keepalive
+        self.running = False
+        handler = type("Handler", (OccupancyRequestHandler,), {"owner": self})
+        self.httpd = ThreadingHTTPServer((host, port), handler)
+        self.httpd.daemon_threads = True
+        self.port = self.httpd.server_address[1]
+        self.thread = None
+
+    def start(self):
+        self.running = True
+        self.thread = threading.Thread(target=self.httpd.serve_forever, daemon=True)
+        self.thread.start()
+
+    def stop(self):
+        if not self.running:
+            return
+        self.running = False
+        self.table.diffs.wake_all()
+        self.httpd.shutdown()
+        self.httpd.server_close()
+
+
+class OccupancyRequestHandler(BaseHTTPRequestHandler):
+    owner = None
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format, *args):
+        pass  # Sin una línea por petición en la consola del servidor
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        table = self.owner.table
+        if url.path == "/spots":
+            seq, spots = table.snapshot()
+            self.send_json({"seq": seq, "counts": table.counts(), "spots": spots})
+        elif url.path == "/spots/free":
+            self.send_json({"free": table.free_spots()})
+        elif url.path.startswith("/spots/"):
+            try:
+                spot = table.get(int(url.path[len("/spots/"):]))
+            except ValueError:
+                spot = None
+            if spot is None:
+                self.send_json({"status": "not_found"}, 404)
+            else:
+                self.send_json(spot_dict(spot))
+        elif url.path.startswith("/analytics") and self.owner.analytics is not None:
+            self.send_analytics(url)
+        elif url.path == "/events":
+            since = self.headers.get("Last-Event-ID") or parse_qs(url.query).get("since", [None])[0]
+            self.stream_events(int(since) if since and since.isdigit() else None)
+        else:
+            self.send_json({"status": "not_found"}, 404)
+
+    def send_analytics(self, url):
+        analytics = self.owner.analytics
+        query = parse_qs(url.query)
+        now = time.time()
+        if url.path == "/analytics":
+            self.send_json(analytics.summary(now))
+            return
+        if url.path.startswith("/analytics/spots/"):
+            try:
+                spot = analytics.spot(int(url.path[len("/analytics/spots/"):]), now)
+            except ValueError:
+                spot = None
+            if spot is None:
+                self.send_json({"status": "not_found"}, 404)
+            else:
+                self.send_json(spot)
+            return
+        periods = {"/analytics/hourly": (analytics.hourly, 24 * 3600),
+                   "/analytics/daily": (analytics.daily, 30 * 86400)}
+        if url.path not in periods:
+            self.send_json({"status": "not_found"}, 404)
+            return
+        rollup, default_span = periods[url.path]
+        try:
+            until = parse_time(query["until"][0]) if "until" in query else now
+            since = parse_time(query["since"][0]) if "since" in query else until - default_span
+        except ValueError:
+            self.send_json({"status": "error", "message": "since/until: AAAA-MM-DD[THH:MM] o segundos"}, 400)
+            return
+        self.send_json({"rows": rollup(since, until, now)})
+
+    def send_json(self, data, code=200):
+        body = json.dumps(data).encode("utf-8")
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def stream_events(self, since):
+        self.send_response(200)
+        self.send_header("Content-Type", "text/event-stream")
+        self.send_header("Cache-Control", "no-cache")
+        self.send_header("Connection", "close")
+        self.end_headers()
+        self.close_connection = True
+
+        table = self.owner.table
+        try:
+            seq = self.send_snapshot() if since is None else since
+            while self.owner.running:
+                entries, last_seq = table.diffs.read(seq, self.owner.keepalive)
+                if entries is None:
+                    # El suscriptor se atrasó más que el registro: estado completo
+                    seq = self.send_snapshot()
+                    continue
+                if not entries:
+                    self.wfile.write(b": keepalive\n\n")
+                    self.wfile.flush()
+                    continue
+                # Todos los cambios pendientes en una sola escritura
+                chunks = []
+                for entry_seq, payload in entries:
+                    chunks.append(b"id: %d\nevent: spot\ndata: %s\n\n" % (entry_seq, payload))
+                self.wfile.write(b"".join(chunks))
+                self.wfile.flush()
+                seq = last_seq
+        except (BrokenPipeError, ConnectionResetError):
+            pass
+
+    def send_snapshot(self):
+        seq, spots = self.owner.table.snapshot()
+        payload = json.dumps({"spots": spots, "counts": self.owner.table.counts()}).encode("utf-8")
+        self.wfile.write(b"id: %d\nevent: snapshot\ndata: %s\n\n" % (seq, payload))
+        self.wfile.flush()
+        return seq
@@ -0,0 +1,416 @@
+#!/usr/bin/env python3
+"""
+Parches delta de firmware para la actualización OTA (ver lib/OtaUpdate)
+
+El ESP32 aplica el parche en streaming contra la imagen que está corriendo,
+así que por WiFi solo viaja lo que cambió entre dos compilaciones.
+
+Formato "PKDL" (ver DeltaPatch.h):
+    cabecera de 24 bytes: "PKDL", versión, flags, reservado,
+        tamaño y CRC-32 de la imagen anterior, tamaño y CRC-32 de la nueva
+    'A' desplazamiento (varint zigzag relativo al final del 'A' anterior),
+        longitud, y pares iguales/distintos con los bytes de diferencia
+        (nuevo - anterior, módulo 256): código movido o con direcciones
+        corridas deja diferencias pequeñas y repetidas
+    'I' longitud y bytes literales
+
+make_patch() busca bloques de la imagen anterior con un índice de hash y
+los extiende tolerando bytes distintos (como bsdiff, sin ordenar sufijos).
+Sin imagen anterior el parche es la imagen completa.
+
+FirmwareRepository sirve los parches desde un directorio:
+    firmware/<firmware_id>.bin                imágenes conocidas
+    firmware/deltas/<desde>-<hasta>.pkdl      parches generados (caché)
+    firmware/deltas/full-<hasta>.pkdl         imagen completa empaquetada
+
+Uso:
+    python ota_delta.py make anterior.bin nueva.bin parche.pkdl
+    python ota_delta.py apply anterior.bin parche.pkdl salida.bin
+    python ota_delta.py info .pio/build/esp32-s3-devkitc-1/firmware.bin
+"""
+
+import argparse
+import hashlib
+import os
+import re
+import shutil
+import struct
+import sys
+import threading
+import zlib
+
+MAGIC = b"PKDL"
+VERSION = 1
+HEADER = struct.Struct("<4sBBHIIII")
+
+BLOCK = 16              # Longitud de la clave del índice
+STRIDE = 4              # Solo se indexan posiciones alineadas de la imagen anterior
+MIN_MATCH = 24          # Coincidencias más cortas salen más baratas como literales
+MAX_CANDIDATES = 8
+MISMATCH_LIMIT = 32     # Bytes sin mejorar antes de cortar una extensión
+
+# Descriptor de la aplicación en una imagen de ESP-IDF: cabecera de imagen
+# (24 bytes) + cabecera del primer segmento (8) + esp_app_desc_t
+APP_DESC_OFFSET = 32
+APP_DESC_MAGIC = 0xABCD5432
+APP_ELF_SHA_OFFSET = APP_DESC_OFFSET + 144
+
+PATCH_ID = re.compile(r"^[A-Za-z0-9._-]{1,47}$")
+
+
+class PatchError(ValueError):
+    pass
+
+
+def firmware_id(image):
+    """Identificador que reporta el firmware en el hello (hal::firmwareId())
+
+    Los primeros 8 bytes del SHA-256 del ELF guardado en esp_app_desc_t, en
+    hex. Para archivos que no son imágenes de ESP-IDF, el SHA-256 del archivo.
+    """
+    if len(image) >= APP_ELF_SHA_OFFSET + 32 and image[0] == 0xE9:
+        magic = struct.unpack_from("<I", image, APP_DESC_OFFSET)[0]
+        if magic == APP_DESC_MAGIC:
+            return image[APP_ELF_SHA_OFFSET:APP_ELF_SHA_OFFSET + 8].hex()
+    return hashlib.sha256(image).hexdigest()[:16]
+
+
+# ---- Varints ----
+
+def put_varint(out, value):
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def zigzag(value):
+    return value * 2 if value >= 0 else -value * 2 - 1
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data) or shift > 35:
+            raise PatchError("varint truncado")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+# ---- Generación ----
+
+def common_prefix(a, ai, b, bi, limit):
+    """Bytes iguales desde a[ai] y b[bi], comparando por bloques"""
+    length = 0
+    for step in (1024, 64, 8, 1):
+        while length + step <= limit and a[ai + length:ai + length + step] == b[bi + length:bi + length + step]:
+            length += step
+    return length
+
+
+def extend_match(old, o, new, n):
+    """Largo de la coincidencia aproximada old[o:] ~ new[n:]
+
+    Maximiza 2·iguales - largo (como bsdiff): los bytes distintos aislados
+    entran en la operación y cuestan un byte de diferencia cada uno.
+    """
+    limit = min(len(old) - o, len(new) - n)
+    length = matches = best_score = best_length = 0
+    while length < limit:
+        if old[o + length] == new[n + length]:
+            run = common_prefix(old, o + length, new, n + length, limit - length)
+            length += run
+            matches += run
+        else:
+            length += 1
+        score = 2 * matches - length
+        if score > best_score:
+            best_score, best_length = score, length
+        elif length - best_length > MISMATCH_LIMIT:
+            break
+    return best_length
+
+
+def build_index(old):
+    index = {}
+    for position in range(0, len(old) - BLOCK + 1, STRIDE):
+        bucket = index.setdefault(old[position:position + BLOCK], [])
+        if len(bucket) < MAX_CANDIDATES:
+            bucket.append(position)
+    return index
+
+
+def encode_add(out, old, o, new, n, length, previous_end):
+    out.append(ord("A"))
+    put_varint(out, zigzag(o - previous_end))
+    put_varint(out, length)
+    k = 0
+    while k < length:
+        equal = common_prefix(old, o + k, new, n + k, length - k)
+        put_varint(out, equal)
+        k += equal
+        if k == length:
+            break
+        # Los tramos iguales cortos quedan dentro de los distintos: un byte
+        # de diferencia 0 es más barato que cerrar el par y abrir otro
+        start = k
+        while k < length:
+            if old[o + k] == new[n + k] and old[o + k:o + k + 3] == new[n + k:n + k + 3] and k + 3 <= length:
+                break
+            k += 1
+        put_varint(out, k - start)
+        out.extend((new[n + j] - old[o + j]) & 0xFF for j in range(start, k))
+
+
+def encode_insert(out, data):
+    if data:
+        out.append(ord("I"))
+        put_varint(out, len(data))
+        out.extend(data)
+
+
+def make_patch(old, new):
+    """Parche que transforma old en new (old vacío o None: imagen completa)"""
+    old = bytes(old or b"")
+    new = bytes(new)
+    if not new:
+        raise PatchError("imagen nueva vacía")
+    out = bytearray(HEADER.pack(MAGIC, VERSION, 0, 0, len(old), zlib.crc32(old),
+                                len(new), zlib.crc32(new)))
+    if not old:
+        encode_insert(out, new)
+        return bytes(out)
+
+    index = build_index(old)
+    literal_start = 0       # Inicio de los bytes nuevos todavía sin cubrir
+    old_end = 0             # Fin del último 'A' en la imagen anterior
+    i = 0
+    while i + BLOCK <= len(new):
+        # Primero la continuación natural del último 'A' (código corrido)
+        expected = old_end + (i - literal_start)
+        candidates = index.get(new[i:i + BLOCK], ())
+        if expected + BLOCK <= len(old) and old[expected:expected + BLOCK] == new[i:i + BLOCK]:
+            candidates = [expected] + list(candidates)
+        best_length, best_old = 0, 0
+        for candidate in candidates[:MAX_CANDIDATES]:
+            length = extend_match(old, candidate, new, i)
+            if length > best_length:
+                best_length, best_old = length, candidate
+        if best_length < MIN_MATCH:
+            i += 1
+            continue
+
+        # Hacia atrás, solo bytes idénticos, dentro de lo que iba a ser literal
+        o, n = best_old, i
+        while n > literal_start and o > 0 and old[o - 1] == new[n - 1]:
+            o -= 1
+            n -= 1
+        encode_insert(out, new[literal_start:n])
+        length = best_length + (i - n)
+        encode_add(out, old, o, new, n, length, old_end)
+        old_end = o + length
+        i = literal_start = n + length
+    encode_insert(out, new[literal_start:])
+    return bytes(out)
+
+
+# ---- Aplicación (referencia del DeltaPatcher del firmware) ----
+
+def parse_header(patch):
+    if len(patch) < HEADER.size:
+        raise PatchError("cabecera truncada")
+    magic, version, _flags, _reserved, old_size, old_crc, new_size, new_crc = HEADER.unpack_from(patch)
+    if magic != MAGIC or version != VERSION or new_size == 0:
+        raise PatchError("cabecera inválida")
+    return {"old_size": old_size, "old_crc": old_crc, "new_size": new_size, "new_crc": new_crc}
+
+
+def apply_patch(old, patch):
+    header = parse_header(patch)
+    old = bytes(old or b"")[:header["old_size"]]
+    if header["old_size"] and (len(old) != header["old_size"] or zlib.crc32(old) != header["old_crc"]):
+        raise PatchError("la imagen anterior no es la base del parche")
+    out = bytearray()
+    pos = HEADER.size
+    old_pos = 0
+    while len(out) < header["new_size"]:
+        if pos >= len(patch):
+            raise PatchError("parche truncado")
+        op = patch[pos]
+        pos += 1
+        if op == ord("I"):
+            length, pos = read_varint(patch, pos)
+            if length == 0 or length > header["new_size"] - len(out) or pos + length > len(patch):
+                raise PatchError("literal fuera de rango")
+            out += patch[pos:pos + length]
+            pos += length
+        elif op == ord("A"):
+            delta, pos = read_varint(patch, pos)
+            old_pos += (delta >> 1) ^ -(delta & 1)
+            length, pos = read_varint(patch, pos)
+            if (old_pos < 0 or length == 0 or old_pos + length > len(old) or
+                    length > header["new_size"] - len(out)):
+                raise PatchError("copia fuera de rango")
+            end = old_pos + length
+            while True:
+                equal, pos = read_varint(patch, pos)
+                if old_pos + equal > end:
+                    raise PatchError("tramo igual fuera de rango")
+                out += old[old_pos:old_pos + equal]
+                old_pos += equal
+                if old_pos == end:
+                    break
+                diff, pos = read_varint(patch, pos)
+                if diff == 0 or old_pos + diff > end or pos + diff > len(patch):
+                    raise PatchError("tramo distinto fuera de rango")
+                out += bytes((old[old_pos + j] + patch[pos + j]) & 0xFF for j in range(diff))
+                old_pos += diff
+                pos += diff
+        else:
+            raise PatchError(f"operación desconocida: {op!r}")
+    if pos != len(patch):
+        raise PatchError("bytes de más al final del parche")
+    if zlib.crc32(out) != header["new_crc"]:
+        raise PatchError("CRC de la imagen nueva incorrecto")
+    return bytes(out)
+
+
+# ---- Repositorio del servidor ----
+
+class FirmwareRepository:
+    """Imágenes y parches servidos a los dispositivos; seguro entre hilos"""
+
+    def __init__(self, directory="firmware"):
+        self.directory = os.path.abspath(directory)
+        self.deltas_dir = os.path.join(self.directory, "deltas")
+        self.lock = threading.Lock()
+        self.patches = {}       # patch_id → bytes (los parches son chicos)
+
+    def image_path(self, fw_id):
+        return os.path.join(self.directory, f"{fw_id}.bin")
+
+    def add_image(self, path):
+        """Registrar una imagen (copia en el directorio); retorna su firmware_id"""
+        with open(path, "rb") as f:
+            image = f.read()
+        fw_id = firmware_id(image)
+        target = self.image_path(fw_id)
+        if not os.path.exists(target):
+            os.makedirs(self.directory, exist_ok=True)
+            shutil.copyfile(path, target + ".tmp")
+            os.replace(target + ".tmp", target)
+        return fw_id
+
+    def has_image(self, fw_id):
+        return bool(fw_id) and PATCH_ID.match(fw_id) is not None and os.path.exists(self.image_path(fw_id))
+
+    def prepare(self, from_id, to_id):
+        """Parche para pasar de from_id a to_id: (patch_id, tamaño)
+
+        Sin la imagen de origen (o si el delta no ahorra nada) se ofrece la
+        imagen completa. El parche se genera una vez y queda en deltas/.
+        """
+        if not self.has_image(to_id):
+            raise FileNotFoundError(f"imagen desconocida: {to_id}")
+        with self.lock:
+            full_id = f"full-{to_id}"
+            patch_id = f"{from_id}-{to_id}" if self.has_image(from_id) else full_id
+            patch = self._load(patch_id)
+            if patch is None:
+                with open(self.image_path(to_id), "rb") as f:
+                    new = f.read()
+                old = None
+                if patch_id != full_id:
+                    with open(self.image_path(from_id), "rb") as f:
+                        old = f.read()
+                patch = make_patch(old, new)
+                if old is not None and len(patch) >= len(new) + HEADER.size:
+                    patch_id, patch = full_id, make_patch(None, new)
+                self._store(patch_id, patch)
+            return patch_id, len(patch)
+
+    def _load(self, patch_id):
+        patch = self.patches.get(patch_id)
+        if patch is None:
+            path = os.path.join(self.deltas_dir, f"{patch_id}.pkdl")
+            if os.path.exists(path):
+                with open(path, "rb") as f:
+                    patch = f.read()
+                self.patches[patch_id] = patch
+        return patch
+
+    def _store(self, patch_id, patch):
+        os.makedirs(self.deltas_dir, exist_ok=True)
+        path = os.path.join(self.deltas_dir, f"{patch_id}.pkdl")
+        with open(path + ".tmp", "wb") as f:
+            f.write(patch)
+        os.replace(path + ".tmp", path)
+        self.patches[patch_id] = patch
+
+    def read_chunk(self, patch_id, offset, length):
+        """Trozo de un parche ya preparado; b"" si el id u offset no son válidos"""
+        if not isinstance(patch_id, str) or not PATCH_ID.match(patch_id):
+            return b""
+        with self.lock:
+            patch = self._load(patch_id)
+        if patch is None or offset < 0 or length <= 0:
+            return b""
+        return patch[offset:offset + length]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Parches delta de firmware (OTA)")
+    commands = parser.add_subparsers(dest="command", required=True)
+    make = commands.add_parser("make", help="Generar un parche")
+    make.add_argument("old", help="Imagen anterior ('-' para imagen completa)")
+    make.add_argument("new")
+    make.add_argument("output")
+    apply = commands.add_parser("apply", help="Aplicar un parche (verificación)")
+    apply.add_argument("old")
+    apply.add_argument("patch")
+    apply.add_argument("output")
+    info = commands.add_parser("info", help="firmware_id de una imagen o cabecera de un parche")
+    info.add_argument("path")
+    args = parser.parse_args()
+
+    if args.command == "make":
+        old = b""
+        if args.old != "-":
+            with open(args.old, "rb") as f:
+                old = f.read()
+        with open(args.new, "rb") as f:
+            new = f.read()
+        patch = make_patch(old, new)
+        with open(args.output, "wb") as f:
+            f.write(patch)
+        print(f"📦 {args.output}: {len(patch)} bytes ({100.0 * len(patch) / len(new):.1f}% de la imagen, "
+              f"{firmware_id(old) if old else '-'} → {firmware_id(new)})")
+    elif args.command == "apply":
+        with open(args.old, "rb") as f:
+            old = f.read()
+        with open(args.patch, "rb") as f:
+            patch = f.read()
+        try:
+            new = apply_patch(old, patch)
+        except PatchError as e:
+            print(f"❌ {e}")
+            sys.exit(1)
+        with open(args.output, "wb") as f:
+            f.write(new)
+        print(f"✅ {args.output}: {len(new)} bytes, firmware {firmware_id(new)}")
+    else:
+        with open(args.path, "rb") as f:
+            data = f.read()
+        if data[:4] == MAGIC:
+            print(parse_header(data))
+        else:
+            print(f"firmware_id={firmware_id(data)} tamaño={len(data)}")
+
+
+if __name__ == "__main__":
+    main()
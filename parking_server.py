@@ -5,38 +5,232 @@ Recibe datos JSON del sensor y opcionalmente imágenes
 """
 
 import socket
+import select
+import ssl
+import struct
 import json
 import threading
 import time
 import os
 from datetime import datetime
-import base64
+import argparse
+
+from image_pipeline import ImagePipeline
+from occupancy_analytics import OccupancyAnalytics
+from occupancy_state import OccupancyHttpServer, OccupancyTable
+from ota_delta import FirmwareRepository
+from postmortem_store import PostmortemStore
+from raw_stream import RawHistory
+from sensor_health import HealthMonitor, describe_health
+from sensor_log import SensorLog
+
+# Claves de configuración aceptadas por el ESP32 (ver lib/CommandChannel)
+CONFIG_KEYS = ("threshold", "id", "server", "interval", "res", "quality", "hb", "roi", "raw")
+
+# Heartbeats sin recibir antes de marcar el espacio como stale
+MISSED_HEARTBEATS = 3
+
+# Segundos para completar el handshake TLS de una conexión nueva
+TLS_HANDSHAKE_TIMEOUT = 10.0
+
+# Bytes máximos de un trozo OTAD (CMD_MAX_OTA_CHUNK en lib/CommandChannel)
+OTA_MAX_CHUNK = 4096
+
+# Segundos entre guardados de los acumulados de analítica
+ANALYTICS_SAVE_INTERVAL = 300.0
+
+# Tipos de trama en los lotes de un gateway (GatewayFrameType en lib/Gateway)
+GATEWAY_EVENT = 1
+GATEWAY_HEARTBEAT = 2
+
+# Telemetría UDP (lib/UdpTelemetry): la trama de hoja en un datagrama
+# (GatewayFrame, 24 bytes) y la confirmación selectiva de 16 bytes
+UDP_FRAME = struct.Struct("<BBHHHIIII")
+UDP_FRAME_MAGIC = 0x4C
+UDP_FRAME_OCCUPIED = 0x80
+UDP_FRAME_TYPE_MASK = 0x0F
+UDP_FRAME_HEALTH_SHIFT = 4    # Salud del sensor en los bits 4-6 (sensor_health.py)
+UDP_ACK = struct.Struct("<BBHHHII")
+UDP_ACK_MAGIC = 0x4B
+UDP_ACK_WINDOW = 32       # Bits del mapa: seq recibidos por debajo del más alto
+
+
+def make_tls_context(cert_file, key_file):
+    """Contexto TLS del servidor para los ESP32 (ver lib/HAL/HalTls.h)
+
+    TLS 1.2+ con ECDHE y AES-GCM. Los tickets de sesión vienen activados:
+    el ESP32 reanuda la sesión al reconectar sin volver a verificar el
+    certificado. Las claves de los tickets viven lo que vive el proceso.
+    """
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.minimum_version = ssl.TLSVersion.TLSv1_2
+    context.set_ciphers("ECDHE+AESGCM")
+    context.load_cert_chain(cert_file, key_file)
+    return context
+
+
+class DeviceConnection:
+    """Conexión de un cliente con envío seguro entre hilos"""
+
+    def __init__(self, client_socket, client_address):
+        self.socket = client_socket
+        self.address = client_address
+        self.parking_id = None
+        self.last_event = None   # timestamp del último evento: identifica sus imágenes
+        self.firmware_id = None  # Imagen en ejecución según el hello (solo firmware con OTA)
+        self.gateway_id = None   # Conexión de un gateway: llegan lotes de sus hojas
+        self.handed_off = False  # Pasada al worker dueño de su parkingId (sharded_ingest.py)
+        self.send_lock = threading.Lock()
+        self.tls = isinstance(client_socket, ssl.SSLSocket)
+
+    def send(self, data):
+        with self.send_lock:
+            self.socket.sendall(data)
+
+    def send_line(self, text):
+        """Enviar una trama terminada en salto de línea"""
+        self.send((text + "\n").encode('utf-8'))
+
+    def recv(self, size, timeout):
+        """Recibir datos; socket.timeout si no llega nada en timeout segundos
+
+        Un SSLSocket no admite leer y escribir a la vez desde hilos distintos:
+        se espera sin el lock y solo se lee el registro con el lock tomado.
+        """
+        if not self.tls:
+            return self.socket.recv(size)
+        if not self.socket.pending():
+            readable, _, _ = select.select([self.socket], [], [], timeout)
+            if not readable:
+                raise socket.timeout()
+        with self.send_lock:
+            return self.socket.recv(size)
+
 
 class ParkingServer:
-    def __init__(self, host='0.0.0.0', port=8080):
+    def __init__(self, host='0.0.0.0', port=8080, ack_events=False, quiet=False,
+                 image_workers=4, image_queue=64, fsync_images=True,
+                 http_port=None, stale_after=900.0, tls_context=None, sensor_log=None,
+                 firmware_dir="firmware", analytics_path="parking_analytics.json",
+                 postmortem_dir="postmortems", udp_port=None, reuse_port=False, router=None,
+                 raw_dir="raw_history"):
         self.host = host
         self.port = port
+        self.ack_events = ack_events  # Responder EVT <timestamp> a cada evento (latencia de ingesta)
+        self.quiet = quiet            # No imprimir cada evento (pruebas de carga)
         self.server_socket = None
         self.running = False
         self.clients = []
+        self.clients_lock = threading.Lock()
+        
+        # Dispositivos identificados por parkingId y confirmaciones pendientes
+        self.devices = {}
+        self.pending_acks = {}
+        self.next_command_seq = 1
+        self.command_lock = threading.Lock()
+        
+        # Estado de ocupación en vivo; http_port=None desactiva las consultas HTTP/SSE
+        self.occupancy = OccupancyTable(stale_after=stale_after)
+        self.http_port = http_port
+        self.http_server = None
+        self.heartbeats_received = 0
+        
+        # Estadía, rotación y utilización (occupancy_analytics.py), guardadas
+        # en analytics_path para no reconstruirlas desde el log al reiniciar
+        self.analytics_path = analytics_path
+        self.analytics = self.load_analytics()
+        
+        # TLS opcional (make_tls_context); handshakes completos y reanudados
+        self.tls_context = tls_context
+        self.tls_stats = {"full": 0, "resumed": 0, "failed": 0}
+        self.tls_lock = threading.Lock()
+        
+        # Tiempo sin datos tras el cual un mensaje sin '\n' se procesa completo
+        # (compatibilidad con clientes que no terminan sus mensajes)
+        self.legacy_flush_timeout = 0.2
         
         # Crear directorio para imágenes si no existe
         self.images_dir = "parking_images"
         if not os.path.exists(self.images_dir):
             os.makedirs(self.images_dir)
             print(f"📁 Directorio creado: {self.images_dir}")
+        
+        # Decodificación, validación y escritura de imágenes fuera de los hilos de conexión
+        self.image_pipeline = ImagePipeline(self.images_dir, workers=image_workers,
+                                            queue_size=image_queue, fsync=fsync_images, quiet=quiet)
+        
+        # Log de eventos con buffer, rotación y compresión (sensor_log.py)
+        self.sensor_log = sensor_log if sensor_log is not None else SensorLog("parking_sensor.log")
+        
+        # Actualizaciones OTA: imágenes y parches (ota_delta.py) y la imagen
+        # pedida para cada parkingId con el estado de su descarga
+        self.firmware = FirmwareRepository(firmware_dir)
+        self.ota_targets = {}
+        self.ota_lock = threading.Lock()
+        
+        # Informes de los reinicios de cada dispositivo (postmortem_store.py)
+        self.postmortems = PostmortemStore(postmortem_dir)
+        
+        # Serie cruda de distancias de los dispositivos con CFG raw=<ms> (raw_stream.py)
+        self.raw_history = RawHistory(raw_dir)
+        
+        # Salud de cada sensor ultrasónico y sus alertas (sensor_health.py)
+        self.health = HealthMonitor()
+        
+        # Gateways (lib/Gateway): último lote aplicado de cada uno y sus hojas
+        self.gateways = {}
+        self.gateway_lock = threading.Lock()
+        
+        # Telemetría UDP (udp_port=None la desactiva, 0 = puerto libre): seq
+        # más alto y mapa de recibidos por parkingId para descartar repetidas
+        self.udp_port = udp_port
+        self.udp_socket = None
+        self.udp_spots = {}
+        self.udp_stats = {"datagrams": 0, "frames": 0, "duplicates": 0, "late": 0, "invalid": 0}
+        self.udp_lock = threading.Lock()
+        
+        # Ingesta repartida en varios procesos (sharded_ingest.py): todos
+        # escuchan el mismo puerto con SO_REUSEPORT y router decide qué
+        # worker es dueño de cada parkingId. Sin router, un solo proceso
+        self.reuse_port = reuse_port
+        self.router = router
+        self.ready = threading.Event()   # Sockets abiertos
     
     def start_server(self):
         """Iniciar el servidor TCP"""
         try:
             self.server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
             self.server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            if self.reuse_port:
+                self.server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
             self.server_socket.bind((self.host, self.port))
-            self.server_socket.listen(5)
+            self.server_socket.listen(128)  # Absorber reconexiones simultáneas de la flota
+            self.port = self.server_socket.getsockname()[1]
+            
+            if self.udp_port is not None:
+                self.udp_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+                if self.reuse_port:
+                    self.udp_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+                self.udp_socket.bind((self.host, self.udp_port))
+                self.udp_socket.settimeout(0.5)
+                self.udp_port = self.udp_socket.getsockname()[1]
             
             self.running = True
+            self.ready.set()
+            self.image_pipeline.start()
+            threading.Thread(target=self.expire_loop, daemon=True).start()
+            if self.udp_socket is not None:
+                threading.Thread(target=self.udp_loop, daemon=True).start()
+            if self.http_port is not None:
+                self.http_server = OccupancyHttpServer(self.occupancy, self.host, self.http_port,
+                                                       analytics=self.analytics)
+                self.http_server.start()
+                print(f"🌐 Ocupación en vivo: http://{self.host}:{self.http_server.port}/spots "
+                      f"(suscripción en /events)")
             print("🚗 Servidor de Parqueo ESP32 iniciado")
-            print(f"📍 Escuchando en {self.host}:{self.port}")
+            print(f"📍 Escuchando en {self.host}:{self.port}" + (" (TLS)" if self.tls_context else ""))
+            if self.udp_socket is not None:
+                print(f"📡 Telemetría UDP en {self.host}:{self.udp_port}")
             print(f"📁 Imágenes se guardarán en: {os.path.abspath(self.images_dir)}")
             print("=" * 50)
             
@@ -62,31 +256,464 @@ class ParkingServer:
         finally:
             self.stop_server()
     
-    def handle_client(self, client_socket, client_address):
-        """Manejar comunicación con un cliente"""
+    def accept_tls(self, client_socket, client_address):
+        """Handshake TLS en el hilo de la conexión; None si falla"""
+        client_socket.settimeout(TLS_HANDSHAKE_TIMEOUT)
+        try:
+            tls_socket = self.tls_context.wrap_socket(client_socket, server_side=True)
+        except (ssl.SSLError, OSError) as e:
+            with self.tls_lock:
+                self.tls_stats["failed"] += 1
+            print(f"🔒 Handshake TLS fallido con {client_address}: {e}")
+            client_socket.close()
+            return None
+        with self.tls_lock:
+            self.tls_stats["resumed" if tls_socket.session_reused else "full"] += 1
+        return tls_socket
+    
+    def handle_client(self, client_socket, client_address, pending=b""):
+        """Manejar comunicación con un cliente
+
+        pending: bytes ya recibidos por otro worker antes de pasar la conexión.
+        """
+        if self.tls_context is not None:
+            client_socket = self.accept_tls(client_socket, client_address)
+            if client_socket is None:
+                return
+        connection = DeviceConnection(client_socket, client_address)
+        with self.clients_lock:
+            self.clients.append(connection)
+        
+        buffer = bytearray(pending)
+        scanned = 0  # Bytes del buffer ya revisados sin encontrar '\n'
+        client_socket.settimeout(self.legacy_flush_timeout)
         try:
             while self.running:
+                # Procesar cada línea completa; una imagen llega en muchos
+                # recv(), así que solo se busca el '\n' en lo nuevo
+                while True:
+                    newline = buffer.find(b"\n", scanned)
+                    if newline < 0:
+                        scanned = len(buffer)
+                        break
+                    line = bytes(buffer[:newline])
+                    del buffer[:newline + 1]
+                    scanned = 0
+                    if line.strip() and not self.route_message(line, connection, buffer):
+                        return
+                
+                # JSON o comandos completos sin '\n' (clientes antiguos)
+                if buffer and self.is_complete_message(buffer):
+                    if not self.route_message(bytes(buffer), connection):
+                        return
+                    buffer.clear()
+                    scanned = 0
+                
                 # Recibir datos del cliente
-                data = client_socket.recv(4096)
+                try:
+                    data = connection.recv(65536, self.legacy_flush_timeout)
+                except socket.timeout:
+                    # Mensaje sin terminador: procesarlo tal como llegó
+                    if buffer:
+                        if not self.route_message(bytes(buffer), connection):
+                            return
+                        buffer.clear()
+                        scanned = 0
+                    continue
+                
                 if not data:
                     break
                 
-                # Decodificar datos
-                message = data.decode('utf-8').strip()
-                
-                # Intentar parsear como JSON (datos del sensor)
-                try:
-                    sensor_data = json.loads(message)
-                    self.process_sensor_data(sensor_data, client_address)
-                except json.JSONDecodeError:
-                    # Si no es JSON, podría ser una imagen o comando
-                    self.process_non_json_data(message, client_socket, client_address)
+                buffer.extend(data)
                     
         except Exception as e:
             print(f"❌ Error manejando cliente {client_address}: {e}")
         finally:
+            self.unregister_connection(connection)
             client_socket.close()
-            print(f"🔌 Cliente desconectado: {client_address}")
+            if not connection.handed_off:
+                print(f"🔌 Cliente desconectado: {client_address}")
+    
+    def route_message(self, raw, connection, rest=b""):
+        """Procesar un mensaje aquí o pasar la conexión al worker dueño de su parkingId
+
+        Solo con router (sharded_ingest.py) y mientras la conexión no tenga
+        parkingId: el kernel reparte las conexiones entre los workers sin
+        saber de qué espacio son, y la primera trama con parkingId (hello,
+        evento o comando de administración) decide. Retorna False si la
+        conexión se pasó a otro worker con raw y el resto del buffer.
+        """
+        if self.router is not None and connection.parking_id is None and connection.gateway_id is None:
+            owner = self.router.owner_of_message(raw)
+            if owner is not None and owner != self.router.shard:
+                connection.handed_off = True
+                self.router.hand_off(owner, connection.socket, connection.address,
+                                     raw + b"\n" + bytes(rest))
+                return False
+        self.process_message(raw, connection)
+        return True
+    
+    def is_complete_message(self, buffer):
+        """Detectar mensajes completos que llegaron sin salto de línea"""
+        if buffer[:6] == b"IMAGE:":
+            return False  # Evitar copiar una imagen a medio recibir
+        text = bytes(buffer).strip()
+        if text.startswith(b"COMMAND:"):
+            return True
+        if text.startswith(b"{") and text.endswith(b"}"):
+            try:
+                json.loads(text.decode('utf-8'))
+                return True
+            except (UnicodeDecodeError, json.JSONDecodeError):
+                return False
+        return False
+    
+    def process_message(self, raw, connection):
+        """Procesar un mensaje completo de un cliente"""
+        # Las imágenes pasan al pipeline en bytes, sin decodificar a texto
+        if raw.startswith(b"IMAGE:"):
+            self.handle_image_data(raw[6:].strip(), connection)
+            return
+        # Heartbeats: sin JSON ni log por trama, el caso más frecuente en reposo
+        if raw.startswith(b"HB "):
+            self.handle_heartbeat(raw, connection)
+            return
+        if raw.startswith(b"RAW "):
+            self.handle_raw_block(raw, connection)
+            return
+        
+        message = raw.decode('utf-8').strip()
+        if not message:
+            return
+        
+        # Intentar parsear como JSON (datos del sensor o confirmaciones)
+        try:
+            sensor_data = json.loads(message)
+        except json.JSONDecodeError:
+            # Si no es JSON, podría ser una imagen o comando
+            self.process_non_json_data(message, connection, connection.address)
+            return
+        
+        if isinstance(sensor_data, dict) and "ack" in sensor_data:
+            self.handle_ack(sensor_data, connection)
+            self.touch_device(connection)
+        elif isinstance(sensor_data, dict) and "frames" in sensor_data and "gateway" in sensor_data:
+            self.handle_gateway_batch(sensor_data, connection)
+        elif isinstance(sensor_data, dict) and "hello" in sensor_data and "gateway" in sensor_data:
+            self.register_gateway(sensor_data, connection)
+        elif isinstance(sensor_data, dict) and "hello" in sensor_data:
+            self.register_device(sensor_data, connection)
+            self.set_heartbeat_timeout(sensor_data, connection)
+            self.touch_device(connection)
+            connection.firmware_id = sensor_data.get("fw")
+            print(f"👋 Parqueo {sensor_data.get('parkingId')} identificado en {connection.address}")
+            self.check_ota(connection)
+        elif isinstance(sensor_data, dict) and "ota" in sensor_data:
+            self.handle_ota_message(sensor_data, connection)
+            self.touch_device(connection)
+        elif isinstance(sensor_data, dict) and "postmortem" in sensor_data:
+            self.handle_postmortem(sensor_data, connection)
+            self.touch_device(connection)
+        elif isinstance(sensor_data, dict) and "health" in sensor_data:
+            parking_id = connection.parking_id if connection.parking_id is not None else sensor_data.get("parkingId")
+            self.update_health(parking_id, sensor_data["health"], sensor_data)
+            self.touch_device(connection)
+        else:
+            self.register_device(sensor_data, connection)
+            if isinstance(sensor_data, dict) and "timestamp" in sensor_data:
+                connection.last_event = sensor_data["timestamp"]
+            self.update_occupancy(sensor_data)
+            self.process_sensor_data(sensor_data, connection.address)
+            if self.ack_events and isinstance(sensor_data, dict) and "timestamp" in sensor_data:
+                connection.send_line(f"EVT {sensor_data['timestamp']}")
+    
+    def register_device(self, data, connection):
+        """Asociar la conexión con el parkingId que reporta"""
+        parking_id = data.get('parkingId') if isinstance(data, dict) else None
+        if parking_id is None or connection.parking_id == parking_id:
+            return
+        
+        with self.clients_lock:
+            if connection.parking_id is not None and self.devices.get(connection.parking_id) is connection:
+                del self.devices[connection.parking_id]
+            connection.parking_id = parking_id
+            self.devices[parking_id] = connection
+    
+    def unregister_connection(self, connection):
+        """Quitar la conexión de los registros del servidor"""
+        lost_device = False
+        with self.clients_lock:
+            if connection in self.clients:
+                self.clients.remove(connection)
+            if connection.parking_id is not None and self.devices.get(connection.parking_id) is connection:
+                del self.devices[connection.parking_id]
+                lost_device = True
+        if lost_device:
+            self.occupancy.mark_stale(connection.parking_id)
+        if connection.gateway_id is not None:
+            # Sin el gateway sus hojas quedan sin noticias
+            with self.gateway_lock:
+                state = self.gateways.get(connection.gateway_id)
+                leaves = []
+                if state is not None and state["connection"] is connection:
+                    state["connection"] = None
+                    leaves = list(state["leaves"])
+            for parking_id in leaves:
+                self.occupancy.mark_stale(parking_id)
+    
+    def update_occupancy(self, data):
+        """Llevar un evento del sensor a la tabla de ocupación en vivo"""
+        if not isinstance(data, dict) or data.get('parkingId') is None or 'occupied' not in data:
+            return
+        self.apply_frame(data['parkingId'], data['occupied'], data.get('distance'),
+                         data.get('timestamp'), seq=data.get('seq'))
+        self.analytics.record(data['parkingId'], data['occupied'], timestamp=data.get('timestamp'))
+    
+    def gateway_state(self, gateway_id):
+        """Estado de un gateway (con gateway_lock tomado)"""
+        state = self.gateways.get(gateway_id)
+        if state is None:
+            state = {"connection": None, "epoch": None, "batch": 0, "batches": 0, "frames": 0,
+                     "duplicates": 0, "leaves": set(), "leaf_timeout": None}
+            self.gateways[gateway_id] = state
+        return state
+    
+    def register_gateway(self, data, connection):
+        """Hello de un gateway: "hb" es el intervalo de heartbeat de sus hojas"""
+        gateway_id = data.get("gateway")
+        interval = data.get("hb")
+        with self.gateway_lock:
+            state = self.gateway_state(gateway_id)
+            state["connection"] = connection
+            state["leaf_timeout"] = (interval / 1000.0 * MISSED_HEARTBEATS
+                                     if isinstance(interval, (int, float)) and interval > 0 else None)
+        connection.gateway_id = gateway_id
+        print(f"🛰️ Gateway {gateway_id} identificado en {connection.address}")
+    
+    def handle_gateway_batch(self, data, connection):
+        """Lote de un gateway: aplicar sus tramas una vez y confirmar con GWK <lote>
+        
+        {"gateway": id, "epoch": e, "batch": n,
+         "frames": [[parkingId, seq, tipo, ocupado, distancia, ms, válidas, fallidas, salud], ...]}
+        Tras reconectar el gateway reenvía el lote sin confirmar con el mismo
+        número: si ya se aplicó solo se vuelve a confirmar.
+        """
+        gateway_id, epoch, batch = data.get("gateway"), data.get("epoch"), data.get("batch")
+        frames = data.get("frames")
+        if not isinstance(batch, int) or not isinstance(frames, list):
+            return
+        new_leaves = []
+        with self.gateway_lock:
+            state = self.gateway_state(gateway_id)
+            duplicate = state["epoch"] == epoch and batch <= state["batch"]
+            if duplicate:
+                state["duplicates"] += 1
+            else:
+                state["epoch"], state["batch"] = epoch, batch
+                state["batches"] += 1
+                state["frames"] += len(frames)
+                for frame in frames:
+                    if isinstance(frame, list) and frame and frame[0] not in state["leaves"]:
+                        state["leaves"].add(frame[0])
+                        new_leaves.append(frame[0])
+            timeout = state["leaf_timeout"]
+        
+        if not duplicate:
+            if self.router is not None:
+                # Las hojas de otros workers se les reenvían; al desconectarse
+                # el gateway esas pasan a stale por su leaf_timeout
+                frames = self.router.forward_frames(frames, connection.address, gateway_id, timeout)
+                new_leaves = [pid for pid in new_leaves if self.router.is_local(pid)]
+            for parking_id in new_leaves:
+                self.occupancy.set_timeout(parking_id, timeout)
+            for frame in frames:
+                self.apply_gateway_frame(frame, connection.address, gateway_id)
+        connection.send_line(f"GWK {batch}")
+    
+    def apply_gateway_frame(self, frame, address, gateway_id=None):
+        """Una trama de hoja: igual que un evento JSON o un HB por conexión directa"""
+        # Gateways anteriores a la salud del sensor envían 8 campos
+        try:
+            parking_id, seq, kind, occupied, distance, timestamp, valid, failed = frame[:8]
+            health = frame[8] if len(frame) > 8 else None
+        except (TypeError, ValueError, KeyError):
+            return
+        if health is not None:
+            self.update_health(parking_id, health)
+        if kind == GATEWAY_EVENT:
+            event = {"parkingId": parking_id, "occupied": bool(occupied), "distance": distance,
+                     "timestamp": timestamp, "seq": seq}
+            if gateway_id is not None:
+                event["gateway"] = gateway_id
+            self.update_occupancy(event)
+            self.process_sensor_data(event, address)
+        elif kind == GATEWAY_HEARTBEAT:
+            self.heartbeats_received += 1
+            self.apply_frame(parking_id, bool(occupied), distance,
+                             seq=seq, measurements=valid, failures=failed)
+            self.analytics.seen(parking_id)
+    
+    def udp_loop(self):
+        """Datagramas de lib/UdpTelemetry: una trama cada uno, confirmada siempre"""
+        while self.running:
+            try:
+                data, address = self.udp_socket.recvfrom(512)
+            except socket.timeout:
+                continue
+            except OSError:
+                break  # Socket cerrado en stop_server
+            if self.router is not None and self.router.forward_datagram(data, address):
+                continue  # Lo confirma el worker dueño, desde el mismo puerto
+            ack = self.handle_udp_frame(data, address)
+            if ack is not None:
+                try:
+                    self.udp_socket.sendto(ack, address)
+                except OSError:
+                    pass
+    
+    def handle_udp_frame(self, data, address):
+        """Aplicar una trama UDP una sola vez; retorna la confirmación a enviar o None
+        
+        La confirmación lleva el seq más alto recibido de ese parkingId y un mapa
+        de los UDP_ACK_WINDOW anteriores (bit i = seq más alto - 1 - i), así una
+        sola alcanza aunque se hayan perdido las de tramas previas. Una trama
+        repetida (su confirmación se perdió) solo se vuelve a confirmar; una que
+        llega después de otra más nueva queda en el log pero no pisa el estado.
+        """
+        with self.udp_lock:
+            self.udp_stats["datagrams"] += 1
+        if len(data) != UDP_FRAME.size:
+            with self.udp_lock:
+                self.udp_stats["invalid"] += 1
+            return None
+        magic, flags, parking_id, epoch, distance, seq, ms, valid, failed = UDP_FRAME.unpack(data)
+        kind = flags & UDP_FRAME_TYPE_MASK
+        if magic != UDP_FRAME_MAGIC or kind not in (GATEWAY_EVENT, GATEWAY_HEARTBEAT):
+            with self.udp_lock:
+                self.udp_stats["invalid"] += 1
+            return None
+        
+        with self.udp_lock:
+            state = self.udp_spots.get(parking_id)
+            if state is None or state["epoch"] != epoch:
+                state = {"epoch": epoch, "seq": seq, "bitmap": 0}
+                self.udp_spots[parking_id] = state
+                status = "new"
+            elif 0 < (seq - state["seq"]) & 0xFFFFFFFF < 0x80000000:
+                # Adelante en aritmética módulo 2^32: sigue valiendo cuando el seq da la vuelta
+                shift = (seq - state["seq"]) & 0xFFFFFFFF
+                state["bitmap"] = ((state["bitmap"] << shift) | (1 << (shift - 1))
+                                   if shift <= UDP_ACK_WINDOW else 0) & 0xFFFFFFFF
+                state["seq"] = seq
+                status = "new"
+            else:
+                behind = (state["seq"] - seq) & 0xFFFFFFFF
+                bit = 1 << (behind - 1) if 0 < behind <= UDP_ACK_WINDOW else 0
+                if bit and not state["bitmap"] & bit:
+                    state["bitmap"] |= bit
+                    status = "late"
+                else:
+                    status = "duplicate"  # Incluye las demasiado viejas para el mapa
+            ack = UDP_ACK.pack(UDP_ACK_MAGIC, 0, parking_id, epoch, 0, state["seq"], state["bitmap"])
+            self.udp_stats[{"new": "frames", "late": "late", "duplicate": "duplicates"}[status]] += 1
+        
+        frame = [parking_id, seq, kind, 1 if flags & UDP_FRAME_OCCUPIED else 0,
+                 distance / 10.0, ms, valid, failed, (flags & ~UDP_FRAME_OCCUPIED) >> UDP_FRAME_HEALTH_SHIFT]
+        if status == "new":
+            self.apply_gateway_frame(frame, address)
+        elif status == "late":
+            self.occupancy.touch(parking_id)
+            if kind == GATEWAY_EVENT:
+                self.log_sensor_data({"parkingId": parking_id, "occupied": bool(frame[3]),
+                                      "distance": frame[4], "timestamp": ms, "seq": seq,
+                                      "late": True}, address)
+        return ack
+    
+    def handle_heartbeat(self, raw, connection):
+        """HB <seq> <ocupado> <distancia> <mediciones válidas> <fallidas> [salud]"""
+        parts = raw.split()
+        if len(parts) not in (6, 7) or connection.parking_id is None:
+            return  # Sin hello no se sabe de qué espacio es
+        try:
+            seq, occupied, valid, failed = int(parts[1]), parts[2] == b"1", int(parts[4]), int(parts[5])
+            distance = float(parts[3])
+        except ValueError:
+            return
+        self.heartbeats_received += 1
+        self.apply_frame(connection.parking_id, occupied, distance,
+                         seq=seq, measurements=valid, failures=failed)
+        self.analytics.seen(connection.parking_id)
+        if len(parts) == 7:
+            self.update_health(connection.parking_id, parts[6].decode("ascii", "replace"))
+    
+    def update_health(self, parking_id, health, stats=None):
+        """Reporte de salud del sensor: avisar si abre o cierra una alerta"""
+        entry = self.health.update(parking_id, health, stats)
+        if entry is not None:
+            print(describe_health(entry))
+    
+    def handle_raw_block(self, raw, connection):
+        """RAW <base64>: un bloque de la serie cruda al historial del dispositivo"""
+        if connection.parking_id is None:
+            return  # Sin hello no se sabe de qué espacio es
+        try:
+            self.raw_history.add_line(connection.parking_id, raw)
+        except (OSError, ValueError) as e:
+            print(f"⚠️ Parqueo {connection.parking_id}: bloque crudo descartado: {e}")
+            return
+        self.touch_device(connection)
+    
+    def apply_frame(self, parking_id, occupied, distance, timestamp=None, **frame):
+        """Llevar un evento o heartbeat a la tabla y avisar si hubo tramas perdidas"""
+        previous = self.occupancy.get(parking_id)
+        self.occupancy.update(parking_id, occupied, distance, timestamp, **frame)
+        spot = self.occupancy.get(parking_id)
+        if previous is not None and spot.lost > previous.lost and not self.quiet:
+            print(f"⚠️ Parqueo {parking_id}: {spot.lost - previous.lost} trama(s) perdida(s) "
+                  f"(seq {previous.seq} → {spot.seq})")
+    
+    def set_heartbeat_timeout(self, data, connection):
+        """El hello anuncia el intervalo de heartbeat: sin tramas en ese lapso, stale"""
+        if connection.parking_id is None:
+            return
+        interval = data.get('hb')
+        if isinstance(interval, (int, float)) and interval > 0:
+            self.occupancy.set_timeout(connection.parking_id, interval / 1000.0 * MISSED_HEARTBEATS)
+        else:
+            self.occupancy.set_timeout(connection.parking_id, None)
+    
+    def touch_device(self, connection):
+        if connection.parking_id is not None:
+            self.occupancy.touch(connection.parking_id)
+    
+    def expire_loop(self):
+        """Marcar como stale los espacios cuyos dispositivos dejaron de reportar"""
+        interval = min(1.0, self.occupancy.stale_after / 4)
+        last_save = time.time()
+        while self.running:
+            time.sleep(interval)
+            expired = self.occupancy.expire()
+            if expired and not self.quiet:
+                print(f"⏰ {expired} espacio(s) sin datos recientes")
+            if time.time() - last_save >= ANALYTICS_SAVE_INTERVAL:
+                self.save_analytics()
+                last_save = time.time()
+    
+    def load_analytics(self):
+        if self.analytics_path and os.path.exists(self.analytics_path):
+            try:
+                return OccupancyAnalytics.load(self.analytics_path)
+            except (OSError, ValueError, KeyError) as e:
+                print(f"⚠️ No se pudo leer {self.analytics_path}, se empieza de cero: {e}")
+        return OccupancyAnalytics()
+    
+    def save_analytics(self):
+        if not self.analytics_path:
+            return
+        try:
+            self.analytics.save(self.analytics_path)
+        except OSError as e:
+            print(f"⚠️ Error guardando analítica: {e}")
     
     def process_sensor_data(self, data, client_address):
         """Procesar datos del sensor de parqueo"""
@@ -108,13 +735,14 @@ class ParkingServer:
             status = "🟢 LIBRE" if not occupied else "🔴 OCUPADO"
             
             # Mostrar información en consola
-            print(f"\n📊 DATOS DEL SENSOR - {time_str}")
-            print(f"   Cliente: {client_address}")
-            print(f"   ID Parqueo: {parking_id}")
-            print(f"   Estado: {status}")
-            print(f"   Distancia: {distance:.1f} cm")
-            print(f"   Timestamp: {timestamp}")
-            print("-" * 40)
+            if not self.quiet:
+                print(f"\n📊 DATOS DEL SENSOR - {time_str}")
+                print(f"   Cliente: {client_address}")
+                print(f"   ID Parqueo: {parking_id}")
+                print(f"   Estado: {status}")
+                print(f"   Distancia: {distance:.1f} cm")
+                print(f"   Timestamp: {timestamp}")
+                print("-" * 40)
             
             # Guardar en archivo de log (opcional)
             self.log_sensor_data(data, client_address)
@@ -122,55 +750,31 @@ class ParkingServer:
         except Exception as e:
             print(f"❌ Error procesando datos del sensor: {e}")
     
-    def process_non_json_data(self, data, client_socket, client_address):
+    def process_non_json_data(self, data, connection, client_address):
         """Procesar datos que no son JSON (imágenes, comandos, etc.)"""
-        # Verificar si es un comando especial
-        if data.startswith("IMAGE:"):
-            self.handle_image_data(data, client_socket, client_address)
-        elif data.startswith("COMMAND:"):
-            self.handle_command(data, client_socket, client_address)
+        # Verificar si es un comando especial (las imágenes se atienden en process_message)
+        if data.startswith("COMMAND:"):
+            self.handle_command(data, connection, client_address)
         else:
             print(f"📝 Mensaje de texto de {client_address}: {data}")
     
-    def handle_image_data(self, data, client_socket, client_address):
-        """Manejar recepción de imagen"""
-        try:
-            # Extraer datos de la imagen (base64)
-            image_data = data[6:]  # Remover "IMAGE:" del inicio
-            
-            # Decodificar imagen
-            image_bytes = base64.b64decode(image_data)
-            
-            # Generar nombre de archivo
-            timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
-            filename = f"parking_{timestamp}_{client_address[0]}.jpg"
-            filepath = os.path.join(self.images_dir, filename)
-            
-            # Guardar imagen
-            with open(filepath, 'wb') as f:
-                f.write(image_bytes)
-            
-            print(f"📸 Imagen guardada: {filename}")
-            print(f"   Tamaño: {len(image_bytes)} bytes")
-            print(f"   Ruta: {filepath}")
-            
-            # Enviar confirmación al cliente
-            response = json.dumps({
-                "status": "success",
-                "message": "Imagen recibida correctamente",
-                "filename": filename
-            })
-            client_socket.send(response.encode('utf-8'))
-            
-        except Exception as e:
-            print(f"❌ Error procesando imagen: {e}")
-            error_response = json.dumps({
-                "status": "error",
-                "message": str(e)
-            })
-            client_socket.send(error_response.encode('utf-8'))
+    def handle_image_data(self, payload, connection):
+        """Encolar una imagen en base64; la respuesta la envía el pipeline"""
+        # Nombre por parqueo y evento: la imagen sigue al evento de ocupación
+        # en la misma conexión. Clientes sin parkingId se identifican por IP.
+        parking_id = connection.parking_id
+        if parking_id is None:
+            parking_id = "ip-" + connection.address[0]
+        event_id = connection.last_event
+        if event_id is None:
+            event_id = datetime.now().strftime("%Y%m%d%H%M%S%f")
+        
+        def reply(response):
+            connection.send_line(json.dumps(response))
+        
+        self.image_pipeline.submit(payload, parking_id, event_id, reply)
     
-    def handle_command(self, data, client_socket, client_address):
+    def handle_command(self, data, connection, client_address):
         """Manejar comandos del cliente"""
         command = data[8:]  # Remover "COMMAND:" del inicio
         
@@ -181,25 +785,359 @@ class ParkingServer:
             response = json.dumps({
                 "status": "running",
                 "clients_connected": len(self.clients),
-                "uptime": time.time()
+                "uptime": time.time(),
+                "images": self.image_pipeline.stats(),
+                "spots": self.occupancy.counts(),
+                "liveness": self.liveness_stats(),
+                "health": self.health.summary(),
+                "tls": self.tls_info(),
+                "ota": self.ota_status(),
+                "gateways": self.gateway_info(),
+                "udp": self.udp_info(),
+                "shard": self.shard_info()
             })
-            client_socket.send(response.encode('utf-8'))
+            connection.send(response.encode('utf-8'))
         elif command == "PING":
             response = json.dumps({"status": "pong"})
-            client_socket.send(response.encode('utf-8'))
+            connection.send(response.encode('utf-8'))
+        elif command == "DEVICES":
+            with self.clients_lock:
+                devices = {str(pid): f"{conn.address[0]}:{conn.address[1]}"
+                           for pid, conn in self.devices.items()}
+            response = json.dumps({"status": "ok", "devices": devices})
+            connection.send(response.encode('utf-8'))
+        elif command.startswith("CONFIG "):
+            response = json.dumps(self.handle_config_command(command[7:]))
+            connection.send(response.encode('utf-8'))
+        elif command.startswith("OTA "):
+            response = json.dumps(self.handle_ota_command(command[4:]))
+            connection.send(response.encode('utf-8'))
+        elif command.startswith("POSTMORTEM "):
+            response = json.dumps(self.handle_postmortem_command(command[11:]))
+            connection.send(response.encode('utf-8'))
+        elif command == "HEALTH" or command.startswith("HEALTH "):
+            response = json.dumps(self.handle_health_command(command[7:]))
+            connection.send(response.encode('utf-8'))
         else:
             response = json.dumps({"status": "unknown_command"})
-            client_socket.send(response.encode('utf-8'))
+            connection.send(response.encode('utf-8'))
+    
+    def handle_postmortem_command(self, arguments):
+        """COMMAND:POSTMORTEM <parkingId> [cantidad]: últimos informes de reinicio"""
+        parts = arguments.split()
+        if not parts or len(parts) > 2:
+            return {"status": "error", "message": "uso: POSTMORTEM <parkingId> [cantidad]"}
+        try:
+            count = int(parts[1]) if len(parts) > 1 else 5
+            reports = self.postmortems.latest(parts[0], count)
+        except ValueError as e:
+            return {"status": "error", "message": str(e)}
+        return {"status": "ok", "parkingId": parts[0], "reports": reports}
+    
+    def handle_health_command(self, arguments):
+        """COMMAND:HEALTH [parkingId]: sensores con alerta abierta, o la salud de uno"""
+        parts = arguments.split()
+        if len(parts) > 1:
+            return {"status": "error", "message": "uso: HEALTH [parkingId]"}
+        if parts:
+            return {"status": "ok", "parkingId": parts[0], "health": self.health.device(parts[0]),
+                    "recent": self.health.recent(parking_id=parts[0])}
+        return {"status": "ok", "alerts": self.health.alerts(), "recent": self.health.recent(),
+                "summary": self.health.summary()}
+    
+    def handle_config_command(self, arguments):
+        """COMMAND:CONFIG <parkingId|*> clave=valor ... desde un cliente de administración"""
+        parts = arguments.split()
+        if len(parts) < 2:
+            return {"status": "error", "message": "uso: CONFIG <parkingId|*> clave=valor ..."}
+        
+        config = {}
+        for pair in parts[1:]:
+            key, sep, value = pair.partition("=")
+            if not sep:
+                return {"status": "error", "message": f"par inválido: {pair}"}
+            config[key] = value
+        
+        if parts[0] == "*" and self.router is not None:
+            return {"status": "error", "message": "con --workers: un parkingId por comando"}
+        try:
+            if parts[0] == "*":
+                results = self.push_config_fleet(config)
+            else:
+                results = [self.push_config(int(parts[0]), config)]
+        except ValueError as e:
+            return {"status": "error", "message": str(e)}
+        
+        all_ok = all(result["status"] == "ok" for result in results)
+        return {"status": "ok" if all_ok else "partial", "results": results}
+    
+    def format_config_frame(self, seq, config):
+        """Construir la trama CFG que interpreta el ESP32"""
+        if not config:
+            raise ValueError("configuración vacía")
+        pairs = []
+        for key, value in config.items():
+            if key not in CONFIG_KEYS:
+                raise ValueError(f"clave desconocida: {key}")
+            if isinstance(value, (list, tuple)):
+                value = ",".join(str(v) for v in value)    # roi=x,y,ancho,alto
+            value = str(value)
+            if not value or any(c.isspace() for c in value):
+                raise ValueError(f"valor inválido para {key}: {value!r}")
+            pairs.append(f"{key}={value}")
+        return f"CFG {seq} " + " ".join(pairs)
+    
+    def send_command(self, parking_id, build_frame, label):
+        """Enviar la trama build_frame(seq) sin esperar respuesta; retorna la espera pendiente"""
+        with self.clients_lock:
+            connection = self.devices.get(parking_id)
+        
+        with self.command_lock:
+            seq = self.next_command_seq
+            self.next_command_seq += 1
+        
+        # Validar antes de comprobar la conexión para reportar errores de formato
+        frame = build_frame(seq)
+        
+        if connection is None:
+            return self.finished_command(seq, parking_id, {"status": "not_connected"})
+        
+        pending = {"seq": seq, "parkingId": parking_id, "event": threading.Event(), "ack": None}
+        self.pending_acks[seq] = pending
+        try:
+            connection.send_line(frame)
+            print(f"📤 {label} enviada a parqueo {parking_id}: {frame}")
+        except OSError as e:
+            self.pending_acks.pop(seq, None)
+            pending["ack"] = {"status": "send_failed", "message": str(e)}
+            pending["event"].set()
+        return pending
+    
+    def finished_command(self, seq, parking_id, ack):
+        """Espera ya resuelta, para comandos que no llegan a enviarse"""
+        pending = {"seq": seq, "parkingId": parking_id, "event": threading.Event(), "ack": ack}
+        pending["event"].set()
+        return pending
+    
+    def send_config(self, parking_id, config):
+        """Enviar una configuración sin esperar respuesta; retorna la espera pendiente"""
+        return self.send_command(parking_id, lambda seq: self.format_config_frame(seq, config),
+                                 "Configuración")
+    
+    def wait_command(self, pending, timeout):
+        """Esperar la confirmación de un comando enviado"""
+        if not pending["event"].wait(timeout):
+            self.pending_acks.pop(pending["seq"], None)
+            pending["ack"] = {"status": "timeout"}
+        
+        ack = pending["ack"]
+        result = {"parkingId": pending["parkingId"], "seq": pending["seq"], "status": ack.get("status")}
+        if "error" in ack:
+            result["error"] = ack["error"]
+            result["key"] = ack.get("key", "")
+        if "message" in ack:
+            result["message"] = ack["message"]
+        return result
+    
+    def push_config(self, parking_id, config, timeout=5.0):
+        """Enviar configuración a un dispositivo y esperar su confirmación"""
+        return self.wait_command(self.send_config(parking_id, config), timeout)
+    
+    def push_config_fleet(self, config, parking_ids=None, timeout=5.0):
+        """Enviar configuración a varios dispositivos (todos si parking_ids es None)"""
+        if parking_ids is None:
+            with self.clients_lock:
+                parking_ids = list(self.devices.keys())
+        
+        # Enviar a todos primero y luego esperar, para que las esperas se solapen
+        pendings = [self.send_config(pid, config) for pid in parking_ids]
+        return self.wait_all(pendings, timeout)
+    
+    def wait_all(self, pendings, timeout):
+        deadline = time.monotonic() + timeout
+        return [self.wait_command(p, max(0.0, deadline - time.monotonic())) for p in pendings]
+    
+    # ---- Actualización de firmware (OTA) ----
+    
+    def handle_ota_command(self, arguments):
+        """COMMAND:OTA <parkingId|*> <imagen.bin|firmware_id>
+
+        La imagen debe estar en el directorio de firmware del servidor; se
+        registra con su firmware_id y cada dispositivo recibe el parche desde
+        la imagen que reportó en su hello.
+        """
+        parts = arguments.split()
+        if len(parts) != 2:
+            return {"status": "error", "message": "uso: OTA <parkingId|*> <imagen.bin|firmware_id>"}
+        
+        if parts[0] == "*" and self.router is not None:
+            return {"status": "error", "message": "con --workers: un parkingId por comando"}
+        try:
+            image_id = self.resolve_image(parts[1])
+            if parts[0] == "*":
+                results = self.push_ota_fleet(image_id)
+            else:
+                results = [self.push_ota(int(parts[0]), image_id)]
+        except (OSError, ValueError) as e:
+            return {"status": "error", "message": str(e)}
+        
+        all_ok = all(result["status"] in ("ok", "up_to_date") for result in results)
+        return {"status": "ok" if all_ok else "partial", "image": image_id, "results": results}
+    
+    def resolve_image(self, name):
+        """firmware_id conocido o archivo .bin dentro del directorio de firmware"""
+        if self.firmware.has_image(name):
+            return name
+        path = os.path.realpath(os.path.join(self.firmware.directory, name))
+        if os.path.dirname(path) != os.path.realpath(self.firmware.directory) or not path.endswith(".bin"):
+            raise ValueError(f"la imagen debe ser un .bin en {self.firmware.directory}")
+        return self.firmware.add_image(path)
+    
+    def send_ota(self, parking_id, image_id):
+        """Ofrecer el parche hacia image_id sin esperar respuesta"""
+        with self.clients_lock:
+            connection = self.devices.get(parking_id)
+        with self.ota_lock:
+            target = self.ota_targets.setdefault(parking_id, {})
+            target.update(image=image_id, status="pending", offset=0)
+        
+        current = connection.firmware_id if connection is not None else None
+        if connection is not None and current is None:
+            status = "unsupported"       # Firmware sin OTA: su hello no trae "fw"
+        elif current == image_id:
+            status = "up_to_date"
+        else:
+            status = None
+        if status is not None:
+            with self.ota_lock:
+                target["status"] = status
+            return self.finished_command(0, parking_id, {"status": status})
+        
+        patch_id, size = self.firmware.prepare(current, image_id) if connection else (None, 0)
+        with self.ota_lock:
+            target.update(patch=patch_id, size=size, status="offered")
+        return self.send_command(parking_id, lambda seq: f"OTA {seq} id={patch_id} size={size}",
+                                 "Actualización")
+    
+    def push_ota(self, parking_id, image_id, timeout=5.0):
+        """Ofrecer una imagen a un dispositivo y esperar que acepte la descarga"""
+        result = self.wait_command(self.send_ota(parking_id, image_id), timeout)
+        self.ota_offer_result(parking_id, result)
+        return result
+    
+    def push_ota_fleet(self, image_id, parking_ids=None, timeout=5.0):
+        if parking_ids is None:
+            with self.clients_lock:
+                parking_ids = list(self.devices.keys())
+        results = self.wait_all([self.send_ota(pid, image_id) for pid in parking_ids], timeout)
+        for pid, result in zip(parking_ids, results):
+            self.ota_offer_result(pid, result)
+        return results
+    
+    def ota_offer_result(self, parking_id, result):
+        with self.ota_lock:
+            target = self.ota_targets.get(parking_id)
+            if target is not None and target["status"] == "offered" and result["status"] != "ok":
+                target["status"] = result["status"] if result["status"] != "error" else "rejected"
+    
+    def check_ota(self, connection):
+        """Tras el hello: ¿el dispositivo ya corre la imagen pedida o hay que retomar?"""
+        parking_id = connection.parking_id
+        with self.ota_lock:
+            target = dict(self.ota_targets.get(parking_id) or {})
+        if not target or connection.firmware_id is None:
+            return
+        if connection.firmware_id == target["image"]:
+            with self.ota_lock:
+                self.ota_targets[parking_id]["status"] = "updated"
+            if target["status"] != "updated":
+                print(f"✅ Parqueo {parking_id} actualizado a {target['image']}")
+            return
+        if target["status"] == "done":
+            # Avisó que terminó pero arrancó con la imagen anterior
+            with self.ota_lock:
+                self.ota_targets[parking_id]["status"] = "boot_failed"
+            print(f"⚠️ Parqueo {parking_id} sigue con {connection.firmware_id} después de actualizar")
+        elif target["status"] in ("offered", "downloading", "not_connected"):
+            # Pendiente desde antes de conectarse, o se reinició a mitad de la
+            # descarga: la oferta vuelve a empezar
+            try:
+                self.send_ota(parking_id, target["image"])
+            except (OSError, ValueError) as e:
+                print(f"⚠️ No se pudo reofrecer la actualización a {parking_id}: {e}")
+    
+    def handle_ota_message(self, data, connection):
+        """{"ota":"get"|"done"|"error", ...} del dispositivo"""
+        kind = data.get("ota")
+        parking_id = connection.parking_id
+        if kind == "get":
+            self.serve_ota_chunk(data, connection)
+            return
+        if kind not in ("done", "error"):
+            return
+        with self.ota_lock:
+            target = self.ota_targets.get(parking_id)
+            if target is not None and target.get("patch") == data.get("id"):
+                target["status"] = kind
+                if kind == "error":
+                    target["error"] = data.get("error")
+        if kind == "done":
+            print(f"📦 Parqueo {parking_id}: parche {data.get('id')} aplicado, reiniciando")
+        else:
+            print(f"❌ Parqueo {parking_id}: actualización fallida ({data.get('error')})")
+    
+    def serve_ota_chunk(self, data, connection):
+        """Responder un pedido con OTAD y los bytes del parche, sin estado por descarga"""
+        patch_id = data.get("id")
+        try:
+            offset = int(data.get("offset"))
+            length = min(int(data.get("length")), OTA_MAX_CHUNK)
+        except (TypeError, ValueError):
+            return
+        chunk = self.firmware.read_chunk(patch_id, offset, length)
+        if not chunk:
+            print(f"⚠️ Pedido OTA inválido de {connection.address}: {patch_id} @ {offset}")
+            return
+        connection.send(f"OTAD {offset} {len(chunk)} {patch_id}\n".encode('utf-8') + chunk)
+        with self.ota_lock:
+            target = self.ota_targets.get(connection.parking_id)
+            if target is not None and target.get("patch") == patch_id:
+                target["status"] = "downloading"
+                target["offset"] = max(target.get("offset", 0), offset + len(chunk))
+    
+    def ota_status(self):
+        with self.ota_lock:
+            return {str(pid): dict(target) for pid, target in self.ota_targets.items()}
+    
+    def handle_postmortem(self, data, connection):
+        """{"postmortem":true,...}: guardar el informe y confirmarlo con PMK <seq>"""
+        parking_id = connection.parking_id if connection.parking_id is not None else data.get("parkingId")
+        try:
+            self.postmortems.add(parking_id, data)
+        except (OSError, ValueError) as e:
+            print(f"⚠️ Error guardando informe postmortem: {e}")
+            return  # Sin PMK: el dispositivo lo reenvía al reconectar
+        connection.send_line(f"PMK {data.get('seq', 0)}")
+        previous = data.get("previous") or {}
+        print(f"🩺 Parqueo {parking_id}: arranque #{data.get('boot')} tras reinicio por {data.get('reset')}"
+              + (f" ({previous.get('uptime', 0) / 1000:.0f} s de actividad, heap mínimo "
+                 f"{previous.get('heapMin')} B, loop máx {previous.get('loopMax')} ms)" if previous else "")
+              + f", {len(data.get('events', []))} evento(s)")
+    
+    def handle_ack(self, data, connection):
+        """Procesar la confirmación de un comando enviado al dispositivo"""
+        pending = self.pending_acks.pop(data.get("ack"), None)
+        status = data.get("status")
+        print(f"📥 Confirmación de {connection.address}: seq={data.get('ack')} estado={status}")
+        if pending is None:
+            return
+        pending["ack"] = data
+        pending["event"].set()
     
     def log_sensor_data(self, data, client_address):
         """Guardar datos del sensor en archivo de log"""
         try:
-            log_file = "parking_sensor.log"
-            timestamp = datetime.now().strftime("%Y-%m-%d %H:%M:%S")
-            
-            with open(log_file, 'a', encoding='utf-8') as f:
-                f.write(f"{timestamp} | {client_address} | {json.dumps(data)}\n")
-                
+            self.sensor_log.write(client_address, data)
         except Exception as e:
             print(f"⚠️ Error guardando log: {e}")
     
@@ -208,6 +1146,13 @@ class ParkingServer:
         self.running = False
         if self.server_socket:
             self.server_socket.close()
+        if self.udp_socket is not None:
+            self.udp_socket.close()
+        self.image_pipeline.stop()
+        if self.http_server is not None:
+            self.http_server.stop()
+        self.sensor_log.close()
+        self.save_analytics()
         print("🛑 Servidor detenido")
     
     def get_server_info(self):
@@ -217,20 +1162,125 @@ class ParkingServer:
             "port": self.port,
             "running": self.running,
             "clients": len(self.clients),
-            "images_dir": os.path.abspath(self.images_dir)
+            "images_dir": os.path.abspath(self.images_dir),
+            "images": self.image_pipeline.stats(),
+            "spots": self.occupancy.counts(),
+            "liveness": self.liveness_stats(),
+            "tls": self.tls_info(),
+            "log": self.sensor_log.stats(),
+            "analytics": self.analytics.summary(),
+            "ota": self.ota_status(),
+            "postmortems": self.postmortems.summary(),
+            "raw": self.raw_history.stats(),
+            "health": self.health.summary(),
+            "gateways": self.gateway_info(),
+            "udp": self.udp_info(),
+            "shard": self.shard_info()
         }
+    
+    def gateway_info(self):
+        with self.gateway_lock:
+            return {str(gid): {"connected": state["connection"] is not None, "leaves": len(state["leaves"]),
+                               "batches": state["batches"], "frames": state["frames"],
+                               "duplicates": state["duplicates"]}
+                    for gid, state in self.gateways.items()}
+    
+    def udp_info(self):
+        if self.udp_socket is None:
+            return None
+        with self.udp_lock:
+            return dict(self.udp_stats, port=self.udp_port, devices=len(self.udp_spots))
+    
+    def shard_info(self):
+        return self.router.stats() if self.router is not None else None
+    
+    def tls_info(self):
+        if self.tls_context is None:
+            return None
+        with self.tls_lock:
+            return dict(self.tls_stats)
+    
+    def liveness_stats(self):
+        stats = self.occupancy.liveness()
+        stats["heartbeats"] = self.heartbeats_received
+        return stats
 
 def main():
     """Función principal"""
+    parser = argparse.ArgumentParser(description="Servidor de Parqueo ESP32")
+    parser.add_argument("--host", default='0.0.0.0', help="Interfaz de escucha (por defecto todas)")
+    parser.add_argument("--port", type=int, default=8080, help="Puerto del servidor")
+    parser.add_argument("--ack-events", action="store_true",
+                        help="Confirmar cada evento con EVT <timestamp> (medición de latencia)")
+    parser.add_argument("--quiet", action="store_true", help="No imprimir cada evento recibido")
+    parser.add_argument("--image-workers", type=int, default=4,
+                        help="Hilos para decodificar, validar y guardar imágenes")
+    parser.add_argument("--image-queue", type=int, default=64,
+                        help="Imágenes en espera antes de responder 'busy'")
+    parser.add_argument("--no-fsync", action="store_true",
+                        help="No sincronizar imágenes a disco (pruebas de carga)")
+    parser.add_argument("--http-port", type=int, default=8081,
+                        help="Puerto HTTP de consultas y suscripción SSE (0 = desactivado)")
+    parser.add_argument("--stale-after", type=float, default=900.0,
+                        help="Segundos sin datos para marcar un espacio como stale")
+    parser.add_argument("--tls-cert", help="Certificado PEM del servidor: activa TLS (ver README_SERVER.md)")
+    parser.add_argument("--tls-key", help="Clave privada PEM del certificado")
+    parser.add_argument("--log-max-mb", type=float, default=64.0,
+                        help="Tamaño del log activo antes de rotarlo y comprimirlo")
+    parser.add_argument("--log-max-age", type=float, default=24.0,
+                        help="Horas antes de rotar el log aunque no llegue al tamaño")
+    parser.add_argument("--log-codec", choices=["gzip", "zstd"], default="gzip",
+                        help="Compresión de los segmentos rotados (zstd requiere zstandard)")
+    parser.add_argument("--log-keep", type=int, default=None,
+                        help="Segmentos comprimidos a conservar (por defecto todos)")
+    parser.add_argument("--firmware-dir", default="firmware",
+                        help="Imágenes .bin y parches para COMMAND:OTA (ver README_SERVER.md)")
+    parser.add_argument("--analytics-file", default="parking_analytics.json",
+                        help="Acumulados de estadía y utilización (se cargan al arrancar)")
+    parser.add_argument("--postmortem-dir", default="postmortems",
+                        help="Informes de reinicio de los dispositivos (ver postmortem_store.py)")
+    parser.add_argument("--raw-dir", default="raw_history",
+                        help="Serie cruda de los dispositivos con raw=<ms> (ver raw_stream.py)")
+    parser.add_argument("--udp-port", type=int, default=None,
+                        help="Puerto de la telemetría UDP (por defecto el mismo que --port)")
+    parser.add_argument("--no-udp", action="store_true", help="No escuchar telemetría UDP")
+    parser.add_argument("--workers", type=int, default=0,
+                        help="Procesos de ingesta en el mismo puerto (ver sharded_ingest.py; 0 = uno solo)")
+    args = parser.parse_args()
+    
+    tls_context = None
+    if args.tls_cert:
+        tls_context = make_tls_context(args.tls_cert, args.tls_key)
+    
     print("🚗 Servidor de Parqueo ESP32")
     print("=" * 30)
     
-    # Configuración del servidor
-    HOST = '0.0.0.0'  # Escuchar en todas las interfaces
-    PORT = 8080       # Puerto del servidor
+    log_options = {"max_bytes": int(args.log_max_mb * (1 << 20)), "max_age": args.log_max_age * 3600.0,
+                   "codec": args.log_codec, "retention": args.log_keep}
+    options = {"ack_events": args.ack_events, "quiet": args.quiet,
+               "image_workers": args.image_workers, "image_queue": args.image_queue,
+               "fsync_images": not args.no_fsync, "stale_after": args.stale_after,
+               "firmware_dir": args.firmware_dir, "postmortem_dir": args.postmortem_dir, "raw_dir": args.raw_dir}
+    udp_port = None if args.no_udp else (args.udp_port if args.udp_port is not None else args.port)
+    
+    if args.workers > 0:
+        if tls_context is not None:
+            print("❌ --workers no admite TLS: la sesión no se puede pasar entre procesos")
+            return
+        from sharded_ingest import ShardedIngest
+        ingest = ShardedIngest(args.workers, args.host, args.port, http_port=args.http_port or None,
+                               udp_port=udp_port, log_path="parking_sensor.log", log_options=log_options,
+                               analytics_path=args.analytics_file, **options)
+        try:
+            ingest.run()
+        except (OSError, ValueError) as e:
+            print(f"❌ Error iniciando workers: {e}")
+        return
     
     # Crear e iniciar servidor
-    server = ParkingServer(HOST, PORT)
+    server = ParkingServer(args.host, args.port, http_port=args.http_port or None, tls_context=tls_context,
+                           sensor_log=SensorLog("parking_sensor.log", **log_options),
+                           analytics_path=args.analytics_file, udp_port=udp_port, **options)
     
     try:
         server.start_server()
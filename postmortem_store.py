@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+Informes postmortem de los ESP32 (lib/Postmortem), guardados por dispositivo
+
+Tras un reinicio en caliente (watchdog, brownout, pánico, ESP.restart()) el
+dispositivo envía al conectar una línea {"postmortem":true,...} con el
+resumen del arranque anterior y los eventos que quedaron en su RAM RTC. El
+servidor la guarda y responde "PMK <seq>"; sin esa respuesta el dispositivo
+la reenvía en la conexión siguiente, con los eventos nuevos agregados. Un
+informe con el mismo número de arranque que el anterior lo reemplaza.
+
+    postmortems/<parkingId>.jsonl   una línea por informe, con "received"
+                                    (hora del servidor) agregada
+
+Se conservan los últimos `keep` informes de cada dispositivo.
+
+Uso:
+    python postmortem_store.py show 3            # Últimos informes del parqueo 3
+    python postmortem_store.py show 3 --count 1 --json
+    python postmortem_store.py summary           # Reinicios por causa y dispositivo
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+import threading
+import time
+
+SAFE_ID = re.compile(r"^[A-Za-z0-9_-]{1,32}$")
+
+
+class PostmortemStore:
+    """Informes por dispositivo en archivos JSONL; seguro entre hilos"""
+
+    def __init__(self, directory="postmortems", keep=200):
+        self.directory = directory
+        self.keep = keep
+        self.lock = threading.Lock()
+        self.counts = {}      # parkingId → informes en su archivo
+        self.last_boot = {}   # parkingId → número de arranque del último informe
+        os.makedirs(directory, exist_ok=True)
+        for name in os.listdir(directory):
+            if name.endswith(".jsonl"):
+                self._load(name[:-len(".jsonl")])
+
+    def path(self, parking_id):
+        key = str(parking_id)
+        if not SAFE_ID.match(key):
+            raise ValueError(f"parkingId inválido: {parking_id!r}")
+        return os.path.join(self.directory, key + ".jsonl")
+
+    def _load(self, key):
+        reports = self._read(key)
+        self.counts[key] = len(reports)
+        if reports:
+            self.last_boot[key] = reports[-1].get("boot")
+
+    def _read(self, key):
+        reports = []
+        try:
+            with open(self.path(key), "r", encoding="utf-8") as f:
+                for line in f:
+                    try:
+                        reports.append(json.loads(line))
+                    except json.JSONDecodeError:
+                        continue    # Línea cortada por un corte abrupto
+        except (OSError, ValueError):
+            pass
+        return reports
+
+    def _rewrite(self, key, reports):
+        path = self.path(key)
+        temp = path + ".tmp"
+        with open(temp, "w", encoding="utf-8") as f:
+            for item in reports:
+                f.write(json.dumps(item, separators=(",", ":")) + "\n")
+        os.replace(temp, path)
+        self.counts[key] = len(reports)
+
+    def add(self, parking_id, report, received=None):
+        """Guardar un informe; False si reemplazó al reenvío del anterior"""
+        key = str(parking_id)
+        path = self.path(key)
+        entry = dict(report)
+        entry["received"] = time.time() if received is None else received
+        boot = report.get("boot")
+        with self.lock:
+            if key in self.last_boot and self.last_boot[key] == boot:
+                reports = self._read(key)
+                self._rewrite(key, reports[:-1] + [entry])
+                return False
+            with open(path, "a", encoding="utf-8") as f:
+                f.write(json.dumps(entry, separators=(",", ":")) + "\n")
+            self.last_boot[key] = boot
+            self.counts[key] = self.counts.get(key, 0) + 1
+            # Recortar con holgura para no reescribir el archivo en cada informe
+            if self.counts[key] > self.keep * 2:
+                self._rewrite(key, self._read(key)[-self.keep:])
+        return True
+
+    def latest(self, parking_id, count=10):
+        """Los últimos informes de un dispositivo, del más nuevo al más viejo"""
+        with self.lock:
+            reports = self._read(str(parking_id))
+        return list(reversed(reports[-self.keep:]))[:count]
+
+    def summary(self):
+        """Por dispositivo: informes guardados, último reinicio y reinicios por causa"""
+        with self.lock:
+            keys = sorted(self.counts)
+        devices = {}
+        for key in keys:
+            reports = self.latest(key, self.keep)
+            if not reports:
+                continue
+            causes = {}
+            for report in reports:
+                cause = report.get("reset", "unknown")
+                causes[cause] = causes.get(cause, 0) + 1
+            last = reports[0]
+            devices[key] = {
+                "reports": len(reports),
+                "last_reset": last.get("reset"),
+                "last_received": last.get("received"),
+                "last_uptime": (last.get("previous") or {}).get("uptime"),
+                "resets": causes,
+            }
+        return devices
+
+
+def describe(report):
+    """Una línea legible por informe"""
+    previous = report.get("previous") or {}
+    when = time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(report.get("received", 0)))
+    text = f"{when}  arranque #{report.get('boot')}  reinicio por {report.get('reset')}"
+    if previous:
+        text += (f" tras {previous.get('uptime', 0) / 1000:.0f} s"
+                 f" (heap mínimo {previous.get('heapMin')} B, loop máx {previous.get('loopMax')} ms)")
+    events = report.get("events", [])
+    text += f", {len(events)} evento(s)"
+    if report.get("lost"):
+        text += f", {report['lost']} perdido(s)"
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Informes postmortem de los ESP32")
+    parser.add_argument("--dir", default="postmortems", help="Directorio de informes del servidor")
+    sub = parser.add_subparsers(dest="command", required=True)
+    show = sub.add_parser("show", help="Últimos informes de un dispositivo")
+    show.add_argument("parking_id")
+    show.add_argument("--count", type=int, default=10)
+    show.add_argument("--json", action="store_true", help="Informes completos en JSON")
+    sub.add_parser("summary", help="Reinicios por causa y dispositivo")
+    args = parser.parse_args()
+
+    store = PostmortemStore(args.dir)
+    if args.command == "summary":
+        json.dump(store.summary(), sys.stdout, indent=2)
+        print()
+        return
+    for report in store.latest(args.parking_id, args.count):
+        if args.json:
+            print(json.dumps(report))
+            continue
+        print(describe(report))
+        for seq, boot, ms, name, value in report.get("events", []):
+            print(f"    #{seq:<6} arranque {boot:<3} {ms / 1000:10.1f} s  {name:<10} {value}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+Serie cruda de distancias (lib/ParkingSensor/RawStream.h), guardada por dispositivo
+
+Con la serie cruda activada (RAW_STREAM_MS en src/main.cpp o
+COMMAND:CONFIG <id> raw=<ms>) el dispositivo envía cada medición, también
+las fallidas, en bloques "RAW <base64>". Cada bloque trae el número de
+bloque, el ms de la primera medición y por cada medición dos varint con
+zigzag: la variación del intervalo y la de los milímetros.
+
+    raw_history/<parkingId>.csv   "hora,ms,distancia" por medición; la hora
+                                  (del servidor, en s) se estima desde la
+                                  llegada del bloque y la distancia (cm)
+                                  queda vacía si la medición falló
+
+Sirve para ajustar umbrales, diagnosticar montajes y entrenar modelos con
+lo que el sensor ve entre cambios de estado.
+
+Uso:
+    python raw_stream.py show 3                  # Todas las mediciones del parqueo 3
+    python raw_stream.py show 3 --since "2025-09-05 11:00"
+    python raw_stream.py stats                   # Mediciones y bloques por dispositivo
+"""
+
+import argparse
+import base64
+import binascii
+import os
+import re
+import struct
+import sys
+import threading
+import time
+from datetime import datetime
+
+RAW_VERSION = 1
+RAW_HEADER = struct.Struct("<BHIB")      # versión, bloque, ms, cantidad
+SAFE_ID = re.compile(r"^[A-Za-z0-9_-]{1,32}$")
+TIME_FORMAT = "%Y-%m-%d %H:%M:%S"
+
+
+def _varint(data, offset):
+    value = shift = 0
+    while offset < len(data) and shift < 35:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, offset
+        shift += 7
+    raise ValueError("varint cortado")
+
+
+def _unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_block(data):
+    """Bloque binario → (número de bloque, [(ms, mm), ...]); mm 0 = fallida"""
+    if len(data) < RAW_HEADER.size:
+        raise ValueError("bloque corto")
+    version, block_seq, at, count = RAW_HEADER.unpack_from(data)
+    if version != RAW_VERSION:
+        raise ValueError(f"versión desconocida: {version}")
+    offset = RAW_HEADER.size
+    interval = value = 0
+    readings = []
+    for _ in range(count):
+        d_interval, offset = _varint(data, offset)
+        d_value, offset = _varint(data, offset)
+        interval += _unzigzag(d_interval)
+        value += _unzigzag(d_value)
+        if not 0 <= value <= 0xFFFF:
+            raise ValueError("distancia fuera de rango")
+        at = (at + interval) & 0xFFFFFFFF
+        readings.append((at, value))
+    if offset != len(data):
+        raise ValueError("bytes sobrantes")
+    return block_seq, readings
+
+
+def encode_block(block_seq, readings):
+    """Lo mismo que RawStream::build() (pruebas y comparaciones de tamaño)"""
+    def varint(value):
+        out = bytearray()
+        while value >= 0x80:
+            out.append(value & 0x7F | 0x80)
+            value >>= 7
+        out.append(value)
+        return out
+
+    def zigzag(value):
+        return value << 1 if value >= 0 else (-value << 1) - 1
+
+    body = bytearray()
+    last_ms = last_interval = last_mm = 0
+    for i, (ms, mm) in enumerate(readings):
+        interval = 0 if i == 0 else ms - last_ms
+        body += varint(zigzag(interval - last_interval))
+        body += varint(zigzag(mm - last_mm))
+        last_ms, last_interval, last_mm = ms, interval, mm
+    first = readings[0][0] & 0xFFFFFFFF if readings else 0
+    return RAW_HEADER.pack(RAW_VERSION, block_seq & 0xFFFF, first, len(readings)) + bytes(body)
+
+
+def parse_line(raw):
+    """b"RAW <base64>" → bloque binario"""
+    try:
+        return base64.b64decode(raw[4:].strip(), validate=True)
+    except (binascii.Error, ValueError) as e:
+        raise ValueError(f"base64 inválido: {e}")
+
+
+class RawHistory:
+    """Mediciones crudas por dispositivo en archivos CSV; seguro entre hilos"""
+
+    def __init__(self, directory="raw_history", clock=time.time):
+        self.directory = directory
+        self.clock = clock
+        self.lock = threading.Lock()
+        self.last_block = {}    # parkingId → último número de bloque
+        self.totals = {"blocks": 0, "readings": 0, "failed": 0, "lost_blocks": 0, "invalid": 0,
+                       "bytes": 0}
+
+    def path(self, parking_id):
+        key = str(parking_id)
+        if not SAFE_ID.match(key):
+            raise ValueError(f"parkingId inválido: {parking_id!r}")
+        return os.path.join(self.directory, key + ".csv")
+
+    def add_line(self, parking_id, raw, now=None):
+        """Una línea RAW del dispositivo; retorna las mediciones guardadas"""
+        try:
+            data = parse_line(raw)
+        except ValueError:
+            with self.lock:
+                self.totals["invalid"] += 1
+            raise
+        return self.add_block(parking_id, data, now, wire_bytes=len(raw) + 2)
+
+    def add_block(self, parking_id, data, now=None, wire_bytes=None):
+        try:
+            block_seq, readings = decode_block(data)
+        except ValueError:
+            with self.lock:
+                self.totals["invalid"] += 1
+            raise
+        now = self.clock() if now is None else now
+        path = self.path(parking_id)
+        # La última medición acaba de medirse: las anteriores, hacia atrás
+        last_ms = readings[-1][0] if readings else 0
+        lines = []
+        failed = 0
+        for ms, mm in readings:
+            wall = now - ((last_ms - ms) & 0xFFFFFFFF) / 1000.0
+            if mm == 0:
+                failed += 1
+            lines.append(f"{wall:.3f},{ms},{mm / 10.0:.1f}\n" if mm else f"{wall:.3f},{ms},\n")
+
+        with self.lock:
+            previous = self.last_block.get(parking_id)
+            if previous is not None:
+                gap = (block_seq - previous - 1) & 0xFFFF
+                if gap < 0x8000:
+                    self.totals["lost_blocks"] += gap
+            self.last_block[parking_id] = block_seq
+            self.totals["blocks"] += 1
+            self.totals["readings"] += len(readings)
+            self.totals["failed"] += failed
+            self.totals["bytes"] += wire_bytes if wire_bytes is not None else len(data)
+            os.makedirs(self.directory, exist_ok=True)
+            with open(path, "a", encoding="utf-8") as f:
+                f.writelines(lines)
+        return len(readings)
+
+    def read(self, parking_id, since=None, until=None):
+        """[(hora, ms, distancia o None), ...] del dispositivo"""
+        readings = []
+        try:
+            with open(self.path(parking_id), "r", encoding="utf-8") as f:
+                for line in f:
+                    parts = line.rstrip("\n").split(",")
+                    if len(parts) != 3:
+                        continue    # Línea cortada por un corte abrupto
+                    try:
+                        wall = float(parts[0])
+                        reading = (wall, int(parts[1]), float(parts[2]) if parts[2] else None)
+                    except ValueError:
+                        continue
+                    if (since is None or wall >= since) and (until is None or wall < until):
+                        readings.append(reading)
+        except OSError:
+            pass
+        return readings
+
+    def stats(self):
+        with self.lock:
+            stats = dict(self.totals, devices=len(self.last_block))
+        stats["bytes_per_reading"] = round(stats["bytes"] / stats["readings"], 2) if stats["readings"] else None
+        return stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Serie cruda de distancias por dispositivo")
+    parser.add_argument("--dir", default="raw_history")
+    sub = parser.add_subparsers(dest="command", required=True)
+    show = sub.add_parser("show", help="Mediciones de un dispositivo en CSV")
+    show.add_argument("parking_id")
+    show.add_argument("--since", help="AAAA-MM-DD HH:MM (hora local)")
+    show.add_argument("--until")
+    sub.add_parser("stats", help="Mediciones por dispositivo")
+    args = parser.parse_args()
+
+    history = RawHistory(args.dir)
+    if args.command == "show":
+        def parse_time(text):
+            return datetime.fromisoformat(text).timestamp() if text else None
+        try:
+            readings = history.read(args.parking_id, parse_time(args.since), parse_time(args.until))
+        except ValueError as e:
+            print(f"❌ {e}", file=sys.stderr)
+            return 1
+        print("hora,ms,distancia")
+        for wall, ms, distance in readings:
+            print(f"{time.strftime(TIME_FORMAT, time.localtime(wall))},{ms},"
+                  f"{'' if distance is None else distance}")
+        return 0
+
+    if not os.path.isdir(args.dir):
+        print(f"📭 Sin serie cruda en {args.dir}")
+        return 0
+    print(f"{'parqueo':>8} {'mediciones':>11} {'fallidas':>9} {'desde':>20} {'hasta':>20}")
+    for name in sorted(os.listdir(args.dir)):
+        if not name.endswith(".csv"):
+            continue
+        readings = history.read(name[:-len(".csv")])
+        if not readings:
+            continue
+        failed = sum(1 for reading in readings if reading[2] is None)
+        print(f"{name[:-4]:>8} {len(readings):>11} {failed:>9} "
+              f"{time.strftime(TIME_FORMAT, time.localtime(readings[0][0])):>20} "
+              f"{time.strftime(TIME_FORMAT, time.localtime(readings[-1][0])):>20}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
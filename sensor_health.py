@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+Salud de los sensores ultrasónicos (lib/ParkingSensor/SensorHealth.h) y sus alertas
+
+Cada dispositivo clasifica su sensor con las estadísticas de sus propias
+mediciones (timeouts, lecturas fuera de rango, ruido, saltos, valor
+trabado) y lo reporta:
+
+    HB <seq> <ocupado> <distancia> <válidas> <fallidas> <salud>
+                                    código de salud en cada heartbeat
+    {"health":"blocked","parkingId":3,"timeouts":0.02,"invalid":0.81,...}
+                                    en cada cambio, con las estadísticas
+    trama de hoja / UDP             código en el byte de tipo (GatewayFrame.h)
+
+El monitor levanta una alerta cuando un dispositivo pasa a un estado que no
+es "ok" y la cierra cuando vuelve. Guarda las últimas `keep` alertas y
+cambios; no persiste nada: tras un reinicio del servidor el dispositivo
+vuelve a avisar al reconectar y el heartbeat trae el código.
+"""
+
+import collections
+import threading
+import time
+
+# Índice = código del heartbeat y de las tramas (SensorHealthState)
+HEALTH_STATES = ("unknown", "ok", "degraded", "misaligned", "blocked", "stuck", "failing")
+
+# Para los mensajes del servidor
+HEALTH_LABELS = {
+    "degraded": "con fallas frecuentes",
+    "misaligned": "desalineado o con ecos erráticos",
+    "blocked": "tapado",
+    "stuck": "trabado en un valor",
+    "failing": "sin eco (desconectado o dañado)",
+}
+
+# Estadísticas del mensaje JSON que se guardan con la alerta
+HEALTH_FIELDS = ("timeouts", "invalid", "near", "far", "jumps", "sd", "stuck")
+
+
+def health_name(value):
+    """Código (int o texto del HB) o nombre → nombre; None si no es válido"""
+    if isinstance(value, str) and value in HEALTH_STATES:
+        return value
+    try:
+        code = int(value)
+    except (TypeError, ValueError):
+        return None
+    return HEALTH_STATES[code] if 0 <= code < len(HEALTH_STATES) else None
+
+
+class HealthMonitor:
+    """Estado de salud por dispositivo y alertas; seguro entre hilos"""
+
+    def __init__(self, keep=200, clock=time.time):
+        self.clock = clock
+        self.lock = threading.Lock()
+        self.devices = {}     # parkingId → {"health", "since", "stats"}
+        self.history = collections.deque(maxlen=keep)
+        self.raised = 0
+
+    def update(self, parking_id, health, stats=None):
+        """Aplicar un reporte; retorna la alerta o el cierre si cambió, None si no
+
+        "unknown" (calentando, o hojas sin salud) no abre ni cierra alertas.
+        """
+        name = health_name(health)
+        if name is None or name == "unknown" or parking_id is None:
+            return None
+        key = str(parking_id)
+        now = self.clock()
+        details = {field: stats[field] for field in HEALTH_FIELDS
+                   if isinstance(stats, dict) and field in stats}
+        with self.lock:
+            device = self.devices.get(key)
+            previous = device["health"] if device is not None else "ok"
+            if device is not None and device["health"] == name:
+                if details:
+                    device["stats"] = details
+                return None
+            self.devices[key] = {"health": name, "since": now, "stats": details}
+            if name == "ok" and device is None:
+                return None   # Primer reporte en buen estado: nada que avisar
+            entry = {"parkingId": parking_id, "health": name, "previous": previous, "time": now}
+            entry.update(details)
+            if name != "ok":
+                self.raised += 1
+            self.history.append(entry)
+        return entry
+
+    def alerts(self):
+        """Dispositivos que hoy no están en "ok", con desde cuándo"""
+        with self.lock:
+            return {key: dict(device) for key, device in self.devices.items()
+                    if device["health"] != "ok"}
+
+    def device(self, parking_id):
+        with self.lock:
+            device = self.devices.get(str(parking_id))
+            return dict(device) if device is not None else None
+
+    def recent(self, count=20, parking_id=None):
+        with self.lock:
+            entries = [entry for entry in self.history
+                       if parking_id is None or str(entry["parkingId"]) == str(parking_id)]
+        return entries[-count:] if count > 0 else []
+
+    def summary(self):
+        with self.lock:
+            states = collections.Counter(device["health"] for device in self.devices.values())
+            return {"devices": len(self.devices), "states": dict(states),
+                    "active": sum(count for name, count in states.items() if name != "ok"),
+                    "alerts": self.raised}
+
+
+def describe_health(entry):
+    """Texto de una alerta o cierre para el log del servidor"""
+    if entry["health"] == "ok":
+        return (f"✅ Parqueo {entry['parkingId']}: sensor recuperado "
+                f"(estaba {HEALTH_LABELS.get(entry['previous'], entry['previous'])})")
+    detail = []
+    if "timeouts" in entry:
+        detail.append(f"timeouts {entry['timeouts'] * 100:.0f}%")
+    if "invalid" in entry:
+        detail.append(f"inválidas {entry['invalid'] * 100:.0f}%")
+    if "sd" in entry:
+        detail.append(f"desvío {entry['sd']:.1f} cm")
+    return (f"🚨 Parqueo {entry['parkingId']}: sensor {HEALTH_LABELS.get(entry['health'], entry['health'])}"
+            + (f" ({', '.join(detail)})" if detail else ""))
@@ -0,0 +1,485 @@
+#!/usr/bin/env python3
+"""
+Log de eventos del servidor con rotación y compresión en segundo plano
+
+    write() desde los hilos de conexión
+      → buffer en memoria, vaciado por tamaño o cada flush_interval s
+      → parking_sensor.log, abierto mientras vive el servidor
+      → rotación por tamaño o antigüedad: parking_sensor.log.000001
+      → hilo de compresión: parking_sensor.log.000001.gz (o .zst) por bloques
+        independientes + índice parking_sensor.log.000001.idx
+
+El formato de cada línea no cambia ("fecha | (ip, puerto) | json"), así que
+el archivo activo se sigue leyendo igual que antes. El índice (JSON) guarda
+el rango de fechas, los parkingId presentes y, por cada bloque comprimido,
+su posición en el archivo, la primera línea y su fecha: read_lines() salta
+segmentos y bloques fuera del rango pedido sin descomprimirlos.
+
+Un segmento rotado sigue en texto plano hasta que termina su compresión; si
+el servidor se detiene antes, se comprime al volver a arrancar. Un corte
+abrupto pierde como mucho lo que quedaba en el buffer (flush_interval).
+
+zstd requiere el paquete zstandard (opcional); gzip viene con Python.
+
+Uso:
+    python sensor_log.py cat parking_sensor.log > completo.log
+    python sensor_log.py cat parking_sensor.log --since "2025-09-05 11:00" --parking-id 3
+    python sensor_log.py stats parking_sensor.log
+"""
+
+import argparse
+import glob
+import gzip
+import io
+import json
+import os
+import queue
+import re
+import sys
+import threading
+import time
+
+try:
+    import zstandard
+except ImportError:
+    zstandard = None
+
+CODEC_SUFFIX = {"gzip": ".gz", "zstd": ".zst"}
+SEGMENT_NAME = re.compile(r"\.(\d{6})(\.gz|\.zst)?$")
+PARKING_ID = re.compile(rb'"parkingId": ?(\d+)')
+TIME_FORMAT = "%Y-%m-%d %H:%M:%S"
+TIME_LENGTH = 19
+
+
+def format_line(when, client_address, data):
+    return f"{time.strftime(TIME_FORMAT, time.localtime(when))} | {client_address} | {json.dumps(data)}\n"
+
+
+class SensorLog:
+    """Escritor del log con rotación; seguro entre hilos"""
+
+    def __init__(self, path="parking_sensor.log", max_bytes=64 << 20, max_age=24 * 3600.0,
+                 codec="gzip", level=None, flush_bytes=64 << 10, flush_interval=1.0,
+                 block_bytes=1 << 20, retention=None, clock=time.time):
+        if codec not in CODEC_SUFFIX:
+            raise ValueError(f"Códec desconocido: {codec}")
+        if codec == "zstd" and zstandard is None:
+            raise ValueError("zstd requiere el paquete zstandard (pip install zstandard)")
+        self.path = os.path.abspath(path)
+        self.max_bytes = max_bytes
+        self.max_age = max_age
+        self.codec = codec
+        self.level = level if level is not None else (6 if codec == "gzip" else 3)
+        self.flush_bytes = flush_bytes
+        self.flush_interval = flush_interval
+        self.block_bytes = block_bytes
+        self.retention = retention      # Segmentos comprimidos a conservar (None = todos)
+        self.clock = clock
+
+        self.lock = threading.Lock()
+        self.file = None
+        self.pending = []
+        self.pending_bytes = 0
+        self.segment_bytes = 0
+        self.segment_started = None
+        self.next_seq = 1
+        self.running = False
+        self.closed = False
+        self.flusher = None
+        self.compressor = None
+        self.compress_queue = queue.Queue()
+
+        # Fecha formateada del último segundo: la mayoría de los eventos la reutilizan
+        self.cached_second = None
+        self.cached_time = ""
+
+        self.lines_written = 0
+        self.bytes_written = 0
+        self.rotations = 0
+        self.segments_compressed = 0
+
+    # ---- Escritura ----
+
+    def open(self):
+        """Abrir el archivo activo y arrancar los hilos (idempotente)"""
+        with self.lock:
+            self._open_locked()
+
+    def _open_locked(self):
+        if self.running or self.closed:
+            return
+        directory = os.path.dirname(os.path.abspath(self.path))
+        os.makedirs(directory, exist_ok=True)
+        existing = list_segments(self.path)
+        if existing:
+            self.next_seq = existing[-1][0] + 1
+        self.file = open(self.path, "ab", buffering=0)
+        self.segment_bytes = self.file.tell()
+        self.segment_started = self._file_started() if self.segment_bytes else None
+        self.running = True
+
+        self.flusher = threading.Thread(target=self._flush_loop, name="log-flush", daemon=True)
+        self.flusher.start()
+        self.compressor = threading.Thread(target=self._compress_loop, name="log-compress", daemon=True)
+        self.compressor.start()
+
+        # Segmentos rotados que no alcanzaron a comprimirse antes de detenerse
+        for seq, raw, compressed in existing:
+            if raw is not None:
+                self.compress_queue.put(raw)
+
+    def _file_started(self):
+        # La primera línea del archivo activo fija su antigüedad al reabrirlo
+        with open(self.path, "rb") as f:
+            first = f.readline()
+        try:
+            return time.mktime(time.strptime(first[:TIME_LENGTH].decode("ascii"), TIME_FORMAT))
+        except (ValueError, UnicodeDecodeError):
+            return self.clock()
+
+    def write(self, client_address, data, now=None):
+        """Registrar un evento con la fecha actual"""
+        now = self.clock() if now is None else now
+        second = int(now)
+        with self.lock:
+            if second != self.cached_second:
+                self.cached_second = second
+                self.cached_time = time.strftime(TIME_FORMAT, time.localtime(second))
+            line = f"{self.cached_time} | {client_address} | {json.dumps(data)}\n".encode("utf-8")
+            self._append_locked(line, now)
+
+    def write_line(self, line, now=None):
+        """Registrar una línea ya formateada (terminada en '\\n')"""
+        now = self.clock() if now is None else now
+        with self.lock:
+            self._append_locked(line.encode("utf-8") if isinstance(line, str) else line, now)
+
+    def _append_locked(self, line, now):
+        self._open_locked()
+        if self.closed:
+            return
+        if self.segment_started is None:
+            self.segment_started = now
+        elif (self.segment_bytes + self.pending_bytes + len(line) > self.max_bytes or
+              now - self.segment_started >= self.max_age) and self.segment_bytes + self.pending_bytes > 0:
+            self._rotate_locked(now)
+        self.pending.append(line)
+        self.pending_bytes += len(line)
+        self.lines_written += 1
+        if self.pending_bytes >= self.flush_bytes:
+            self._flush_locked()
+
+    def _flush_locked(self):
+        if not self.pending:
+            return
+        data = b"".join(self.pending)
+        self.file.write(data)
+        self.segment_bytes += len(data)
+        self.bytes_written += len(data)
+        self.pending = []
+        self.pending_bytes = 0
+
+    def flush(self):
+        with self.lock:
+            if self.file is not None:
+                self._flush_locked()
+
+    def rotate(self):
+        """Cerrar el segmento activo aunque no haya llegado al límite"""
+        with self.lock:
+            if self.file is not None and self.segment_bytes + self.pending_bytes > 0:
+                self._rotate_locked(self.clock())
+
+    def _rotate_locked(self, now):
+        self._flush_locked()
+        self.file.close()
+        rotated = f"{self.path}.{self.next_seq:06d}"
+        self.next_seq += 1
+        os.replace(self.path, rotated)
+        self.file = open(self.path, "ab", buffering=0)
+        self.segment_bytes = 0
+        self.segment_started = now
+        self.rotations += 1
+        self.compress_queue.put(rotated)
+
+    def _flush_loop(self):
+        while True:
+            time.sleep(self.flush_interval)
+            with self.lock:
+                if not self.running:
+                    return
+                self._flush_locked()
+                # Rotación por antigüedad aunque no lleguen eventos
+                if (self.segment_started is not None and self.segment_bytes > 0 and
+                        self.clock() - self.segment_started >= self.max_age):
+                    self._rotate_locked(self.clock())
+
+    def close(self, wait=True):
+        """Vaciar, cerrar y (si wait) esperar la compresión pendiente
+
+        Las escrituras posteriores (conexiones que terminan tarde) se descartan.
+        """
+        with self.lock:
+            self.closed = True
+            if not self.running:
+                return
+            self._flush_locked()
+            self.file.close()
+            self.file = None
+            self.running = False
+        self.compress_queue.put(None)
+        if wait:
+            self.compressor.join()
+
+    # ---- Compresión ----
+
+    def _compress_loop(self):
+        while True:
+            raw = self.compress_queue.get()
+            if raw is None:
+                return
+            try:
+                compress_segment(raw, self.codec, self.level, self.block_bytes)
+                self.segments_compressed += 1
+                self._apply_retention()
+            except OSError as e:
+                print(f"⚠️ Error comprimiendo {raw}: {e}")
+
+    def _apply_retention(self):
+        if self.retention is None:
+            return
+        compressed = [entry for entry in list_segments(self.path) if entry[1] is None and entry[2]]
+        for seq, raw, path in compressed[:max(0, len(compressed) - self.retention)]:
+            for victim in (path, index_path(path)):
+                try:
+                    os.remove(victim)
+                except FileNotFoundError:
+                    pass
+
+    def stats(self):
+        with self.lock:
+            return {
+                "lines": self.lines_written,
+                "bytes": self.bytes_written + self.pending_bytes,
+                "rotations": self.rotations,
+                "compressed_segments": self.segments_compressed,
+                "pending_compression": self.compress_queue.qsize(),
+                "active_bytes": self.segment_bytes + self.pending_bytes,
+            }
+
+
+# ---- Segmentos e índice ----
+
+def index_path(segment_path):
+    """parking_sensor.log.000001.gz → parking_sensor.log.000001.idx"""
+    return SEGMENT_NAME.sub(lambda m: f".{m.group(1)}.idx", segment_path)
+
+
+def list_segments(path):
+    """[(seq, ruta sin comprimir o None, ruta comprimida o None)] en orden"""
+    found = {}
+    for candidate in glob.glob(glob.escape(path) + ".*"):
+        match = SEGMENT_NAME.search(candidate)
+        if match is None or candidate[:match.start()] != path:
+            continue
+        seq = int(match.group(1))
+        raw, compressed = found.get(seq, (None, None))
+        if match.group(2):
+            compressed = candidate
+        else:
+            raw = candidate
+        found[seq] = (raw, compressed)
+    return [(seq, raw, compressed) for seq, (raw, compressed) in sorted(found.items())]
+
+
+def _compress_block(data, codec, level):
+    if codec == "gzip":
+        # Un miembro gzip por bloque: el archivo completo sigue siendo un .gz válido
+        return gzip.compress(data, compresslevel=level, mtime=0)
+    return zstandard.ZstdCompressor(level=level).compress(data)
+
+
+def compress_segment(raw_path, codec="gzip", level=6, block_bytes=1 << 20):
+    """Comprimir un segmento rotado por bloques y escribir su índice
+
+    El segmento sin comprimir se borra al final: si algo falla antes, queda
+    como autoritativo y se vuelve a comprimir al reiniciar.
+    """
+    target = raw_path + CODEC_SUFFIX[codec]
+    index = {"codec": codec, "lines": 0, "raw_bytes": 0, "compressed_bytes": 0,
+             "first_time": None, "last_time": None, "parking_ids": [], "blocks": []}
+    parking_ids = set()
+    block = []
+    block_size = 0
+    offset = 0
+
+    with open(raw_path, "rb") as source, open(target + ".tmp", "wb") as out:
+        def emit():
+            nonlocal offset, block, block_size
+            compressed = _compress_block(b"".join(block), codec, level)
+            out.write(compressed)
+            offset += len(compressed)
+            block = []
+            block_size = 0
+
+        for line in source:
+            if not block:
+                index["blocks"].append([offset, index["lines"], line[:TIME_LENGTH].decode("ascii", "replace")])
+            block.append(line)
+            block_size += len(line)
+            index["lines"] += 1
+            index["raw_bytes"] += len(line)
+            match = PARKING_ID.search(line)
+            if match:
+                parking_ids.add(int(match.group(1)))
+            if block_size >= block_bytes:
+                emit()
+            last = line
+        if block:
+            emit()
+        out.flush()
+        os.fsync(out.fileno())
+
+    if index["lines"]:
+        index["first_time"] = index["blocks"][0][2]
+        index["last_time"] = last[:TIME_LENGTH].decode("ascii", "replace")
+    index["compressed_bytes"] = offset
+    index["parking_ids"] = sorted(parking_ids)
+
+    os.replace(target + ".tmp", target)
+    with open(index_path(target) + ".tmp", "w", encoding="utf-8") as f:
+        json.dump(index, f)
+    os.replace(index_path(target) + ".tmp", index_path(target))
+    os.remove(raw_path)
+    return target
+
+
+def load_index(segment_path):
+    try:
+        with open(index_path(segment_path), "r", encoding="utf-8") as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+
+# ---- Lectura ----
+
+def _open_compressed(path, offset, codec):
+    f = open(path, "rb")
+    f.seek(offset)
+    if codec == "gzip":
+        return gzip.GzipFile(fileobj=f, mode="rb")
+    if zstandard is None:
+        raise ValueError(f"{path}: zstd requiere el paquete zstandard")
+    return io.BufferedReader(zstandard.ZstdDecompressor().stream_reader(f, read_across_frames=True,
+                                                                        closefd=True))
+
+
+def _filter(lines, since, until, parking_id):
+    since_b = since.encode("ascii") if since else None
+    until_b = until.encode("ascii") if until else None
+    for line in lines:
+        stamp = line[:TIME_LENGTH]
+        if since_b is not None and stamp < since_b:
+            continue
+        if until_b is not None and stamp >= until_b:
+            return
+        if parking_id is not None:
+            match = PARKING_ID.search(line)
+            if match is None or int(match.group(1)) != parking_id:
+                continue
+        yield line
+
+
+def _segment_lines(compressed, since, until, parking_id):
+    index = load_index(compressed)
+    codec = "gzip" if compressed.endswith(".gz") else "zstd"
+    offset = 0
+    if index is not None:
+        if index["lines"] == 0:
+            return
+        if since and index["last_time"] < since[:TIME_LENGTH]:
+            return
+        if until and index["first_time"] >= until:
+            return
+        if parking_id is not None and parking_id not in index["parking_ids"]:
+            return
+        # Empezar en el último bloque que comienza antes de since
+        if since:
+            for block_offset, _, first_time in index["blocks"]:
+                if first_time > since:
+                    break
+                offset = block_offset
+    with _open_compressed(compressed, offset, codec) as stream:
+        yield from _filter(stream, since, until, parking_id)
+
+
+def read_lines(path="parking_sensor.log", since=None, until=None, parking_id=None):
+    """Líneas (bytes, con '\\n') de todos los segmentos y del archivo activo, en orden
+
+    since/until: fechas "AAAA-MM-DD HH:MM:SS" o prefijos ("2025-09-05");
+    since es inclusivo y until exclusivo.
+    """
+    for seq, raw, compressed in list_segments(path):
+        if raw is not None:
+            # Todavía sin comprimir (o compresión interrumpida): es el autoritativo
+            with open(raw, "rb") as f:
+                yield from _filter(f, since, until, parking_id)
+        elif compressed is not None:
+            yield from _segment_lines(compressed, since, until, parking_id)
+    if os.path.exists(path):
+        with open(path, "rb") as f:
+            yield from _filter(f, since, until, parking_id)
+
+
+def disk_usage(path="parking_sensor.log"):
+    """Bytes en disco del archivo activo, los segmentos y sus índices"""
+    total = os.path.getsize(path) if os.path.exists(path) else 0
+    for seq, raw, compressed in list_segments(path):
+        for candidate in (raw, compressed, compressed and index_path(compressed)):
+            if candidate and os.path.exists(candidate):
+                total += os.path.getsize(candidate)
+    return total
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Leer el log rotado y comprimido del servidor")
+    sub = parser.add_subparsers(dest="command", required=True)
+    cat = sub.add_parser("cat", help="Escribir todas las líneas en orden por stdout")
+    cat.add_argument("log", nargs="?", default="parking_sensor.log")
+    cat.add_argument("--since", help="Fecha inicial (inclusive), p. ej. \"2025-09-05 11:00\"")
+    cat.add_argument("--until", help="Fecha final (exclusive)")
+    cat.add_argument("--parking-id", type=int)
+    stats = sub.add_parser("stats", help="Segmentos, líneas y tamaño en disco")
+    stats.add_argument("log", nargs="?", default="parking_sensor.log")
+    args = parser.parse_args()
+
+    if args.command == "cat":
+        out = sys.stdout.buffer
+        try:
+            for line in read_lines(args.log, args.since, args.until, args.parking_id):
+                out.write(line)
+            out.flush()
+        except BrokenPipeError:
+            pass
+        return 0
+
+    segments = list_segments(args.log)
+    raw_bytes = os.path.getsize(args.log) if os.path.exists(args.log) else 0
+    lines = 0
+    for seq, raw, compressed in segments:
+        index = load_index(compressed) if compressed and raw is None else None
+        if index is not None:
+            lines += index["lines"]
+            raw_bytes += index["raw_bytes"]
+        elif raw is not None:
+            raw_bytes += os.path.getsize(raw)
+    on_disk = disk_usage(args.log)
+    print(f"📚 {args.log}: {len(segments)} segmentos rotados, {lines} líneas indexadas")
+    print(f"   Sin comprimir: {raw_bytes / 1e6:.1f} MB, en disco: {on_disk / 1e6:.1f} MB "
+          f"({on_disk / raw_bytes * 100 if raw_bytes else 0:.0f}%)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,571 @@
+#!/usr/bin/env python3
+"""
+Ingesta repartida en varios procesos (parking_server.py --workers N)
+
+Un solo proceso de Python queda limitado por el GIL con cualquier cantidad
+de hilos. Con --workers N se levantan N procesos ParkingServer que escuchan
+el mismo puerto TCP y UDP con SO_REUSEPORT; el kernel reparte las
+conexiones nuevas entre ellos.
+
+El estado de cada espacio (tabla de ocupación, analítica, comandos
+pendientes, OTA) vive en un solo worker, elegido por hashing consistente
+del parkingId (ShardRing). El kernel no sabe de qué espacio es una
+conexión: el worker que la aceptó espera la primera trama con parkingId
+(hello, evento o COMMAND:CONFIG/OTA/POSTMORTEM/HEALTH <id>) y, si el
+espacio es de otro, le pasa el descriptor del socket con lo ya leído
+(SCM_RIGHTS por un socket Unix). Desde ahí la conexión no vuelve a cruzar procesos. Las
+tramas de hojas de un gateway y los datagramas UDP de espacios ajenos se
+reenvían al dueño, que aplica y confirma desde el mismo puerto.
+
+El proceso principal (coordinador) no recibe eventos: arma la vista
+global. Cada worker le reenvía sus cambios de ocupación (el DiffLog ya
+codificado) y responde consultas por un socket de control:
+
+    /spots, /spots/free, /spots/<id>, /events    MergedOccupancy
+    /analytics, /analytics/hourly|daily|spots    MergedAnalytics
+
+con el mismo OccupancyHttpServer que el modo de un proceso. La analítica
+global es la suma de los acumulados de los workers
+(OccupancyAnalytics.merged()), recalculada como mucho una vez por segundo.
+
+Cada worker escribe su propio log y su analítica (parking_sensor.<n>.log,
+parking_analytics.<n>.json). TLS no se admite: la sesión no se puede pasar
+a otro proceso junto con el socket.
+"""
+
+import bisect
+import ctypes
+import hashlib
+import heapq
+import json
+import multiprocessing
+import os
+import signal
+import socket
+import threading
+import time
+
+from occupancy_analytics import OccupancyAnalytics
+from occupancy_state import DiffLog, OccupancyHttpServer, Spot
+from parking_server import UDP_FRAME, UDP_FRAME_MAGIC, ParkingServer
+from sensor_log import SensorLog
+
+# Puntos de cada worker en el anillo: con 64 el más cargado queda a ~15% del promedio
+RING_REPLICAS = 64
+
+# Mensaje más grande entre workers: encabezado y lo leído de la conexión
+# (un recv() de handle_client) o un lote de tramas de un gateway
+HANDOFF_MAX_BYTES = 1 << 18
+
+# Antigüedad máxima de la analítica global antes de volver a sumar los workers
+MERGE_MAX_AGE = 1.0
+
+# Segundos para que un worker abra sus sockets o responda una consulta
+WORKER_TIMEOUT = 10.0
+
+# prctl(2): señal que recibe el proceso cuando muere su padre (solo Linux)
+PR_SET_PDEATHSIG = 1
+
+ADMIN_COMMANDS = (b"COMMAND:CONFIG ", b"COMMAND:OTA ", b"COMMAND:POSTMORTEM ", b"COMMAND:HEALTH ")
+
+
+def ring_hash(key):
+    return int.from_bytes(hashlib.blake2b(str(key).encode("utf-8"), digest_size=8).digest(), "big")
+
+
+class ShardRing:
+    """Hashing consistente parkingId → worker
+
+    Cada worker ocupa RING_REPLICAS puntos del anillo y un parkingId es del
+    primero que sigue a su hash. Al pasar de N a N+1 workers solo ~1/(N+1)
+    de los espacios cambia de dueño, y todos hacia el worker nuevo. Los
+    parkingId se comparan como texto: 7 (JSON) y "7" (comando) son el mismo.
+    """
+
+    def __init__(self, shards, replicas=RING_REPLICAS):
+        points = sorted((ring_hash(f"{shard}#{replica}"), shard)
+                        for shard in range(shards) for replica in range(replicas))
+        self.shards = shards
+        self.hashes = [point for point, _ in points]
+        self.owners = [shard for _, shard in points]
+
+    def owner(self, parking_id):
+        index = bisect.bisect(self.hashes, ring_hash(parking_id))
+        return self.owners[index % len(self.owners)]
+
+
+def message_parking_id(raw):
+    """parkingId de una trama que ata la conexión a un espacio, o None
+
+    Sin parkingId quedan en el worker que la aceptó: gateways (sus hojas se
+    reparten trama por trama), imágenes, heartbeats sin hello y comandos
+    globales (STATUS, DEVICES, CONFIG *).
+    """
+    if raw.startswith(b"COMMAND:"):
+        for prefix in ADMIN_COMMANDS:
+            if raw.startswith(prefix):
+                target = raw[len(prefix):].split(None, 1)
+                if target and target[0] != b"*":
+                    return target[0].decode("utf-8", "replace")
+        return None
+    if not raw.lstrip().startswith(b"{"):
+        return None
+    try:
+        data = json.loads(raw)
+    except ValueError:
+        return None
+    if not isinstance(data, dict) or "gateway" in data:
+        return None
+    return data.get("parkingId")
+
+
+def shard_path(path, shard):
+    """parking_sensor.log → parking_sensor.<shard>.log"""
+    root, extension = os.path.splitext(path)
+    return f"{root}.{shard}{extension}"
+
+
+class ShardRouter:
+    """Lado de un worker: de quién es cada parkingId y el paso de conexiones y tramas
+
+    inboxes[n] es el extremo de envío del socket SEQPACKET del worker n;
+    cada mensaje es un encabezado JSON, '\\n' y los bytes que acompañan.
+    """
+
+    def __init__(self, shard, ring, inboxes, inbox):
+        self.shard = shard
+        self.ring = ring
+        self.inboxes = inboxes
+        self.inbox = inbox            # Extremo de recepción de este worker
+        self.server = None
+        self.counters = {"handed_off": 0, "received": 0, "frames_out": 0, "frames_in": 0,
+                         "datagrams_out": 0, "datagrams_in": 0}
+        self.lock = threading.Lock()
+
+    def start(self, server):
+        self.server = server
+        threading.Thread(target=self.receive_loop, daemon=True).start()
+
+    def is_local(self, parking_id):
+        return self.ring.owner(parking_id) == self.shard
+
+    def owner_of_message(self, raw):
+        parking_id = message_parking_id(raw)
+        return None if parking_id is None else self.ring.owner(parking_id)
+
+    def count(self, name, amount=1):
+        with self.lock:
+            self.counters[name] += amount
+
+    def send(self, owner, header, payload=b"", fds=()):
+        message = json.dumps(header).encode("utf-8") + b"\n" + payload
+        socket.send_fds(self.inboxes[owner], [message], list(fds))
+
+    def hand_off(self, owner, client_socket, address, pending):
+        """Pasar la conexión al worker dueño; quien llama solo cierra su copia"""
+        self.send(owner, {"kind": "conn", "address": list(address)}, pending, [client_socket.fileno()])
+        self.count("handed_off")
+
+    def forward_frames(self, frames, address, gateway_id, timeout):
+        """Reenviar las tramas de hojas ajenas de un lote; retorna las propias"""
+        local = []
+        remote = {}
+        for frame in frames:
+            owner = self.ring.owner(frame[0]) if isinstance(frame, list) and frame else self.shard
+            if owner == self.shard:
+                local.append(frame)
+            else:
+                remote.setdefault(owner, []).append(frame)
+        for owner, owned in remote.items():
+            self.send(owner, {"kind": "frames", "address": list(address), "gateway": gateway_id,
+                              "timeout": timeout, "frames": owned})
+            self.count("frames_out", len(owned))
+        return local
+
+    def forward_datagram(self, data, address):
+        """Reenviar una trama UDP de un espacio ajeno; False si se atiende aquí"""
+        if len(data) != UDP_FRAME.size or data[0] != UDP_FRAME_MAGIC:
+            return False  # Inválida: la cuenta este worker
+        owner = self.ring.owner(int.from_bytes(data[2:4], "little"))
+        if owner == self.shard:
+            return False
+        self.send(owner, {"kind": "udp", "address": list(address)}, data)
+        self.count("datagrams_out")
+        return True
+
+    def receive_loop(self):
+        server = self.server
+        while True:
+            try:
+                message, fds, _, _ = socket.recv_fds(self.inbox, HANDOFF_MAX_BYTES, 1)
+            except OSError:
+                break
+            if not message:
+                break
+            header, _, payload = message.partition(b"\n")
+            try:
+                header = json.loads(header)
+                address = tuple(header["address"])
+                kind = header["kind"]
+            except (ValueError, KeyError, TypeError):
+                kind = None
+            if kind == "conn" and fds:
+                client = socket.socket(fileno=fds.pop())
+                self.count("received")
+                threading.Thread(target=server.handle_client, args=(client, address, payload),
+                                 daemon=True).start()
+            elif kind == "frames":
+                frames = header["frames"]
+                for parking_id in {frame[0] for frame in frames}:
+                    server.occupancy.set_timeout(parking_id, header["timeout"])
+                for frame in frames:
+                    server.apply_gateway_frame(frame, address, header["gateway"])
+                self.count("frames_in", len(frames))
+            elif kind == "udp":
+                ack = server.handle_udp_frame(payload, address)
+                self.count("datagrams_in")
+                if ack is not None and server.udp_socket is not None:
+                    try:
+                        server.udp_socket.sendto(ack, address)
+                    except OSError:
+                        pass
+            for fd in fds:
+                os.close(fd)
+
+    def stats(self):
+        with self.lock:
+            return dict(self.counters, shard=self.shard, workers=self.ring.shards)
+
+
+class WorkerLink:
+    """Lado de un worker de la vista global: responde consultas y reenvía sus cambios"""
+
+    def __init__(self, server, control, diffs):
+        self.server = server
+        self.control = control
+        self.diffs = diffs
+
+    def start(self, port, udp_port):
+        self.control.sendall(json.dumps({"ready": port, "udp": udp_port}).encode("utf-8") + b"\n")
+        threading.Thread(target=self.serve_queries, daemon=True).start()
+        threading.Thread(target=self.forward_diffs, daemon=True).start()
+
+    def serve_queries(self):
+        try:
+            for line in self.control.makefile("rb"):
+                answer = self.answer(json.loads(line))
+                self.control.sendall(json.dumps(answer).encode("utf-8") + b"\n")
+        except (OSError, ValueError):
+            pass
+        # Coordinador cerrado: un worker huérfano seguiría en el grupo de
+        # SO_REUSEPORT y un servidor nuevo compartiría el puerto con él. La
+        # señal corta el accept() del hilo principal, que cierra con stop_server()
+        if self.server.running:
+            print(f"❌ Worker {os.getpid()}: se cerró el coordinador; deteniendo")
+            os.kill(os.getpid(), signal.SIGTERM)
+
+    def answer(self, request):
+        table = self.server.occupancy
+        query = request.get("query")
+        if query == "spots":
+            return table.snapshot()[1]
+        if query == "counts":
+            return table.counts()
+        if query == "free":
+            return table.free_spots()
+        if query == "spot":
+            spot = table.get(request.get("parkingId"))
+            return list(spot) if spot is not None else None
+        if query == "liveness":
+            return self.server.liveness_stats()
+        if query == "analytics":
+            return self.server.analytics.state()
+        return None
+
+    def forward_diffs(self):
+        table = self.server.occupancy
+        seq = 0
+        try:
+            while True:
+                entries, last_seq = table.diffs.read(seq, 1.0)
+                if entries is None:
+                    # Atrasado más que el registro: cada cambio es el estado
+                    # completo del espacio, así que basta con reenviarlos todos
+                    last_seq, spots = table.snapshot()
+                    payloads = [json.dumps(spot).encode("utf-8") for spot in spots]
+                else:
+                    payloads = [payload for _, payload in entries]
+                seq = last_seq
+                if payloads:
+                    self.diffs.sendall(b"\n".join(payloads) + b"\n")
+        except OSError:
+            pass
+
+
+class WorkerHandle:
+    """Lado del coordinador de un worker: proceso, consultas y cambios"""
+
+    def __init__(self, shard, process, control, diffs):
+        self.shard = shard
+        self.process = process
+        self.control = control
+        self.diffs = diffs
+        self.reader = control.makefile("rb")
+        self.lock = threading.Lock()
+
+    def wait_ready(self):
+        line = self.reader.readline()
+        if not line:
+            raise OSError(f"el worker {self.shard} no pudo abrir el puerto")
+        return json.loads(line)
+
+    def request(self, query, **fields):
+        with self.lock:
+            self.control.sendall(json.dumps(dict(fields, query=query)).encode("utf-8") + b"\n")
+            line = self.reader.readline()
+        if not line:
+            raise OSError(f"el worker {self.shard} no responde")
+        return json.loads(line)
+
+
+class MergedOccupancy:
+    """Las OccupancyTable de los workers como una sola, para OccupancyHttpServer"""
+
+    def __init__(self, workers, ring, history=4096):
+        self.workers = workers
+        self.ring = ring
+        self.diffs = DiffLog(history)
+
+    def start(self):
+        for worker in self.workers:
+            threading.Thread(target=self.collect, args=(worker,), daemon=True).start()
+
+    def collect(self, worker):
+        try:
+            for line in worker.diffs.makefile("rb"):
+                self.diffs.append(line.rstrip(b"\n"))
+        except OSError:
+            pass
+
+    def gather(self, query):
+        return [worker.request(query) for worker in self.workers]
+
+    def snapshot(self):
+        # La secuencia se toma antes de preguntar: un cambio posterior puede
+        # llegar repetido al suscriptor, pero no perderse
+        seq = self.diffs.last_seq
+        return seq, [spot for spots in self.gather("spots") for spot in spots]
+
+    def counts(self):
+        return sum_counts(self.gather("counts"))
+
+    def liveness(self):
+        return sum_counts(self.gather("liveness"))
+
+    def free_spots(self):
+        return list(heapq.merge(*self.gather("free")))
+
+    def get(self, parking_id):
+        fields = self.workers[self.ring.owner(parking_id)].request("spot", parkingId=parking_id)
+        return Spot(*fields) if fields is not None else None
+
+
+class MergedAnalytics:
+    """Consultas de analítica sobre la suma de los workers (OccupancyAnalytics.merged)"""
+
+    def __init__(self, occupancy, max_age=MERGE_MAX_AGE):
+        self.occupancy = occupancy
+        self.max_age = max_age
+        self.merged = None
+        self.merged_at = 0.0
+        self.lock = threading.Lock()
+
+    def current(self):
+        with self.lock:
+            if self.merged is None or time.monotonic() - self.merged_at > self.max_age:
+                self.merged = OccupancyAnalytics.merged(self.occupancy.gather("analytics"))
+                self.merged_at = time.monotonic()
+            return self.merged
+
+    def summary(self, now=None):
+        return self.current().summary(now)
+
+    def spot(self, parking_id, now=None):
+        return self.current().spot(parking_id, now)
+
+    def hourly(self, since, until, now=None):
+        return self.current().hourly(since, until, now)
+
+    def daily(self, since, until, now=None):
+        return self.current().daily(since, until, now)
+
+
+def sum_counts(parts):
+    total = {}
+    for part in parts:
+        for key, value in part.items():
+            total[key] = total.get(key, 0) + value
+    return total
+
+
+def interrupt(signum, frame):
+    # Una sola vez: la segunda señal no corta stop_server() a mitad del guardado
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+    signal.signal(signal.SIGTERM, signal.SIG_IGN)
+    raise KeyboardInterrupt
+
+
+def die_with_parent(parent):
+    """SIGTERM a este proceso si muere el coordinador, también con SIGKILL"""
+    try:
+        ctypes.CDLL(None).prctl(PR_SET_PDEATHSIG, signal.SIGTERM)
+    except (OSError, AttributeError):
+        pass   # Fuera de Linux queda el EOF del socket de control
+    # Si murió antes del prctl() la señal ya no llega
+    return os.getppid() == parent
+
+
+def run_worker(shard, ring, inboxes, control, diffs, unused, host, port, udp_port,
+               log_path, log_options, analytics_path, options, parent):
+    """Proceso de un worker: un ParkingServer con su parte del estado"""
+    signal.signal(signal.SIGINT, interrupt)
+    signal.signal(signal.SIGTERM, interrupt)
+    if not die_with_parent(parent):
+        return
+    for sock in unused:
+        sock.close()   # Sin copias ajenas, el coordinador ve el EOF si este worker muere
+    router = ShardRouter(shard, ring, [pair[1] for pair in inboxes], inboxes[shard][0])
+    server = ParkingServer(host, port, udp_port=udp_port, reuse_port=True, router=router,
+                           sensor_log=SensorLog(shard_path(log_path, shard), **log_options),
+                           analytics_path=shard_path(analytics_path, shard) if analytics_path else None,
+                           **options)
+    router.start(server)
+    link = WorkerLink(server, control, diffs)
+
+    def announce():
+        server.ready.wait()
+        link.start(server.port, server.udp_port)
+
+    threading.Thread(target=announce, daemon=True).start()
+    try:
+        server.start_server()   # Termina con stop_server() al recibir la señal
+    except KeyboardInterrupt:
+        pass
+
+
+class ShardedIngest:
+    """Coordinador: levanta los workers y sirve la vista global por HTTP"""
+
+    def __init__(self, workers, host="0.0.0.0", port=8080, http_port=None, udp_port=None,
+                 log_path="parking_sensor.log", log_options=None,
+                 analytics_path="parking_analytics.json", **options):
+        if workers < 1:
+            raise ValueError("se necesita al menos un worker")
+        self.ring = ShardRing(workers)
+        self.host = host
+        self.port = port
+        self.udp_port = udp_port
+        self.http_port = http_port
+        self.log_path = log_path
+        self.log_options = log_options or {}
+        self.analytics_path = analytics_path
+        self.options = options
+        self.workers = []
+        self.occupancy = None
+        self.analytics = None
+        self.http_server = None
+
+    def reserve(self, kind, port):
+        """Con el puerto 0, uno libre que todos los workers puedan compartir"""
+        probe = socket.socket(socket.AF_INET, kind)
+        probe.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+        probe.bind((self.host, port))
+        return probe, probe.getsockname()[1]
+
+    def start(self):
+        probes = []
+        if self.port == 0:
+            probe, self.port = self.reserve(socket.SOCK_STREAM, 0)
+            probes.append(probe)
+        if self.udp_port == 0:
+            probe, self.udp_port = self.reserve(socket.SOCK_DGRAM, 0)
+            probes.append(probe)
+        os.makedirs("parking_images", exist_ok=True)
+
+        count = self.ring.shards
+        inboxes = [socket.socketpair(socket.AF_UNIX, socket.SOCK_SEQPACKET) for _ in range(count)]
+        controls = [socket.socketpair() for _ in range(count)]
+        diffs = [socket.socketpair() for _ in range(count)]
+        context = multiprocessing.get_context("fork")
+        for shard in range(count):
+            # Cada worker se queda con su extremo de recepción, los de envío
+            # de todos y sus dos sockets con el coordinador. Las reservas de
+            # puerto se cierran: una copia viva del socket UDP queda en el
+            # grupo de SO_REUSEPORT y se lleva datagramas que nadie lee
+            unused = (probes + [pair[0] for n, pair in enumerate(inboxes) if n != shard]
+                      + [pair[0] for pair in controls + diffs]
+                      + [pair[1] for n, pair in enumerate(controls + diffs) if n % count != shard])
+            process = context.Process(
+                target=run_worker, name=f"ingest-{shard}", daemon=True,
+                args=(shard, self.ring, inboxes, controls[shard][1], diffs[shard][1], unused,
+                      self.host, self.port, self.udp_port, self.log_path, self.log_options,
+                      self.analytics_path, self.options, os.getpid()))
+            process.start()
+            controls[shard][0].settimeout(WORKER_TIMEOUT)
+            self.workers.append(WorkerHandle(shard, process, controls[shard][0], diffs[shard][0]))
+        for pair in inboxes:
+            pair[0].close()
+            pair[1].close()
+        for pair in controls + diffs:
+            pair[1].close()
+
+        try:
+            for worker in self.workers:
+                worker.wait_ready()
+        except (OSError, ValueError):
+            self.stop()
+            raise
+        finally:
+            for probe in probes:
+                probe.close()
+
+        self.occupancy = MergedOccupancy(self.workers, self.ring)
+        self.occupancy.start()
+        self.analytics = MergedAnalytics(self.occupancy)
+        if self.http_port is not None:
+            self.http_server = OccupancyHttpServer(self.occupancy, self.host, self.http_port,
+                                                   analytics=self.analytics)
+            self.http_server.start()
+            self.http_port = self.http_server.port
+        print(f"🧩 {count} workers en {self.host}:{self.port} (SO_REUSEPORT, espacios por parkingId)")
+        if self.http_port is not None:
+            print(f"🌐 Vista global: http://{self.host}:{self.http_port}/spots (suscripción en /events)")
+
+    def stop(self):
+        if self.http_server is not None:
+            self.http_server.stop()
+            self.http_server = None
+        for worker in self.workers:
+            if worker.process.is_alive():
+                os.kill(worker.process.pid, signal.SIGINT)
+        for worker in self.workers:
+            worker.process.join(WORKER_TIMEOUT)
+            if worker.process.is_alive():
+                worker.process.kill()
+            worker.control.close()
+            worker.diffs.close()
+        self.workers = []
+
+    def run(self):
+        """start() y esperar hasta Ctrl+C, SIGTERM o la caída de un worker"""
+        signal.signal(signal.SIGTERM, interrupt)
+        try:
+            self.start()
+            while all(worker.process.is_alive() for worker in self.workers):
+                time.sleep(0.5)
+            print("❌ Un worker terminó; deteniendo los demás")
+        except KeyboardInterrupt:
+            print("\n🛑 Deteniendo workers...")
+        finally:
+            self.stop()
+        print("🛑 Servidor detenido")
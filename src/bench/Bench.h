@@ -0,0 +1,128 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Arnés mínimo de microbenchmarks (env "bench" en el host, "bench_esp32" en
+// la placa). Cada caso se calibra hasta durar minTimeMs, se repite
+// BENCH_SAMPLES veces y se reporta la mediana de ns/op.
+//
+// - Host: reloj monotónico y conteo de asignaciones (operator new) por operación.
+// - ESP32: contador de ciclos del CPU; las asignaciones no se cuentan porque
+//   String de Arduino usa realloc() directamente.
+
+#include "Hal.h"
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <time.h>
+#endif
+
+#define BENCH_SAMPLES 5
+#define BENCH_MAX_RESULTS 32
+
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;        // Iteraciones por muestra
+    double nsPerOp;             // Mediana de las muestras
+    double cyclesPerOp;         // < 0 si no hay contador de ciclos
+    double allocsPerOp;         // < 0 si no se cuentan asignaciones
+    double bytesPerOp;
+    double peakBytes;           // Pico de heap por operación informado por el caso; < 0 si no aplica
+};
+
+// Contadores de asignaciones; en el host los incrementa operator new (bench_main.cpp)
+extern uint64_t benchAllocCount;
+extern uint64_t benchAllocBytes;
+
+// Pico de heap de la operación, para memoria que no pasa por operator new
+// (p. ej. OpenSSL en los casos tls_*). El caso guarda el máximo observado.
+extern double benchPeakBytes;
+
+// Evitar que el compilador elimine el resultado de la operación medida
+template <typename T>
+inline void benchKeep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline uint64_t benchNowNs() {
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time() * 1000ULL;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+inline uint32_t benchCycles() {
+#ifdef ARDUINO
+    return ESP.getCycleCount();
+#else
+    return 0;
+#endif
+}
+
+// Ejecutar body(i) las veces necesarias y medir
+template <typename Body>
+BenchResult runBenchmark(const char* name, double minTimeMs, Body body) {
+    BenchResult result;
+    result.name = name;
+
+    // Calibración: duplicar iteraciones hasta superar una décima del tiempo objetivo
+    uint32_t iterations = 1;
+    while (true) {
+        uint64_t start = benchNowNs();
+        for (uint32_t i = 0; i < iterations; i++) {
+            body(i);
+        }
+        double elapsedMs = (benchNowNs() - start) / 1e6;
+        if (elapsedMs >= minTimeMs / 10 || iterations >= (1u << 30)) {
+            double scaled = iterations * (minTimeMs / BENCH_SAMPLES) / (elapsedMs > 0 ? elapsedMs : 1e-3);
+            iterations = scaled < 1 ? 1 : scaled > (1u << 30) ? (1u << 30) : (uint32_t)scaled;
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double samples[BENCH_SAMPLES];
+    double cycleSamples[BENCH_SAMPLES];
+    benchPeakBytes = -1;
+    uint64_t allocsBefore = benchAllocCount;
+    uint64_t bytesBefore = benchAllocBytes;
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        uint32_t startCycles = benchCycles();
+        uint64_t start = benchNowNs();
+        for (uint32_t i = 0; i < iterations; i++) {
+            body(i);
+        }
+        uint64_t elapsed = benchNowNs() - start;
+        uint32_t cycles = benchCycles() - startCycles;
+        samples[s] = (double)elapsed / iterations;
+        cycleSamples[s] = (double)cycles / iterations;
+    }
+    double totalOps = (double)iterations * BENCH_SAMPLES;
+
+    // Mediana por inserción: son pocas muestras
+    for (int i = 1; i < BENCH_SAMPLES; i++) {
+        for (int j = i; j > 0 && samples[j] < samples[j - 1]; j--) {
+            double t = samples[j]; samples[j] = samples[j - 1]; samples[j - 1] = t;
+            t = cycleSamples[j]; cycleSamples[j] = cycleSamples[j - 1]; cycleSamples[j - 1] = t;
+        }
+    }
+
+    result.iterations = iterations;
+    result.nsPerOp = samples[BENCH_SAMPLES / 2];
+    result.peakBytes = benchPeakBytes;
+#ifdef ARDUINO
+    result.cyclesPerOp = cycleSamples[BENCH_SAMPLES / 2];
+    result.allocsPerOp = -1;
+    result.bytesPerOp = -1;
+#else
+    result.cyclesPerOp = -1;
+    result.allocsPerOp = (benchAllocCount - allocsBefore) / totalOps;
+    result.bytesPerOp = (benchAllocBytes - bytesBefore) / totalOps;
+#endif
+    return result;
+}
+
+#endif // BENCH_H
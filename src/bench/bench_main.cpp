@@ -0,0 +1,551 @@
+// Microbenchmarks de las rutas calientes del firmware.
+//
+// Host (env "bench"):
+//   .pio/build/bench/program [--filter TEXTO] [--min-time MS] > resultados.json
+//   python bench_compare.py resultados.json
+// La tabla legible sale por stderr y el JSON por stdout.
+//
+// ESP32 (env "bench_esp32"): corre los casos sin red al arrancar e imprime la
+// tabla y una línea JSON por el puerto serie (capturarla con pio device monitor).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "Hal.h"
+#include "ParkingSensor.h"
+#include "RawStream.h"
+#include "Base64.h"
+#include "Bench.h"
+#include "HalTls.h"
+#include "Postmortem.h"
+#include "Gateway.h"
+#include "HalCamera.h"
+#include "JpegCrop.h"
+#include "Int8Kernels.h"
+#include "OccupancyClassifier.h"
+#include "OccupancyReference.h"
+#include "HalBoard.h"
+#include "HalGpio.h"
+
+#ifndef ARDUINO
+#include <vector>
+#include <thread>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+uint64_t benchAllocCount = 0;
+uint64_t benchAllocBytes = 0;
+double benchPeakBytes = -1;
+
+#ifndef ARDUINO
+
+// ---- Conteo de asignaciones en el host ----
+
+void* operator new(size_t size) {
+    benchAllocCount++;
+    benchAllocBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ---- Servidor sumidero: acepta una conexión y descarta lo recibido ----
+
+static int startSinkServer(uint16_t& port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t length = sizeof(addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &length) < 0) {
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+
+    std::thread([fd]() {
+        int client = accept(fd, NULL, NULL);
+        char buffer[4096];
+        while (client >= 0 && recv(client, buffer, sizeof(buffer), 0) > 0) {
+        }
+    }).detach();
+    return fd;
+}
+
+// Eco alternado entre ocupado y libre: cada medición es un cambio de estado
+static float alternatingDistance(void* context, unsigned long nowMs) {
+    (void)nowMs;
+    bool& occupied = *(bool*)context;
+    occupied = !occupied;
+    return occupied ? 30.0f : 80.0f;
+}
+
+#endif // ARDUINO
+
+// ---- Casos ----
+
+static BenchResult results[BENCH_MAX_RESULTS];
+static int resultCount = 0;
+static const char* filter = NULL;
+static double minTimeMs = 1000;
+
+template <typename Body>
+static void bench(const char* name, Body body) {
+    if (resultCount >= BENCH_MAX_RESULTS || (filter != NULL && strstr(name, filter) == NULL)) {
+        return;
+    }
+    results[resultCount++] = runBenchmark(name, minTimeMs, body);
+}
+
+static uint8_t imageData[32768];
+
+static void runPureCases() {
+    // Datos con la entropía de un JPEG: bytes pseudoaleatorios
+    uint32_t x = 0x2545F491;
+    for (size_t i = 0; i < sizeof(imageData); i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        imageData[i] = (uint8_t)x;
+    }
+
+    ParkingSensor sensor(35, 36, 1, "192.168.1.100", 8080);
+
+    bench("parking_json", [&](uint32_t i) {
+        String json = sensor.buildParkingJson(123456 + i);
+        benchKeep(json);
+    });
+
+    // Serie cruda: una medición y un bloque lleno de 80 (a 1 Hz, ruido de
+    // pocos mm) codificado y en base64, contra 80 parking_json
+    static RawStream rawStream;
+    rawStream.setFlushInterval(90000);
+    static char rawLine[RAW_LINE_BYTES];
+    bench("raw_add", [&](uint32_t i) {
+        if (!rawStream.add(i * 1000 + (i & 3), 182.0f + (i & 7) * 0.1f)) {
+            rawStream.drop();
+        }
+    });
+    bench("raw_block_80", [&](uint32_t i) {
+        for (uint32_t k = 0; k < 80; k++) {
+            rawStream.add((i * 80 + k) * 1000 + (k & 3), 182.0f + (k & 7) * 0.1f);
+        }
+        benchKeep(rawStream.buildLine(rawLine));
+    });
+
+    static SensorHealth health;
+    bench("health_add", [&](uint32_t i) {
+        benchKeep(health.add((i & 31) == 0 ? -1.0f : 182.0f + (i & 7) * 0.1f));
+    });
+
+    bench("status_string", [&](uint32_t) {
+        String status = sensor.getStatusString();
+        benchKeep(status);
+    });
+
+    bench("distance_conversion", [&](uint32_t i) {
+        float distance = ParkingSensor::durationToDistance(100 + (i & 0x3FFF));
+        benchKeep(distance);
+    });
+
+    bench("base64_encode_1k", [&](uint32_t) {
+        String encoded = base64Encode(imageData, 1024);
+        benchKeep(encoded);
+    });
+
+    bench("base64_encode_32k", [&](uint32_t) {
+        String encoded = base64Encode(imageData, sizeof(imageData));
+        benchKeep(encoded);
+    });
+
+    // Registro postmortem: la muestra de cada vuelta del loop y el informe
+    // con el anillo lleno que se arma al conectar tras un reinicio
+    static PostmortemRing ring;
+    Postmortem recorder(ring);
+    recorder.begin(hal::RESET_POWERON, 0);
+    for (int i = 0; i < PM_EVENTS; i++) {
+        recorder.record(PM_ARRIVAL, 250 + i, 1000 * i);
+    }
+    bench("postmortem_sample", [&](uint32_t i) {
+        recorder.sample(i, 40 + (i & 7), 180000 - (i & 0xFF));
+    });
+    recorder.begin(hal::RESET_WATCHDOG, 0);
+    bench("postmortem_report", [&](uint32_t) {
+        String report = recorder.buildReport(1);
+        benchKeep(report);
+    });
+
+    // Modo gateway: una trama de hoja (decodificar, deduplicar entre 256
+    // hojas y encolar) y la línea de un lote lleno
+    static Gateway gateway(1, "192.168.1.100", 8080);
+    GatewayFrame leafFrame = sensor.buildLeafFrame(GW_FRAME_HEARTBEAT);
+    uint8_t frameBytes[GW_FRAME_SIZE];
+    uint32_t leafSeq = 0;
+    for (int i = 0; i < GW_QUEUE_FRAMES; i++) {
+        leafFrame.parkingId = (uint16_t)i;
+        leafFrame.seq = ++leafSeq;
+        encodeGatewayFrame(leafFrame, frameBytes);
+        gateway.submit(frameBytes, sizeof(frameBytes));
+    }
+    bench("gateway_submit", [&](uint32_t i) {
+        leafFrame.parkingId = (uint16_t)(i & 0xFF);
+        leafFrame.seq = ++leafSeq;
+        encodeGatewayFrame(leafFrame, frameBytes);
+        benchKeep(gateway.submit(frameBytes, sizeof(frameBytes)));
+    });
+    static char batchLine[GW_BATCH_BYTES];
+    bench("gateway_batch", [&](uint32_t) {
+        benchKeep(gateway.buildBatch(GW_BATCH_FRAMES, batchLine, sizeof(batchLine)));
+    });
+}
+
+// Clasificador de ocupación int8: antes de medir se comparan los logits con
+// los de referencia de train_occupancy_model.py (placa y host dan lo mismo)
+static void runClassifierCases() {
+    OccupancyClassifier classifier;
+    bool simd = classifier.begin();
+    int matches = 0;
+    for (int i = 0; i < OCC_REFERENCE_COUNT; i++) {
+        OccupancyScore score = classifier.classify(OCC_REFERENCE_INPUTS[i]);
+        if (score.logits[0] == OCC_REFERENCE_LOGITS[i][0] && score.logits[1] == OCC_REFERENCE_LOGITS[i][1]) {
+            matches++;
+        }
+    }
+#ifdef ARDUINO
+    Serial.printf("%s Logits de referencia (kernel %s): %d/%d iguales\n", matches == OCC_REFERENCE_COUNT ? "✅" : "❌",
+                  int8KernelName(), matches, OCC_REFERENCE_COUNT);
+#else
+    fprintf(stderr, "%s Logits de referencia (kernel %s): %d/%d iguales\n", matches == OCC_REFERENCE_COUNT ? "✅" : "❌",
+            int8KernelName(), matches, OCC_REFERENCE_COUNT);
+#endif
+
+    bench("occupancy_infer", [&](uint32_t i) {
+        OccupancyScore score = classifier.classify(OCC_REFERENCE_INPUTS[i % OCC_REFERENCE_COUNT]);
+        benchKeep(score.logits[1]);
+    });
+    setInt8SimdEnabled(false);
+    bench("occupancy_infer_scalar", [&](uint32_t i) {
+        OccupancyScore score = classifier.classify(OCC_REFERENCE_INPUTS[i % OCC_REFERENCE_COUNT]);
+        benchKeep(score.logits[1]);
+    });
+    setInt8SimdEnabled(simd);
+}
+
+#ifndef ARDUINO
+
+// update() necesita el HC-SR04 simulado y un servidor: solo en el host
+static void runUpdateCases() {
+    uint16_t port = 0;
+    if (startSinkServer(port) < 0) {
+        fprintf(stderr, "No se pudo abrir el servidor sumidero, se omiten los casos de update()\n");
+        return;
+    }
+
+    hal::sim::Board board;
+    hal::sim::initBoard(board);
+    board.serialEnabled = false;
+    hal::sim::bindBoard(&board);
+
+    ParkingSensor sensor(35, 36, 1, "127.0.0.1", port);
+    sensor.begin();
+
+    // Reloj acelerado solo para que el primer intento de conexión sea inmediato
+    board.timeScale = 1000;
+    while (!sensor.isTcpConnected()) {
+        sensor.update();
+    }
+    board.timeScale = 1;
+
+    // Entre mediciones: la mayoría de las llamadas a update() en loop()
+    sensor.setMeasurementInterval(3600000);
+    bench("update_idle", [&](uint32_t) {
+        sensor.update();
+    });
+
+    // Medición y decisión sin cambio de estado
+    sensor.setMeasurementInterval(0);
+    board.fixedDistance = 80.0f;
+    bench("update_measure", [&](uint32_t) {
+        sensor.update();
+    });
+
+    // Cambio de estado en cada medición: JSON + envío TCP
+    bool occupied = false;
+    board.distanceSource = alternatingDistance;
+    board.context = &occupied;
+    bench("update_transition", [&](uint32_t) {
+        sensor.update();
+    });
+
+    hal::sim::bindBoard(NULL);
+}
+
+// Handshake TLS completo y reanudado contra un servidor en loopback: tiempo
+// de connect() (TCP + TLS) y pico de heap de OpenSSL en el cliente
+static void runTlsCases() {
+    hal::sim::TlsTestServer server;
+    uint16_t port = 0;
+    if (!server.start(port)) {
+        fprintf(stderr, "No se pudo abrir el servidor TLS, se omiten los casos tls_*\n");
+        return;
+    }
+
+    hal::TlsClient client;
+    client.setCACert(server.caCert());
+    bool ok = true;
+
+    auto handshake = [&](uint32_t) {
+        ok = client.connect("127.0.0.1", port) && ok;
+        double peak = client.getStats().lastHandshakePeakBytes;
+        if (peak > benchPeakBytes) {
+            benchPeakBytes = peak;
+        }
+        client.stop();
+    };
+
+    client.setSessionResumption(false);
+    bench("tls_handshake_full", handshake);
+
+    client.setSessionResumption(true);
+    client.connect("127.0.0.1", port);  // Sesión inicial
+    client.stop();
+    bench("tls_handshake_resumed", handshake);
+
+    const hal::TlsStats& stats = client.getStats();
+    if (!ok || stats.resumedHandshakes == 0) {
+        fprintf(stderr, "⚠️ Handshakes TLS fallidos: %u, reanudados: %u\n",
+                (unsigned)stats.failedHandshakes, (unsigned)stats.resumedHandshakes);
+    }
+}
+
+// Recorte JPEG en bordes de MCU sobre cuadros del OV2640 simulado: región
+// central de 40 % × 50 % del cuadro, como un espacio de estacionamiento
+static void runCameraCases() {
+    camera_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.pixel_format = PIXFORMAT_JPEG;
+    config.frame_size = FRAMESIZE_VGA;
+    config.jpeg_quality = 12;
+    config.fb_count = 1;
+    if (esp_camera_init(&config) != ESP_OK) {
+        fprintf(stderr, "No se pudo iniciar la cámara simulada, se omiten los casos jpeg_crop_*\n");
+        return;
+    }
+    sensor_t* sensor = esp_camera_sensor_get();
+
+    static const struct {
+        const char* name;
+        framesize_t framesize;
+    } cases[] = {
+        {"jpeg_crop_qvga", FRAMESIZE_QVGA},
+        {"jpeg_crop_vga", FRAMESIZE_VGA},
+    };
+    JpegCropper cropper;
+    for (const auto& c : cases) {
+        sensor->set_framesize(sensor, c.framesize);
+        camera_fb_t* fb = esp_camera_fb_get();
+        if (fb == NULL) {
+            continue;
+        }
+        std::vector<uint8_t> jpeg(fb->buf, fb->buf + fb->len);
+        JpegRect rect = {(uint16_t)(fb->width * 3 / 10), (uint16_t)(fb->height * 3 / 10),
+                         (uint16_t)(fb->width * 4 / 10), (uint16_t)(fb->height / 2)};
+        esp_camera_fb_return(fb);
+        std::vector<uint8_t> out(JpegCropper::outputCapacity(jpeg.size()));
+
+        bench(c.name, [&](uint32_t) {
+            size_t length = cropper.crop(jpeg.data(), jpeg.size(), rect, out.data(), out.size());
+            benchKeep(length);
+        });
+
+        // Miniatura DC para el clasificador (lo que más cuesta de la inferencia)
+        if (c.framesize == FRAMESIZE_QVGA) {
+            std::vector<uint8_t> thumb(jpeg.size());
+            bench("jpeg_luma_thumb_qvga", [&](uint32_t) {
+                uint16_t width;
+                uint16_t height;
+                size_t pixels = cropper.lumaThumbnail(jpeg.data(), jpeg.size(), thumb.data(), thumb.size(),
+                                                      &width, &height);
+                benchKeep(pixels);
+            });
+        }
+    }
+    esp_camera_deinit();
+}
+
+#endif // ARDUINO
+
+#ifdef ARDUINO
+// Pulso de trigger del HC-SR04: ruta con pines en tiempo de ejecución
+// (digitalWrite + delayMicroseconds, la de ParkingSensor sin setPing) contra
+// hal::Ultrasonic. Además del promedio se reparte la duración de
+// TRIGGER_SAMPLES pulsos: con el Wi-Fi encendido las interrupciones estiran
+// la primera y no la segunda. En el host delayMicros() duerme: solo en la placa
+typedef hal::Ultrasonic<hal::BOARD.trigPin, hal::BOARD.echoPin> Hcsr04;
+
+#define TRIGGER_SAMPLES 1000
+
+static void runtimeTrigger() {
+    hal::gpioWrite(hal::BOARD.trigPin, false);
+    hal::delayMicros(2);
+    hal::gpioWrite(hal::BOARD.trigPin, true);
+    hal::delayMicros(10);
+    hal::gpioWrite(hal::BOARD.trigPin, false);
+}
+
+static int compareCycles(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void reportJitter(const char* name, void (*trigger)()) {
+    static uint32_t cycles[TRIGGER_SAMPLES];
+    for (int i = 0; i < TRIGGER_SAMPLES; i++) {
+        uint32_t start = ESP.getCycleCount();
+        trigger();
+        cycles[i] = ESP.getCycleCount() - start;
+        delayMicroseconds(50);
+    }
+    qsort(cycles, TRIGGER_SAMPLES, sizeof(cycles[0]), compareCycles);
+    float perUs = (float)hal::cpuFreqMHz();
+    Serial.printf("%-22s min %.2f  p50 %.2f  p99 %.2f  max %.2f µs\n", name,
+                  cycles[0] / perUs, cycles[TRIGGER_SAMPLES / 2] / perUs,
+                  cycles[TRIGGER_SAMPLES * 99 / 100] / perUs, cycles[TRIGGER_SAMPLES - 1] / perUs);
+}
+
+static void runTriggerCases() {
+    hal::gpioOutput(hal::BOARD.trigPin);
+    Hcsr04::begin();
+
+    bench("trigger_pulse", [&](uint32_t) {
+        runtimeTrigger();
+    });
+    bench("trigger_pulse_fast", [&](uint32_t) {
+        Hcsr04::trigger();
+    });
+
+    reportJitter("trigger_pulse", runtimeTrigger);
+    reportJitter("trigger_pulse_fast", Hcsr04::trigger);
+}
+#endif // ARDUINO
+
+// ---- Reporte ----
+
+#ifdef ARDUINO
+
+void setup() {
+    Serial.begin(115200);
+    delay(2000);
+    minTimeMs = 500;
+    Serial.printf("🔬 Benchmarks en %s a %u MHz\n", hal::chipModel(), (unsigned)hal::cpuFreqMHz());
+
+    runPureCases();
+    runClassifierCases();
+    runTriggerCases();
+
+    for (int i = 0; i < resultCount; i++) {
+        Serial.printf("%-22s %12.1f ns/op %12.1f ciclos/op\n",
+                      results[i].name, results[i].nsPerOp, results[i].cyclesPerOp);
+    }
+
+    // Una sola línea JSON para bench_compare.py
+    char line[128];
+    Serial.print("{\"platform\": \"esp32\", \"results\": [");
+    for (int i = 0; i < resultCount; i++) {
+        snprintf(line, sizeof(line),
+                 "%s{\"name\": \"%s\", \"iterations\": %u, \"ns_per_op\": %.3f, \"cycles_per_op\": %.3f, "
+                 "\"allocs_per_op\": null, \"bytes_per_op\": null}",
+                 i ? ", " : "", results[i].name, (unsigned)results[i].iterations,
+                 results[i].nsPerOp, results[i].cyclesPerOp);
+        Serial.print(line);
+    }
+    Serial.println("]}");
+}
+
+void loop() {
+    delay(1000);
+}
+
+#else
+
+static void printNumber(FILE* out, double value) {
+    if (value < 0) {
+        fprintf(out, "null");
+    } else {
+        fprintf(out, "%.3f", value);
+    }
+}
+
+static void printJson(FILE* out, const char* platform) {
+    fprintf(out, "{\"platform\": \"%s\", \"results\": [", platform);
+    for (int i = 0; i < resultCount; i++) {
+        const BenchResult& r = results[i];
+        fprintf(out, "%s{\"name\": \"%s\", \"iterations\": %u, \"ns_per_op\": ", i ? ", " : "", r.name,
+                (unsigned)r.iterations);
+        printNumber(out, r.nsPerOp);
+        fprintf(out, ", \"cycles_per_op\": ");
+        printNumber(out, r.cyclesPerOp);
+        fprintf(out, ", \"allocs_per_op\": ");
+        printNumber(out, r.allocsPerOp);
+        fprintf(out, ", \"bytes_per_op\": ");
+        printNumber(out, r.bytesPerOp);
+        if (r.peakBytes >= 0) {
+            fprintf(out, ", \"peak_bytes\": ");
+            printNumber(out, r.peakBytes);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "]}\n");
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--filter") == 0) {
+            filter = argv[i + 1];
+        } else if (strcmp(argv[i], "--min-time") == 0) {
+            minTimeMs = atof(argv[i + 1]);
+        } else {
+            fprintf(stderr, "Uso: %s [--filter TEXTO] [--min-time MS]\n", argv[0]);
+            return 1;
+        }
+    }
+    hal::sim::setSerialEnabled(false);
+
+    runPureCases();
+    runClassifierCases();
+    runUpdateCases();
+    runTlsCases();
+    runCameraCases();
+
+    fprintf(stderr, "%-22s %12s %10s %10s %12s\n", "caso", "ns/op", "allocs/op", "bytes/op", "iteraciones");
+    for (int i = 0; i < resultCount; i++) {
+        const BenchResult& r = results[i];
+        fprintf(stderr, "%-22s %12.1f %10.2f %10.1f %12u", r.name, r.nsPerOp, r.allocsPerOp, r.bytesPerOp,
+                (unsigned)r.iterations);
+        if (r.peakBytes >= 0) {
+            fprintf(stderr, "   pico %.1f KB", r.peakBytes / 1024);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    printJson(stdout, "host");
+    return 0;
+}
+
+#endif // ARDUINO
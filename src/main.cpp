@@ -1,171 +1,330 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <esp_camera.h>
+#include <esp_wifi.h>
 #include "ParkingSensor.h"
-#include "board_config.h"
+#include "Gateway.h"
+#include "HalLink.h"
+#include "HalBoard.h"
+#include "HalGpio.h"
+#include "UdpTelemetry.h"
+#include "CameraManager.h"
+#include "LiveView.h"
+#include "CapturePolicy.h"
+#include "HalTls.h"
+#include "OtaUpdater.h"
+#include "OccupancyClassifier.h"
+#include "Postmortem.h"
 
 // Configuración de Wi-Fi
 const char* ssid = "SSS";
 const char* password = "$eba$tian3093";
 
-// Configuración del sensor de parqueoW
-// Pines para el sensor ultrasónico HC-SR04
-#define TRIG_PIN 35  // Pin de trigger
-#define ECHO_PIN 36  // Pin de echo
+// Configuración del sensor de parqueo. Los pines del HC-SR04 y de la cámara
+// vienen del perfil de la placa (lib/HAL/HalBoard.h, elegido en platformio.ini)
+#define TRIG_PIN hal::BOARD.trigPin
+#define ECHO_PIN hal::BOARD.echoPin
 #define PARKING_ID 1  // ID único del parqueo
 
+// Modo heartbeat: sin cambios solo se envía una trama corta cada 30 s
+// (0 = protocolo de eventos clásico)
+#define HEARTBEAT_INTERVAL_MS 30000
+
+// Serie cruda de distancias para diagnóstico (ver RawStream.h): cada
+// medición en bloques de ~2 bytes por lectura, enviados como mucho cada
+// RAW_STREAM_MS. 0 = apagada; también se enciende con CFG <seq> raw=<ms>
+#define RAW_STREAM_MS 0
+
+// Ajuste automático del JPEG: cada imagen debe subirse en este tiempo
+#define JPEG_TARGET_UPLOAD_MS 1500
+#define JPEG_TUNE_RESOLUTION 1  // 1 = también bajar a QQVGA en enlaces débiles
+
+// Cuándo tomar fotos (ver lib/CapturePolicy/CapturePolicy.h). Se evalúan en
+// orden y cada cambio dispara como mucho una captura.
+const char* CAPTURE_RULES[] = {
+    "on=arrival",                             // Toda llegada, también sin hora NTP
+    "on=departure hours=6-22 res=5",          // Salida en QVGA
+    "every=1800 max=2 hours=6-22 res=5",      // Ocupaciones largas: cada 30 min
+};
+
+// Perfiles de cámara (lib/CameraManager/CameraProfile.h): "thumbnail" para
+// las capturas periódicas y "day"/"night" para llegadas y salidas según la
+// hora local. Un res=/quality= recibido por CFG los desactiva.
+#define USE_CAMERA_PROFILES 1
+#define NIGHT_FROM_MINUTE (19 * 60)
+#define NIGHT_TO_MINUTE (6 * 60)
+
+// Región de interés en milésimas del cuadro (x, y, ancho, alto): solo esa
+// parte del JPEG se envía, recortada en bordes de MCU. {0, 0, 1000, 1000} =
+// cuadro completo; p. ej. {250, 350, 500, 650} para un espacio centrado
+// abajo. Se cambia en caliente con roi= por CFG.
+const CameraRoi CAMERA_ROI = {0, 0, 1000, 1000};
+
+// Confirmación de llegadas y salidas con la cámara (lib/OccupancyClassifier):
+// un clasificador int8 sobre una miniatura de la región de interés veta los
+// cambios del ultrasonido que no se ven como un auto (personas, carritos,
+// lluvia). Si captura + inferencia no entran en el presupuesto o el
+// resultado es dudoso, vale el ultrasonido. El modelo incluido se entrenó con
+// escenas sintéticas: reentrenar con miniaturas del lugar antes de activarlo
+// (ver train_occupancy_model.py).
+#define USE_OCCUPANCY_CLASSIFIER 0
+#define OCCUPANCY_BUDGET_MS 150
+#define OCCUPANCY_VETO_HOLD_MS 20000   // Sin volver a capturar tras un veto
+
+// Hora local para los horarios de las reglas (POSIX TZ), sincronizada por NTP
+#define TIMEZONE "CST6"
+#define NTP_SERVER "pool.ntp.org"
+
 // Configuración del servidor TCP
 const char* SERVER_IP = "10.185.200.153";  // IP del servidor
 const int SERVER_PORT = 8080;              // Puerto del servidor
 
+// Rol de la placa (ver lib/Gateway/Gateway.h):
+//   NODE_DIRECT   WiFi y conexión TCP propias (por defecto)
+//   NODE_LEAF     sin asociarse al AP: eventos y heartbeats por ESP-NOW al gateway
+//   NODE_GATEWAY  asociado al AP: reenvía en lotes lo de sus hojas (y lo de su
+//                 propio sensor) por una sola conexión con el servidor
+// ESP-NOW usa el canal del AP: GATEWAY_CHANNEL debe ser el canal en que el
+// gateway quedó asociado. Hojas y gateway no reciben CFG ni OTA, ni envían
+// imágenes: eso requiere NODE_DIRECT.
+#define NODE_DIRECT 0
+#define NODE_LEAF 1
+#define NODE_GATEWAY 2
+#define NODE_ROLE NODE_DIRECT
+#define GATEWAY_MAC "24:6f:28:00:00:01"    // MAC de estación del gateway (hojas)
+#define GATEWAY_CHANNEL 6
+#define GATEWAY_ID 1
+
+// Telemetría UDP (ver lib/UdpTelemetry/UdpTelemetry.h), solo con NODE_DIRECT:
+// eventos y heartbeats en datagramas confirmados en lugar de la conexión TCP,
+// que no se abre. Como en modo hoja, sin CFG, OTA ni imágenes.
+#define USE_UDP_TELEMETRY 0
+
+// Transporte TLS (ver lib/HAL/HalTls.h): 1 = eventos e imágenes cifrados.
+// El servidor debe correr con --tls-cert/--tls-key (ver README_SERVER.md).
+#ifndef USE_TLS
+#define USE_TLS 0
+#endif
+
+// Vista en vivo para apuntar la cámara (ver lib/LiveView/LiveView.h):
+// http://<ip>:81/stream en el navegador, en una tarea debajo de loop().
+// El stream no tiene autenticación: apagada por defecto, se enciende solo en
+// la compilación de instalación (pio run -e esp32-s3-install).
+#ifndef ENABLE_LIVE_VIEW
+#define ENABLE_LIVE_VIEW 0
+#endif
+#define LIVE_VIEW_FPS 2
+
+#if USE_TLS
+// server.crt del servidor (o la CA que lo firmó)
+const char* SERVER_CA_CERT = R"PEM(
+-----BEGIN CERTIFICATE-----
+...pegar aquí server.crt...
+-----END CERTIFICATE-----
+)PEM";
+hal::TlsClient tlsClient;
+#endif
+
 // Crear instancia del sensor de parqueo
 ParkingSensor parkingSensor(TRIG_PIN, ECHO_PIN, PARKING_ID, SERVER_IP, SERVER_PORT);
+typedef hal::Ultrasonic<TRIG_PIN, ECHO_PIN> Hcsr04;   // Trigger y eco por registros
+
+#if NODE_ROLE != NODE_DIRECT
+hal::LocalLink localLink;
+#endif
+#if NODE_ROLE == NODE_GATEWAY
+Gateway gateway(GATEWAY_ID, SERVER_IP, SERVER_PORT);
+#endif
+#if NODE_ROLE == NODE_DIRECT && USE_UDP_TELEMETRY
+UdpTelemetry udpTelemetry(SERVER_IP, SERVER_PORT);
+#endif
+
+// Actualización de firmware por la conexión con el servidor (COMMAND:OTA,
+// ver README_SERVER.md). Requiere la tabla de particiones con app0/app1.
+// La imagen solo se verifica con CRC: sin TLS cualquiera en la red podría
+// inyectar tramas OTA/OTAD y grabar su firmware, así que exige USE_TLS.
+#ifndef ENABLE_OTA
+#define ENABLE_OTA 0
+#endif
+#if ENABLE_OTA && !USE_TLS
+#error "ENABLE_OTA requiere USE_TLS: el parche solo se verifica con CRC"
+#endif
+#if ENABLE_OTA
+OtaUpdater otaUpdater;
+#endif
+
+// Registro postmortem (lib/Postmortem): eventos, latencia del loop, heap y
+// causa de cada reinicio en RAM RTC; tras un reinicio en caliente el informe
+// se envía al servidor al conectar
+HAL_NOINIT PostmortemRing postmortemRing;
+Postmortem postmortem(postmortemRing);
+
+// Cámara del ESP32-S3-CAM
+CameraManager camera;
 
 // Variables para la cámara
 bool cameraInitialized = false;
-bool lastParkingState = false; // false = libre, true = ocupado
-bool imageSentForCurrentOccupation = false; // Para evitar enviar múltiples imágenes
+CapturePolicy capturePolicy;
+bool cameraProfiles = USE_CAMERA_PROFILES;
+uint32_t reportedSwitches = 0;
+#if USE_OCCUPANCY_CLASSIFIER
+OccupancyClassifier occupancyClassifier;
+#endif
+#if ENABLE_LIVE_VIEW
+LiveView liveView(camera);
+#endif
 
 // Declaración de funciones
-bool initCamera();
-void captureAndSendImage();
+bool applyCameraConfig(const ConfigUpdate& config);
+int localMinuteOfDay();
+CameraProfileId profileFor(const CaptureDecision& decision);
+void captureAndSendImage(const CaptureDecision& decision);
+void onImageAck(size_t wireBytes, unsigned long uploadMs, bool accepted);
 void printSystemInfo();
-String base64Encode(const uint8_t* data, size_t length);
+bool verifyTransition(bool occupied, float distance);
+bool sendNodeFrame(const uint8_t* frame, size_t length);
 
-// Función para inicializar la cámara
-bool initCamera() {
-    Serial.println("📸 Inicializando cámara...");
-    
-    camera_config_t config;
-    config.ledc_channel = LEDC_CHANNEL_0;
-    config.ledc_timer = LEDC_TIMER_0;
-    config.pin_d0 = Y2_GPIO_NUM;
-    config.pin_d1 = Y3_GPIO_NUM;
-    config.pin_d2 = Y4_GPIO_NUM;
-    config.pin_d3 = Y5_GPIO_NUM;
-    config.pin_d4 = Y6_GPIO_NUM;
-    config.pin_d5 = Y7_GPIO_NUM;
-    config.pin_d6 = Y8_GPIO_NUM;
-    config.pin_d7 = Y9_GPIO_NUM;
-    config.pin_xclk = XCLK_GPIO_NUM;
-    config.pin_pclk = PCLK_GPIO_NUM;
-    config.pin_vsync = VSYNC_GPIO_NUM;
-    config.pin_href = HREF_GPIO_NUM;
-    config.pin_sccb_sda = SIOD_GPIO_NUM;
-    config.pin_sccb_scl = SIOC_GPIO_NUM;
-    config.pin_pwdn = PWDN_GPIO_NUM;
-    config.pin_reset = RESET_GPIO_NUM;
-    config.xclk_freq_hz = 20000000;
-    config.pixel_format = PIXFORMAT_JPEG;
-    config.frame_size = FRAMESIZE_QVGA; // 320x240
-    config.jpeg_quality = 12;
-    config.fb_count = 1;
-    config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
-    config.fb_location = CAMERA_FB_IN_DRAM;
-    
-    // Inicializar la cámara
-    esp_err_t err = esp_camera_init(&config);
-    if (err != ESP_OK) {
-        Serial.printf("❌ Error inicializando cámara: 0x%x\n", err);
+// Aplicar los campos de cámara recibidos por el canal de comandos
+bool applyCameraConfig(const ConfigUpdate& config) {
+    if (!camera.isInitialized()) {
+        Serial.println("⚠️ Cámara no inicializada, configuración de cámara rechazada");
         return false;
     }
     
-    // Configurar el sensor
-    sensor_t *s = esp_camera_sensor_get();
-    if (s != NULL) {
-        s->set_brightness(s, 0);
-        s->set_contrast(s, 0);
-        s->set_saturation(s, 0);
-        s->set_special_effect(s, 0);
-        s->set_whitebal(s, 1);
-        s->set_awb_gain(s, 1);
-        s->set_wb_mode(s, 0);
-        s->set_exposure_ctrl(s, 1);
-        s->set_aec2(s, 0);
-        s->set_ae_level(s, 0);
-        s->set_aec_value(s, 300);
-        s->set_gain_ctrl(s, 1);
-        s->set_agc_gain(s, 0);
-        s->set_gainceiling(s, (gainceiling_t)0);
-        s->set_bpc(s, 0);
-        s->set_wpc(s, 1);
-        s->set_raw_gma(s, 1);
-        s->set_lenc(s, 1);
-        s->set_hmirror(s, 0);
-        s->set_vflip(s, 0);
-        s->set_dcw(s, 1);
-        s->set_colorbar(s, 0);
+    // Configuración manual desde el servidor: dejar de elegir perfiles
+    if (cameraProfiles && (config.fields & CFG_CAMERA_FIELDS)) {
+        cameraProfiles = false;
+        Serial.println("📷 Perfiles de cámara desactivados por configuración remota");
+    }
+    if (config.fields & CFG_RESOLUTION) {
+        camera.setResolution((framesize_t)config.cameraResolution);
+    }
+    if (config.fields & CFG_QUALITY) {
+        camera.setQuality(config.cameraQuality);
+    }
+    if (config.fields & CFG_ROI) {
+        const uint16_t* r = config.cameraRoi;
+        camera.setRegionOfInterest({r[0], r[1], r[2], r[3]});
     }
-    
-    Serial.println("✅ Cámara inicializada correctamente");
     return true;
 }
 
-// Función para codificar en base64
-String base64Encode(const uint8_t* data, size_t length) {
-    const char* base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    String result = "";
-    
-    for (size_t i = 0; i < length; i += 3) {
-        uint32_t chunk = 0;
-        int chunk_size = 0;
-        
-        // Construir chunk de 3 bytes
-        for (int j = 0; j < 3 && (i + j) < length; j++) {
-            chunk = (chunk << 8) | data[i + j];
-            chunk_size++;
-        }
-        
-        // Codificar chunk
-        for (int j = 0; j < 4; j++) {
-            if (j < chunk_size + 1) {
-                result += base64_chars[(chunk >> (18 - 6 * j)) & 0x3F];
-            } else {
-                result += '=';
-            }
-        }
+// Minuto del día en hora local, -1 hasta que NTP sincronice el reloj
+int localMinuteOfDay() {
+    struct tm now;
+    if (!getLocalTime(&now, 0)) {
+        return -1;
     }
-    
-    return result;
+    return now.tm_hour * 60 + now.tm_min;
 }
 
-// Función para capturar y enviar imagen cuando el parqueo se ocupa
-void captureAndSendImage() {
+// Perfil de cámara para una captura
+CameraProfileId profileFor(const CaptureDecision& decision) {
+    if (decision.reason == CAPTURE_PERIODIC) {
+        return PROFILE_THUMBNAIL;
+    }
+    int minute = localMinuteOfDay();
+    bool night = minute >= 0 && (minute >= NIGHT_FROM_MINUTE || minute < NIGHT_TO_MINUTE);
+    return night ? PROFILE_NIGHT : PROFILE_DAY;
+}
+
+// Función para capturar y enviar imagen cuando una regla de captura dispara
+void captureAndSendImage(const CaptureDecision& decision) {
     if (!cameraInitialized) {
         Serial.println("⚠️ Cámara no inicializada, no se puede capturar imagen");
         return;
     }
     
-    Serial.println("📸 Capturando imagen por ocupación del parqueo...");
+    static const char* REASONS[] = {"", "llegada", "salida", "periódica"};
+    Serial.printf("📸 Capturando imagen (%s, regla %d)...\n", REASONS[decision.reason], decision.rule);
+    
+    // Solo se escriben los registros que difieren del perfil anterior
+    if (cameraProfiles) {
+        camera.applyProfile(profileFor(decision));
+    }
     
-    // Capturar imagen
-    camera_fb_t *fb = esp_camera_fb_get();
+    // Capturar imagen (con el ajuste automático de calidad/resolución y el tope de la regla)
+    unsigned long captureStart = millis();
+    camera_fb_t *fb = camera.capture(decision.framesize);
     if (!fb) {
         Serial.println("❌ Error capturando imagen");
         return;
     }
     
-    Serial.printf("📸 Imagen capturada: %dx%d, %d bytes\n", fb->width, fb->height, fb->len);
+    CameraSwitchStats switchStats = camera.getSwitchStats();
+    if (switchStats.switches != reportedSwitches) {
+        reportedSwitches = switchStats.switches;
+        Serial.printf("📷 Primer cuadro tras el cambio en %lu us (%u escrituras omitidas, %u resincronizaciones)\n",
+                      switchStats.lastSwitchUs, (unsigned)switchStats.writesSkipped,
+                      (unsigned)switchStats.windowResyncs);
+    }
+    
+    JpegSettings used = camera.getLastSettings();
+    Serial.printf("📸 Imagen capturada: %dx%d, %d bytes (calidad %d, presupuesto %d bytes)\n",
+                  fb->width, fb->height, fb->len, used.quality, (int)camera.getTuner().byteBudget());
+    if (camera.hasRegionOfInterest()) {
+        CameraRoiStats roiStats = camera.getRoiStats();
+        Serial.printf("📐 Región %ux%u: %u de %u bytes, recorte en %lu us\n",
+                      (unsigned)fb->width, (unsigned)fb->height, (unsigned)roiStats.lastBytes,
+                      (unsigned)roiStats.lastFullBytes, roiStats.lastCropUs);
+    }
     
-    // Simular envío de imagen (sin enviar realmente para reducir latencia)
-    if (parkingSensor.isTcpConnected()) {
-        Serial.println("🔄 Simulando codificación de imagen en base64...");
-        
-        // Simular tamaño de base64 sin codificar realmente
-        size_t estimatedBase64Size = (fb->len * 4) / 3 + 4; // Estimación aproximada
-        Serial.printf("📊 Base64 estimado: %d caracteres\n", estimatedBase64Size);
-        
-        // Simular mensaje sin enviarlo
-        Serial.println("📤 [SIMULADO] Imagen enviada por TCP (parqueo ocupado)");
-        Serial.println("📥 [SIMULADO] Respuesta del servidor: {\"status\":\"success\",\"message\":\"Imagen recibida correctamente\"}");
-        
-        // No hay delay ni envío real para reducir latencia
+    // Envío real: base64 por bloques directo al socket, sin copiar la imagen
+    if (parkingSensor.sendImage(fb->buf, fb->len)) {
+        Serial.printf("📤 Imagen enviada por TCP (%lu ms desde la captura)\n", millis() - captureStart);
     } else {
         Serial.println("⚠️ No conectado al servidor TCP, imagen no enviada");
     }
     
     // Liberar buffer
-    esp_camera_fb_return(fb);
+    camera.release(fb);
+}
+
+// Respuesta del servidor a la imagen: alimenta la estimación del enlace
+void onImageAck(size_t wireBytes, unsigned long uploadMs, bool accepted) {
+    camera.reportUpload(wireBytes, uploadMs);
+    JpegSettings used = camera.getLastSettings();
+    Serial.printf("📥 Imagen %s en %lu ms (%u bytes)\n",
+                  accepted ? "recibida" : "rechazada", uploadMs, (unsigned)wireBytes);
+    
+    // Línea de traza para jpeg_tuning_sim: rssi,bytes_enviados,ms,bytes_jpeg,calidad,resolución
+    Serial.printf("JPEGTRACE,%d,%u,%lu,%u,%d,%d\n", WiFi.RSSI(), (unsigned)wireBytes, uploadMs,
+                  (unsigned)camera.getLastFrameBytes(), used.quality, (int)used.framesize);
+}
+
+// Confirmación de un cambio del ultrasonido con la cámara; false = vetado
+bool verifyTransition(bool occupied, float distance) {
+#if USE_OCCUPANCY_CLASSIFIER
+    if (!cameraInitialized) {
+        return true;
+    }
+    static const char* verdicts[] = {"confirmado", "vetado", "dudoso"};
+    OccupancyVerdict verdict = occupancyClassifier.verify(occupied, camera);
+    OccupancyClassifierStats stats = occupancyClassifier.getStats();
+    Serial.printf("🧠 %s a %.1f cm: %s (margen %.1f, %lu ms, inferencia %lu µs)\n",
+                  occupied ? "Llegada" : "Salida", distance, verdicts[verdict],
+                  stats.lastMargin, stats.lastLatencyUs / 1000, stats.lastInferenceUs);
+    return verdict != OCCUPANCY_VETOED;
+#else
+    (void)occupied;
+    (void)distance;
+    return true;
+#endif
+}
+
+// Trama del sensor propio en modo hoja, gateway o telemetría UDP
+bool sendNodeFrame(const uint8_t* frame, size_t length) {
+#if NODE_ROLE == NODE_LEAF
+    return localLink.send(frame, length);
+#elif NODE_ROLE == NODE_GATEWAY
+    return gateway.submit(frame, length);
+#elif USE_UDP_TELEMETRY
+    return udpTelemetry.send(frame, length);
+#else
+    (void)frame;
+    (void)length;
+    return false;
+#endif
 }
 
 // Función para mostrar información del sistema
@@ -173,8 +332,11 @@ void printSystemInfo() {
     Serial.println("=== INFORMACIÓN DEL SISTEMA ===");
     Serial.println("ESP32 Parking Sensor + Camera v1.0");
     Serial.printf("ID de parqueo: %d\n", PARKING_ID);
+    Serial.printf("Placa: %s\n", hal::BOARD.name);
     Serial.printf("Pines sensor: Trig=%d, Echo=%d\n", TRIG_PIN, ECHO_PIN);
     Serial.printf("Servidor TCP: %s:%d\n", SERVER_IP, SERVER_PORT);
+    static const char* ROLES[] = {"directo", "hoja", "gateway"};
+    Serial.printf("Rol: %s\n", ROLES[NODE_ROLE]);
     Serial.printf("Cámara: %s\n", cameraInitialized ? "Inicializada" : "No inicializada");
     Serial.printf("Memoria libre: %d bytes\n", esp_get_free_heap_size());
     Serial.printf("Uptime: %lu segundos\n", millis() / 1000);
@@ -188,17 +350,78 @@ void setup() {
   Serial.println("🚗 ESP32 Parking Sensor System v1.0");
   Serial.println("=====================================");
 
+  // Lo primero: recuperar el registro del arranque anterior
+  hal::ResetReason resetReason = hal::resetReason();
+  if (postmortem.begin(resetReason, millis())) {
+    const PostmortemBoot& previous = postmortem.getPrevious();
+    Serial.printf("🩺 Arranque #%lu tras reinicio por %s (anterior: %lu s, heap mínimo %lu bytes, loop máx %u ms)\n",
+                  (unsigned long)postmortem.getBootCount(), postmortemResetName(resetReason),
+                  (unsigned long)previous.uptimeMs / 1000, (unsigned long)previous.minFreeHeap,
+                  (unsigned)previous.maxLoopMs);
+  } else {
+    Serial.printf("🩺 Arranque en frío (%s)\n", postmortemResetName(resetReason));
+  }
+
   // Mostrar información del sistema
   printSystemInfo();
 
   // Inicializar la cámara
-  cameraInitialized = initCamera();
+  Serial.println("📸 Inicializando cámara...");
+  cameraInitialized = camera.begin();
   if (!cameraInitialized) {
     Serial.println("⚠️ Advertencia: Cámara no inicializada, solo funcionará el sensor");
   }
+  camera.setAutoTune(true);
+  camera.getTuner().setTargetUploadMs(JPEG_TARGET_UPLOAD_MS);
+#if JPEG_TUNE_RESOLUTION
+  camera.getTuner().setFramesizeRange(FRAMESIZE_QQVGA, FRAMESIZE_QVGA);
+#endif
+  camera.setRegionOfInterest(CAMERA_ROI);
+  for (size_t i = 0; i < sizeof(CAPTURE_RULES) / sizeof(CAPTURE_RULES[0]); i++) {
+    if (!capturePolicy.addRule(CAPTURE_RULES[i])) {
+      Serial.printf("⚠️ Regla de captura inválida: %s\n", CAPTURE_RULES[i]);
+    }
+  }
 
   // Inicializar el sensor de parqueo
   parkingSensor.begin();
+  Hcsr04::begin();
+  parkingSensor.setPing(Hcsr04::ping);
+  parkingSensor.setConfigHandler(applyCameraConfig);
+  parkingSensor.setImageAckHandler(onImageAck);
+  parkingSensor.setHeartbeatInterval(HEARTBEAT_INTERVAL_MS);
+  if (RAW_STREAM_MS > 0) {
+    parkingSensor.setRawStream(RAW_STREAM_MS);
+  }
+  parkingSensor.setPostmortem(&postmortem);
+#if ENABLE_OTA
+  parkingSensor.setOtaUpdater(&otaUpdater);
+#endif
+#if USE_OCCUPANCY_CLASSIFIER
+  occupancyClassifier.setLatencyBudget(OCCUPANCY_BUDGET_MS * 1000UL);
+  occupancyClassifier.setVetoHold(OCCUPANCY_VETO_HOLD_MS);
+  Serial.printf("🧠 Clasificador de ocupación: kernel %s\n",
+                occupancyClassifier.begin() ? "vectorial (PIE)" : "escalar");
+  parkingSensor.setTransitionVerifier(verifyTransition);
+#endif
+#if USE_TLS
+  tlsClient.setCACert(SERVER_CA_CERT);
+  parkingSensor.setTransport(&tlsClient);
+#endif
+
+#if NODE_ROLE == NODE_LEAF
+  // Hoja: la radio en el canal del gateway, sin asociarse al AP
+  WiFi.mode(WIFI_STA);
+  esp_wifi_set_channel(GATEWAY_CHANNEL, WIFI_SECOND_CHAN_NONE);
+  if (!localLink.beginLeaf(GATEWAY_MAC)) {
+    Serial.println("❌ Error: no se pudo iniciar ESP-NOW, reiniciando en 5 segundos...");
+    delay(5000);
+    ESP.restart();
+  }
+  parkingSensor.setFrameSender(sendNodeFrame);
+  Serial.printf("🛰️ Modo hoja: tramas por ESP-NOW a %s (canal %d)\n", GATEWAY_MAC, GATEWAY_CHANNEL);
+  return;
+#endif
 
   // Configurar Wi-Fi
   Serial.println("=== CONFIGURANDO WIFI ===");
@@ -229,6 +452,42 @@ void setup() {
     Serial.println("  DNS: " + WiFi.dnsIP().toString());
     Serial.println("================================");
     
+    // Hora local para los horarios de captura (sin bloquear: llega en segundo plano)
+    configTzTime(TIMEZONE, NTP_SERVER);
+    
+#if NODE_ROLE == NODE_GATEWAY
+    if (WiFi.channel() != GATEWAY_CHANNEL) {
+      Serial.printf("⚠️ El AP está en el canal %d y las hojas usan el %d: ajustar GATEWAY_CHANNEL\n",
+                    WiFi.channel(), GATEWAY_CHANNEL);
+    }
+    if (localLink.beginGateway()) {
+      gateway.setLink(&localLink);
+    } else {
+      Serial.println("⚠️ ESP-NOW no disponible: el gateway solo reenvía su propio sensor");
+    }
+    gateway.setLeafHeartbeat(HEARTBEAT_INTERVAL_MS);
+#if USE_TLS
+    gateway.setTransport(&tlsClient);
+#endif
+    gateway.begin();
+    parkingSensor.setFrameSender(sendNodeFrame);
+    Serial.printf("🛰️ Modo gateway: hojas por ESP-NOW (MAC %s, canal %d)\n",
+                  WiFi.macAddress().c_str(), WiFi.channel());
+#endif
+#if NODE_ROLE == NODE_DIRECT && USE_UDP_TELEMETRY
+    if (udpTelemetry.begin()) {
+      parkingSensor.setFrameSender(sendNodeFrame);
+    } else {
+      Serial.println("⚠️ No se pudo abrir el socket UDP: se sigue por TCP");
+    }
+#endif
+#if ENABLE_LIVE_VIEW
+    liveView.setMaxFps(LIVE_VIEW_FPS);
+    if (cameraInitialized && liveView.begin() && liveView.start()) {
+      Serial.println("🎥 Vista en vivo: http://" + WiFi.localIP().toString() + ":" + String(LIVEVIEW_PORT) + "/stream");
+    }
+#endif
+    
     Serial.println("=== SISTEMA INICIADO ===");
     Serial.println("El sensor de parqueo está monitoreando...");
     Serial.println("Los datos se enviarán por TCP al servidor");
@@ -242,50 +501,89 @@ void setup() {
     Serial.println("  - Señal WiFi suficiente");
     Serial.println("Reiniciando en 5 segundos...");
     delay(5000);
+    postmortem.record(PM_RESTART, PM_RESTART_WIFI, millis());
     ESP.restart();
   }
 }
 
 void loop() {
+  unsigned long loopStart = millis();
+  
+#if NODE_ROLE != NODE_LEAF
   // Verificar conexión WiFi cada 10 segundos
   static unsigned long lastWiFiCheck = 0;
+  static bool wifiLost = false;
   if (millis() - lastWiFiCheck > 10000) {
     if (WiFi.status() != WL_CONNECTED) {
       Serial.println("⚠️ WiFi desconectado! Intentando reconectar...");
+      if (!wifiLost) {
+        postmortem.record(PM_WIFI_LOST, 0, millis());
+        wifiLost = true;
+      }
       WiFi.reconnect();
       lastWiFiCheck = millis();
       return;
     }
+    if (wifiLost) {
+      postmortem.record(PM_WIFI_UP, WiFi.RSSI(), millis());
+      wifiLost = false;
+    }
     lastWiFiCheck = millis();
   }
+#endif
   
   // Actualizar el sensor de parqueo (maneja mediciones y envío TCP)
   parkingSensor.update();
+#if NODE_ROLE == NODE_GATEWAY
+  gateway.update();
+#endif
+#if NODE_ROLE == NODE_DIRECT && USE_UDP_TELEMETRY
+  udpTelemetry.update();
+#endif
   
-  // Capturar y enviar imagen solo cuando el parqueo se ocupe
-  if (cameraInitialized && parkingSensor.hasStateChanged() && parkingSensor.getIsOccupied()) {
-    // Solo enviar imagen si cambió de LIBRE a OCUPADO
-    if (!lastParkingState && parkingSensor.getIsOccupied()) {
-      captureAndSendImage();
-      imageSentForCurrentOccupation = true;
-      Serial.println("📸 Imagen enviada por ocupación del parqueo");
+  // La cámara y la red solo se usan cuando una regla de captura dispara
+  if (cameraInitialized) {
+    CaptureDecision decision = capturePolicy.update(parkingSensor.getIsOccupied(), millis(), localMinuteOfDay());
+    if (decision.fire()) {
+      captureAndSendImage(decision);
     }
   }
   
-  // Actualizar estado anterior
-  lastParkingState = parkingSensor.getIsOccupied();
-  
-  // Resetear flag cuando el parqueo se libere
-  if (!parkingSensor.getIsOccupied()) {
-    imageSentForCurrentOccupation = false;
-  }
-  
   // Mostrar estado del sistema cada 30 segundos
   static unsigned long lastStatusPrint = 0;
   if (millis() - lastStatusPrint > 30000) {
     Serial.println(parkingSensor.getStatusString());
+#if NODE_ROLE == NODE_GATEWAY
+    const GatewayStats& gw = gateway.getStats();
+    Serial.printf("🛰️ Gateway: %u hojas, %lu tramas reenviadas, %u en cola, %lu duplicadas, %lu descartadas, %lu lotes\n",
+                  (unsigned)gw.leaves, (unsigned long)gw.forwarded, (unsigned)gw.queued,
+                  (unsigned long)gw.duplicates, (unsigned long)gw.dropped, (unsigned long)gw.batchesAcked);
+#endif
+#if NODE_ROLE == NODE_DIRECT && USE_UDP_TELEMETRY
+    const TelemetryStats& udp = udpTelemetry.getStats();
+    Serial.printf("📡 UDP: %lu tramas, %lu confirmadas, %lu retransmisiones, %lu perdidas, %u en vuelo, %lu ms con radio ocupada\n",
+                  (unsigned long)udp.sent, (unsigned long)udp.acked, (unsigned long)udp.retransmits,
+                  (unsigned long)udp.lost, (unsigned)udpTelemetry.getPending(), udp.activeMs);
+#endif
+#if ENABLE_LIVE_VIEW
+    LiveViewStats live = liveView.getStats();
+    if (live.viewers > 0) {
+      Serial.printf("🎥 Vista en vivo: %u visores, %lu cuadros (%lu saltados por el sensor), %lu cortes, cuadro tomado hasta %lu µs\n",
+                    (unsigned)live.viewers, (unsigned long)live.frames, (unsigned long)live.skipped,
+                    (unsigned long)(live.idleDrops + live.sessionEnds), live.maxHoldUs);
+    }
+#endif
+#if USE_TLS
+    const hal::TlsStats& tls = tlsClient.getStats();
+    Serial.printf("🔒 TLS: %u completos, %u reanudados, %u fallidos; último %lu ms (%s), heap %u bytes\n",
+                  (unsigned)tls.fullHandshakes, (unsigned)tls.resumedHandshakes, (unsigned)tls.failedHandshakes,
+                  (unsigned long)(tls.lastHandshakeUs / 1000), tls.lastResumed ? "reanudado" : "completo",
+                  (unsigned)tls.connectionBytes);
+#endif
     lastStatusPrint = millis();
   }
   
+  // Duración de la vuelta (sin la espera) y heap libre para el registro postmortem
+  postmortem.sample(millis(), millis() - loopStart, esp_get_free_heap_size());
   delay(100);
 }
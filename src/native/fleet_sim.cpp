@@ -0,0 +1,734 @@
+// Simulador de flota (env "fleet_sim"): N instancias del ParkingSensor real,
+// una por hilo, cada una con su placa simulada, una traza sintética de
+// distancia y su propia conexión TCP al servidor. Con --gateways las
+// instancias son hojas (ParkingSensor::setFrameSender) que envían tramas por
+// UDP local a G gateways, y solo los gateways se conectan al servidor. Con
+// --transport udp cada instancia envía sus tramas en datagramas al servidor
+// (lib/UdpTelemetry) en lugar de mantener una conexión TCP.
+//
+// Uso: .pio/build/fleet_sim/program [opciones]
+//   --devices N        instancias (500)
+//   --server HOST      servidor (127.0.0.1)
+//   --port P           puerto (8080)
+//   --duration S       segundos reales de simulación (60)
+//   --speed X          aceleración del reloj de las placas (1.0)
+//   --mean-free S      duración media de un espacio libre, en s simulados (120)
+//   --mean-occupied S  duración media de una ocupación, en s simulados (300)
+//   --noise CM         desviación estándar del ruido de medición (1.5)
+//   --dropout P        probabilidad de una medición sin eco (0.02)
+//   --seed K           semilla de las trazas (1)
+//   --first-id N       parkingId de la primera instancia (1)
+//   --image-rate P     probabilidad de subir una imagen al ocuparse el espacio (0)
+//   --image-bytes N    tamaño del JPEG sintético (12000)
+//   --heartbeat MS     modo heartbeat con ese intervalo en ms simulados (0 = apagado)
+//   --tls CA.pem       conectar por TLS verificando con esa CA (parking_server.py --tls-cert)
+//   --gateways G       modo gateway: las instancias se reparten entre G gateways (0 = directo)
+//   --transport T      tcp o udp: cómo llegan al servidor los eventos y heartbeats (tcp)
+//   --loss P           pérdida de paquetes simulada hacia y desde el servidor (0)
+//
+// Imprime un informe JSON en stdout: eventos por segundo, distribución de la
+// latencia de ingesta (requiere parking_server.py --ack-events), imágenes
+// confirmadas por segundo y su tiempo de subida, línea de tiempo por segundo
+// y tormentas de reconexión detectadas. Para comparar los dos modos también
+// informa asociaciones al punto de acceso, conexiones con el servidor y
+// mensajes hacia el servidor por segundo; en modo gateway la latencia va
+// desde que la trama llega al gateway hasta el GWK de su lote, y en UDP
+// desde el primer envío de la trama hasta su confirmación.
+//
+// radio_on es el tiempo real por instancia con la radio ocupada con el
+// servidor: en TCP lo que tarda update() (connect y envíos, con las
+// retransmisiones simuladas por --loss) más la espera de cada EVT; en UDP el
+// tiempo con tramas sin confirmar. En TCP la conexión además queda abierta
+// (connection_open) y el ESP32 no puede dormir la radio entre eventos.
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Hal.h"
+#include "HalTls.h"
+#include "HalLink.h"
+#include "Gateway.h"
+#include "ParkingSensor.h"
+#include "UdpTelemetry.h"
+
+struct SimOptions {
+    int devices = 500;
+    const char* server = "127.0.0.1";
+    int port = 8080;
+    double duration = 60.0;
+    double speed = 1.0;
+    double meanFree = 120.0;
+    double meanOccupied = 300.0;
+    double noise = 1.5;
+    double dropout = 0.02;
+    unsigned seed = 1;
+    int firstId = 1;
+    double imageRate = 0.0;
+    int imageBytes = 12000;
+    unsigned long heartbeat = 0;
+    std::string caCert;                 // PEM de --tls; vacío = TCP plano
+    int gateways = 0;
+    std::vector<uint16_t> gatewayPorts; // Puerto UDP de cada gateway (efímero)
+    bool udp = false;                   // --transport udp
+    double loss = 0.0;
+};
+
+// Traza sintética de un espacio: llegadas/salidas exponenciales, ruido,
+// mediciones sin eco aisladas y cortes de varios segundos.
+struct SpotTrace {
+    std::mt19937 rng;
+    const SimOptions* options;
+    bool occupied;
+    unsigned long nextChangeMs;
+    unsigned long dropoutUntilMs;
+    float baseDistance;
+};
+
+static double exponential(std::mt19937& rng, double mean) {
+    std::exponential_distribution<double> distribution(1.0 / mean);
+    return distribution(rng);
+}
+
+static float spotDistance(void* context, unsigned long nowMs) {
+    SpotTrace& trace = *(SpotTrace*)context;
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    while (nowMs >= trace.nextChangeMs) {
+        trace.occupied = !trace.occupied;
+        double mean = trace.occupied ? trace.options->meanOccupied : trace.options->meanFree;
+        trace.nextChangeMs += (unsigned long)(exponential(trace.rng, mean) * 1000.0) + 1;
+        // Auto: techo del vehículo a 10-45 cm; libre: piso a 60-300 cm
+        trace.baseDistance = trace.occupied ? 10.0f + 35.0f * uniform(trace.rng)
+                                            : 60.0f + 240.0f * uniform(trace.rng);
+    }
+
+    if (nowMs < trace.dropoutUntilMs) {
+        return -1.0f;
+    }
+    float roll = uniform(trace.rng);
+    if (roll < trace.options->dropout) {
+        // Uno de cada diez fallos es un corte de 2-10 s (lluvia, obstrucción)
+        if (roll < trace.options->dropout / 10.0f) {
+            trace.dropoutUntilMs = nowMs + 2000 + (unsigned long)(8000.0f * uniform(trace.rng));
+        }
+        return -1.0f;
+    }
+
+    std::normal_distribution<float> noise(0.0f, (float)trace.options->noise);
+    return trace.baseDistance + noise(trace.rng);
+}
+
+// Contadores de una instancia, leídos por el hilo de muestreo
+struct DeviceStats {
+    std::atomic<bool> connected{false};
+    std::atomic<unsigned long> connectAttempts{0};
+    std::atomic<unsigned long> eventsSent{0};
+    std::atomic<unsigned long> eventAcks{0};
+    std::atomic<unsigned long> imagesSent{0};
+    std::atomic<unsigned long> imageAcks{0};
+    std::atomic<unsigned long> imagesRejected{0};
+    std::atomic<unsigned long> heartbeatsSent{0};
+    std::atomic<unsigned long> datagrams{0};  // --transport udp, con retransmisiones
+    hal::TlsStats tls = {};                   // Copia al terminar (--tls)
+    hal::LinkStats link = {};                 // Copia al terminar (modo hoja)
+    TelemetryStats telemetry = {};            // Copia al terminar (--transport udp)
+    unsigned long radioUs = 0;                // Ver radio_on; se lee al terminar
+    unsigned long connectedUs = 0;
+    std::vector<unsigned long> latenciesUs;   // Solo lo escribe el hilo de la instancia
+    std::vector<unsigned long> uploadsMs;     // Subidas de imagen confirmadas (ms reales)
+};
+
+// Contadores de un gateway (--gateways)
+struct GatewayNode {
+    hal::LocalLink link;                      // Abierto antes de lanzar las hojas
+    std::atomic<bool> connected{false};
+    std::atomic<unsigned long> connectAttempts{0};
+    std::atomic<unsigned long> batchesSent{0};
+    std::atomic<unsigned long> eventAcks{0};
+    GatewayStats stats = {};                  // Copia al terminar
+    std::vector<unsigned long> latenciesUs;   // Solo lo escribe el hilo del gateway
+};
+
+static std::atomic<bool> stopRequested(false);
+
+// Estadísticas y velocidad del reloj de la instancia del hilo actual, para el
+// manejador de respuestas a imágenes (un puntero a función sin contexto)
+static thread_local DeviceStats* threadStats = NULL;
+static thread_local double threadSpeed = 1.0;
+static thread_local hal::LocalLink* threadLink = NULL;
+static thread_local GatewayNode* threadGateway = NULL;
+static thread_local UdpTelemetry* threadTelemetry = NULL;
+
+static void onImageAck(size_t wireBytes, unsigned long uploadMs, bool accepted) {
+    (void)wireBytes;
+    if (accepted) {
+        threadStats->imageAcks.fetch_add(1, std::memory_order_relaxed);
+        threadStats->uploadsMs.push_back((unsigned long)(uploadMs / threadSpeed));
+    } else {
+        threadStats->imagesRejected.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static bool sendToGateway(const uint8_t* frame, size_t length) {
+    return threadLink->send(frame, length);
+}
+
+static bool sendToServer(const uint8_t* frame, size_t length) {
+    return threadTelemetry->send(frame, length);
+}
+
+static void onTelemetryAck(uint8_t type, unsigned long latencyUs) {
+    if (type == GW_FRAME_EVENT) {
+        threadStats->latenciesUs.push_back((unsigned long)(latencyUs / threadSpeed));
+        threadStats->eventAcks.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static unsigned long elapsedUs(const std::chrono::steady_clock::time_point& since) {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+static void onGatewayAck(uint8_t type, unsigned long latencyUs) {
+    if (type == GW_FRAME_EVENT) {
+        threadGateway->latenciesUs.push_back((unsigned long)(latencyUs / threadSpeed));
+        threadGateway->eventAcks.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// JPEG sintético: marcadores válidos y contenido distinto en cada captura
+// para que la deduplicación del servidor no los descarte
+static void fillImage(std::vector<uint8_t>& image, std::mt19937& rng) {
+    image[0] = 0xFF;
+    image[1] = 0xD8;
+    for (size_t i = 2; i + 2 < image.size(); i += 4) {
+        uint32_t word = rng();
+        for (size_t j = 0; j < 4 && i + j + 2 < image.size(); j++) {
+            image[i + j] = (uint8_t)(word >> (8 * j));
+        }
+    }
+    image[image.size() - 2] = 0xFF;
+    image[image.size() - 1] = 0xD9;
+}
+
+static void runDevice(int index, const SimOptions& options, DeviceStats& stats) {
+    SpotTrace trace;
+    trace.rng.seed(options.seed * 7919u + (unsigned)index);
+    trace.options = &options;
+    trace.occupied = std::uniform_int_distribution<int>(0, 1)(trace.rng) == 1;
+    trace.nextChangeMs = 0;
+    trace.dropoutUntilMs = 0;
+    trace.baseDistance = 100.0f;
+
+    hal::sim::Board board;
+    hal::sim::initBoard(board);
+    board.serialEnabled = false;
+    board.timeScale = options.speed;
+    board.distanceSource = spotDistance;
+    board.context = &trace;
+    board.packetLoss = options.loss;
+    hal::sim::bindBoard(&board);
+
+    // Arranque escalonado en el primer segundo, como una flota real encendiéndose
+    usleep((useconds_t)(std::uniform_int_distribution<int>(0, 999)(trace.rng) * 1000));
+
+    ParkingSensor sensor(35, 36, options.firstId + index, options.server, options.port);
+    hal::TlsClient tls;
+    if (!options.caCert.empty()) {
+        tls.setCACert(options.caCert.c_str());
+        sensor.setTransport(&tls);
+    }
+    sensor.begin();
+    sensor.setHeartbeatInterval(options.heartbeat);
+
+    // Hoja: sin WiFi ni TCP, tramas por el enlace local a su gateway
+    hal::LocalLink link;
+    if (options.gateways > 0) {
+        char address[32];
+        snprintf(address, sizeof(address), "127.0.0.1:%u",
+                 (unsigned)options.gatewayPorts[index % options.gateways]);
+        link.beginLeaf(address);
+        threadLink = &link;
+        sensor.setFrameSender(sendToGateway);
+    }
+
+    threadStats = &stats;
+    threadSpeed = options.speed;
+
+    // UDP: sin conexión; cada trama en un datagrama confirmado por el servidor
+    UdpTelemetry telemetry(options.server, options.port);
+    if (options.udp) {
+        telemetry.begin(0);
+        telemetry.setAckHandler(onTelemetryAck);
+        threadTelemetry = &telemetry;
+        sensor.setFrameSender(sendToServer);
+    }
+    sensor.setImageAckHandler(onImageAck);
+    std::vector<uint8_t> image(options.imageRate > 0 ? std::max(options.imageBytes, 4) : 0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    unsigned long seenAcks = 0;
+    bool wasOccupied = sensor.getIsOccupied();
+    bool radioBusy = false;
+    std::chrono::steady_clock::time_point lastLoop = std::chrono::steady_clock::now();
+    while (!stopRequested.load(std::memory_order_relaxed)) {
+        // La vuelta anterior, si quedó esperando una confirmación
+        unsigned long loopUs = elapsedUs(lastLoop);
+        if (radioBusy) {
+            stats.radioUs += loopUs;
+        }
+        if (sensor.isTcpConnected()) {
+            stats.connectedUs += loopUs;
+        }
+
+        std::chrono::steady_clock::time_point updateStart = std::chrono::steady_clock::now();
+        sensor.update();
+        if (options.udp) {
+            telemetry.update();
+        } else if (options.gateways == 0) {
+            stats.radioUs += elapsedUs(updateStart);
+        }
+        lastLoop = std::chrono::steady_clock::now();
+
+        // Como src/main.cpp: una imagen justo después del evento de ocupación
+        bool occupied = sensor.getIsOccupied();
+        if (occupied && !wasOccupied && sensor.isTcpConnected() && uniform(trace.rng) < options.imageRate) {
+            fillImage(image, trace.rng);
+            if (sensor.sendImage(image.data(), image.size())) {
+                stats.imagesSent.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        wasOccupied = occupied;
+
+        if (sensor.getEventAcks() != seenAcks) {
+            seenAcks = sensor.getEventAcks();
+            // La latencia se mide con el reloj acelerado de la placa: pasar a µs reales
+            stats.latenciesUs.push_back((unsigned long)(sensor.getLastIngestLatency() / options.speed));
+        }
+        stats.connected.store(sensor.isTcpConnected(), std::memory_order_relaxed);
+        stats.connectAttempts.store(sensor.getConnectAttempts(), std::memory_order_relaxed);
+        stats.eventsSent.store(sensor.getEventsSent(), std::memory_order_relaxed);
+        if (!options.udp) {
+            stats.eventAcks.store(seenAcks, std::memory_order_relaxed);
+        }
+        stats.heartbeatsSent.store(sensor.getHeartbeatsSent(), std::memory_order_relaxed);
+        stats.datagrams.store(telemetry.getStats().datagrams, std::memory_order_relaxed);
+
+        // Esperando confirmación: sondear rápido para medir la latencia con precisión
+        // (las imágenes se miden en ms: basta con 5 ms reales)
+        radioBusy = options.udp ? telemetry.getPending() > 0 : sensor.isIngestAckPending();
+        if (radioBusy) {
+            usleep(500);
+        } else if (sensor.isImageAckPending()) {
+            usleep(5000);
+        } else {
+            hal::delayMs(100);
+        }
+    }
+    sensor.setTransport(NULL);
+    stats.tls = tls.getStats();
+    stats.link = link.getStats();
+    stats.telemetry = telemetry.getStats();
+    telemetry.end();
+    threadTelemetry = NULL;
+    hal::sim::bindBoard(NULL);
+}
+
+static void runGateway(int index, const SimOptions& options, GatewayNode& node) {
+    hal::sim::Board board;
+    hal::sim::initBoard(board);
+    board.serialEnabled = false;
+    board.timeScale = options.speed;
+    board.packetLoss = options.loss;
+    hal::sim::bindBoard(&board);
+
+    Gateway gateway(index + 1, options.server, options.port);
+    hal::TlsClient tls;
+    if (!options.caCert.empty()) {
+        tls.setCACert(options.caCert.c_str());
+        gateway.setTransport(&tls);
+    }
+    gateway.begin();
+    gateway.setLink(&node.link);
+    gateway.setLeafHeartbeat(options.heartbeat);
+
+    threadGateway = &node;
+    threadSpeed = options.speed;
+    gateway.setAckHandler(onGatewayAck);
+
+    while (!stopRequested.load(std::memory_order_relaxed)) {
+        gateway.update();
+        const GatewayStats& stats = gateway.getStats();
+        node.connected.store(gateway.isConnected(), std::memory_order_relaxed);
+        node.connectAttempts.store(stats.connectAttempts, std::memory_order_relaxed);
+        node.batchesSent.store(stats.batchesSent, std::memory_order_relaxed);
+        // 1 ms real: la latencia del lote no depende del sondeo
+        usleep(1000);
+    }
+    gateway.setTransport(NULL);
+    node.stats = gateway.getStats();
+    hal::sim::bindBoard(NULL);
+}
+
+struct Sample {
+    double t;
+    int connected;
+    unsigned long connectAttempts;
+    unsigned long eventsSent;
+    unsigned long eventAcks;
+    unsigned long imagesSent;
+    unsigned long imageAcks;
+    unsigned long upstreamMessages;     // Líneas hacia el servidor (eventos y heartbeats, o lotes)
+};
+
+static double percentile(const std::vector<unsigned long>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t index = (size_t)(p / 100.0 * (double)(sorted.size() - 1) + 0.5);
+    return (double)sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Suma de los TlsStats de las instancias
+struct TlsTotals {
+    unsigned long full = 0;
+    unsigned long resumed = 0;
+    unsigned long failed = 0;
+    std::vector<unsigned long> lastHandshakeUs;  // Último handshake de cada instancia conectada
+};
+
+// Tiempo con la radio ocupada y con la conexión abierta (ver radio_on) y la
+// suma de los TelemetryStats (--transport udp)
+struct RadioTotals {
+    std::vector<unsigned long> radioMs;       // Uno por instancia, ms reales
+    unsigned long connectedMs = 0;
+    TelemetryStats telemetry = {};
+};
+
+// Suma de los gateways y de los enlaces de las hojas (--gateways)
+struct GatewayTotals {
+    GatewayStats stats = {};
+    unsigned long leaves = 0;
+    hal::LinkStats link = {};
+};
+
+static bool parseOptions(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Falta el valor de %s\n", name);
+            return false;
+        }
+        const char* value = argv[++i];
+        if (strcmp(name, "--devices") == 0) options.devices = atoi(value);
+        else if (strcmp(name, "--server") == 0) options.server = value;
+        else if (strcmp(name, "--port") == 0) options.port = atoi(value);
+        else if (strcmp(name, "--duration") == 0) options.duration = atof(value);
+        else if (strcmp(name, "--speed") == 0) options.speed = atof(value);
+        else if (strcmp(name, "--mean-free") == 0) options.meanFree = atof(value);
+        else if (strcmp(name, "--mean-occupied") == 0) options.meanOccupied = atof(value);
+        else if (strcmp(name, "--noise") == 0) options.noise = atof(value);
+        else if (strcmp(name, "--dropout") == 0) options.dropout = atof(value);
+        else if (strcmp(name, "--seed") == 0) options.seed = (unsigned)atoi(value);
+        else if (strcmp(name, "--first-id") == 0) options.firstId = atoi(value);
+        else if (strcmp(name, "--image-rate") == 0) options.imageRate = atof(value);
+        else if (strcmp(name, "--image-bytes") == 0) options.imageBytes = atoi(value);
+        else if (strcmp(name, "--heartbeat") == 0) options.heartbeat = strtoul(value, NULL, 10);
+        else if (strcmp(name, "--gateways") == 0) options.gateways = atoi(value);
+        else if (strcmp(name, "--loss") == 0) options.loss = atof(value);
+        else if (strcmp(name, "--transport") == 0) {
+            if (strcmp(value, "udp") != 0 && strcmp(value, "tcp") != 0) {
+                fprintf(stderr, "Transporte desconocido: %s (tcp o udp)\n", value);
+                return false;
+            }
+            options.udp = strcmp(value, "udp") == 0;
+        }
+        else if (strcmp(name, "--tls") == 0) {
+            std::ifstream file(value);
+            std::stringstream pem;
+            pem << file.rdbuf();
+            options.caCert = pem.str();
+            if (options.caCert.empty()) {
+                fprintf(stderr, "No se pudo leer el certificado: %s\n", value);
+                return false;
+            }
+        }
+        else {
+            fprintf(stderr, "Opción desconocida: %s\n", name);
+            return false;
+        }
+    }
+    return options.devices > 0 && options.duration > 0 && options.speed > 0 &&
+           options.gateways >= 0 && options.gateways <= options.devices &&
+           options.loss >= 0 && options.loss < 1 &&
+           !(options.udp && options.gateways > 0);  // Los gateways suben sus lotes por TCP
+}
+
+static void printReport(const SimOptions& options, const std::vector<Sample>& timeline,
+                        std::vector<unsigned long>& latencies, std::vector<unsigned long>& uploads,
+                        unsigned long imagesRejected, unsigned long heartbeatsSent,
+                        TlsTotals& tls, const GatewayTotals& gateways, RadioTotals& radio) {
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(uploads.begin(), uploads.end());
+    std::sort(radio.radioMs.begin(), radio.radioMs.end());
+    const Sample& last = timeline.back();
+    double elapsed = last.t > 0 ? last.t : 1.0;
+    // Quienes se asocian al punto de acceso y se conectan al servidor
+    int nodes = options.gateways > 0 ? options.gateways : options.devices;
+
+    printf("{\n");
+    printf("  \"devices\": %d,\n", options.devices);
+    printf("  \"mode\": \"%s\",\n", options.gateways > 0 ? "gateway" : "direct");
+    printf("  \"transport\": \"%s\",\n", options.udp ? "udp" : "tcp");
+    printf("  \"loss\": %.3f,\n", options.loss);
+    printf("  \"ap_associations\": %d,\n", nodes);
+    printf("  \"server_connections\": %d,\n", last.connected);
+    printf("  \"upstream_messages\": %lu,\n", last.upstreamMessages);
+    printf("  \"upstream_messages_per_second\": %.2f,\n", (double)last.upstreamMessages / elapsed);
+    printf("  \"duration_s\": %.1f,\n", elapsed);
+    printf("  \"speed\": %.2f,\n", options.speed);
+    printf("  \"events_sent\": %lu,\n", last.eventsSent);
+    printf("  \"events_acked\": %lu,\n", last.eventAcks);
+    printf("  \"events_per_second\": %.2f,\n", (double)last.eventsSent / elapsed);
+    printf("  \"heartbeats_sent\": %lu,\n", heartbeatsSent);
+    printf("  \"connect_attempts\": %lu,\n", last.connectAttempts);
+    if (options.gateways == 0) {
+        unsigned long radioTotal = 0;
+        for (unsigned long ms : radio.radioMs) {
+            radioTotal += ms;
+        }
+        double mean = radio.radioMs.empty() ? 0.0 : (double)radioTotal / (double)radio.radioMs.size();
+        printf("  \"radio_on_ms\": {\"mean\": %.0f, \"p50\": %.0f, \"p99\": %.0f, \"fraction\": %.4f},\n",
+               mean, percentile(radio.radioMs, 50), percentile(radio.radioMs, 99), mean / (elapsed * 1000.0));
+        printf("  \"connection_open_fraction\": %.4f,\n",
+               (double)radio.connectedMs / ((double)options.devices * elapsed * 1000.0));
+    }
+    if (options.udp) {
+        const TelemetryStats& u = radio.telemetry;
+        printf("  \"udp\": {\"frames\": %lu, \"datagrams\": %lu, \"retransmits\": %lu, \"acked\": %lu, "
+               "\"lost\": %lu, \"evicted\": %lu, \"acks_received\": %lu, \"pending_ms\": %lu},\n",
+               (unsigned long)u.sent, (unsigned long)u.datagrams, (unsigned long)u.retransmits,
+               (unsigned long)u.acked, (unsigned long)u.lost, (unsigned long)u.evicted,
+               (unsigned long)u.acksReceived, u.activeMs);
+    }
+    if (!options.caCert.empty()) {
+        std::sort(tls.lastHandshakeUs.begin(), tls.lastHandshakeUs.end());
+        printf("  \"tls\": {\"full_handshakes\": %lu, \"resumed_handshakes\": %lu, \"failed_handshakes\": %lu, "
+               "\"last_handshake_us\": {\"p50\": %.0f, \"p99\": %.0f}},\n",
+               tls.full, tls.resumed, tls.failed,
+               percentile(tls.lastHandshakeUs, 50), percentile(tls.lastHandshakeUs, 99));
+    }
+    if (options.gateways > 0) {
+        const GatewayStats& g = gateways.stats;
+        printf("  \"gateway\": {\"gateways\": %d, \"leaves\": %lu, \"frames_received\": %lu, "
+               "\"frames_forwarded\": %lu, \"duplicates\": %lu, \"dropped\": %lu, \"invalid\": %lu, "
+               "\"batches_sent\": %lu, \"batches_acked\": %lu, \"batches_resent\": %lu, "
+               "\"frames_per_batch\": %.1f, \"link_sent\": %lu, \"link_failures\": %lu, \"link_retries\": %lu},\n",
+               options.gateways, gateways.leaves, (unsigned long)g.received, (unsigned long)g.forwarded,
+               (unsigned long)g.duplicates, (unsigned long)g.dropped, (unsigned long)g.invalid,
+               (unsigned long)g.batchesSent, (unsigned long)g.batchesAcked, (unsigned long)g.batchesResent,
+               g.batchesAcked > 0 ? (double)g.forwarded / (double)g.batchesAcked : 0.0,
+               (unsigned long)gateways.link.sent, (unsigned long)gateways.link.sendFailures,
+               (unsigned long)gateways.link.retries);
+    }
+    printf("  \"ingest_latency_us\": {\"count\": %zu, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f},\n",
+           latencies.size(), percentile(latencies, 50), percentile(latencies, 90),
+           percentile(latencies, 99), percentile(latencies, 100));
+    printf("  \"images_sent\": %lu,\n", last.imagesSent);
+    printf("  \"images_acked\": %lu,\n", last.imageAcks);
+    printf("  \"images_rejected\": %lu,\n", imagesRejected);
+    printf("  \"images_per_second\": %.2f,\n", (double)last.imageAcks / elapsed);
+    printf("  \"image_upload_ms\": {\"count\": %zu, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f},\n",
+           uploads.size(), percentile(uploads, 50), percentile(uploads, 90),
+           percentile(uploads, 99), percentile(uploads, 100));
+
+    // Tormentas: caídas de más del 10% de conexiones y su recuperación
+    printf("  \"reconnect_storms\": [");
+    bool first = true;
+    for (size_t i = 1; i < timeline.size(); i++) {
+        if (timeline[i].connected >= timeline[i - 1].connected - nodes / 10 ||
+            timeline[i - 1].connected < nodes * 9 / 10) {
+            continue;
+        }
+        size_t dropIndex = i;
+        size_t recovered = 0;
+        unsigned long peakAttempts = 0;
+        for (size_t j = dropIndex; j < timeline.size(); j++) {
+            unsigned long attempts = timeline[j].connectAttempts - timeline[j - 1].connectAttempts;
+            peakAttempts = std::max(peakAttempts, attempts);
+            if (timeline[j].connected >= nodes * 99 / 100) {
+                recovered = j;
+                break;
+            }
+        }
+        unsigned long totalAttempts = timeline[recovered ? recovered : timeline.size() - 1].connectAttempts
+                                      - timeline[dropIndex - 1].connectAttempts;
+        // -1: no se recuperó antes de terminar la simulación
+        double recovery = recovered ? timeline[recovered].t - timeline[dropIndex].t : -1.0;
+        printf("%s\n    {\"at_s\": %.1f, \"min_connected\": %d, \"recovery_s\": %.1f, "
+               "\"peak_attempts_per_s\": %lu, \"attempts\": %lu}",
+               first ? "" : ",", timeline[dropIndex].t, timeline[dropIndex].connected,
+               recovery, peakAttempts, totalAttempts);
+        first = false;
+    }
+    printf("%s],\n", first ? "" : "\n  ");
+
+    printf("  \"timeline\": [");
+    for (size_t i = 0; i < timeline.size(); i++) {
+        const Sample& s = timeline[i];
+        printf("%s\n    {\"t\": %.1f, \"connected\": %d, \"connect_attempts\": %lu, \"events_sent\": %lu, "
+               "\"events_acked\": %lu, \"images_acked\": %lu}",
+               i ? "," : "", s.t, s.connected, s.connectAttempts, s.eventsSent, s.eventAcks, s.imageAcks);
+    }
+    printf("\n  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Uso: %s [--devices N] [--server HOST] [--port P] [--duration S] [--speed X] ...\n", argv[0]);
+        return 1;
+    }
+
+    // El hilo principal no habla por Serial; las instancias tienen su propia placa
+    hal::sim::setSerialEnabled(false);
+    fprintf(stderr, "🚗 Simulando %d sensores contra %s:%d durante %.0f s (x%.1f)\n",
+            options.devices, options.server, options.port, options.duration, options.speed);
+    if (options.udp || options.loss > 0) {
+        fprintf(stderr, "📡 Transporte %s, pérdida simulada %.1f%%\n", options.udp ? "UDP" : "TCP",
+                options.loss * 100.0);
+    }
+
+    // Los gateways abren su puerto antes de que arranquen las hojas
+    std::vector<GatewayNode> gateways(options.gateways);
+    for (GatewayNode& node : gateways) {
+        if (!node.link.beginGateway(0)) {
+            fprintf(stderr, "No se pudo abrir el enlace local de un gateway\n");
+            return 1;
+        }
+        options.gatewayPorts.push_back(node.link.port());
+    }
+    if (options.gateways > 0) {
+        fprintf(stderr, "🛰️ %d gateways, %d hojas por gateway\n", options.gateways,
+                (options.devices + options.gateways - 1) / options.gateways);
+    }
+
+    std::vector<DeviceStats> stats(options.devices);
+    std::vector<std::thread> threads;
+    threads.reserve(options.devices + options.gateways);
+    for (int g = 0; g < options.gateways; g++) {
+        threads.emplace_back(runGateway, g, std::cref(options), std::ref(gateways[g]));
+    }
+    for (int i = 0; i < options.devices; i++) {
+        threads.emplace_back(runDevice, i, std::cref(options), std::ref(stats[i]));
+    }
+
+    // Muestreo una vez por segundo real
+    std::vector<Sample> timeline;
+    Sample zero = {0.0, 0, 0, 0, 0, 0, 0, 0};
+    timeline.push_back(zero);
+    for (int second = 1; second <= (int)ceil(options.duration); second++) {
+        sleep(1);
+        Sample sample = {(double)second, 0, 0, 0, 0, 0, 0, 0};
+        for (DeviceStats& device : stats) {
+            sample.connected += device.connected.load(std::memory_order_relaxed) ? 1 : 0;
+            sample.connectAttempts += device.connectAttempts.load(std::memory_order_relaxed);
+            sample.eventsSent += device.eventsSent.load(std::memory_order_relaxed);
+            sample.eventAcks += device.eventAcks.load(std::memory_order_relaxed);
+            sample.imagesSent += device.imagesSent.load(std::memory_order_relaxed);
+            sample.imageAcks += device.imageAcks.load(std::memory_order_relaxed);
+            sample.upstreamMessages += options.udp ? device.datagrams.load(std::memory_order_relaxed)
+                                                   : device.eventsSent.load(std::memory_order_relaxed) +
+                                                     device.heartbeatsSent.load(std::memory_order_relaxed);
+        }
+        if (options.gateways > 0) {
+            // Las hojas no llegan al servidor: conexiones, intentos y
+            // confirmaciones son de los gateways
+            sample.connected = 0;
+            sample.connectAttempts = 0;
+            sample.eventAcks = 0;
+            sample.upstreamMessages = 0;
+            for (GatewayNode& node : gateways) {
+                sample.connected += node.connected.load(std::memory_order_relaxed) ? 1 : 0;
+                sample.connectAttempts += node.connectAttempts.load(std::memory_order_relaxed);
+                sample.eventAcks += node.eventAcks.load(std::memory_order_relaxed);
+                sample.upstreamMessages += node.batchesSent.load(std::memory_order_relaxed);
+            }
+        }
+        timeline.push_back(sample);
+        fprintf(stderr, "t=%3ds conectados=%d eventos=%lu imágenes=%lu\n", second, sample.connected,
+                sample.eventsSent, sample.imageAcks);
+    }
+
+    stopRequested.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<unsigned long> latencies;
+    std::vector<unsigned long> uploads;
+    unsigned long imagesRejected = 0;
+    unsigned long heartbeatsSent = 0;
+    TlsTotals tls;
+    for (DeviceStats& device : stats) {
+        tls.full += device.tls.fullHandshakes;
+        tls.resumed += device.tls.resumedHandshakes;
+        tls.failed += device.tls.failedHandshakes;
+        if (device.tls.fullHandshakes + device.tls.resumedHandshakes > 0) {
+            tls.lastHandshakeUs.push_back(device.tls.lastHandshakeUs);
+        }
+        latencies.insert(latencies.end(), device.latenciesUs.begin(), device.latenciesUs.end());
+        uploads.insert(uploads.end(), device.uploadsMs.begin(), device.uploadsMs.end());
+        imagesRejected += device.imagesRejected.load();
+        heartbeatsSent += device.heartbeatsSent.load();
+    }
+    GatewayTotals gatewayTotals;
+    for (GatewayNode& node : gateways) {
+        GatewayStats& total = gatewayTotals.stats;
+        total.received += node.stats.received;
+        total.invalid += node.stats.invalid;
+        total.duplicates += node.stats.duplicates;
+        total.dropped += node.stats.dropped;
+        total.forwarded += node.stats.forwarded;
+        total.batchesSent += node.stats.batchesSent;
+        total.batchesAcked += node.stats.batchesAcked;
+        total.batchesResent += node.stats.batchesResent;
+        gatewayTotals.leaves += node.stats.leaves;
+        latencies.insert(latencies.end(), node.latenciesUs.begin(), node.latenciesUs.end());
+    }
+    for (DeviceStats& device : stats) {
+        gatewayTotals.link.sent += device.link.sent;
+        gatewayTotals.link.sendFailures += device.link.sendFailures;
+        gatewayTotals.link.retries += device.link.retries;
+    }
+    RadioTotals radio;
+    for (DeviceStats& device : stats) {
+        radio.radioMs.push_back(device.radioUs / 1000);
+        radio.connectedMs += device.connectedUs / 1000;
+        TelemetryStats& total = radio.telemetry;
+        total.sent += device.telemetry.sent;
+        total.datagrams += device.telemetry.datagrams;
+        total.retransmits += device.telemetry.retransmits;
+        total.acked += device.telemetry.acked;
+        total.lost += device.telemetry.lost;
+        total.evicted += device.telemetry.evicted;
+        total.acksReceived += device.telemetry.acksReceived;
+        total.activeMs += (unsigned long)(device.telemetry.activeMs / options.speed);
+    }
+    printReport(options, timeline, latencies, uploads, imagesRejected, heartbeatsSent, tls, gatewayTotals, radio);
+    return 0;
+}
+
+#endif // ARDUINO
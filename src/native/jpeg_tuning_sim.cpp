@@ -0,0 +1,223 @@
+// Simulación del ajuste automático de JPEG (env "jpeg_tuning") sobre trazas
+// de tamaño de cuadro: compara la configuración fija (QVGA, calidad 12) con el
+// JpegTuner ajustando solo calidad y calidad + resolución.
+//
+// Uso: .pio/build/jpeg_tuning/program [opciones] [traza]
+//   traza              log serie con líneas JPEGTRACE (ver src/main.cpp) o CSV
+//                      rssi,bytes_enviados,ms,bytes_jpeg,calidad,resolución
+//   --synthetic N      sin traza: N capturas sintéticas (2000)
+//   --seed K           semilla de la traza sintética (1)
+//   --target MS        tiempo objetivo de subida (1500)
+//   --rtt MS           ida y vuelta por imagen incluida en ms de la traza (40)
+//
+// De cada captura de la traza se toman el RSSI, el rendimiento del enlace
+// (bytes/ms sin la ida y vuelta) y la complejidad de la escena (tamaño real
+// frente al modelo de JpegTuner::predictSize). Imprime una tabla por stderr y
+// el informe JSON por stdout.
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "JpegTuner.h"
+
+struct Capture {
+    int spot;           // Cada espacio (dispositivo) tiene su propio JpegTuner
+    int rssi;
+    float bytesPerMs;   // Rendimiento del enlace durante la subida
+    float complexity;   // Escala del modelo de tamaño para la escena
+};
+
+struct ModeResult {
+    const char* name;
+    double totalBytes;
+    double totalUploadMs;
+    std::vector<double> uploads;
+    int overTarget;
+    double totalQuality;
+    int belowQvga;
+};
+
+static size_t wireBytes(size_t jpegBytes) {
+    return 6 + (jpegBytes + 2) / 3 * 4 + 2; // "IMAGE:" + base64 + "\r\n"
+}
+
+static bool parseTraceLine(const char* line, double rtt, Capture& out) {
+    const char* p = strstr(line, "JPEGTRACE,");
+    p = p != NULL ? p + 10 : line;
+
+    int rssi, quality, framesize;
+    unsigned long wire, ms, jpeg;
+    if (sscanf(p, "%d,%lu,%lu,%lu,%d,%d", &rssi, &wire, &ms, &jpeg, &quality, &framesize) != 6) {
+        return false;
+    }
+    size_t modeled = JpegTuner::predictSize((framesize_t)framesize, quality, 1.0f);
+    if (modeled == 0 || jpeg == 0) {
+        return false;
+    }
+
+    double transferMs = (double)ms - rtt;
+    out.spot = 0;
+    out.rssi = rssi;
+    out.bytesPerMs = (float)(wire / (transferMs > 1 ? transferMs : 1));
+    out.complexity = (float)jpeg / (float)modeled;
+    return true;
+}
+
+static std::vector<Capture> loadTrace(const char* path, double rtt) {
+    std::vector<Capture> trace;
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return trace;
+    }
+    char line[256];
+    Capture capture;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (parseTraceLine(line, rtt, capture)) {
+            trace.push_back(capture);
+        }
+    }
+    fclose(f);
+    return trace;
+}
+
+// Traza sintética: espacios de 50 capturas con RSSI fijo más variación, rendimiento con
+// ruido log-normal alrededor de la tabla por RSSI y escenas que cambian con
+// el ciclo día/noche (de noche el ruido del sensor agranda el JPEG).
+static std::vector<Capture> syntheticTrace(int count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> spotRssi(-88, -50);
+    std::normal_distribution<float> rssiNoise(0.0f, 3.0f);
+    std::lognormal_distribution<float> linkNoise(0.0f, 0.35f);
+    std::lognormal_distribution<float> sceneNoise(0.0f, 0.25f);
+
+    std::vector<Capture> trace;
+    int baseRssi = spotRssi(rng);
+    for (int i = 0; i < count; i++) {
+        if (i % 50 == 0) {
+            baseRssi = spotRssi(rng); // Otro espacio del estacionamiento
+        }
+        float hour = fmodf(i * 0.37f, 24.0f);
+        float night = hour < 6.0f || hour > 19.0f ? 1.0f : 0.0f;
+
+        Capture capture;
+        capture.spot = i / 50;
+        capture.rssi = (int)lroundf(baseRssi + rssiNoise(rng));
+        capture.bytesPerMs = JpegTuner::rssiThroughput(capture.rssi) * linkNoise(rng);
+        capture.complexity = (0.8f + 0.9f * night) * sceneNoise(rng);
+        trace.push_back(capture);
+    }
+    return trace;
+}
+
+static void record(ModeResult& mode, const JpegSettings& settings, size_t jpeg, double uploadMs,
+                   unsigned long targetMs) {
+    mode.totalBytes += jpeg;
+    mode.totalUploadMs += uploadMs;
+    mode.uploads.push_back(uploadMs);
+    mode.totalQuality += settings.quality;
+    if (uploadMs > targetMs) mode.overTarget++;
+    if (settings.framesize < FRAMESIZE_QVGA) mode.belowQvga++;
+}
+
+static ModeResult runMode(const char* name, const std::vector<Capture>& trace, int tune,
+                          unsigned long targetMs, double rtt) {
+    ModeResult mode = {name, 0, 0, {}, 0, 0, 0};
+
+    JpegTuner tuner;
+    int spot = -1;
+
+    for (const Capture& capture : trace) {
+        if (capture.spot != spot) {
+            spot = capture.spot;
+            tuner = JpegTuner();
+            tuner.setTargetUploadMs(targetMs);
+            if (tune == 2) {
+                tuner.setFramesizeRange(FRAMESIZE_QQVGA, FRAMESIZE_QVGA);
+            }
+        }
+
+        JpegSettings settings = {FRAMESIZE_QVGA, 12};
+        if (tune > 0) {
+            tuner.reportRssi(capture.rssi);
+            settings = tuner.nextSettings();
+        }
+
+        size_t jpeg = JpegTuner::predictSize(settings.framesize, settings.quality, capture.complexity);
+        size_t wire = wireBytes(jpeg);
+        double uploadMs = rtt + wire / capture.bytesPerMs;
+        record(mode, settings, jpeg, uploadMs, targetMs);
+
+        if (tune > 0) {
+            tuner.reportFrame(settings, jpeg);
+            tuner.reportUpload(wire, (unsigned long)uploadMs);
+        }
+    }
+    return mode;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+int main(int argc, char** argv) {
+    const char* tracePath = NULL;
+    int synthetic = 2000;
+    unsigned seed = 1;
+    unsigned long targetMs = 1500;
+    double rtt = 40;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) synthetic = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--target") == 0 && i + 1 < argc) targetMs = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--rtt") == 0 && i + 1 < argc) rtt = atof(argv[++i]);
+        else if (argv[i][0] != '-') tracePath = argv[i];
+        else {
+            fprintf(stderr, "Uso: %s [--synthetic N] [--seed K] [--target MS] [--rtt MS] [traza]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Capture> trace = tracePath != NULL ? loadTrace(tracePath, rtt) : syntheticTrace(synthetic, seed);
+    if (trace.empty()) {
+        fprintf(stderr, "Traza vacía o ilegible: %s\n", tracePath != NULL ? tracePath : "(sintética)");
+        return 1;
+    }
+
+    ModeResult modes[] = {
+        runMode("fixed", trace, 0, targetMs, rtt),
+        runMode("auto_quality", trace, 1, targetMs, rtt),
+        runMode("auto_quality_resolution", trace, 2, targetMs, rtt),
+    };
+
+    fprintf(stderr, "%zu capturas (%s), objetivo %lu ms\n", trace.size(),
+            tracePath != NULL ? tracePath : "sintéticas", targetMs);
+    fprintf(stderr, "%-25s %12s %12s %12s %10s %8s\n", "modo", "bytes/img", "subida ms", "p95 ms", "> obj.", "calidad");
+
+    printf("{\"captures\": %zu, \"target_ms\": %lu, \"modes\": [", trace.size(), targetMs);
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        const ModeResult& m = modes[i];
+        double n = (double)m.uploads.size();
+        double p95 = percentile(m.uploads, 95);
+        fprintf(stderr, "%-25s %12.0f %12.0f %12.0f %9.1f%% %8.1f\n", m.name, m.totalBytes / n,
+                m.totalUploadMs / n, p95, 100.0 * m.overTarget / n, m.totalQuality / n);
+        printf("%s{\"mode\": \"%s\", \"avg_bytes\": %.1f, \"avg_upload_ms\": %.1f, \"p95_upload_ms\": %.1f, "
+               "\"over_target_pct\": %.2f, \"avg_quality\": %.2f, \"below_qvga_pct\": %.2f}",
+               i ? ", " : "", m.name, m.totalBytes / n, m.totalUploadMs / n, p95,
+               100.0 * m.overTarget / n, m.totalQuality / n, 100.0 * m.belowQvga / n);
+    }
+    printf("]}\n");
+    return 0;
+}
+
+#endif // ARDUINO
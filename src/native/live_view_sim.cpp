@@ -0,0 +1,318 @@
+// Costo de la vista en vivo para el sensor (env "live_view"): el mismo
+// ParkingSensor con la confirmación por cámara de main.cpp (una miniatura
+// por cambio de estado), sin visor y con un visor conectado, en tiempo real.
+//
+// Uso: .pio/build/live_view/program [opciones]
+//   --seconds S        duración de cada fase (20)
+//   --fps N            tope de la vista en vivo (LIVEVIEW_DEFAULT_FPS)
+//   --port P           puerto de la vista en vivo (18081)
+//
+// Fases: sin visor, un visor que lee todo y uno lento (lee 512 bytes cada
+// 100 ms: sus envíos chocan con LIVEVIEW_SEND_TIMEOUT_MS). De cada una:
+// el peor intervalo entre mediciones, la latencia de los eventos (del cambio
+// de distancia a la línea recibida por el servidor), cuántas veces y cuánto
+// esperó la miniatura del sensor por la cámara y los cuadros enviados.
+// Tabla por stderr, JSON por stdout.
+//
+// Son cifras del host (hilo con nice 10 en lugar de la prioridad de
+// FreeRTOS, cámara y red simuladas): comparan las fases entre sí, no
+// reemplazan la medición en la placa.
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Hal.h"
+#include "ParkingSensor.h"
+#include "CameraManager.h"
+#include "LiveView.h"
+
+#define FLIP_MS 2500            // Llegada o salida cada 2.5 s
+#define MEASURE_INTERVAL_MS 200
+#define LOOP_DELAY_MS 100       // Como delay(100) en loop()
+
+static CameraManager camera;
+
+// ---- Servidor: registra cuándo llega cada evento ----
+
+static std::mutex eventLock;
+static std::vector<unsigned long> eventArrivals;
+
+static int startEventServer(uint16_t& port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &length) < 0) {
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+
+    std::thread([fd]() {
+        int client;
+        while ((client = accept(fd, NULL, NULL)) >= 0) {
+            std::string pending;
+            char buffer[4096];
+            ssize_t n;
+            while ((n = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+                pending.append(buffer, (size_t)n);
+                size_t end;
+                while ((end = pending.find('\n')) != std::string::npos) {
+                    if (pending.compare(0, 1, "{") == 0 && pending.find("\"occupied\"") < end) {
+                        std::lock_guard<std::mutex> guard(eventLock);
+                        eventArrivals.push_back(hal::millis());
+                    }
+                    pending.erase(0, end + 1);
+                }
+            }
+            close(client);
+        }
+    }).detach();
+    return fd;
+}
+
+// ---- Sensor: distancia que alterna y cuándo se midió ----
+
+struct Scene {
+    unsigned long start;
+    std::vector<unsigned long> flips;       // Cambios de distancia
+    std::vector<unsigned long> measurements;
+};
+
+static float sceneDistance(void* context, unsigned long nowMs) {
+    Scene& scene = *(Scene*)context;
+    scene.measurements.push_back(nowMs);
+    unsigned long phase = (nowMs - scene.start) / FLIP_MS;
+    unsigned long flipAt = scene.start + phase * FLIP_MS;
+    if (phase > 0 && (scene.flips.empty() || scene.flips.back() != flipAt)) {
+        scene.flips.push_back(flipAt);
+    }
+    return phase % 2 == 0 ? 80.0f : 25.0f;
+}
+
+// Como verifyTransition() de main.cpp: una miniatura por cambio. Incluye la
+// espera por el cuadro si lo tiene la vista en vivo
+static unsigned long verifyMaxUs = 0;
+
+static bool verifyWithCamera(bool occupied, float distance) {
+    (void)occupied;
+    (void)distance;
+    static uint8_t thumb[32 * 24];
+    unsigned long start = hal::micros();
+    camera.captureGrayscale(thumb, 32, 24);
+    verifyMaxUs = std::max(verifyMaxUs, hal::micros() - start);
+    return true;
+}
+
+// ---- Visores ----
+
+static std::atomic<bool> viewerRunning(false);
+
+static int connectViewer(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    // Buffer de recepción chico: un visor lento llena la ventana como en Wi-Fi
+    int receiveBuffer = 16384;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    const char* request = "GET /stream HTTP/1.1\r\n\r\n";
+    send(fd, request, strlen(request), 0);
+    return fd;
+}
+
+static void runViewer(uint16_t port, size_t readBytes, unsigned readDelayMs) {
+    std::vector<char> buffer(readBytes);
+    int fd = connectViewer(port);
+    while (viewerRunning && fd >= 0) {
+        ssize_t n = recv(fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (n == 0) {
+            // Cortado por el dispositivo (envío vencido): vuelve a conectar, como un navegador
+            close(fd);
+            usleep(200000);
+            fd = connectViewer(port);
+            continue;
+        }
+        usleep(readDelayMs * 1000);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+// ---- Fases ----
+
+struct PhaseResult {
+    const char* name;
+    size_t measurements;
+    unsigned long maxIntervalMs;
+    size_t events;
+    double eventP50Ms;
+    unsigned long eventMaxMs;
+    uint32_t cameraContended;
+    unsigned long verifyMaxUs;      // Miniatura del sensor, con la espera por el cuadro
+    uint32_t frames;
+    uint32_t skipped;
+    uint32_t idleDrops;
+    unsigned long maxHoldUs;
+};
+
+static PhaseResult runPhase(const char* name, uint16_t serverPort, uint16_t viewPort, int fps,
+                            unsigned seconds, int viewerMode) {
+    PhaseResult result;
+    memset(&result, 0, sizeof(result));
+    result.name = name;
+
+    LiveView view(camera, viewPort);
+    view.setMaxFps(fps);
+    bool viewing = viewerMode > 0;
+    if (viewing && (!view.begin() || !view.start())) {
+        fprintf(stderr, "No se pudo iniciar la vista en vivo en el puerto %u\n", (unsigned)viewPort);
+        return result;
+    }
+    std::thread viewer;
+    if (viewing) {
+        viewerRunning = true;
+        viewer = viewerMode == 1 ? std::thread(runViewer, viewPort, 65536, 1)
+                                 : std::thread(runViewer, viewPort, 512, 100);
+    }
+
+    CameraLockStats lockBefore = camera.getLockStats();
+    verifyMaxUs = 0;
+    {
+        std::lock_guard<std::mutex> guard(eventLock);
+        eventArrivals.clear();
+    }
+
+    Scene scene;
+    scene.start = hal::millis();
+    hal::sim::currentBoard().distanceSource = sceneDistance;
+    hal::sim::currentBoard().context = &scene;
+
+    ParkingSensor sensor(35, 36, 1, "127.0.0.1", serverPort);
+    sensor.begin();
+    sensor.setMeasurementInterval(MEASURE_INTERVAL_MS);
+    sensor.setTransitionVerifier(verifyWithCamera);
+    while (hal::millis() - scene.start < seconds * 1000UL) {
+        sensor.update();
+        hal::delayMs(LOOP_DELAY_MS);
+    }
+
+    if (viewing) {
+        viewerRunning = false;
+        viewer.join();
+        view.stop();
+        LiveViewStats stats = view.getStats();
+        result.frames = stats.frames;
+        result.skipped = stats.skipped;
+        result.idleDrops = stats.idleDrops;
+        result.maxHoldUs = stats.maxHoldUs;
+        view.end();
+    }
+    hal::sim::currentBoard().distanceSource = NULL;
+
+    CameraLockStats lockAfter = camera.getLockStats();
+    result.cameraContended = lockAfter.contended - lockBefore.contended;
+    result.verifyMaxUs = verifyMaxUs;
+
+    result.measurements = scene.measurements.size();
+    for (size_t i = 1; i < scene.measurements.size(); i++) {
+        result.maxIntervalMs = std::max(result.maxIntervalMs, scene.measurements[i] - scene.measurements[i - 1]);
+    }
+
+    // Primer evento recibido tras cada cambio de distancia
+    std::vector<unsigned long> latencies;
+    {
+        std::lock_guard<std::mutex> guard(eventLock);
+        for (unsigned long flip : scene.flips) {
+            for (unsigned long arrival : eventArrivals) {
+                if (arrival >= flip) {
+                    latencies.push_back(arrival - flip);
+                    break;
+                }
+            }
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.events = latencies.size();
+    if (!latencies.empty()) {
+        result.eventP50Ms = latencies[latencies.size() / 2];
+        result.eventMaxMs = latencies.back();
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    unsigned seconds = 20;
+    int fps = LIVEVIEW_DEFAULT_FPS;
+    uint16_t viewPort = 18081;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            viewPort = (uint16_t)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Uso: %s [--seconds S] [--fps N] [--port P]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    hal::sim::setSerialEnabled(false);
+    uint16_t serverPort = 0;
+    if (startEventServer(serverPort) < 0 || !camera.begin()) {
+        fprintf(stderr, "No se pudo iniciar el servidor de eventos o la cámara simulada\n");
+        return 1;
+    }
+    camera.setResolution(FRAMESIZE_QVGA);
+
+    PhaseResult results[3];
+    results[0] = runPhase("sin_visor", serverPort, viewPort, fps, seconds, 0);
+    results[1] = runPhase("visor", serverPort, viewPort, fps, seconds, 1);
+    results[2] = runPhase("visor_lento", serverPort, viewPort, fps, seconds, 2);
+
+    fprintf(stderr, "%-12s %8s %10s %7s %9s %9s %10s %11s %7s %7s %7s %10s\n", "fase", "medidas",
+            "máx ms", "eventos", "p50 ms", "máx ms", "esperas", "miniat. µs", "cuadros", "saltos",
+            "cortes", "máx µs");
+    printf("{\"seconds\": %u, \"fps\": %d, \"phases\": [", seconds, fps);
+    for (int i = 0; i < 3; i++) {
+        const PhaseResult& r = results[i];
+        fprintf(stderr, "%-12s %8zu %10lu %7zu %9.0f %9lu %10u %11lu %7u %7u %7u %10lu\n", r.name,
+                r.measurements, r.maxIntervalMs, r.events, r.eventP50Ms, r.eventMaxMs,
+                (unsigned)r.cameraContended, r.verifyMaxUs, (unsigned)r.frames, (unsigned)r.skipped,
+                (unsigned)r.idleDrops, r.maxHoldUs);
+        printf("%s{\"name\": \"%s\", \"measurements\": %zu, \"max_interval_ms\": %lu, \"events\": %zu, "
+               "\"event_p50_ms\": %.0f, \"event_max_ms\": %lu, \"camera_waits\": %u, "
+               "\"verify_max_us\": %lu, \"frames\": %u, \"skipped\": %u, \"idle_drops\": %u, "
+               "\"max_hold_us\": %lu}",
+               i ? ", " : "", r.name, r.measurements, r.maxIntervalMs, r.events, r.eventP50Ms, r.eventMaxMs,
+               (unsigned)r.cameraContended, r.verifyMaxUs, (unsigned)r.frames, (unsigned)r.skipped,
+               (unsigned)r.idleDrops, r.maxHoldUs);
+    }
+    printf("]}\n");
+    camera.end();
+    return 0;
+}
+
+#endif // ARDUINO
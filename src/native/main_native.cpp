@@ -0,0 +1,104 @@
+// Punto de entrada para el env "native": corre la lógica del firmware en
+// Linux con GPIO y cámara simulados, y TCP real contra parking_server.py.
+//
+// Uso: .pio/build/native/program [servidor] [puerto] [parkingId] [traza.csv]
+//   traza.csv: líneas "ms,distancia_cm" (distancia < 0 = sin eco); se repite en bucle
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "Hal.h"
+#include "ParkingSensor.h"
+#include "CameraManager.h"
+
+struct TracePoint {
+    unsigned long ms;
+    float distance;
+};
+
+static std::vector<TracePoint> trace;
+
+// Distancia según la traza cargada, o un ciclo llegada/salida de 20 s
+static float traceDistance(void* context, unsigned long nowMs) {
+    (void)context;
+    if (trace.empty()) {
+        return (nowMs / 10000) % 2 == 0 ? 80.0f : 25.0f;
+    }
+    unsigned long period = trace.back().ms + 1;
+    unsigned long t = nowMs % period;
+    float distance = trace.front().distance;
+    for (size_t i = 0; i < trace.size() && trace[i].ms <= t; i++) {
+        distance = trace[i].distance;
+    }
+    return distance;
+}
+
+static bool loadTrace(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    TracePoint point;
+    while (fscanf(file, "%lu,%f", &point.ms, &point.distance) == 2) {
+        trace.push_back(point);
+    }
+    fclose(file);
+    return !trace.empty();
+}
+
+static CameraManager camera;
+
+static bool applyCameraConfig(const ConfigUpdate& config) {
+    if (!camera.isInitialized()) {
+        return false;
+    }
+    if (config.fields & CFG_RESOLUTION) {
+        camera.setResolution((framesize_t)config.cameraResolution);
+    }
+    if (config.fields & CFG_QUALITY) {
+        camera.setQuality(config.cameraQuality);
+    }
+    if (config.fields & CFG_ROI) {
+        const uint16_t* r = config.cameraRoi;
+        camera.setRegionOfInterest({r[0], r[1], r[2], r[3]});
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* serverIP = argc > 1 ? argv[1] : "127.0.0.1";
+    int serverPort = argc > 2 ? atoi(argv[2]) : 8080;
+    int parkingId = argc > 3 ? atoi(argv[3]) : 1;
+
+    if (argc > 4 && !loadTrace(argv[4])) {
+        fprintf(stderr, "No se pudo leer la traza: %s\n", argv[4]);
+        return 1;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    Serial.println("🚗 ESP32 Parking Sensor System v1.0 (host)");
+    hal::sim::currentBoard().distanceSource = traceDistance;
+
+    camera.begin();
+
+    ParkingSensor parkingSensor(35, 36, parkingId, serverIP, serverPort);
+    parkingSensor.begin();
+    parkingSensor.setConfigHandler(applyCameraConfig);
+
+    unsigned long lastStatusPrint = 0;
+    while (!hal::sim::currentBoard().restartRequested) {
+        parkingSensor.update();
+
+        if (hal::millis() - lastStatusPrint > 30000) {
+            Serial.println(parkingSensor.getStatusString());
+            lastStatusPrint = hal::millis();
+        }
+
+        hal::delayMs(100);
+    }
+    return 0;
+}
+
+#endif // ARDUINO
@@ -0,0 +1,444 @@
+// Reproducción de trazas de campo (env "trace_replay"): convierte
+// parking_sensor.log a una traza binaria compacta (ver EventTrace.h), la pasa
+// por la lógica de decisión del ParkingSensor (OccupancyDecision) y compara
+// los eventos que enviaría el firmware actual con los registrados.
+//
+// Uso: .pio/build/trace_replay/program <comando> [opciones]
+//   convert LOG TRAZA           log del servidor → traza binaria
+//   replay TRAZA [opciones]     reproduce y compara con la traza de entrada
+//     --threshold CM            umbral de ocupación a probar (50)
+//     --repeat K                repetir la traza K veces (medir rendimiento)
+//     --events SALIDA           guardar los eventos reproducidos como traza
+//   diff A B                    compara dos trazas de eventos
+//   captures TRAZA [--rule R]... fotos que tomaría una política de captura
+//                               (CapturePolicy.h; por defecto "on=arrival")
+//
+// Cada registro de la traza es una medición que el dispositivo envió como
+// evento; la reproducción decide si el firmware actual también la enviaría.
+// Un timestamp de dispositivo que retrocede indica un reinicio y reinicia la
+// decisión de ese espacio. Imprime una tabla por stderr y el informe JSON por
+// stdout. trace_replay.py agrega la comparación del lado del servidor.
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include "CapturePolicy.h"
+#include "EventTrace.h"
+#include "OccupancyDecision.h"
+
+#define MAX_SPOTS 65536
+#define MAX_MISMATCHES 10
+
+enum Outcome { OUTCOME_MATCH, OUTCOME_DROPPED, OUTCOME_FLIPPED, OUTCOME_EXTRA };
+
+static const char* outcomeName(Outcome outcome) {
+    switch (outcome) {
+        case OUTCOME_DROPPED: return "dropped";
+        case OUTCOME_FLIPPED: return "flipped";
+        case OUTCOME_EXTRA:   return "extra";
+        default:              return "match";
+    }
+}
+
+struct Mismatch {
+    TraceRecord record;
+    Outcome outcome;
+};
+
+struct DiffCounts {
+    unsigned long long matched = 0;
+    unsigned long long dropped = 0;     // En la referencia pero no en la reproducción
+    unsigned long long flipped = 0;     // En ambas con distinto estado
+    unsigned long long extra = 0;       // Solo en la reproducción
+    std::vector<Mismatch> mismatches;   // Las primeras, para inspección
+    std::vector<uint16_t> spots;        // Espacios con alguna diferencia
+    std::vector<bool> affected;
+
+    void add(const TraceRecord& record, Outcome outcome) {
+        switch (outcome) {
+            case OUTCOME_MATCH:   matched++; return;
+            case OUTCOME_DROPPED: dropped++; break;
+            case OUTCOME_FLIPPED: flipped++; break;
+            case OUTCOME_EXTRA:   extra++; break;
+        }
+        if (mismatches.size() < MAX_MISMATCHES) {
+            mismatches.push_back({record, outcome});
+        }
+        if (affected.empty()) {
+            affected.resize(MAX_SPOTS, false);
+        }
+        if (!affected[record.parkingId]) {
+            affected[record.parkingId] = true;
+            spots.push_back(record.parkingId);
+        }
+    }
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool loadTrace(const char* path, std::vector<TraceRecord>& records) {
+    FILE* f = fopen(path, "rb");
+    uint64_t count = 0;
+    if (f == NULL || !readTraceHeader(f, count)) {
+        fprintf(stderr, "❌ No es una traza válida: %s\n", path);
+        if (f != NULL) fclose(f);
+        return false;
+    }
+    records.resize((size_t)count);
+    size_t read = fread(records.data(), sizeof(TraceRecord), records.size(), f);
+    fclose(f);
+    if (read != records.size()) {
+        fprintf(stderr, "❌ Traza truncada: %zu de %zu registros\n", read, records.size());
+        return false;
+    }
+    return true;
+}
+
+static bool saveTrace(const char* path, const std::vector<TraceRecord>& records) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) return false;
+    bool ok = writeTraceHeader(f, records.size()) &&
+              fwrite(records.data(), sizeof(TraceRecord), records.size(), f) == records.size();
+    return fclose(f) == 0 && ok;
+}
+
+static void formatWall(uint32_t wall, char* out, size_t size) {
+    time_t t = (time_t)wall;
+    struct tm parts;
+    gmtime_r(&t, &parts);
+    strftime(out, size, "%Y-%m-%d %H:%M:%S", &parts);
+}
+
+static void printDiffJson(const DiffCounts& diff) {
+    printf("  \"matched\": %llu,\n", diff.matched);
+    printf("  \"dropped\": %llu,\n", diff.dropped);
+    printf("  \"flipped\": %llu,\n", diff.flipped);
+    printf("  \"extra\": %llu,\n", diff.extra);
+    printf("  \"affected_spots\": [");
+    for (size_t i = 0; i < diff.spots.size(); i++) {
+        printf("%s%u", i == 0 ? "" : ", ", diff.spots[i]);
+    }
+    printf("],\n");
+    printf("  \"mismatches\": [");
+    for (size_t i = 0; i < diff.mismatches.size(); i++) {
+        const Mismatch& m = diff.mismatches[i];
+        char wall[32];
+        formatWall(m.record.wall, wall, sizeof(wall));
+        printf("%s\n    {\"outcome\": \"%s\", \"parkingId\": %u, \"wall\": \"%s\", \"timestamp\": %lu, "
+               "\"occupied\": %s, \"distance\": %.1f}",
+               i == 0 ? "" : ",", outcomeName(m.outcome), m.record.parkingId, wall,
+               (unsigned long)m.record.deviceMs, traceOccupied(m.record) ? "true" : "false",
+               traceDistance(m.record));
+    }
+    printf("%s]\n", diff.mismatches.empty() ? "" : "\n  ");
+}
+
+static void printDiffTable(const DiffCounts& diff) {
+    fprintf(stderr, "   Coinciden: %llu  Omitidos: %llu  Invertidos: %llu  Nuevos: %llu\n",
+            diff.matched, diff.dropped, diff.flipped, diff.extra);
+    for (const Mismatch& m : diff.mismatches) {
+        char wall[32];
+        formatWall(m.record.wall, wall, sizeof(wall));
+        fprintf(stderr, "   ⚠️ %-8s parqueo %u %s ts=%lu %s %.1f cm\n", outcomeName(m.outcome),
+                m.record.parkingId, wall, (unsigned long)m.record.deviceMs,
+                traceOccupied(m.record) ? "OCUPADO" : "LIBRE", traceDistance(m.record));
+    }
+}
+
+static int runConvert(const char* logPath, const char* tracePath) {
+    auto start = std::chrono::steady_clock::now();
+    unsigned long skipped = 0;
+    long count = convertLog(logPath, tracePath, &skipped);
+    if (count < 0) {
+        fprintf(stderr, "❌ No se pudo convertir %s → %s\n", logPath, tracePath);
+        return 1;
+    }
+    double elapsed = secondsSince(start);
+    fprintf(stderr, "📼 %ld eventos → %s (%lu líneas ignoradas, %.0f líneas/s)\n", count, tracePath,
+            skipped, (count + skipped) / (elapsed > 0 ? elapsed : 1e-9));
+    printf("{\n  \"events\": %ld,\n  \"skipped\": %lu,\n  \"seconds\": %.4f\n}\n", count, skipped, elapsed);
+    return 0;
+}
+
+// Estado del firmware por espacio. La tabla indexada por parkingId evita
+// búsquedas; entre pasadas solo se reinician los espacios usados.
+struct Replayer {
+    std::vector<OccupancyDecision> spots;
+    std::vector<uint32_t> lastDeviceMs;
+    std::vector<uint16_t> touched;
+
+    explicit Replayer(float threshold)
+        : spots(MAX_SPOTS, OccupancyDecision(threshold)), lastDeviceMs(MAX_SPOTS, UINT32_MAX) {}
+
+    void reset() {
+        for (uint16_t id : touched) {
+            spots[id].reset();
+            lastDeviceMs[id] = UINT32_MAX;
+        }
+        touched.clear();
+    }
+};
+
+// Una pasada de la traza por la decisión del firmware
+static void replayPass(Replayer& replayer, const std::vector<TraceRecord>& records,
+                       std::vector<TraceRecord>* events, DiffCounts& diff) {
+    replayer.reset();
+    for (const TraceRecord& record : records) {
+        OccupancyDecision& decision = replayer.spots[record.parkingId];
+        uint32_t& lastDeviceMs = replayer.lastDeviceMs[record.parkingId];
+        if (lastDeviceMs == UINT32_MAX) {
+            replayer.touched.push_back(record.parkingId);
+        } else if (record.deviceMs < lastDeviceMs) {
+            decision.reset(); // El dispositivo se reinició
+        }
+        lastDeviceMs = record.deviceMs;
+
+        float distance = traceDistance(record);
+        if (!OccupancyDecision::isValidDistance(distance) || !decision.apply(distance)) {
+            diff.add(record, OUTCOME_DROPPED);
+            continue;
+        }
+        bool occupied = decision.isOccupied();
+        diff.add(record, occupied == traceOccupied(record) ? OUTCOME_MATCH : OUTCOME_FLIPPED);
+        if (events != NULL) {
+            TraceRecord event = record;
+            event.flags = occupied ? TRACE_OCCUPIED : 0;
+            events->push_back(event);
+        }
+    }
+}
+
+static int runReplay(const char* tracePath, float threshold, int repeat, const char* eventsPath) {
+    std::vector<TraceRecord> records;
+    if (!loadTrace(tracePath, records)) {
+        return 1;
+    }
+
+    std::vector<TraceRecord> events;
+    events.reserve(eventsPath != NULL ? records.size() : 0);
+    Replayer replayer(threshold);
+    DiffCounts diff;
+    auto start = std::chrono::steady_clock::now();
+    replayPass(replayer, records, eventsPath != NULL ? &events : NULL, diff);
+    for (int i = 1; i < repeat; i++) {
+        DiffCounts again;
+        replayPass(replayer, records, NULL, again);
+    }
+    double elapsed = secondsSince(start);
+    double total = (double)records.size() * repeat;
+    double perSecond = total / (elapsed > 0 ? elapsed : 1e-9);
+
+    if (eventsPath != NULL && !saveTrace(eventsPath, events)) {
+        fprintf(stderr, "❌ No se pudo escribir %s\n", eventsPath);
+        return 1;
+    }
+
+    fprintf(stderr, "\n📼 REPRODUCCIÓN DE %s (umbral %.1f cm)\n", tracePath, threshold);
+    fprintf(stderr, "=================================================\n");
+    fprintf(stderr, "   Eventos de entrada: %zu  Reproducidos: %llu\n", records.size(),
+            diff.matched + diff.flipped);
+    printDiffTable(diff);
+    fprintf(stderr, "   Rendimiento: %.0f eventos en %.3f s → %.2f M eventos/s\n", total, elapsed,
+            perSecond / 1e6);
+    fprintf(stderr, "=================================================\n");
+
+    printf("{\n");
+    printf("  \"trace\": \"%s\",\n", tracePath);
+    printf("  \"threshold\": %.2f,\n", threshold);
+    printf("  \"input_events\": %zu,\n", records.size());
+    printf("  \"first_wall\": %lu,\n", records.empty() ? 0UL : (unsigned long)records.front().wall);
+    printf("  \"last_wall\": %lu,\n", records.empty() ? 0UL : (unsigned long)records.back().wall);
+    printf("  \"replayed_events\": %llu,\n", diff.matched + diff.flipped);
+    printf("  \"repeat\": %d,\n", repeat);
+    printf("  \"seconds\": %.4f,\n", elapsed);
+    printf("  \"events_per_second\": %.0f,\n", perSecond);
+    printDiffJson(diff);
+    printf("}\n");
+    return 0;
+}
+
+// Identidad de un evento en ambas trazas: espacio, timestamp del dispositivo
+// y segundo del servidor (16 bits bajos, suficientes para separar reinicios)
+static uint64_t eventKey(const TraceRecord& record) {
+    return ((uint64_t)record.parkingId << 48) | ((uint64_t)(record.wall & 0xFFFF) << 32) | record.deviceMs;
+}
+
+static int runDiff(const char* pathA, const char* pathB) {
+    std::vector<TraceRecord> a, b;
+    if (!loadTrace(pathA, a) || !loadTrace(pathB, b)) {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<uint64_t, uint32_t> indexB;
+    indexB.reserve(b.size());
+    for (uint32_t i = 0; i < b.size(); i++) {
+        indexB.emplace(eventKey(b[i]), i);
+    }
+
+    DiffCounts diff;
+    std::vector<bool> seen(b.size(), false);
+    for (const TraceRecord& record : a) {
+        auto it = indexB.find(eventKey(record));
+        if (it == indexB.end()) {
+            diff.add(record, OUTCOME_DROPPED);
+            continue;
+        }
+        seen[it->second] = true;
+        diff.add(record, traceOccupied(b[it->second]) == traceOccupied(record) ? OUTCOME_MATCH : OUTCOME_FLIPPED);
+    }
+    for (size_t i = 0; i < b.size(); i++) {
+        if (!seen[i]) {
+            diff.add(b[i], OUTCOME_EXTRA);
+        }
+    }
+    double elapsed = secondsSince(start);
+
+    fprintf(stderr, "\n📼 %s (%zu) ↔ %s (%zu)\n", pathA, a.size(), pathB, b.size());
+    printDiffTable(diff);
+
+    printf("{\n");
+    printf("  \"a_events\": %zu,\n", a.size());
+    printf("  \"b_events\": %zu,\n", b.size());
+    printf("  \"seconds\": %.4f,\n", elapsed);
+    printDiffJson(diff);
+    printf("}\n");
+    return diff.dropped + diff.flipped + diff.extra == 0 ? 0 : 2;
+}
+
+// La traza solo trae eventos: entre uno y otro se despierta la política en
+// cada captura periódica pendiente, como haría el loop del firmware. La hora
+// del log se usa como hora local para los horarios de las reglas.
+static int runCaptures(const char* tracePath, const char* const* ruleTexts, int ruleCount) {
+    std::vector<TraceRecord> records;
+    if (!loadTrace(tracePath, records)) {
+        return 1;
+    }
+
+    CapturePolicy policy;
+    for (int i = 0; i < ruleCount; i++) {
+        if (!policy.addRule(ruleTexts[i])) {
+            fprintf(stderr, "❌ Regla inválida o demasiadas reglas: %s\n", ruleTexts[i]);
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<uint16_t, CapturePolicy> spots;
+    unsigned long long byReason[CAPTURE_PERIODIC + 1] = {0};
+    uint32_t firstWall = records.empty() ? 0 : records.front().wall;
+    for (const TraceRecord& record : records) {
+        CapturePolicy& spot = spots.emplace(record.parkingId, policy).first->second;
+        uint32_t nowMs = (record.wall - firstWall) * 1000U;
+        uint32_t due;
+        while (spot.nextWake(due) && (int32_t)(nowMs - due) >= 0) {
+            uint32_t dueWall = record.wall - (nowMs - due) / 1000U;
+            byReason[spot.update(true, due, (int)(dueWall % 86400) / 60).reason]++;
+        }
+        byReason[spot.update(traceOccupied(record), nowMs, (int)(record.wall % 86400) / 60).reason]++;
+    }
+    double elapsed = secondsSince(start);
+
+    CaptureRuleStats totals[CAPTURE_MAX_RULES] = {};
+    for (const auto& entry : spots) {
+        for (uint8_t i = 0; i < policy.getRuleCount(); i++) {
+            const CaptureRuleStats& stats = entry.second.getStats(i);
+            totals[i].fired += stats.fired;
+            totals[i].rateLimited += stats.rateLimited;
+            totals[i].outsideHours += stats.outsideHours;
+        }
+    }
+    unsigned long long captures = byReason[CAPTURE_ARRIVAL] + byReason[CAPTURE_DEPARTURE] + byReason[CAPTURE_PERIODIC];
+    double days = records.empty() ? 0.0 : (records.back().wall - firstWall) / 86400.0;
+    double perSpotDay = spots.empty() || days <= 0.0 ? 0.0 : captures / (spots.size() * days);
+
+    fprintf(stderr, "\n📸 POLÍTICA DE CAPTURA SOBRE %s\n", tracePath);
+    fprintf(stderr, "=================================================\n");
+    fprintf(stderr, "   Eventos: %zu  Espacios: %zu  Días: %.1f\n", records.size(), spots.size(), days);
+    fprintf(stderr, "   Capturas: %llu (llegada %llu, salida %llu, periódicas %llu), %.1f por espacio y día\n",
+            captures, byReason[CAPTURE_ARRIVAL], byReason[CAPTURE_DEPARTURE], byReason[CAPTURE_PERIODIC],
+            perSpotDay);
+    for (uint8_t i = 0; i < policy.getRuleCount(); i++) {
+        fprintf(stderr, "   Regla %u \"%s\": %lu capturas, %lu sin cupo, %lu fuera de horario\n", i,
+                ruleTexts[i], (unsigned long)totals[i].fired, (unsigned long)totals[i].rateLimited,
+                (unsigned long)totals[i].outsideHours);
+    }
+    fprintf(stderr, "=================================================\n");
+
+    printf("{\n");
+    printf("  \"trace\": \"%s\",\n", tracePath);
+    printf("  \"events\": %zu,\n", records.size());
+    printf("  \"spots\": %zu,\n", spots.size());
+    printf("  \"captures\": %llu,\n", captures);
+    printf("  \"arrival\": %llu,\n", byReason[CAPTURE_ARRIVAL]);
+    printf("  \"departure\": %llu,\n", byReason[CAPTURE_DEPARTURE]);
+    printf("  \"periodic\": %llu,\n", byReason[CAPTURE_PERIODIC]);
+    printf("  \"per_spot_day\": %.2f,\n", perSpotDay);
+    printf("  \"seconds\": %.4f,\n", elapsed);
+    printf("  \"rules\": [");
+    for (uint8_t i = 0; i < policy.getRuleCount(); i++) {
+        printf("%s\n    {\"rule\": \"%s\", \"fired\": %lu, \"rate_limited\": %lu, \"outside_hours\": %lu}",
+               i == 0 ? "" : ",", ruleTexts[i], (unsigned long)totals[i].fired,
+               (unsigned long)totals[i].rateLimited, (unsigned long)totals[i].outsideHours);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && strcmp(argv[1], "convert") == 0) {
+        return runConvert(argv[2], argv[3]);
+    }
+    if (argc >= 4 && strcmp(argv[1], "diff") == 0) {
+        return runDiff(argv[2], argv[3]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "captures") == 0) {
+        const char* rules[CAPTURE_MAX_RULES + 1];
+        int ruleCount = 0;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--rule") != 0 || i + 1 >= argc || ruleCount > CAPTURE_MAX_RULES) {
+                fprintf(stderr, "Uso: %s captures TRAZA [--rule \"on=arrival every=900 ...\"]...\n", argv[0]);
+                return 1;
+            }
+            rules[ruleCount++] = argv[++i];
+        }
+        if (ruleCount == 0) {
+            rules[ruleCount++] = "on=arrival";  // Comportamiento anterior del firmware
+        }
+        return runCaptures(argv[2], rules, ruleCount);
+    }
+    if (argc >= 3 && strcmp(argv[1], "replay") == 0) {
+        float threshold = 50.0f;
+        int repeat = 1;
+        const char* eventsPath = NULL;
+        for (int i = 3; i < argc; i++) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Falta el valor de %s\n", argv[i]);
+                return 1;
+            }
+            if (strcmp(argv[i], "--threshold") == 0) threshold = (float)atof(argv[++i]);
+            else if (strcmp(argv[i], "--repeat") == 0) repeat = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+            else if (strcmp(argv[i], "--events") == 0) eventsPath = argv[++i];
+            else {
+                fprintf(stderr, "Opción desconocida: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        return runReplay(argv[2], threshold, repeat, eventsPath);
+    }
+
+    fprintf(stderr, "Uso: %s convert LOG TRAZA | replay TRAZA [--threshold CM] [--repeat K] "
+                    "[--events SALIDA] | diff A B | captures TRAZA [--rule R]...\n", argv[0]);
+    return 1;
+}
+
+#endif // ARDUINO
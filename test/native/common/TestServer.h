@@ -0,0 +1,97 @@
+#ifndef TEST_SERVER_H
+#define TEST_SERVER_H
+
+// Servidor de prueba en loopback para las suites nativas que hablan con un
+// ParkingSensor o Gateway reales (incluido con -Itest/native/common).
+//
+// Un solo hilo: readLine() corre el loop del dispositivo y a la vez acepta
+// y lee la conexión, hasta tener una línea completa.
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string>
+
+// Socket en 127.0.0.1 con un puerto libre (SOCK_STREAM o SOCK_DGRAM)
+inline int openLoopback(int type, uint16_t& port) {
+    int fd = socket(AF_INET, type, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    bind(fd, (struct sockaddr*)&address, sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(fd, (struct sockaddr*)&address, &length);
+    port = ntohs(address.sin_port);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+struct TestServer {
+    int listener;
+    int client;
+    uint16_t port;
+    std::string pending;
+};
+
+inline void startServer(TestServer& server) {
+    server.listener = openLoopback(SOCK_STREAM, server.port);
+    listen(server.listener, 1);
+    server.client = -1;
+    server.pending.clear();
+}
+
+// Corre el loop del dispositivo hasta que el servidor reciba una línea completa
+template <typename Device>
+bool readLine(TestServer& server, Device& device, std::string& line) {
+    for (int i = 0; i < 2000; i++) {
+        device.update();
+        if (server.client < 0) {
+            server.client = accept(server.listener, NULL, NULL);
+            if (server.client >= 0) {
+                fcntl(server.client, F_SETFL, O_NONBLOCK);
+            }
+        } else {
+            char buffer[4096];
+            ssize_t n = recv(server.client, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                server.pending.append(buffer, (size_t)n);
+            }
+        }
+        size_t newline = server.pending.find('\n');
+        if (newline != std::string::npos) {
+            line = server.pending.substr(0, newline);
+            if (!line.empty() && line[line.size() - 1] == '\r') {
+                line.erase(line.size() - 1);
+            }
+            server.pending.erase(0, newline + 1);
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+inline void sendFrame(TestServer& server, const char* frame) {
+    send(server.client, frame, strlen(frame), 0);
+}
+
+// Corta la conexión; el dispositivo reconecta en el próximo readLine()
+inline void dropClient(TestServer& server) {
+    close(server.client);
+    server.client = -1;
+    server.pending.clear();
+}
+
+inline void stopServer(TestServer& server) {
+    if (server.client >= 0) {
+        close(server.client);
+    }
+    close(server.listener);
+}
+
+#endif // TEST_SERVER_H
@@ -0,0 +1,128 @@
+// Pruebas de los perfiles de cámara y la caché de registros (pio test -e native)
+//
+// El OV2640 simulado cuenta transacciones SCCB y descarta cuadros al
+// resincronizar tras set_framesize(), como el driver real.
+
+#include <unity.h>
+
+#include "Hal.h"
+#include "HalCamera.h"
+#include "CameraManager.h"
+
+static CameraManager* camera = NULL;
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(1000.0);     // Las esperas de begin() y del bus en ms reales
+    camera = new CameraManager();
+    TEST_ASSERT_TRUE(camera->begin());
+}
+
+void tearDown(void) {
+    camera->end();
+    delete camera;
+    camera = NULL;
+}
+
+static size_t captureWidth() {
+    camera_fb_t* fb = camera->capture();
+    TEST_ASSERT_NOT_NULL(fb);
+    size_t width = fb->width;
+    camera->release(fb);
+    return width;
+}
+
+void test_compiled_profile_orders_writes_by_bank(void) {
+    CompiledProfile compiled;
+    compileProfile(cameraProfile(PROFILE_NIGHT), compiled);
+    TEST_ASSERT_EQUAL(5, compiled.writeCount);
+    TEST_ASSERT_EQUAL(3, compiled.zoomWrites);
+    TEST_ASSERT_EQUAL(80, compiled.writes[0].value);        // ZMOW = 320 / 4
+    TEST_ASSERT_EQUAL(60, compiled.writes[1].value);        // ZMOH = 240 / 4
+    for (uint8_t i = 0; i + 1 < compiled.writeCount; i++) {
+        TEST_ASSERT_EQUAL(0, compiled.writes[i].reg >> 8);   // DSP primero
+    }
+    TEST_ASSERT_EQUAL(1, compiled.writes[compiled.writeCount - 1].reg >> 8);
+
+    TEST_ASSERT_EQUAL(PROFILE_EVIDENCE, findCameraProfile("evidence"));
+    TEST_ASSERT_EQUAL(-1, findCameraProfile("noche"));
+    TEST_ASSERT_TRUE(sameSensorWindow(FRAMESIZE_QVGA, FRAMESIZE_QQVGA));
+    TEST_ASSERT_FALSE(sameSensorWindow(FRAMESIZE_QVGA, FRAMESIZE_VGA));
+    TEST_ASSERT_FALSE(sameSensorWindow(FRAMESIZE_QVGA, FRAMESIZE_240X240));
+}
+
+void test_same_window_profile_switch_skips_resync(void) {
+    uint32_t sccb = hal::sim::sccbTransactions();
+    uint32_t dropped = hal::sim::framesDropped();
+    TEST_ASSERT_TRUE(camera->applyProfile(PROFILE_THUMBNAIL));
+    uint32_t profileSccb = hal::sim::sccbTransactions() - sccb;
+
+    TEST_ASSERT_EQUAL(160, captureWidth());
+    TEST_ASSERT_EQUAL(0, hal::sim::framesDropped() - dropped);
+    TEST_ASSERT_EQUAL(20, camera->getCurrentQuality());
+    TEST_ASSERT_EQUAL(PROFILE_THUMBNAIL, camera->getActiveProfile());
+    CameraSwitchStats stats = camera->getSwitchStats();
+    TEST_ASSERT_EQUAL(0, stats.windowResyncs);
+    TEST_ASSERT_EQUAL(3, stats.registerWrites);             // ZMOW, ZMOH y QS; ZMHH y COM9 no cambian
+    TEST_ASSERT_GREATER_THAN(0, stats.lastSwitchUs);
+
+    // El mismo cambio por el driver reescribe la ventana y pierde cuadros
+    sensor_t* s = esp_camera_sensor_get();
+    sccb = hal::sim::sccbTransactions();
+    s->set_framesize(s, FRAMESIZE_QVGA);
+    s->set_quality(s, 12);
+    TEST_ASSERT_GREATER_THAN(profileSccb * 5, hal::sim::sccbTransactions() - sccb);
+    camera_fb_t* fb = esp_camera_fb_get();
+    esp_camera_fb_return(fb);
+    TEST_ASSERT_EQUAL(2, hal::sim::framesDropped() - dropped);
+}
+
+void test_reapplying_profile_writes_nothing(void) {
+    TEST_ASSERT_TRUE(camera->applyProfile("night"));
+    TEST_ASSERT_EQUAL(1, camera->getCurrentBrightness());
+    TEST_ASSERT_EQUAL(320, captureWidth());
+
+    uint32_t sccb = hal::sim::sccbTransactions();
+    CameraSwitchStats before = camera->getSwitchStats();
+    TEST_ASSERT_TRUE(camera->applyProfile(PROFILE_NIGHT));
+    TEST_ASSERT_EQUAL(0, hal::sim::sccbTransactions() - sccb);
+    CameraSwitchStats after = camera->getSwitchStats();
+    TEST_ASSERT_EQUAL(before.switches, after.switches);
+    TEST_ASSERT_GREATER_THAN(before.writesSkipped, after.writesSkipped);
+
+    // Los ajustes sueltos tampoco escriben si no cambian
+    camera->setQuality(14);
+    camera->setBrightness(1);
+    TEST_ASSERT_EQUAL(0, hal::sim::sccbTransactions() - sccb);
+    TEST_ASSERT_FALSE(camera->applyProfile("unknown"));
+}
+
+void test_mode_change_goes_through_driver_once(void) {
+    uint32_t dropped = hal::sim::framesDropped();
+    TEST_ASSERT_TRUE(camera->applyProfile(PROFILE_EVIDENCE));
+    TEST_ASSERT_EQUAL(640, captureWidth());
+    TEST_ASSERT_EQUAL(10, camera->getCurrentQuality());
+    TEST_ASSERT_EQUAL(1, camera->getSwitchStats().windowResyncs);
+    TEST_ASSERT_EQUAL(2, hal::sim::framesDropped() - dropped);
+
+    TEST_ASSERT_TRUE(camera->applyProfile(PROFILE_DAY));
+    TEST_ASSERT_EQUAL(320, captureWidth());
+    TEST_ASSERT_EQUAL(2, camera->getSwitchStats().windowResyncs);
+
+    // QVGA ↔ QQVGA del ajuste automático: solo el escalador
+    camera->setResolution(FRAMESIZE_QQVGA);
+    TEST_ASSERT_EQUAL(160, captureWidth());
+    TEST_ASSERT_EQUAL(2, camera->getSwitchStats().windowResyncs);
+    TEST_ASSERT_EQUAL(-1, camera->getActiveProfile());
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_compiled_profile_orders_writes_by_bank);
+    RUN_TEST(test_same_window_profile_switch_skips_resync);
+    RUN_TEST(test_reapplying_profile_writes_nothing);
+    RUN_TEST(test_mode_change_goes_through_driver_once);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+// Pruebas de la política de captura de imágenes (pio test -e native)
+
+#include <unity.h>
+
+#include "CapturePolicy.h"
+
+#define MINUTE_MS 60000UL
+#define NOON (12 * 60)
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_parse_rules(void) {
+    CaptureRule rule;
+    TEST_ASSERT_TRUE(CapturePolicy::parseRule("on=arrival,departure every=900 max=3 res=5 hours=6:30-22", rule));
+    TEST_ASSERT_EQUAL_UINT8(CAPTURE_ON_ARRIVAL | CAPTURE_ON_DEPARTURE, rule.transitions);
+    TEST_ASSERT_EQUAL_UINT32(900000, rule.periodMs);
+    TEST_ASSERT_EQUAL_UINT8(3, rule.maxPerHour);
+    TEST_ASSERT_EQUAL(5, rule.framesize);
+    TEST_ASSERT_EQUAL_UINT16(6 * 60 + 30, rule.fromMinute);
+    TEST_ASSERT_EQUAL_UINT16(22 * 60, rule.toMinute);
+
+    TEST_ASSERT_TRUE(CapturePolicy::parseRule("on=arrival", rule));
+    TEST_ASSERT_EQUAL(-1, rule.framesize);
+    TEST_ASSERT_EQUAL_UINT16(rule.fromMinute, rule.toMinute);
+
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("", rule));              // Nunca dispara
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("max=3", rule));
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("on=parked", rule));
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("on=arrival max=31", rule));
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("on=arrival res=14", rule));
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("on=arrival hours=22", rule));
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("on=arrival hours=6:75-22", rule));
+    TEST_ASSERT_FALSE(CapturePolicy::parseRule("on=arrival color=red", rule));
+}
+
+void test_arrival_only_matches_previous_firmware(void) {
+    CapturePolicy policy;
+    TEST_ASSERT_TRUE(policy.addRule("on=arrival"));
+
+    TEST_ASSERT_FALSE(policy.update(false, 0, -1).fire());
+    CaptureDecision arrival = policy.update(true, 1000, -1);
+    TEST_ASSERT_EQUAL(CAPTURE_ARRIVAL, arrival.reason);
+    TEST_ASSERT_EQUAL(0, arrival.rule);
+    TEST_ASSERT_FALSE(policy.update(true, 2000, -1).fire());        // Sigue ocupado
+    TEST_ASSERT_FALSE(policy.update(false, 3000, -1).fire());       // Salida sin regla
+    TEST_ASSERT_TRUE(policy.update(true, 4000, -1).fire());
+    TEST_ASSERT_EQUAL_UINT32(2, policy.getStats(0).fired);
+}
+
+void test_departure_and_periodic_during_long_occupation(void) {
+    CapturePolicy policy;
+    TEST_ASSERT_TRUE(policy.addRule("on=arrival,departure"));
+    TEST_ASSERT_TRUE(policy.addRule("every=600 res=3"));
+
+    TEST_ASSERT_EQUAL(CAPTURE_ARRIVAL, policy.update(true, 0, NOON).reason);
+    uint32_t due = 0;
+    TEST_ASSERT_TRUE(policy.nextWake(due));
+    TEST_ASSERT_EQUAL_UINT32(10 * MINUTE_MS, due);
+
+    TEST_ASSERT_FALSE(policy.update(true, 9 * MINUTE_MS, NOON).fire());
+    CaptureDecision periodic = policy.update(true, 10 * MINUTE_MS, NOON);
+    TEST_ASSERT_EQUAL(CAPTURE_PERIODIC, periodic.reason);
+    TEST_ASSERT_EQUAL(1, periodic.rule);
+    TEST_ASSERT_EQUAL(3, periodic.framesize);
+    TEST_ASSERT_TRUE(policy.update(true, 20 * MINUTE_MS, NOON).fire());
+
+    TEST_ASSERT_EQUAL(CAPTURE_DEPARTURE, policy.update(false, 25 * MINUTE_MS, NOON).reason);
+    TEST_ASSERT_FALSE(policy.nextWake(due));                        // Libre: nada periódico
+    TEST_ASSERT_FALSE(policy.update(false, 40 * MINUTE_MS, NOON).fire());
+}
+
+void test_rate_limit_is_a_sliding_hour(void) {
+    CapturePolicy policy;
+    TEST_ASSERT_TRUE(policy.addRule("on=arrival max=2"));
+
+    uint32_t now = 0;
+    int fired = 0;
+    for (int i = 0; i < 4; i++) {      // Cuatro llegadas en 30 minutos
+        fired += policy.update(true, now, -1).fire() ? 1 : 0;
+        policy.update(false, now + MINUTE_MS, -1);
+        now += 10 * MINUTE_MS;
+    }
+    TEST_ASSERT_EQUAL(2, fired);
+    TEST_ASSERT_EQUAL_UINT32(2, policy.getStats(0).rateLimited);
+
+    // Una hora después de la primera captura vuelve a haber cupo
+    TEST_ASSERT_TRUE(policy.update(true, 60 * MINUTE_MS, -1).fire());
+    policy.update(false, 61 * MINUTE_MS, -1);
+    TEST_ASSERT_FALSE(policy.update(true, 62 * MINUTE_MS, -1).fire());
+}
+
+void test_hours_window_crossing_midnight_and_unknown_time(void) {
+    CapturePolicy night;
+    TEST_ASSERT_TRUE(night.addRule("on=arrival hours=22-6"));
+    TEST_ASSERT_TRUE(night.update(true, 0, 23 * 60).fire());
+    night.update(false, 1000, 23 * 60);
+    TEST_ASSERT_TRUE(night.update(true, 2000, 5 * 60 + 59).fire());
+    night.update(false, 3000, 6 * 60);
+    TEST_ASSERT_FALSE(night.update(true, 4000, 6 * 60).fire());
+    night.update(false, 5000, 12 * 60);
+    TEST_ASSERT_FALSE(night.update(true, 6000, -1).fire());          // Sin NTP todavía
+    TEST_ASSERT_EQUAL_UINT32(2, night.getStats(0).outsideHours);
+
+    // Una regla sin horario dispara aunque no se conozca la hora
+    CapturePolicy always;
+    TEST_ASSERT_TRUE(always.addRule("on=arrival"));
+    TEST_ASSERT_TRUE(always.update(true, 0, -1).fire());
+}
+
+void test_first_matching_rule_wins(void) {
+    CapturePolicy policy;
+    TEST_ASSERT_TRUE(policy.addRule("on=arrival hours=6-22"));
+    TEST_ASSERT_TRUE(policy.addRule("on=arrival res=1"));          // De noche, en QQVGA
+
+    CaptureDecision day = policy.update(true, 0, NOON);
+    TEST_ASSERT_EQUAL(0, day.rule);
+    TEST_ASSERT_EQUAL(-1, day.framesize);
+    policy.update(false, 1000, NOON);
+
+    CaptureDecision night = policy.update(true, 2000, 23 * 60);
+    TEST_ASSERT_EQUAL(1, night.rule);
+    TEST_ASSERT_EQUAL(1, night.framesize);
+    TEST_ASSERT_EQUAL_UINT32(1, policy.getStats(1).fired);          // La segunda no gastó cupo de día
+}
+
+void test_periodic_due_together_fire_on_consecutive_calls(void) {
+    CapturePolicy policy;
+    TEST_ASSERT_TRUE(policy.addRule("every=600"));
+    TEST_ASSERT_TRUE(policy.addRule("every=600 res=3"));
+    policy.update(true, 0, NOON);
+
+    // Vencen a la vez: dispara la primera y la segunda sigue pendiente
+    TEST_ASSERT_EQUAL(0, policy.update(true, 10 * MINUTE_MS, NOON).rule);
+    uint32_t due = 0;
+    TEST_ASSERT_TRUE(policy.nextWake(due));
+    TEST_ASSERT_EQUAL_UINT32(10 * MINUTE_MS, due);
+    TEST_ASSERT_EQUAL(1, policy.update(true, 10 * MINUTE_MS + 50, NOON).rule);
+    TEST_ASSERT_FALSE(policy.update(true, 10 * MINUTE_MS + 100, NOON).fire());
+    TEST_ASSERT_EQUAL_UINT32(1, policy.getStats(1).fired);
+}
+
+void test_periodic_survives_millis_wraparound(void) {
+    CapturePolicy policy;
+    TEST_ASSERT_TRUE(policy.addRule("every=60"));
+    uint32_t start = 0xFFFFFFFFUL - 30000;
+    TEST_ASSERT_FALSE(policy.update(true, start, -1).fire());
+    TEST_ASSERT_FALSE(policy.update(true, start + 59000, -1).fire());
+    TEST_ASSERT_EQUAL(CAPTURE_PERIODIC, policy.update(true, start + 60000, -1).reason);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_rules);
+    RUN_TEST(test_arrival_only_matches_previous_firmware);
+    RUN_TEST(test_departure_and_periodic_during_long_occupation);
+    RUN_TEST(test_rate_limit_is_a_sliding_hour);
+    RUN_TEST(test_hours_window_crossing_midnight_and_unknown_time);
+    RUN_TEST(test_first_matching_rule_wins);
+    RUN_TEST(test_periodic_due_together_fire_on_consecutive_calls);
+    RUN_TEST(test_periodic_survives_millis_wraparound);
+    return UNITY_END();
+}
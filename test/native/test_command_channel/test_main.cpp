@@ -0,0 +1,270 @@
+// Pruebas del canal de comandos en el host (pio test -e native)
+// Incluye ida y vuelta completa: ParkingSensor real conectado por TCP a un
+// servidor de prueba que envía tramas CFG y lee las confirmaciones.
+
+#include <unity.h>
+#include <string.h>
+#include <string>
+
+#include "Hal.h"
+#include "CommandChannel.h"
+#include "ParkingSensor.h"
+#include "TestServer.h"
+
+static Command parseFrame(const char* frame) {
+    Command command;
+    parseCommand(frame, command);
+    return command;
+}
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(1000.0); // 5 s de reconexión en 5 ms reales
+}
+
+void tearDown(void) {}
+
+void test_parser_splits_frames_across_feeds(void) {
+    CommandParser parser;
+    const char* input = "CFG 1 thres";
+    for (const char* c = input; *c; c++) {
+        TEST_ASSERT_FALSE(parser.feed(*c));
+    }
+    const char* rest = "hold=30\r\nPING 2\n";
+    int frames = 0;
+    for (const char* c = rest; *c; c++) {
+        if (parser.feed(*c)) {
+            frames++;
+            if (frames == 1) {
+                TEST_ASSERT_EQUAL_STRING("CFG 1 threshold=30", parser.frame());
+            } else {
+                TEST_ASSERT_EQUAL_STRING("PING 2", parser.frame());
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(2, frames);
+}
+
+void test_parser_drops_oversized_frame(void) {
+    CommandParser parser;
+    for (int i = 0; i < CMD_MAX_FRAME + 10; i++) {
+        TEST_ASSERT_FALSE(parser.feed('x'));
+    }
+    TEST_ASSERT_FALSE(parser.feed('\n'));
+
+    const char* next = "PING 3\n";
+    bool complete = false;
+    for (const char* c = next; *c; c++) {
+        complete = parser.feed(*c);
+    }
+    TEST_ASSERT_TRUE(complete);
+    TEST_ASSERT_EQUAL_STRING("PING 3", parser.frame());
+}
+
+void test_parse_typed_config(void) {
+    Command command = parseFrame("CFG 42 threshold=35.5 id=9 server=10.0.0.5:9090 interval=750 res=8 quality=15");
+    TEST_ASSERT_EQUAL(CMD_CONFIG, command.type);
+    TEST_ASSERT_EQUAL(CMD_OK, command.status);
+    TEST_ASSERT_EQUAL_UINT32(42, command.seq);
+    TEST_ASSERT_EQUAL_FLOAT(35.5f, command.config.thresholdDistance);
+    TEST_ASSERT_EQUAL(9, command.config.parkingId);
+    TEST_ASSERT_EQUAL_STRING("10.0.0.5", command.config.serverIP);
+    TEST_ASSERT_EQUAL(9090, command.config.serverPort);
+    TEST_ASSERT_EQUAL(750, command.config.measurementInterval);
+    TEST_ASSERT_EQUAL(8, command.config.cameraResolution);
+    TEST_ASSERT_EQUAL(15, command.config.cameraQuality);
+    TEST_ASSERT_EQUAL(CFG_THRESHOLD | CFG_PARKING_ID | CFG_SERVER | CFG_INTERVAL | CFG_RESOLUTION | CFG_QUALITY,
+                      command.config.fields);
+}
+
+void test_parse_heartbeat_interval(void) {
+    Command command = parseFrame("CFG 3 hb=30000");
+    TEST_ASSERT_EQUAL(CMD_OK, command.status);
+    TEST_ASSERT_EQUAL(CFG_HEARTBEAT, command.config.fields);
+    TEST_ASSERT_EQUAL(30000, command.config.heartbeatInterval);
+
+    TEST_ASSERT_EQUAL(CMD_OK, parseFrame("CFG 4 hb=0").status);
+    TEST_ASSERT_EQUAL(CMD_OUT_OF_RANGE, parseFrame("CFG 5 hb=10").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_VALUE, parseFrame("CFG 6 hb=-").status);
+}
+
+void test_parse_region_of_interest(void) {
+    Command command = parseFrame("CFG 8 roi=250,400,500,600");
+    TEST_ASSERT_EQUAL(CMD_OK, command.status);
+    TEST_ASSERT_EQUAL(CFG_ROI, command.config.fields);
+    TEST_ASSERT_EQUAL(250, command.config.cameraRoi[0]);
+    TEST_ASSERT_EQUAL(400, command.config.cameraRoi[1]);
+    TEST_ASSERT_EQUAL(500, command.config.cameraRoi[2]);
+    TEST_ASSERT_EQUAL(600, command.config.cameraRoi[3]);
+
+    Command off = parseFrame("CFG 9 roi=off");
+    TEST_ASSERT_EQUAL(CMD_OK, off.status);
+    TEST_ASSERT_EQUAL(0, off.config.cameraRoi[2]);
+    TEST_ASSERT_EQUAL(CMD_OUT_OF_RANGE, parseFrame("CFG 10 roi=600,0,500,100").status);
+    TEST_ASSERT_EQUAL(CMD_OUT_OF_RANGE, parseFrame("CFG 11 roi=0,0,0,100").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_VALUE, parseFrame("CFG 12 roi=0,0,100").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_VALUE, parseFrame("CFG 13 roi=0,0,100,100,5").status);
+}
+
+void test_parse_rejects_bad_values(void) {
+    TEST_ASSERT_EQUAL(CMD_OUT_OF_RANGE, parseFrame("CFG 1 threshold=1000").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_VALUE, parseFrame("CFG 1 threshold=abc").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_VALUE, parseFrame("CFG 1 interval=10x").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_VALUE, parseFrame("CFG 1 server=10.0.0.1").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_FRAME, parseFrame("CFG 1").status);
+    TEST_ASSERT_EQUAL(CMD_BAD_FRAME, parseFrame("CFG").status);
+
+    Command unknown = parseFrame("CFG 5 threshold=30 color=red");
+    TEST_ASSERT_EQUAL(CMD_UNKNOWN_KEY, unknown.status);
+    TEST_ASSERT_EQUAL_UINT32(5, unknown.seq);
+    TEST_ASSERT_EQUAL_STRING("color", unknown.errorKey);
+}
+
+void test_parse_event_ack(void) {
+    // El timestamp de millis() ocupa los 32 bits completos tras ~25 días
+    Command command = parseFrame("EVT 4000000000");
+    TEST_ASSERT_EQUAL(CMD_EVENT_ACK, command.type);
+    TEST_ASSERT_EQUAL(CMD_OK, command.status);
+    TEST_ASSERT_EQUAL_UINT32(4000000000u, command.seq);
+    TEST_ASSERT_EQUAL(CMD_BAD_FRAME, parseFrame("EVT -1").status);
+
+    Command postmortem = parseFrame("PMK 57");
+    TEST_ASSERT_EQUAL(CMD_POSTMORTEM_ACK, postmortem.type);
+    TEST_ASSERT_EQUAL_UINT32(57, postmortem.seq);
+
+    Command batch = parseFrame("GWK 9");
+    TEST_ASSERT_EQUAL(CMD_GATEWAY_ACK, batch.type);
+    TEST_ASSERT_EQUAL_UINT32(9, batch.seq);
+}
+
+void test_parse_image_response(void) {
+    Command ok = parseFrame("{\"status\": \"success\", \"message\": \"Imagen recibida correctamente\"}");
+    TEST_ASSERT_EQUAL(CMD_IMAGE_ACK, ok.type);
+    TEST_ASSERT_EQUAL(CMD_OK, ok.status);
+
+    Command error = parseFrame("{\"status\": \"error\", \"message\": \"Incorrect padding\"}");
+    TEST_ASSERT_EQUAL(CMD_IMAGE_ACK, error.type);
+    TEST_ASSERT_EQUAL(CMD_REJECTED, error.status);
+}
+
+// ---- Ida y vuelta con el ParkingSensor real ----
+
+static int lastCameraQuality = -1;
+static bool cameraAccepts = true;
+
+static bool cameraHandler(const ConfigUpdate& config) {
+    if (!cameraAccepts) {
+        return false;
+    }
+    if (config.fields & CFG_QUALITY) {
+        lastCameraQuality = config.cameraQuality;
+    }
+    return true;
+}
+
+void test_round_trip_with_native_sensor(void) {
+    TestServer server;
+    startServer(server);
+
+    ParkingSensor sensor(35, 36, 7, "127.0.0.1", server.port);
+    sensor.begin();
+    sensor.setConfigHandler(cameraHandler);
+    cameraAccepts = true;
+    lastCameraQuality = -1;
+
+    std::string line;
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"hello\":true,\"parkingId\":7}", line.c_str());
+
+    // Cambio válido, con la trama partida en dos envíos
+    sendFrame(server, "CFG 9 threshold=33.5 ");
+    sensor.update();
+    sendFrame(server, "interval=700 quality=20\n");
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":9,\"parkingId\":7,\"status\":\"ok\"}", line.c_str());
+    TEST_ASSERT_EQUAL_FLOAT(33.5f, sensor.getThresholdDistance());
+    TEST_ASSERT_EQUAL(700, sensor.getMeasurementInterval());
+    TEST_ASSERT_EQUAL(20, lastCameraQuality);
+
+    // Un valor inválido descarta toda la trama
+    sendFrame(server, "CFG 10 threshold=40 res=99\n");
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":10,\"parkingId\":7,\"status\":\"error\",\"error\":\"out_of_range\",\"key\":\"res\"}",
+                             line.c_str());
+    TEST_ASSERT_EQUAL_FLOAT(33.5f, sensor.getThresholdDistance());
+
+    // Si la cámara rechaza el cambio, tampoco se aplica lo del sensor
+    cameraAccepts = false;
+    sendFrame(server, "CFG 11 threshold=45 quality=30\n");
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":11,\"parkingId\":7,\"status\":\"error\",\"error\":\"rejected\",\"key\":\"\"}",
+                             line.c_str());
+    TEST_ASSERT_EQUAL_FLOAT(33.5f, sensor.getThresholdDistance());
+    TEST_ASSERT_EQUAL(20, lastCameraQuality);
+
+    sendFrame(server, "PING 12\n");
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":12,\"parkingId\":7,\"status\":\"ok\"}", line.c_str());
+
+    stopServer(server);
+}
+
+void test_heartbeat_mode_with_native_sensor(void) {
+    TestServer server;
+    startServer(server);
+    hal::sim::setFixedDistance(120.0f);
+
+    ParkingSensor sensor(35, 36, 8, "127.0.0.1", server.port);
+    sensor.begin();
+    sensor.setHeartbeatInterval(60000); // 60 ms reales
+
+    std::string line;
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"hello\":true,\"parkingId\":8,\"hb\":60000}", line.c_str());
+
+    // La primera medición se tomó sin conexión (seq 1 perdida): se reenvía el estado
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_TRUE(line.find("\"occupied\":false") != std::string::npos);
+    TEST_ASSERT_TRUE(line.find("\"seq\":2}") != std::string::npos);
+
+    // Sin cambios solo llegan heartbeats
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("HB 3 0 "));
+    TEST_ASSERT_EQUAL(1, sensor.getHeartbeatsSent());
+
+    // Un cambio envía el evento completo con la siguiente secuencia
+    hal::sim::setFixedDistance(20.0f);
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_TRUE(line.find("\"occupied\":true") != std::string::npos);
+    TEST_ASSERT_TRUE(line.find("\"seq\":4}") != std::string::npos);
+
+    // hb=0 vuelve al protocolo de eventos clásico
+    sendFrame(server, "CFG 20 hb=0\n");
+    do {
+        TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    } while (line.compare(0, 3, "HB ") == 0);
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":20,\"parkingId\":8,\"status\":\"ok\"}", line.c_str());
+    TEST_ASSERT_EQUAL(0, sensor.getHeartbeatInterval());
+    sendFrame(server, "PING 21\n");
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":21,\"parkingId\":8,\"status\":\"ok\"}", line.c_str());
+
+    stopServer(server);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_parser_splits_frames_across_feeds);
+    RUN_TEST(test_parser_drops_oversized_frame);
+    RUN_TEST(test_parse_typed_config);
+    RUN_TEST(test_parse_heartbeat_interval);
+    RUN_TEST(test_parse_region_of_interest);
+    RUN_TEST(test_parse_rejects_bad_values);
+    RUN_TEST(test_parse_event_ack);
+    RUN_TEST(test_parse_image_response);
+    RUN_TEST(test_round_trip_with_native_sensor);
+    RUN_TEST(test_heartbeat_mode_with_native_sensor);
+    return UNITY_END();
+}
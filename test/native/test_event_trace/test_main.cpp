@@ -0,0 +1,96 @@
+// Pruebas de la traza binaria y de la decisión de ocupación en el host
+// (pio test -e native): conversión de líneas de parking_sensor.log y
+// reproducción de eventos con OccupancyDecision.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "EventTrace.h"
+#include "OccupancyDecision.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_parse_server_log_line(void) {
+    TraceRecord record;
+    TEST_ASSERT_TRUE(parseLogLine("2025-09-05 11:47:03 | ('192.168.1.21', 58180) | "
+                                  "{\"parkingId\": 1, \"occupied\": true, \"distance\": 14.3, \"timestamp\": 493489}\n",
+                                  record));
+    TEST_ASSERT_EQUAL_UINT32(1757072823UL, record.wall);
+    TEST_ASSERT_EQUAL_UINT32(493489, record.deviceMs);
+    TEST_ASSERT_EQUAL(1, record.parkingId);
+    TEST_ASSERT_EQUAL(143, record.distanceDm);
+    TEST_ASSERT_TRUE(traceOccupied(record));
+
+    // Orden de claves distinto y campos extra (modo heartbeat)
+    TEST_ASSERT_TRUE(parseLogLine("2025-09-05 11:47:03 | ('10.0.0.2', 1) | "
+                                  "{\"occupied\":false,\"parkingId\":7,\"distance\":60.0,\"timestamp\":5,\"seq\":3}",
+                                  record));
+    TEST_ASSERT_EQUAL(7, record.parkingId);
+    TEST_ASSERT_FALSE(traceOccupied(record));
+}
+
+void test_parse_rejects_other_lines(void) {
+    TraceRecord record;
+    TEST_ASSERT_FALSE(parseLogLine("", record));
+    TEST_ASSERT_FALSE(parseLogLine("2025-09-05 11:47:03 | ('10.0.0.2', 1) | {\"hello\": true}", record));
+    TEST_ASSERT_FALSE(parseLogLine("05/09/2025 11:47 | x | {\"parkingId\": 1}", record));
+}
+
+void test_convert_writes_header_and_records(void) {
+    char logPath[] = "/tmp/event_trace_logXXXXXX";
+    int fd = mkstemp(logPath);
+    FILE* log = fdopen(fd, "w");
+    fputs("2025-09-05 11:39:26 | ('192.168.1.21', 58180) | "
+          "{\"parkingId\": 1, \"occupied\": false, \"distance\": 60.0, \"timestamp\": 36600}\n", log);
+    fputs("línea que no es un evento\n", log);
+    fputs("2025-09-05 11:47:03 | ('192.168.1.21', 58180) | "
+          "{\"parkingId\": 1, \"occupied\": true, \"distance\": 14.3, \"timestamp\": 493489}\n", log);
+    fclose(log);
+
+    char tracePath[64];
+    snprintf(tracePath, sizeof(tracePath), "%s.trace", logPath);
+    unsigned long skipped = 0;
+    TEST_ASSERT_EQUAL(2, convertLog(logPath, tracePath, &skipped));
+    TEST_ASSERT_EQUAL(1, skipped);
+
+    FILE* trace = fopen(tracePath, "rb");
+    uint64_t count = 0;
+    TEST_ASSERT_TRUE(readTraceHeader(trace, count));
+    TEST_ASSERT_EQUAL(2, (int)count);
+    TraceRecord records[2];
+    TEST_ASSERT_EQUAL(2, fread(records, sizeof(TraceRecord), 2, trace));
+    TEST_ASSERT_EQUAL_UINT32(36600, records[0].deviceMs);
+    TEST_ASSERT_TRUE(traceOccupied(records[1]));
+    fclose(trace);
+    unlink(logPath);
+    unlink(tracePath);
+}
+
+void test_decision_sends_first_and_changes_only(void) {
+    OccupancyDecision decision(50.0f);
+    TEST_ASSERT_TRUE(decision.apply(120.0f));     // Primera medición
+    TEST_ASSERT_FALSE(decision.apply(110.0f));
+    TEST_ASSERT_TRUE(decision.apply(30.0f));
+    TEST_ASSERT_TRUE(decision.isOccupied() && decision.hasChanged());
+    TEST_ASSERT_FALSE(decision.apply(31.0f));
+
+    decision.reset();                             // Reinicio del dispositivo
+    TEST_ASSERT_TRUE(decision.apply(32.0f));
+    TEST_ASSERT_FALSE(OccupancyDecision::isValidDistance(1.5f));
+    TEST_ASSERT_FALSE(OccupancyDecision::isValidDistance(450.0f));
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_server_log_line);
+    RUN_TEST(test_parse_rejects_other_lines);
+    RUN_TEST(test_convert_writes_header_and_records);
+    RUN_TEST(test_decision_sends_first_and_changes_only);
+    return UNITY_END();
+}
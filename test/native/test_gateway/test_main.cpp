@@ -0,0 +1,236 @@
+// Pruebas del modo gateway en el host (pio test -e native): tramas de hoja,
+// deduplicación, lotes confirmados con GWK y reenvío tras reconectar.
+
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "Hal.h"
+#include "HalLink.h"
+#include "Gateway.h"
+#include "GatewayFrame.h"
+#include "ParkingSensor.h"
+#include "TestServer.h"
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+}
+
+void tearDown(void) {
+    hal::sim::setTimeScale(1.0);
+}
+
+static GatewayFrame makeFrame(uint16_t parkingId, uint16_t epoch, uint32_t seq, uint8_t type) {
+    GatewayFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.parkingId = parkingId;
+    frame.epoch = epoch;
+    frame.seq = seq;
+    frame.type = type;
+    frame.occupied = true;
+    frame.distanceDm = 253;
+    frame.leafMs = 90000 + seq;
+    frame.validMeasurements = 40;
+    frame.failedMeasurements = 2;
+    return frame;
+}
+
+static bool submitFrame(Gateway& gateway, const GatewayFrame& frame) {
+    uint8_t bytes[GW_FRAME_SIZE];
+    return gateway.submit(bytes, encodeGatewayFrame(frame, bytes));
+}
+
+void test_frame_round_trip(void) {
+    GatewayFrame frame = makeFrame(513, 0xBEEF, 70000, GW_FRAME_HEARTBEAT);
+    uint8_t bytes[GW_FRAME_SIZE];
+    TEST_ASSERT_EQUAL(GW_FRAME_SIZE, encodeGatewayFrame(frame, bytes));
+    TEST_ASSERT_EQUAL_HEX32(GW_FRAME_MAGIC, bytes[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x82, bytes[1]);         // Heartbeat | ocupado
+    TEST_ASSERT_EQUAL_HEX32(0x01, bytes[2]);         // 513 little-endian
+    TEST_ASSERT_EQUAL_HEX32(0x02, bytes[3]);
+
+    GatewayFrame decoded;
+    TEST_ASSERT_TRUE(decodeGatewayFrame(bytes, sizeof(bytes), decoded));
+    TEST_ASSERT_EQUAL(513, decoded.parkingId);
+    TEST_ASSERT_EQUAL_HEX32(0xBEEF, decoded.epoch);
+    TEST_ASSERT_EQUAL(GW_FRAME_HEARTBEAT, decoded.type);
+    TEST_ASSERT_TRUE(decoded.occupied);
+    TEST_ASSERT_EQUAL(253, decoded.distanceDm);
+    TEST_ASSERT_EQUAL_UINT32(70000, decoded.seq);
+    TEST_ASSERT_EQUAL_UINT32(160000, decoded.leafMs);
+    TEST_ASSERT_EQUAL_UINT32(40, decoded.validMeasurements);
+    TEST_ASSERT_EQUAL_UINT32(2, decoded.failedMeasurements);
+    TEST_ASSERT_EQUAL(0, decoded.health);
+
+    // La salud del sensor va entre el tipo y el bit de ocupado
+    frame.health = 4;
+    encodeGatewayFrame(frame, bytes);
+    TEST_ASSERT_EQUAL_HEX32(0xC2, bytes[1]);
+    TEST_ASSERT_TRUE(decodeGatewayFrame(bytes, sizeof(bytes), decoded));
+    TEST_ASSERT_EQUAL(GW_FRAME_HEARTBEAT, decoded.type);
+    TEST_ASSERT_EQUAL(4, decoded.health);
+    TEST_ASSERT_TRUE(decoded.occupied);
+
+    TEST_ASSERT_FALSE(decodeGatewayFrame(bytes, sizeof(bytes) - 1, decoded));
+    bytes[1] = 0x03;                                // Tipo desconocido
+    TEST_ASSERT_FALSE(decodeGatewayFrame(bytes, sizeof(bytes), decoded));
+    bytes[1] = 0x01;
+    bytes[0] = 'X';
+    TEST_ASSERT_FALSE(decodeGatewayFrame(bytes, sizeof(bytes), decoded));
+}
+
+void test_duplicates_restarts_and_full_queue(void) {
+    static Gateway gateway(1, "127.0.0.1", 1);
+    TEST_ASSERT_TRUE(submitFrame(gateway, makeFrame(11, 7, 1, GW_FRAME_EVENT)));
+    TEST_ASSERT_TRUE(submitFrame(gateway, makeFrame(11, 7, 2, GW_FRAME_HEARTBEAT)));
+    // Reintento cuya confirmación se perdió y trama atrasada
+    TEST_ASSERT_FALSE(submitFrame(gateway, makeFrame(11, 7, 2, GW_FRAME_HEARTBEAT)));
+    TEST_ASSERT_FALSE(submitFrame(gateway, makeFrame(11, 7, 1, GW_FRAME_EVENT)));
+    // La hoja se reinició: otro epoch, el seq vuelve a 1
+    TEST_ASSERT_TRUE(submitFrame(gateway, makeFrame(11, 8, 1, GW_FRAME_EVENT)));
+    TEST_ASSERT_TRUE(submitFrame(gateway, makeFrame(12, 7, 1, GW_FRAME_EVENT)));
+
+    uint8_t junk[5] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_FALSE(gateway.submit(junk, sizeof(junk)));
+
+    GatewayStats stats = gateway.getStats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.received);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.invalid);
+    TEST_ASSERT_EQUAL(2, stats.leaves);
+    TEST_ASSERT_EQUAL(4, stats.queued);
+
+    // Cola llena: se pierden las más viejas
+    for (uint32_t seq = 2; seq < 2 + GW_QUEUE_FRAMES; seq++) {
+        submitFrame(gateway, makeFrame(12, 7, seq, GW_FRAME_HEARTBEAT));
+    }
+    stats = gateway.getStats();
+    TEST_ASSERT_EQUAL(GW_QUEUE_FRAMES, stats.queued);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.dropped);
+
+    static char line[GW_BATCH_BYTES];
+    gateway.buildBatch(2, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("{\"gateway\":1,\"epoch\":0,\"batch\":0,\"frames\":["
+                             "[12,2,2,1,25.3,90002,40,2,0],[12,3,2,1,25.3,90003,40,2,0]]}\r\n", line);
+}
+
+// ---- Lotes contra un servidor local ----
+
+static std::vector<unsigned long> ackLatencies;
+
+static void onAck(uint8_t type, unsigned long latencyUs) {
+    (void)type;
+    ackLatencies.push_back(latencyUs);
+}
+
+void test_batches_are_acknowledged_and_resent_after_reconnect(void) {
+    // 5 s de reconexión en 50 ms reales; el GWK sigue llegando antes de
+    // los GW_ACK_TIMEOUT_MS
+    hal::sim::setTimeScale(100.0);
+    TestServer server;
+    startServer(server);
+    static Gateway gateway(7, "127.0.0.1", server.port);
+    gateway.begin();
+    gateway.setLeafHeartbeat(30000);
+    gateway.setAckHandler(onAck);
+
+    submitFrame(gateway, makeFrame(21, 3, 1, GW_FRAME_EVENT));
+    submitFrame(gateway, makeFrame(22, 3, 1, GW_FRAME_EVENT));
+    submitFrame(gateway, makeFrame(21, 3, 2, GW_FRAME_HEARTBEAT));
+
+    std::string line;
+    TEST_ASSERT_TRUE(readLine(server, gateway, line));
+    TEST_ASSERT_EQUAL_STRING("{\"hello\":true,\"gateway\":7,\"hb\":30000}", line.c_str());
+    TEST_ASSERT_TRUE(readLine(server, gateway, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"gateway\":7,\"epoch\":"));
+    TEST_ASSERT_TRUE(line.find("\"batch\":1,\"frames\":[[21,1,1,1,25.3,90001,40,2,0],"
+                               "[22,1,1,1,25.3,90001,40,2,0],[21,2,2,1,25.3,90002,40,2,0]]}") != std::string::npos);
+    std::string first = line;
+
+    // Corte antes del GWK: el mismo lote vuelve a salir tras el hello
+    dropClient(server);
+    TEST_ASSERT_TRUE(readLine(server, gateway, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"hello\":true"));
+    TEST_ASSERT_TRUE(readLine(server, gateway, line));
+    TEST_ASSERT_EQUAL_STRING(first.c_str(), line.c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, gateway.getStats().batchesResent);
+
+    sendFrame(server, "GWK 1\n");
+    for (int i = 0; i < 100 && gateway.getStats().forwarded == 0; i++) {
+        gateway.update();
+        usleep(1000);
+    }
+    GatewayStats stats = gateway.getStats();
+    TEST_ASSERT_EQUAL_UINT32(3, stats.forwarded);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.batchesAcked);
+    TEST_ASSERT_EQUAL(0, stats.queued);
+    TEST_ASSERT_EQUAL(3, ackLatencies.size());
+
+    // Lo siguiente va en el lote 2
+    submitFrame(gateway, makeFrame(22, 3, 2, GW_FRAME_HEARTBEAT));
+    TEST_ASSERT_TRUE(readLine(server, gateway, line));
+    TEST_ASSERT_TRUE(line.find("\"batch\":2,\"frames\":[[22,2,2,") != std::string::npos);
+
+    stopServer(server);
+}
+
+// ---- Hoja: ParkingSensor real por el enlace UDP del host ----
+
+static hal::LocalLink* leafLink = NULL;
+
+static bool sendToGateway(const uint8_t* frame, size_t length) {
+    return leafLink->send(frame, length);
+}
+
+void test_leaf_sensor_reaches_gateway_over_link(void) {
+    hal::sim::setTimeScale(1000.0);
+    hal::sim::setFixedDistance(30.0f);
+
+    hal::LocalLink gatewayLink;
+    TEST_ASSERT_TRUE(gatewayLink.beginGateway(0));
+    TEST_ASSERT_TRUE(gatewayLink.port() != 0);
+    hal::LocalLink link;
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", (unsigned)gatewayLink.port());
+    TEST_ASSERT_TRUE(link.beginLeaf(address));
+    leafLink = &link;
+
+    static Gateway gateway(2, "127.0.0.1", 1);     // Sin servidor: solo se encola
+    gateway.setLink(&gatewayLink);
+
+    ParkingSensor sensor(35, 36, 31, "127.0.0.1", 1);
+    sensor.begin();
+    sensor.setHeartbeatInterval(1000);
+    sensor.setFrameSender(sendToGateway);
+    for (int i = 0; i < 500 && gateway.getStats().received < 2; i++) {
+        sensor.update();
+        gateway.update();
+        usleep(1000);
+    }
+
+    TEST_ASSERT_FALSE(sensor.isTcpConnected());
+    TEST_ASSERT_EQUAL(1, sensor.getEventsSent());
+    TEST_ASSERT_TRUE(sensor.getHeartbeatsSent() >= 1);
+    GatewayStats stats = gateway.getStats();
+    TEST_ASSERT_TRUE(stats.received >= 2);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.duplicates);
+    TEST_ASSERT_EQUAL(1, stats.leaves);
+
+    static char line[GW_BATCH_BYTES];
+    gateway.buildBatch(1, line, sizeof(line));
+    TEST_ASSERT_TRUE(strstr(line, "\"frames\":[[31,1,1,1,30.0,") != NULL);
+    TEST_ASSERT_TRUE(link.getStats().sent >= 2);
+    leafLink = NULL;
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_round_trip);
+    RUN_TEST(test_duplicates_restarts_and_full_queue);
+    RUN_TEST(test_batches_are_acknowledged_and_resent_after_reconnect);
+    RUN_TEST(test_leaf_sensor_reaches_gateway_over_link);
+    return UNITY_END();
+}
@@ -0,0 +1,181 @@
+// Pruebas de la HAL del host (pio test -e native)
+
+#include <unity.h>
+#include <thread>
+
+#include "Hal.h"
+#include "HalCamera.h"
+#include "HalBoard.h"
+#include "HalGpio.h"
+#include "ParkingSensor.h"
+#include "CameraManager.h"
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(1000.0);
+    hal::sim::setFixedDistance(80.0f);
+    hal::sim::currentBoard().distanceSource = NULL;
+}
+
+void tearDown(void) {}
+
+void test_ultrasonic_echo_matches_simulated_distance(void) {
+    ParkingSensor sensor(35, 36, 1, "127.0.0.1", 1);
+    sensor.begin();
+
+    hal::sim::setFixedDistance(25.0f);
+    sensor.forceMeasurement();
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 25.0f, sensor.getLastDistance());
+    TEST_ASSERT_TRUE(sensor.getIsOccupied());
+
+    hal::sim::setFixedDistance(120.0f);
+    sensor.forceMeasurement();
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 120.0f, sensor.getLastDistance());
+    TEST_ASSERT_FALSE(sensor.getIsOccupied());
+}
+
+void test_pulse_without_trigger_or_echo_times_out(void) {
+    TEST_ASSERT_EQUAL(0, hal::pulseInHigh(36, 50000));
+
+    hal::sim::setFixedDistance(-1.0f);
+    hal::gpioWrite(35, true);
+    hal::gpioWrite(35, false);
+    TEST_ASSERT_EQUAL(0, hal::pulseInHigh(36, 50000));
+
+    // Más allá del timeout del HC-SR04 tampoco hay eco
+    hal::sim::setFixedDistance(1000.0f);
+    hal::gpioWrite(35, true);
+    TEST_ASSERT_EQUAL(0, hal::pulseInHigh(36, 50000));
+}
+
+// Perfiles con conflictos: los static_assert de HalBoard.h los rechazarían
+static constexpr hal::BoardProfile TRIG_ON_CAMERA = {
+    "trig en PCLK", 13, 36,
+    {{11, 9, 8, 10, 12, 18, 17, 16}, 15, 13, 6, 7, 4, 5, BOARD_NO_PIN, BOARD_NO_PIN}, 0};
+static constexpr hal::BoardProfile SHARED_CAMERA_PIN = {
+    "VSYNC y HREF juntos", 35, 36,
+    {{11, 9, 8, 10, 12, 18, 17, 16}, 15, 13, 7, 7, 4, 5, BOARD_NO_PIN, BOARD_NO_PIN}, 0};
+static constexpr hal::BoardProfile ECHO_ON_FLASH = {
+    "eco en la flash", 35, 30,
+    {{11, 9, 8, 10, 12, 18, 17, 16}, 15, 13, 6, 7, 4, 5, BOARD_NO_PIN, BOARD_NO_PIN},
+    hal::board::pinRange(26, 32)};
+
+static_assert(hal::board::profileValid(hal::BOARD), "Perfil de la placa inválido");
+static_assert(!hal::board::sensorPinsFree(TRIG_ON_CAMERA), "Conflicto con la cámara no detectado");
+static_assert(!hal::board::cameraPinsDistinct(SHARED_CAMERA_PIN), "Pin repetido no detectado");
+static_assert(!hal::board::pinsNotReserved(ECHO_ON_FLASH), "Pin de la flash no detectado");
+
+void test_board_profile_and_register_ping(void) {
+    TEST_ASSERT_EQUAL(35, hal::BOARD.trigPin);
+    TEST_ASSERT_EQUAL(36, hal::BOARD.echoPin);
+    TEST_ASSERT_EQUAL(14, hal::board::bitCount(hal::board::cameraPins(hal::BOARD.camera)));
+    TEST_ASSERT_TRUE(hal::board::cameraPinsDistinct(TRIG_ON_CAMERA));
+    TEST_ASSERT_FALSE(hal::board::profileValid(TRIG_ON_CAMERA));
+    TEST_ASSERT_FALSE(hal::board::profileValid(SHARED_CAMERA_PIN));
+    TEST_ASSERT_FALSE(hal::board::profileValid(ECHO_ON_FLASH));
+
+    // La ruta con pines en plantilla da la misma medición que la de runtime
+    typedef hal::Ultrasonic<hal::BOARD.trigPin, hal::BOARD.echoPin> Hcsr04;
+    ParkingSensor runtime(hal::BOARD.trigPin, hal::BOARD.echoPin, 1, "127.0.0.1", 1);
+    ParkingSensor fast(hal::BOARD.trigPin, hal::BOARD.echoPin, 2, "127.0.0.1", 1);
+    runtime.begin();
+    fast.begin();
+    Hcsr04::begin();
+    fast.setPing(Hcsr04::ping);
+
+    hal::sim::setFixedDistance(42.0f);
+    TEST_ASSERT_EQUAL(2449, Hcsr04::ping(50000));    // 42 * 2 / 0.0343
+    runtime.forceMeasurement();
+    fast.forceMeasurement();
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 42.0f, fast.getLastDistance());
+    TEST_ASSERT_EQUAL_FLOAT(runtime.getLastDistance(), fast.getLastDistance());
+
+    hal::sim::setFixedDistance(-1.0f);
+    TEST_ASSERT_EQUAL(0, Hcsr04::ping(50000));
+}
+
+static float constantDistance(void* context, unsigned long nowMs) {
+    (void)nowMs;
+    return *(float*)context;
+}
+
+void test_boards_are_per_thread(void) {
+    float distances[2] = {15.0f, 150.0f};
+    float measured[2] = {0, 0};
+
+    std::thread workers[2];
+    for (int i = 0; i < 2; i++) {
+        workers[i] = std::thread([&, i] {
+            hal::sim::Board board;
+            hal::sim::initBoard(board);
+            board.serialEnabled = false;
+            board.timeScale = 1000.0;
+            board.distanceSource = constantDistance;
+            board.context = &distances[i];
+            hal::sim::bindBoard(&board);
+
+            ParkingSensor sensor(35, 36, i + 1, "127.0.0.1", 1);
+            sensor.forceMeasurement();
+            measured[i] = sensor.getLastDistance();
+            hal::sim::bindBoard(NULL);
+        });
+    }
+    workers[0].join();
+    workers[1].join();
+
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 15.0f, measured[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 150.0f, measured[1]);
+}
+
+void test_simulated_camera_follows_quality_and_resolution(void) {
+    CameraManager camera;
+    TEST_ASSERT_TRUE(camera.begin());
+    TEST_ASSERT_EQUAL(FRAMESIZE_QVGA, camera.getCurrentResolution());
+
+    camera_fb_t* fb = esp_camera_fb_get();
+    TEST_ASSERT_NOT_NULL(fb);
+    TEST_ASSERT_EQUAL(320, fb->width);
+    TEST_ASSERT_EQUAL(0xFF, fb->buf[0]);
+    TEST_ASSERT_EQUAL(0xD8, fb->buf[1]);
+    TEST_ASSERT_EQUAL(0xD9, fb->buf[fb->len - 1]);
+    size_t qvgaSize = fb->len;
+
+    // Con un solo buffer no hay otra captura hasta devolver la anterior
+    TEST_ASSERT_NULL(esp_camera_fb_get());
+    esp_camera_fb_return(fb);
+
+    camera.setQuality(40);
+    fb = esp_camera_fb_get();
+    TEST_ASSERT_LESS_THAN(qvgaSize, fb->len);
+    esp_camera_fb_return(fb);
+
+    camera.setQuality(12);
+    camera.setVGA();
+    fb = esp_camera_fb_get();
+    TEST_ASSERT_EQUAL(640, fb->width);
+    TEST_ASSERT_GREATER_THAN(qvgaSize, fb->len);
+    esp_camera_fb_return(fb);
+
+    camera.end();
+    TEST_ASSERT_NULL(esp_camera_sensor_get());
+}
+
+void test_memory_stats_are_reported(void) {
+    hal::MemoryStats stats = hal::memoryStats();
+    TEST_ASSERT_GREATER_THAN(0, stats.totalHeap);
+    TEST_ASSERT_LESS_OR_EQUAL(stats.totalHeap, stats.freeHeap);
+    TEST_ASSERT_LESS_OR_EQUAL(stats.freeHeap, stats.minFreeHeap);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_ultrasonic_echo_matches_simulated_distance);
+    RUN_TEST(test_pulse_without_trigger_or_echo_times_out);
+    RUN_TEST(test_board_profile_and_register_ping);
+    RUN_TEST(test_boards_are_per_thread);
+    RUN_TEST(test_simulated_camera_follows_quality_and_resolution);
+    RUN_TEST(test_memory_stats_are_reported);
+    return UNITY_END();
+}
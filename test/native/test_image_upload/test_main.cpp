@@ -0,0 +1,146 @@
+// Pruebas de la ruta de imágenes en el host (pio test -e native):
+// base64 por bloques, JpegTuner y captura con ajuste automático sobre la
+// cámara simulada.
+
+#include <unity.h>
+#include <string.h>
+
+#include "Hal.h"
+#include "HalCamera.h"
+#include "Base64.h"
+#include "JpegTuner.h"
+#include "CameraManager.h"
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(1000.0); // Las esperas de CameraManager::begin() en ms reales
+}
+
+void tearDown(void) {}
+
+// ---- Base64 ----
+
+void test_base64_rfc4648_vectors(void) {
+    const char* inputs[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    const char* expected[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    for (int i = 0; i < 7; i++) {
+        String encoded = base64Encode((const uint8_t*)inputs[i], strlen(inputs[i]));
+        TEST_ASSERT_EQUAL_STRING(expected[i], encoded.c_str());
+        TEST_ASSERT_EQUAL(strlen(expected[i]), base64Length(strlen(inputs[i])));
+    }
+}
+
+void test_base64_blocks_match_whole_encoding(void) {
+    uint8_t data[1000];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 131 + 7);
+    }
+
+    // Bloques de 768 bytes como en ParkingSensor::sendImage()
+    char streamed[1400];
+    size_t length = 0;
+    for (size_t i = 0; i < sizeof(data); i += 768) {
+        size_t n = sizeof(data) - i < 768 ? sizeof(data) - i : 768;
+        length += base64EncodeBlock(data + i, n, streamed + length);
+    }
+    streamed[length] = '\0';
+
+    String whole = base64Encode(data, sizeof(data));
+    TEST_ASSERT_EQUAL(base64Length(sizeof(data)), length);
+    TEST_ASSERT_EQUAL_STRING(whole.c_str(), streamed);
+}
+
+// ---- JpegTuner ----
+
+void test_tuner_keeps_best_quality_on_strong_link(void) {
+    JpegTuner tuner;
+    tuner.reportRssi(-45);
+    JpegSettings settings = tuner.nextSettings();
+    TEST_ASSERT_EQUAL(FRAMESIZE_QVGA, settings.framesize);
+    TEST_ASSERT_EQUAL(12, settings.quality);
+}
+
+void test_tuner_fits_budget_on_weak_link(void) {
+    JpegTuner tuner;
+    tuner.setFramesizeRange(FRAMESIZE_QQVGA, FRAMESIZE_QVGA);
+    tuner.reportRssi(-85);
+
+    // Escena compleja: el cuadro anterior salió el doble de lo que predice el modelo
+    JpegSettings first = {FRAMESIZE_QVGA, 12};
+    tuner.reportFrame(first, 2 * JpegTuner::predictSize(FRAMESIZE_QVGA, 12, 1.0f));
+
+    // Peor calidad o menor resolución, pero dentro del presupuesto
+    JpegSettings settings = tuner.nextSettings();
+    TEST_ASSERT_TRUE(settings.quality > 12 || settings.framesize < FRAMESIZE_QVGA);
+    size_t predicted = JpegTuner::predictSize(settings.framesize, settings.quality, tuner.sceneComplexity());
+    TEST_ASSERT_TRUE(predicted <= tuner.byteBudget());
+}
+
+void test_tuner_uses_measured_throughput(void) {
+    JpegTuner tuner;
+    tuner.reportRssi(-60);
+    size_t rssiBudget = tuner.byteBudget();
+
+    // Subidas mucho más lentas que lo que sugiere el RSSI
+    for (int i = 0; i < 5; i++) {
+        tuner.reportUpload(20000, 4000);
+    }
+    TEST_ASSERT_TRUE(tuner.byteBudget() < rssiBudget / 4);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 5.0f, tuner.linkThroughput());
+
+    // Si el RSSI empeora después de medir, el estimado baja
+    tuner.reportRssi(-75);
+    TEST_ASSERT_TRUE(tuner.linkThroughput() < 5.0f);
+}
+
+void test_tuner_only_downscales_same_aspect(void) {
+    JpegTuner tuner;
+    tuner.setFramesizeRange(FRAMESIZE_QQVGA, FRAMESIZE_QVGA);
+    tuner.reportRssi(-95);
+    JpegSettings first = {FRAMESIZE_QVGA, 12};
+    tuner.reportFrame(first, 3 * JpegTuner::predictSize(FRAMESIZE_QVGA, 12, 1.0f));
+
+    // Ni 240x240 ni HQVGA: de QVGA se pasa directo a QQVGA
+    JpegSettings settings = tuner.nextSettings();
+    TEST_ASSERT_EQUAL(FRAMESIZE_QQVGA, settings.framesize);
+}
+
+// ---- Captura con la cámara simulada ----
+
+void test_camera_auto_tune_shrinks_frames(void) {
+    CameraManager camera;
+    TEST_ASSERT_TRUE(camera.begin());
+
+    camera_fb_t* fb = camera.capture();
+    TEST_ASSERT_NOT_NULL(fb);
+    size_t fixedBytes = fb->len;
+    camera.release(fb);
+
+    camera.setAutoTune(true);
+    hal::sim::currentBoard().rssi = -88;
+    for (int i = 0; i < 3; i++) {
+        fb = camera.capture();
+        TEST_ASSERT_NOT_NULL(fb);
+        camera.release(fb);
+    }
+    TEST_ASSERT_TRUE(camera.getLastSettings().quality > 12);
+    TEST_ASSERT_TRUE(camera.getLastFrameBytes() < fixedBytes);
+    TEST_ASSERT_EQUAL(camera.getLastSettings().quality, camera.getCurrentQuality());
+
+    hal::sim::currentBoard().rssi = -55;
+    camera.end();
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_base64_rfc4648_vectors);
+    RUN_TEST(test_base64_blocks_match_whole_encoding);
+    RUN_TEST(test_tuner_keeps_best_quality_on_strong_link);
+    RUN_TEST(test_tuner_fits_budget_on_weak_link);
+    RUN_TEST(test_tuner_uses_measured_throughput);
+    RUN_TEST(test_tuner_only_downscales_same_aspect);
+    RUN_TEST(test_camera_auto_tune_shrinks_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,172 @@
+// Pruebas del recorte JPEG en bordes de MCU y de la región de interés de
+// CameraManager (pio test -e native)
+//
+// El OV2640 simulado entrega JPEG baseline 4:2:2 reales, así que el recorte
+// se prueba sobre los mismos cuadros que se envían al servidor.
+
+#include <unity.h>
+#include <string.h>
+#include <vector>
+
+#include "Hal.h"
+#include "HalCamera.h"
+#include "JpegCrop.h"
+#include "CameraManager.h"
+
+static CameraManager* camera = NULL;
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(1000.0);     // Las esperas de begin() en ms reales
+    camera = new CameraManager();
+    TEST_ASSERT_TRUE(camera->begin());
+}
+
+void tearDown(void) {
+    camera->end();
+    delete camera;
+    camera = NULL;
+}
+
+static std::vector<uint8_t> sensorFrame(framesize_t framesize) {
+    camera->setResolution(framesize);
+    camera_fb_t* fb = esp_camera_fb_get();
+    TEST_ASSERT_NOT_NULL(fb);
+    std::vector<uint8_t> jpeg(fb->buf, fb->buf + fb->len);
+    esp_camera_fb_return(fb);
+    return jpeg;
+}
+
+static size_t cropTo(const std::vector<uint8_t>& jpeg, JpegRect rect, std::vector<uint8_t>& out,
+                     JpegRect* applied = NULL) {
+    JpegCropper cropper;
+    out.resize(JpegCropper::outputCapacity(jpeg.size()));
+    size_t length = cropper.crop(jpeg.data(), jpeg.size(), rect, out.data(), out.size(), applied);
+    out.resize(length);
+    return length;
+}
+
+void test_full_frame_crop_is_identity(void) {
+    std::vector<uint8_t> jpeg = sensorFrame(FRAMESIZE_QVGA);
+    std::vector<uint8_t> out;
+    JpegRect applied;
+    TEST_ASSERT_EQUAL(jpeg.size(), cropTo(jpeg, {0, 0, 320, 240}, out, &applied));
+    TEST_ASSERT_EQUAL_MEMORY(jpeg.data(), out.data(), jpeg.size());
+    TEST_ASSERT_EQUAL(320, applied.width);
+    TEST_ASSERT_EQUAL(240, applied.height);
+}
+
+void test_crop_aligns_to_mcu_and_composes(void) {
+    std::vector<uint8_t> jpeg = sensorFrame(FRAMESIZE_VGA);
+    std::vector<uint8_t> out;
+    JpegRect applied;
+    TEST_ASSERT_GREATER_THAN(0, cropTo(jpeg, {200, 170, 250, 200}, out, &applied));
+
+    // MCU de 16x8 en el 4:2:2 del OV2640: el rectángulo crece hacia afuera
+    TEST_ASSERT_EQUAL(192, applied.x);
+    TEST_ASSERT_EQUAL(168, applied.y);
+    TEST_ASSERT_EQUAL(272, applied.width);
+    TEST_ASSERT_EQUAL(208, applied.height);
+    uint16_t width = 0;
+    uint16_t height = 0;
+    TEST_ASSERT_TRUE(JpegCropper::imageSize(out.data(), out.size(), &width, &height));
+    TEST_ASSERT_EQUAL(272, width);
+    TEST_ASSERT_EQUAL(208, height);
+    TEST_ASSERT_LESS_THAN(jpeg.size() / 2, out.size());
+
+    // Recortar el recorte da lo mismo que recortar el original directamente
+    std::vector<uint8_t> twice;
+    std::vector<uint8_t> direct;
+    TEST_ASSERT_GREATER_THAN(0, cropTo(out, {32, 16, 64, 40}, twice));
+    TEST_ASSERT_GREATER_THAN(0, cropTo(jpeg, {224, 184, 64, 40}, direct));
+    TEST_ASSERT_EQUAL(direct.size(), twice.size());
+    TEST_ASSERT_EQUAL_MEMORY(direct.data(), twice.data(), direct.size());
+}
+
+void test_unsupported_input_is_rejected(void) {
+    std::vector<uint8_t> jpeg = sensorFrame(FRAMESIZE_QVGA);
+    std::vector<uint8_t> out;
+    JpegRect rect = {0, 0, 64, 64};
+
+    // Rectángulo fuera del cuadro
+    TEST_ASSERT_EQUAL(0, cropTo(jpeg, {320, 0, 16, 16}, out));
+
+    // Datos truncados a la mitad
+    std::vector<uint8_t> truncated(jpeg.begin(), jpeg.begin() + jpeg.size() / 2);
+    TEST_ASSERT_EQUAL(0, cropTo(truncated, {0, 0, 320, 240}, out));
+
+    // Progresivo: SOF0 → SOF2
+    std::vector<uint8_t> progressive = jpeg;
+    for (size_t i = 2; i + 1 < progressive.size(); i++) {
+        if (progressive[i] == 0xFF && progressive[i + 1] == 0xC0) {
+            progressive[i + 1] = 0xC2;
+            break;
+        }
+    }
+    TEST_ASSERT_EQUAL(0, cropTo(progressive, rect, out));
+
+    // Sin espacio de salida
+    JpegCropper cropper;
+    uint8_t small[64];
+    TEST_ASSERT_EQUAL(0, cropper.crop(jpeg.data(), jpeg.size(), rect, small, sizeof(small)));
+}
+
+void test_camera_roi_sends_only_the_region(void) {
+    camera_fb_t* fb = camera->capture();
+    TEST_ASSERT_NOT_NULL(fb);
+    size_t fullBytes = fb->len;
+    camera->release(fb);
+
+    // Espacio en el centro del cuadro: 40 % del ancho, 50 % del alto
+    CameraRoi roi = {310, 300, 400, 500};
+    camera->setRegionOfInterest(roi);
+    TEST_ASSERT_TRUE(camera->hasRegionOfInterest());
+    fb = camera->capture();
+    TEST_ASSERT_NOT_NULL(fb);
+    TEST_ASSERT_EQUAL(144, fb->width);      // 99..227 ampliado a MCU: 96..240
+    TEST_ASSERT_EQUAL(120, fb->height);     // 72..192
+    TEST_ASSERT_EQUAL(0xFF, fb->buf[0]);
+    TEST_ASSERT_EQUAL(0xD8, fb->buf[1]);
+    TEST_ASSERT_LESS_THAN(fullBytes, fb->len);
+    camera->release(fb);
+
+    CameraRoiStats stats = camera->getRoiStats();
+    TEST_ASSERT_EQUAL(1, stats.cropped);
+    TEST_ASSERT_EQUAL(0, stats.failed);
+    TEST_ASSERT_EQUAL(stats.lastBytes, camera->getLastFrameBytes());
+    TEST_ASSERT_LESS_THAN(stats.lastFullBytes, stats.lastBytes);
+
+    // El cuadro completo equivale a no recortar
+    camera->setRegionOfInterest({0, 0, 1000, 1000});
+    TEST_ASSERT_FALSE(camera->hasRegionOfInterest());
+}
+
+void test_roi_lets_tuner_keep_quality(void) {
+    // Enlace débil: sin recorte hay que bajar la calidad para cumplir el presupuesto
+    hal::sim::currentBoard().rssi = -85;
+    camera->setAutoTune(true);
+    for (int i = 0; i < 4; i++) {
+        camera->release(camera->capture());
+    }
+    int fullQuality = camera->getLastSettings().quality;
+
+    camera->setRegionOfInterest({300, 300, 400, 500});
+    for (int i = 0; i < 4; i++) {
+        camera->release(camera->capture());
+    }
+    TEST_ASSERT_LESS_THAN(fullQuality, camera->getLastSettings().quality);
+    TEST_ASSERT_TRUE(camera->getLastFrameBytes() <= camera->getTuner().byteBudget());
+    hal::sim::currentBoard().rssi = -55;
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_full_frame_crop_is_identity);
+    RUN_TEST(test_crop_aligns_to_mcu_and_composes);
+    RUN_TEST(test_unsupported_input_is_rejected);
+    RUN_TEST(test_camera_roi_sends_only_the_region);
+    RUN_TEST(test_roi_lets_tuner_keep_quality);
+    return UNITY_END();
+}
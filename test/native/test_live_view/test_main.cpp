@@ -0,0 +1,197 @@
+// Pruebas de la vista en vivo en el host (pio test -e native): MJPEG con
+// tope de cuadros, un solo visor, visores inactivos y prioridad del sensor.
+
+#include <unity.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string>
+
+#include "Hal.h"
+#include "CameraManager.h"
+#include "LiveView.h"
+
+#define TEST_PORT 18081
+
+static CameraManager* camera = NULL;
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(10.0);
+}
+
+void tearDown(void) {
+    hal::sim::setTimeScale(1.0);
+}
+
+static int connectViewer(const char* request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(TEST_PORT);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr*)&address, sizeof(address)));
+    if (request != NULL) {
+        send(fd, request, strlen(request), 0);
+    }
+    return fd;
+}
+
+// Lo que llegó hasta ahora, sin bloquear
+static void drain(int fd, std::string& received) {
+    char buffer[8192];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        received.append(buffer, (size_t)n);
+    }
+}
+
+static void pollFor(LiveView& view, unsigned long simulatedMs, int fd, std::string& received) {
+    unsigned long start = hal::millis();
+    while (hal::millis() - start < simulatedMs) {
+        view.poll();
+        if (fd >= 0) {
+            drain(fd, received);
+        }
+        usleep(1000);
+    }
+}
+
+static size_t countOf(const std::string& text, const char* needle) {
+    size_t count = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+void test_streams_mjpeg_at_capped_rate(void) {
+    // Cada cuadro cuesta unos ms reales de JPEG: con más escala el tope no se nota
+    hal::sim::setTimeScale(2.0);
+    LiveView view(*camera, TEST_PORT);
+    TEST_ASSERT_TRUE(view.begin());
+    view.setMaxFps(50);     // Se recorta a LIVEVIEW_MAX_FPS
+
+    int fd = connectViewer("GET /stream HTTP/1.1\r\nHost: esp32\r\n\r\n");
+    std::string received;
+    pollFor(view, 3000, fd, received);
+
+    TEST_ASSERT_TRUE(view.hasViewer());
+    TEST_ASSERT_EQUAL(0, received.find("HTTP/1.1 200 OK\r\n"));
+    TEST_ASSERT_TRUE(received.find("multipart/x-mixed-replace; boundary=" LIVEVIEW_BOUNDARY) != std::string::npos);
+
+    // Cada parte es un JPEG completo con su Content-Length
+    size_t part = received.find("--" LIVEVIEW_BOUNDARY "\r\n");
+    TEST_ASSERT_TRUE(part != std::string::npos);
+    size_t lengthAt = received.find("Content-Length: ", part);
+    size_t body = received.find("\r\n\r\n", part) + 4;
+    size_t length = strtoul(received.c_str() + lengthAt + 16, NULL, 10);
+    TEST_ASSERT_TRUE(length > 100);
+    TEST_ASSERT_EQUAL_HEX32(0xFF, (uint8_t)received[body]);
+    TEST_ASSERT_EQUAL_HEX32(0xD8, (uint8_t)received[body + 1]);
+    TEST_ASSERT_EQUAL_HEX32(0xD9, (uint8_t)received[body + length - 1]);
+
+    // 3 s simulados a 5 cuadros/s: el primero enseguida y uno cada 200 ms
+    LiveViewStats stats = view.getStats();
+    size_t parts = countOf(received, "--" LIVEVIEW_BOUNDARY "\r\n");
+    TEST_ASSERT_EQUAL(1, stats.viewers);
+    TEST_ASSERT_TRUE(stats.frames >= 12 && stats.frames <= 3 * LIVEVIEW_MAX_FPS + 1);
+    TEST_ASSERT_TRUE(parts >= stats.frames - 1 && parts <= stats.frames);
+    close(fd);
+    view.end();
+}
+
+void test_one_viewer_and_idle_viewers_are_dropped(void) {
+    LiveView view(*camera, TEST_PORT);
+    TEST_ASSERT_TRUE(view.begin());
+
+    // Conecta y no pide nada; el segundo recibe 503 mientras tanto
+    int idle = connectViewer(NULL);
+    std::string idleReceived;
+    pollFor(view, 100, -1, idleReceived);
+    int second = connectViewer("GET /stream HTTP/1.1\r\n\r\n");
+    std::string secondReceived;
+    pollFor(view, 100, second, secondReceived);
+    TEST_ASSERT_EQUAL(0, secondReceived.find("HTTP/1.1 503"));
+    TEST_ASSERT_EQUAL(1, view.getStats().rejected);
+
+    pollFor(view, LIVEVIEW_REQUEST_TIMEOUT_MS + 200, -1, idleReceived);
+    TEST_ASSERT_EQUAL(1, view.getStats().idleDrops);
+    TEST_ASSERT_EQUAL(0, recv(idle, NULL, 0, 0));   // Cerrado por el servidor
+
+    // Otra ruta: 404
+    int other = connectViewer("GET /capture HTTP/1.1\r\n\r\n");
+    std::string otherReceived;
+    pollFor(view, 100, other, otherReceived);
+    TEST_ASSERT_EQUAL(0, otherReceived.find("HTTP/1.1 404"));
+    TEST_ASSERT_EQUAL(1, view.getStats().badRequests);
+
+    // Sesión acotada: una pestaña olvidada se corta sola
+    view.setSessionLimit(1000);
+    int viewer = connectViewer("GET / HTTP/1.1\r\n\r\n");
+    std::string received;
+    pollFor(view, 1500, viewer, received);
+    TEST_ASSERT_FALSE(view.hasViewer());
+    TEST_ASSERT_EQUAL(1, view.getStats().sessionEnds);
+    TEST_ASSERT_TRUE(view.getStats().frames >= 2);
+
+    close(idle);
+    close(second);
+    close(other);
+    close(viewer);
+    view.end();
+}
+
+void test_sensor_capture_has_priority(void) {
+    LiveView view(*camera, TEST_PORT);
+    TEST_ASSERT_TRUE(view.begin());
+    int fd = connectViewer("GET /stream HTTP/1.1\r\n\r\n");
+    std::string received;
+    pollFor(view, 100, fd, received);
+    TEST_ASSERT_TRUE(view.hasViewer());
+
+    // Con el cuadro en manos de una captura del sensor la vista lo salta
+    uint32_t framesBefore = view.getStats().frames;
+    camera_fb_t* fb = camera->capture();
+    TEST_ASSERT_NOT_NULL(fb);
+    pollFor(view, 1000, fd, received);
+    TEST_ASSERT_EQUAL(framesBefore, view.getStats().frames);
+    TEST_ASSERT_TRUE(view.getStats().skipped > 0);
+    TEST_ASSERT_TRUE(camera->getLockStats().liveSkipped > 0);
+    camera->release(fb);
+
+    // En su tarea de fondo: el sensor sigue capturando mientras hay visor
+    TEST_ASSERT_TRUE(view.start());
+    uint8_t thumb[16 * 12];
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_TRUE(camera->captureGrayscale(thumb, 16, 12));
+        drain(fd, received);
+        usleep(5000);
+    }
+    view.stop();
+    CameraLockStats lockStats = camera->getLockStats();
+    TEST_ASSERT_EQUAL(0, lockStats.timeouts);
+    TEST_ASSERT_TRUE(view.getStats().frames > framesBefore);
+    TEST_ASSERT_TRUE(view.getStats().maxHoldUs > 0);
+    close(fd);
+    view.end();
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    hal::sim::setSerialEnabled(false);
+    camera = new CameraManager();
+    camera->begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_streams_mjpeg_at_capped_rate);
+    RUN_TEST(test_one_viewer_and_idle_viewers_are_dropped);
+    RUN_TEST(test_sensor_capture_has_priority);
+    int result = UNITY_END();
+    camera->end();
+    delete camera;
+    return result;
+}
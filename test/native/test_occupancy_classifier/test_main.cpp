@@ -0,0 +1,195 @@
+// Pruebas del clasificador de ocupación int8 y del veto de cambios con la
+// cámara (pio test -e native)
+//
+// Los logits de referencia los calcula train_occupancy_model.py en enteros:
+// el kernel del host tiene que dar exactamente lo mismo que el del ESP32-S3.
+// El OV2640 simulado dibuja un auto, el espacio vacío o una persona.
+
+#include <unity.h>
+#include <stdlib.h>
+
+#include "Hal.h"
+#include "HalCamera.h"
+#include "CameraManager.h"
+#include "ParkingSensor.h"
+#include "Int8Kernels.h"
+#include "OccupancyClassifier.h"
+#include "OccupancyReference.h"
+
+static CameraManager* camera = NULL;
+static OccupancyClassifier* classifier = NULL;
+
+static bool verifyWithCamera(bool occupied, float distance) {
+    (void)distance;
+    return classifier->verify(occupied, *camera) != OCCUPANCY_VETOED;
+}
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(1000.0);     // Las esperas de begin() en ms reales
+    hal::sim::setFixedDistance(150.0f);
+    hal::sim::setScene(hal::sim::SCENE_CAR);
+    camera = new CameraManager();
+    TEST_ASSERT_TRUE(camera->begin());
+    hal::sim::setTimeScale(1.0);        // El presupuesto de latencia es en tiempo real
+    classifier = new OccupancyClassifier();
+    classifier->begin();
+}
+
+void tearDown(void) {
+    camera->end();
+    delete camera;
+    delete classifier;
+    camera = NULL;
+    classifier = NULL;
+}
+
+void test_reference_logits_are_bit_exact(void) {
+    for (int pass = 0; pass < 2; pass++) {
+        setInt8SimdEnabled(pass == 1);      // Escalar y, si existe, vectorial
+        for (int i = 0; i < OCC_REFERENCE_COUNT; i++) {
+            OccupancyScore score = classifier->classify(OCC_REFERENCE_INPUTS[i]);
+            TEST_ASSERT_EQUAL_INT32(OCC_REFERENCE_LOGITS[i][0], score.logits[0]);
+            TEST_ASSERT_EQUAL_INT32(OCC_REFERENCE_LOGITS[i][1], score.logits[1]);
+        }
+    }
+
+    // El kernel activo coincide con el escalar también en los extremos
+    alignas(16) int8_t a[OCC_INPUTS];
+    alignas(16) int8_t b[OCC_INPUTS];
+    srand(7);
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < OCC_INPUTS; i++) {
+            a[i] = round == 0 ? -128 : (int8_t)(rand() & 0xFF);
+            b[i] = round == 0 ? -128 : (int8_t)(rand() & 0xFF);
+        }
+        int32_t expected = dotProductS8Scalar(a, b, OCC_INPUTS);
+        TEST_ASSERT_EQUAL_INT32(expected, dotProductS8(a, b, OCC_INPUTS));
+        if (round == 0) {
+            TEST_ASSERT_EQUAL_INT32(OCC_INPUTS * 16384, expected);
+        }
+    }
+}
+
+void test_luma_thumbnail_follows_scene(void) {
+    camera->setResolution(FRAMESIZE_QVGA);
+    camera_fb_t* fb = esp_camera_fb_get();
+    TEST_ASSERT_NOT_NULL(fb);
+    JpegCropper cropper;
+    uint8_t thumb[40 * 30];
+    uint16_t width = 0;
+    uint16_t height = 0;
+    TEST_ASSERT_EQUAL(0, cropper.lumaThumbnail(fb->buf, fb->len, thumb, 16, &width, &height));
+    TEST_ASSERT_EQUAL(40 * 30, cropper.lumaThumbnail(fb->buf, fb->len, thumb, sizeof(thumb), &width, &height));
+    esp_camera_fb_return(fb);
+    TEST_ASSERT_EQUAL(40, width);
+    TEST_ASSERT_EQUAL(30, height);
+
+    // El auto (centro) es ~60 niveles más claro que el piso de la misma fila
+    int row = 18 * width;
+    TEST_ASSERT_INT_WITHIN(8, 60, thumb[row + 20] - thumb[row + 2]);
+    TEST_ASSERT_LESS_THAN(thumb[29 * width + 2], thumb[2]);     // Gradiente del piso
+
+    // Con región de interés la miniatura cubre solo la región
+    uint8_t full[OCC_INPUTS];
+    uint8_t region[OCC_INPUTS];
+    TEST_ASSERT_TRUE(camera->captureGrayscale(full, OCC_INPUT_WIDTH, OCC_INPUT_HEIGHT));
+    camera->setRegionOfInterest({300, 350, 400, 450});     // El auto
+    TEST_ASSERT_TRUE(camera->captureGrayscale(region, OCC_INPUT_WIDTH, OCC_INPUT_HEIGHT));
+    int fullSum = 0;
+    int regionSum = 0;
+    for (int i = 0; i < OCC_INPUTS; i++) {
+        fullSum += full[i];
+        regionSum += region[i];
+    }
+    TEST_ASSERT_GREATER_THAN(fullSum / OCC_INPUTS + 30, regionSum / OCC_INPUTS);
+}
+
+void test_classifier_confirms_car_and_vetoes_person(void) {
+    camera->setRegionOfInterest({250, 200, 500, 700});
+    TEST_ASSERT_EQUAL(OCCUPANCY_CONFIRMED, classifier->verify(true, *camera));
+    TEST_ASSERT_EQUAL(OCCUPANCY_VETOED, classifier->verify(false, *camera));
+
+    classifier->setVetoHold(0);
+    hal::sim::setScene(hal::sim::SCENE_PERSON);
+    TEST_ASSERT_EQUAL(OCCUPANCY_VETOED, classifier->verify(true, *camera));
+    hal::sim::setScene(hal::sim::SCENE_EMPTY);
+    TEST_ASSERT_EQUAL(OCCUPANCY_CONFIRMED, classifier->verify(false, *camera));
+    TEST_ASSERT_EQUAL(OCCUPANCY_VETOED, classifier->verify(true, *camera));
+
+    OccupancyClassifierStats stats = classifier->getStats();
+    TEST_ASSERT_EQUAL(2, stats.confirmed);
+    TEST_ASSERT_EQUAL(3, stats.vetoed);
+    TEST_ASSERT_LESS_OR_EQUAL(classifier->getLatencyBudget(), stats.maxLatencyUs);
+    TEST_ASSERT_LESS_THAN(stats.lastLatencyUs, stats.lastInferenceUs);
+}
+
+void test_parking_sensor_drops_vetoed_arrival(void) {
+    camera->setRegionOfInterest({250, 200, 500, 700});
+    ParkingSensor sensor(35, 36, 1, "127.0.0.1", 1);
+    sensor.begin();
+    sensor.setTransitionVerifier(verifyWithCamera);
+    sensor.forceMeasurement();                  // Primera medición: sin verificar
+    TEST_ASSERT_FALSE(sensor.getIsOccupied());
+
+    // Una persona frente al sensor: lectura corta, la cámara no ve un auto
+    hal::sim::setScene(hal::sim::SCENE_PERSON);
+    hal::sim::setFixedDistance(30.0f);
+    uint32_t frames = hal::sim::framesCaptured();
+    sensor.forceMeasurement();
+    TEST_ASSERT_FALSE(sensor.getIsOccupied());
+    TEST_ASSERT_FALSE(sensor.hasStateChanged());
+    TEST_ASSERT_EQUAL(1, sensor.getVetoedTransitions());
+    TEST_ASSERT_EQUAL(frames + 1, hal::sim::framesCaptured());
+
+    // Mientras dura la espera tras el veto no se vuelve a capturar
+    sensor.forceMeasurement();
+    TEST_ASSERT_FALSE(sensor.getIsOccupied());
+    TEST_ASSERT_EQUAL(2, sensor.getVetoedTransitions());
+    TEST_ASSERT_EQUAL(frames + 1, hal::sim::framesCaptured());
+    TEST_ASSERT_EQUAL(1, classifier->getStats().held);
+
+    // Llega el auto: pasada la espera se confirma
+    classifier->setVetoHold(0);
+    hal::sim::setScene(hal::sim::SCENE_CAR);
+    sensor.forceMeasurement();
+    TEST_ASSERT_TRUE(sensor.getIsOccupied());
+    TEST_ASSERT_EQUAL(2, sensor.getVetoedTransitions());
+}
+
+void test_over_budget_fails_open(void) {
+    ParkingSensor sensor(35, 36, 1, "127.0.0.1", 1);
+    sensor.begin();
+    sensor.setTransitionVerifier(verifyWithCamera);
+    sensor.forceMeasurement();
+
+    // La captura sola ya se pasa del presupuesto: vale el ultrasonido
+    classifier->setLatencyBudget(1);
+    hal::sim::setScene(hal::sim::SCENE_PERSON);
+    hal::sim::setFixedDistance(30.0f);
+    sensor.forceMeasurement();
+    TEST_ASSERT_TRUE(sensor.getIsOccupied());
+    TEST_ASSERT_EQUAL(0, sensor.getVetoedTransitions());
+    OccupancyClassifierStats stats = classifier->getStats();
+    TEST_ASSERT_EQUAL(1, stats.overBudget);
+    TEST_ASSERT_EQUAL(0, stats.lastInferenceUs);     // Ni siquiera se clasificó
+
+    // Sin cámara tampoco se veta
+    camera->end();
+    hal::sim::setFixedDistance(150.0f);
+    sensor.forceMeasurement();
+    TEST_ASSERT_FALSE(sensor.getIsOccupied());
+    TEST_ASSERT_EQUAL(1, classifier->getStats().unsure);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_reference_logits_are_bit_exact);
+    RUN_TEST(test_luma_thumbnail_follows_scene);
+    RUN_TEST(test_classifier_confirms_car_and_vetoes_person);
+    RUN_TEST(test_parking_sensor_drops_vetoed_arrival);
+    RUN_TEST(test_over_budget_fails_open);
+    return UNITY_END();
+}
@@ -0,0 +1,409 @@
+// Pruebas de la actualización OTA en el host (pio test -e native): parches
+// delta generados por ota_delta.py, descarga reanudable y la ida y vuelta
+// completa con un ParkingSensor real y un servidor de prueba que sirve OTAD.
+
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "Hal.h"
+#include "HalOta.h"
+#include "DeltaPatch.h"
+#include "OtaUpdater.h"
+#include "ParkingSensor.h"
+#include "TestServer.h"
+
+// Imagen anterior: 2048 bytes pseudoaleatorios (LCG)
+static std::vector<uint8_t> oldImage() {
+    std::vector<uint8_t> image;
+    uint32_t x = 1;
+    for (int i = 0; i < 2048; i++) {
+        x = x * 1103515245u + 12345u;
+        image.push_back((uint8_t)(x >> 16));
+    }
+    return image;
+}
+
+// Imagen nueva: 17 bytes insertados, un tramo con un byte de cada 64
+// cambiado (+3) y 100 bytes eliminados
+static std::vector<uint8_t> newImage() {
+    std::vector<uint8_t> old = oldImage();
+    std::vector<uint8_t> image(old.begin(), old.begin() + 600);
+    const char* text = "NUEVO-FIRMWARE-v2";
+    image.insert(image.end(), text, text + strlen(text));
+    for (int k = 600; k < 1500; k++) {
+        image.push_back((uint8_t)(old[k] + ((k - 600) % 64 == 0 ? 3 : 0)));
+    }
+    image.insert(image.end(), old.begin() + 1600, old.end());
+    return image;
+}
+
+// python ota_delta.py make anterior.bin nueva.bin (las imágenes de arriba)
+static const uint8_t PYTHON_PATCH[] = {
+    0x50, 0x4b, 0x44, 0x4c, 0x01, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0xec, 0xf4, 0x63, 0x44,
+    0xad, 0x07, 0x00, 0x00, 0x07, 0x42, 0x06, 0x72, 0x41, 0x00, 0xd8, 0x04, 0xd8, 0x04, 0x49, 0x12,
+    0x4e, 0x55, 0x45, 0x56, 0x4f, 0x2d, 0x46, 0x49, 0x52, 0x4d, 0x57, 0x41, 0x52, 0x45, 0x2d, 0x76,
+    0x32, 0xa3, 0x41, 0x02, 0x83, 0x07, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f,
+    0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01,
+    0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03, 0x3f, 0x01, 0x03,
+    0x03, 0x41, 0xc8, 0x01, 0xc0, 0x03, 0xc0, 0x03,
+};
+
+static std::vector<uint8_t> pythonPatch() {
+    return std::vector<uint8_t>(PYTHON_PATCH, PYTHON_PATCH + sizeof(PYTHON_PATCH));
+}
+
+static void putLe32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+// Parche de imagen completa: cabecera sin imagen base y un único 'I'
+static std::vector<uint8_t> fullImagePatch(const std::vector<uint8_t>& image) {
+    std::vector<uint8_t> patch = {'P', 'K', 'D', 'L', DELTA_VERSION, 0, 0, 0};
+    putLe32(patch, 0);
+    putLe32(patch, 0);
+    putLe32(patch, (uint32_t)image.size());
+    putLe32(patch, crc32Update(0, image.data(), image.size()));
+    patch.push_back('I');
+    for (uint32_t value = (uint32_t)image.size(); ; value >>= 7) {
+        if (value < 0x80) { patch.push_back((uint8_t)value); break; }
+        patch.push_back((uint8_t)((value & 0x7F) | 0x80));
+    }
+    patch.insert(patch.end(), image.begin(), image.end());
+    return patch;
+}
+
+// ---- DeltaPatcher sobre buffers ----
+
+struct Target {
+    const std::vector<uint8_t>* old;
+    std::vector<uint8_t> out;
+};
+
+static bool readOld(void* context, uint32_t offset, uint8_t* buffer, size_t size) {
+    Target* target = (Target*)context;
+    if (offset + size > target->old->size()) return false;
+    memcpy(buffer, target->old->data() + offset, size);
+    return true;
+}
+
+static bool writeNew(void* context, const uint8_t* data, size_t size) {
+    Target* target = (Target*)context;
+    target->out.insert(target->out.end(), data, data + size);
+    return true;
+}
+
+static DeltaPatcher patcher;
+
+static bool applyInChunks(const std::vector<uint8_t>& old, const std::vector<uint8_t>& patch,
+                          size_t chunk, Target& target) {
+    target.old = &old;
+    target.out.clear();
+    DeltaIo io = {readOld, writeNew, &target};
+    patcher.begin(io);
+    for (size_t i = 0; i < patch.size(); i += chunk) {
+        size_t n = patch.size() - i < chunk ? patch.size() - i : chunk;
+        if (!patcher.feed(patch.data() + i, n)) {
+            return false;
+        }
+    }
+    return patcher.isDone();
+}
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+}
+
+void tearDown(void) {}
+
+void test_crc32_matches_zlib(void) {
+    const uint8_t text[] = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32Update(0, text, 9));
+    // Por partes da lo mismo
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32Update(crc32Update(0, text, 4), text + 4, 5));
+}
+
+void test_python_patch_in_any_chunk_size(void) {
+    std::vector<uint8_t> old = oldImage();
+    std::vector<uint8_t> expected = newImage();
+    std::vector<uint8_t> patch = pythonPatch();
+    const size_t chunks[] = {1, 5, 64, patch.size()};
+    for (size_t chunk : chunks) {
+        Target target;
+        TEST_ASSERT_TRUE(applyInChunks(old, patch, chunk, target));
+        TEST_ASSERT_EQUAL(expected.size(), target.out.size());
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), target.out.data(), expected.size());
+        TEST_ASSERT_EQUAL_UINT32(patch.size(), patcher.getPatchBytes());
+    }
+}
+
+void test_rejects_wrong_base_image(void) {
+    std::vector<uint8_t> old = oldImage();
+    old[1000] ^= 0x01;
+    Target target;
+    TEST_ASSERT_FALSE(applyInChunks(old, pythonPatch(), 16, target));
+    TEST_ASSERT_EQUAL(DELTA_BAD_SOURCE, patcher.getError());
+    TEST_ASSERT_EQUAL(0, target.out.size());        // Nada escrito en la partición
+}
+
+void test_detects_corrupted_truncated_and_oversized_patches(void) {
+    std::vector<uint8_t> old = oldImage();
+    Target target;
+
+    std::vector<uint8_t> corrupted = pythonPatch();
+    corrupted[35] ^= 0x20;                          // Un byte literal del 'I'
+    TEST_ASSERT_FALSE(applyInChunks(old, corrupted, 7, target));
+    TEST_ASSERT_EQUAL(DELTA_BAD_OUTPUT, patcher.getError());
+
+    std::vector<uint8_t> truncated = pythonPatch();
+    truncated.resize(truncated.size() - 3);
+    TEST_ASSERT_FALSE(applyInChunks(old, truncated, 7, target));
+    TEST_ASSERT_FALSE(patcher.hasFailed());         // Esperando más bytes
+
+    std::vector<uint8_t> extra = pythonPatch();
+    extra.push_back('I');
+    TEST_ASSERT_FALSE(applyInChunks(old, extra, 7, target));
+    TEST_ASSERT_EQUAL(DELTA_BAD_PATCH, patcher.getError());
+
+    std::vector<uint8_t> badMagic = pythonPatch();
+    badMagic[0] = 'X';
+    TEST_ASSERT_FALSE(applyInChunks(old, badMagic, 7, target));
+    TEST_ASSERT_EQUAL(DELTA_BAD_HEADER, patcher.getError());
+}
+
+void test_full_image_needs_no_base(void) {
+    std::vector<uint8_t> image = newImage();
+    std::vector<uint8_t> none;
+    Target target;
+    TEST_ASSERT_TRUE(applyInChunks(none, fullImagePatch(image), 100, target));
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), target.out.data(), image.size());
+}
+
+// ---- OtaUpdater con la partición simulada ----
+
+static uint8_t partition[16384];
+
+void test_updater_window_resume_and_duplicates(void) {
+    std::vector<uint8_t> old = oldImage();
+    std::vector<uint8_t> image(5000);
+    for (size_t i = 0; i < image.size(); i++) image[i] = (uint8_t)(i * 7);
+    std::vector<uint8_t> patch = fullImagePatch(image);
+    hal::sim::setRunningImage(old.data(), old.size(), "0011223344556677");
+    hal::sim::setOtaPartition(partition, sizeof(partition));
+
+    OtaUpdater updater;
+    TEST_ASSERT_TRUE(updater.offer("full-a1b2", (uint32_t)patch.size(), 0));
+
+    // Ventana de OTA_WINDOW pedidos
+    uint32_t offset, length;
+    for (uint32_t i = 0; i < OTA_WINDOW; i++) {
+        TEST_ASSERT_TRUE(updater.nextRequest(offset, length, 0));
+        TEST_ASSERT_EQUAL_UINT32(i * OTA_CHUNK_SIZE, offset);
+    }
+    TEST_ASSERT_FALSE(updater.nextRequest(offset, length, 0));
+
+    // Llegan los dos primeros trozos y se corta la conexión
+    for (uint32_t i = 0; i < 2; i++) {
+        TEST_ASSERT_TRUE(updater.acceptChunk("full-a1b2", i * OTA_CHUNK_SIZE, OTA_CHUNK_SIZE));
+        updater.feedChunk(patch.data() + i * OTA_CHUNK_SIZE, OTA_CHUNK_SIZE, 10);
+    }
+    updater.rewind(20);
+    TEST_ASSERT_TRUE(updater.nextRequest(offset, length, 20));
+    TEST_ASSERT_EQUAL_UINT32(2 * OTA_CHUNK_SIZE, offset);
+
+    // Un trozo repetido o de otro parche no se aplica
+    TEST_ASSERT_FALSE(updater.acceptChunk("full-a1b2", OTA_CHUNK_SIZE, OTA_CHUNK_SIZE));
+    TEST_ASSERT_FALSE(updater.acceptChunk("full-ffff", 2 * OTA_CHUNK_SIZE, OTA_CHUNK_SIZE));
+
+    // La misma oferta después de reconectar continúa; el timeout vuelve a pedir
+    TEST_ASSERT_TRUE(updater.offer("full-a1b2", (uint32_t)patch.size(), 30));
+    TEST_ASSERT_EQUAL_UINT32(1, updater.getStats().resumes);
+    TEST_ASSERT_EQUAL_UINT32(2 * OTA_CHUNK_SIZE, updater.getReceived());
+    TEST_ASSERT_TRUE(updater.nextRequest(offset, length, 30));
+    TEST_ASSERT_TRUE(updater.nextRequest(offset, length, 30 + OTA_REQUEST_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL_UINT32(2 * OTA_CHUNK_SIZE, offset);
+    TEST_ASSERT_EQUAL_UINT32(1, updater.getStats().retries);
+
+    for (uint32_t at = updater.getReceived(); at < patch.size(); at += OTA_CHUNK_SIZE) {
+        uint32_t n = (uint32_t)patch.size() - at < OTA_CHUNK_SIZE ? (uint32_t)patch.size() - at : OTA_CHUNK_SIZE;
+        TEST_ASSERT_TRUE(updater.acceptChunk("full-a1b2", at, n));
+        updater.feedChunk(patch.data() + at, n, 40);
+    }
+    TEST_ASSERT_EQUAL(OTA_DONE, updater.getState());
+    TEST_ASSERT_TRUE(hal::sim::currentBoard().otaCompleted);
+    TEST_ASSERT_EQUAL(image.size(), hal::sim::currentBoard().otaWritten);
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), partition, image.size());
+}
+
+void test_updater_reports_wrong_base(void) {
+    std::vector<uint8_t> old = oldImage();
+    old[0] ^= 0xFF;                                  // No es la imagen de la que partió el parche
+    hal::sim::setRunningImage(old.data(), old.size(), "0011223344556677");
+    hal::sim::setOtaPartition(partition, sizeof(partition));
+    std::vector<uint8_t> patch = pythonPatch();
+
+    OtaUpdater updater;
+    TEST_ASSERT_TRUE(updater.offer("aa-bb", (uint32_t)patch.size(), 0));
+    TEST_ASSERT_TRUE(updater.acceptChunk("aa-bb", 0, (uint32_t)patch.size()));
+    TEST_ASSERT_FALSE(updater.feedChunk(patch.data(), patch.size(), 0));
+    TEST_ASSERT_EQUAL(OTA_FAILED, updater.getState());
+    TEST_ASSERT_EQUAL_STRING("bad_source", updater.getFailure());
+    TEST_ASSERT_FALSE(hal::sim::currentBoard().otaCompleted);
+
+    // Sin partición inactiva la oferta se rechaza
+    hal::sim::setOtaPartition(NULL, 0);
+    TEST_ASSERT_FALSE(updater.offer("cc-dd", 100, 0));
+}
+
+// ---- Ida y vuelta con el ParkingSensor real ----
+
+static long jsonNumber(const std::string& line, const char* key) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t at = line.find(pattern);
+    return at == std::string::npos ? -1 : atol(line.c_str() + at + pattern.size());
+}
+
+// Responde un {"ota":"get",...} como parking_server.py
+static void serveChunk(TestServer& server, const std::string& request, const std::vector<uint8_t>& patch) {
+    long offset = jsonNumber(request, "offset");
+    long length = jsonNumber(request, "length");
+    char header[96];
+    snprintf(header, sizeof(header), "OTAD %ld %ld full-e2e\n", offset, length);
+    sendFrame(server, header);
+    send(server.client, patch.data() + offset, (size_t)length, 0);
+}
+
+void test_download_survives_reconnect_with_native_sensor(void) {
+    hal::sim::setTimeScale(1000.0);     // 5 s de reconexión en 5 ms reales
+    std::vector<uint8_t> old = oldImage();
+    std::vector<uint8_t> image(6000);
+    for (size_t i = 0; i < image.size(); i++) image[i] = (uint8_t)(i * 13 + 1);
+    std::vector<uint8_t> patch = fullImagePatch(image);
+    hal::sim::setRunningImage(old.data(), old.size(), "0011223344556677");
+    hal::sim::setOtaPartition(partition, sizeof(partition));
+    hal::sim::currentBoard().restartRequested = false;
+
+    TestServer server;
+    startServer(server);
+    ParkingSensor sensor(35, 36, 9, "127.0.0.1", server.port);
+    OtaUpdater updater;
+    sensor.begin();
+    sensor.setOtaUpdater(&updater);
+
+    std::string line;
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"hello\":true,\"parkingId\":9,\"fw\":\"0011223344556677\"}", line.c_str());
+
+    char offer[64];
+    snprintf(offer, sizeof(offer), "OTA 5 id=full-e2e size=%u\n", (unsigned)patch.size());
+    sendFrame(server, offer);
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":5,\"parkingId\":9,\"status\":\"ok\"}", line.c_str());
+
+    // Dos trozos servidos y se corta la conexión con pedidos en vuelo
+    for (int served = 0; served < 2; ) {
+        TEST_ASSERT_TRUE(readLine(server, sensor, line));
+        if (line.find("\"ota\":\"get\"") != std::string::npos) {
+            serveChunk(server, line, patch);
+            served++;
+        }
+    }
+    for (int i = 0; i < 50 && updater.getReceived() < 2 * OTA_CHUNK_SIZE; i++) {
+        sensor.update();
+        usleep(1000);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2 * OTA_CHUNK_SIZE, updater.getReceived());
+    dropClient(server);
+
+    // Al reconectar pide desde lo aplicado, sin nueva oferta del servidor
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"hello\":true"));
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(2 * OTA_CHUNK_SIZE, jsonNumber(line, "offset"));
+
+    while (true) {
+        if (line.find("\"ota\":\"get\"") != std::string::npos) {
+            serveChunk(server, line, patch);
+        } else {
+            break;
+        }
+        TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    }
+    TEST_ASSERT_EQUAL_STRING("{\"ota\":\"done\",\"parkingId\":9,\"id\":\"full-e2e\"}", line.c_str());
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), partition, image.size());
+    TEST_ASSERT_TRUE(hal::sim::currentBoard().otaCompleted);
+
+    // Reinicia después de avisar
+    for (int i = 0; i < 100 && !hal::sim::currentBoard().restartRequested; i++) {
+        sensor.update();
+        usleep(1000);
+    }
+    TEST_ASSERT_TRUE(hal::sim::currentBoard().restartRequested);
+
+    stopServer(server);
+}
+
+void test_rejected_chunk_reports_error_at_once(void) {
+    std::vector<uint8_t> image(6000);
+    for (size_t i = 0; i < image.size(); i++) image[i] = (uint8_t)(i * 7 + 3);
+    std::vector<uint8_t> patch = fullImagePatch(image);
+    std::vector<uint8_t> corrupted = patch;
+    corrupted[0] ^= 0xFF;                            // Cabecera inválida: falla el primer trozo
+    std::vector<uint8_t> old = oldImage();
+    hal::sim::setRunningImage(old.data(), old.size(), "0011223344556677");
+    hal::sim::setOtaPartition(partition, sizeof(partition));
+
+    TestServer server;
+    startServer(server);
+    ParkingSensor sensor(35, 36, 9, "127.0.0.1", server.port);
+    OtaUpdater updater;
+    sensor.begin();
+    sensor.setOtaUpdater(&updater);
+
+    std::string line;
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    char offer[64];
+    snprintf(offer, sizeof(offer), "OTA 6 id=full-e2e size=%u\n", (unsigned)corrupted.size());
+    sendFrame(server, offer);
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":6,\"parkingId\":9,\"status\":\"ok\"}", line.c_str());
+
+    // Se sirve solo el primer pedido: el error llega sin que se sirvan los
+    // demás (los pedidos repetidos por timeout se ignoran)
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, jsonNumber(line, "offset"));
+    serveChunk(server, line, corrupted);
+    do {
+        TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    } while (line.find("\"ota\":\"get\"") != std::string::npos);
+    TEST_ASSERT_EQUAL_STRING("{\"ota\":\"error\",\"parkingId\":9,\"id\":\"full-e2e\",\"error\":\"bad_header\"}",
+                             line.c_str());
+    TEST_ASSERT_EQUAL(OTA_FAILED, updater.getState());
+
+    // El resto del trozo se descartó sin romper el framing: una oferta nueva
+    // se acepta y empieza otra descarga
+    snprintf(offer, sizeof(offer), "OTA 7 id=full-ok size=%u\n", (unsigned)patch.size());
+    sendFrame(server, offer);
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL_STRING("{\"ack\":7,\"parkingId\":9,\"status\":\"ok\"}", line.c_str());
+    TEST_ASSERT_EQUAL(OTA_DOWNLOADING, updater.getState());
+
+    stopServer(server);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_matches_zlib);
+    RUN_TEST(test_python_patch_in_any_chunk_size);
+    RUN_TEST(test_rejects_wrong_base_image);
+    RUN_TEST(test_detects_corrupted_truncated_and_oversized_patches);
+    RUN_TEST(test_full_image_needs_no_base);
+    RUN_TEST(test_updater_window_resume_and_duplicates);
+    RUN_TEST(test_updater_reports_wrong_base);
+    RUN_TEST(test_download_survives_reconnect_with_native_sensor);
+    RUN_TEST(test_rejected_chunk_reports_error_at_once);
+    return UNITY_END();
+}
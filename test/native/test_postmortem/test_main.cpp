@@ -0,0 +1,216 @@
+// Pruebas del registro postmortem en el host (pio test -e native): el anillo
+// se reinicia "en caliente" volviendo a llamar a begin() sobre la misma
+// memoria, como hace el ESP32 con la RAM RTC.
+
+#include <unity.h>
+#include <string.h>
+#include <string>
+
+#include "Hal.h"
+#include "Postmortem.h"
+#include "ParkingSensor.h"
+#include "TestServer.h"
+
+static PostmortemRing ring;
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    memset(&ring, 0xA5, sizeof(ring));      // Basura, como la RAM RTC al encender
+}
+
+void tearDown(void) {}
+
+static bool contains(const String& text, const char* part) {
+    return strstr(text.c_str(), part) != NULL;
+}
+
+void test_warm_reset_recovers_previous_boot(void) {
+    Postmortem first(ring);
+    TEST_ASSERT_FALSE(first.begin(hal::RESET_POWERON, 0));
+    TEST_ASSERT_FALSE(first.hasReport());
+    TEST_ASSERT_EQUAL_UINT32(1, first.getBootCount());
+    first.record(PM_TCP_UP, 1, 900);
+    first.sample(1000, 40, 180000);
+    first.sample(2000, 1500, 150000);      // Vuelta lenta: también es evento
+    first.sample(3000, 60, 170000);
+    first.record(PM_ARRIVAL, 253, 3500);
+    first.record(PM_RESTART, PM_RESTART_WIFI, 524828);
+
+    Postmortem second(ring);
+    TEST_ASSERT_TRUE(second.begin(hal::RESET_SOFTWARE, 10));
+    TEST_ASSERT_TRUE(second.hasReport());
+    TEST_ASSERT_EQUAL_UINT32(2, second.getBootCount());
+    TEST_ASSERT_EQUAL_UINT32(524828, second.getPrevious().uptimeMs);
+    TEST_ASSERT_EQUAL_UINT32(150000, second.getPrevious().minFreeHeap);
+    TEST_ASSERT_EQUAL(1500, second.getPrevious().maxLoopMs);
+
+    String report = second.buildReport(4);
+    TEST_ASSERT_TRUE(contains(report, "{\"postmortem\":true,\"parkingId\":4,\"boot\":2,\"reset\":\"software\",\"boots\":1,\"seq\":7,"));
+    TEST_ASSERT_TRUE(contains(report, "\"previous\":{\"reset\":\"poweron\",\"uptime\":524828,\"heapMin\":150000,"
+                                      "\"loops\":3,\"loopMax\":1500,\"slowLoops\":1,\"loopMs\":[40,1500,60]}"));
+    TEST_ASSERT_TRUE(contains(report, "\"events\":[[1,1,0,\"boot\",1],[2,1,900,\"tcp_up\",1],"
+                                      "[3,1,2000,\"slow_loop\",1500],[4,1,3500,\"arrival\",253],"
+                                      "[5,1,524828,\"restart\",1],[6,2,10,\"boot\",3]]"));
+    TEST_ASSERT_TRUE(contains(report, "\"lost\":0,\"dropped\":0,\"salvaged\":false}"));
+
+    // Solo la confirmación del último informe lo da por entregado
+    TEST_ASSERT_FALSE(second.acknowledge(5));
+    TEST_ASSERT_TRUE(second.hasReport());
+    TEST_ASSERT_TRUE(second.acknowledge(7));
+    TEST_ASSERT_FALSE(second.hasReport());
+
+    // El informe siguiente trae solo lo nuevo
+    second.record(PM_TCP_LOST, 0, 20);
+    Postmortem third(ring);
+    TEST_ASSERT_TRUE(third.begin(hal::RESET_WATCHDOG, 5));
+    report = third.buildReport(4);
+    TEST_ASSERT_TRUE(contains(report, "\"reset\":\"watchdog\""));
+    TEST_ASSERT_TRUE(contains(report, "\"events\":[[7,2,20,\"tcp_lost\",0],[8,3,5,\"boot\",5]]"));
+}
+
+void test_power_on_and_other_firmware_start_cold(void) {
+    Postmortem first(ring);
+    first.begin(hal::RESET_POWERON, 0);
+    first.record(PM_TCP_UP, 1, 100);
+
+    // Tras un corte de energía el contenido no vale aunque valide
+    Postmortem second(ring);
+    TEST_ASSERT_FALSE(second.begin(hal::RESET_POWERON, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, second.getBootCount());
+    TEST_ASSERT_FALSE(second.hasReport());
+
+    // Otro formato (firmware distinto): tampoco
+    ring.size--;
+    Postmortem third(ring);
+    TEST_ASSERT_FALSE(third.begin(hal::RESET_SOFTWARE, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, third.getBootCount());
+
+    // Basura con causa de reinicio en caliente
+    memset(&ring, 0x5A, sizeof(ring));
+    Postmortem fourth(ring);
+    TEST_ASSERT_FALSE(fourth.begin(hal::RESET_PANIC, 0));
+    TEST_ASSERT_FALSE(fourth.hasReport());
+}
+
+void test_damaged_events_and_header_are_recovered(void) {
+    Postmortem first(ring);
+    first.begin(hal::RESET_POWERON, 0);
+    for (int i = 0; i < 5; i++) {
+        first.record(PM_ARRIVAL, 100 + i, 1000 * (i + 1));
+    }
+
+    // Un evento dañado se descarta y se cuenta
+    ring.events[3].value ^= 0x40;
+    Postmortem second(ring);
+    TEST_ASSERT_TRUE(second.begin(hal::RESET_BROWNOUT, 0));
+    TEST_ASSERT_EQUAL(1, second.getDroppedEvents());
+    String report = second.buildReport(1);
+    TEST_ASSERT_FALSE(contains(report, "[3,"));
+    TEST_ASSERT_TRUE(contains(report, "\"dropped\":1"));
+    TEST_ASSERT_TRUE(second.acknowledge(8));
+
+    // Reinicio a mitad de escribir la cabecera: se rescatan los eventos
+    second.record(PM_DEPARTURE, 900, 40);
+    ring.current.uptimeMs++;
+    Postmortem third(ring);
+    TEST_ASSERT_TRUE(third.begin(hal::RESET_WATCHDOG, 0));
+    TEST_ASSERT_TRUE(third.wasSalvaged());
+    report = third.buildReport(1);
+    TEST_ASSERT_TRUE(contains(report, "\"salvaged\":true"));
+    TEST_ASSERT_FALSE(contains(report, "\"previous\""));
+    TEST_ASSERT_TRUE(contains(report, "[8,2,40,\"departure\",900],[9,3,0,\"boot\",5]]"));
+}
+
+void test_repeated_resets_accumulate_until_delivered(void) {
+    Postmortem first(ring);
+    first.begin(hal::RESET_POWERON, 0);
+    first.record(PM_WIFI_LOST, 0, 100);
+    first.record(PM_RESTART, PM_RESTART_WIFI, 25000);
+
+    // Sin Wi-Fi reinicia una y otra vez sin poder entregar nada
+    for (int boot = 2; boot <= 13; boot++) {
+        Postmortem recorder(ring);
+        TEST_ASSERT_TRUE(recorder.begin(hal::RESET_SOFTWARE, 0));
+        if (boot < 13) {
+            recorder.record(PM_WIFI_LOST, 0, 100);
+            recorder.record(PM_RESTART, PM_RESTART_WIFI, 25000);
+            continue;
+        }
+
+        // 37 eventos sin entregar en un anillo de 32: los 5 más viejos se pierden
+        TEST_ASSERT_EQUAL(12, recorder.getPendingBoots());
+        String report = recorder.buildReport(2);
+        TEST_ASSERT_TRUE(contains(report, "\"boot\":13,\"reset\":\"software\",\"boots\":12,\"seq\":38,"));
+        TEST_ASSERT_TRUE(contains(report, "\"events\":[[6,2,25000,\"restart\",1],[7,3,0,\"boot\",3],"));
+        TEST_ASSERT_TRUE(contains(report, "\"lost\":5"));
+    }
+}
+
+// ---- Ida y vuelta con el ParkingSensor real ----
+
+void test_report_is_sent_on_connect_until_acknowledged(void) {
+    hal::sim::setTimeScale(1000.0);     // 5 s de reconexión en 5 ms reales
+    hal::sim::setFixedDistance(30.0f);
+
+    // Arranque anterior que terminó en un reinicio por watchdog
+    Postmortem before(ring);
+    before.begin(hal::RESET_POWERON, 0);
+    before.record(PM_TCP_LOST, 0, 61000);
+    hal::sim::setResetReason(hal::RESET_WATCHDOG);
+    Postmortem recorder(ring);
+    TEST_ASSERT_TRUE(recorder.begin(hal::resetReason(), hal::millis()));
+
+    TestServer server;
+    startServer(server);
+    ParkingSensor sensor(35, 36, 6, "127.0.0.1", server.port);
+    sensor.begin();
+    sensor.setHeartbeatInterval(60000);    // Reenvía el estado tras cada hello
+    sensor.setPostmortem(&recorder);
+
+    std::string line;
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"hello\":true,\"parkingId\":6"));
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"postmortem\":true,\"parkingId\":6,\"boot\":2,\"reset\":\"watchdog\""));
+    TEST_ASSERT_TRUE(line.find("[2,1,61000,\"tcp_lost\",0]") != std::string::npos);
+    size_t at = line.find("\"seq\":");
+    long seq = atol(line.c_str() + at + 6);
+
+    // Sin confirmación se vuelve a enviar en la conexión siguiente
+    dropClient(server);
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"hello\":true"));
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"postmortem\":true"));
+    seq = atol(line.c_str() + line.find("\"seq\":") + 6);
+    char ack[32];
+    snprintf(ack, sizeof(ack), "PMK %ld\n", seq);
+    sendFrame(server, ack);
+    for (int i = 0; i < 100 && recorder.hasReport(); i++) {
+        sensor.update();
+        usleep(1000);
+    }
+    TEST_ASSERT_FALSE(recorder.hasReport());
+
+    // Confirmado: al reconectar el hello va seguido directamente del estado
+    dropClient(server);
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"hello\":true"));
+    TEST_ASSERT_TRUE(readLine(server, sensor, line));
+    TEST_ASSERT_EQUAL(0, line.find("{\"parkingId\":6,\"occupied\":true"));
+
+    stopServer(server);
+    hal::sim::setResetReason(hal::RESET_POWERON);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_warm_reset_recovers_previous_boot);
+    RUN_TEST(test_power_on_and_other_firmware_start_cold);
+    RUN_TEST(test_damaged_events_and_header_are_recovered);
+    RUN_TEST(test_repeated_resets_accumulate_until_delivered);
+    RUN_TEST(test_report_is_sent_on_connect_until_acknowledged);
+    return UNITY_END();
+}
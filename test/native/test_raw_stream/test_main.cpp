@@ -0,0 +1,245 @@
+// Pruebas de la serie cruda en el host (pio test -e native): ida y vuelta
+// del bloque, cierre por tamaño y por plazo, y los bloques "RAW" que envía
+// el ParkingSensor real.
+
+#include <unity.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string>
+
+#include "Hal.h"
+#include "Base64.h"
+#include "RawStream.h"
+#include "ParkingSensor.h"
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+}
+
+void tearDown(void) {
+    hal::sim::setTimeScale(1.0);
+    hal::sim::currentBoard().distanceSource = NULL;
+}
+
+void test_block_round_trip(void) {
+    RawStream stream;
+    stream.setFlushInterval(60000);
+
+    // Intervalo con jitter, ruido de pocos mm, un salto, fallidas y millis() dando la vuelta
+    uint32_t ms = 0xFFFFF000UL;
+    float distances[40];
+    uint32_t times[40];
+    for (int i = 0; i < 40; i++) {
+        ms += 1000 + (i % 3) - 1;
+        times[i] = ms;
+        distances[i] = i == 7 || i == 8 ? -1.0f : (i < 20 ? 182.3f + (i % 4) * 0.3f : 35.0f - (i % 2) * 0.2f);
+        TEST_ASSERT_TRUE(stream.add(ms, distances[i]));
+    }
+    TEST_ASSERT_EQUAL(40, stream.getCount());
+
+    uint8_t block[RAW_BLOCK_BYTES];
+    size_t length = stream.build(block);
+    TEST_ASSERT_EQUAL(0, stream.getCount());
+    TEST_ASSERT_EQUAL(1, stream.getBlockSeq());
+    // Cabecera más ~2 bytes por medición
+    TEST_ASSERT_TRUE(length <= RAW_HEADER_SIZE + 40 * 2 + 8);
+
+    uint16_t seq;
+    uint32_t decodedMs[RAW_MAX_READINGS];
+    uint16_t decodedMm[RAW_MAX_READINGS];
+    TEST_ASSERT_EQUAL(40, decodeRawBlock(block, length, seq, decodedMs, decodedMm));
+    TEST_ASSERT_EQUAL(0, seq);
+    for (int i = 0; i < 40; i++) {
+        TEST_ASSERT_EQUAL_UINT32(times[i], decodedMs[i]);
+        uint16_t expected = distances[i] < 0 ? 0 : (uint16_t)(distances[i] * 10.0f + 0.5f);
+        TEST_ASSERT_EQUAL(expected, decodedMm[i]);
+    }
+
+    // Cortado o con basura al final: inválido
+    TEST_ASSERT_EQUAL(-1, decodeRawBlock(block, length - 1, seq, decodedMs, decodedMm));
+    block[0] = RAW_VERSION + 1;
+    TEST_ASSERT_EQUAL(-1, decodeRawBlock(block, length, seq, decodedMs, decodedMm));
+}
+
+void test_block_is_due_when_full_or_late(void) {
+    RawStream stream;
+    TEST_ASSERT_TRUE(stream.add(0, 100.0f));    // Apagado: no guarda nada
+    TEST_ASSERT_EQUAL(0, stream.getCount());
+
+    stream.setFlushInterval(30000);
+    stream.add(1000, 100.0f);
+    TEST_ASSERT_FALSE(stream.isDue(30999));
+    TEST_ASSERT_TRUE(stream.isDue(31000));
+
+    // Mediciones que no comprimen (saltos grandes): se llena antes del plazo
+    char line[RAW_LINE_BYTES];
+    TEST_ASSERT_TRUE(stream.buildLine(line) > 4);
+    uint32_t ms = 2000;
+    int added = 0;
+    while (stream.add(ms, added % 2 ? 20.0f : 390.0f)) {
+        ms += 1000 + (added % 2) * 5000;
+        added++;
+    }
+    TEST_ASSERT_TRUE(stream.isDue(ms));
+    TEST_ASSERT_TRUE(added > 20 && added < RAW_MAX_READINGS);
+
+    size_t n = stream.buildLine(line);
+    TEST_ASSERT_EQUAL(n, strlen(line));
+    TEST_ASSERT_EQUAL(0, strncmp(line, "RAW ", 4));
+    TEST_ASSERT_EQUAL(0, strcmp(line + n - 2, "\r\n"));
+    TEST_ASSERT_TRUE(n < RAW_LINE_BYTES);
+    TEST_ASSERT_EQUAL(2, stream.getBlockSeq());
+
+    // Apagar descarta lo pendiente y adelanta el número de bloque
+    stream.add(ms, 50.0f);
+    stream.setFlushInterval(0);
+    TEST_ASSERT_EQUAL(0, stream.getCount());
+    TEST_ASSERT_EQUAL(3, stream.getBlockSeq());
+}
+
+// ---- ParkingSensor real contra un servidor local ----
+
+static float wobble(void* context, unsigned long nowMs) {
+    (void)context;
+    if (nowMs / 1000 % 10 == 9) {
+        return -1.0f;                           // Un timeout cada 10 mediciones
+    }
+    return 120.0f + (float)(nowMs / 1000 % 3) * 0.3f;
+}
+
+static int base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    return c == '+' ? 62 : (c == '/' ? 63 : -1);
+}
+
+static size_t base64Decode(const std::string& text, uint8_t* out) {
+    size_t n = 0;
+    uint32_t bits = 0;
+    int count = 0;
+    for (size_t i = 0; i < text.size() && text[i] != '='; i++) {
+        bits = bits << 6 | (uint32_t)base64Value(text[i]);
+        if (++count == 4) {
+            out[n++] = (uint8_t)(bits >> 16);
+            out[n++] = (uint8_t)(bits >> 8);
+            out[n++] = (uint8_t)bits;
+            bits = 0;
+            count = 0;
+        }
+    }
+    if (count == 3) {
+        out[n++] = (uint8_t)(bits >> 10);
+        out[n++] = (uint8_t)(bits >> 2);
+    } else if (count == 2) {
+        out[n++] = (uint8_t)(bits >> 4);
+    }
+    return n;
+}
+
+void test_sensor_sends_raw_blocks(void) {
+    hal::sim::setTimeScale(50.0);
+    hal::sim::currentBoard().distanceSource = wobble;
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, (struct sockaddr*)&address, sizeof(address));
+    listen(listener, 1);
+    socklen_t addressLength = sizeof(address);
+    getsockname(listener, (struct sockaddr*)&address, &addressLength);
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+
+    ParkingSensor sensor(35, 36, 4, "127.0.0.1", ntohs(address.sin_port));
+    sensor.begin();
+    sensor.setRawStream(20000);
+
+    // 60 s simulados: tres bloques por plazo de ~20 mediciones cada uno
+    int client = -1;
+    std::string received;
+    unsigned long start = hal::millis();
+    while (hal::millis() - start < 61000) {
+        sensor.update();
+        if (client < 0) {
+            client = accept(listener, NULL, NULL);
+        } else {
+            char buffer[1024];
+            ssize_t n = recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0) {
+                received.append(buffer, (size_t)n);
+            }
+        }
+        usleep(500);
+    }
+    TEST_ASSERT_TRUE(sensor.getRawBlocksSent() >= 2);
+
+    int blocks = 0;
+    int readings = 0;
+    int failed = 0;
+    uint16_t lastSeq = 0;
+    for (size_t at = received.find("RAW "); at != std::string::npos; at = received.find("RAW ", at + 1)) {
+        size_t end = received.find("\r\n", at);
+        TEST_ASSERT_TRUE(end != std::string::npos);
+        uint8_t block[RAW_BLOCK_BYTES];
+        size_t length = base64Decode(received.substr(at + 4, end - at - 4), block);
+        uint16_t seq;
+        uint32_t ms[RAW_MAX_READINGS];
+        uint16_t mm[RAW_MAX_READINGS];
+        int count = decodeRawBlock(block, length, seq, ms, mm);
+        TEST_ASSERT_TRUE(count > 10);
+        for (int i = 0; i < count; i++) {
+            TEST_ASSERT_TRUE(mm[i] == 0 || (mm[i] >= 1200 && mm[i] <= 1206));
+            failed += mm[i] == 0;
+        }
+        TEST_ASSERT_TRUE(blocks == 0 || seq == lastSeq + 1);
+        // Aun con el jitter de la simulación acelerada, muy por debajo de
+        // los ~70 bytes del JSON por medición
+        TEST_ASSERT_TRUE((end - at + 2) < (size_t)count * 8);
+        lastSeq = seq;
+        readings += count;
+        blocks++;
+    }
+    TEST_ASSERT_EQUAL((int)sensor.getRawBlocksSent(), blocks);
+    TEST_ASSERT_TRUE(readings >= 35);
+    TEST_ASSERT_TRUE(failed >= 3);
+
+    // CFG raw=0 lo apaga desde el servidor
+    const char* frame = "CFG 7 raw=0\n";
+    send(client, frame, strlen(frame), 0);
+    for (int i = 0; i < 200 && received.find("\"ack\":7") == std::string::npos; i++) {
+        sensor.update();
+        char buffer[256];
+        ssize_t n = recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n > 0) {
+            received.append(buffer, (size_t)n);
+        }
+        usleep(1000);
+    }
+    TEST_ASSERT_TRUE(received.find("{\"ack\":7,\"parkingId\":4,\"status\":\"ok\"}") != std::string::npos);
+    unsigned long sent = sensor.getRawBlocksSent();
+    start = hal::millis();
+    while (hal::millis() - start < 25000) {
+        sensor.update();
+        usleep(500);
+    }
+    TEST_ASSERT_EQUAL(sent, sensor.getRawBlocksSent());
+
+    close(client);
+    close(listener);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_block_round_trip);
+    RUN_TEST(test_block_is_due_when_full_or_late);
+    RUN_TEST(test_sensor_sends_raw_blocks);
+    return UNITY_END();
+}
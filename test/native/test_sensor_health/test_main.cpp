@@ -0,0 +1,221 @@
+// Pruebas de la salud del sensor ultrasónico en el host (pio test -e native):
+// el clasificador contra trazas sintéticas de fallas (tapado, desalineado,
+// desconectado, trabado, con timeouts frecuentes) después de un tramo sano,
+// y el aviso del ParkingSensor real al servidor.
+
+#include <unity.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string>
+
+#include "Hal.h"
+#include "SensorHealth.h"
+#include "ParkingSensor.h"
+
+// Pseudoaleatorio reproducible: uniforme en [0, 1) y ruido casi normal
+static uint32_t seed = 1;
+
+static float uniform() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return (float)(seed >> 8) / 16777216.0f;
+}
+
+static float noise(float sd) {
+    return (uniform() + uniform() + uniform() + uniform() - 2.0f) * 1.73f * sd;
+}
+
+// Un espacio sano: libre a 180 cm, autos a 30 cm que se quedan entre 1 y 5
+// minutos, ruido de 3 mm y un timeout cada ~100 mediciones
+static float healthy(int i) {
+    if (uniform() < 0.01f) {
+        return -1.0f;
+    }
+    bool occupied = (i / 120 + i / 300) % 2 == 1;
+    return (occupied ? 30.0f : 180.0f) + noise(0.3f);
+}
+
+enum Fault { UNPLUGGED, COVERED, TILTED, FROZEN, FLAKY };
+
+static float faulty(Fault fault, int i) {
+    switch (fault) {
+        case UNPLUGGED: return -1.0f;
+        case COVERED: return 0.5f + uniform() * 3.0f;           // Hoja o barro sobre el transductor
+        case TILTED:                                            // Eco en el piso o en la columna
+            return uniform() < 0.4f ? 420.0f + uniform() * 200.0f : 60.0f + uniform() * 300.0f;
+        case FROZEN: return 180.3f;
+        case FLAKY: return uniform() < 0.25f ? -1.0f : healthy(i);
+    }
+    return -1.0f;
+}
+
+// Mediciones hasta que el clasificador llega a expected (-1 si no llega en limit)
+static int feedUntil(SensorHealth& health, Fault fault, SensorHealthState expected, int limit) {
+    for (int i = 0; i < limit; i++) {
+        health.add(faulty(fault, i));
+        if (health.getState() == expected) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    seed = 1;
+}
+
+void tearDown(void) {
+    hal::sim::setTimeScale(1.0);
+    hal::sim::currentBoard().distanceSource = NULL;
+}
+
+void test_healthy_trace_stays_ok(void) {
+    SensorHealth health;
+    int changes = 0;
+    for (int i = 0; i < HEALTH_WARMUP_READINGS; i++) {
+        TEST_ASSERT_FALSE(health.add(healthy(i)));
+        TEST_ASSERT_EQUAL(HEALTH_UNKNOWN, health.getState());
+    }
+    // Seis horas a una medición cada 2 s, con decenas de llegadas y salidas
+    for (int i = HEALTH_WARMUP_READINGS; i < 10800; i++) {
+        changes += health.add(healthy(i));
+        TEST_ASSERT_EQUAL(HEALTH_OK, health.getState());
+    }
+    TEST_ASSERT_EQUAL(1, changes);
+    TEST_ASSERT_TRUE(health.getNoise() < 1.0f);
+    TEST_ASSERT_TRUE(health.getTimeoutRate() < 0.05f);
+}
+
+void test_detects_each_fault_quickly(void) {
+    struct Case {
+        Fault fault;
+        SensorHealthState expected;
+        int maxReadings;        // Latencia de detección
+    };
+    const Case cases[] = {
+        {UNPLUGGED, HEALTH_FAILING, 30},
+        {COVERED, HEALTH_BLOCKED, 30},
+        {TILTED, HEALTH_MISALIGNED, 30},
+        {FROZEN, HEALTH_STUCK, HEALTH_STUCK_READINGS + HEALTH_CONFIRM_READINGS},
+        {FLAKY, HEALTH_DEGRADED, 60},
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        SensorHealth health;
+        seed = 7 + (uint32_t)c;
+        for (int i = 0; i < 600; i++) {
+            health.add(healthy(i));
+        }
+        TEST_ASSERT_EQUAL(HEALTH_OK, health.getState());
+
+        int latency = feedUntil(health, cases[c].fault, cases[c].expected, 2000);
+        TEST_ASSERT_TRUE_MESSAGE(latency > 0 && latency <= cases[c].maxReadings,
+                                 sensorHealthName(cases[c].expected));
+
+        // Mientras dura la falla no vuelve a cambiar
+        for (int i = 0; i < 1000; i++) {
+            TEST_ASSERT_TRUE_MESSAGE(!health.add(faulty(cases[c].fault, i)),
+                                     sensorHealthName(cases[c].expected));
+        }
+
+        // Reparado: vuelve a ok en unas decenas de mediciones
+        int recovery = -1;
+        for (int i = 0; i < 200 && recovery < 0; i++) {
+            health.add(healthy(i));
+            if (health.getState() == HEALTH_OK) {
+                recovery = i + 1;
+            }
+        }
+        TEST_ASSERT_TRUE_MESSAGE(recovery > 0 && recovery <= 120, sensorHealthName(cases[c].expected));
+    }
+}
+
+// ---- ParkingSensor real contra un servidor local ----
+
+static volatile bool unplugged = false;
+
+static float cable(void* context, unsigned long nowMs) {
+    (void)context;
+    (void)nowMs;
+    return unplugged ? -1.0f : 142.0f + noise(0.3f);
+}
+
+static void pump(ParkingSensor& sensor, int listener, int& client, std::string& received,
+                 unsigned long ms) {
+    unsigned long start = hal::millis();
+    while (hal::millis() - start < ms) {
+        sensor.update();
+        if (client < 0) {
+            client = accept(listener, NULL, NULL);
+        } else {
+            char buffer[512];
+            ssize_t n = recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0) {
+                received.append(buffer, (size_t)n);
+            }
+        }
+        usleep(500);
+    }
+}
+
+void test_sensor_reports_health_changes(void) {
+    hal::sim::setTimeScale(50.0);
+    hal::sim::currentBoard().distanceSource = cable;
+    unplugged = false;
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, (struct sockaddr*)&address, sizeof(address));
+    listen(listener, 1);
+    socklen_t addressLength = sizeof(address);
+    getsockname(listener, (struct sockaddr*)&address, &addressLength);
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+
+    ParkingSensor sensor(35, 36, 4, "127.0.0.1", ntohs(address.sin_port));
+    sensor.begin();
+    sensor.setHeartbeatInterval(10000);
+
+    // Sano: el fin del calentamiento no se avisa, el heartbeat lleva "ok" (1)
+    int client = -1;
+    std::string received;
+    pump(sensor, listener, client, received, 30000);
+    TEST_ASSERT_TRUE(client >= 0);
+    TEST_ASSERT_EQUAL(HEALTH_OK, sensor.getHealth());
+    TEST_ASSERT_TRUE(received.find("\"health\"") == std::string::npos);
+    TEST_ASSERT_TRUE(received.find(" 1\r\n") != std::string::npos);
+
+    // Desconectado: una línea con el estado y las tasas, y el código 6 en el HB
+    unplugged = true;
+    pump(sensor, listener, client, received, 60000);
+    TEST_ASSERT_EQUAL(HEALTH_FAILING, sensor.getHealth());
+    size_t at = received.find("{\"health\":\"failing\",\"parkingId\":4,\"timeouts\":");
+    TEST_ASSERT_TRUE(at != std::string::npos);
+    TEST_ASSERT_TRUE(received.find("\"stuck\":", at) != std::string::npos);
+    TEST_ASSERT_TRUE(received.find(" 6\r\n", at) != std::string::npos);
+    TEST_ASSERT_TRUE(strstr(sensor.getStatusString().c_str(), "Salud: failing") != NULL);
+
+    // Reparado: pasa por degraded mientras bajan los promedios (~75 mediciones)
+    unplugged = false;
+    pump(sensor, listener, client, received, 100000);
+    TEST_ASSERT_EQUAL(HEALTH_OK, sensor.getHealth());
+    TEST_ASSERT_TRUE(received.find("{\"health\":\"ok\",\"parkingId\":4,", at) != std::string::npos);
+
+    close(client);
+    close(listener);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_healthy_trace_stays_ok);
+    RUN_TEST(test_detects_each_fault_quickly);
+    RUN_TEST(test_sensor_reports_health_changes);
+    return UNITY_END();
+}
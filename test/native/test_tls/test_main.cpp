@@ -0,0 +1,136 @@
+// Pruebas del transporte TLS en el host (pio test -e native)
+// Servidor TLS en loopback con certificado autofirmado (hal::sim::TlsTestServer).
+
+#include <unity.h>
+#include <unistd.h>
+#include <string>
+
+#include "Hal.h"
+#include "HalTls.h"
+#include "ParkingSensor.h"
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+    hal::sim::setTimeScale(1000.0);
+}
+
+void tearDown(void) {}
+
+// Esperar la respuesta "OK" del servidor a la última línea
+static bool readReply(hal::TlsClient& client) {
+    std::string reply;
+    for (int i = 0; i < 2000 && reply.find('\n') == std::string::npos; i++) {
+        while (client.available() > 0) {
+            int c = client.read();
+            if (c >= 0) {
+                reply += (char)c;
+            }
+        }
+        usleep(1000);
+    }
+    return reply == "OK\n";
+}
+
+void test_full_handshake_then_resumed(void) {
+    hal::sim::TlsTestServer server;
+    uint16_t port = 0;
+    TEST_ASSERT_TRUE(server.start(port));
+
+    hal::TlsClient client;
+    client.setCACert(server.caCert());
+
+    TEST_ASSERT_EQUAL(1, client.connect("127.0.0.1", port));
+    TEST_ASSERT_FALSE(client.getStats().lastResumed);
+    TEST_ASSERT_TRUE(client.hasSavedSession());
+    uint32_t fullPeak = client.getStats().lastHandshakePeakBytes;
+    client.println("hola");
+    TEST_ASSERT_TRUE(readReply(client));
+    client.stop();
+
+    // Misma sesión ofrecida al reconectar: sin certificados ni ECDHE
+    TEST_ASSERT_EQUAL(1, client.connect("127.0.0.1", port));
+    const hal::TlsStats& stats = client.getStats();
+    TEST_ASSERT_TRUE(stats.lastResumed);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.fullHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.resumedHandshakes);
+    TEST_ASSERT_TRUE(fullPeak > 0);
+    TEST_ASSERT_TRUE(stats.lastHandshakePeakBytes < fullPeak);
+    client.println("otra vez");
+    TEST_ASSERT_TRUE(readReply(client));
+    TEST_ASSERT_TRUE(server.received("otra vez"));
+    client.stop();
+
+    // Sin reanudación cada conexión hace el handshake completo
+    client.setSessionResumption(false);
+    TEST_ASSERT_EQUAL(1, client.connect("127.0.0.1", port));
+    TEST_ASSERT_FALSE(client.getStats().lastResumed);
+    TEST_ASSERT_FALSE(client.hasSavedSession());
+    client.stop();
+    TEST_ASSERT_EQUAL_UINT32(1, server.resumed());
+}
+
+void test_rejects_server_with_unknown_certificate(void) {
+    hal::sim::TlsTestServer trusted;
+    hal::sim::TlsTestServer other;
+    uint16_t trustedPort = 0;
+    uint16_t otherPort = 0;
+    TEST_ASSERT_TRUE(trusted.start(trustedPort));
+    TEST_ASSERT_TRUE(other.start(otherPort));
+
+    hal::TlsClient client;
+    client.setCACert(trusted.caCert());
+    TEST_ASSERT_EQUAL(0, client.connect("127.0.0.1", otherPort));
+    TEST_ASSERT_EQUAL_UINT32(1, client.getStats().failedHandshakes);
+    TEST_ASSERT_FALSE(client.connected());
+    TEST_ASSERT_FALSE(client.hasSavedSession());
+}
+
+void test_parking_sensor_over_tls(void) {
+    hal::sim::TlsTestServer server;
+    uint16_t port = 0;
+    TEST_ASSERT_TRUE(server.start(port));
+
+    hal::TlsClient tls;
+    tls.setCACert(server.caCert());
+
+    ParkingSensor sensor(35, 36, 6, "127.0.0.1", port);
+    sensor.setTransport(&tls);
+    sensor.begin();
+    hal::sim::setFixedDistance(80.0f);
+    for (int i = 0; i < 2000 && !sensor.isTcpConnected(); i++) {
+        sensor.update();
+        usleep(500);
+    }
+    TEST_ASSERT_TRUE(sensor.isTcpConnected());
+    TEST_ASSERT_EQUAL_UINT32(1, tls.getStats().fullHandshakes);
+
+    // El cambio a ocupado sale por la conexión TLS ya abierta
+    hal::sim::setFixedDistance(20.0f);
+    for (int i = 0; i < 2000 && sensor.getEventsSent() == 0; i++) {
+        sensor.update();
+        usleep(500);
+    }
+    TEST_ASSERT_EQUAL(1, sensor.getEventsSent());
+
+    const char* event = "\"parkingId\":6,\"occupied\":true";
+    for (int i = 0; i < 2000 && !server.received(event); i++) {
+        usleep(1000);
+    }
+    TEST_ASSERT_TRUE(server.received("{\"hello\":true,\"parkingId\":6}"));
+    TEST_ASSERT_TRUE(server.received(event));
+
+    // Volver a TCP plano cierra la conexión TLS
+    sensor.setTransport(NULL);
+    TEST_ASSERT_FALSE(tls.connected());
+    TEST_ASSERT_FALSE(sensor.isTcpConnected());
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_full_handshake_then_resumed);
+    RUN_TEST(test_rejects_server_with_unknown_certificate);
+    RUN_TEST(test_parking_sensor_over_tls);
+    return UNITY_END();
+}
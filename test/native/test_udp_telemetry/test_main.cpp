@@ -0,0 +1,274 @@
+// Pruebas de la telemetría UDP en el host (pio test -e native): confirmación
+// selectiva, retransmisión acotada, ventana llena y pérdida simulada.
+
+#include <unity.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <set>
+
+#include "Hal.h"
+#include "UdpTelemetry.h"
+#include "GatewayFrame.h"
+#include "ParkingSensor.h"
+#include "TestServer.h"
+
+void setUp(void) {
+    hal::sim::setSerialEnabled(false);
+}
+
+void tearDown(void) {
+    hal::sim::setTimeScale(1.0);
+    hal::sim::setPacketLoss(0.0);
+}
+
+// Servidor de prueba: recibe tramas y confirma como parking_server.py
+struct UdpServer {
+    int fd;
+    uint16_t port;
+    std::set<uint32_t> received;
+    unsigned datagrams;
+};
+
+static void startServer(UdpServer& server) {
+    server.fd = openLoopback(SOCK_DGRAM, server.port);
+    server.datagrams = 0;
+}
+
+static void sendAck(UdpServer& server, const struct sockaddr_in& to, const TelemetryAck& ack) {
+    uint8_t bytes[TELEMETRY_ACK_SIZE];
+    encodeTelemetryAck(ack, bytes);
+    sendto(server.fd, bytes, sizeof(bytes), 0, (const struct sockaddr*)&to, sizeof(to));
+}
+
+// Lee lo pendiente; con `acknowledge` responde a cada trama
+static void serve(UdpServer& server, bool acknowledge) {
+    uint8_t buffer[64];
+    struct sockaddr_in from;
+    socklen_t length = sizeof(from);
+    ssize_t n;
+    while ((n = recvfrom(server.fd, buffer, sizeof(buffer), 0, (struct sockaddr*)&from, &length)) > 0) {
+        server.datagrams++;
+        GatewayFrame frame;
+        if (!decodeGatewayFrame(buffer, (size_t)n, frame)) {
+            continue;
+        }
+        server.received.insert(frame.seq);
+        if (!acknowledge) {
+            continue;
+        }
+        TelemetryAck ack = {frame.parkingId, frame.epoch, *server.received.rbegin(), 0};
+        for (uint32_t seq : server.received) {
+            if (seq < ack.seq && ack.seq - seq <= 32) {
+                ack.bitmap |= 1UL << (ack.seq - seq - 1);
+            }
+        }
+        sendAck(server, from, ack);
+    }
+}
+
+static void sendFrame(UdpTelemetry& telemetry, uint32_t seq, uint8_t type = GW_FRAME_EVENT) {
+    GatewayFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.parkingId = 9;
+    frame.epoch = 0x1234;
+    frame.type = type;
+    frame.seq = seq;
+    uint8_t bytes[GW_FRAME_SIZE];
+    TEST_ASSERT_TRUE(telemetry.send(bytes, encodeGatewayFrame(frame, bytes)));
+}
+
+static unsigned ackedEvents = 0;
+
+static void onAck(uint8_t type, unsigned long latencyUs) {
+    (void)latencyUs;
+    if (type == GW_FRAME_EVENT) {
+        ackedEvents++;
+    }
+}
+
+void test_ack_codec_and_selective_ack(void) {
+    TelemetryAck ack = {513, 0xBEEF, 70000, 0x80000005};
+    uint8_t bytes[TELEMETRY_ACK_SIZE];
+    TEST_ASSERT_EQUAL(TELEMETRY_ACK_SIZE, encodeTelemetryAck(ack, bytes));
+    TelemetryAck decoded;
+    TEST_ASSERT_TRUE(decodeTelemetryAck(bytes, sizeof(bytes), decoded));
+    TEST_ASSERT_EQUAL(513, decoded.parkingId);
+    TEST_ASSERT_EQUAL_HEX32(0xBEEF, decoded.epoch);
+    TEST_ASSERT_EQUAL_UINT32(70000, decoded.seq);
+    TEST_ASSERT_EQUAL_HEX32(0x80000005, decoded.bitmap);
+    TEST_ASSERT_FALSE(decodeTelemetryAck(bytes, sizeof(bytes) - 1, decoded));
+
+    UdpServer server;
+    startServer(server);
+    UdpTelemetry telemetry("127.0.0.1", server.port);
+    TEST_ASSERT_TRUE(telemetry.begin(0));
+    ackedEvents = 0;
+    telemetry.setAckHandler(onAck);
+    for (uint32_t seq = 1; seq <= 4; seq++) {
+        sendFrame(telemetry, seq);
+    }
+    TEST_ASSERT_EQUAL(4, telemetry.getPending());
+    usleep(10000);
+    serve(server, false);     // Sin responder: las confirmaciones se arman a mano
+
+    // Llegaron 1, 3 y 4: seq 4, bit 0 = 3, bit 2 = 1
+    TelemetryAck partial = {9, 0x1234, 4, 0x5};
+    telemetry.acknowledge(partial);
+    TEST_ASSERT_EQUAL(1, telemetry.getPending());
+    TEST_ASSERT_EQUAL(3, ackedEvents);
+
+    // Otro epoch (el sensor se reinició): no confirma nada
+    TelemetryAck stale = {9, 0x9999, 2, 0};
+    telemetry.acknowledge(stale);
+    TEST_ASSERT_EQUAL(1, telemetry.getPending());
+
+    // Por el socket: la retransmisión de 2 se confirma
+    hal::sim::setTimeScale(100.0);
+    for (int i = 0; i < 200 && telemetry.getPending() > 0; i++) {
+        telemetry.update();
+        serve(server, true);
+        usleep(1000);
+    }
+    const TelemetryStats& stats = telemetry.getStats();
+    TEST_ASSERT_EQUAL(0, telemetry.getPending());
+    TEST_ASSERT_EQUAL_UINT32(4, stats.acked);
+    TEST_ASSERT_TRUE(stats.retransmits >= 1);
+    TEST_ASSERT_TRUE(stats.acksReceived >= 1);
+    TEST_ASSERT_EQUAL(4, ackedEvents);
+    close(server.fd);
+}
+
+void test_selective_ack_across_seq_wraparound(void) {
+    UdpServer server;
+    startServer(server);
+    UdpTelemetry telemetry("127.0.0.1", server.port);
+    TEST_ASSERT_TRUE(telemetry.begin(0));
+    const uint32_t seqs[] = {0xFFFFFFFEUL, 0xFFFFFFFFUL, 0, 1, 2};
+    for (uint32_t seq : seqs) {
+        sendFrame(telemetry, seq);
+    }
+
+    // Llegaron todas menos 0: seq 2, bit 1 = 0 ausente, bits 0, 2 y 3 antes de la vuelta
+    TelemetryAck ack = {9, 0x1234, 2, 0xD};
+    telemetry.acknowledge(ack);
+    TEST_ASSERT_EQUAL(1, telemetry.getPending());
+    TEST_ASSERT_EQUAL_UINT32(4, telemetry.getStats().acked);
+
+    // Una confirmación vieja (seq anterior a la vuelta) no toca las nuevas
+    TelemetryAck late = {9, 0x1234, 0xFFFFFFF0UL, 0xFFFFFFFFUL};
+    telemetry.acknowledge(late);
+    TEST_ASSERT_EQUAL(1, telemetry.getPending());
+    close(server.fd);
+}
+
+void test_gives_up_after_max_attempts_and_evicts(void) {
+    hal::sim::setTimeScale(100.0);
+    UdpServer server;
+    startServer(server);
+    UdpTelemetry telemetry("127.0.0.1", server.port);
+    telemetry.begin(0);
+    sendFrame(telemetry, 1);
+
+    // 300 + 600 + 1200 + 2400 ms simulados y luego se abandona
+    for (int i = 0; i < 400 && telemetry.getPending() > 0; i++) {
+        telemetry.update();
+        serve(server, false);
+        usleep(1000);
+    }
+    serve(server, false);
+    const TelemetryStats& stats = telemetry.getStats();
+    TEST_ASSERT_EQUAL(0, telemetry.getPending());
+    TEST_ASSERT_EQUAL_UINT32(1, stats.lost);
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_MAX_ATTEMPTS - 1, stats.retransmits);
+    TEST_ASSERT_EQUAL(TELEMETRY_MAX_ATTEMPTS, server.datagrams);
+    TEST_ASSERT_TRUE(stats.activeMs >= 4500);
+
+    for (uint32_t seq = 2; seq < 2 + TELEMETRY_WINDOW + 1; seq++) {
+        sendFrame(telemetry, seq);
+    }
+    TEST_ASSERT_EQUAL(TELEMETRY_WINDOW, telemetry.getPending());
+    TEST_ASSERT_EQUAL_UINT32(1, telemetry.getStats().evicted);
+    close(server.fd);
+}
+
+void test_recovers_from_packet_loss(void) {
+    hal::sim::setTimeScale(100.0);
+    hal::sim::setPacketLoss(0.3);
+    UdpServer server;
+    startServer(server);
+    UdpTelemetry telemetry("127.0.0.1", server.port);
+    telemetry.begin(0);
+
+    for (uint32_t seq = 1; seq <= 40; seq++) {
+        sendFrame(telemetry, seq, seq % 4 == 0 ? GW_FRAME_EVENT : GW_FRAME_HEARTBEAT);
+        for (int i = 0; i < 5; i++) {
+            telemetry.update();
+            serve(server, true);
+            usleep(1000);
+        }
+    }
+    for (int i = 0; i < 1000 && telemetry.getPending() > 0; i++) {
+        telemetry.update();
+        serve(server, true);
+        usleep(1000);
+    }
+
+    const TelemetryStats& stats = telemetry.getStats();
+    TEST_ASSERT_EQUAL(0, telemetry.getPending());
+    TEST_ASSERT_EQUAL_UINT32(40, stats.acked + stats.lost + stats.evicted);
+    // 30% de pérdida en cada sentido: cada intento llega y vuelve con ~49%
+    TEST_ASSERT_TRUE(stats.acked >= 34);
+    TEST_ASSERT_TRUE(stats.retransmits > 0);
+    TEST_ASSERT_EQUAL(stats.datagrams, stats.sent + stats.retransmits);
+    close(server.fd);
+}
+
+// ParkingSensor real con la telemetría como sender de tramas
+static UdpTelemetry* sensorTelemetry = NULL;
+
+static bool sendTelemetry(const uint8_t* frame, size_t length) {
+    return sensorTelemetry->send(frame, length);
+}
+
+void test_parking_sensor_over_udp(void) {
+    hal::sim::setTimeScale(1000.0);
+    hal::sim::setFixedDistance(20.0f);
+    UdpServer server;
+    startServer(server);
+    UdpTelemetry telemetry("127.0.0.1", server.port);
+    telemetry.begin(0);
+    sensorTelemetry = &telemetry;
+
+    ParkingSensor sensor(35, 36, 44, "127.0.0.1", server.port);
+    sensor.begin();
+    sensor.setHeartbeatInterval(1000);
+    sensor.setFrameSender(sendTelemetry);
+    for (int i = 0; i < 500 && telemetry.getStats().acked < 2; i++) {
+        sensor.update();
+        telemetry.update();
+        serve(server, true);
+        usleep(1000);
+    }
+
+    TEST_ASSERT_FALSE(sensor.isTcpConnected());
+    TEST_ASSERT_EQUAL(1, sensor.getEventsSent());
+    TEST_ASSERT_TRUE(telemetry.getStats().acked >= 2);
+    TEST_ASSERT_TRUE(server.received.count(1) == 1);
+    sensorTelemetry = NULL;
+    close(server.fd);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_ack_codec_and_selective_ack);
+    RUN_TEST(test_selective_ack_across_seq_wraparound);
+    RUN_TEST(test_gives_up_after_max_attempts_and_evicts);
+    RUN_TEST(test_recovers_from_packet_loss);
+    RUN_TEST(test_parking_sensor_over_udp);
+    return UNITY_END();
+}
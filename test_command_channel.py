@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Pruebas del canal de comandos servidor → ESP32 (CFG/PING con confirmación)
+Ejecutar con: pytest test_command_channel.py
+"""
+
+import json
+import socket
+import threading
+import time
+
+import pytest
+
+
+class FakeDevice:
+    """Dispositivo simulado que responde tramas CFG como el firmware"""
+
+    VALID_KEYS = {"threshold", "id", "server", "interval", "res", "quality", "roi"}
+
+    def __init__(self, port, parking_id, respond=True):
+        self.parking_id = parking_id
+        self.respond = respond
+        self.applied = []
+        self.socket = socket.create_connection(("127.0.0.1", port))
+        self.running = True
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+        self.send({"parkingId": parking_id, "occupied": False, "distance": 80.0, "timestamp": 1000})
+
+    def send(self, data):
+        self.socket.sendall((json.dumps(data) + "\n").encode("utf-8"))
+
+    def run(self):
+        buffer = b""
+        while self.running:
+            try:
+                data = self.socket.recv(4096)
+            except OSError:
+                break
+            if not data:
+                break
+            buffer += data
+            while b"\n" in buffer:
+                line, buffer = buffer.split(b"\n", 1)
+                self.handle_frame(line.decode("utf-8"))
+
+    def handle_frame(self, frame):
+        parts = frame.split()
+        verb, seq = parts[0], int(parts[1])
+        if not self.respond:
+            return
+        config = dict(pair.split("=", 1) for pair in parts[2:])
+        bad = [key for key in config if key not in self.VALID_KEYS]
+        if verb == "CFG" and bad:
+            self.send({"ack": seq, "parkingId": self.parking_id, "status": "error",
+                       "error": "unknown_key", "key": bad[0]})
+            return
+        self.applied.append(config)
+        self.send({"ack": seq, "parkingId": self.parking_id, "status": "ok"})
+
+    def close(self):
+        self.running = False
+        self.socket.close()
+
+
+def wait_devices(server, count):
+    deadline = time.time() + 2.0
+    while len(server.devices) < count and time.time() < deadline:
+        time.sleep(0.01)
+    assert len(server.devices) == count
+
+
+def test_push_config_single_device(server):
+    device = FakeDevice(server.port, 7)
+    wait_devices(server, 1)
+
+    result = server.push_config(7, {"threshold": "35.5", "interval": 500, "roi": (250, 400, 500, 600)})
+
+    assert result["status"] == "ok"
+    assert device.applied == [{"threshold": "35.5", "interval": "500", "roi": "250,400,500,600"}]
+    device.close()
+
+
+def test_push_config_fleet(server):
+    devices = [FakeDevice(server.port, pid) for pid in (1, 2, 3)]
+    wait_devices(server, 3)
+
+    results = server.push_config_fleet({"quality": 20})
+
+    assert sorted(r["parkingId"] for r in results) == [1, 2, 3]
+    assert all(r["status"] == "ok" for r in results)
+    for device in devices:
+        assert device.applied == [{"quality": "20"}]
+        device.close()
+
+
+def test_push_config_reports_missing_and_silent_devices(server):
+    silent = FakeDevice(server.port, 4, respond=False)
+    wait_devices(server, 1)
+
+    assert server.push_config(99, {"threshold": 40})["status"] == "not_connected"
+    assert server.push_config(4, {"threshold": 40}, timeout=0.3)["status"] == "timeout"
+    silent.close()
+
+
+def test_push_config_rejects_unknown_keys_before_sending(server):
+    device = FakeDevice(server.port, 5)
+    wait_devices(server, 1)
+
+    with pytest.raises(ValueError):
+        server.push_config(5, {"colour": "red"})
+    assert device.applied == []
+    device.close()
+
+
+def test_config_command_from_admin_client(server):
+    device = FakeDevice(server.port, 8)
+    wait_devices(server, 1)
+
+    admin = socket.create_connection(("127.0.0.1", server.port))
+    admin.sendall(b"COMMAND:CONFIG 8 threshold=42\n")
+    response = json.loads(admin.recv(4096).decode("utf-8"))
+    admin.close()
+
+    assert response["status"] == "ok"
+    assert response["results"][0]["parkingId"] == 8
+    assert device.applied == [{"threshold": "42"}]
+    device.close()
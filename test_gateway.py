@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+Pruebas del modo gateway en el servidor
+Ejecutar con: pytest test_gateway.py
+
+Los lotes los arma lib/Gateway (probado en C++ en test/native/test_gateway);
+acá se prueba cómo se aplican, se confirman y se reconocen los reenvíos.
+"""
+
+import json
+import socket
+import time
+
+
+def batch(number, frames, epoch=77, gateway=2):
+    line = {"gateway": gateway, "epoch": epoch, "batch": number, "frames": frames}
+    return (json.dumps(line) + "\r\n").encode("utf-8")
+
+
+def event(parking_id, seq, occupied, distance=25.3, ms=90000):
+    return [parking_id, seq, 1, 1 if occupied else 0, distance, ms, 40, 2]
+
+
+def heartbeat(parking_id, seq, occupied, distance=25.3, ms=120000):
+    return [parking_id, seq, 2, 1 if occupied else 0, distance, ms, 300, 1]
+
+
+def connect_gateway(server, hello=b'{"hello":true,"gateway":2,"hb":30000}\n'):
+    gateway = socket.create_connection(("127.0.0.1", server.port))
+    gateway.settimeout(5.0)
+    gateway.sendall(hello)
+    return gateway
+
+
+def test_batch_is_applied_and_acknowledged(server):
+    gateway = connect_gateway(server)
+    gateway.sendall(batch(1, [event(11, 1, True), event(12, 1, False, 180.0), heartbeat(11, 2, True)]))
+    assert gateway.recv(64) == b"GWK 1\n"
+
+    spot = server.occupancy.get(11)
+    assert spot.occupied and spot.seq == 2 and spot.lost == 0
+    assert spot.measurements == 300
+    assert not server.occupancy.get(12).occupied
+    assert server.heartbeats_received == 1
+
+    info = server.get_server_info()["gateways"]["2"]
+    assert info == {"connected": True, "leaves": 2, "batches": 1, "frames": 3, "duplicates": 0}
+    gateway.close()
+
+
+def test_resent_batch_is_acknowledged_but_not_reapplied(server):
+    gateway = connect_gateway(server)
+    gateway.sendall(batch(1, [event(11, 1, True)]))
+    assert gateway.recv(64) == b"GWK 1\n"
+    gateway.close()
+
+    # El GWK se perdió con la conexión: el gateway reenvía el mismo lote
+    gateway = connect_gateway(server)
+    gateway.sendall(batch(1, [event(11, 1, True)]))
+    assert gateway.recv(64) == b"GWK 1\n"
+    gateway.sendall(batch(2, [event(11, 2, False)]))
+    assert gateway.recv(64) == b"GWK 2\n"
+
+    info = server.gateway_info()["2"]
+    assert info["batches"] == 2 and info["duplicates"] == 1
+    spot = server.occupancy.get(11)
+    assert not spot.occupied and spot.lost == 0
+
+    # El gateway se reinició: otro epoch, los lotes vuelven a empezar
+    gateway.sendall(batch(1, [event(11, 3, True)], epoch=78))
+    assert gateway.recv(64) == b"GWK 1\n"
+    assert server.occupancy.get(11).occupied
+    gateway.close()
+
+
+def test_leaves_go_stale_when_the_gateway_disconnects(server):
+    gateway = connect_gateway(server)
+    gateway.sendall(batch(1, [event(21, 1, True), event(22, 1, True)]))
+    assert gateway.recv(64) == b"GWK 1\n"
+    assert not server.occupancy.get(21).stale
+
+    gateway.close()
+    deadline = time.time() + 2.0
+    while not server.occupancy.get(22).stale and time.time() < deadline:
+        time.sleep(0.01)
+    assert server.occupancy.get(21).stale and server.occupancy.get(22).stale
+    assert server.gateway_info()["2"]["connected"] is False
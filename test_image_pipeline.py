@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Pruebas del pipeline de imágenes del servidor (cola, dedup, nombres, índice)
+Ejecutar con: pytest test_image_pipeline.py
+"""
+
+import base64
+import json
+import os
+import socket
+import threading
+import time
+
+import pytest
+
+from image_pipeline import ImagePipeline
+
+
+def fake_jpeg(seed, size=2000):
+    body = bytes((seed * 31 + i * 7) & 0xFF for i in range(size))
+    return b"\xff\xd8" + body + b"\xff\xd9"
+
+
+class Replies:
+    """Recolector de respuestas entregadas desde los hilos del pipeline"""
+
+    def __init__(self):
+        self.items = []
+        self.cond = threading.Condition()
+
+    def __call__(self, response):
+        with self.cond:
+            self.items.append(response)
+            self.cond.notify_all()
+
+    def wait(self, count, timeout=5.0):
+        with self.cond:
+            assert self.cond.wait_for(lambda: len(self.items) >= count, timeout)
+        return self.items
+
+
+@pytest.fixture
+def pipeline(tmp_path):
+    p = ImagePipeline(str(tmp_path), workers=2, quiet=True)
+    p.start()
+    yield p
+    p.stop()
+
+
+def test_names_are_unique_per_parking_and_event(pipeline, tmp_path):
+    replies = Replies()
+    for seed in range(3):
+        pipeline.submit(base64.b64encode(fake_jpeg(seed)), 4, 1000, replies)
+    pipeline.submit(base64.b64encode(fake_jpeg(9)), 5, 1000, replies)
+
+    names = sorted(r["filename"] for r in replies.wait(4))
+    assert names == ["parking_4_1000.jpg", "parking_4_1000_1.jpg", "parking_4_1000_2.jpg",
+                     "parking_5_1000.jpg"]
+    for name in names:
+        assert os.path.exists(tmp_path / name)
+    assert not [f for f in os.listdir(tmp_path) if f.endswith(".tmp")]
+
+
+def test_duplicate_content_is_not_stored_twice(pipeline, tmp_path):
+    replies = Replies()
+    payload = base64.b64encode(fake_jpeg(1))
+    pipeline.submit(payload, 1, 10, replies)
+    replies.wait(1)
+    pipeline.submit(payload, 2, 20, replies)
+
+    first, second = replies.wait(2)
+    assert second["status"] == "success" and second["duplicate"]
+    assert second["filename"] == first["filename"]
+    assert not os.path.exists(tmp_path / "parking_2_20.jpg")
+    assert pipeline.stats()["duplicates"] == 1
+
+
+@pytest.mark.parametrize("disk_fails", [False, True])
+def test_duplicate_of_an_image_in_flight_waits_for_it(pipeline, tmp_path, monkeypatch, disk_fails):
+    # El escritor queda detenido en el renombrado de la original
+    gate = threading.Event()
+    replace = os.replace
+
+    def slow_replace(source, target):
+        gate.wait(5.0)
+        if disk_fails:
+            raise OSError("disco lleno")
+        replace(source, target)
+
+    monkeypatch.setattr("image_pipeline.os.replace", slow_replace)
+    replies = Replies()
+    payload = base64.b64encode(fake_jpeg(2))
+    pipeline.submit(payload, 1, 10, replies)
+    pipeline.submit(payload, 2, 20, replies)
+    deadline = time.time() + 5.0
+    while not any(pipeline.waiting.values()) and time.time() < deadline:
+        time.sleep(0.01)
+    assert replies.items == []          # Nada confirmado antes de llegar a disco
+    gate.set()
+
+    original, duplicate = sorted(replies.wait(2), key=lambda r: bool(r.get("duplicate")))
+    if disk_fails:
+        assert original == duplicate == {"status": "error", "message": "error de disco: disco lleno"}
+        assert not os.path.exists(tmp_path / "parking_1_10.jpg")
+        assert pipeline.by_hash == {} and pipeline.waiting == {}
+    else:
+        assert original["filename"] == duplicate["filename"] == "parking_1_10.jpg"
+        assert duplicate["duplicate"] and pipeline.stats()["duplicates"] == 1
+
+
+def test_invalid_images_are_rejected(pipeline):
+    replies = Replies()
+    pipeline.submit(b"no es base64!", 1, 1, replies)
+    pipeline.submit(base64.b64encode(b"GIF89a" + bytes(100)), 1, 2, replies)
+    pipeline.submit(base64.b64encode(b"\xff\xd8" + bytes(100)), 1, 3, replies)
+
+    assert all(r["status"] == "error" for r in replies.wait(3))
+    assert pipeline.stats()["invalid"] == 3
+
+
+def test_full_queue_answers_busy(tmp_path):
+    # Sin iniciar los trabajadores nada sale de la cola
+    p = ImagePipeline(str(tmp_path), workers=1, queue_size=2, quiet=True)
+    replies = Replies()
+    accepted = [p.submit(base64.b64encode(fake_jpeg(i)), 1, i, replies) for i in range(3)]
+
+    assert accepted == [True, True, False]
+    assert replies.wait(1)[0]["error"] == "busy"
+
+
+def test_index_keeps_dedup_across_restarts(tmp_path):
+    payload = base64.b64encode(fake_jpeg(3))
+    first = ImagePipeline(str(tmp_path), workers=1, quiet=True)
+    first.start()
+    replies = Replies()
+    first.submit(payload, 1, 1, replies)
+    replies.wait(1)
+    first.stop()
+
+    second = ImagePipeline(str(tmp_path), workers=1, quiet=True)
+    second.start()
+    replies = Replies()
+    second.submit(payload, 1, 1, replies)
+    second.submit(base64.b64encode(fake_jpeg(4)), 1, 1, replies)
+    responses = replies.wait(2)
+    second.stop()
+
+    by_duplicate = {bool(r.get("duplicate")): r["filename"] for r in responses}
+    assert by_duplicate[True] == "parking_1_1.jpg"
+    assert by_duplicate[False] == "parking_1_1_1.jpg"
+    with open(tmp_path / "index.jsonl", encoding="utf-8") as f:
+        assert len(f.readlines()) == 2
+
+
+def test_server_names_images_by_last_event(server, tmp_path):
+    device = socket.create_connection(("127.0.0.1", server.port))
+    event = {"parkingId": 12, "occupied": True, "distance": 20.0, "timestamp": 4321}
+    device.sendall((json.dumps(event) + "\n").encode("utf-8"))
+    device.sendall(b"IMAGE:" + base64.b64encode(fake_jpeg(5)) + b"\r\n")
+    device.settimeout(5.0)
+    response = json.loads(device.makefile().readline())
+    device.close()
+    server.stop_server()
+
+    assert response == {"status": "success", "message": "Imagen recibida correctamente",
+                        "filename": "parking_12_4321.jpg"}
+    assert os.path.exists(tmp_path / "parking_images" / "parking_12_4321.jpg")
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+Pruebas de la analítica de ocupación (estadía, rotación, utilización)
+Ejecutar con: pytest test_occupancy_analytics.py
+"""
+
+import json
+import socket
+import time
+import urllib.request
+
+from occupancy_analytics import OccupancyAnalytics, log_events
+from sensor_log import SensorLog
+
+DAY = 1_700_006_400.0    # Medianoche UTC: las horas del día empiezan en DAY + h * 3600
+
+
+def test_sessions_are_split_across_hours():
+    analytics = OccupancyAnalytics(utc_offset=0)
+    analytics.record(1, False, DAY, 0)
+    analytics.record(1, True, DAY + 3000, 3000_000)      # 10:50 de ocupación en la hora 0
+    analytics.record(1, False, DAY + 4200, 4200_000)     # Sale a los 20 minutos
+    analytics.record(2, True, DAY + 600, 100)
+
+    hours = analytics.hourly(DAY, DAY + 7200, now=DAY + 7200)
+    assert [row["start"] for row in hours] == ["2023-11-15 00:00", "2023-11-15 01:00"]
+    assert hours[0]["arrivals"] == 2 and hours[0]["sessions"] == 0
+    assert hours[1]["sessions"] == 1 and hours[1]["avg_dwell_s"] == 1200.0
+    # Espacio 1: 600 s + 600 s; espacio 2 sigue ocupado desde 00:10
+    assert hours[0]["utilization"] == round((600 + 3000) / (2 * 3600), 4)
+    assert hours[1]["utilization"] == round((600 + 3600) / (2 * 3600), 4)
+
+    spot = analytics.spot(1, now=DAY + 7200)
+    assert spot["sessions"] == 1 and spot["min_dwell_s"] == spot["max_dwell_s"] == 1200.0
+    assert analytics.spot(2, now=DAY + 7200)["occupied_since"] == DAY + 600
+    summary = analytics.summary(now=DAY + 7200)
+    assert summary["occupied_now"] == 1 and summary["arrivals"] == 2
+
+
+def test_restart_truncates_session_at_last_contact():
+    analytics = OccupancyAnalytics(utc_offset=0)
+    analytics.record(5, True, DAY, 50_000)
+    analytics.seen(5, DAY + 900)                          # Último heartbeat antes del corte
+    # Vuelve con millis() desde cero y el espacio libre: la salida se perdió
+    analytics.record(5, False, DAY + 4000, 1_200)
+    analytics.record(5, True, DAY + 5000, 2_000)
+    analytics.record(5, False, DAY + 5600, 2_600)
+
+    spot = analytics.spot(5, now=DAY + 6000)
+    assert spot["restarts"] == 1 and spot["truncated"] == 1 and spot["sessions"] == 1
+    assert spot["avg_dwell_s"] == 600.0                   # La truncada no cuenta en la estadía
+    assert spot["utilization"] == round((900 + 600) / 6000, 4)
+    day = analytics.daily(DAY, DAY + 86400, now=DAY + 6000)[0]
+    assert day["sessions"] == 1 and day["truncated"] == 1 and day["turnover_per_spot"] == 2.0
+
+
+def test_save_and_load_keep_open_sessions(tmp_path):
+    analytics = OccupancyAnalytics(utc_offset=-6 * 3600)
+    for spot in range(1, 4):
+        analytics.record(spot, True, DAY + spot * 100, spot)
+    analytics.record(1, False, DAY + 1000, 10)
+    path = str(tmp_path / "analytics.json")
+    analytics.save(path)
+
+    loaded = OccupancyAnalytics.load(path)
+    now = DAY + 5000
+    assert loaded.summary(now) == analytics.summary(now)
+    assert loaded.hourly(DAY - 86400, now, now) == analytics.hourly(DAY - 86400, now, now)
+    loaded.record(2, False, DAY + 3000, 20)
+    assert loaded.spot(2, now)["sessions"] == 1 and loaded.summary(now)["occupied_now"] == 1
+
+
+def test_log_backfill_matches_live_rollups(tmp_path):
+    log = SensorLog(str(tmp_path / "parking_sensor.log"))
+    events = [(0, 7, True, 100), (30, 7, False, 30_100), (60, 8, True, 200), (90, 7, True, 90_100)]
+    for offset, parking_id, occupied, timestamp in events:
+        log.write(("10.0.0.1", 1), {"parkingId": parking_id, "occupied": occupied,
+                                     "distance": 20.0, "timestamp": timestamp}, now=DAY + offset)
+    log.close()
+
+    replayed = list(log_events(str(tmp_path / "parking_sensor.log")))
+    assert [(when - DAY, pid, occ, ts) for when, pid, occ, ts in replayed] == events
+
+    live, backfill = OccupancyAnalytics(), OccupancyAnalytics()
+    for offset, parking_id, occupied, timestamp in events:
+        live.record(parking_id, occupied, DAY + offset, timestamp)
+    for when, parking_id, occupied, timestamp in replayed:
+        backfill.record(parking_id, occupied, when, timestamp)
+    assert backfill.summary(DAY + 100) == live.summary(DAY + 100)
+
+
+def test_server_serves_analytics_over_http(start_server):
+    srv = start_server(http_port=0)
+    http = srv.http_server.port
+
+    device = socket.create_connection(("127.0.0.1", srv.port))
+    for occupied, timestamp in ((True, 1000), (False, 2000), (True, 3000)):
+        event = {"parkingId": 6, "occupied": occupied, "distance": 20.0, "timestamp": timestamp}
+        device.sendall((json.dumps(event) + "\n").encode("utf-8"))
+    deadline = time.time() + 5
+    while srv.analytics.events < 3 and time.time() < deadline:
+        time.sleep(0.01)
+
+    def get(path):
+        with urllib.request.urlopen(f"http://127.0.0.1:{http}{path}", timeout=5) as response:
+            return json.loads(response.read())
+
+    summary = get("/analytics")
+    assert summary["sessions"] == 1 and summary["occupied_now"] == 1
+    assert get("/analytics/spots/6")["arrivals"] == 2
+    assert get("/analytics/hourly")["rows"][-1]["arrivals"] >= 1
+    assert len(get("/analytics/daily?since=2020-01-01")["rows"]) >= 1
+
+    device.close()
+    srv.stop_server()
+    # Al detenerse quedan guardados para el próximo arranque
+    assert OccupancyAnalytics.load("parking_analytics.json").summary()["sessions"] == 1
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+Pruebas de la tabla de ocupación en vivo y de la suscripción SSE
+Ejecutar con: pytest test_occupancy_state.py
+"""
+
+import json
+import socket
+import time
+import urllib.request
+
+from occupancy_state import DiffLog, OccupancyTable
+
+
+def test_updates_keep_counts_and_publish_only_changes():
+    table = OccupancyTable()
+    assert table.update(1, False, 120.0, now=10) == 1
+    assert table.update(2, True, 20.0, now=10) == 2
+    assert table.update(1, False, 118.0, now=11) == 0    # Misma ocupación: sin cambio publicado
+    assert table.update(1, True, 25.0, now=12) == 3
+
+    assert table.counts() == {"total": 2, "free": 0, "occupied": 2, "stale": 0}
+    assert table.get(1).distance == 25.0 and table.get(1).last_seen == 12
+    assert table.get(99) is None
+
+
+def test_expire_marks_only_silent_spots_and_touch_revives():
+    table = OccupancyTable(stale_after=60)
+    table.update(1, False, 100.0, now=0)
+    table.update(2, False, 100.0, now=0)
+    table.update(3, True, 20.0, now=0)
+    table.touch(2, now=50)
+    table.update(3, True, 21.0, now=55)
+
+    assert table.expire(now=100) == 1
+    assert table.get(1).stale and not table.get(2).stale
+    assert table.free_spots() == [2]
+
+    seq = table.touch(1, now=101)
+    assert seq > 0 and not table.get(1).stale
+    assert table.counts()["stale"] == 0
+
+
+def test_sequence_gaps_and_restarts_are_counted():
+    table = OccupancyTable()
+    table.update(1, False, 120.0, 1000, seq=1, now=0)
+    table.update(1, False, 119.0, seq=2, measurements=30, failures=1, now=30)   # Heartbeat
+    assert table.get(1).timestamp == 1000 and table.get(1).measurements == 30
+
+    # Se perdieron 3 y 4; el heartbeat trae el estado nuevo y se publica
+    assert table.update(1, True, 20.0, seq=5, now=60) > 0
+    assert table.get(1).lost == 2
+    table.update(1, True, 21.0, seq=1, now=90)
+    assert table.liveness()["lost_frames"] == 2 and table.liveness()["restarts"] == 1
+
+
+def test_heartbeat_timeout_is_per_spot():
+    table = OccupancyTable(stale_after=900)
+    table.update(1, False, 100.0, now=0)
+    table.update(2, False, 100.0, now=0)
+    table.set_timeout(2, 90)
+
+    assert table.expire(now=60) == 0
+    assert table.expire(now=100) == 1
+    assert table.get(2).stale and not table.get(1).stale
+    table.update(2, False, 100.0, now=110)
+    table.set_timeout(2, None)
+    assert table.expire(now=300) == 0
+
+
+def test_slow_reader_gets_resync_instead_of_gaps():
+    log = DiffLog(capacity=3)
+    for i in range(5):
+        log.append(b"%d" % i)
+
+    entries, last = log.read(1, timeout=0)
+    assert entries is None and last == 5
+    entries, last = log.read(3, timeout=0)
+    assert [seq for seq, _ in entries] == [4, 5]
+    assert log.read(5, timeout=0.01) == ([], 5)
+
+
+def read_sse_events(sock, count, timeout=5.0):
+    """Leer count eventos SSE (event, id, data)"""
+    sock.settimeout(timeout)
+    buffer = b""
+    events = []
+    while len(events) < count:
+        data = sock.recv(65536)
+        assert data
+        buffer += data
+        while b"\n\n" in buffer:
+            block, buffer = buffer.split(b"\n\n", 1)
+            fields = dict(line.split(": ", 1) for line in block.decode("utf-8").split("\n")
+                          if ": " in line and not line.startswith(":"))
+            if "event" in fields:
+                events.append(fields)
+    return events
+
+
+def test_server_streams_changes_and_stale_on_disconnect(start_server):
+    srv = start_server(http_port=0)
+    http = srv.http_server.port
+
+    subscriber = socket.create_connection(("127.0.0.1", http))
+    subscriber.sendall(b"GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n")
+    assert read_sse_events(subscriber, 1)[0]["event"] == "snapshot"
+
+    device = socket.create_connection(("127.0.0.1", srv.port))
+    event = {"parkingId": 3, "occupied": True, "distance": 22.0, "timestamp": 500}
+    device.sendall((json.dumps(event) + "\n").encode("utf-8"))
+    change = read_sse_events(subscriber, 1)[0]
+    assert change["event"] == "spot"
+    assert json.loads(change["data"])["occupied"] is True
+
+    with urllib.request.urlopen(f"http://127.0.0.1:{http}/spots/3", timeout=5) as response:
+        assert json.loads(response.read())["distance"] == 22.0
+
+    device.close()
+    stale = json.loads(read_sse_events(subscriber, 1)[0]["data"])
+    assert stale["parkingId"] == 3 and stale["stale"] is True
+
+    subscriber.close()
+    srv.stop_server()
+
+
+def test_server_tracks_heartbeats_and_gaps(server):
+    device = socket.create_connection(("127.0.0.1", server.port))
+    device.sendall(b'{"hello":true,"parkingId":4,"hb":2000}\n'
+                   b'{"parkingId":4,"occupied":false,"distance":130.0,"timestamp":900,"seq":2}\n'
+                   b'HB 3 0 131.0 12 0\r\nHB 6 1 25.0 15 1\r\n')
+    deadline = time.time() + 5
+    while server.heartbeats_received < 2 and time.time() < deadline:
+        time.sleep(0.01)
+
+    spot = server.occupancy.get(4)
+    assert spot.occupied and spot.seq == 6 and spot.lost == 2 and spot.failures == 1
+    assert server.occupancy.timeouts[4] == 6.0
+    assert server.get_server_info()["liveness"]["heartbeats"] == 2
+
+    device.close()
+    server.stop_server()
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""
+Pruebas de los parches de firmware y de la descarga OTA desde el servidor
+Ejecutar con: pytest test_ota_delta.py
+
+El dispositivo simulado habla el mismo protocolo que lib/OtaUpdate: hello
+con "fw", oferta OTA confirmada, pedidos {"ota":"get"} y tramas OTAD con
+bytes binarios. La misma aplicación del parche se prueba en C++ en
+test/native/test_ota.
+"""
+
+import json
+import os
+import random
+import socket
+import struct
+import threading
+import time
+
+import pytest
+
+from ota_delta import (FirmwareRepository, PatchError, apply_patch, firmware_id,
+                       make_patch, parse_header)
+
+
+def fake_image(seed, size=200_000, sha=None):
+    """Imagen con la cabecera y el esp_app_desc_t de ESP-IDF"""
+    rng = random.Random(seed)
+    body = bytearray(rng.getrandbits(8) for _ in range(size))
+    body[0] = 0xE9
+    struct.pack_into("<I", body, 32, 0xABCD5432)
+    body[176:208] = sha or bytes(rng.getrandbits(8) for _ in range(32))
+    return body
+
+
+def rebuild(image, seed):
+    """Nueva compilación: código insertado, direcciones corridas y un parche de datos"""
+    rng = random.Random(seed)
+    new = bytearray(image[:50_000]) + bytes(rng.getrandbits(8) for _ in range(300)) + image[50_000:]
+    for k in range(60_000, 120_000, 97):
+        new[k] = (new[k] + 4) & 0xFF
+    new[176:208] = bytes(rng.getrandbits(8) for _ in range(32))
+    return bytes(new)
+
+
+def test_firmware_id_from_app_descriptor():
+    image = fake_image(1, size=4096, sha=bytes(range(32)))
+    assert firmware_id(image) == "0001020304050607"
+    # Archivos que no son imágenes de ESP-IDF: hash del contenido
+    assert len(firmware_id(b"no es firmware")) == 16
+
+
+def test_delta_round_trip_is_small():
+    old = bytes(fake_image(2))
+    new = rebuild(old, 3)
+    patch = make_patch(old, new)
+
+    assert apply_patch(old, patch) == new
+    assert len(patch) < len(new) // 10
+    header = parse_header(patch)
+    assert (header["old_size"], header["new_size"]) == (len(old), len(new))
+
+    full = make_patch(None, new)
+    assert apply_patch(b"", full) == new
+    assert len(full) > len(new)
+
+
+def test_apply_rejects_wrong_base_and_corruption():
+    old = bytes(fake_image(4, size=130_000))
+    new = rebuild(old, 5)
+    patch = make_patch(old, new)
+
+    other = bytearray(old)
+    other[100] ^= 1
+    with pytest.raises(PatchError):
+        apply_patch(bytes(other), patch)
+    with pytest.raises(PatchError):
+        apply_patch(old, patch[:-1])
+    with pytest.raises(PatchError):
+        apply_patch(old, patch + b"I")
+
+
+def test_repository_caches_patches_and_falls_back_to_full_image(tmp_path):
+    repo = FirmwareRepository(str(tmp_path / "firmware"))
+    old = bytes(fake_image(6))
+    new = rebuild(old, 7)
+    (tmp_path / "old.bin").write_bytes(old)
+    (tmp_path / "new.bin").write_bytes(new)
+    old_id = repo.add_image(str(tmp_path / "old.bin"))
+    new_id = repo.add_image(str(tmp_path / "new.bin"))
+
+    patch_id, size = repo.prepare(old_id, new_id)
+    assert patch_id == f"{old_id}-{new_id}"
+    assert os.path.exists(tmp_path / "firmware" / "deltas" / f"{patch_id}.pkdl")
+    chunks = b"".join(repo.read_chunk(patch_id, offset, 1024) for offset in range(0, size, 1024))
+    assert apply_patch(old, chunks) == new
+
+    # Imagen de origen desconocida: la imagen completa
+    full_id, _ = repo.prepare("ffffffffffffffff", new_id)
+    assert full_id == f"full-{new_id}"
+    assert repo.read_chunk("../../etc/passwd", 0, 10) == b""
+
+
+class FakeOtaDevice:
+    """Dispositivo con OTA: aplica el parche al terminar, como el DeltaPatcher"""
+
+    def __init__(self, port, parking_id, image, window=4, chunk=1024):
+        self.port = port
+        self.parking_id = parking_id
+        self.image = image
+        self.window = window
+        self.chunk = chunk
+        self.offer = None
+        self.received = bytearray()
+        self.updated = None
+        self.stop_after = None   # Cortar la conexión tras recibir tantos bytes
+        self.connect()
+
+    def connect(self):
+        self.socket = socket.create_connection(("127.0.0.1", self.port))
+        self.buffer = b""
+        self.requested = len(self.received)
+        self.send({"hello": True, "parkingId": self.parking_id, "fw": firmware_id(self.image)})
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def send(self, data):
+        self.socket.sendall((json.dumps(data) + "\n").encode("utf-8"))
+
+    def request_more(self):
+        size = self.offer[1]
+        while self.requested < size and self.requested - len(self.received) < self.window * self.chunk:
+            length = min(self.chunk, size - self.requested)
+            self.send({"ota": "get", "parkingId": self.parking_id, "id": self.offer[0],
+                       "offset": self.requested, "length": length})
+            self.requested += length
+
+    def run(self):
+        try:
+            while True:
+                data = self.socket.recv(65536)
+                if not data:
+                    return
+                self.buffer += data
+                while self.process():
+                    pass
+        except OSError:
+            return
+
+    def process(self):
+        newline = self.buffer.find(b"\n")
+        if newline < 0:
+            return False
+        parts = self.buffer[:newline].decode("utf-8").split()
+        if parts[0] == "OTAD":
+            offset, length, patch_id = int(parts[1]), int(parts[2]), parts[3]
+            if len(self.buffer) < newline + 1 + length:
+                return False
+            payload = self.buffer[newline + 1:newline + 1 + length]
+            self.buffer = self.buffer[newline + 1 + length:]
+            if patch_id == self.offer[0] and offset == len(self.received):
+                self.received += payload
+            if self.stop_after is not None and len(self.received) >= self.stop_after:
+                self.stop_after = None
+                self.socket.close()
+                return False
+            if len(self.received) == self.offer[1]:
+                self.updated = apply_patch(self.image, bytes(self.received))
+                self.send({"ota": "done", "parkingId": self.parking_id, "id": self.offer[0]})
+            else:
+                self.request_more()
+            return True
+        self.buffer = self.buffer[newline + 1:]
+        if parts[0] == "OTA":
+            fields = dict(pair.split("=", 1) for pair in parts[2:])
+            offer = (fields["id"], int(fields["size"]))
+            if offer != self.offer:
+                self.offer, self.received = offer, bytearray()
+            self.requested = len(self.received)
+            self.send({"ack": int(parts[1]), "parkingId": self.parking_id, "status": "ok"})
+            self.request_more()
+        return True
+
+    def close(self):
+        self.socket.close()
+
+
+def wait_for(condition, timeout=5.0):
+    deadline = time.time() + timeout
+    while not condition() and time.time() < deadline:
+        time.sleep(0.01)
+    return condition()
+
+
+def test_ota_download_resumes_after_disconnect(server, tmp_path):
+    old = bytes(fake_image(8))
+    new = rebuild(old, 9)
+    os.makedirs("firmware", exist_ok=True)
+    (tmp_path / "firmware" / "running.bin").write_bytes(old)
+    (tmp_path / "firmware" / "release.bin").write_bytes(new)
+    server.resolve_image("running.bin")
+
+    device = FakeOtaDevice(server.port, 11, old, chunk=512)
+    assert wait_for(lambda: 11 in server.devices)
+    device.stop_after = 2048
+
+    admin = socket.create_connection(("127.0.0.1", server.port))
+    admin.sendall(b"COMMAND:OTA 11 release.bin\n")
+    response = json.loads(admin.recv(4096).decode("utf-8"))
+    admin.close()
+    assert response["status"] == "ok"
+    assert response["image"] == firmware_id(new)
+
+    # Se corta a mitad de la descarga y reconecta: continúa donde quedó
+    assert wait_for(lambda: device.stop_after is None)
+    received = len(device.received)
+    device.connect()
+    assert wait_for(lambda: device.updated is not None)
+    assert device.updated == new
+    assert received < server.ota_status()["11"]["size"]
+    assert wait_for(lambda: server.ota_status()["11"]["status"] == "done")
+
+    # Arranca con la imagen nueva
+    device.close()
+    device.image = new
+    device.connect()
+    assert wait_for(lambda: server.ota_status()["11"]["status"] == "updated")
+    device.close()
+
+
+def test_ota_rejects_images_outside_firmware_dir(server, tmp_path):
+    (tmp_path / "secret.bin").write_bytes(b"x" * 100)
+    with pytest.raises(ValueError):
+        server.resolve_image("../secret.bin")
+    assert server.handle_ota_command("3 ../secret.bin")["status"] == "error"
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""
+Pruebas de los informes postmortem en el servidor
+Ejecutar con: pytest test_postmortem_store.py
+
+La trama es la que arma lib/Postmortem (probada en C++ en
+test/native/test_postmortem); acá se prueba cómo se guarda y se confirma.
+"""
+
+import json
+import socket
+
+import pytest
+
+from postmortem_store import PostmortemStore
+
+
+def report(boot, seq, reset="watchdog", events=None):
+    return {"postmortem": True, "parkingId": 3, "boot": boot, "reset": reset, "boots": 1, "seq": seq,
+            "previous": {"reset": "poweron", "uptime": 524828, "heapMin": 150000, "loops": 5230,
+                         "loopMax": 412, "slowLoops": 0, "loopMs": [40, 41]},
+            "events": events if events is not None else [[1, 1, 0, "boot", 1]],
+            "lost": 0, "dropped": 0, "salvaged": False}
+
+
+def test_resend_replaces_and_old_reports_are_trimmed(tmp_path):
+    store = PostmortemStore(str(tmp_path / "pm"), keep=3)
+    assert store.add(3, report(2, 7), received=100.0)
+    # Sin PMK el dispositivo lo reenvía con un evento más: reemplaza
+    assert not store.add(3, report(2, 8, events=[[1, 1, 0, "boot", 1], [7, 2, 5, "tcp_up", 2]]))
+    latest = store.latest(3)
+    assert len(latest) == 1 and latest[0]["seq"] == 8
+
+    for boot in range(3, 10):
+        store.add(3, report(boot, boot * 10, reset="brownout" if boot % 2 else "software"))
+    assert len(store.latest(3, 100)) == 3
+    assert [r["boot"] for r in store.latest(3)] == [9, 8, 7]
+
+    # Se recarga desde el disco al reiniciar el servidor
+    reopened = PostmortemStore(str(tmp_path / "pm"), keep=3)
+    summary = reopened.summary()["3"]
+    assert summary["last_reset"] == "brownout"
+    assert summary["resets"] == {"brownout": 2, "software": 1}
+    assert not reopened.add(3, report(9, 95))
+
+    with pytest.raises(ValueError):
+        store.add("../x", report(1, 1))
+
+
+def test_server_stores_and_acknowledges_report(server, tmp_path):
+    device = socket.create_connection(("127.0.0.1", server.port))
+    device.settimeout(5.0)
+    device.sendall(b'{"hello":true,"parkingId":3}\n')
+    device.sendall((json.dumps(report(4, 21)) + "\n").encode("utf-8"))
+    assert device.recv(64) == b"PMK 21\n"
+    device.close()
+
+    lines = (tmp_path / "postmortems" / "3.jsonl").read_text().splitlines()
+    assert len(lines) == 1
+    stored = json.loads(lines[0])
+    assert stored["previous"]["uptime"] == 524828 and "received" in stored
+
+    admin = socket.create_connection(("127.0.0.1", server.port))
+    admin.sendall(b"COMMAND:POSTMORTEM 3\n")
+    response = json.loads(admin.recv(65536).decode("utf-8"))
+    admin.close()
+    assert response["status"] == "ok"
+    assert response["reports"][0]["reset"] == "watchdog"
+    assert server.get_server_info()["postmortems"]["3"]["reports"] == 1
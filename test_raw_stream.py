@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""
+Pruebas de la serie cruda en el servidor (raw_stream.py)
+Ejecutar con: pytest test_raw_stream.py
+
+El bloque lo arma lib/ParkingSensor/RawStream (probado en C++ en
+test/native/test_raw_stream); acá se prueba que ambos lados coinciden y
+cómo se guarda.
+"""
+
+import base64
+import json
+import socket
+import time
+
+import pytest
+
+from raw_stream import RawHistory, decode_block, encode_block
+
+# RawStream::build() con estas mediciones, como bloque número 1
+READINGS = [(5000, 1823), (6001, 1826), (7000, 1823), (8002, 0), (9001, 350)]
+DEVICE_BLOCK = bytes.fromhex("010100881300000500be1cd20f06030506bd1c05bc05")
+
+
+def test_block_matches_the_device_encoder():
+    assert encode_block(1, READINGS) == DEVICE_BLOCK
+    assert decode_block(DEVICE_BLOCK) == (1, READINGS)
+    # millis() da la vuelta dentro del bloque
+    wrapped = [(0xFFFFFC00 + i * 1000 & 0xFFFFFFFF, 1200 + i % 2) for i in range(5)]
+    assert decode_block(encode_block(9, wrapped)) == (9, wrapped)
+    for broken in (DEVICE_BLOCK[:-1], DEVICE_BLOCK + b"\x00", b"\x02" + DEVICE_BLOCK[1:], b"\x01\x00"):
+        with pytest.raises(ValueError):
+            decode_block(broken)
+
+
+def test_history_estimates_time_and_counts_lost_blocks(tmp_path):
+    history = RawHistory(str(tmp_path / "raw"))
+    assert history.add_block(3, DEVICE_BLOCK, now=1000.0) == 5
+    # La última medición es la de la llegada; las demás, hacia atrás
+    readings = history.read(3)
+    assert readings[-1] == (1000.0, 9001, 35.0)
+    assert readings[0] == (pytest.approx(995.999), 5000, 182.3)
+    assert readings[3][2] is None
+
+    # Bloques 2 y 3 perdidos (sin conexión): el 4 deja el hueco
+    history.add_block(3, encode_block(4, [(20000, 1500)]), now=1011.0)
+    assert len(history.read(3, since=1000.5)) == 1
+    stats = history.stats()
+    assert stats["blocks"] == 2 and stats["readings"] == 6 and stats["failed"] == 1
+    assert stats["lost_blocks"] == 2
+
+    with pytest.raises(ValueError):
+        history.add_line(3, b"RAW no-es-base64!")
+    with pytest.raises(ValueError):
+        history.add_block("../x", DEVICE_BLOCK)
+    assert history.stats()["invalid"] == 1
+
+
+def test_raw_is_much_smaller_than_json():
+    # Una hora a 1 Hz de un espacio libre con ruido de ±3 mm y jitter de 4 ms
+    readings = [(1000 * i + (i * 7) % 5, 1820 + (i * 13) % 7 - 3) for i in range(3600)]
+    raw_bytes = 0
+    for start in range(0, len(readings), 80):
+        block = encode_block(start // 80, readings[start:start + 80])
+        raw_bytes += len(b"RAW " + base64.b64encode(block) + b"\r\n")
+    json_bytes = sum(len(json.dumps({"parkingId": 12, "occupied": False, "distance": mm / 10.0,
+                                     "timestamp": ms}, separators=(",", ":"))) + 2
+                     for ms, mm in readings)
+    assert raw_bytes / len(readings) < 3.2
+    assert json_bytes / raw_bytes > 20
+
+
+def test_server_stores_raw_blocks(server, tmp_path):
+    device = socket.create_connection(("127.0.0.1", server.port))
+    # Antes del hello no se sabe de quién es: se ignora
+    device.sendall(b"RAW " + base64.b64encode(DEVICE_BLOCK) + b"\r\n")
+    device.sendall(b'{"hello":true,"parkingId":8}\n')
+    device.sendall(b"RAW " + base64.b64encode(DEVICE_BLOCK) + b"\r\n")
+    device.sendall(b"RAW " + base64.b64encode(encode_block(2, READINGS[:2])) + b"\r\n")
+    deadline = time.time() + 5.0
+    while server.raw_history.stats()["blocks"] < 2 and time.time() < deadline:
+        time.sleep(0.01)
+    device.close()
+
+    lines = (tmp_path / "raw_history" / "8.csv").read_text().splitlines()
+    assert len(lines) == 7
+    assert lines[3].endswith(",8002,") and lines[4].endswith(",9001,35.0")
+    info = server.get_server_info()["raw"]
+    assert info["readings"] == 7 and info["devices"] == 1 and info["bytes_per_reading"] < 10
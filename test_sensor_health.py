@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Pruebas de las alertas de salud de los sensores en el servidor
+Ejecutar con: pytest test_sensor_health.py
+
+La clasificación la hace el dispositivo (lib/ParkingSensor/SensorHealth,
+probada con trazas sintéticas en test/native/test_sensor_health); acá se
+prueba cómo llegan los reportes y cuándo se abre y se cierra cada alerta.
+"""
+
+import json
+import socket
+import struct
+import time
+
+import pytest
+
+from sensor_health import HealthMonitor, describe_health
+
+FRAME = struct.Struct("<BBHHHIIII")
+
+
+def test_monitor_opens_and_closes_alerts():
+    now = [1000.0]
+    monitor = HealthMonitor(clock=lambda: now[0])
+    # Calentando o en buen estado desde el principio: nada que avisar
+    assert monitor.update(3, "unknown") is None
+    assert monitor.update(3, 1) is None
+    assert monitor.update(3, "9") is None      # Código desconocido
+
+    alert = monitor.update(3, "blocked", {"timeouts": 0.02, "invalid": 0.81, "sd": 0.3, "other": 1})
+    assert alert == {"parkingId": 3, "health": "blocked", "previous": "ok", "time": 1000.0,
+                     "timeouts": 0.02, "invalid": 0.81, "sd": 0.3}
+    assert "tapado" in describe_health(alert) and "inválidas 81%" in describe_health(alert)
+    # El mismo estado por heartbeat no repite la alerta
+    assert monitor.update(3, "4") is None
+    assert monitor.update(7, "6")["previous"] == "ok"
+    assert set(monitor.alerts()) == {"3", "7"}
+
+    now[0] = 1600.0
+    closed = monitor.update(3, "ok")
+    assert closed["previous"] == "blocked" and "recuperado" in describe_health(closed)
+    assert monitor.summary() == {"devices": 2, "states": {"ok": 1, "failing": 1}, "active": 1,
+                                 "alerts": 2}
+    assert [entry["health"] for entry in monitor.recent(parking_id=3)] == ["blocked", "ok"]
+
+
+@pytest.fixture
+def server(start_server):
+    return start_server(udp_port=0)
+
+
+def wait_for(condition):
+    deadline = time.time() + 5.0
+    while not condition() and time.time() < deadline:
+        time.sleep(0.01)
+    return condition()
+
+
+def test_reports_from_every_transport(server):
+    # Conexión directa: la línea de cambio y el código en el heartbeat
+    device = socket.create_connection(("127.0.0.1", server.port))
+    device.sendall(b'{"hello":true,"parkingId":8,"hb":30000}\n')
+    device.sendall(b'{"health":"misaligned","parkingId":8,"timeouts":0.010,"invalid":0.310,'
+                   b'"near":0.000,"far":0.310,"jumps":0.280,"sd":9.40,"stuck":1}\n')
+    assert wait_for(lambda: server.health.device(8) is not None)
+    assert server.health.device(8)["stats"]["far"] == 0.31
+    device.sendall(b"HB 12 0 181.0 900 40 1\r\n")
+    assert wait_for(lambda: server.health.device(8)["health"] == "ok")
+    # Heartbeat de firmware anterior, sin salud: se aplica igual
+    device.sendall(b"HB 13 0 181.0 901 40\r\n")
+    assert wait_for(lambda: server.occupancy.get(8).seq == 13)
+
+    # Gateway: noveno campo de cada trama; lotes sin él siguen valiendo
+    gateway = socket.create_connection(("127.0.0.1", server.port))
+    gateway.settimeout(5.0)
+    gateway.sendall(b'{"hello":true,"gateway":2,"hb":30000}\n')
+    frames = [[21, 1, 2, 0, 2.1, 5000, 10, 0, 4], [22, 1, 2, 0, 180.0, 5000, 10, 0]]
+    line = {"gateway": 2, "epoch": 1, "batch": 1, "frames": frames}
+    gateway.sendall((json.dumps(line) + "\r\n").encode("utf-8"))
+    assert gateway.recv(64) == b"GWK 1\n"
+    assert server.health.device(21)["health"] == "blocked"
+    assert server.health.device(22) is None and server.occupancy.get(22).seq == 1
+
+    # UDP: bits 4-6 del byte de tipo
+    udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    udp.settimeout(5.0)
+    udp.connect(("127.0.0.1", server.udp_port))
+    udp.send(FRAME.pack(0x4C, 2 | 6 << 4 | 0x80, 31, 0x1234, 250, 1, 9000, 40, 2))
+    udp.recv(64)
+    assert server.health.device(31)["health"] == "failing"
+    assert server.occupancy.get(31).occupied
+
+    admin = socket.create_connection(("127.0.0.1", server.port))
+    admin.settimeout(5.0)
+    admin.sendall(b"COMMAND:HEALTH\n")
+    response = json.loads(admin.recv(4096))
+    assert set(response["alerts"]) == {"21", "31"}
+    assert [entry["health"] for entry in response["recent"]] == ["misaligned", "ok", "blocked", "failing"]
+    admin.sendall(b"COMMAND:HEALTH 8\n")
+    response = json.loads(admin.recv(4096))
+    assert response["health"]["health"] == "ok" and len(response["recent"]) == 2
+    assert server.get_server_info()["health"]["active"] == 2
+    for sock in (device, gateway, udp, admin):
+        sock.close()
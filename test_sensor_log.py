@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+Pruebas del log de eventos con rotación y compresión
+Ejecutar con: pytest test_sensor_log.py
+"""
+
+import gzip
+import json
+import os
+import time
+
+from sensor_log import SensorLog, compress_segment, list_segments, load_index, read_lines
+
+BASE = time.mktime((2025, 9, 5, 11, 0, 0, 0, 0, -1))
+
+
+def event(parking_id, occupied, n):
+    return {"parkingId": parking_id, "occupied": occupied, "distance": 20.0 + n, "timestamp": n}
+
+
+class FakeClock:
+    def __init__(self, now=BASE):
+        self.now = now
+
+    def __call__(self):
+        return self.now
+
+
+def test_writes_keep_legacy_line_format(tmp_path):
+    path = str(tmp_path / "parking_sensor.log")
+    log = SensorLog(path, clock=FakeClock())
+    log.write(("10.0.0.5", 50000), event(1, True, 0))
+    log.close()
+
+    with open(path, "r", encoding="utf-8") as f:
+        line = f.read()
+    assert line == ("2025-09-05 11:00:00 | ('10.0.0.5', 50000) | "
+                    '{"parkingId": 1, "occupied": true, "distance": 20.0, "timestamp": 0}\n')
+
+
+def test_rotation_compresses_segments_and_reads_back_in_order(tmp_path):
+    path = str(tmp_path / "parking_sensor.log")
+    clock = FakeClock()
+    log = SensorLog(path, max_bytes=4096, block_bytes=1024, flush_bytes=512, clock=clock)
+    for n in range(300):
+        clock.now = BASE + n
+        log.write(("10.0.0.5", 50000), event(n % 4, n % 2 == 0, n))
+    log.close()
+
+    segments = list_segments(path)
+    assert len(segments) >= 5
+    for seq, raw, compressed in segments:
+        assert raw is None and compressed.endswith(".gz")
+        index = load_index(compressed)
+        assert index["codec"] == "gzip" and index["lines"] > 0
+        assert len(index["blocks"]) >= 2
+        assert index["parking_ids"] == [0, 1, 2, 3]
+        # Cada bloque es un miembro gzip independiente: el archivo completo se lee con gzip
+        with gzip.open(compressed, "rb") as f:
+            assert f.read().count(b"\n") == index["lines"]
+
+    lines = list(read_lines(path))
+    assert len(lines) == 300
+    assert [json.loads(line.split(b" | ", 2)[2])["timestamp"] for line in lines] == list(range(300))
+
+
+def test_time_and_spot_filters_use_the_index(tmp_path):
+    path = str(tmp_path / "parking_sensor.log")
+    clock = FakeClock()
+    log = SensorLog(path, max_bytes=4096, block_bytes=512, clock=clock)
+    for n in range(600):
+        clock.now = BASE + n
+        log.write(("10.0.0.5", 50000), event(7 if n >= 500 else 1, True, n))
+    log.close()
+
+    # 11:05:00 a 11:06:00 → eventos 300..359
+    selected = list(read_lines(path, since="2025-09-05 11:05:00", until="2025-09-05 11:06:00"))
+    assert [json.loads(line.split(b" | ", 2)[2])["timestamp"] for line in selected] == list(range(300, 360))
+
+    assert len(list(read_lines(path, parking_id=7))) == 100
+    assert list(read_lines(path, since="2025-09-06")) == []
+
+
+def test_age_rotation_and_restart_recovers_pending_segment(tmp_path):
+    path = str(tmp_path / "parking_sensor.log")
+    clock = FakeClock()
+    log = SensorLog(path, max_age=60.0, clock=clock)
+    log.write(("10.0.0.5", 50000), event(1, True, 0))
+    clock.now = BASE + 61
+    log.write(("10.0.0.5", 50000), event(1, False, 1))
+    log.close()
+    assert [entry[0] for entry in list_segments(path)] == [1]
+
+    # Segmento rotado que no llegó a comprimirse (servidor detenido a mitad)
+    os.rename(path, path + ".000002")
+    log = SensorLog(path, clock=clock)
+    log.write(("10.0.0.5", 50000), event(1, True, 2))
+    log.close()
+
+    segments = list_segments(path)
+    assert [(seq, raw) for seq, raw, _ in segments] == [(1, None), (2, None)]
+    assert [json.loads(line.split(b" | ", 2)[2])["timestamp"] for line in read_lines(path)] == [0, 1, 2]
+
+
+def test_interrupted_compression_keeps_the_plain_segment(tmp_path):
+    path = str(tmp_path / "parking_sensor.log")
+    segment = path + ".000001"
+    with open(segment, "w", encoding="utf-8") as f:
+        f.write("2025-09-05 11:00:00 | x | {\"parkingId\": 2}\n")
+    compressed = compress_segment(segment)
+    # Como si el proceso muriera antes de borrar el original
+    with open(segment, "w", encoding="utf-8") as f:
+        f.write("2025-09-05 11:00:00 | x | {\"parkingId\": 2}\n")
+    assert os.path.exists(compressed)
+
+    assert len(list(read_lines(path))) == 1
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Pruebas de la ingesta repartida en varios procesos (sharded_ingest.py)
+Ejecutar con: pytest test_sharded_ingest.py
+
+El reparto de conexiones lo hace el kernel (SO_REUSEPORT); acá se prueba
+que cada espacio termina en su worker, que la vista global coincide con la
+de un solo proceso y que el anillo mueve pocos espacios al crecer.
+"""
+
+import json
+import os
+import signal
+import socket
+import subprocess
+import sys
+import time
+import urllib.request
+
+import pytest
+
+from occupancy_analytics import OccupancyAnalytics
+from parking_server import UDP_ACK, UDP_FRAME, UDP_FRAME_MAGIC
+from sharded_ingest import ShardedIngest, ShardRing, message_parking_id
+
+
+def test_ring_balances_and_moves_few_spots():
+    ids = range(1, 20001)
+    four = ShardRing(4)
+    owners = [four.owner(pid) for pid in ids]
+    for shard in range(4):
+        assert abs(owners.count(shard) - 5000) < 5000 * 0.25
+
+    # Un worker más: solo ~1/5 cambia de dueño, y todos hacia el nuevo
+    five = ShardRing(5)
+    moved = [pid for pid, owner in zip(ids, owners) if five.owner(pid) != owner]
+    assert 0.12 < len(moved) / len(ids) < 0.28
+    assert all(five.owner(pid) == 4 for pid in moved)
+    assert four.owner(7) == four.owner("7")
+
+
+def test_message_parking_id():
+    assert message_parking_id(b'{"hello":true,"parkingId":12,"hb":30000}') == 12
+    assert message_parking_id(b'{"parkingId":5,"occupied":true}') == 5
+    assert message_parking_id(b"COMMAND:CONFIG 9 threshold=40") == "9"
+    assert message_parking_id(b"COMMAND:CONFIG * threshold=40") is None
+    assert message_parking_id(b"COMMAND:STATUS") is None
+    assert message_parking_id(b'{"hello":true,"gateway":2,"parkingId":3}') is None
+    assert message_parking_id(b"IMAGE:/9j/4AAQ") is None
+
+
+def test_merged_analytics_match_a_single_server():
+    ring = ShardRing(3)
+    single = OccupancyAnalytics(utc_offset=0)
+    shards = [OccupancyAnalytics(utc_offset=0) for _ in range(3)]
+    start = 1757000000.0
+    for step in range(600):
+        parking_id = step % 17 + 1
+        when = start + step * 37.0
+        occupied = (step // 17) % 2 == 0
+        single.record(parking_id, occupied, when, timestamp=step * 1000)
+        shards[ring.owner(parking_id)].record(parking_id, occupied, when, timestamp=step * 1000)
+
+    merged = OccupancyAnalytics.merged([json.loads(json.dumps(shard.state())) for shard in shards])
+    now = start + 600 * 37.0
+    assert merged.summary(now) == single.summary(now)
+    assert merged.hourly(start, now, now) == single.hourly(start, now, now)
+    assert merged.daily(start, now, now) == single.daily(start, now, now)
+    assert merged.spot(5, now) == single.spot(5, now)
+
+
+@pytest.fixture
+def ingest(tmp_path, monkeypatch):
+    monkeypatch.chdir(tmp_path)
+    cluster = ShardedIngest(3, "127.0.0.1", 0, http_port=0, udp_port=0, quiet=True, ack_events=True,
+                            analytics_path=None)
+    cluster.start()
+    yield cluster
+    cluster.stop()
+
+
+def http_json(cluster, path):
+    with urllib.request.urlopen(f"http://127.0.0.1:{cluster.http_port}{path}", timeout=5) as response:
+        return json.loads(response.read())
+
+
+def test_connections_end_in_their_worker_and_global_view_merges(ingest):
+    sensors = []
+    for parking_id in range(1, 13):
+        sensor = socket.create_connection(("127.0.0.1", ingest.port))
+        sensor.settimeout(5.0)
+        sensor.sendall(f'{{"hello":true,"parkingId":{parking_id},"hb":30000}}\n'.encode())
+        event = {"parkingId": parking_id, "occupied": parking_id % 3 == 0, "distance": 25.0,
+                 "timestamp": 1000 + parking_id, "seq": 1}
+        sensor.sendall((json.dumps(event) + "\n").encode())
+        assert sensor.recv(64) == f"EVT {1000 + parking_id}\n".encode()
+        sensors.append(sensor)
+
+    # Cada espacio está solo en el worker que indica el anillo
+    for worker in ingest.workers:
+        spots = worker.request("spots")
+        assert spots and all(ingest.ring.owner(spot["parkingId"]) == worker.shard for spot in spots)
+
+    view = http_json(ingest, "/spots")
+    assert view["counts"] == {"total": 12, "free": 8, "occupied": 4, "stale": 0}
+    assert sorted(spot["parkingId"] for spot in view["spots"]) == list(range(1, 13))
+    assert http_json(ingest, "/spots/free")["free"] == [1, 2, 4, 5, 7, 8, 10, 11]
+    assert http_json(ingest, "/spots/9")["occupied"] is True
+    assert http_json(ingest, "/analytics")["events"] == 12
+
+    # Un cambio en un worker llega al registro global de cambios
+    seq = ingest.occupancy.diffs.last_seq
+    sensors[0].sendall(b'{"parkingId":1,"occupied":true,"distance":20.0,"timestamp":5000,"seq":2}\n')
+    assert sensors[0].recv(64) == b"EVT 5000\n"
+    deadline = time.time() + 2.0
+    while ingest.occupancy.diffs.last_seq == seq and time.time() < deadline:
+        time.sleep(0.01)
+    entries, _ = ingest.occupancy.diffs.read(seq, 0)
+    assert json.loads(entries[-1][1])["parkingId"] == 1
+    for sensor in sensors:
+        sensor.close()
+
+
+def test_udp_frames_reach_their_owner(ingest):
+    udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    udp.settimeout(5.0)
+    for parking_id in range(40, 46):
+        frame = UDP_FRAME.pack(UDP_FRAME_MAGIC, 1 | 0x80, parking_id, 3, 254, 1, 9000, 10, 0)
+        udp.sendto(frame, ("127.0.0.1", ingest.udp_port))
+        ack = UDP_ACK.unpack(udp.recv(64))
+        assert ack[2] == parking_id and ack[5] == 1
+    udp.close()
+    assert http_json(ingest, "/spots")["counts"]["occupied"] == 6
+
+
+COORDINATOR = """
+import json, os, time
+from sharded_ingest import ShardedIngest
+cluster = ShardedIngest(2, "127.0.0.1", 0, quiet=True, analytics_path=None)
+cluster.start()
+with open("pids.tmp", "w") as f:
+    json.dump([cluster.port] + [worker.process.pid for worker in cluster.workers], f)
+os.replace("pids.tmp", "pids.json")
+time.sleep(60)
+"""
+
+
+def alive(pid):
+    try:
+        with open(f"/proc/{pid}/stat") as stat:
+            return stat.read().rpartition(")")[2].split()[0] != "Z"
+    except OSError:
+        return False
+
+
+@pytest.mark.skipif(not sys.platform.startswith("linux"), reason="/proc y PR_SET_PDEATHSIG")
+def test_workers_exit_when_the_coordinator_is_killed(tmp_path):
+    # Sin stop(): los workers no pueden quedar escuchando el puerto compartido.
+    # Los pids van por archivo: la salida de los workers se mezcla con la suya
+    source = os.path.dirname(os.path.abspath(__file__))
+    coordinator = subprocess.Popen([sys.executable, "-c", COORDINATOR], cwd=tmp_path,
+                                   env=dict(os.environ, PYTHONPATH=source),
+                                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    pids = tmp_path / "pids.json"
+    deadline = time.time() + 20.0
+    while not pids.exists() and coordinator.poll() is None and time.time() < deadline:
+        time.sleep(0.05)
+    assert pids.exists(), "el coordinador no arrancó"
+    port, *workers = json.loads(pids.read_text())
+    os.kill(coordinator.pid, signal.SIGKILL)
+    coordinator.wait()
+
+    deadline = time.time() + 10.0
+    while any(alive(pid) for pid in workers) and time.time() < deadline:
+        time.sleep(0.05)
+    assert not any(alive(pid) for pid in workers)
+    with pytest.raises(OSError):
+        socket.create_connection(("127.0.0.1", port), timeout=1.0).close()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Pruebas del transporte TLS del servidor (--tls-cert/--tls-key)
+Ejecutar con: pytest test_tls_transport.py
+
+El certificado de prueba se genera con el comando openssl del sistema,
+igual que en README_SERVER.md.
+"""
+
+import json
+import shutil
+import socket
+import ssl
+import subprocess
+import threading
+import time
+
+import pytest
+
+from parking_server import make_tls_context
+
+
+@pytest.fixture(scope="module")
+def certificate(tmp_path_factory):
+    if shutil.which("openssl") is None:
+        pytest.skip("openssl no disponible")
+    directory = tmp_path_factory.mktemp("tls")
+    cert, key = directory / "server.crt", directory / "server.key"
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:prime256v1",
+                    "-nodes", "-keyout", str(key), "-out", str(cert), "-days", "1",
+                    "-subj", "/CN=127.0.0.1", "-addext", "subjectAltName=IP:127.0.0.1"],
+                   check=True, capture_output=True)
+    return str(cert), str(key)
+
+
+@pytest.fixture
+def server(start_server, certificate):
+    return start_server(tls_context=make_tls_context(*certificate))
+
+
+def client_context(certificate):
+    """Lo mismo que negocia el ESP32: TLS 1.2 verificando el certificado"""
+    context = ssl.create_default_context(cafile=certificate[0])
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    return context
+
+
+def connect(server, context, session=None):
+    raw = socket.create_connection(("127.0.0.1", server.port))
+    return context.wrap_socket(raw, server_hostname="127.0.0.1", session=session)
+
+
+def send(sock, data):
+    sock.sendall((json.dumps(data) + "\n").encode("utf-8"))
+
+
+def wait_for(condition, timeout=2.0):
+    deadline = time.time() + timeout
+    while not condition() and time.time() < deadline:
+        time.sleep(0.01)
+    return condition()
+
+
+def test_reconnect_resumes_session(server, certificate):
+    context = client_context(certificate)
+
+    first = connect(server, context)
+    assert not first.session_reused
+    send(first, {"hello": True, "parkingId": 3})
+    send(first, {"parkingId": 3, "occupied": True, "distance": 20.0, "timestamp": 1000})
+    assert wait_for(lambda: server.occupancy.get(3) is not None)
+    session = first.session
+    first.close()
+
+    second = connect(server, context, session=session)
+    assert second.session_reused
+    send(second, {"parkingId": 3, "occupied": False, "distance": 90.0, "timestamp": 2000})
+    assert wait_for(lambda: server.occupancy.get(3).occupied is False)
+    second.close()
+
+    assert wait_for(lambda: server.tls_info() == {"full": 1, "resumed": 1, "failed": 0})
+
+
+def test_config_push_while_device_reads(server, certificate):
+    device = connect(server, client_context(certificate))
+    send(device, {"hello": True, "parkingId": 5})
+    assert wait_for(lambda: 5 in server.devices)
+
+    # El dispositivo responde desde su hilo mientras el servidor lee y escribe
+    def respond():
+        frame = device.recv(4096).decode("utf-8").split()
+        send(device, {"ack": int(frame[1]), "parkingId": 5, "status": "ok"})
+
+    threading.Thread(target=respond, daemon=True).start()
+    result = server.push_config(5, {"threshold": 40})
+    assert result["status"] == "ok"
+    device.close()
+
+
+def test_plain_tcp_client_is_rejected(server):
+    plain = socket.create_connection(("127.0.0.1", server.port))
+    plain.sendall(b'{"parkingId": 9, "occupied": true, "distance": 10.0, "timestamp": 1}\n')
+    plain.settimeout(2.0)
+    try:
+        plain.recv(4096)
+    except OSError:
+        pass
+    plain.close()
+
+    assert wait_for(lambda: server.tls_info()["failed"] == 1)
+    assert server.occupancy.get(9) is None
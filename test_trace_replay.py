@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+"""
+Pruebas del lado del servidor de la reproducción de trazas
+Ejecutar con: pytest test_trace_replay.py
+"""
+
+from trace_replay import Event, diff_changes, read_trace, server_changes, write_trace
+
+
+def test_trace_round_trip_and_spot_filter(tmp_path):
+    path = tmp_path / "eventos.trace"
+    events = [Event(100, 5000, 1, 60.0, False), Event(101, 7000, 2, 14.3, True), Event(130, 9000, 1, 20.5, True)]
+    write_trace(path, events)
+
+    assert read_trace(path) == events
+    assert read_trace(path, {1}) == [events[0], events[2]]
+
+
+def test_server_changes_include_stale_at_expiry_time():
+    events = [Event(0, 1, 1, 60.0, False), Event(10, 2, 1, 20.0, True), Event(500, 3, 2, 80.0, False)]
+    changes = server_changes(events, stale_after=300, end=1000)
+    assert changes == [(1, 0, False, False), (1, 10, True, False),
+                       (1, 310, True, True), (2, 500, False, False), (2, 800, False, True)]
+
+
+def test_dropped_event_shows_as_server_diff():
+    baseline = [Event(0, 1, 1, 60.0, False), Event(10, 2, 1, 45.0, True), Event(20, 3, 1, 70.0, False)]
+    replayed = [baseline[0]]   # Un umbral más bajo no detecta la ocupación de 45 cm
+    missing, extra = diff_changes(server_changes(baseline, 900, 30), server_changes(replayed, 900, 30))
+    assert missing == [(1, 10, True, False), (1, 20, False, False)]
+    assert extra == []
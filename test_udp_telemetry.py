@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+Pruebas de la telemetría UDP en el servidor
+Ejecutar con: pytest test_udp_telemetry.py
+
+Las tramas y retransmisiones las arma lib/UdpTelemetry (probado en C++ en
+test/native/test_udp_telemetry); acá se prueba cómo se aplican y confirman.
+"""
+
+import socket
+import struct
+
+import pytest
+
+
+FRAME = struct.Struct("<BBHHHIIII")
+ACK = struct.Struct("<BBHHHII")
+
+
+def frame(parking_id, seq, occupied, kind=1, epoch=0x1234, distance=25.3, ms=90000):
+    flags = kind | (0x80 if occupied else 0)
+    return FRAME.pack(0x4C, flags, parking_id, epoch, int(distance * 10), seq, ms, 40, 2)
+
+
+@pytest.fixture
+def server(start_server):
+    return start_server(udp_port=0)
+
+
+@pytest.fixture
+def device(server):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(5.0)
+    sock.connect(("127.0.0.1", server.udp_port))
+    yield sock
+    sock.close()
+
+
+def exchange(device, datagram):
+    device.send(datagram)
+    magic, _, parking_id, epoch, _, seq, bitmap = ACK.unpack(device.recv(64))
+    assert magic == 0x4B
+    return parking_id, epoch, seq, bitmap
+
+
+def test_frame_is_applied_and_acknowledged(server, device):
+    assert exchange(device, frame(11, 1, True)) == (11, 0x1234, 1, 0)
+    spot = server.occupancy.get(11)
+    assert spot.occupied and spot.seq == 1 and spot.distance == pytest.approx(25.3)
+
+    assert exchange(device, frame(11, 2, True, kind=2)) == (11, 0x1234, 2, 0x1)
+    assert server.heartbeats_received == 1
+    assert server.occupancy.get(11).measurements == 40
+
+    device.send(b"no es una trama")
+    assert exchange(device, frame(11, 3, False)) == (11, 0x1234, 3, 0x3)
+    assert not server.occupancy.get(11).occupied
+    info = server.get_server_info()["udp"]
+    assert info["frames"] == 3 and info["invalid"] == 1 and info["devices"] == 1
+
+
+def test_repeated_frame_is_acknowledged_but_not_reapplied(server, device):
+    exchange(device, frame(11, 1, True))
+    exchange(device, frame(11, 2, False))
+    # La confirmación de 1 se perdió: la retransmisión no vuelve a ocupar el espacio
+    assert exchange(device, frame(11, 1, True)) == (11, 0x1234, 2, 0x1)
+    assert not server.occupancy.get(11).occupied
+    assert server.udp_info()["duplicates"] == 1
+
+    # Otro epoch: el sensor se reinició y su seq vuelve a empezar
+    assert exchange(device, frame(11, 1, True, epoch=0x9999)) == (11, 0x9999, 1, 0)
+    assert server.occupancy.get(11).occupied
+
+
+def test_selective_ack_covers_gaps_and_late_frames(server, device):
+    exchange(device, frame(11, 1, True))
+    # 2 y 3 perdidas: el mapa de 5 solo marca 1 (bit 3)
+    assert exchange(device, frame(11, 5, True, kind=2)) == (11, 0x1234, 5, 0x8)
+    assert server.occupancy.get(11).lost == 3
+
+    # La retransmisión de 3 llega tarde: se confirma sin pisar el estado más nuevo
+    assert exchange(device, frame(11, 3, False)) == (11, 0x1234, 5, 0xA)
+    assert server.occupancy.get(11).occupied and server.occupancy.get(11).seq == 5
+    assert server.udp_info()["late"] == 1
+
+
+def test_sequence_wraparound_keeps_acknowledging(server, device):
+    exchange(device, frame(11, 0xFFFFFFFE, True))
+    # Después de la vuelta el seq 0 y el 1 son más nuevos que 0xFFFFFFFE
+    assert exchange(device, frame(11, 0, False)) == (11, 0x1234, 0, 0x2)
+    assert not server.occupancy.get(11).occupied
+    assert exchange(device, frame(11, 1, True)) == (11, 0x1234, 1, 0x5)
+    # La retransmisión de 0xFFFFFFFF llega tarde: se marca en el mapa
+    assert exchange(device, frame(11, 0xFFFFFFFF, False)) == (11, 0x1234, 1, 0x7)
+    assert server.occupancy.get(11).occupied
+    assert server.udp_info()["late"] == 1
@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""
+Reproducción de parking_sensor.log contra el firmware y el servidor actuales
+
+Convierte el log del servidor a una traza binaria (env trace_replay), la pasa
+por la lógica de decisión del ParkingSensor compilada para el host y compara
+los eventos que enviaría el firmware actual con los registrados. Luego pasa
+ambos flujos de eventos por la tabla de ocupación del servidor
+(occupancy_state.OccupancyTable, con el reloj de la traza en vez del real) y
+compara los cambios que vería un suscriptor de /events.
+
+La tabla del servidor trata cada espacio por separado, así que solo los
+espacios cuyos eventos difieren pueden publicar cambios distintos: solo esos
+pasan por el lado del servidor y el resto se cuenta como idéntico. Una
+regresión sin diferencias corre a la velocidad del binario nativo (millones
+de eventos por segundo).
+
+Sirve como prueba de regresión de filtros y protocolo: un cambio que no
+altera el comportamiento termina sin diferencias (código de salida 0).
+
+Uso:
+    pio run -e trace_replay
+    python trace_replay.py parking_sensor.log
+    python trace_replay.py parking_sensor.log --threshold 40 --stale-after 600
+
+Si el log tiene segmentos rotados y comprimidos (parking_sensor.log.000001.gz,
+ver sensor_log.py) se reproducen todos en orden, seguidos del archivo activo.
+"""
+
+import argparse
+import collections
+import json
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+from datetime import datetime, timezone
+
+from occupancy_state import OccupancyTable
+from sensor_log import list_segments, read_lines
+
+DEFAULT_BINARY = os.path.join(".pio", "build", "trace_replay", "program")
+
+# Formato de lib/EventTrace/EventTrace.h (little-endian)
+TRACE_HEADER = struct.Struct("<4sIQ")
+TRACE_RECORD = struct.Struct("<IIHHB3x")
+TRACE_MAGIC = b"PKTR"
+TRACE_VERSION = 1
+TRACE_OCCUPIED = 0x01
+
+Event = collections.namedtuple("Event", "wall timestamp parking_id distance occupied")
+
+
+def read_trace(path, spots=None):
+    """Eventos de una traza binaria (solo de los parkingId en spots, si se indica)"""
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, count = TRACE_HEADER.unpack_from(data)
+    if magic != TRACE_MAGIC or version != TRACE_VERSION:
+        raise ValueError(f"{path} no es una traza válida")
+    body = memoryview(data)[TRACE_HEADER.size:TRACE_HEADER.size + count * TRACE_RECORD.size]
+    return [Event(wall, timestamp, parking_id, distance / 10.0, bool(flags & TRACE_OCCUPIED))
+            for wall, timestamp, parking_id, distance, flags in TRACE_RECORD.iter_unpack(body)
+            if spots is None or parking_id in spots]
+
+
+def write_trace(path, events):
+    """Escribir eventos en el formato de la traza (pruebas y trazas sintéticas)"""
+    with open(path, "wb") as f:
+        f.write(TRACE_HEADER.pack(TRACE_MAGIC, TRACE_VERSION, len(events)))
+        for event in events:
+            f.write(TRACE_RECORD.pack(event.wall, event.timestamp, event.parking_id,
+                                      min(0xFFFF, int(event.distance * 10 + 0.5)),
+                                      TRACE_OCCUPIED if event.occupied else 0))
+
+
+class ReplayTable(OccupancyTable):
+    """OccupancyTable que registra cada cambio publicado con la hora de la traza"""
+
+    def __init__(self, stale_after):
+        super().__init__(stale_after=stale_after, history=1)
+        self.now = 0
+        self.changes = []
+
+    def publish(self, spot):
+        # Sin codificar JSON: solo interesa qué cambió y cuándo. Un espacio
+        # vence en last_seen + límite, no cuando llega el siguiente evento
+        # de la traza: así el resultado no depende de los otros espacios.
+        when = self.now
+        if spot.stale:
+            when = spot.last_seen + self.timeouts.get(spot.parking_id, self.stale_after)
+        self.changes.append((spot.parking_id, when, spot.occupied, spot.stale))
+        return len(self.changes)
+
+
+def server_changes(events, stale_after=900.0, end=None):
+    """Cambios que publicaría el servidor al recibir los eventos en orden
+
+    end: hora final de la traza, para vencer los espacios que quedaron sin noticias.
+    """
+    table = ReplayTable(stale_after)
+    for event in events:
+        if event.wall != table.now:
+            table.now = event.wall
+            table.expire(now=event.wall)
+        table.update(event.parking_id, event.occupied, event.distance, event.timestamp, now=event.wall)
+    if end is not None:
+        table.expire(now=end)
+    return table.changes
+
+
+def diff_changes(baseline, replayed):
+    """(solo en la referencia, solo en la reproducción), en orden"""
+    missing = collections.Counter(baseline) - collections.Counter(replayed)
+    extra = collections.Counter(replayed) - collections.Counter(baseline)
+
+    def ordered(changes, counter):
+        result = []
+        for change in changes:
+            if counter[change] > 0:
+                counter[change] -= 1
+                result.append(change)
+        return result
+
+    return ordered(baseline, missing), ordered(replayed, extra)
+
+
+def run_native(binary, *args):
+    result = subprocess.run([binary] + list(args), stdout=subprocess.PIPE, text=True)
+    if result.returncode not in (0, 2):
+        raise RuntimeError(f"{os.path.basename(binary)} {args[0]} terminó con código {result.returncode}")
+    return json.loads(result.stdout)
+
+
+def describe(change):
+    parking_id, wall, occupied, stale = change
+    state = "STALE" if stale else ("OCUPADO" if occupied else "LIBRE")
+    when = datetime.fromtimestamp(wall, timezone.utc).strftime("%Y-%m-%d %H:%M:%S")
+    return f"parqueo {parking_id} {when} {state}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Reproducir parking_sensor.log y comparar eventos")
+    parser.add_argument("log", nargs="?", default="parking_sensor.log")
+    parser.add_argument("--binary", default=DEFAULT_BINARY, help="Ejecutable del env trace_replay")
+    parser.add_argument("--threshold", type=float, default=50.0, help="Umbral de ocupación a probar (cm)")
+    parser.add_argument("--stale-after", type=float, default=900.0, help="Igual que parking_server.py")
+    parser.add_argument("--repeat", type=int, default=1, help="Repeticiones para medir rendimiento")
+    parser.add_argument("--workdir", default=None, help="Dónde dejar las trazas (temporal por defecto)")
+    parser.add_argument("--output", default="replay_report.json", help="Archivo del informe JSON")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.binary):
+        print(f"❌ No existe {args.binary}; compila con: pio run -e trace_replay")
+        return 1
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="trace_replay_")
+    os.makedirs(workdir, exist_ok=True)
+    baseline_path = os.path.join(workdir, "baseline.trace")
+    replayed_path = os.path.join(workdir, "replayed.trace")
+
+    # Con segmentos rotados (sensor_log.py) se reproduce el historial completo
+    log_path = args.log
+    if list_segments(os.path.abspath(args.log)):
+        log_path = os.path.join(workdir, "merged.log")
+        with open(log_path, "wb") as merged:
+            for line in read_lines(args.log):
+                merged.write(line)
+
+    conversion = run_native(args.binary, "convert", log_path, baseline_path)
+    firmware = run_native(args.binary, "replay", baseline_path, "--threshold", str(args.threshold),
+                          "--repeat", str(args.repeat), "--events", replayed_path)
+
+    # Solo los espacios con eventos distintos pueden cambiar lo que publica el servidor
+    spots = set(firmware["affected_spots"])
+    baseline, replayed = [], []
+    if spots:
+        end = firmware["last_wall"]
+        baseline = server_changes(read_trace(baseline_path, spots), args.stale_after, end)
+        replayed = server_changes(read_trace(replayed_path, spots), args.stale_after, end)
+    missing, extra = diff_changes(baseline, replayed)
+
+    report = {
+        "log": args.log,
+        "conversion": conversion,
+        "firmware": firmware,
+        "server": {"compared_spots": len(spots),
+                   "baseline_changes": len(baseline), "replayed_changes": len(replayed),
+                   "missing": len(missing), "extra": len(extra),
+                   "first_missing": [describe(c) for c in missing[:10]],
+                   "first_extra": [describe(c) for c in extra[:10]]},
+    }
+    with open(args.output, "w", encoding="utf-8") as f:
+        json.dump(report, f, indent=2)
+
+    firmware_diffs = firmware["dropped"] + firmware["flipped"] + firmware["extra"]
+    print("\n📼 REPRODUCCIÓN DE TRAZA")
+    print("=" * 45)
+    print(f"   Log: {args.log} ({conversion['events']} eventos, {conversion['skipped']} líneas ignoradas)")
+    print(f"   Firmware (umbral {args.threshold:.1f} cm): {firmware['replayed_events']} eventos, "
+          f"{firmware['events_per_second'] / 1e6:.1f} M eventos/s")
+    print(f"      Coinciden {firmware['matched']}, omitidos {firmware['dropped']}, "
+          f"invertidos {firmware['flipped']}")
+    if spots:
+        print(f"   Servidor ({len(spots)} espacios con diferencias): "
+              f"{len(baseline)} cambios publicados → {len(replayed)}")
+    else:
+        print("   Servidor: sin espacios con diferencias, mismos cambios publicados")
+    for change in missing[:5]:
+        print(f"      − {describe(change)}")
+    for change in extra[:5]:
+        print(f"      + {describe(change)}")
+    print("=" * 45)
+    print(f"📁 Informe guardado en {args.output}")
+    return 0 if firmware_diffs == 0 and not missing and not extra else 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,504 @@
+#!/usr/bin/env python3
+"""
+Entrena el clasificador de ocupación int8 de lib/OccupancyClassifier
+
+El ESP32 confirma o veta los cambios de estado del ultrasonido con una
+miniatura en escala de grises del espacio: el DC de cada bloque de luminancia
+del JPEG (1/8 de escala, sin IDCT) reducido por promedio a 16x12. Una
+persona parada, un carrito o la lluvia frente al sensor dan lecturas cortas
+como un auto, pero no se ven como un auto.
+
+Modelo: 192 entradas (miniatura menos su promedio) → 16 ReLU → 2 logits
+(vacío, auto). Se entrena en punto flotante con SGD y se cuantiza a int8 por
+tensor; la capa oculta se recuantiza con multiplicador entero y corrimiento,
+así que el ESP32 y el host dan exactamente los mismos logits (int32).
+
+Datos: escenas sintéticas (piso con gradiente, líneas de demarcación,
+manchas, sombras, autos de cualquier color, personas, carritos, lluvia y
+cambios de exposición) más, opcionalmente, miniaturas reales en PGM:
+    muestras/occupied/*.pgm     espacio ocupado por un auto
+    muestras/empty/*.pgm        vacío, con o sin personas u objetos
+de cualquier tamaño (se reducen a 16x12 como en el ESP32).
+
+Genera:
+    lib/OccupancyClassifier/OccupancyModel.h        pesos int8 (firmware)
+    lib/OccupancyClassifier/OccupancyReference.h    entradas y logits de
+        referencia calculados aquí en enteros: las pruebas y el benchmark
+        los comparan bit a bit con el kernel del ESP32 y el del host
+
+Uso:
+    python train_occupancy_model.py
+    python train_occupancy_model.py --samples muestras/ --epochs 20
+"""
+
+import argparse
+import math
+import os
+import random
+
+WIDTH = 16
+HEIGHT = 12
+INPUTS = WIDTH * HEIGHT
+HIDDEN = 16
+OUTPUTS = 2                 # 0 = vacío, 1 = auto
+INPUT_SCALE = 1.0 / 64      # Valor real de una unidad de la entrada int8
+REFERENCE_COUNT = 8
+
+SCENE_WIDTH = 40            # Miniatura DC de un QVGA
+SCENE_HEIGHT = 30
+
+MODEL_HEADER = "lib/OccupancyClassifier/OccupancyModel.h"
+REFERENCE_HEADER = "lib/OccupancyClassifier/OccupancyReference.h"
+
+
+# ---- Preprocesamiento (igual que CameraManager::captureGrayscale y
+# ---- OccupancyClassifier::prepare) ----
+
+def box_resize(pixels, width, height, out_width=WIDTH, out_height=HEIGHT):
+    """Promedio por áreas con los mismos límites enteros que el ESP32"""
+    out = []
+    for oy in range(out_height):
+        y0 = oy * height // out_height
+        y1 = max((oy + 1) * height // out_height, y0 + 1)
+        for ox in range(out_width):
+            x0 = ox * width // out_width
+            x1 = max((ox + 1) * width // out_width, x0 + 1)
+            total = 0
+            for y in range(y0, y1):
+                row = y * width
+                total += sum(pixels[row + x0:row + x1])
+            count = (y1 - y0) * (x1 - x0)
+            out.append((total + count // 2) // count)
+    return out
+
+
+def prepare(gray):
+    """Miniatura 0-255 → entrada int8 centrada en su promedio"""
+    mean = sum(gray) // len(gray)
+    return [max(-128, min(127, g - mean)) for g in gray]
+
+
+# ---- Escenas sintéticas ----
+
+def clamp_pixel(value):
+    return 0 if value < 0 else 255 if value > 255 else int(value)
+
+
+def fill_rect(scene, x0, y0, x1, y1, delta, absolute=None):
+    for y in range(max(0, int(y0)), min(SCENE_HEIGHT, int(math.ceil(y1)))):
+        for x in range(max(0, int(x0)), min(SCENE_WIDTH, int(math.ceil(x1)))):
+            i = y * SCENE_WIDTH + x
+            scene[i] = absolute if absolute is not None else scene[i] + delta
+
+
+def fill_blob(scene, cx, cy, rx, ry, delta):
+    for y in range(max(0, int(cy - ry)), min(SCENE_HEIGHT, int(cy + ry) + 1)):
+        for x in range(max(0, int(cx - rx)), min(SCENE_WIDTH, int(cx + rx) + 1)):
+            d = ((x - cx) / max(rx, 0.5)) ** 2 + ((y - cy) / max(ry, 0.5)) ** 2
+            if d <= 1.0:
+                scene[y * SCENE_WIDTH + x] += delta * (1.0 - 0.5 * d)
+
+
+def contrast(rng, floor, minimum=25):
+    """Brillo de un objeto que se distingue del piso (más claro u oscuro)"""
+    while True:
+        value = rng.uniform(15, 240)
+        if abs(value - floor) >= minimum:
+            return value
+
+
+def draw_car(rng, scene, floor):
+    w = rng.uniform(0.35, 0.9) * SCENE_WIDTH
+    h = rng.uniform(0.3, 0.7) * SCENE_HEIGHT
+    cx = rng.uniform(0.38, 0.62) * SCENE_WIDTH
+    bottom = min(SCENE_HEIGHT, rng.uniform(0.7, 1.05) * SCENE_HEIGHT)
+    x0, x1, y0 = cx - w / 2, cx + w / 2, bottom - h
+    body = contrast(rng, floor)
+    fill_rect(scene, x0, y0, x1, bottom, 0, absolute=body)
+    if rng.random() < 0.7:
+        # Parabrisas o luneta oscuros y ruedas en las esquinas de abajo
+        glass = body - rng.uniform(30, 90)
+        fill_rect(scene, x0 + w * 0.15, y0 + h * 0.08, x1 - w * 0.15, y0 + h * 0.4, 0, absolute=glass)
+        for wx in (x0 + w * 0.15, x1 - w * 0.15):
+            fill_blob(scene, wx, bottom - 0.5, w * 0.08, h * 0.12, -rng.uniform(30, 80))
+    if rng.random() < 0.5:
+        fill_rect(scene, x0, bottom, x1, bottom + rng.uniform(1, 3), -rng.uniform(15, 45))   # Sombra
+
+
+def draw_person(rng, scene, floor):
+    w = rng.uniform(0.05, 0.14) * SCENE_WIDTH
+    h = rng.uniform(0.35, 0.75) * SCENE_HEIGHT
+    cx = rng.uniform(0.12, 0.88) * SCENE_WIDTH
+    bottom = rng.uniform(0.6, 1.0) * SCENE_HEIGHT
+    body = contrast(rng, floor)
+    fill_rect(scene, cx - w / 2, bottom - h, cx + w / 2, bottom, 0, absolute=body)
+    fill_blob(scene, cx, bottom - h - w * 0.4, w * 0.45, w * 0.45, body - floor)
+
+
+def draw_cart(rng, scene, floor):
+    w = rng.uniform(0.1, 0.25) * SCENE_WIDTH
+    h = rng.uniform(0.1, 0.25) * SCENE_HEIGHT
+    cx = rng.uniform(0.15, 0.85) * SCENE_WIDTH
+    bottom = rng.uniform(0.75, 1.0) * SCENE_HEIGHT
+    fill_rect(scene, cx - w / 2, bottom - h, cx + w / 2, bottom, 0, absolute=contrast(rng, floor, 15))
+
+
+def draw_rain(rng, scene):
+    for _ in range(rng.randint(10, 40)):
+        x = rng.randrange(SCENE_WIDTH)
+        y = rng.randrange(SCENE_HEIGHT)
+        delta = rng.uniform(20, 60)
+        for dy in range(rng.randint(2, 8)):
+            if y + dy < SCENE_HEIGHT:
+                scene[(y + dy) * SCENE_WIDTH + x] += delta
+    for i in range(len(scene)):
+        scene[i] += rng.uniform(-15, 15)
+
+
+def synthetic_scene(rng, kind):
+    """Miniatura DC 40x30 de un espacio; kind: empty, car, person, cart, rain, shadow"""
+    floor = rng.uniform(60, 190)
+    slope = rng.uniform(-30, 70)
+    side = rng.uniform(-15, 15)
+    scene = [floor + slope * (y / SCENE_HEIGHT - 0.5) + side * (x / SCENE_WIDTH - 0.5)
+             for y in range(SCENE_HEIGHT) for x in range(SCENE_WIDTH)]
+    if rng.random() < 0.7:
+        line = rng.uniform(30, 80) * (1 if floor < 170 else -1)
+        for x in (rng.randint(0, 6), rng.randint(SCENE_WIDTH - 7, SCENE_WIDTH - 1)):
+            fill_rect(scene, x, 0, x + 1, SCENE_HEIGHT, line)
+    for _ in range(rng.randint(0, 2)):
+        fill_blob(scene, rng.uniform(0, SCENE_WIDTH), rng.uniform(0, SCENE_HEIGHT),
+                  rng.uniform(1, 3), rng.uniform(1, 2), -rng.uniform(10, 40))
+
+    if kind == "shadow" or rng.random() < 0.15:
+        # Sombra de un auto vecino o de una columna sobre parte del espacio
+        edge = rng.uniform(0.2, 0.8) * SCENE_WIDTH
+        if rng.random() < 0.5:
+            fill_rect(scene, 0, 0, edge, SCENE_HEIGHT, -rng.uniform(20, 60))
+        else:
+            fill_rect(scene, edge, 0, SCENE_WIDTH, SCENE_HEIGHT, -rng.uniform(20, 60))
+    if kind == "car":
+        draw_car(rng, scene, floor)
+        if rng.random() < 0.1:
+            draw_person(rng, scene, floor)
+    elif kind == "person":
+        for _ in range(rng.randint(1, 2)):
+            draw_person(rng, scene, floor)
+    elif kind == "cart":
+        draw_cart(rng, scene, floor)
+        if rng.random() < 0.4:
+            draw_person(rng, scene, floor)
+    elif kind == "rain":
+        draw_rain(rng, scene)
+        if rng.random() < 0.3:
+            draw_person(rng, scene, floor)
+
+    # Exposición y ganancia distintas entre cuadros (día, noche, contraluz)
+    gain = rng.uniform(0.4, 1.3)
+    offset = rng.uniform(-40, 40)
+    noise = rng.uniform(1, 6)
+    return [clamp_pixel(128 + (v - 128) * gain + offset + rng.uniform(-noise, noise)) for v in scene]
+
+
+KINDS = [("car", 1, 0.45), ("empty", 0, 0.2), ("person", 0, 0.15), ("cart", 0, 0.08),
+         ("rain", 0, 0.07), ("shadow", 0, 0.05)]
+
+
+def synthetic_samples(rng, count):
+    samples = []
+    for _ in range(count):
+        pick = rng.random()
+        for kind, label, share in KINDS:
+            pick -= share
+            if pick < 0:
+                break
+        gray = box_resize(synthetic_scene(rng, kind), SCENE_WIDTH, SCENE_HEIGHT)
+        samples.append((gray, label))
+    return samples
+
+
+def read_pgm(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            pos = data.index(b"\n", pos)
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        fields.append(data[start:pos])
+    if fields[0] != b"P5" or int(fields[3]) > 255:
+        raise ValueError(f"{path}: solo PGM binario de 8 bits")
+    width, height = int(fields[1]), int(fields[2])
+    pixels = list(data[pos + 1:pos + 1 + width * height])
+    return box_resize(pixels, width, height)
+
+
+def sample_directory(path):
+    samples = []
+    for folder, label in (("occupied", 1), ("empty", 0)):
+        folder = os.path.join(path, folder)
+        if not os.path.isdir(folder):
+            continue
+        for name in sorted(os.listdir(folder)):
+            if name.lower().endswith(".pgm"):
+                samples.append((read_pgm(os.path.join(folder, name)), label))
+    return samples
+
+
+# ---- Entrenamiento en punto flotante ----
+
+def forward(model, x):
+    w1, b1, w2, b2 = model
+    hidden = [max(0.0, sum(w * v for w, v in zip(row, x)) + b) for row, b in zip(w1, b1)]
+    logits = [sum(w * h for w, h in zip(row, hidden)) + b for row, b in zip(w2, b2)]
+    return hidden, logits
+
+
+def train(samples, epochs, seed):
+    rng = random.Random(seed)
+    scale1 = math.sqrt(2.0 / INPUTS)
+    scale2 = math.sqrt(2.0 / HIDDEN)
+    w1 = [[rng.gauss(0, scale1) for _ in range(INPUTS)] for _ in range(HIDDEN)]
+    b1 = [0.0] * HIDDEN
+    w2 = [[rng.gauss(0, scale2) for _ in range(HIDDEN)] for _ in range(OUTPUTS)]
+    b2 = [0.0] * OUTPUTS
+    model = (w1, b1, w2, b2)
+    inputs = [([v * INPUT_SCALE for v in prepare(gray)], label) for gray, label in samples]
+
+    for epoch in range(epochs):
+        rng.shuffle(inputs)
+        rate = 0.02 * (1.0 - epoch / epochs) + 0.001
+        loss = 0.0
+        correct = 0
+        for x, label in inputs:
+            hidden, logits = forward(model, x)
+            top = max(logits)
+            exps = [math.exp(v - top) for v in logits]
+            total = sum(exps)
+            probs = [e / total for e in exps]
+            loss -= math.log(max(probs[label], 1e-12))
+            correct += probs[label] > 0.5
+
+            # Entropía cruzada: gradiente de los logits = p - y
+            grad = [p - (1.0 if k == label else 0.0) for k, p in enumerate(probs)]
+            grad_hidden = [sum(grad[k] * w2[k][j] for k in range(OUTPUTS)) if hidden[j] > 0 else 0.0
+                           for j in range(HIDDEN)]
+            for k in range(OUTPUTS):
+                step = rate * grad[k]
+                w2[k] = [w - step * h - rate * 1e-4 * w for w, h in zip(w2[k], hidden)]
+                b2[k] -= step
+            for j in range(HIDDEN):
+                if grad_hidden[j] != 0.0:
+                    step = rate * grad_hidden[j]
+                    w1[j] = [w - step * v - rate * 1e-4 * w for w, v in zip(w1[j], x)]
+                    b1[j] -= step
+        print(f"   época {epoch + 1:2d}: pérdida {loss / len(inputs):.4f}, exactitud {100.0 * correct / len(inputs):.1f}%")
+    return model
+
+
+# ---- Cuantización e inferencia entera (la misma aritmética que el ESP32) ----
+
+def quantize(model, samples):
+    w1, b1, w2, b2 = model
+    w1_scale = max(abs(w) for row in w1 for w in row) / 127
+    w1_q = [[max(-127, min(127, round(w / w1_scale))) for w in row] for row in w1]
+    acc_scale = w1_scale * INPUT_SCALE
+    b1_q = [round(b / acc_scale) for b in b1]
+
+    # Escala de la capa oculta: la mayor activación sobre los datos de entrenamiento
+    peak = 1
+    for gray, _ in samples:
+        x = prepare(gray)
+        for row, b in zip(w1_q, b1_q):
+            peak = max(peak, sum(w * v for w, v in zip(row, x)) + b)
+    hidden_scale = peak * acc_scale / 127
+
+    # hidden = (acc * multiplier + 2^(shift-1)) >> shift, multiplier en [2^30, 2^31)
+    ratio = acc_scale / hidden_scale
+    shift = 0
+    while ratio * (1 << shift) < (1 << 30):
+        shift += 1
+    multiplier = round(ratio * (1 << shift))
+    if multiplier >= 1 << 31:
+        multiplier //= 2
+        shift -= 1
+
+    w2_scale = max(abs(w) for row in w2 for w in row) / 127
+    w2_q = [[max(-127, min(127, round(w / w2_scale))) for w in row] for row in w2]
+    b2_q = [round(b / (w2_scale * hidden_scale)) for b in b2]
+    return {
+        "w1": w1_q, "b1": b1_q, "multiplier": multiplier, "shift": shift,
+        "w2": w2_q, "b2": b2_q, "output_scale": w2_scale * hidden_scale,
+    }
+
+
+def infer(q, gray):
+    """Logits int32 de una miniatura 16x12: referencia de OccupancyClassifier"""
+    x = prepare(gray)
+    rounding = 1 << (q["shift"] - 1)
+    hidden = []
+    for row, b in zip(q["w1"], q["b1"]):
+        acc = sum(w * v for w, v in zip(row, x)) + b
+        hidden.append(max(0, min(127, (acc * q["multiplier"] + rounding) >> q["shift"])))
+    return [sum(w * h for w, h in zip(row, hidden)) + b for row, b in zip(q["w2"], q["b2"])]
+
+
+def evaluate(q, samples, margin):
+    """Exactitud y fracción de veredictos firmes con el umbral de margen"""
+    correct = decided = 0
+    for gray, label in samples:
+        logits = infer(q, gray)
+        score = (logits[1] - logits[0]) * q["output_scale"]
+        if abs(score) >= margin:
+            decided += 1
+            correct += (score > 0) == (label == 1)
+    return correct, decided
+
+
+# ---- Cabeceras C++ ----
+
+def c_array(values, per_line=16, indent="    "):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append(indent + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def write_model(path, q, summary):
+    rows = []
+    for row in q["w1"]:
+        rows.append("    {\n" + c_array(row, indent="        ") + "\n    },")
+    out = f"""#ifndef OCCUPANCYMODEL_H
+#define OCCUPANCYMODEL_H
+
+// Generado por train_occupancy_model.py: no editar a mano.
+// {summary}
+//
+// Miniatura {WIDTH}x{HEIGHT} menos su promedio (int8) → {HIDDEN} ReLU (int8) → {OUTPUTS} logits (int32).
+// Los pesos van alineados a 16 bytes para las cargas de 128 bits del ESP32-S3.
+
+#include <stdint.h>
+
+#define OCC_INPUT_WIDTH {WIDTH}
+#define OCC_INPUT_HEIGHT {HEIGHT}
+#define OCC_INPUTS {INPUTS}
+#define OCC_HIDDEN {HIDDEN}
+#define OCC_OUTPUTS {OUTPUTS}
+
+alignas(16) static const int8_t OCC_W1[OCC_HIDDEN][OCC_INPUTS] = {{
+{chr(10).join(rows)}
+}};
+
+static const int32_t OCC_B1[OCC_HIDDEN] = {{
+{c_array(q["b1"], per_line=8)}
+}};
+
+// Recuantización de la capa oculta: (acc * MULTIPLIER + 2^(SHIFT-1)) >> SHIFT
+static const int32_t OCC_REQUANT_MULTIPLIER = {q["multiplier"]};
+static const int OCC_REQUANT_SHIFT = {q["shift"]};
+
+alignas(16) static const int8_t OCC_W2[OCC_OUTPUTS][OCC_HIDDEN] = {{
+    {{{", ".join(str(v) for v in q["w2"][0])}}},
+    {{{", ".join(str(v) for v in q["w2"][1])}}},
+}};
+
+static const int32_t OCC_B2[OCC_OUTPUTS] = {{{q["b2"][0]}, {q["b2"][1]}}};
+
+// Valor real (logit) de una unidad de los logits enteros
+static const float OCC_OUTPUT_SCALE = {q["output_scale"]:.9g}f;
+
+#endif // OCCUPANCYMODEL_H
+"""
+    with open(path, "w") as f:
+        f.write(out)
+
+
+def write_reference(path, references):
+    inputs = []
+    logits = []
+    for gray, label, result in references:
+        inputs.append(f"    {{  // {'auto' if label else 'vacío'}\n" + c_array(gray, indent="        ") + "\n    },")
+        logits.append(f"    {{{result[0]}, {result[1]}}},")
+    out = f"""#ifndef OCCUPANCYREFERENCE_H
+#define OCCUPANCYREFERENCE_H
+
+// Generado por train_occupancy_model.py: no editar a mano.
+//
+// Miniaturas de prueba y los logits que calcula la referencia entera en
+// Python. El kernel del ESP32 (vectorial o escalar) y el del host tienen que
+// dar exactamente estos valores. Solo para pruebas y benchmark: no incluir
+// en el firmware.
+
+#include <stdint.h>
+
+#include "OccupancyModel.h"
+
+#define OCC_REFERENCE_COUNT {len(references)}
+
+static const uint8_t OCC_REFERENCE_INPUTS[OCC_REFERENCE_COUNT][OCC_INPUTS] = {{
+{chr(10).join(inputs)}
+}};
+
+static const int32_t OCC_REFERENCE_LOGITS[OCC_REFERENCE_COUNT][OCC_OUTPUTS] = {{
+{chr(10).join(logits)}
+}};
+
+#endif // OCCUPANCYREFERENCE_H
+"""
+    with open(path, "w") as f:
+        f.write(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Entrena el clasificador de ocupación int8")
+    parser.add_argument("--samples", default=None, help="Directorio con occupied/ y empty/ (PGM)")
+    parser.add_argument("--synthetic", type=int, default=6000, help="Escenas sintéticas de entrenamiento")
+    parser.add_argument("--epochs", type=int, default=20)
+    parser.add_argument("--seed", type=int, default=42)
+    parser.add_argument("--margin", type=float, default=2.0, help="Margen de veredicto para la evaluación")
+    parser.add_argument("--output", default=MODEL_HEADER)
+    parser.add_argument("--reference", default=REFERENCE_HEADER)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    samples = synthetic_samples(rng, args.synthetic)
+    validation = synthetic_samples(rng, args.synthetic // 4)
+    if args.samples:
+        real = sample_directory(args.samples)
+        rng.shuffle(real)
+        split = len(real) // 5
+        validation += real[:split]
+        samples += real[split:] * 4     # Las reales pesan más que las sintéticas
+        print(f"📂 {len(real)} miniaturas reales de {args.samples}")
+    print(f"🧠 Entrenando con {len(samples)} miniaturas ({args.epochs} épocas)")
+
+    model = train(samples, args.epochs, args.seed)
+    q = quantize(model, samples)
+    correct, decided = evaluate(q, validation, 0.0)
+    firm_correct, firm = evaluate(q, validation, args.margin)
+    summary = (f"{len(samples)} muestras, semilla {args.seed}; validación int8: "
+               f"{100.0 * correct / len(validation):.1f}% de aciertos, "
+               f"{100.0 * firm / len(validation):.1f}% con margen >= {args.margin} "
+               f"({100.0 * firm_correct / max(firm, 1):.1f}% de aciertos)")
+    print(f"📊 {summary}")
+
+    # Referencias: las primeras miniaturas de validación de cada clase
+    references = []
+    for wanted in (1, 0) * (REFERENCE_COUNT // 2):
+        for gray, label in validation:
+            if label == wanted and all(gray is not r[0] for r in references):
+                references.append((gray, label, infer(q, gray)))
+                break
+    write_model(args.output, q, summary)
+    write_reference(args.reference, references)
+    print(f"✅ {args.output} y {args.reference}")
+
+
+if __name__ == "__main__":
+    main()